@@ -0,0 +1,75 @@
+# STLINK-V3-BRIDGE library sources and platform settings, included by
+# STLinkV3Bridge.pro (library) and test/bridge_test.pro (test program)
+
+win32 {
+    DEFINES += \
+        WIN32 \
+        USING_ERRORLOG
+}
+
+INCLUDEPATH += \
+    $$PWD/src/bridge \
+    $$PWD/src/common \
+    $$PWD/src/error
+
+SOURCES += \
+    $$PWD/src/bridge/bridge.cpp \
+    $$PWD/src/bridge/bridge_sim.cpp \
+    $$PWD/src/bridge/bridge_async.cpp \
+    $$PWD/src/bridge/bridge_i2c_cache.cpp \
+    $$PWD/src/bridge/bridge_i2c_eeprom.cpp \
+    $$PWD/src/bridge/bridge_i2c_pipeline.cpp \
+    $$PWD/src/bridge/bridge_spsc_ring.cpp \
+    $$PWD/src/bridge/bridge_i2c_sampler.cpp \
+    $$PWD/src/bridge/bridge_spi_flash.cpp \
+    $$PWD/src/bridge/bridge_can_rx.cpp \
+    $$PWD/src/bridge/bridge_can_capture.cpp \
+    $$PWD/src/bridge/bridge_can_tx.cpp \
+    $$PWD/src/bridge/bridge_can_filter.cpp \
+    $$PWD/src/bridge/bridge_can_soft_filter.cpp \
+    $$PWD/src/bridge/bridge_can_isotp.cpp \
+    $$PWD/src/common/stlink_interface.cpp \
+    $$PWD/src/common/stlink_device.cpp \
+    $$PWD/src/common/stlink_cmd_stats.cpp \
+    $$PWD/src/common/stlink_usbdriver.cpp \
+    $$PWD/src/common/stlink_libusb.cpp \
+    $$PWD/src/common/criticalsectionlock.cpp \
+    $$PWD/src/error/ErrLog.cpp
+
+HEADERS += \
+    $$PWD/src/bridge/bridge.h \
+    $$PWD/src/bridge/bridge_sim.h \
+    $$PWD/src/bridge/bridge_async.h \
+    $$PWD/src/bridge/bridge_i2c_cache.h \
+    $$PWD/src/bridge/bridge_i2c_eeprom.h \
+    $$PWD/src/bridge/bridge_i2c_pipeline.h \
+    $$PWD/src/bridge/bridge_spsc_ring.h \
+    $$PWD/src/bridge/bridge_i2c_sampler.h \
+    $$PWD/src/bridge/bridge_spi_flash.h \
+    $$PWD/src/bridge/bridge_can_rx.h \
+    $$PWD/src/bridge/bridge_can_capture.h \
+    $$PWD/src/bridge/bridge_can_tx.h \
+    $$PWD/src/bridge/bridge_can_filter.h \
+    $$PWD/src/bridge/bridge_can_soft_filter.h \
+    $$PWD/src/bridge/bridge_can_isotp.h \
+    $$PWD/src/bridge/stlink_fw_const_bridge.h \
+    $$PWD/src/bridge/stlink_fw_api_bridge.h \
+    $$PWD/src/common/STLinkUSBDriver.h \
+    $$PWD/src/common/stlink_type.h \
+    $$PWD/src/common/stlink_interface.h \
+    $$PWD/src/common/stlink_if_common.h \
+    $$PWD/src/common/stlink_fw_api_common.h \
+    $$PWD/src/common/stlink_device.h \
+    $$PWD/src/common/stlink_cmd_stats.h \
+    $$PWD/src/common/stlink_transport.h \
+    $$PWD/src/common/stlink_usbdriver.h \
+    $$PWD/src/common/stlink_libusb.h \
+    $$PWD/src/common/criticalsectionlock.h \
+    $$PWD/src/error/ErrLog.h
+
+win32: LIBS += -lShLwApi
+
+# Native libusb-1.0 transport on Linux/MacOS (libSTLinkUSBDriver.so not required)
+unix: DEFINES += USING_LIBUSB
+unix: CONFIG += link_pkgconfig
+unix: PKGCONFIG += libusb-1.0
@@ -5,13 +5,6 @@ TARGET = STLINK-V3-BRIDGE
 TEMPLATE = lib
 DEFINES += STLINKV3BRIDGE_LIBRARY
 
-win32
-{
-    DEFINES += \
-        WIN32 \
-        USING_ERRORLOG
-}
-
 CONFIG += c++11
 
 # The following define makes your compiler emit warnings if you use
@@ -25,40 +18,14 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
-INCLUDEPATH += \
-    src/bridge \
-    src/common \
-    src/error
-
-SOURCES += \
-    src/bridge/bridge.cpp \
-    src/common/stlink_interface.cpp \
-    src/common/stlink_device.cpp \
-    src/common/criticalsectionlock.cpp \
-    src/error/ErrLog.cpp
-
-HEADERS += \
-    src/bridge/bridge.h \
-    src/bridge/stlink_fw_const_bridge.h \
-    src/bridge/stlink_fw_api_bridge.h \
-    src/common/STLinkUSBDriver.h \
-    src/common/stlink_type.h \
-    src/common/stlink_interface.h \
-    src/common/stlink_if_common.h \
-    src/common/stlink_fw_api_common.h \
-    src/common/stlink_device.h \
-    src/common/criticalsectionlock.h \
-    src/error/ErrLog.h
+# Library sources, shared with the test program (test/bridge_test.pro)
+include(STLinkV3Bridge.pri)
 
 # Default rules for deployment.
-unix
-{
+unix {
     target.path = /usr/lib
 }
-win32
-{
+win32 {
     target.path = $$PWD
 }
 !isEmpty(target.path): INSTALLS += target
-
-win32: LIBS += -lShLwApi
@@ -33,16 +33,40 @@
 #endif
 
 #include <math.h>
+#include <new>
 #include "bridge.h"
 
 /* Private typedef -----------------------------------------------------------*/
-// I2C structure for timing calculation
+// I2C terms for timing calculation, common to all PRESC/SCLL/SCLH candidates
 typedef struct {
-    int prescaler;
-    int SDLDEL;
-    int SCLDEL;
-    double resultat;
-} Brg_I2cModelT;
+	double clkPeriodI2C;   // Period of clock
+	double tsync;          // SCL synchronization delay
+	double delayFilter;    // Analog and digital filters delay
+	double riseTimeCalc;   // Rise time
+	double fallTimeCalc;   // Fall time
+	double tLowMin;        // Boundaries of the I2C mode
+	double tHighMin;
+	double targetFreqI2C;  // Target frequency
+	double clkMin;         // Accepted frequency range
+	double clkMax;
+} Brg_I2cTimingCtxT;
+
+// I2C best timing candidate
+typedef struct {
+	double error; // Relative frequency error
+	int presc;    // -1 if no candidate
+	int scll;
+	int sclh;
+} Brg_I2cTimingBestT;
+
+// Fields of a received CAN message given by its message type byte, see s_canRxFlags
+typedef struct {
+	Brg_CanMsgIdT IDE;
+	Brg_CanMsgRtrT RTR;
+	Brg_CanRxFifoT Fifo;
+	Brg_CanRxOverrunT Overrun;
+	uint8_t DataMask;  // DLC mask of the copied data: 0 for remote frames
+} Brg_CanRxFlagsT;
 
 /* Private defines -----------------------------------------------------------*/
 // Size in bytes of a USB bridge command
@@ -58,9 +82,31 @@ typedef struct {
 #define SCLDEL_LENGTH  16
 #define SCLDEL_LENGTH  16
 #define PRESC_LENGTH   16
-#define MODE_NUMBER    3
+
+// Message type bits of a CAN_MSG_FORMAT_V1 received message (see Brg_CanRxFlagsT)
+#define CAN_RX_FLAGS_MASK 0x1F
+
+// I2cTimingScanSum() result bits: valid candidates faster/slower than the target frequency
+#define I2C_TIMING_FASTER  0x1
+#define I2C_TIMING_SLOWER  0x2
 
 /* Private macros ------------------------------------------------------------*/
+// Brg::ExecuteBatch() operations followed by a Read/Write status
+#define IS_BATCH_RW_OP(_type) (((_type) != BATCH_SPI_CS) && ((_type) != BATCH_GPIO_SET))
+// Communication of a Brg::ExecuteBatch() operation
+#define BATCH_OP_COM(_type) (((_type) <= BATCH_SPI_READ) ? COM_SPI : ((_type) == BATCH_GPIO_SET) ? COM_GPIO : \
+                             ((_type) == BATCH_CAN_WRITE) ? COM_CAN : COM_I2C)
+
+// s_canRxFlags entry of the message type byte _f
+#define CAN_RX_FLAGS(_f) { \
+	(((_f)&BRG_CAN_RX_FLAG_IDE) != 0) ? CAN_ID_EXTENDED : CAN_ID_STANDARD, \
+	(((_f)&BRG_CAN_RX_FLAG_RTR) != 0) ? CAN_REMOTE_FRAME : CAN_DATA_FRAME, \
+	(((_f)&BRG_CAN_RX_FLAG_FIFO1) != 0) ? CAN_MSG_RX_FIFO1 : CAN_MSG_RX_FIFO0, \
+	(((_f)&BRG_CAN_RX_FLAG_OVERRUN) == 0) ? CAN_RX_NO_OVERRUN : \
+	((((_f)&BRG_CAN_RX_FLAG_OVERRUN) == 0x08) ? CAN_RX_FIFO_OVERRUN : CAN_RX_BUFF_OVERRUN), \
+	(uint8_t)((((_f)&BRG_CAN_RX_FLAG_RTR) != 0) ? 0x00 : 0xFF) }
+#define CAN_RX_FLAGS4(_f) CAN_RX_FLAGS(_f), CAN_RX_FLAGS((_f)+1), CAN_RX_FLAGS((_f)+2), CAN_RX_FLAGS((_f)+3)
+
 /* Private variables ---------------------------------------------------------*/
 // I2C constants for timing calculation
 const double TFALL_MAX_T0 = (double)(300 / pow((double)10, 9));
@@ -87,7 +133,92 @@ const double THIGH_MIN0 = (double)(4 / pow((double)10, 6));
 const double THIGH_MIN1 = (double)(0.6 / pow((double)10, 6));
 const double THIGH_MIN2 = (double)(0.26 / pow((double)10, 6));
 
+// GetRxMsgCAN() decode of the message type byte (bits 0 to 4) of a CAN_MSG_FORMAT_V1 message
+static const Brg_CanRxFlagsT s_canRxFlags[CAN_RX_FLAGS_MASK+1] = {
+	CAN_RX_FLAGS4(0),  CAN_RX_FLAGS4(4),  CAN_RX_FLAGS4(8),  CAN_RX_FLAGS4(12),
+	CAN_RX_FLAGS4(16), CAN_RX_FLAGS4(20), CAN_RX_FLAGS4(24), CAN_RX_FLAGS4(28)
+};
+
 /* Global variables ----------------------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+/*
+ * I2C timing calculation: SCL low and high periods of a PRESC/SCLL/SCLH candidate
+ */
+static double I2cTimingSclPeriod(const Brg_I2cTimingCtxT *pCtx, int Presc, int SclReg)
+{
+	double presc = (double)(Presc + 1) * (double)pCtx->clkPeriodI2C;
+	double tScl = (double)(SclReg + 1) * (double)presc;
+
+	return (double)tScl + (double)pCtx->tsync;
+}
+/*
+ * I2C timing calculation: lowest SCLL (bHigh false) or SCLH (bHigh true) meeting the SCL low/high
+ * constraints of the I2C mode, SCLL_LENGTH/SCLH_LENGTH if none (constraints met by all higher values)
+ */
+static int I2cTimingMinScl(const Brg_I2cTimingCtxT *pCtx, int Presc, bool bHigh)
+{
+	int sclReg;
+	double tScl;
+
+	for( sclReg = 0; sclReg < SCLL_LENGTH; sclReg++ ) {
+		tScl = I2cTimingSclPeriod(pCtx, Presc, sclReg);
+		if( bHigh == false ) {
+			if( (tScl >= pCtx->tLowMin) && (pCtx->clkPeriodI2C < ((tScl - pCtx->delayFilter) / 4)) ) {
+				break;
+			}
+		} else {
+			if( (tScl >= pCtx->tHighMin) && (pCtx->clkPeriodI2C < tScl) ) {
+				break;
+			}
+		}
+	}
+	return sclReg;
+}
+/*
+ * I2C timing calculation: evaluate all the SCLL/SCLH couples of Sum (SCLL >= SclMin, SCLH >= SclhMin)
+ * for Presc and update pBest. Candidates are compared as when scanning PRESC from the highest, then SCLL
+ * and SCLH from 0, the last one of equal error being kept.
+ * Returns I2C_TIMING_FASTER/I2C_TIMING_SLOWER bits of the valid candidates, 0 if none
+ */
+static int I2cTimingScanSum(const Brg_I2cTimingCtxT *pCtx, int Presc, int Sum, int SclMin, int SclhMin,
+                            Brg_I2cTimingBestT *pBest)
+{
+	int side = 0;
+	int scllFirst = (Sum - (SCLH_LENGTH - 1) > SclMin) ? (Sum - (SCLH_LENGTH - 1)) : SclMin;
+	int scllLast = (Sum - SclhMin < (SCLL_LENGTH - 1)) ? (Sum - SclhMin) : (SCLL_LENGTH - 1);
+
+	for( int scll = scllFirst; scll <= scllLast; scll++ ) {
+		int sclh = Sum - scll;
+		double tSclLow = I2cTimingSclPeriod(pCtx, Presc, scll);
+		double tSclHigh = I2cTimingSclPeriod(pCtx, Presc, sclh);
+		double tScl = (double)tSclLow + (double)tSclHigh + (double)pCtx->riseTimeCalc + (double)pCtx->fallTimeCalc;
+		double speed = 1 / (double)tScl;
+		double errorTmp;
+
+		if( (speed < pCtx->clkMin) || (speed > pCtx->clkMax) ) {
+			continue;
+		}
+		errorTmp = (double)(speed - pCtx->targetFreqI2C) / (double)(pCtx->targetFreqI2C);
+		if( errorTmp < 0 ) {
+			side |= I2C_TIMING_SLOWER;
+			errorTmp = (double)(0 - (double)errorTmp);
+		} else {
+			side |= I2C_TIMING_FASTER;
+		}
+
+		if( (errorTmp < pBest->error) ||
+		    ((errorTmp == pBest->error) &&
+		     ((pBest->presc < 0) || (Presc < pBest->presc) ||
+		      ((Presc == pBest->presc) && ((scll > pBest->scll) || ((scll == pBest->scll) && (sclh > pBest->sclh))))))) {
+			pBest->error = errorTmp;
+			pBest->presc = Presc;
+			pBest->scll = scll;
+			pBest->sclh = sclh;
+		}
+	}
+	return side;
+}
+
 
 /* Class Functions Definition ------------------------------------------------*/
 
@@ -96,9 +227,15 @@ const double THIGH_MIN2 = (double)(0.26 / pow((double)10, 6));
  * @brief Brg constructor
  * @param[in]  StlinkIf  reference to USB STLink Bridge interface: STLinkInterface(STLINK_BRIDGE)
  */
-Brg::Brg(STLinkInterface &StlinkIf): StlinkDevice(StlinkIf), m_slaveAddrPartialI2cTrans(0)
+Brg::Brg(STLinkInterface &StlinkIf): StlinkDevice(StlinkIf), m_slaveAddrPartialI2cTrans(0),
+	m_rwStatusMode(RW_STATUS_IMMEDIATE), m_rwBatchSize(0), m_rwPendingNb(0), m_rwSyncOpId(1),
+	m_rwDeferredStat(BRG_NO_ERR), m_pCanRxAnswer(NULL), m_canRxAnswerSize(0),
+	m_pGatherBuf(NULL), m_gatherBufSize(0), m_i2cTimingCacheNext(0)
 {
 	this->SetOpenModeExclusive(true);
+	memset(&m_rwLastOp, 0, sizeof(m_rwLastOp));
+	memset(&m_rwDeferredOp, 0, sizeof(m_rwDeferredOp));
+	memset(m_i2cTimingCache, 0, sizeof(m_i2cTimingCache));
 }
 /**
  * @ingroup DEVICE
@@ -109,6 +246,15 @@ Brg::~Brg(void)
 	// Close device if necessary
 	CloseBridge(COM_UNDEF_ALL);
 	// Close STLink is done by ~StlinkDevice
+
+	if( m_pCanRxAnswer != NULL ) {
+		delete [] m_pCanRxAnswer;
+		m_pCanRxAnswer = NULL;
+	}
+	if( m_pGatherBuf != NULL ) {
+		delete [] m_pGatherBuf;
+		m_pGatherBuf = NULL;
+	}
 }
 
 /**
@@ -277,7 +423,8 @@ Brg_StatusT Brg::CloseStlink(void)
  */
 Brg_StatusT Brg::CloseBridge(uint8_t BrgCom)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
 	uint32_t answer = 0;
 	uint8_t closeCom;
@@ -297,7 +444,6 @@ Brg_StatusT Brg::CloseBridge(uint8_t BrgCom)
 		closeCom = BrgCom;
 	}
 
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
@@ -313,8 +459,6 @@ Brg_StatusT Brg::CloseBridge(uint8_t BrgCom)
 
 	brgStat = SendRequestAndAnalyzeStatus(pRq, (uint16_t*)&answer);
 
-	delete pRq;
-
 	return brgStat;
 }
 /**
@@ -432,7 +576,8 @@ Brg_StatusT Brg::AnalyzeStatus(const uint16_t *pStatus)
  */
 Brg_StatusT Brg::GetClk(uint8_t BrgCom, uint32_t *pBrgInputClk, uint32_t *pStlHClk)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
 	uint8_t answer[12]={0,0,0,0,0,0,0,0,0,0,0,0};
 
@@ -448,7 +593,6 @@ Brg_StatusT Brg::GetClk(uint8_t BrgCom, uint32_t *pBrgInputClk, uint32_t *pStlHC
 		return BRG_NO_STLINK;
 	}
 
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
@@ -468,8 +612,6 @@ Brg_StatusT Brg::GetClk(uint8_t BrgCom, uint32_t *pBrgInputClk, uint32_t *pStlHC
 	*pBrgInputClk = (uint32_t)answer[4] | (uint32_t)answer[5]<<8 | (uint32_t)answer[6]<<16 | (uint32_t)answer[7]<<24;
 	*pStlHClk = (uint32_t)answer[8] | (uint32_t)answer[9]<<8 | (uint32_t)answer[10]<<16 | (uint32_t)answer[11]<<24;
 
-	delete pRq;
-
 	return brgStat;
 }
 /**
@@ -487,9 +629,10 @@ Brg_StatusT Brg::GetClk(uint8_t BrgCom, uint32_t *pBrgInputClk, uint32_t *pStlHC
  */
 Brg_StatusT Brg::InitSPI(const Brg_SpiInitT *pInitParams)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
-	uint16_t status;
+	uint16_t status = 0;
 
 	if( m_bStlinkConnected == false ) {
 		// The function should be called at least after OpenStlink
@@ -498,7 +641,6 @@ Brg_StatusT Brg::InitSPI(const Brg_SpiInitT *pInitParams)
 	if( pInitParams == NULL ) {
 		return BRG_PARAM_ERR;
 	}
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
@@ -521,12 +663,11 @@ Brg_StatusT Brg::InitSPI(const Brg_SpiInitT *pInitParams)
 		pRq->CDBByte[7] = 0; // CRC disable (0)
 		pRq->CDBByte[8] = 0;
 	} else {
-		if( ((pInitParams->CrcPoly & 0x1) == 0x1) && (pInitParams->CrcPoly <= 0xFFFF) ) {
+		if( (pInitParams->CrcPoly & 0x1) == 0x1 ) {
 			// CRC polynomial >= 0x1 (odd value only)
 			pRq->CDBByte[7] = (uint8_t)(pInitParams->CrcPoly&0xFF);
 			pRq->CDBByte[8] = (uint8_t)((pInitParams->CrcPoly>>8)&0xFF);
 		} else {
-			delete pRq;
 			return BRG_PARAM_ERR;
 		}
 	}
@@ -543,7 +684,6 @@ Brg_StatusT Brg::InitSPI(const Brg_SpiInitT *pInitParams)
 	pRq->SenseLength=DEFAULT_SENSE_LEN;
 
 	brgStat = SendRequestAndAnalyzeStatus(pRq, &status);
-	delete pRq;
 
 	return brgStat;
 }
@@ -631,16 +771,16 @@ Brg_StatusT Brg::GetSPIbaudratePrescal(uint32_t ReqSpiFreqKHz, Brg_SpiBaudrateT
  */
 Brg_StatusT Brg::SetSPIpinCS(Brg_SpiNssLevelT NssLevel)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
-	uint16_t status;
+	uint16_t status = 0;
 
 	if( m_bStlinkConnected == false ) {
 		// The function should be called at least after OpenStlink
 		return BRG_NO_STLINK;
 	}
 
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
@@ -654,7 +794,6 @@ Brg_StatusT Brg::SetSPIpinCS(Brg_SpiNssLevelT NssLevel)
 	pRq->SenseLength=DEFAULT_SENSE_LEN;
 
 	brgStat = SendRequestAndAnalyzeStatus(pRq, &status);
-	delete pRq;
 
 	return brgStat;
 }
@@ -674,7 +813,8 @@ Brg_StatusT Brg::SetSPIpinCS(Brg_SpiNssLevelT NssLevel)
  */
 Brg_StatusT Brg::ReadSPI(uint8_t *pBuffer, uint16_t SizeInBytes, uint16_t *pSizeRead)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
 
 	if( m_bStlinkConnected == false ) {
@@ -688,7 +828,6 @@ Brg_StatusT Brg::ReadSPI(uint8_t *pBuffer, uint16_t SizeInBytes, uint16_t *pSize
 		return BRG_NO_ERR;
 	}
 
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBByte[0] = STLINK_BRIDGE_COMMAND;
@@ -703,13 +842,15 @@ Brg_StatusT Brg::ReadSPI(uint8_t *pBuffer, uint16_t SizeInBytes, uint16_t *pSize
 
 	pRq->SenseLength=DEFAULT_SENSE_LEN;
 
-	brgStat = SendRequestAndAnalyzeStatus(pRq, NULL);
+	// Command and its status must not be interleaved with other commands
+	CSLocker locker(m_csDevice);
 
-	delete pRq;
+	RwStatusBeforeCmd(COM_SPI);
+	brgStat = SendRequestAndAnalyzeStatus(pRq, NULL);
 
 	if( brgStat == BRG_NO_ERR )
 	{	// pErrorInfo currently unused
-		brgStat = GetLastReadWriteStatus(pSizeRead, NULL);
+		brgStat = RwStatusAfterCmd(COM_SPI, SizeInBytes, pSizeRead, NULL);
 	}
 
 	if( brgStat != BRG_NO_ERR ) {
@@ -746,8 +887,7 @@ Brg_StatusT Brg::ReadSPI(uint8_t *pBuffer, uint16_t SizeInBytes, uint16_t *pSize
  */
 Brg_StatusT Brg::WriteSPI(const uint8_t *pBuffer, uint16_t SizeInBytes, uint16_t *pSizeWritten)
 {
-	STLink_DeviceRequestT *pRq;
-	Brg_StatusT brgStat;
+	Brg_SpanT span;
 
 	if( m_bStlinkConnected == false ) {
 		// The function should be called at least after OpenStlink
@@ -760,52 +900,187 @@ Brg_StatusT Brg::WriteSPI(const uint8_t *pBuffer, uint16_t SizeInBytes, uint16_t
 		return BRG_NO_ERR;
 	}
 
-	pRq = new STLink_DeviceRequestT;
+	span.pData = pBuffer;
+	span.SizeInBytes = SizeInBytes;
+	return WriteSPIcmd(&span, SizeInBytes, pSizeWritten);
+}
+/**
+ * @ingroup SPI
+ * @brief Same as Brg::WriteSPI(const uint8_t *pBuffer, uint16_t SizeInBytes, uint16_t *pSizeWritten)
+ * with data gathered from several buffers (e.g. header and payload) without copy to a contiguous
+ * buffer by the caller: the spans are sent in order in one SPI write.
+ * @param[in]  pSpans Data spans to be sent, see #Brg_SpanT.
+ * @param[in]  SpanNb Number of spans in pSpans.
+ * @param[out] pSizeWritten See Brg::WriteSPI() above
+ *
+ * @retval #BRG_NO_STLINK If Brg::OpenStlink() not called before
+ * @retval #BRG_PARAM_ERR If a span is invalid or total size is more than 0xFFFF bytes
+ * @retval #BRG_COM_INIT_NOT_DONE If SPI is not initialized
+ * @retval #BRG_SPI_ERR In case of SPI write error
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT Brg::WriteSPI(const Brg_SpanT *pSpans, uint8_t SpanNb, uint16_t *pSizeWritten)
+{
+	Brg_StatusT brgStat;
+	uint16_t sizeInBytes;
+
+	if( m_bStlinkConnected == false ) {
+		// The function should be called at least after OpenStlink
+		return BRG_NO_STLINK;
+	}
+	brgStat = GetSpansSize(pSpans, SpanNb, &sizeInBytes);
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+	if( sizeInBytes==0 ) {
+		return BRG_NO_ERR;
+	}
+
+	return WriteSPIcmd(pSpans, sizeInBytes, pSizeWritten);
+}
+/*
+ * See Brg::WriteSPI header, Size is the total size of the checked spans (min 1)
+ */
+Brg_StatusT Brg::WriteSPIcmd(const Brg_SpanT *pSpans, uint16_t Size, uint16_t *pSizeWritten)
+{
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
+	Brg_StatusT brgStat;
+
+	// Command and its status must not be interleaved with other commands
+	// (locked before GatherWriteData() that may use m_pGatherBuf)
+	CSLocker locker(m_csDevice);
+
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
 	pRq->CDBByte[0] = STLINK_BRIDGE_COMMAND;
 	pRq->CDBByte[1] = STLINK_BRIDGE_WRITE_SPI;
-	pRq->CDBByte[2] = (uint8_t)SizeInBytes;
-	pRq->CDBByte[3] = (uint8_t)(SizeInBytes>>8);
-	if( SizeInBytes > 8 ) {	
-		// First bytes to transfer to target
-		for( int i = 0; i<8; i++ ) {
-			pRq->CDBByte[4+i] = pBuffer[i];
-		}
-		pRq->BufferLength = SizeInBytes - 8;
-		pRq->InputRequest = REQUEST_WRITE_1ST_EPOUT;
-		pRq->Buffer = (void *)&pBuffer[8];
-	} else {
-		// First bytes to transfer to target
-		for( int i = 0; i<SizeInBytes; i++ ) {
-			pRq->CDBByte[4+i] = pBuffer[i];
-		}
-		// If less than 8 bytes all data are sent inside the cmd
-		// Just send the cmd (no data follows)
-		pRq->BufferLength = 0;
-		pRq->InputRequest = REQUEST_READ_1ST_EPIN;
-		pRq->Buffer = NULL;
+	pRq->CDBByte[2] = (uint8_t)Size;
+	pRq->CDBByte[3] = (uint8_t)(Size>>8);
+	// First 8 bytes to transfer to target inside the cmd, the others in data stage
+	brgStat = GatherWriteData(pRq, pSpans, Size, 4, 8);
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
 	}
 
 	pRq->SenseLength=DEFAULT_SENSE_LEN;
 
+	RwStatusBeforeCmd(COM_SPI);
 	brgStat = SendRequestAndAnalyzeStatus(pRq, NULL);
 
-	delete pRq;
-
 	if( brgStat == BRG_NO_ERR )
 	{	// pErrorInfo currently unused
-		brgStat = GetLastReadWriteStatus(pSizeWritten,NULL);
+		brgStat = RwStatusAfterCmd(COM_SPI, Size, pSizeWritten, NULL);
 	}
 
 	if( brgStat != BRG_NO_ERR ) {
-		LogTrace("SPI Error (%d) in WriteSPI (%d bytes)", (int)brgStat,(int)SizeInBytes);
+		LogTrace("SPI Error (%d) in WriteSPI (%d bytes)", (int)brgStat,(int)Size);
 		if( pSizeWritten != NULL ) {
 			LogTrace("SPI Only %d bytes written without error",(int)*pSizeWritten);
 		}
 	}
 	return brgStat;
 }
+/**
+ * @ingroup SPI
+ * @brief This routine receives SizeInBytes bytes on the SPI interface, without the 16bit size limit
+ * of Brg::ReadSPI(): the transfer is split in #BRG_SPI_STREAM_CHUNK_SIZE chunks sent without
+ * interleaving with other threads commands. See BrgAsync::ReadSPIStream() to process the data
+ * while the next chunk is transferred.
+ * @param[out] pBuffer Pointer on data buffer filled with read data.
+ * @param[in]  SizeInBytes Data size to be read in bytes (max data buffer size)
+ * @param[out] pSizeRead If not NULL, number of bytes received without error.
+ *
+ * @retval #BRG_NO_STLINK If Brg::OpenStlink() not called before
+ * @retval #BRG_COM_INIT_NOT_DONE If SPI is not initialized
+ * @retval #BRG_SPI_ERR In case of SPI read error
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT Brg::ReadSPIStream(uint8_t *pBuffer, uint64_t SizeInBytes, uint64_t *pSizeRead)
+{
+	Brg_StatusT brgStat = BRG_NO_ERR;
+	uint64_t offset = 0;
+	uint16_t chunkSize, chunkDone;
+
+	if( pSizeRead != NULL ) {
+		*pSizeRead = 0;
+	}
+	if( m_bStlinkConnected == false ) {
+		// The function should be called at least after OpenStlink
+		return BRG_NO_STLINK;
+	}
+	if( pBuffer == NULL ) {
+		return BRG_PARAM_ERR;
+	}
+
+	// Stream must not be interleaved with other commands
+	CSLocker locker(m_csDevice);
+
+	while( (offset < SizeInBytes) && (brgStat == BRG_NO_ERR) ) {
+		if( (SizeInBytes - offset) > BRG_SPI_STREAM_CHUNK_SIZE ) {
+			chunkSize = BRG_SPI_STREAM_CHUNK_SIZE;
+		} else {
+			chunkSize = (uint16_t)(SizeInBytes - offset);
+		}
+		chunkDone = chunkSize; // only updated by ReadSPI() in case of error
+		brgStat = ReadSPI(&pBuffer[offset], chunkSize, &chunkDone);
+		offset += (brgStat == BRG_NO_ERR) ? chunkSize : chunkDone;
+	}
+	if( pSizeRead != NULL ) {
+		*pSizeRead = offset;
+	}
+	return brgStat;
+}
+/**
+ * @ingroup SPI
+ * @brief This routine transmits SizeInBytes bytes on the SPI interface, without the 16bit size limit
+ * of Brg::WriteSPI(): the transfer is split in #BRG_SPI_STREAM_CHUNK_SIZE chunks sent without
+ * interleaving with other threads commands. See BrgAsync::WriteSPIStream() to prepare the data
+ * while the previous chunk is transferred.
+ * @param[in]  pBuffer Pointer on data buffer with data to be sent.
+ * @param[in]  SizeInBytes Data size to be sent in bytes (max data buffer size)
+ * @param[out] pSizeWritten If not NULL, number of bytes transmitted without error.
+ *
+ * @retval #BRG_NO_STLINK If Brg::OpenStlink() not called before
+ * @retval #BRG_COM_INIT_NOT_DONE If SPI is not initialized
+ * @retval #BRG_SPI_ERR In case of SPI write error
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT Brg::WriteSPIStream(const uint8_t *pBuffer, uint64_t SizeInBytes, uint64_t *pSizeWritten)
+{
+	Brg_StatusT brgStat = BRG_NO_ERR;
+	uint64_t offset = 0;
+	uint16_t chunkSize, chunkDone;
+
+	if( pSizeWritten != NULL ) {
+		*pSizeWritten = 0;
+	}
+	if( m_bStlinkConnected == false ) {
+		// The function should be called at least after OpenStlink
+		return BRG_NO_STLINK;
+	}
+	if( pBuffer == NULL ) {
+		return BRG_PARAM_ERR;
+	}
+
+	// Stream must not be interleaved with other commands
+	CSLocker locker(m_csDevice);
+
+	while( (offset < SizeInBytes) && (brgStat == BRG_NO_ERR) ) {
+		if( (SizeInBytes - offset) > BRG_SPI_STREAM_CHUNK_SIZE ) {
+			chunkSize = BRG_SPI_STREAM_CHUNK_SIZE;
+		} else {
+			chunkSize = (uint16_t)(SizeInBytes - offset);
+		}
+		chunkDone = chunkSize; // only updated by WriteSPI() in case of error
+		brgStat = WriteSPI(&pBuffer[offset], chunkSize, &chunkDone);
+		offset += (brgStat == BRG_NO_ERR) ? chunkSize : chunkDone;
+	}
+	if( pSizeWritten != NULL ) {
+		*pSizeWritten = offset;
+	}
+	return brgStat;
+}
 /**
  * @ingroup I2C
  * @brief This routine initializes the I2C according to init parameters.\n
@@ -819,9 +1094,10 @@ Brg_StatusT Brg::WriteSPI(const uint8_t *pBuffer, uint16_t SizeInBytes, uint16_t
  */
 Brg_StatusT Brg::InitI2C(const Brg_I2cInitT *pInitParams)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
-	uint16_t status;
+	uint16_t status = 0;
 
 	if( m_bStlinkConnected == false ) {
 		// The function should be called at least after OpenStlink
@@ -830,7 +1106,6 @@ Brg_StatusT Brg::InitI2C(const Brg_I2cInitT *pInitParams)
 	if( pInitParams == NULL ) {
 		return BRG_PARAM_ERR;
 	}
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
@@ -846,7 +1121,6 @@ Brg_StatusT Brg::InitI2C(const Brg_I2cInitT *pInitParams)
 		pRq->CDBByte[6] = (uint8_t) (pInitParams->OwnAddr);
 		pRq->CDBByte[7] = (uint8_t) (pInitParams->OwnAddr>>8);
 	} else {
-		delete pRq;
 		return BRG_PARAM_ERR;
 	}
 	// AddressingMode
@@ -860,7 +1134,6 @@ Brg_StatusT Brg::InitI2C(const Brg_I2cInitT *pInitParams)
 		if( pInitParams->Dnf <= 15 ) {
 			pRq->CDBByte[9] = ((uint8_t)pInitParams->Dnf & 0x0F) | ((((uint8_t)pInitParams->AnFilterEn) << 7) & 0x80);
 		} else {
-			delete pRq;
 			return BRG_PARAM_ERR;
 		}		
 	}
@@ -873,7 +1146,6 @@ Brg_StatusT Brg::InitI2C(const Brg_I2cInitT *pInitParams)
 	pRq->SenseLength=DEFAULT_SENSE_LEN;
 
 	brgStat = SendRequestAndAnalyzeStatus(pRq, &status);
-	delete pRq;
 
 	return brgStat;
 }
@@ -888,6 +1160,8 @@ Brg_StatusT Brg::InitI2C(const Brg_I2cInitT *pInitParams)
  * @param[in]  FallTime In ns, 0-300ns (STANDARD), 0-300ns (FAST), 0-120ns (FAST PLUS)
  * @param[in]  bAF  Use true for Analog Filter ON or false for Analog Filter OFF
  * @param[out] pTimingReg  Filled with timing parameter required by Brg::InitI2C().
+ * @note The last results are kept by the Brg: a call with the same parameters and I2C input clock
+ *       only reads the clock.
  *
  * @retval #BRG_NO_STLINK If Brg::OpenStlink() not called before
  * @retval #BRG_PARAM_ERR Null pointer parameter
@@ -899,6 +1173,7 @@ Brg_StatusT Brg::GetI2cTiming(I2cModeT I2CSpeedMode, int SpeedFrequency, int DNF
 	Brg_StatusT brgStatus=BRG_NO_ERR;
 	double clockSource;
 	uint32_t stlHClkKHz, i2cInputClkKHz;
+	Brg_I2cTimingCacheT *pCache;
 
 	if( pTimingReg == NULL ) {
 		return BRG_PARAM_ERR;
@@ -918,144 +1193,122 @@ Brg_StatusT Brg::GetI2cTiming(I2cModeT I2CSpeedMode, int SpeedFrequency, int DNF
 		return BRG_PARAM_ERR;
 	}
 
+	CSLocker locker(m_csDevice);
+
 	// Get the current I2C input Clk
 	brgStatus = GetClk(COM_I2C, &i2cInputClkKHz, &stlHClkKHz);
-	if( brgStatus == BRG_NO_ERR ) {
-		clockSource = (double)i2cInputClkKHz;
-		brgStatus = CalculateI2cTimingReg(I2CSpeedMode, SpeedFrequency, clockSource, DNFn,
-		                                  RiseTime, FallTime, bAF, pTimingReg);
+	if( brgStatus != BRG_NO_ERR ) {
+		return brgStatus;
+	}
+
+	// Same parameters as a previous call: same result
+	for( int i = 0; i < I2C_TIMING_CACHE_NB; i++ ) {
+		pCache = &m_i2cTimingCache[i];
+		if( (pCache->bValid == true) && (pCache->I2CSpeedMode == I2CSpeedMode) &&
+		    (pCache->SpeedFrequency == SpeedFrequency) && (pCache->I2cInputClkKHz == i2cInputClkKHz) &&
+		    (pCache->DNFn == DNFn) && (pCache->RiseTime == RiseTime) && (pCache->FallTime == FallTime) &&
+		    (pCache->bAF == bAF) ) {
+			*pTimingReg = pCache->TimingReg;
+			return pCache->Status;
+		}
 	}
 
+	clockSource = (double)i2cInputClkKHz;
+	brgStatus = CalculateI2cTimingReg(I2CSpeedMode, SpeedFrequency, clockSource, DNFn,
+	                                  RiseTime, FallTime, bAF, pTimingReg);
+
+	pCache = &m_i2cTimingCache[m_i2cTimingCacheNext];
+	m_i2cTimingCacheNext = (m_i2cTimingCacheNext + 1) % I2C_TIMING_CACHE_NB;
+	pCache->bValid = true;
+	pCache->I2CSpeedMode = I2CSpeedMode;
+	pCache->SpeedFrequency = SpeedFrequency;
+	pCache->I2cInputClkKHz = i2cInputClkKHz;
+	pCache->DNFn = DNFn;
+	pCache->RiseTime = RiseTime;
+	pCache->FallTime = FallTime;
+	pCache->bAF = bAF;
+	pCache->Status = brgStatus;
+	pCache->TimingReg = *pTimingReg;
+
 	return brgStatus;
 }
 /*
  * Internal function used by GetI2cTiming()
+ * Selects the same timing as an exhaustive search of PRESC x SCLL x SCLH (lowest frequency error,
+ * ties resolved as when scanning PRESC from the highest, then SCLL and SCLH from 0): for a PRESC
+ * the frequency only depends on SCLL+SCLH, so only the sums closest to the target frequency,
+ * above and below it, can hold the best candidate and are evaluated.
  */
 Brg_StatusT Brg::CalculateI2cTimingReg(I2cModeT I2CSpeedMode, int SpeedFrequency, double ClockSource, int DNFn,
                                        int RiseTime, int FallTime, bool bAF, uint32_t *pTimingReg)
 {
-#define MAX_I2C_MODEL_NB 40
 	Brg_StatusT brgStatus=BRG_NO_ERR;
+	Brg_I2cTimingCtxT ctx;
+	Brg_I2cTimingBestT best;
+
+	// Valid SCLDEL & SDADEL of each PRESC (-1 if PRESC is not valid)
+	int scldelOfPresc[PRESC_LENGTH];
+	int sdadelOfPresc[PRESC_LENGTH];
+
+	double tHdDatMax;       // Boundaries of the I2C mode
+	double tSuDatMin;
+	double tmpSCLDEL;       // Calculate SCLDEL Time from  SCLDEL Bit
+	double tmpSDADEL;       // Calculate SDLDEL Time from  SDLDEL Bit
+	double clkI2C;          // Clock frequency
+	double delayAF;
+	double delayDNF;
+	double tmpMinSDADEL;    // SDADEL range
+	double tmpMaxSDADEL;    // SDADEL range
+	double tmpMinSCLDEL;    // SCLDEL range
+	double sumTarget;       // SCLL+SCLH giving the target frequency
+	int sclMin, sclhMin, sumMin, sumMax, sumStart, sum, side;
 
 	if( (SpeedFrequency == 0) || (ClockSource == 0) || (pTimingReg == NULL) ) {
 		return BRG_PARAM_ERR;
 	}
 
-    // SCLL & SCLH  settings
-    int *pSCLL = new int[SCLL_LENGTH];
-    int *pSCLH = new int[SCLH_LENGTH];
-
-    //SCLDEL & SDLDEL settings
-    int *pSCLDEL = new int[SCLDEL_LENGTH];
-    int *pSDADEL = new int[SCLDEL_LENGTH];
-    // PRESC settings
-    int *pPRESC = new int[PRESC_LENGTH];
-    int *pPRESCvalid = new int[16];
-
-    // Variables for solution  (SCLDEL , SDLDEL  and PRESC)
-    Brg_I2cModelT *pPrescSDLDELSCLDELpossComb = new Brg_I2cModelT[MAX_I2C_MODEL_NB]; // possible combination table
-    int prescSDLDELSCLDELpossCombSize = 0;
-    int tabIndex = 0;
-
-    // Variables for Boundaries
-    double *pTFallMax = new double[MODE_NUMBER];
-    double *pTRiseMax = new double[MODE_NUMBER];
-    double *pTHdDatMax = new double[MODE_NUMBER];
-    double *pTSuDatMin = new double[MODE_NUMBER];
-    double *pTLowMin = new double[MODE_NUMBER];
-    double *pTHighMin = new double[MODE_NUMBER];
-
-    double targetFreqI2C;   // Target frequency
-    double targetPeriodI2C; // Target period of clock
-    double tmpSCLDEL;       // Calculate SCLDEL Time from  SCLDEL Bit
-    double tmpSDADEL;       // Calculate SDLDEL Time from  SDLDEL Bit
-    double clkMax;
-    double clkMin;
-    int idx=0;              // Get I2c mode speed
-    double clkI2C;          // Clock frequency
-    double clkPeriodI2C;    // Period of clock
-
-    double delayAF;
-    double delayDNF;
-    double delayFilter;
-    double riseTimeCalc;   // Rise time
-    double fallTimeCalc;   // Fall time
-    double tmpMinSDADEL;   // SDADEL range
-    double tmpMaxSDADEL;   // SDADEL range
-    double tmpMinSCLDEL;   // SCLDEL range
-    int nbValid;           // Number of valid solution
-    int tmpPRESC;          // Current prescaler
-
 	// Timing handling
-	int i;
-	for (i = 0; i < SCLL_LENGTH; i++) {
-		pSCLL[i] = i;//current SCLL value
-		pSCLH[i] = i;//cuirrent SCLH value
-	}
-	for (i = 0; i < SCLDEL_LENGTH; i++) {
-		pPRESC[i] = i;//current Presc value
-		pSCLDEL[i] = i;
-		pSDADEL[i] = i;
-		pPRESCvalid[i] = 99;
+	if( I2CSpeedMode == I2C_FAST_PLUS ) {
+		tHdDatMax = THDDAT_MAX_T2;
+		tSuDatMin = TSUDAT_MIN_T2;
+		ctx.tLowMin = TLOW_MIN2;
+		ctx.tHighMin = THIGH_MIN2;
+	} else if( I2CSpeedMode == I2C_FAST ) {
+		tHdDatMax = THDDAT_MAX_T1;
+		tSuDatMin = TSUDAT_MIN_T1;
+		ctx.tLowMin = TLOW_MIN1;
+		ctx.tHighMin = THIGH_MIN1;
+	} else {
+		tHdDatMax = THDDAT_MAX_T0;
+		tSuDatMin = TSUDAT_MIN_T0;
+		ctx.tLowMin = TLOW_MIN0;
+		ctx.tHighMin = THIGH_MIN0;
 	}
-	pTFallMax[0] = TFALL_MAX_T0;
-	pTFallMax[1] = TFALL_MAX_T1;
-	pTFallMax[2] = TFALL_MAX_T2;
 
-	pTRiseMax[0] = TRISE_MAX_T0;
-	pTRiseMax[1] = TRISE_MAX_T1;
-	pTRiseMax[2] = TRISE_MAX_T2;
+	ctx.targetFreqI2C = SpeedFrequency * 1000;   // Speed frequency
 
-	pTHdDatMax[0] = THDDAT_MAX_T0;
-	pTHdDatMax[1] = THDDAT_MAX_T1;
-	pTHdDatMax[2] = THDDAT_MAX_T2;
-
-	pTSuDatMin[0] = TSUDAT_MIN_T0;
-	pTSuDatMin[1] = TSUDAT_MIN_T1;
-	pTSuDatMin[2] = TSUDAT_MIN_T2;
-
-	pTLowMin[0] = TLOW_MIN0;
-	pTLowMin[1] = TLOW_MIN1;
-	pTLowMin[2] = TLOW_MIN2;
-
-	pTHighMin[0] = THIGH_MIN0;
-	pTHighMin[1] = THIGH_MIN1;
-	pTHighMin[2] = THIGH_MIN2;
-
-	targetFreqI2C = SpeedFrequency * 1000;   // Speed frequency
-	targetPeriodI2C = (1 / (targetFreqI2C)); // Speed period
-
-	clkMax = targetFreqI2C + targetFreqI2C * 0.2;
-	clkMin = targetFreqI2C - targetFreqI2C * 0.2;
+	ctx.clkMax = ctx.targetFreqI2C + ctx.targetFreqI2C * 0.2;
+	ctx.clkMin = ctx.targetFreqI2C - ctx.targetFreqI2C * 0.2;
 
 	clkI2C = ClockSource;
-	clkPeriodI2C = (double)(1 / (double)(clkI2C * 1000));  // Clock period
+	ctx.clkPeriodI2C = (double)(1 / (double)(clkI2C * 1000));  // Clock period
 
-	if( I2CSpeedMode == I2C_STANDARD ) {
-		idx = 0;
-	}
-	if( I2CSpeedMode == I2C_FAST ) {
-		idx = 1;
-	}
-	if( I2CSpeedMode == I2C_FAST_PLUS ) {
-		idx = 2;
-	}
 	if( bAF == true ) {
 		delayAF = (50 / (double)pow((double)10, 9)) * 1;
 	} else {
 		delayAF = 0; // (50 / (double)pow((double)10, 9)) * 0;
 	}
 
-	delayDNF = (DNFn * clkPeriodI2C);
-	delayFilter = delayAF + delayDNF;
+	delayDNF = (DNFn * ctx.clkPeriodI2C);
+	ctx.delayFilter = delayAF + delayDNF;
 
-	riseTimeCalc = (double)(RiseTime / (double)pow((double)10, 9));
-	fallTimeCalc = (double)(FallTime / (double)pow((double)10, 9));
+	ctx.riseTimeCalc = (double)(RiseTime / (double)pow((double)10, 9));
+	ctx.fallTimeCalc = (double)(FallTime / (double)pow((double)10, 9));
 
-	tmpMinSDADEL = (double)((double)fallTimeCalc - (50 / (double)pow((double)10, 9))
-	                - (double)((DNFn + 3) * clkPeriodI2C));
-	tmpMaxSDADEL = (double)((double)pTHdDatMax[idx] - riseTimeCalc - (1 * (260 / (double)pow((double)10, 9)))
-		            - (double)((DNFn + 4) * clkPeriodI2C));
+	tmpMinSDADEL = (double)((double)ctx.fallTimeCalc - (50 / (double)pow((double)10, 9))
+	                - (double)((DNFn + 3) * ctx.clkPeriodI2C));
+	tmpMaxSDADEL = (double)((double)tHdDatMax - ctx.riseTimeCalc - (1 * (260 / (double)pow((double)10, 9)))
+	                - (double)((DNFn + 4) * ctx.clkPeriodI2C));
 	if( tmpMaxSDADEL < 0 ) {
 		tmpMaxSDADEL = 0;
 	}
@@ -1063,150 +1316,88 @@ Brg_StatusT Brg::CalculateI2cTimingReg(I2cModeT I2CSpeedMode, int SpeedFrequency
 		tmpMinSDADEL = 0;
 	}
 
-	tmpMinSCLDEL = (double)((double)riseTimeCalc + pTSuDatMin[idx]);
+	tmpMinSCLDEL = (double)((double)ctx.riseTimeCalc + tSuDatMin);
 	if( tmpMinSCLDEL < 0 ) {
 		tmpMinSCLDEL = 0;
 	}
 
-	nbValid = 0;
-
-	tmpPRESC = 99;
+	ctx.tsync = (double)ctx.delayFilter + (2 * ctx.clkPeriodI2C);
 	// End of timing handling
 
-	// SDLDEL and SCLDEL calculation
-	for( int i1 = 0; i1 < PRESC_LENGTH; i1++ ) {
+	// SDLDEL and SCLDEL calculation: first valid combination of each PRESC
+	for( int presc = 0; presc < PRESC_LENGTH; presc++ ) {
+		scldelOfPresc[presc] = -1;
+		sdadelOfPresc[presc] = -1;
+		for( int i3 = 0; (i3 < SCLDEL_LENGTH) && (scldelOfPresc[presc] < 0); i3++ ) {
+			tmpSCLDEL = (double)((i3 + 1) * (double)((presc + 1) * ctx.clkPeriodI2C));
 
-		for( int i3 = 0; i3 < SCLDEL_LENGTH; i3++ ) {
-			tmpSCLDEL = (double)((pSCLDEL[i3] + 1) * (double)((pPRESC[i1] + 1) * clkPeriodI2C));
-
-			for( int i2 = 0; i2 < SCLDEL_LENGTH; i2++ ) {
-				tmpSDADEL = (double)(pSDADEL[i2] * (double)((pPRESC[i1] + 1) * clkPeriodI2C));
+			for( int i2 = 0; (i2 < SCLDEL_LENGTH) && (scldelOfPresc[presc] < 0); i2++ ) {
+				tmpSDADEL = (double)(i2 * (double)((presc + 1) * ctx.clkPeriodI2C));
 				if( (tmpSDADEL >= tmpMinSDADEL) && (tmpSDADEL <= tmpMaxSDADEL) && (tmpSCLDEL >= tmpMinSCLDEL) ) {
-					if( pPRESC[i1] != tmpPRESC ) {
-						pPRESCvalid[nbValid] = pPRESC[i1];
-						tmpPRESC = pPRESCvalid[nbValid];
-						nbValid = nbValid + 1;
-						if( tabIndex < MAX_I2C_MODEL_NB ) {
-							pPrescSDLDELSCLDELpossComb[tabIndex].prescaler = i1;
-							pPrescSDLDELSCLDELpossComb[tabIndex].SDLDEL=i2;
-							pPrescSDLDELSCLDELpossComb[tabIndex].SCLDEL=i3;
-							pPrescSDLDELSCLDELpossComb[tabIndex].resultat=1;
-							prescSDLDELSCLDELpossCombSize++;
-						}
-						// else MAX_I2C_MODEL_NB should be incremented or use dynamic memory
-						tabIndex++;
-					}
+					scldelOfPresc[presc] = i3;
+					sdadelOfPresc[presc] = i2;
 				}
 			}
 		}
 	}
 
 	// SCLL SCLH calculation
-	int l = 0;
-	double solution = 0;
-	double prescR = 99;
-	int sdadel = 0;
-	int scldel = 0;
-	int i1Sel = 0;
-	int i2Sel = 0;
-	int i3Sel = 0;
-	double errorTarget = 0.2;
-	double tsync = (double)delayFilter + (2 * clkPeriodI2C);
-	Brg_I2cModelT s;
-
-	if( nbValid != 0 ) {
-		for( int i3 = nbValid - 1; i3 >= 0; i3-- ) {
-			for( int i1 = 0; i1 < SCLL_LENGTH; i1++ ) {
-				for( int i2 = 0; i2 < SCLH_LENGTH; i2++ ) {
-					double presc = (double)(pPRESCvalid[i3] + 1) * (double)clkPeriodI2C;
-					double tSclLow = (double)(pSCLL[i1] + 1) * (double)presc;
-					double tSclHigh = (double)(pSCLH[i2] + 1) * (double)presc;
-
-					tSclLow = (double)tSclLow + (double)tsync;
-					tSclHigh = (double)tSclHigh + (double)tsync;
-					double tScl = (double)tSclLow + (double)tSclHigh + (double)riseTimeCalc + (double)fallTimeCalc;
-					double speed = 1 / (double)tScl;
-
-					if( (speed >= clkMin) && (speed <= clkMax) && (tSclLow >= pTLowMin[idx]) &&
-					    (tSclHigh >= pTHighMin[idx]) && (clkPeriodI2C < ((tSclLow - delayFilter) / 4)) &&
-					    (clkPeriodI2C < tSclHigh) ) {
-						double errorTmp = (double)(speed - targetFreqI2C) / (double)(targetFreqI2C);
-						if( errorTmp < 0 ) {
-							double x = (double)(0 - (double)errorTmp);
-							s.prescaler = i1;
-							s.SDLDEL=i2;
-							s.SCLDEL=i3;
-							s.resultat=x;
-						} else {
-							s.prescaler = i1;
-							s.SDLDEL=i2;
-							s.SCLDEL=i3;
-							s.resultat=errorTmp;
-						}
-					} else {
-						s.prescaler = i1;
-						s.SDLDEL=i2;
-						s.SCLDEL=i3;
-						s.resultat=1;
-					}
+	best.error = 0.2; // Max frequency error
+	best.presc = -1;
+	best.scll = 0;
+	best.sclh = 0;
+	for( int presc = PRESC_LENGTH - 1; presc >= 0; presc-- ) {
+		if( scldelOfPresc[presc] < 0 ) {
+			continue;
+		}
+		sclMin = I2cTimingMinScl(&ctx, presc, false);
+		sclhMin = I2cTimingMinScl(&ctx, presc, true);
+		if( (sclMin >= SCLL_LENGTH) || (sclhMin >= SCLH_LENGTH) ) {
+			continue;
+		}
+		sumMin = sclMin + sclhMin;
+		sumMax = (SCLL_LENGTH - 1) + (SCLH_LENGTH - 1);
+
+		// tScl = (SCLL+1 + SCLH+1) * tPresc + 2 * tsync + tRise + tFall
+		sumTarget = ((1 / ctx.targetFreqI2C) - (2 * ctx.tsync) - ctx.riseTimeCalc - ctx.fallTimeCalc)
+		            / ((presc + 1) * ctx.clkPeriodI2C) - 2;
+		if( sumTarget <= sumMin ) {
+			sumStart = sumMin;
+		} else if( sumTarget >= sumMax ) {
+			sumStart = sumMax;
+		} else {
+			sumStart = (int)floor(sumTarget + 0.5);
+		}
 
-					if( (s.resultat <= errorTarget) && (pPRESCvalid[i3] <= prescR) ) {
-						prescR = pPRESCvalid[i3];
-						solution = 1;
-						errorTarget = (double)s.resultat;
-						i1Sel = i1;
-						i2Sel = i2;
-						i3Sel = i3;
-					}
-				}
+		// Closest sums with a valid candidate faster (lower sum) and slower than the target
+		for( sum = sumStart; sum >= sumMin; sum-- ) {
+			side = I2cTimingScanSum(&ctx, presc, sum, sclMin, sclhMin, &best);
+			if( (side == 0) || ((side & I2C_TIMING_FASTER) != 0) ) {
+				break;
 			}
 		}
-		int x = 0;
-		for( int i2 = 0; i2 < 16; i2++ ) {
-			for( int i3 = 0; i3 < 16; i3++ ) {
-				for( int j = 0; j < prescSDLDELSCLDELpossCombSize; j++ ) {
-					if( (pPrescSDLDELSCLDELpossComb[j].resultat == 1) &&
-					    (pPrescSDLDELSCLDELpossComb[j].prescaler == pPRESCvalid[i3Sel]) &&
-					    (pPrescSDLDELSCLDELpossComb[j].SDLDEL == i2) &&
-					    (pPrescSDLDELSCLDELpossComb[j].SCLDEL == i3) &&
-					    (x == 0) ) {
-						l = pPRESCvalid[i3Sel];
-						sdadel = i2;
-						scldel = i3;
-						x++;
-					}
-				}
+		for( sum = sumStart + 1; sum <= sumMax; sum++ ) {
+			side = I2cTimingScanSum(&ctx, presc, sum, sclMin, sclhMin, &best);
+			if( (side == 0) || ((side & I2C_TIMING_SLOWER) != 0) ) {
+				break;
 			}
 		}
 	}
+
 	// Get results
 	*pTimingReg=0;
-	if( solution==1 ) {
-		*pTimingReg = (uint32_t) ((uint32_t)pPRESCvalid[i3Sel]<<28 | // Bits 31:28 PRESC[3:0]: Timing prescaler
-					(uint32_t)scldel<<20 | // Bits 27:24 Reserved, must be kept at reset value.
+	if( best.presc >= 0 ) {
+		*pTimingReg = (uint32_t) ((uint32_t)best.presc<<28 | // Bits 31:28 PRESC[3:0]: Timing prescaler
+					(uint32_t)scldelOfPresc[best.presc]<<20 | // Bits 27:24 Reserved, must be kept at reset value.
 		                                   // Bits 23:20 SCLDEL[3:0]: Data setup time
-					(uint32_t)sdadel<<16 | // Bits 19:16 SDADEL[3:0]: Data hold time
-					(uint32_t)i2Sel<<8 | // Bits 15:8 SCLH[7:0]: SCL high period (master mode)
-					(uint32_t)i1Sel); // Bits 7:0 SCLL[7:0]: SCL low period (master mode)
+					(uint32_t)sdadelOfPresc[best.presc]<<16 | // Bits 19:16 SDADEL[3:0]: Data hold time
+					(uint32_t)best.sclh<<8 | // Bits 15:8 SCLH[7:0]: SCL high period (master mode)
+					(uint32_t)best.scll); // Bits 7:0 SCLL[7:0]: SCL low period (master mode)
 		brgStatus = BRG_NO_ERR;
 	} else {
 		brgStatus = BRG_PARAM_ERR;
 	}
 
-    delete [] pSCLL;
-    delete [] pSCLH;
-	delete [] pSCLDEL;
-    delete [] pSDADEL;
-    delete [] pPRESC;
-    delete [] pPRESCvalid;
-	delete [] pPrescSDLDELSCLDELpossComb;
-    delete [] pTFallMax;
-    delete [] pTRiseMax;
-    delete [] pTHdDatMax;
-    delete [] pTSuDatMin;
-    delete [] pTLowMin;
-    delete [] pTHighMin;
-
 	return brgStatus;
 }
 /**
@@ -1259,7 +1450,6 @@ Brg_StatusT Brg::ReadI2Ccmd(uint8_t *pBuffer, uint16_t Addr,
                             uint16_t SizeInBytes, Brg_I2cRWTransfer RwTransType,
                             uint16_t *pSizeRead, uint32_t *pErrorInfo)
 {
-	STLink_DeviceRequestT *pRq;
 	Brg_StatusT brgStat;
 
 	if( m_bStlinkConnected == false ) {
@@ -1270,31 +1460,15 @@ Brg_StatusT Brg::ReadI2Ccmd(uint8_t *pBuffer, uint16_t Addr,
 		return BRG_PARAM_ERR;
 	}
 
-	pRq = new STLink_DeviceRequestT;
-	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
-
-	pRq->CDBByte[0] = STLINK_BRIDGE_COMMAND;
-	pRq->CDBByte[1] = STLINK_BRIDGE_READ_I2C;
-	pRq->CDBByte[2] = (uint8_t)SizeInBytes;
-	pRq->CDBByte[3] = (uint8_t)(SizeInBytes>>8);
-	pRq->CDBByte[4] = (uint8_t)Addr;
-	pRq->CDBByte[5] = (uint8_t)(Addr>>8);
-	pRq->CDBByte[6] = (uint8_t)RwTransType;
-
-	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
-	pRq->BufferLength = SizeInBytes;
-	pRq->InputRequest = REQUEST_READ_1ST_EPIN;
-	pRq->Buffer = pBuffer;
-
-	pRq->SenseLength=DEFAULT_SENSE_LEN;
-
-	brgStat = SendRequestAndAnalyzeStatus(pRq, NULL, DEFAULT_TIMEOUT);
+	// Command and its status must not be interleaved with other commands
+	CSLocker locker(m_csDevice);
 
-	delete pRq;
+	RwStatusBeforeCmd(COM_I2C);
+	brgStat = SendReadI2Ccmd(pBuffer, Addr, SizeInBytes, RwTransType);
 
 	if( brgStat == BRG_NO_ERR )
 	{
-		brgStat = GetLastReadWriteStatus(pSizeRead, pErrorInfo);
+		brgStat = RwStatusAfterCmd(COM_I2C, SizeInBytes, pSizeRead, pErrorInfo);
 	}
 
 	if( brgStat != BRG_NO_ERR ) {
@@ -1315,6 +1489,34 @@ Brg_StatusT Brg::ReadI2Ccmd(uint8_t *pBuffer, uint16_t Addr,
 
 	return brgStat;
 }
+/*
+ * private: send the I2C read command (m_csDevice locked), without reading the Read/Write status
+ */
+Brg_StatusT Brg::SendReadI2Ccmd(uint8_t *pBuffer, uint16_t Addr, uint16_t SizeInBytes,
+                                Brg_I2cRWTransfer RwTransType)
+{
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
+
+	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
+
+	pRq->CDBByte[0] = STLINK_BRIDGE_COMMAND;
+	pRq->CDBByte[1] = STLINK_BRIDGE_READ_I2C;
+	pRq->CDBByte[2] = (uint8_t)SizeInBytes;
+	pRq->CDBByte[3] = (uint8_t)(SizeInBytes>>8);
+	pRq->CDBByte[4] = (uint8_t)Addr;
+	pRq->CDBByte[5] = (uint8_t)(Addr>>8);
+	pRq->CDBByte[6] = (uint8_t)RwTransType;
+
+	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
+	pRq->BufferLength = SizeInBytes;
+	pRq->InputRequest = REQUEST_READ_1ST_EPIN;
+	pRq->Buffer = pBuffer;
+
+	pRq->SenseLength=DEFAULT_SENSE_LEN;
+
+	return SendRequestAndAnalyzeStatus(pRq, NULL, DEFAULT_TIMEOUT);
+}
 /**
  * @ingroup I2C
  * @brief This low level routine allows to split I2C transaction and to receive bytes on the I2C interface,
@@ -1412,67 +1614,173 @@ Brg_StatusT Brg::StopReadI2C(uint8_t *pBuffer, uint16_t SizeInBytes, uint16_t *p
 }
 /**
  * @ingroup I2C
- * @brief This routine allows to receive bytes on the I2C interface without blocking the
- *        USB for I2C transaction completion.\n
- * Main use case if for I2C transaction requiring timeout higher than 200ms to complete.
- * Difference with Brg::ReadI2C() are:
- * - Command answer is a status not the data.
- * - I2C transaction at target side is not completed when receiving the status answer.
- * - BUSY is returned in the status while I2C transaction at target side is not completed,
- * in BUSY state only Brg:GetLastReadWriteStatus() command can be sent to the firmware.
- * - Once status is no more BUSY, data can be retrieved using Brg:GetReadDataI2C().
- * - Data size limited to 512 bytes.
- * @warning If other commands than STLINK_BRIDGE_GET_RWCMD_STATUS are sent to the STLink firmware
- *  while it is in BUSY state this can break the USB communication.
- *
- * @param[in]  Addr  I2C slave address used in master mode (default 7bit): 
+ * @brief This routine performs a combined I2C transaction in master mode: START, Addr (write), pTxBuffer data,
+ * repeated START, Addr (read), data received in pRxBuffer, STOP. That is the usual register read:
+ * register address written then registers read without STOP in between.\n
+ * Same bus transaction as Brg::StartWriteI2C() followed by Brg::StopReadI2C() (the firmware being
+ * expected to send the repeated START on the direction change, see warning) but the status is only read
+ * once, after the read: 3 USB round trips instead of 4, and the partial transaction state of
+ * Brg::StartWriteI2C() is not used.
+ * @param[in]  Addr  I2C slave address used in master mode (default 7bit):
  *             use #I2C_10B_ADDR(Addr) if it is a 10bit address.
- * @param[in]  SizeInBytes Data size to be read in bytes: min 1, max 512 bytes.
+ * @param[in]  pTxBuffer Data to write (e.g. register address).
+ * @param[in]  TxSizeInBytes Data size to write in bytes (min 1).
+ * @param[out] pRxBuffer Data read.
+ * @param[in]  RxSizeInBytes Data size to read in bytes (min 1, max data buffer size).
  * @param[out] pSizeRead If not NULL and in case of error, pSizeRead returns the number of bytes
- *             received before the error.
- * @param[in]  CmdTimeoutMs 0: #DEFAULT_CMD_TIMEOUT (~200ms), val>0: timeout to wait for
- *             the command completion, value in ms (must be a multiple of 200ms, up to 50s).
- *             While command is not completed or CmdTimeoutMs not elapsed STLink firmware is BUSY.
+ *             received before the error (0 if the write stage failed).
  *
- * @retval #BRG_CMD_BUSY If I2C transaction is not completed, use Brg:GetLastReadWriteStatus() until no more BUSY
  * @retval #BRG_NO_STLINK If Brg::OpenStlink() not called before
+ * @retval #BRG_PARAM_ERR If a buffer is NULL or a size is 0
  * @retval #BRG_COM_INIT_NOT_DONE If I2C is not initialized
- * @retval #BRG_I2C_ERR In case of I2C error
+ * @retval #BRG_I2C_ERR In case of I2C error (write or read stage)
  * @retval #BRG_NO_ERR If no error
+ * @note In #RW_STATUS_DEFERRED mode, a failing write stage is reported by Brg::SyncRwStatus()
+ *       as #BRG_COM_CMD_ORDER_ERR (read stage aborted by the firmware).
+ * @warning Not verified on STLINK-V3 hardware: the firmware interface only documents partial
+ *          transactions in one direction (Start, Cont, Stop of the same direction). The repeated
+ *          START on the direction change and the read stage aborted after a failing write stage are
+ *          assumed, and only checked against the BrgSimTransport model of them.
  */
-Brg_StatusT Brg::ReadNoWaitI2C(uint16_t Addr, uint16_t SizeInBytes, uint16_t *pSizeRead, uint16_t CmdTimeoutMs)
+Brg_StatusT Brg::WriteReadI2C(uint16_t Addr, const uint8_t *pTxBuffer, uint16_t TxSizeInBytes,
+                              uint8_t *pRxBuffer, uint16_t RxSizeInBytes, uint16_t *pSizeRead)
 {
-	STLink_DeviceRequestT *pRq;
 	Brg_StatusT brgStat;
-	uint8_t targetCmdTimeout = 0; // Default timeout
-	uint16_t answer[BRIDGE_RW_STATUS_LEN_WORD]={0,0,0,0};
+	Brg_SpanT span;
+	uint16_t sizeRead = 0;
 
 	if( m_bStlinkConnected == false ) {
 		// The function should be called at least after OpenStlink
 		return BRG_NO_STLINK;
 	}
-	if( IsReadNoWaitI2CSupport() == false ) {
-		// Command supported starting firmware version B3
-		return BRG_CMD_NOT_SUPPORTED;
-	}
-	if( (SizeInBytes > 512) || (SizeInBytes==0) ) {
+	if( (pTxBuffer == NULL) || (TxSizeInBytes == 0) || (pRxBuffer == NULL) || (RxSizeInBytes == 0) ) {
 		return BRG_PARAM_ERR;
 	}
+	span.pData = pTxBuffer;
+	span.SizeInBytes = TxSizeInBytes;
 
-	// Timeout param: timeout for BUSY state at target side
-	if( CmdTimeoutMs != DEFAULT_CMD_TIMEOUT ) {
-		if(CmdTimeoutMs > 50000) { // trunk to 50s (max uint8_t 0xFF = 256)
-			targetCmdTimeout = 250; // 50s (250*200ms)
-		} else {
-			targetCmdTimeout = (uint8_t)((CmdTimeoutMs + 199)/200); // CmdTimeoutMs = targetCmdTimeout*200ms
-			                                                        // (rounded to 200ms superior)
+	// Both commands and the status must not be interleaved with other commands
+	CSLocker locker(m_csDevice);
+
+	// Write stage status not read: if it fails the firmware aborts the transaction,
+	// then the read stage fails with STLINK_BRIDGE_ABORT_TRANS
+	RwStatusBeforeCmd(COM_I2C);
+	brgStat = SendWriteI2Ccmd(&span, TxSizeInBytes, Addr, I2C_START_RW_TRANS);
+	if( brgStat == BRG_NO_ERR ) {
+		brgStat = SendReadI2Ccmd(pRxBuffer, Addr, RxSizeInBytes, I2C_STOP_RW_TRANS);
+	}
+	if( brgStat == BRG_NO_ERR ) {
+		brgStat = RwStatusAfterCmd(COM_I2C, RxSizeInBytes, &sizeRead, NULL);
+		if( brgStat == BRG_COM_CMD_ORDER_ERR ) {
+			// Read stage aborted: error in the write stage
+			brgStat = BRG_I2C_ERR;
+			sizeRead = 0;
+		}
+		if( (brgStat != BRG_NO_ERR) && (pSizeRead != NULL) ) {
+			*pSizeRead = sizeRead;
+		}
+	}
+
+	if( brgStat != BRG_NO_ERR ) {
+		LogTrace("I2C Error (%d) in WriteReadI2C (%d/%d bytes)", (int)brgStat, (int)TxSizeInBytes,
+		         (int)RxSizeInBytes);
+	}
+#ifdef USING_TRACELOG
+	else {
+		LogTrace("I2C W %d bytes R %d bytes", (int)TxSizeInBytes, (int)RxSizeInBytes);
+	}
+#endif
+	return brgStat;
+}
+/**
+ * @ingroup I2C
+ * @brief Same as Brg::WriteReadI2C(uint16_t Addr, const uint8_t *pTxBuffer, uint16_t TxSizeInBytes,
+ *        uint8_t *pRxBuffer, uint16_t RxSizeInBytes, uint16_t *pSizeRead) except for Addr parameter
+ * @param[in]  Addr Is the I2C slave address used in master mode.
+ * @param[in]  AddrMode Indicate if it is a 10bit or 7bit address.
+ * @param[in]  pTxBuffer     See Brg::WriteReadI2C() above
+ * @param[in]  TxSizeInBytes See Brg::WriteReadI2C() above
+ * @param[out] pRxBuffer     See Brg::WriteReadI2C() above
+ * @param[in]  RxSizeInBytes See Brg::WriteReadI2C() above
+ * @param[out] pSizeRead     See Brg::WriteReadI2C() above
+ */
+Brg_StatusT Brg::WriteReadI2C(uint16_t Addr, Brg_I2cAddrModeT AddrMode, const uint8_t *pTxBuffer,
+                              uint16_t TxSizeInBytes, uint8_t *pRxBuffer, uint16_t RxSizeInBytes,
+                              uint16_t *pSizeRead)
+{
+	 uint16_t slaveAddr = Addr; // default bit15=0 7b
+	 if( AddrMode == I2C_ADDR_10BIT ) {
+		slaveAddr = I2C_10B_ADDR(Addr); // set bit15 to 1 for 10b
+	 }
+	 return WriteReadI2C(slaveAddr, pTxBuffer, TxSizeInBytes, pRxBuffer, RxSizeInBytes, pSizeRead);
+}
+/**
+ * @ingroup I2C
+ * @brief This routine allows to receive bytes on the I2C interface without blocking the
+ *        USB for I2C transaction completion.\n
+ * Main use case if for I2C transaction requiring timeout higher than 200ms to complete.
+ * Difference with Brg::ReadI2C() are:
+ * - Command answer is a status not the data.
+ * - I2C transaction at target side is not completed when receiving the status answer.
+ * - BUSY is returned in the status while I2C transaction at target side is not completed,
+ * in BUSY state only Brg:GetLastReadWriteStatus() command can be sent to the firmware.
+ * - Once status is no more BUSY, data can be retrieved using Brg:GetReadDataI2C().
+ * - Data size limited to 512 bytes.
+ * @warning If other commands than STLINK_BRIDGE_GET_RWCMD_STATUS are sent to the STLink firmware
+ *  while it is in BUSY state this can break the USB communication.
+ *
+ * @param[in]  Addr  I2C slave address used in master mode (default 7bit): 
+ *             use #I2C_10B_ADDR(Addr) if it is a 10bit address.
+ * @param[in]  SizeInBytes Data size to be read in bytes: min 1, max 512 bytes.
+ * @param[out] pSizeRead If not NULL and in case of error, pSizeRead returns the number of bytes
+ *             received before the error.
+ * @param[in]  CmdTimeoutMs 0: #DEFAULT_CMD_TIMEOUT (~200ms), val>0: timeout to wait for
+ *             the command completion, value in ms (must be a multiple of 200ms, up to 50s).
+ *             While command is not completed or CmdTimeoutMs not elapsed STLink firmware is BUSY.
+ *
+ * @retval #BRG_CMD_BUSY If I2C transaction is not completed, use Brg:GetLastReadWriteStatus() until no more BUSY
+ * @retval #BRG_NO_STLINK If Brg::OpenStlink() not called before
+ * @retval #BRG_COM_INIT_NOT_DONE If I2C is not initialized
+ * @retval #BRG_I2C_ERR In case of I2C error
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT Brg::ReadNoWaitI2C(uint16_t Addr, uint16_t SizeInBytes, uint16_t *pSizeRead, uint16_t CmdTimeoutMs)
+{
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
+	Brg_StatusT brgStat;
+	uint8_t targetCmdTimeout = 0; // Default timeout
+	uint16_t answer[BRIDGE_RW_STATUS_LEN_WORD]={0,0,0,0};
+
+	if( m_bStlinkConnected == false ) {
+		// The function should be called at least after OpenStlink
+		return BRG_NO_STLINK;
+	}
+	if( IsReadNoWaitI2CSupport() == false ) {
+		// Command supported starting firmware version B3
+		return BRG_CMD_NOT_SUPPORTED;
+	}
+	if( (SizeInBytes > 512) || (SizeInBytes==0) ) {
+		return BRG_PARAM_ERR;
+	}
+
+	// Timeout param: timeout for BUSY state at target side
+	if( CmdTimeoutMs != DEFAULT_CMD_TIMEOUT ) {
+		if(CmdTimeoutMs > 50000) { // trunk to 50s (max uint8_t 0xFF = 256)
+			targetCmdTimeout = 250; // 50s (250*200ms)
+		} else {
+			targetCmdTimeout = (uint8_t)((CmdTimeoutMs + 199)/200); // CmdTimeoutMs = targetCmdTimeout*200ms
+			                                                        // (rounded to 200ms superior)
 		}
 	}
 	if( SizeInBytes==0 ) {
 		return BRG_NO_ERR;
 	}
 
-	pRq = new STLink_DeviceRequestT;
+	// Status of the deferred Read/Write commands window would be lost
+	CSLocker locker(m_csDevice);
+	ReadRwWindowStatus();
+
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBByte[0] = STLINK_BRIDGE_COMMAND;
@@ -1493,8 +1801,6 @@ Brg_StatusT Brg::ReadNoWaitI2C(uint16_t Addr, uint16_t SizeInBytes, uint16_t *pS
 
 	brgStat = SendRequestAndAnalyzeStatus(pRq, NULL, DEFAULT_TIMEOUT);
 
-	delete pRq;
-
 	if( brgStat == BRG_NO_ERR ) // answer is same format as GetLastReadWriteStatus()
 	{
 		brgStat = AnalyzeStatus(&answer[0]);
@@ -1557,7 +1863,8 @@ Brg_StatusT Brg::ReadNoWaitI2C(uint16_t Addr, Brg_I2cAddrModeT AddrMode,
 	 */
 Brg_StatusT Brg::GetReadDataI2C(uint8_t *pBuffer, uint16_t SizeInBytes)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
 
 	if( m_bStlinkConnected == false ) {
@@ -1580,7 +1887,6 @@ Brg_StatusT Brg::GetReadDataI2C(uint8_t *pBuffer, uint16_t SizeInBytes)
 
 	if( brgStat == BRG_NO_ERR )
 	{
-		pRq = new STLink_DeviceRequestT;
 		memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 		pRq->CDBByte[0] = STLINK_BRIDGE_COMMAND;
@@ -1597,8 +1903,6 @@ Brg_StatusT Brg::GetReadDataI2C(uint8_t *pBuffer, uint16_t SizeInBytes)
 
 		brgStat = SendRequestAndAnalyzeStatus(pRq, NULL, DEFAULT_TIMEOUT);
 
-		delete pRq;
-
 		if( brgStat != BRG_NO_ERR ) {
 			LogTrace("I2C Error (%d) in ReadI2C (%d bytes)", (int)brgStat,(int)SizeInBytes);
 		}
@@ -1656,6 +1960,41 @@ Brg_StatusT Brg::WriteI2C(const uint8_t *pBuffer, uint16_t Addr, Brg_I2cAddrMode
 	 }
 	 return WriteI2C(pBuffer, slaveAddr, SizeInBytes, pSizeWritten);
 }
+/**
+ * @ingroup I2C
+ * @brief Same as Brg::WriteI2C(uint8_t *pBuffer, uint16_t Addr, uint16_t Size, uint16_t *pSizeWritten)
+ * with data gathered from several buffers (e.g. register address and payload) without copy to a
+ * contiguous buffer by the caller: the spans are sent in order in one I2C transaction.
+ * @param[in]  pSpans Data spans to be sent, see #Brg_SpanT.
+ * @param[in]  SpanNb Number of spans in pSpans.
+ * @param[in]  Addr   See Brg::WriteI2C() above
+ * @param[out] pSizeWritten See Brg::WriteI2C() above
+ *
+ * @retval #BRG_NO_STLINK If Brg::OpenStlink() not called before
+ * @retval #BRG_PARAM_ERR If a span is invalid, total size is 0 or more than 0xFFFF bytes
+ * @retval #BRG_COM_INIT_NOT_DONE If I2C is not initialized
+ * @retval #BRG_I2C_ERR In case of I2C error
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT Brg::WriteI2C(const Brg_SpanT *pSpans, uint8_t SpanNb, uint16_t Addr, uint16_t *pSizeWritten)
+{
+	Brg_StatusT brgStat;
+	uint16_t sizeInBytes;
+
+	if( m_bStlinkConnected == false ) {
+		// The function should be called at least after OpenStlink
+		return BRG_NO_STLINK;
+	}
+	brgStat = GetSpansSize(pSpans, SpanNb, &sizeInBytes);
+	if( (brgStat == BRG_NO_ERR) && (sizeInBytes == 0) ) {
+		brgStat = BRG_PARAM_ERR;
+	}
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+
+	return WriteI2Ccmd(pSpans, sizeInBytes, Addr, I2C_FULL_RW_TRANS, pSizeWritten, NULL);
+}
 /*
  * See Brg::WriteI2C header
  * RwTransType gives the type of I2C transaction to perform
@@ -1665,8 +2004,7 @@ Brg_StatusT Brg::WriteI2Ccmd(const uint8_t *pBuffer, uint16_t Addr,
                              uint16_t Size, Brg_I2cRWTransfer RwTransType,
                              uint16_t *pSizeWritten, uint32_t *pErrorInfo)
 {
-	STLink_DeviceRequestT *pRq;
-	Brg_StatusT brgStat;
+	Brg_SpanT span;
 
 	if( m_bStlinkConnected == false ) {
 		// The function should be called at least after OpenStlink
@@ -1676,46 +2014,28 @@ Brg_StatusT Brg::WriteI2Ccmd(const uint8_t *pBuffer, uint16_t Addr,
 		return BRG_PARAM_ERR;
 	}
 
-	pRq = new STLink_DeviceRequestT;
-	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
-	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
-	pRq->CDBByte[0] = STLINK_BRIDGE_COMMAND;
-	pRq->CDBByte[1] = STLINK_BRIDGE_WRITE_I2C;
-	pRq->CDBByte[2] = (uint8_t)Size;
-	pRq->CDBByte[3] = (uint8_t)(Size>>8);
-	pRq->CDBByte[4] = (uint8_t)Addr;
-	pRq->CDBByte[5] = (uint8_t)(Addr>>8);
-	pRq->CDBByte[6] = (uint8_t)RwTransType;
-	// 	pRq->CDBByte[7] unused 0
-	if( Size > 4 ) {
-		// First bytes to transfer to target
-		for( int i = 0; i<4; i++ ) {
-			pRq->CDBByte[8+i] = pBuffer[i];
-		}
-		pRq->BufferLength = Size - 4;
-		pRq->InputRequest = REQUEST_WRITE_1ST_EPOUT;
-		pRq->Buffer = (void *)&pBuffer[4];
-	} else {
-		// First bytes to transfer to target
-		for( int i = 0; i<Size; i++ ) {
-			pRq->CDBByte[8+i] = pBuffer[i];
-		}
-		// If less than 4 bytes all data are sent inside the cmd
-		// Just send the cmd (no data follows)
-		pRq->BufferLength = 0;
-		pRq->InputRequest = REQUEST_READ_1ST_EPIN;
-		pRq->Buffer = NULL;
-	}
-
-	pRq->SenseLength=DEFAULT_SENSE_LEN;
+	span.pData = pBuffer;
+	span.SizeInBytes = Size;
+	return WriteI2Ccmd(&span, Size, Addr, RwTransType, pSizeWritten, pErrorInfo);
+}
+/*
+ * Same as above with data gathered from spans, Size is the total size of the checked spans (min 1)
+ */
+Brg_StatusT Brg::WriteI2Ccmd(const Brg_SpanT *pSpans, uint16_t Size, uint16_t Addr,
+                             Brg_I2cRWTransfer RwTransType, uint16_t *pSizeWritten, uint32_t *pErrorInfo)
+{
+	Brg_StatusT brgStat;
 
-	brgStat = SendRequestAndAnalyzeStatus(pRq, NULL, DEFAULT_TIMEOUT);
+	// Command and its status must not be interleaved with other commands
+	// (locked before GatherWriteData() that may use m_pGatherBuf)
+	CSLocker locker(m_csDevice);
 
-	delete pRq;
+	RwStatusBeforeCmd(COM_I2C);
+	brgStat = SendWriteI2Ccmd(pSpans, Size, Addr, RwTransType);
 
 	if( brgStat == BRG_NO_ERR )
 	{
-		brgStat = GetLastReadWriteStatus(pSizeWritten, pErrorInfo);
+		brgStat = RwStatusAfterCmd(COM_I2C, Size, pSizeWritten, pErrorInfo);
 	}
 
 	if( brgStat != BRG_NO_ERR ) {
@@ -1726,6 +2046,36 @@ Brg_StatusT Brg::WriteI2Ccmd(const uint8_t *pBuffer, uint16_t Addr,
 	}
 	return brgStat;
 }
+/*
+ * private: send the I2C write command (m_csDevice locked), without reading the Read/Write status
+ */
+Brg_StatusT Brg::SendWriteI2Ccmd(const Brg_SpanT *pSpans, uint16_t Size, uint16_t Addr,
+                                 Brg_I2cRWTransfer RwTransType)
+{
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
+	Brg_StatusT brgStat;
+
+	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
+	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
+	pRq->CDBByte[0] = STLINK_BRIDGE_COMMAND;
+	pRq->CDBByte[1] = STLINK_BRIDGE_WRITE_I2C;
+	pRq->CDBByte[2] = (uint8_t)Size;
+	pRq->CDBByte[3] = (uint8_t)(Size>>8);
+	pRq->CDBByte[4] = (uint8_t)Addr;
+	pRq->CDBByte[5] = (uint8_t)(Addr>>8);
+	pRq->CDBByte[6] = (uint8_t)RwTransType;
+	// 	pRq->CDBByte[7] unused 0
+	// First 4 bytes to transfer to target inside the cmd, the others in data stage
+	brgStat = GatherWriteData(pRq, pSpans, Size, 8, 4);
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+
+	pRq->SenseLength=DEFAULT_SENSE_LEN;
+
+	return SendRequestAndAnalyzeStatus(pRq, NULL, DEFAULT_TIMEOUT);
+}
 /**
  * @ingroup I2C
  * @brief This low level routine allows to split I2C transaction and to send bytes on the I2C interface,
@@ -1836,9 +2186,10 @@ Brg_StatusT Brg::StopWriteI2C(const uint8_t *pBuffer, uint16_t SizeInBytes, uint
  */
 Brg_StatusT Brg::InitCAN(const Brg_CanInitT *pInitParams, Brg_InitTypeT InitType)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
-	uint16_t status;
+	uint16_t status = 0;
 	const Brg_CanBitTimeConfT* pBitTimeConf;
 	uint8_t conf;
 
@@ -1862,7 +2213,6 @@ Brg_StatusT Brg::InitCAN(const Brg_CanInitT *pInitParams, Brg_InitTypeT InitType
 		return BRG_PARAM_ERR;
 	}
 
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
@@ -1914,7 +2264,6 @@ Brg_StatusT Brg::InitCAN(const Brg_CanInitT *pInitParams, Brg_InitTypeT InitType
 	pRq->SenseLength=DEFAULT_SENSE_LEN;
 
 	brgStat = SendRequestAndAnalyzeStatus(pRq, &status);
-	delete pRq;
 
 	return brgStat;
 }
@@ -2099,9 +2448,10 @@ Brg_StatusT Brg::FormatFilter16bitCAN(const Brg_FilterBitsT *pInConf, uint8_t *p
  */
 Brg_StatusT Brg::InitFilterCAN(const Brg_CanFilterConfT *pInitParams)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
-	uint16_t status;
+	uint16_t status = 0;
 	uint8_t filterConf = 0; // Default DISABLED CAN_FILTER_16BIT CAN_FILTER_ID_MASK CAN_MSG_RX_FIFO0
 	uint8_t filterId[4] = {0,0,0,0}, filterMask[4] = {0,0,0,0};
 
@@ -2177,7 +2527,6 @@ Brg_StatusT Brg::InitFilterCAN(const Brg_CanFilterConfT *pInitParams)
 		return brgStat;
 	}
 
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
@@ -2207,7 +2556,6 @@ Brg_StatusT Brg::InitFilterCAN(const Brg_CanFilterConfT *pInitParams)
 	pRq->SenseLength=DEFAULT_SENSE_LEN;
 
 	brgStat = SendRequestAndAnalyzeStatus(pRq, &status);
-	delete pRq;
 
 	return brgStat;
 }
@@ -2227,9 +2575,10 @@ Brg_StatusT Brg::InitFilterCAN(const Brg_CanFilterConfT *pInitParams)
  */
 Brg_StatusT Brg::StartMsgReceptionCAN(void)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
-	uint8_t answer[4];
+	uint8_t answer[4]={0,0,0,0};
 
 	if( m_bStlinkConnected == false ) {
 		// The function should be called at least after OpenStlink
@@ -2240,7 +2589,6 @@ Brg_StatusT Brg::StartMsgReceptionCAN(void)
 		return BRG_CMD_NOT_SUPPORTED;
 	}
 
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBByte[0] = STLINK_BRIDGE_COMMAND;
@@ -2264,7 +2612,6 @@ Brg_StatusT Brg::StartMsgReceptionCAN(void)
 		         (int)brgStat, (int)answer[2], (int)CAN_MSG_FORMAT_V1);
 	}
 
-	delete pRq;
 	return brgStat;
 }
 /**
@@ -2280,9 +2627,10 @@ Brg_StatusT Brg::StartMsgReceptionCAN(void)
  */
 Brg_StatusT Brg::StopMsgReceptionCAN(void)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
-	uint16_t status;
+	uint16_t status = 0;
 
 	if( m_bStlinkConnected == false ) {
 		// The function should be called at least after OpenStlink
@@ -2293,7 +2641,6 @@ Brg_StatusT Brg::StopMsgReceptionCAN(void)
 		return BRG_CMD_NOT_SUPPORTED;
 	}
 
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBByte[0] = STLINK_BRIDGE_COMMAND;
@@ -2308,7 +2655,6 @@ Brg_StatusT Brg::StopMsgReceptionCAN(void)
 
 	brgStat = SendRequestAndAnalyzeStatus(pRq, &status);
 
-	delete pRq;
 	return brgStat;
 }
 /**
@@ -2326,9 +2672,10 @@ Brg_StatusT Brg::StopMsgReceptionCAN(void)
  */
 Brg_StatusT Brg::GetRxMsgNbCAN(uint16_t *pMsgNb)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
-	uint8_t answer[8];
+	uint8_t answer[8]={0,0,0,0,0,0,0,0};
 
 	if( m_bStlinkConnected == false ) {
 		// The function should be called at least after OpenStlink
@@ -2342,7 +2689,6 @@ Brg_StatusT Brg::GetRxMsgNbCAN(uint16_t *pMsgNb)
 		return BRG_PARAM_ERR;
 	}
 
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBByte[0] = STLINK_BRIDGE_COMMAND;
@@ -2361,7 +2707,6 @@ Brg_StatusT Brg::GetRxMsgNbCAN(uint16_t *pMsgNb)
 		brgStat = BRG_PARAM_ERR;
 	}
 
-	delete pRq;
 	return brgStat;
 }
 /**
@@ -2396,12 +2741,11 @@ Brg_StatusT Brg::GetRxMsgNbCAN(uint16_t *pMsgNb)
 Brg_StatusT Brg::GetRxMsgCAN(Brg_CanRxMsgT *pCanMsg, uint16_t MsgNb, uint8_t *pBuffer,
                              uint16_t BufSizeInBytes, uint16_t *pDataSizeInBytes)
 {
-	STLink_DeviceRequestT *pRq;
 	Brg_StatusT brgStat;
-	uint8_t *pAnswer;
-	uint8_t *pReadCanMsg;
+	const uint8_t *pReadCanMsg;
+	const Brg_CanRxFlagsT *pFlags;
 	uint16_t msgDataSize, buffDataSize, buffDataOffset;
-	uint32_t answerSize, firstErrMsgNb;
+	uint32_t firstErrMsgNb;
 
 	if( m_bStlinkConnected == false ) {
 		// The function should be called at least after OpenStlink
@@ -2416,94 +2760,50 @@ Brg_StatusT Brg::GetRxMsgCAN(Brg_CanRxMsgT *pCanMsg, uint16_t MsgNb, uint8_t *pB
 	}
 
 	*pDataSizeInBytes = 0; // Default
-	answerSize = MsgNb*CAN_READ_MSG_SIZE_V1;
-	pAnswer = new uint8_t[answerSize];
-	if( pAnswer == NULL ) {
-		return BRG_MEM_ALLOC_ERR;
-	}
-	pRq = new STLink_DeviceRequestT;
-	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
-
-	pRq->CDBByte[0] = STLINK_BRIDGE_COMMAND;
-	pRq->CDBByte[1] = STLINK_BRIDGE_GET_RXMSG_CAN;
-	pRq->CDBByte[2] = (uint8_t)MsgNb;
-	pRq->CDBByte[3] = (uint8_t)((MsgNb>>8)&0xFF);
 
-	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
-	pRq->BufferLength = answerSize;
-	pRq->InputRequest = REQUEST_READ_1ST_EPIN;
-	pRq->Buffer = pAnswer;
-
-	pRq->SenseLength=DEFAULT_SENSE_LEN;
-
-	brgStat = SendRequestAndAnalyzeStatus(pRq, NULL);
-
-	delete pRq;
+	// Answer buffer shared with GetRxMsgArraysCAN()
+	CSLocker locker(m_csDevice);
+	brgStat = ReadRxMsgCAN(MsgNb, &pReadCanMsg);
 
-	// Warning if MsgNb is not correct, a 2 bytes error status is received from the FW instead
-	// of answerSize bytes, this is a host issue and can lead to USB com err or wrongly
-	// interpreted answer
 	if( brgStat == BRG_NO_ERR ) {
-		uint8_t overrunErr;
-		pReadCanMsg = &pAnswer[0]; //First received message
 		buffDataSize = BufSizeInBytes;
 		buffDataOffset = 0;
 		for( int j=0; j<MsgNb; j++ ) {
 			// Fill pCanMsg and pBuffer with read data
 			pCanMsg[j].ID = (uint32_t)pReadCanMsg[0] | (((uint32_t)pReadCanMsg[1])<<8) |
                             (((uint32_t)pReadCanMsg[2])<<16) | (((uint32_t)pReadCanMsg[3])<<24);
-			// byte4 message type
-			if( (pReadCanMsg[4]&0x1) == 0) { // byte4 bit0 IDE
-				pCanMsg[j].IDE = CAN_ID_STANDARD;
-			} else {
-				pCanMsg[j].IDE = CAN_ID_EXTENDED;
-			}
-			if( (pReadCanMsg[4]&(0x1<<2)) == 0) { // byte4 Bit2 FIFONumber
-				pCanMsg[j].Fifo = CAN_MSG_RX_FIFO0;
-			} else {
-				pCanMsg[j].Fifo = CAN_MSG_RX_FIFO1;
+			// byte4 message type: IDE, RTR, FIFONumber and Overrun fields from one table entry
+			pFlags = &s_canRxFlags[pReadCanMsg[4]&CAN_RX_FLAGS_MASK];
+			pCanMsg[j].IDE = pFlags->IDE;
+			pCanMsg[j].RTR = pFlags->RTR;
+			pCanMsg[j].Fifo = pFlags->Fifo;
+			pCanMsg[j].Overrun = pFlags->Overrun;
+			// Byte5 DLC
+			pCanMsg[j].DLC = pReadCanMsg[5];
+			// Byte6-7: Message time stamp unused
+			pCanMsg[j].TimeStamp = 0;
+			// Byte 8 to 15: 0 to 8 data bytes (no data to copy in case of RTR message)
+			msgDataSize = pFlags->DataMask & pCanMsg[j].DLC;
+			if( msgDataSize > CAN_READ_MSG_DATA_SIZE_V1 ) {
+				msgDataSize = CAN_READ_MSG_DATA_SIZE_V1;
 			}
-			overrunErr = (pReadCanMsg[4]>>3)&0x3; // byte4 Bit3-4 Overrun
-			if( overrunErr != 0 ) {
-				// Overrun has occurred before this msg
-				if( overrunErr == 1 ) { // CAN fifo overrun err (1)
-					pCanMsg[j].Overrun = CAN_RX_FIFO_OVERRUN;
-				} else { // Buffer overrun error (2)
-					pCanMsg[j].Overrun = CAN_RX_BUFF_OVERRUN;
-				}
-				if( brgStat == BRG_NO_ERR ) {
-					brgStat = BRG_OVERRUN_ERR;
+			if( ((pFlags->Overrun != CAN_RX_NO_OVERRUN) || (msgDataSize > buffDataSize))
+			    && (brgStat == BRG_NO_ERR) ) {
+				brgStat = BRG_OVERRUN_ERR;
+				if( pFlags->Overrun != CAN_RX_NO_OVERRUN ) {
+					// Overrun has occurred before this msg
 					firstErrMsgNb = j;
 					LogTrace("CAN Overrun Error in GetRxMsgCAN (first error %d at %d/%d msg)",
-                             (int)overrunErr, (int)firstErrMsgNb, (int)MsgNb);
-				}
-			} else { // Else no overrun error
-				pCanMsg[j].Overrun = CAN_RX_NO_OVERRUN;
-			}
-			// Byte5 DLC
-			pCanMsg[j].DLC = pReadCanMsg[5];
-			if( (pReadCanMsg[4]&0x2) == 0) { // byte4 bit1 RTR
-				pCanMsg[j].RTR = CAN_DATA_FRAME;
-				if( buffDataSize >= pCanMsg[j].DLC ) {
-					msgDataSize = pCanMsg[j].DLC;
+                             (int)pFlags->Overrun, (int)firstErrMsgNb, (int)MsgNb);
 				} else {
-					msgDataSize = buffDataSize; // limit copied data to max buffer size
-					if( brgStat == BRG_NO_ERR ) {
-						brgStat = BRG_OVERRUN_ERR;
-						LogTrace("CAN Data Error in GetRxMsgCAN: BufSizeInBytes too small (error at %d/%d msg)",
-						         (int)j, (int)MsgNb);
-					}
+					LogTrace("CAN Data Error in GetRxMsgCAN: BufSizeInBytes too small (error at %d/%d msg)",
+					         (int)j, (int)MsgNb);
 				}
-			} else {
-				pCanMsg[j].RTR = CAN_REMOTE_FRAME;
-				msgDataSize = 0; // no data to copy in case of RTR message
 			}
-			// Byte6-7: Message time stamp unused
-			pCanMsg[j].TimeStamp = 0;
-			// Byte 8 to 15: 0 to 8 data bytes
-			for( int i=0; i<msgDataSize; i++ ) {
-				pBuffer[buffDataOffset+i] = pReadCanMsg[CAN_READ_MSG_HEADER_SIZE_V1+i];
+			if( msgDataSize > buffDataSize ) {
+				msgDataSize = buffDataSize; // limit copied data to max buffer size
 			}
+			memcpy(&pBuffer[buffDataOffset], &pReadCanMsg[CAN_READ_MSG_HEADER_SIZE_V1], msgDataSize);
 			// Point on next message and update the number of remaining data to copy
 			pReadCanMsg += CAN_READ_MSG_SIZE_V1;
 			buffDataSize -= msgDataSize;
@@ -2527,13 +2827,130 @@ Brg_StatusT Brg::GetRxMsgCAN(Brg_CanRxMsgT *pCanMsg, uint16_t MsgNb, uint8_t *pB
 	}
 #endif
 
-	delete [] pAnswer;
 	return brgStat;
 }
+/**
+ * @ingroup CAN
+ * @brief This routine gets the available CAN messages like Brg::GetRxMsgCAN(), in a structure of arrays
+ * (identifiers, flags, DLCs, payloads) for consumers processing a field over many messages.\n
+ * The message type byte is returned as is (BRG_CAN_RX_FLAG_xxx) and the payloads have a fixed 8-byte stride,
+ * so the messages are copied without any per-message decoding.
+ * @param[in]  MsgNb  Number of messages, same rules as for Brg::GetRxMsgCAN().
+ * @param[in]  pArrays  Arrays of at least MsgNb entries (pData: MsgNb*8 bytes), see #Brg_CanRxArraysT.
+ *
+ * @retval #BRG_NO_STLINK If Brg::OpenStlink() not called before
+ * @retval #BRG_COM_INIT_NOT_DONE If CAN is not initialized
+ * @retval #BRG_CAN_ERR In case of CAN error
+ * @retval #BRG_PARAM_ERR If incorrect MsgNb (0 or greater than available messages) or NULL pointer
+ * @retval #BRG_CMD_NOT_SUPPORTED If firmware is too old for this command
+ * @retval #BRG_MEM_ALLOC_ERR If memory allocation for message answer failed
+ * @retval #BRG_OVERRUN_ERR if overrun is detected in at least 1 message (#BRG_CAN_RX_FLAG_OVERRUN)
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT Brg::GetRxMsgArraysCAN(uint16_t MsgNb, const Brg_CanRxArraysT *pArrays)
+{
+	Brg_StatusT brgStat;
+	const uint8_t *pReadCanMsg, *pMsg;
+	uint8_t overrunFlags = 0;
+
+	if( m_bStlinkConnected == false ) {
+		// The function should be called at least after OpenStlink
+		return BRG_NO_STLINK;
+	}
+	if( IsCanSupport() == false ) {
+		// Command not supported on first FW bridge version (B1)
+		return BRG_CMD_NOT_SUPPORTED;
+	}
+	if( (pArrays == NULL) || (pArrays->pId == NULL) || (MsgNb < 1) ) {
+		return BRG_PARAM_ERR;
+	}
+
+	CSLocker locker(m_csDevice);
+	brgStat = ReadRxMsgCAN(MsgNb, &pReadCanMsg);
+
+	if( brgStat == BRG_NO_ERR ) {
+		// One pass per field: fixed record and payload sizes, no per-message branch
+		for( int j=0; j<MsgNb; j++ ) {
+			pMsg = &pReadCanMsg[j*CAN_READ_MSG_SIZE_V1];
+			pArrays->pId[j] = (uint32_t)pMsg[0] | (((uint32_t)pMsg[1])<<8) |
+			                  (((uint32_t)pMsg[2])<<16) | (((uint32_t)pMsg[3])<<24);
+			overrunFlags |= pMsg[4];
+		}
+		if( pArrays->pFlags != NULL ) {
+			for( int j=0; j<MsgNb; j++ ) {
+				pArrays->pFlags[j] = pReadCanMsg[j*CAN_READ_MSG_SIZE_V1 + 4] & CAN_RX_FLAGS_MASK;
+			}
+		}
+		if( pArrays->pDlc != NULL ) {
+			for( int j=0; j<MsgNb; j++ ) {
+				pArrays->pDlc[j] = pReadCanMsg[j*CAN_READ_MSG_SIZE_V1 + 5];
+			}
+		}
+		if( pArrays->pData != NULL ) {
+			for( int j=0; j<MsgNb; j++ ) {
+				memcpy(&pArrays->pData[j*CAN_READ_MSG_DATA_SIZE_V1],
+				       &pReadCanMsg[j*CAN_READ_MSG_SIZE_V1 + CAN_READ_MSG_HEADER_SIZE_V1], CAN_READ_MSG_DATA_SIZE_V1);
+			}
+		}
+		if( (overrunFlags & BRG_CAN_RX_FLAG_OVERRUN) != 0 ) {
+			brgStat = BRG_OVERRUN_ERR;
+			LogTrace("CAN Overrun Error in GetRxMsgArraysCAN (%d msg)", (int)MsgNb);
+		}
+	} else {
+		LogTrace("CAN Error (%d) in GetRxMsgArraysCAN (%d msg)", (int)brgStat, (int)MsgNb);
+	}
+
+	return brgStat;
+}
+/*
+ * private: STLINK_BRIDGE_GET_RXMSG_CAN request of MsgNb messages (m_csDevice locked). The answer is
+ * received in m_pCanRxAnswer, kept from one call to the other (only reallocated when a bigger one
+ * is needed): *ppAnswer points on the first CAN_READ_MSG_SIZE_V1 bytes record.
+ */
+Brg_StatusT Brg::ReadRxMsgCAN(uint16_t MsgNb, const uint8_t **ppAnswer)
+{
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
+	uint32_t answerSize = MsgNb*CAN_READ_MSG_SIZE_V1;
+
+	if( answerSize > m_canRxAnswerSize ) {
+		if( m_pCanRxAnswer != NULL ) {
+			delete [] m_pCanRxAnswer;
+		}
+		m_canRxAnswerSize = 0;
+		m_pCanRxAnswer = new (std::nothrow) uint8_t[answerSize];
+		if( m_pCanRxAnswer == NULL ) {
+			return BRG_MEM_ALLOC_ERR;
+		}
+		m_canRxAnswerSize = answerSize;
+	}
+	*ppAnswer = m_pCanRxAnswer;
+	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
+
+	pRq->CDBByte[0] = STLINK_BRIDGE_COMMAND;
+	pRq->CDBByte[1] = STLINK_BRIDGE_GET_RXMSG_CAN;
+	pRq->CDBByte[2] = (uint8_t)MsgNb;
+	pRq->CDBByte[3] = (uint8_t)((MsgNb>>8)&0xFF);
+
+	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
+	pRq->BufferLength = answerSize;
+	pRq->InputRequest = REQUEST_READ_1ST_EPIN;
+	pRq->Buffer = m_pCanRxAnswer;
+
+	pRq->SenseLength=DEFAULT_SENSE_LEN;
+
+	// Warning if MsgNb is not correct, a 2 bytes error status is received from the FW instead
+	// of answerSize bytes, this is a host issue and can lead to USB com err or wrongly
+	// interpreted answer
+	return SendRequestAndAnalyzeStatus(pRq, NULL);
+}
 /**
  * @ingroup CAN
  * @brief This routine allows to send a message on CAN bus through the CAN interface,
  * in the mode initialized by InitCAN().\n
+ * The status is read as for the other Read/Write commands (see Brg::SetRwStatusMode()): in #RW_STATUS_DEFERRED
+ * mode consecutive messages are sent back-to-back, one USB command each, and a CAN error is only reported at
+ * the end of the batch.
  * @param[in]   pCanMsg Pointer on a message "header" see #Brg_CanTxMsgT description.
  * @param[in]   pBuffer  Pointer to the data buffer (must be at least size length).
  * @param[in]   SizeInBytes  Number of data bytes to send (max 8 bytes).
@@ -2546,7 +2963,8 @@ Brg_StatusT Brg::GetRxMsgCAN(Brg_CanRxMsgT *pCanMsg, uint16_t MsgNb, uint8_t *pB
  */
 Brg_StatusT Brg::WriteMsgCAN(const Brg_CanTxMsgT *pCanMsg, const uint8_t *pBuffer, uint8_t SizeInBytes)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
 	uint8_t msgType, msgDLC;
 
@@ -2577,7 +2995,8 @@ Brg_StatusT Brg::WriteMsgCAN(const Brg_CanTxMsgT *pCanMsg, const uint8_t *pBuffe
 		msgDLC = SizeInBytes;
 	}
 
-	pRq = new STLink_DeviceRequestT;
+	CSLocker locker(m_csDevice);
+
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
 	pRq->CDBByte[0] = STLINK_BRIDGE_COMMAND;
@@ -2612,13 +3031,12 @@ Brg_StatusT Brg::WriteMsgCAN(const Brg_CanTxMsgT *pCanMsg, const uint8_t *pBuffe
 
 	pRq->SenseLength=DEFAULT_SENSE_LEN;
 
+	RwStatusBeforeCmd(COM_CAN);
 	brgStat = SendRequestAndAnalyzeStatus(pRq, NULL);
 
-	delete pRq;
-
 	if( brgStat == BRG_NO_ERR )
 	{	// pSizeWritten not useful for CAN, pErrorInfo currently unused
-		brgStat = GetLastReadWriteStatus(NULL, NULL);
+		brgStat = RwStatusAfterCmd(COM_CAN, SizeInBytes, NULL, NULL);
 	}
 
 	if( brgStat != BRG_NO_ERR ) {
@@ -2645,7 +3063,8 @@ Brg_StatusT Brg::WriteMsgCAN(const Brg_CanTxMsgT *pCanMsg, const uint8_t *pBuffe
 Brg_StatusT Brg::GetLastReadWriteStatus(uint16_t *pBytesWithoutError, uint32_t *pErrorInfo)
 {
 	uint16_t answer[BRIDGE_RW_STATUS_LEN_WORD]={0,0,0,0};
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
 
 	if( m_bStlinkConnected == false ) {
@@ -2653,7 +3072,6 @@ Brg_StatusT Brg::GetLastReadWriteStatus(uint16_t *pBytesWithoutError, uint32_t *
 		return BRG_NO_STLINK;
 	}
 
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
 	pRq->CDBByte[0] = STLINK_BRIDGE_COMMAND;
@@ -2673,10 +3091,464 @@ Brg_StatusT Brg::GetLastReadWriteStatus(uint16_t *pBytesWithoutError, uint32_t *
 		*pErrorInfo = (uint32_t)answer[2] | (uint32_t)answer[3]<<16;
 	}
 
-	delete pRq;
+	return brgStat;
+}
+
+/**
+ * @ingroup BRIDGE
+ * @brief This routine selects how the status of SPI/I2C/CAN Read/Write commands (Brg::ReadSPI(), Brg::WriteSPI(),
+ * Brg::ReadI2C(), Brg::WriteI2C(), partial I2C transactions and Brg::WriteMsgCAN()) is collected.\n
+ * In #RW_STATUS_IMMEDIATE mode (default) each command is followed by Brg::GetLastReadWriteStatus(), that is
+ * 2 USB round trips per command.\n
+ * In #RW_STATUS_DEFERRED mode the commands are grouped in windows ended by a status read: every BatchSize
+ * commands (error returned by the command ending the window), at Brg::SyncRwStatus() and at the end of a
+ * Brg::ExecuteBatch(); other commands only return USB errors.
+ * STLink firmware only keeps the status of its last Read/Write command, so in #RW_STATUS_DEFERRED mode an
+ * I2C or CAN command, which can fail on the bus (NACK, CAN error), ends its window: its status is read before
+ * the next Read/Write command, and its error kept for Brg::SyncRwStatus(). Only consecutive SPI commands,
+ * which fail only if SPI is not initialized, share a window and save their status reads.
+ * @warning In #RW_STATUS_DEFERRED mode, data read by a command are checked only once its window is ended:
+ *          call Brg::SyncRwStatus() after each read whose data are used, and after a write that must be
+ *          checked before the next command.
+ * @param[in]  Mode  #RW_STATUS_IMMEDIATE or #RW_STATUS_DEFERRED.
+ * @param[in]  BatchSize  #RW_STATUS_DEFERRED: number of commands after which the status is read,
+ *             0 for status read only by Brg::SyncRwStatus(). Unused in #RW_STATUS_IMMEDIATE mode.
+ *
+ * @return Brg::SyncRwStatus() errors when leaving #RW_STATUS_DEFERRED mode
+ * @retval #BRG_PARAM_ERR Unknown Mode
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT Brg::SetRwStatusMode(Brg_RwStatusModeT Mode, uint16_t BatchSize)
+{
+	Brg_StatusT brgStat = BRG_NO_ERR;
+
+	if( (Mode != RW_STATUS_IMMEDIATE) && (Mode != RW_STATUS_DEFERRED) ) {
+		return BRG_PARAM_ERR;
+	}
+
+	CSLocker locker(m_csDevice);
+
+	if( (m_rwStatusMode == RW_STATUS_DEFERRED) && (Mode == RW_STATUS_IMMEDIATE) ) {
+		// Report the errors of the commands not yet checked
+		brgStat = SyncRwStatus(NULL);
+	}
+	m_rwStatusMode = Mode;
+	m_rwBatchSize = (Mode == RW_STATUS_DEFERRED) ? BatchSize : 0;
+	return brgStat;
+}
+/**
+ * @ingroup BRIDGE
+ * @brief In #RW_STATUS_DEFERRED mode, this routine ends the current window of Read/Write commands (commands
+ * sent since the last status read) by reading its status, and returns the first error found since the
+ * previous call to Brg::SyncRwStatus(), even if the commands sent after the failing one succeeded.
+ * @param[out] pOpStatus If not NULL, filled with the command(s) the returned status refers to:
+ *             the first failing window in case of error (the failing command for I2C and CAN, see
+ *             #Brg_RwOpStatusT), else the last command.
+ *
+ * @return All possible read/write errors (first failing window status since previous call)
+ * @retval #BRG_NO_STLINK If Brg::OpenStlink() not called before
+ * @retval #BRG_NO_ERR If no error (or #RW_STATUS_IMMEDIATE mode)
+ */
+Brg_StatusT Brg::SyncRwStatus(Brg_RwOpStatusT *pOpStatus)
+{
+	Brg_StatusT brgStat;
+
+	if( m_bStlinkConnected == false ) {
+		// The function should be called at least after OpenStlink
+		return BRG_NO_STLINK;
+	}
+
+	CSLocker locker(m_csDevice);
+
+	ReadRwWindowStatus();
+
+	brgStat = m_rwDeferredStat;
+	if( pOpStatus != NULL ) {
+		if( brgStat != BRG_NO_ERR ) {
+			*pOpStatus = m_rwDeferredOp;
+		} else {
+			*pOpStatus = m_rwLastOp;
+			pOpStatus->FirstOpId = m_rwSyncOpId;
+		}
+	}
+	if( brgStat != BRG_NO_ERR ) {
+		LogTrace("Deferred Read/Write Error (%d) in commands %d to %d",
+		         (int)brgStat, (int)m_rwDeferredOp.FirstOpId, (int)m_rwDeferredOp.OpId);
+	}
+	m_rwDeferredStat = BRG_NO_ERR;
+	m_rwSyncOpId = m_rwLastOp.OpId + 1;
+	return brgStat;
+}
+/**
+ * @ingroup BRIDGE
+ * @brief This routine returns the Id of the last SPI/I2C/CAN Read/Write command sent in #RW_STATUS_DEFERRED
+ * mode, to be compared with the window returned by Brg::SyncRwStatus() (see #Brg_RwOpStatusT).
+ *
+ * @return Id of the last Read/Write command (0 if none)
+ */
+uint32_t Brg::GetLastRwOpId(void)
+{
+	CSLocker locker(m_csDevice);
+	return m_rwLastOp.OpId;
+}
+/*
+ * private: called before a Read/Write command or a batch operation (m_csDevice locked), BrgCom being its
+ * communication. In RW_STATUS_DEFERRED mode, end the
+ * current window unless both its commands and this one are SPI commands: the status of an I2C or CAN
+ * command is read before the next command overwrites it, its error is kept for SyncRwStatus().
+ */
+void Brg::RwStatusBeforeCmd(uint8_t BrgCom)
+{
+	if( (m_rwStatusMode == RW_STATUS_DEFERRED) && (m_rwPendingNb != 0) &&
+	    ((BrgCom != COM_SPI) || (m_rwLastOp.BrgCom != COM_SPI)) ) {
+		ReadRwWindowStatus();
+	}
+}
+/*
+ * private: called after a Read/Write command (m_csDevice locked), read the status now or record
+ * the command for a deferred status read (see SetRwStatusMode()).
+ */
+Brg_StatusT Brg::RwStatusAfterCmd(uint8_t BrgCom, uint16_t SizeInBytes,
+                                  uint16_t *pBytesWithoutError, uint32_t *pErrorInfo)
+{
+	Brg_StatusT brgStat;
+
+	if( m_rwStatusMode == RW_STATUS_IMMEDIATE ) {
+		return GetLastReadWriteStatus(pBytesWithoutError, pErrorInfo);
+	}
+
+	m_rwLastOp.OpId++;
+	m_rwLastOp.BrgCom = BrgCom;
+	m_rwLastOp.SizeInBytes = SizeInBytes;
+	m_rwLastOp.BytesWithoutError = 0;
+	m_rwLastOp.ErrorInfo = 0;
+	m_rwPendingNb++;
 
+	if( (m_rwBatchSize == 0) || (m_rwPendingNb < m_rwBatchSize) ) {
+		return BRG_NO_ERR;
+	}
+	// End of window
+	brgStat = ReadRwWindowStatus();
+	if( brgStat != BRG_NO_ERR ) {
+		if( pBytesWithoutError != NULL ) {
+			*pBytesWithoutError = m_rwLastOp.BytesWithoutError;
+		}
+		if( pErrorInfo != NULL ) {
+			*pErrorInfo = m_rwLastOp.ErrorInfo;
+		}
+	}
 	return brgStat;
 }
+/*
+ * private: end the window of deferred Read/Write commands (m_csDevice locked): read the STLink status,
+ * which is the one of the last command of the window, keep the first failing window for SyncRwStatus()
+ * (later failing windows are only traced).
+ */
+Brg_StatusT Brg::ReadRwWindowStatus(void)
+{
+	Brg_StatusT brgStat;
+
+	if( m_rwPendingNb == 0 ) {
+		return BRG_NO_ERR;
+	}
+	brgStat = GetLastReadWriteStatus(&m_rwLastOp.BytesWithoutError, &m_rwLastOp.ErrorInfo);
+	m_rwLastOp.FirstOpId = m_rwLastOp.OpId - m_rwPendingNb + 1;
+	m_rwPendingNb = 0;
+	if( brgStat != BRG_NO_ERR ) {
+		if( m_rwDeferredStat == BRG_NO_ERR ) {
+			m_rwDeferredStat = brgStat;
+			m_rwDeferredOp = m_rwLastOp;
+		} else {
+			LogTrace("Deferred Read/Write Error (%d) in commands %d to %d not reported",
+			         (int)brgStat, (int)m_rwLastOp.FirstOpId, (int)m_rwLastOp.OpId);
+		}
+	}
+	return brgStat;
+}
+/**
+ * @ingroup BRIDGE
+ * @brief This routine executes a sequence of SPI/I2C/CAN/GPIO operations (see #Brg_BatchOpT) in one call.\n
+ * All the operations are checked before the first one is sent, then they are executed in order,
+ * without interleaving with commands of other threads, until the end or the first error.\n
+ * The Read/Write status follows the mode selected by Brg::SetRwStatusMode(): in #RW_STATUS_DEFERRED
+ * mode the status of an I2C or CAN operation is read before the next operation, consecutive SPI operations
+ * share a status read, and the batch ends with Brg::SyncRwStatus(). The batch stops at the first failing
+ * window, whose error is reported on its Read/Write operations (the failing I2C/CAN operation, or all the
+ * SPI operations of the window, SizeDone only exact for the last one). The window of the commands sent
+ * before the batch is ended before its first operation: an error of these commands is not returned by the
+ * batch but by the next Brg::SyncRwStatus().
+ * @param[in,out] pOps  Operations to execute, Status, SizeDone and GpioErrorMask updated.
+ * @param[in]  OpNb  Number of operations in pOps.
+ * @param[out] pOpDoneNb If not NULL, number of operations executed (the last one failed in case of error).
+ *
+ * @return Status of the first failing operation (or of Brg::SyncRwStatus() in #RW_STATUS_DEFERRED mode)
+ * @retval #BRG_NO_STLINK If Brg::OpenStlink() not called before
+ * @retval #BRG_PARAM_ERR If an operation has wrong parameters (no operation executed)
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT Brg::ExecuteBatch(Brg_BatchOpT *pOps, uint32_t OpNb, uint32_t *pOpDoneNb)
+{
+	Brg_StatusT brgStat = BRG_NO_ERR;
+	Brg_StatusT syncStat;
+	Brg_StatusT prevStat = BRG_NO_ERR;
+	Brg_RwOpStatusT rwStatus;
+	Brg_RwOpStatusT prevOp;
+	uint32_t opIdx, opDoneNb, rwOpId;
+
+	if( pOpDoneNb != NULL ) {
+		*pOpDoneNb = 0;
+	}
+	if( (pOps == NULL) || (OpNb == 0) ) {
+		return BRG_PARAM_ERR;
+	}
+	if( m_bStlinkConnected == false ) {
+		// The function should be called at least after OpenStlink
+		return BRG_NO_STLINK;
+	}
+	// Check the whole batch before sending anything
+	for( opIdx = 0; opIdx < OpNb; opIdx++ ) {
+		brgStat = CheckBatchOp(&pOps[opIdx]);
+		if( brgStat != BRG_NO_ERR ) {
+			LogTrace("Batch operation %d: wrong parameter", (int)opIdx);
+			return brgStat;
+		}
+		pOps[opIdx].Status = BRG_COM_CMD_ORDER_ERR;
+		pOps[opIdx].SizeDone = 0;
+		pOps[opIdx].GpioErrorMask = 0;
+	}
+
+	// Batch must not be interleaved with other commands
+	CSLocker locker(m_csDevice);
+
+	if( m_rwStatusMode == RW_STATUS_DEFERRED ) {
+		// End the window of the commands sent before the batch: their error (or the one already kept)
+		// is not reported on the batch operations but kept for the next SyncRwStatus()
+		ReadRwWindowStatus();
+		prevStat = m_rwDeferredStat;
+		prevOp = m_rwDeferredOp;
+		m_rwDeferredStat = BRG_NO_ERR;
+	}
+	rwOpId = m_rwLastOp.OpId + 1; // Id of the first batch Read/Write operation in deferred mode
+	opDoneNb = 0;
+	while( (opDoneNb < OpNb) && (brgStat == BRG_NO_ERR) ) {
+		if( m_rwStatusMode == RW_STATUS_DEFERRED ) {
+			// Stop after a failing window (reported by SyncRwStatus() below), SPI_CS does not end
+			// a window of SPI operations
+			RwStatusBeforeCmd(BATCH_OP_COM(pOps[opDoneNb].OpType));
+			if( m_rwDeferredStat != BRG_NO_ERR ) {
+				break;
+			}
+		}
+		brgStat = ExecuteBatchOp(&pOps[opDoneNb]);
+		opDoneNb++;
+	}
+
+	if( m_rwStatusMode == RW_STATUS_DEFERRED ) {
+		syncStat = SyncRwStatus(&rwStatus);
+		if( syncStat != BRG_NO_ERR ) {
+			for( opIdx = 0; opIdx < opDoneNb; opIdx++ ) {
+				if( IS_BATCH_RW_OP(pOps[opIdx].OpType) ) {
+					if( (rwOpId >= rwStatus.FirstOpId) && (rwOpId <= rwStatus.OpId) ) {
+						pOps[opIdx].Status = syncStat;
+						pOps[opIdx].SizeDone = (rwOpId == rwStatus.OpId) ? rwStatus.BytesWithoutError : 0;
+					}
+					rwOpId++;
+				}
+			}
+			if( brgStat == BRG_NO_ERR ) {
+				brgStat = syncStat;
+			}
+		}
+		if( prevStat != BRG_NO_ERR ) {
+			m_rwDeferredStat = prevStat;
+			m_rwDeferredOp = prevOp;
+		}
+	}
+
+	if( pOpDoneNb != NULL ) {
+		*pOpDoneNb = opDoneNb;
+	}
+	if( brgStat != BRG_NO_ERR ) {
+		LogTrace("Batch Error (%d) after %d/%d operations", (int)brgStat, (int)opDoneNb, (int)OpNb);
+	}
+	return brgStat;
+}
+/*
+ * private: check the parameters of a Brg::ExecuteBatch() operation
+ */
+Brg_StatusT Brg::CheckBatchOp(const Brg_BatchOpT *pOp) const
+{
+	switch( pOp->OpType ) {
+		case BATCH_SPI_CS:
+			if( (pOp->NssLevel != SPI_NSS_LOW) && (pOp->NssLevel != SPI_NSS_HIGH) ) {
+				return BRG_PARAM_ERR;
+			}
+			break;
+		case BATCH_SPI_WRITE:
+		case BATCH_I2C_WRITE:
+			if( (pOp->pTxBuffer == NULL) || (pOp->SizeInBytes == 0) ) {
+				return BRG_PARAM_ERR;
+			}
+			break;
+		case BATCH_SPI_READ:
+		case BATCH_I2C_READ:
+			if( (pOp->pRxBuffer == NULL) || (pOp->SizeInBytes == 0) ) {
+				return BRG_PARAM_ERR;
+			}
+			break;
+		case BATCH_GPIO_SET:
+			if( (pOp->GpioMask & BRG_GPIO_ALL) == 0 ) {
+				return BRG_PARAM_ERR;
+			}
+			break;
+		case BATCH_CAN_WRITE:
+			if( (pOp->pTxBuffer == NULL) || (pOp->SizeInBytes > 8) || (pOp->CanMsg.DLC > 8) ) {
+				return BRG_PARAM_ERR;
+			}
+			break;
+		default:
+			return BRG_PARAM_ERR;
+	}
+	return BRG_NO_ERR;
+}
+/*
+ * private: execute a checked Brg::ExecuteBatch() operation (m_csDevice locked)
+ */
+Brg_StatusT Brg::ExecuteBatchOp(Brg_BatchOpT *pOp)
+{
+	// Read/Write routines only set the size in case of error
+	uint16_t sizeDone = pOp->SizeInBytes;
+
+	switch( pOp->OpType ) {
+		case BATCH_SPI_CS:
+			pOp->Status = SetSPIpinCS(pOp->NssLevel);
+			break;
+		case BATCH_SPI_WRITE:
+			pOp->Status = WriteSPI(pOp->pTxBuffer, pOp->SizeInBytes, &sizeDone);
+			break;
+		case BATCH_SPI_READ:
+			pOp->Status = ReadSPI(pOp->pRxBuffer, pOp->SizeInBytes, &sizeDone);
+			break;
+		case BATCH_I2C_WRITE:
+			pOp->Status = WriteI2C(pOp->pTxBuffer, pOp->Addr, pOp->SizeInBytes, &sizeDone);
+			break;
+		case BATCH_I2C_READ:
+			pOp->Status = ReadI2C(pOp->pRxBuffer, pOp->Addr, pOp->SizeInBytes, &sizeDone);
+			break;
+		case BATCH_GPIO_SET:
+			sizeDone = 0;
+			pOp->Status = SetResetGPIO(pOp->GpioMask, pOp->GpioVal, &pOp->GpioErrorMask);
+			break;
+		case BATCH_CAN_WRITE:
+			pOp->Status = WriteMsgCAN(&pOp->CanMsg, pOp->pTxBuffer, (uint8_t)pOp->SizeInBytes);
+			if( pOp->Status != BRG_NO_ERR ) {
+				sizeDone = 0;
+			}
+			break;
+		default:
+			sizeDone = 0;
+			pOp->Status = BRG_PARAM_ERR;
+			break;
+	}
+	pOp->SizeDone = sizeDone;
+	return pOp->Status;
+}
+/*
+ * private: check the spans of a gather write and return their total size
+ */
+Brg_StatusT Brg::GetSpansSize(const Brg_SpanT *pSpans, uint8_t SpanNb, uint16_t *pSize)
+{
+	uint32_t size = 0;
+
+	*pSize = 0;
+	if( (pSpans == NULL) || (SpanNb == 0) ) {
+		return BRG_PARAM_ERR;
+	}
+	for( uint8_t i = 0; i < SpanNb; i++ ) {
+		if( (pSpans[i].pData == NULL) && (pSpans[i].SizeInBytes != 0) ) {
+			return BRG_PARAM_ERR;
+		}
+		size += pSpans[i].SizeInBytes;
+	}
+	if( size > 0xFFFF ) {
+		return BRG_PARAM_ERR;
+	}
+	*pSize = (uint16_t)size;
+	return BRG_NO_ERR;
+}
+/*
+ * private: set the data of a write command from the spans (m_csDevice locked): the CdbDataMax first
+ * bytes are copied in the CDB from CDBByte[CdbIdx], the following ones are sent in the data stage,
+ * in place if they are in a single span, else gathered in m_pGatherBuf. Size is the total size of
+ * the spans checked by GetSpansSize(): it bounds the span walk.
+ */
+Brg_StatusT Brg::GatherWriteData(STLink_DeviceRequestT *pRq, const Brg_SpanT *pSpans, uint16_t Size,
+                                 uint8_t CdbIdx, uint8_t CdbDataMax)
+{
+	uint8_t spanIdx = 0;
+	uint16_t spanOffset = 0; // Offset of next byte in pSpans[spanIdx]
+	uint16_t cdbSize = (Size > CdbDataMax) ? CdbDataMax : Size;
+	uint16_t dataSize = Size - cdbSize;
+	uint16_t copySize;
+	uint32_t i;
+
+	// First bytes to transfer to target inside the cmd
+	for( i = 0; i < cdbSize; i++ ) {
+		while( spanOffset >= pSpans[spanIdx].SizeInBytes ) {
+			spanIdx++;
+			spanOffset = 0;
+		}
+		pRq->CDBByte[CdbIdx+i] = pSpans[spanIdx].pData[spanOffset++];
+	}
+
+	if( dataSize == 0 ) {
+		// All data are sent inside the cmd
+		// Just send the cmd (no data follows)
+		pRq->BufferLength = 0;
+		pRq->InputRequest = REQUEST_READ_1ST_EPIN;
+		pRq->Buffer = NULL;
+		return BRG_NO_ERR;
+	}
+
+	while( spanOffset >= pSpans[spanIdx].SizeInBytes ) {
+		spanIdx++;
+		spanOffset = 0;
+	}
+	pRq->BufferLength = dataSize;
+	pRq->InputRequest = REQUEST_WRITE_1ST_EPOUT;
+	if( (pSpans[spanIdx].SizeInBytes - spanOffset) >= dataSize ) {
+		// Remaining data in one span: no copy
+		pRq->Buffer = (void *)&pSpans[spanIdx].pData[spanOffset];
+		return BRG_NO_ERR;
+	}
+
+	// Remaining data spread over several spans: gather them in one buffer
+	if( m_gatherBufSize < dataSize ) {
+		if( m_pGatherBuf != NULL ) {
+			delete [] m_pGatherBuf;
+		}
+		m_gatherBufSize = 0;
+		m_pGatherBuf = new (std::nothrow) uint8_t[dataSize];
+		if( m_pGatherBuf == NULL ) {
+			return BRG_MEM_ALLOC_ERR;
+		}
+		m_gatherBufSize = dataSize;
+	}
+	for( i = 0; i < dataSize; i += copySize ) {
+		while( spanOffset >= pSpans[spanIdx].SizeInBytes ) {
+			spanIdx++;
+			spanOffset = 0;
+		}
+		copySize = pSpans[spanIdx].SizeInBytes - spanOffset;
+		if( copySize > (dataSize - i) ) {
+			copySize = (uint16_t)(dataSize - i);
+		}
+		memcpy(&m_pGatherBuf[i], &pSpans[spanIdx].pData[spanOffset], copySize);
+		spanOffset += copySize;
+	}
+	pRq->Buffer = m_pGatherBuf;
+	return BRG_NO_ERR;
+}
 
 // -------------------------------- GPIO ----------------------------------- //
 /*
@@ -2700,9 +3572,10 @@ uint8_t Brg::GpioConfField(Brg_GpioConfT GpioConfParam)
  */
 Brg_StatusT Brg::InitGPIO(const Brg_GpioInitT *pInitParams)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
-	uint16_t status;
+	uint16_t status = 0;
 	uint8_t gpioConf, i;
 
 	if( m_bStlinkConnected == false ) {
@@ -2717,7 +3590,6 @@ Brg_StatusT Brg::InitGPIO(const Brg_GpioInitT *pInitParams)
 		return BRG_PARAM_ERR;
 	}
 
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
@@ -2745,7 +3617,6 @@ Brg_StatusT Brg::InitGPIO(const Brg_GpioInitT *pInitParams)
 	pRq->SenseLength=DEFAULT_SENSE_LEN;
 
 	brgStat = SendRequestAndAnalyzeStatus(pRq, &status);
-	delete pRq;
 
 	return brgStat;
 }
@@ -2764,7 +3635,8 @@ Brg_StatusT Brg::InitGPIO(const Brg_GpioInitT *pInitParams)
  */
 Brg_StatusT Brg::ReadGPIO(uint8_t GpioMask, Brg_GpioValT *pGpioVal, uint8_t *pGpioErrorMask)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
 	uint8_t answer[8]={0,0,0,0,0,0,0,0};
 
@@ -2777,7 +3649,6 @@ Brg_StatusT Brg::ReadGPIO(uint8_t GpioMask, Brg_GpioValT *pGpioVal, uint8_t *pGp
 		return BRG_NO_STLINK;
 	}
 
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
@@ -2809,7 +3680,6 @@ Brg_StatusT Brg::ReadGPIO(uint8_t GpioMask, Brg_GpioValT *pGpioVal, uint8_t *pGp
 			}
 		}
 	}
-	delete pRq;
 
 	return brgStat;
 }
@@ -2828,7 +3698,8 @@ Brg_StatusT Brg::ReadGPIO(uint8_t GpioMask, Brg_GpioValT *pGpioVal, uint8_t *pGp
  */
 Brg_StatusT Brg::SetResetGPIO(uint8_t GpioMask, const Brg_GpioValT *pGpioVal, uint8_t *pGpioErrorMask)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	Brg_StatusT brgStat;
 	uint8_t answer[8]={0,0,0,0,0,0,0,0};
 
@@ -2841,7 +3712,6 @@ Brg_StatusT Brg::SetResetGPIO(uint8_t GpioMask, const Brg_GpioValT *pGpioVal, ui
 		return BRG_NO_STLINK;
 	}
 
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBLength = STLINK_BRIDGE_CMD_SIZE_16;
@@ -2873,8 +3743,6 @@ Brg_StatusT Brg::SetResetGPIO(uint8_t GpioMask, const Brg_GpioValT *pGpioVal, ui
 		brgStat = BRG_GPIO_ERR;
 	}
 
-	delete pRq;
-
 	return brgStat;
 }
 /**
@@ -2896,6 +3764,76 @@ Brg_StatusT Brg::GetTargetVoltage(float *pVoltage)
 	return ConvSTLinkIfToBrgStatus(ifStatus);
 }
 
+/**
+ * @ingroup DEVICE
+ * @brief This routine returns the USB latency statistics of a bridge command, recorded for every
+ * command sent to the STLink since the last Brg::ResetCmdStats() (status reads included,
+ * see #STLINK_BRIDGE_GET_RWCMD_STATUS).
+ * @param[in]  BrgCmd  Bridge command (e.g. #STLINK_BRIDGE_WRITE_SPI).
+ * @param[out] pStats  Command count, USB errors, bytes transferred and latency percentiles
+ *                     (all counters 0 if the command was not sent).
+ *
+ * @retval #BRG_PARAM_ERR If pStats is NULL
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT Brg::GetCmdStats(uint8_t BrgCmd, StlinkCmdStatsT *pStats)
+{
+	if( pStats == NULL ) {
+		return BRG_PARAM_ERR;
+	}
+
+	m_cmdStats.GetStats(STLINK_BRIDGE_COMMAND, BrgCmd, pStats);
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup DEVICE
+ * @brief This routine returns the USB latency statistics of all the commands sent to the STLink
+ * since the last Brg::ResetCmdStats(), in order of first use.
+ * @param[out] pStatsList  Array of MaxNb statistics.
+ * @param[in]  MaxNb       Size of pStatsList (at most #STLINK_CMD_STATS_MAX_CMD used).
+ *
+ * @return Number of commands filled in pStatsList
+ */
+uint32_t Brg::GetCmdStatsList(StlinkCmdStatsT *pStatsList, uint32_t MaxNb)
+{
+	if( pStatsList == NULL ) {
+		return 0;
+	}
+
+	return m_cmdStats.GetStatsList(pStatsList, MaxNb);
+}
+/**
+ * @ingroup DEVICE
+ * @brief This routine writes the USB latency statistics of all the commands sent to the STLink
+ * as a text table, one line per command (CDB bytes 0 and 1, counts, latencies in us, bytes).
+ * @param[out] pBuffer     Buffer receiving the '\0' terminated text (truncated if too small).
+ * @param[in]  BufferSize  Size of pBuffer.
+ *
+ * @return Number of characters written (without '\0')
+ */
+uint32_t Brg::DumpCmdStats(char *pBuffer, uint32_t BufferSize)
+{
+	return m_cmdStats.Dump(pBuffer, BufferSize);
+}
+/**
+ * @ingroup DEVICE
+ * @brief This routine clears the USB latency statistics of all the commands.
+ */
+void Brg::ResetCmdStats(void)
+{
+	m_cmdStats.Reset();
+}
+/**
+ * @ingroup DEVICE
+ * @brief This routine enables (default) or disables the USB latency statistics: while disabled the
+ * commands are neither timed nor recorded, the statistics already recorded are kept.
+ * @param[in]  bEnable  true to record the commands.
+ */
+void Brg::EnableCmdStats(bool bEnable)
+{
+	m_cmdStats.SetEnabled(bEnable);
+}
+
 /**
  * @ingroup CAN
  * @retval false If FW is too old for full CAN support.
@@ -63,7 +63,8 @@ typedef enum {
 	BRG_OVERRUN_ERR,          ///< Overrun error during bridge communication
 	BRG_CMD_BUSY,             ///< Command busy: only Brg::GetLastReadWriteStatus() command allowed in that case
 	BRG_CLOSE_ERR,            ///< Error during device Close
-	BRG_INTERFACE_ERR         ///< Unknown default error returned by STLinkInterface
+	BRG_INTERFACE_ERR,        ///< Unknown default error returned by STLinkInterface
+	BRG_FILE_ERR              ///< File creation, mapping or format error (BrgCanCaptureWriter, BrgCanCaptureReader)
 } Brg_StatusT;
 
 #define COM_SPI STLINK_SPI_COM   ///< 0x2 SPI Bridge communication parameter
@@ -73,6 +74,34 @@ typedef enum {
 #define COM_UNDEF_ALL 0xFF       ///< 0xFF All or Undefined Bridge communication parameter
 
 #define DEFAULT_CMD_TIMEOUT 0  ///< 0x0 Parameter to use default firmware timeout
+
+/// Read/Write status collection mode, see Brg::SetRwStatusMode()
+typedef enum {
+	RW_STATUS_IMMEDIATE = 0, ///< Default: status read after each SPI/I2C/CAN Read/Write command
+	RW_STATUS_DEFERRED = 1   ///< Status read once per batch of commands or at Brg::SyncRwStatus()
+} Brg_RwStatusModeT;
+
+/// Status of a window of deferred SPI/I2C/CAN Read/Write commands returned by Brg::SyncRwStatus().\n
+/// A window is made of the commands FirstOpId to OpId sent between two status reads. STLink firmware
+/// only keeps the status of its last Read/Write command, so the windows are built for an error to be
+/// tied to the failing command: an I2C or CAN command (which can fail on the bus) is a window of its own,
+/// a window of SPI commands (which only fail if SPI is not initialized) fails as a whole.
+typedef struct {
+	uint32_t FirstOpId;         ///< Id of the first command of the window
+	uint32_t OpId;              ///< Id of the last command of the window, the one the STLink status refers to
+	                            ///< (see Brg::GetLastRwOpId())
+	uint8_t  BrgCom;            ///< Communication of command OpId: #COM_SPI, #COM_I2C or #COM_CAN
+	uint16_t SizeInBytes;       ///< Size requested by command OpId
+	uint16_t BytesWithoutError; ///< In case of error, number of bytes transferred before the error
+	uint32_t ErrorInfo;         ///< Currently not significant
+} Brg_RwOpStatusT;
+
+/// Data span of the gather write routines (Brg::WriteSPI() and Brg::WriteI2C() with a span list):
+/// the spans are sent as one contiguous buffer (e.g. command/address header followed by payload).
+typedef struct {
+	const uint8_t *pData; ///< Data to write (can be NULL if SizeInBytes is 0)
+	uint16_t SizeInBytes; ///< Data size
+} Brg_SpanT;
 // end group doxygen GENERAL
 /** @} */
 // -------------------------------- SPI ------------------------------------ //
@@ -134,6 +163,13 @@ typedef enum {
 	SPI_NSS_NO_PULSE = 0, ///< SPI NSS not pulsed between each data
 	SPI_NSS_PULSE = 1 ///< SPI NSS pulse generated between 2 data
 } Brg_SpiNssPulseT;
+/// Chunk size of Brg::ReadSPIStream() and Brg::WriteSPIStream(): biggest multiple of the 512 bytes
+/// USB High Speed bulk packet that fits the 16bit size of the firmware SPI commands.\n
+/// Fixed rather than derived from the SPI clock: the cost of a chunk is one command and one status round
+/// trip (about 0.4 ms), less than 2% of its 21.7 ms transfer at the fastest SPI clock (24 MHz), so a
+/// smaller chunk never speeds up a stream; at the slowest clock (48 MHz input clock / 256, 187.5 KHz) a
+/// chunk lasts 2.8 s, within the 5 s default USB timeout of the commands.
+#define BRG_SPI_STREAM_CHUNK_SIZE 65024
 /// Brg::SetSPIpinCS() parameter: SPI NSS level for #SPI_NSS_SOFT case in master mode
 typedef enum {
 	SPI_NSS_LOW = 0, ///< Set SPI NSS low
@@ -231,6 +267,21 @@ typedef enum {
 	I2C_TRANS_R_ONGOING, // Partial read I2C transaction ongoing
 	I2C_TRANS_W_ONGOING // Partial write I2C transaction ongoing
 } Brg_I2cPartialTransT;
+
+// Private: Brg::GetI2cTiming() result kept to skip the timing calculation for the same parameters
+#define I2C_TIMING_CACHE_NB 8
+typedef struct {
+	bool bValid;
+	I2cModeT I2CSpeedMode;
+	int SpeedFrequency;
+	uint32_t I2cInputClkKHz;
+	int DNFn;
+	int RiseTime;
+	int FallTime;
+	bool bAF;
+	Brg_StatusT Status;
+	uint32_t TimingReg;
+} Brg_I2cTimingCacheT;
 // end group doxygen I2C
 /** @} */
 // -------------------------------- CAN ------------------------------------ //
@@ -333,6 +384,22 @@ typedef struct {
 	                    ///< (for data frame Size parameter of Brg::WriteMsgCAN() is used as DLC)
 } Brg_CanTxMsgT;
 
+/// Message type flags of a received CAN message, see #Brg_CanRxArraysT
+#define BRG_CAN_RX_FLAG_IDE     0x01 ///< Extended identifier
+#define BRG_CAN_RX_FLAG_RTR     0x02 ///< Remote frame
+#define BRG_CAN_RX_FLAG_FIFO1   0x04 ///< Received in FIFO1 (else FIFO0)
+#define BRG_CAN_RX_FLAG_OVERRUN 0x18 ///< Overrun before this message: 0x08 STLink CAN HW fifo overrun,
+                                     ///< 0x10 STLink CAN Rx buffer overrun
+
+/// Structure of arrays filled by Brg::GetRxMsgArraysCAN(), entry j for the message j
+typedef struct {
+	uint32_t *pId;   ///< MsgNb identifiers (11bit or 29bit according to #BRG_CAN_RX_FLAG_IDE)
+	uint8_t *pFlags; ///< MsgNb BRG_CAN_RX_FLAG_xxx combinations, or NULL
+	uint8_t *pDlc;   ///< MsgNb DLCs, or NULL
+	uint8_t *pData;  ///< MsgNb*8 bytes, payload of the message j at pData[8*j] (bytes after DLC and
+	                 ///< bytes of remote frames not significant), or NULL
+} Brg_CanRxArraysT;
+
 /// Filter mode \n
 /// In mask mode the identifier is associated with mask to specify which
 /// bits of the identifier are handled as "must match" or as "don't care".
@@ -467,6 +534,38 @@ typedef enum {
 	GPIO_SET = 1    ///< GPIO High level
 }Brg_GpioValT;
 /** @} */
+// -------------------------------- BATCH ---------------------------------- //
+/** @addtogroup BRIDGE
+ * @{
+ */
+/// Operation of Brg::ExecuteBatch()
+typedef enum {
+	BATCH_SPI_CS = 0,     ///< Brg::SetSPIpinCS(NssLevel)
+	BATCH_SPI_WRITE = 1,  ///< Brg::WriteSPI(pTxBuffer, SizeInBytes)
+	BATCH_SPI_READ = 2,   ///< Brg::ReadSPI(pRxBuffer, SizeInBytes)
+	BATCH_I2C_WRITE = 3,  ///< Brg::WriteI2C(pTxBuffer, Addr, SizeInBytes)
+	BATCH_I2C_READ = 4,   ///< Brg::ReadI2C(pRxBuffer, Addr, SizeInBytes)
+	BATCH_GPIO_SET = 5,   ///< Brg::SetResetGPIO(GpioMask, GpioVal)
+	BATCH_CAN_WRITE = 6   ///< Brg::WriteMsgCAN(&CanMsg, pTxBuffer, SizeInBytes)
+} Brg_BatchOpTypeT;
+
+/// Operation descriptor of Brg::ExecuteBatch(): only the fields used by OpType are significant.
+typedef struct {
+	Brg_BatchOpTypeT OpType;          ///< Operation
+	const uint8_t *pTxBuffer;         ///< Data to write (#BATCH_SPI_WRITE, #BATCH_I2C_WRITE, #BATCH_CAN_WRITE)
+	uint8_t *pRxBuffer;               ///< Buffer receiving the data read (#BATCH_SPI_READ, #BATCH_I2C_READ)
+	uint16_t SizeInBytes;             ///< Data size (min 1, #BATCH_CAN_WRITE: 0 to 8)
+	uint16_t Addr;                    ///< I2C slave address, use #I2C_10B_ADDR(Addr) for a 10bit address
+	Brg_SpiNssLevelT NssLevel;        ///< #BATCH_SPI_CS level
+	uint8_t GpioMask;                 ///< #BATCH_GPIO_SET mask, see #Brg_GpioMaskT
+	Brg_GpioValT GpioVal[BRG_GPIO_MAX_NB]; ///< #BATCH_GPIO_SET levels
+	Brg_CanTxMsgT CanMsg;             ///< #BATCH_CAN_WRITE message header
+	// Results
+	Brg_StatusT Status;               ///< Operation status, #BRG_COM_CMD_ORDER_ERR if not executed
+	uint16_t SizeDone;                ///< Bytes read/written without error
+	uint8_t GpioErrorMask;            ///< #BATCH_GPIO_SET error mask
+} Brg_BatchOpT;
+/** @} */
 // ------------------------------------------------------------------------- //
 /* Class -------------------------------------------------------------------- */
 /// Bridge Class
@@ -493,6 +592,22 @@ public:
 	Brg_StatusT GetTargetVoltage(float *pVoltage);
 
 	Brg_StatusT GetLastReadWriteStatus(uint16_t *pBytesWithoutError=NULL, uint32_t *pErrorInfo=NULL);
+	Brg_StatusT SetRwStatusMode(Brg_RwStatusModeT Mode, uint16_t BatchSize=0);
+	Brg_StatusT SyncRwStatus(Brg_RwOpStatusT *pOpStatus=NULL);
+	Brg_StatusT ExecuteBatch(Brg_BatchOpT *pOps, uint32_t OpNb, uint32_t *pOpDoneNb=NULL);
+	uint32_t GetLastRwOpId(void);
+	/**
+	 * @ingroup BRIDGE
+	 * @retval Read/Write status mode selected by Brg::SetRwStatusMode().
+	 */
+	Brg_RwStatusModeT GetRwStatusMode(void) const {
+		return m_rwStatusMode;
+	}
+	Brg_StatusT GetCmdStats(uint8_t BrgCmd, StlinkCmdStatsT *pStats);
+	uint32_t GetCmdStatsList(StlinkCmdStatsT *pStatsList, uint32_t MaxNb);
+	uint32_t DumpCmdStats(char *pBuffer, uint32_t BufferSize);
+	void ResetCmdStats(void);
+	void EnableCmdStats(bool bEnable);
 	Brg_StatusT CloseBridge(uint8_t BrgCom);
 	Brg_StatusT GetClk(uint8_t BrgCom, uint32_t *pBrgInputClk, uint32_t *pStlHClk);
 
@@ -501,6 +616,9 @@ public:
 	Brg_StatusT SetSPIpinCS(Brg_SpiNssLevelT NssLevel);
 	Brg_StatusT ReadSPI(uint8_t *pBuffer, uint16_t SizeInBytes, uint16_t *pSizeRead);
 	Brg_StatusT WriteSPI(const uint8_t *pBuffer, uint16_t SizeInBytes, uint16_t *pSizeWritten);
+	Brg_StatusT WriteSPI(const Brg_SpanT *pSpans, uint8_t SpanNb, uint16_t *pSizeWritten);
+	Brg_StatusT ReadSPIStream(uint8_t *pBuffer, uint64_t SizeInBytes, uint64_t *pSizeRead);
+	Brg_StatusT WriteSPIStream(const uint8_t *pBuffer, uint64_t SizeInBytes, uint64_t *pSizeWritten);
 
 	Brg_StatusT InitI2C(const Brg_I2cInitT *pInitParams);
 	Brg_StatusT GetI2cTiming(I2cModeT I2CSpeedMode, int SpeedFrequency, int DNFn, int RiseTime,
@@ -515,6 +633,11 @@ public:
 	                         uint16_t SizeInBytes, uint16_t *pSizeRead);
 	Brg_StatusT ContReadI2C(uint8_t *pBuffer, uint16_t SizeInBytes, uint16_t *pSizeRead);
 	Brg_StatusT StopReadI2C(uint8_t *pBuffer, uint16_t SizeInBytes, uint16_t *pSizeRead);
+	Brg_StatusT WriteReadI2C(uint16_t Addr, const uint8_t *pTxBuffer, uint16_t TxSizeInBytes,
+	                         uint8_t *pRxBuffer, uint16_t RxSizeInBytes, uint16_t *pSizeRead=NULL);
+	Brg_StatusT WriteReadI2C(uint16_t Addr, Brg_I2cAddrModeT AddrMode, const uint8_t *pTxBuffer,
+	                         uint16_t TxSizeInBytes, uint8_t *pRxBuffer, uint16_t RxSizeInBytes,
+	                         uint16_t *pSizeRead=NULL);
 	Brg_StatusT ReadNoWaitI2C(uint16_t Addr, uint16_t SizeInBytes,
 	                          uint16_t *pSizeRead, uint16_t CmdTimeoutMs);
 	Brg_StatusT ReadNoWaitI2C(uint16_t Addr, Brg_I2cAddrModeT AddrMode, uint16_t SizeInBytes,
@@ -524,6 +647,7 @@ public:
 	                     uint16_t SizeInBytes, uint16_t *pSizeWritten);
 	Brg_StatusT WriteI2C(const uint8_t *pBuffer, uint16_t Addr, Brg_I2cAddrModeT AddrMode,
 	                     uint16_t SizeInBytes, uint16_t *pSizeWritten);
+	Brg_StatusT WriteI2C(const Brg_SpanT *pSpans, uint8_t SpanNb, uint16_t Addr, uint16_t *pSizeWritten);
 	Brg_StatusT StartWriteI2C(const uint8_t *pBuffer, uint16_t Addr,
 	                          uint16_t SizeInBytes, uint16_t *pSizeWritten);
 	Brg_StatusT StartWriteI2C(const uint8_t *pBuffer, uint16_t Addr, Brg_I2cAddrModeT AddrMode,
@@ -540,6 +664,7 @@ public:
 	Brg_StatusT GetRxMsgNbCAN(uint16_t *pMsgNb);
 	Brg_StatusT GetRxMsgCAN(Brg_CanRxMsgT *pCanMsg, uint16_t MsgNb, uint8_t *pBuffer,
 	                        uint16_t BufSizeInBytes, uint16_t *pDataSizeInBytes);
+	Brg_StatusT GetRxMsgArraysCAN(uint16_t MsgNb, const Brg_CanRxArraysT *pArrays);
 	Brg_StatusT WriteMsgCAN(const Brg_CanTxMsgT *pCanMsg, const uint8_t *pBuffer, uint8_t SizeInBytes);
 
 	Brg_StatusT InitGPIO(const Brg_GpioInitT *pInitParams);
@@ -563,14 +688,55 @@ private:
 
 	Brg_StatusT WriteI2Ccmd(const uint8_t *pBuffer, uint16_t Addr, uint16_t Size,
 	                        Brg_I2cRWTransfer RwTransType, uint16_t *pSizeWritten, uint32_t *pErrorInfo);
+	Brg_StatusT WriteI2Ccmd(const Brg_SpanT *pSpans, uint16_t Size, uint16_t Addr,
+	                        Brg_I2cRWTransfer RwTransType, uint16_t *pSizeWritten, uint32_t *pErrorInfo);
+	Brg_StatusT WriteSPIcmd(const Brg_SpanT *pSpans, uint16_t Size, uint16_t *pSizeWritten);
+	static Brg_StatusT GetSpansSize(const Brg_SpanT *pSpans, uint8_t SpanNb, uint16_t *pSize);
+	Brg_StatusT GatherWriteData(STLink_DeviceRequestT *pRq, const Brg_SpanT *pSpans, uint16_t Size,
+	                            uint8_t CdbIdx, uint8_t CdbDataMax);
 	Brg_StatusT ReadI2Ccmd(uint8_t *pBuffer, uint16_t Addr, uint16_t SizeInBytes,
 	                       Brg_I2cRWTransfer RwTransType, uint16_t *pSizeRead, uint32_t *pErrorInfo);
+	Brg_StatusT SendReadI2Ccmd(uint8_t *pBuffer, uint16_t Addr, uint16_t SizeInBytes,
+	                           Brg_I2cRWTransfer RwTransType);
+	Brg_StatusT SendWriteI2Ccmd(const Brg_SpanT *pSpans, uint16_t Size, uint16_t Addr,
+	                            Brg_I2cRWTransfer RwTransType);
+
+	void RwStatusBeforeCmd(uint8_t BrgCom);
+	Brg_StatusT RwStatusAfterCmd(uint8_t BrgCom, uint16_t SizeInBytes,
+	                             uint16_t *pBytesWithoutError, uint32_t *pErrorInfo);
+	Brg_StatusT ReadRwWindowStatus(void);
+
+	Brg_StatusT CheckBatchOp(const Brg_BatchOpT *pOp) const;
+	Brg_StatusT ExecuteBatchOp(Brg_BatchOpT *pOp);
+
+	Brg_StatusT ReadRxMsgCAN(uint16_t MsgNb, const uint8_t **ppAnswer);
 
 	uint8_t GpioConfField(Brg_GpioConfT GpioConfParam);
 
 	// Global to manage I2C partial transaction (START, STOP, CONT)
 	uint16_t m_slaveAddrPartialI2cTrans;
 
+	// Deferred Read/Write status management (see SetRwStatusMode())
+	Brg_RwStatusModeT m_rwStatusMode;
+	uint16_t m_rwBatchSize;
+	uint16_t m_rwPendingNb;       // Commands of the current window (sent since the last status read)
+	Brg_RwOpStatusT m_rwLastOp;   // Last command sent
+	uint32_t m_rwSyncOpId;        // Id of the first command not yet covered by SyncRwStatus()
+	Brg_StatusT m_rwDeferredStat; // First failing window status since the last SyncRwStatus()
+	Brg_RwOpStatusT m_rwDeferredOp; // and its window (the failing command for I2C/CAN)
+
+	// GetRxMsgCAN()/GetRxMsgArraysCAN() answer buffer, grown on demand and reused to avoid an allocation per call
+	uint8_t *m_pCanRxAnswer;
+	uint32_t m_canRxAnswerSize;
+
+	// Write data stage gathered from several spans (see GatherWriteData()), grown on demand
+	uint8_t *m_pGatherBuf;
+	uint32_t m_gatherBufSize;
+
+	// GetI2cTiming() results (round robin replacement)
+	Brg_I2cTimingCacheT m_i2cTimingCache[I2C_TIMING_CACHE_NB];
+	uint32_t m_i2cTimingCacheNext;
+
 	Brg_StatusT CalculateI2cTimingReg(I2cModeT I2CSpeedMode, int SpeedFrequency, double ClockSource,
 	                                  int DNFn, int RiseTime, int FallTime, bool bAF, uint32_t *pTimingReg);
 	Brg_StatusT FormatFilter32bitCAN(const Brg_FilterBitsT *pInConf, uint8_t *pOutConf);
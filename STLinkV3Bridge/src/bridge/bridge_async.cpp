@@ -0,0 +1,560 @@
+/**
+  ******************************************************************************
+  * @file    bridge_async.cpp
+  * @author  MCD Application Team
+  * @brief   Asynchronous submission of Brg commands: in-order queue executed by
+  *          a per device worker thread (see BrgAsync).
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup ASYNC
+ * @{
+ * Usage:\n
+ *   BrgAsync brgAsync(brg);\n
+ *   Brg_AsyncOpT op;\n
+ *   brgAsync.Start();\n
+ *   brgAsync.SubmitWriteSPI(&op, dataOut, sizeof(dataOut));\n
+ *   ... processing overlapping the USB transfer ...\n
+ *   brgStat = brgAsync.Wait(&op);\n
+ *   brgAsync.Stop();
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_async.h"
+
+#include <chrono>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private defines -----------------------------------------------------------*/
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Global variables ----------------------------------------------------------*/
+/* Class Functions Definition ------------------------------------------------*/
+
+/**
+ * @ingroup ASYNC
+ * @brief BrgAsync constructor. Brg::OpenStlink() must be called on BrgDevice before
+ * submitting operations; BrgDevice must not be deleted before the BrgAsync.
+ */
+BrgAsync::BrgAsync(Brg &BrgDevice): m_brg(BrgDevice), m_bStarted(false), m_bStop(false),
+	m_pFirst(NULL), m_pLast(NULL), m_submitNb(0), m_doneNb(0), m_firstErrStat(BRG_NO_ERR)
+{
+	m_pStreamBuf[0] = NULL;
+	m_pStreamBuf[1] = NULL;
+}
+/**
+ * @ingroup ASYNC
+ * @brief BrgAsync destructor: execute the queued operations and stop the worker thread.
+ */
+BrgAsync::~BrgAsync(void)
+{
+	Stop();
+	delete [] m_pStreamBuf[0];
+	delete [] m_pStreamBuf[1];
+}
+/**
+ * @ingroup ASYNC
+ * @brief This routine starts the worker thread executing the submitted operations.
+ *
+ * @retval #BRG_NO_STLINK If Brg::OpenStlink() not called before
+ * @retval #BRG_NO_ERR If no error (or worker already started)
+ */
+Brg_StatusT BrgAsync::Start(void)
+{
+	if( m_brg.GetIsStlinkConnected() == false ) {
+		return BRG_NO_STLINK;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if( m_bStarted == false ) {
+		m_bStop = false;
+		m_submitNb = 0;
+		m_doneNb = 0;
+		m_firstErrStat = BRG_NO_ERR;
+		m_worker = std::thread(&BrgAsync::WorkerLoop, this);
+		m_bStarted = true;
+	}
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup ASYNC
+ * @brief This routine executes the operations already submitted, then stops the worker thread.
+ * It must not be called from a completion callback.
+ */
+void BrgAsync::Stop(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if( m_bStarted == false ) {
+			return;
+		}
+		m_bStop = true;
+	}
+	m_cvWork.notify_one();
+	m_worker.join();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_bStarted = false;
+}
+/**
+ * @ingroup ASYNC
+ * @brief This routine queues an asynchronous Brg::WriteSPI().
+ * @param[in]  pOp         Operation, owned by the caller until completion.
+ * @param[in]  pBuffer     Data to write, must stay valid until completion.
+ * @param[in]  SizeInBytes Data size.
+ * @param[in]  pCallback   Completion callback, NULL if not used.
+ * @param[in]  pUserData   Copied in pOp->pUserData.
+ *
+ * @retval #BRG_PARAM_ERR If pOp or pBuffer is NULL or SizeInBytes is 0
+ * @retval #BRG_COM_CMD_ORDER_ERR If BrgAsync::Start() not called before
+ * @retval #BRG_NO_ERR If operation queued, see Wait() for the command status
+ */
+Brg_StatusT BrgAsync::SubmitWriteSPI(Brg_AsyncOpT *pOp, const uint8_t *pBuffer, uint16_t SizeInBytes,
+                                     Brg_AsyncCallbackT pCallback, void *pUserData)
+{
+	if( (pOp == NULL) || (pBuffer == NULL) || (SizeInBytes == 0) ) {
+		return BRG_PARAM_ERR;
+	}
+	pOp->Cmd = BRG_ASYNC_WRITE_SPI;
+	pOp->pTxBuffer = pBuffer;
+	pOp->pRxBuffer = NULL;
+	pOp->SizeInBytes = SizeInBytes;
+	pOp->Addr = 0;
+	pOp->AddrMode = I2C_ADDR_7BIT;
+	pOp->pCallback = pCallback;
+	pOp->pUserData = pUserData;
+	return Submit(pOp);
+}
+/**
+ * @ingroup ASYNC
+ * @brief This routine queues an asynchronous Brg::ReadSPI().
+ * @param[in]  pOp         Operation, owned by the caller until completion.
+ * @param[out] pBuffer     Buffer receiving the data read, must stay valid until completion.
+ * @param[in]  SizeInBytes Data size.
+ * @param[in]  pCallback   Completion callback, NULL if not used.
+ * @param[in]  pUserData   Copied in pOp->pUserData.
+ *
+ * @retval #BRG_PARAM_ERR If pOp or pBuffer is NULL or SizeInBytes is 0
+ * @retval #BRG_COM_CMD_ORDER_ERR If BrgAsync::Start() not called before
+ * @retval #BRG_NO_ERR If operation queued, see Wait() for the command status
+ */
+Brg_StatusT BrgAsync::SubmitReadSPI(Brg_AsyncOpT *pOp, uint8_t *pBuffer, uint16_t SizeInBytes,
+                                    Brg_AsyncCallbackT pCallback, void *pUserData)
+{
+	if( (pOp == NULL) || (pBuffer == NULL) || (SizeInBytes == 0) ) {
+		return BRG_PARAM_ERR;
+	}
+	pOp->Cmd = BRG_ASYNC_READ_SPI;
+	pOp->pTxBuffer = NULL;
+	pOp->pRxBuffer = pBuffer;
+	pOp->SizeInBytes = SizeInBytes;
+	pOp->Addr = 0;
+	pOp->AddrMode = I2C_ADDR_7BIT;
+	pOp->pCallback = pCallback;
+	pOp->pUserData = pUserData;
+	return Submit(pOp);
+}
+/**
+ * @ingroup ASYNC
+ * @brief This routine queues an asynchronous Brg::WriteI2C().
+ * @param[in]  pOp         Operation, owned by the caller until completion.
+ * @param[in]  pBuffer     Data to write, must stay valid until completion.
+ * @param[in]  Addr        I2C slave address.
+ * @param[in]  AddrMode    I2C addressing mode.
+ * @param[in]  SizeInBytes Data size.
+ * @param[in]  pCallback   Completion callback, NULL if not used.
+ * @param[in]  pUserData   Copied in pOp->pUserData.
+ *
+ * @retval #BRG_PARAM_ERR If pOp or pBuffer is NULL or SizeInBytes is 0
+ * @retval #BRG_COM_CMD_ORDER_ERR If BrgAsync::Start() not called before
+ * @retval #BRG_NO_ERR If operation queued, see Wait() for the command status
+ */
+Brg_StatusT BrgAsync::SubmitWriteI2C(Brg_AsyncOpT *pOp, const uint8_t *pBuffer, uint16_t Addr,
+                                     Brg_I2cAddrModeT AddrMode, uint16_t SizeInBytes,
+                                     Brg_AsyncCallbackT pCallback, void *pUserData)
+{
+	if( (pOp == NULL) || (pBuffer == NULL) || (SizeInBytes == 0) ) {
+		return BRG_PARAM_ERR;
+	}
+	pOp->Cmd = BRG_ASYNC_WRITE_I2C;
+	pOp->pTxBuffer = pBuffer;
+	pOp->pRxBuffer = NULL;
+	pOp->SizeInBytes = SizeInBytes;
+	pOp->Addr = Addr;
+	pOp->AddrMode = AddrMode;
+	pOp->pCallback = pCallback;
+	pOp->pUserData = pUserData;
+	return Submit(pOp);
+}
+/**
+ * @ingroup ASYNC
+ * @brief This routine queues an asynchronous Brg::ReadI2C().
+ * @param[in]  pOp         Operation, owned by the caller until completion.
+ * @param[out] pBuffer     Buffer receiving the data read, must stay valid until completion.
+ * @param[in]  Addr        I2C slave address.
+ * @param[in]  AddrMode    I2C addressing mode.
+ * @param[in]  SizeInBytes Data size.
+ * @param[in]  pCallback   Completion callback, NULL if not used.
+ * @param[in]  pUserData   Copied in pOp->pUserData.
+ *
+ * @retval #BRG_PARAM_ERR If pOp or pBuffer is NULL or SizeInBytes is 0
+ * @retval #BRG_COM_CMD_ORDER_ERR If BrgAsync::Start() not called before
+ * @retval #BRG_NO_ERR If operation queued, see Wait() for the command status
+ */
+Brg_StatusT BrgAsync::SubmitReadI2C(Brg_AsyncOpT *pOp, uint8_t *pBuffer, uint16_t Addr,
+                                    Brg_I2cAddrModeT AddrMode, uint16_t SizeInBytes,
+                                    Brg_AsyncCallbackT pCallback, void *pUserData)
+{
+	if( (pOp == NULL) || (pBuffer == NULL) || (SizeInBytes == 0) ) {
+		return BRG_PARAM_ERR;
+	}
+	pOp->Cmd = BRG_ASYNC_READ_I2C;
+	pOp->pTxBuffer = NULL;
+	pOp->pRxBuffer = pBuffer;
+	pOp->SizeInBytes = SizeInBytes;
+	pOp->Addr = Addr;
+	pOp->AddrMode = AddrMode;
+	pOp->pCallback = pCallback;
+	pOp->pUserData = pUserData;
+	return Submit(pOp);
+}
+/**
+ * @ingroup ASYNC
+ * @brief This routine receives SizeInBytes bytes on the SPI interface (see Brg::ReadSPIStream()) with
+ * 2 chunk buffers: pCallback processes a chunk while the next one is transferred by the worker thread.
+ * Returns when the whole stream is transferred. Not to be called from a completion callback
+ * nor concurrently from several threads.
+ * @param[in]  SizeInBytes Data size to be read in bytes.
+ * @param[in]  pCallback   Called in order with each chunk read (max #BRG_SPI_STREAM_CHUNK_SIZE bytes).
+ * @param[in]  pUserData   Given to pCallback.
+ * @param[out] pSizeRead   If not NULL, number of bytes received without error (all given to pCallback).
+ *
+ * @retval #BRG_PARAM_ERR If pCallback is NULL
+ * @retval #BRG_MEM_ALLOC_ERR If chunk buffers allocation failed
+ * @retval #BRG_COM_CMD_ORDER_ERR If BrgAsync::Start() not called before
+ * @return Other errors: see Brg::ReadSPI()
+ */
+Brg_StatusT BrgAsync::ReadSPIStream(uint64_t SizeInBytes, Brg_StreamCallbackT pCallback, void *pUserData,
+                                    uint64_t *pSizeRead)
+{
+	Brg_StatusT brgStat;
+	Brg_StatusT opStat;
+	Brg_AsyncOpT ops[2];
+	uint64_t offset = 0, submitOffset = 0;
+	uint16_t chunkSize;
+	int idx, nbInFlight = 0;
+
+	if( pSizeRead != NULL ) {
+		*pSizeRead = 0;
+	}
+	if( pCallback == NULL ) {
+		return BRG_PARAM_ERR;
+	}
+	brgStat = AllocStreamBuffers();
+
+	// Start the transfer of the 2 first chunks
+	for( idx = 0; (idx < 2) && (submitOffset < SizeInBytes) && (brgStat == BRG_NO_ERR); idx++ ) {
+		chunkSize = StreamChunkSize(SizeInBytes - submitOffset);
+		brgStat = SubmitReadSPI(&ops[idx], m_pStreamBuf[idx], chunkSize);
+		if( brgStat == BRG_NO_ERR ) {
+			submitOffset += chunkSize;
+			nbInFlight++;
+		}
+	}
+	// Chunks complete in submission order: alternate between the 2 buffers
+	idx = 0;
+	while( nbInFlight > 0 ) {
+		opStat = Wait(&ops[idx]);
+		nbInFlight--;
+		if( brgStat != BRG_NO_ERR ) {
+			// Stream already failed: only wait for the chunk in flight
+		} else if( opStat != BRG_NO_ERR ) {
+			brgStat = opStat;
+			offset += ops[idx].SizeDone;
+		} else {
+			pCallback(m_pStreamBuf[idx], ops[idx].SizeInBytes, offset, pUserData);
+			offset += ops[idx].SizeInBytes;
+			if( submitOffset < SizeInBytes ) {
+				chunkSize = StreamChunkSize(SizeInBytes - submitOffset);
+				brgStat = SubmitReadSPI(&ops[idx], m_pStreamBuf[idx], chunkSize);
+				if( brgStat == BRG_NO_ERR ) {
+					submitOffset += chunkSize;
+					nbInFlight++;
+				}
+			}
+		}
+		idx ^= 1;
+	}
+	if( pSizeRead != NULL ) {
+		*pSizeRead = offset;
+	}
+	return brgStat;
+}
+/**
+ * @ingroup ASYNC
+ * @brief This routine transmits SizeInBytes bytes on the SPI interface (see Brg::WriteSPIStream()) with
+ * 2 chunk buffers: pCallback prepares a chunk while the previous one is transferred by the worker thread.
+ * Returns when the whole stream is transferred. Not to be called from a completion callback
+ * nor concurrently from several threads.
+ * @param[in]  SizeInBytes  Data size to be sent in bytes.
+ * @param[in]  pCallback    Called in order to fill each chunk to send (max #BRG_SPI_STREAM_CHUNK_SIZE bytes).
+ * @param[in]  pUserData    Given to pCallback.
+ * @param[out] pSizeWritten If not NULL, number of bytes transmitted without error.
+ *
+ * @retval #BRG_PARAM_ERR If pCallback is NULL
+ * @retval #BRG_MEM_ALLOC_ERR If chunk buffers allocation failed
+ * @retval #BRG_COM_CMD_ORDER_ERR If BrgAsync::Start() not called before
+ * @return Other errors: see Brg::WriteSPI()
+ */
+Brg_StatusT BrgAsync::WriteSPIStream(uint64_t SizeInBytes, Brg_StreamCallbackT pCallback, void *pUserData,
+                                     uint64_t *pSizeWritten)
+{
+	Brg_StatusT brgStat;
+	Brg_StatusT opStat;
+	Brg_AsyncOpT ops[2];
+	uint64_t offset = 0, submitOffset = 0;
+	uint16_t chunkSize;
+	int idx, nbInFlight = 0;
+
+	if( pSizeWritten != NULL ) {
+		*pSizeWritten = 0;
+	}
+	if( pCallback == NULL ) {
+		return BRG_PARAM_ERR;
+	}
+	brgStat = AllocStreamBuffers();
+
+	// Prepare the 2 first chunks, the 2nd one while the 1st is transferred
+	for( idx = 0; (idx < 2) && (submitOffset < SizeInBytes) && (brgStat == BRG_NO_ERR); idx++ ) {
+		chunkSize = StreamChunkSize(SizeInBytes - submitOffset);
+		pCallback(m_pStreamBuf[idx], chunkSize, submitOffset, pUserData);
+		brgStat = SubmitWriteSPI(&ops[idx], m_pStreamBuf[idx], chunkSize);
+		if( brgStat == BRG_NO_ERR ) {
+			submitOffset += chunkSize;
+			nbInFlight++;
+		}
+	}
+	// Chunks complete in submission order: alternate between the 2 buffers
+	idx = 0;
+	while( nbInFlight > 0 ) {
+		opStat = Wait(&ops[idx]);
+		nbInFlight--;
+		if( brgStat != BRG_NO_ERR ) {
+			// Stream already failed: only wait for the chunk in flight
+		} else if( opStat != BRG_NO_ERR ) {
+			brgStat = opStat;
+			offset += ops[idx].SizeDone;
+		} else {
+			offset += ops[idx].SizeInBytes;
+			if( submitOffset < SizeInBytes ) {
+				chunkSize = StreamChunkSize(SizeInBytes - submitOffset);
+				pCallback(m_pStreamBuf[idx], chunkSize, submitOffset, pUserData);
+				brgStat = SubmitWriteSPI(&ops[idx], m_pStreamBuf[idx], chunkSize);
+				if( brgStat == BRG_NO_ERR ) {
+					submitOffset += chunkSize;
+					nbInFlight++;
+				}
+			}
+		}
+		idx ^= 1;
+	}
+	if( pSizeWritten != NULL ) {
+		*pSizeWritten = offset;
+	}
+	return brgStat;
+}
+/**
+ * @ingroup ASYNC
+ * @brief This routine waits for the completion of a submitted operation.
+ * @param[in]  pOp       Operation given to a Submit...() routine.
+ * @param[in]  TimeoutMs Max wait duration, #BRG_ASYNC_WAIT_INFINITE to wait for ever.
+ *
+ * @return Status of the operation (see the corresponding Brg routine)
+ * @retval #BRG_PARAM_ERR If pOp is NULL
+ * @retval #BRG_TARGET_CMD_TIMEOUT If the operation is not completed after TimeoutMs
+ */
+Brg_StatusT BrgAsync::Wait(Brg_AsyncOpT *pOp, uint32_t TimeoutMs)
+{
+	if( pOp == NULL ) {
+		return BRG_PARAM_ERR;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if( TimeoutMs == BRG_ASYNC_WAIT_INFINITE ) {
+		m_cvDone.wait(lock, [pOp]{ return pOp->bDone; });
+	} else if( m_cvDone.wait_for(lock, std::chrono::milliseconds(TimeoutMs),
+	                             [pOp]{ return pOp->bDone; }) == false ) {
+		return BRG_TARGET_CMD_TIMEOUT;
+	}
+	return pOp->Status;
+}
+/**
+ * @ingroup ASYNC
+ * @param[in]  pOp Operation given to a Submit...() routine.
+ * @retval true if the operation is completed (result fields valid), false otherwise.
+ */
+bool BrgAsync::IsDone(Brg_AsyncOpT *pOp)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return pOp->bDone;
+}
+/**
+ * @ingroup ASYNC
+ * @brief This routine waits for the completion of all the submitted operations.
+ * It must not be called from a completion callback.
+ *
+ * @return First error of the operations completed since the previous Flush()
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgAsync::Flush(void)
+{
+	Brg_StatusT brgStat;
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_cvDone.wait(lock, [this]{ return m_doneNb == m_submitNb; });
+	brgStat = m_firstErrStat;
+	m_firstErrStat = BRG_NO_ERR;
+	return brgStat;
+}
+/**
+ * @brief Add an operation at the end of the queue.
+ */
+Brg_StatusT BrgAsync::Submit(Brg_AsyncOpT *pOp)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if( (m_bStarted == false) || (m_bStop == true) ) {
+			return BRG_COM_CMD_ORDER_ERR;
+		}
+		m_submitNb++;
+		pOp->OpId = m_submitNb;
+		pOp->Status = BRG_NO_ERR;
+		pOp->SizeDone = 0;
+		pOp->bDone = false;
+		pOp->pNext = NULL;
+		if( m_pLast == NULL ) {
+			m_pFirst = pOp;
+		} else {
+			m_pLast->pNext = pOp;
+		}
+		m_pLast = pOp;
+	}
+	m_cvWork.notify_one();
+	return BRG_NO_ERR;
+}
+/**
+ * @brief Execute an operation with the synchronous Brg API (worker thread).
+ */
+void BrgAsync::Execute(Brg_AsyncOpT *pOp)
+{
+	// Brg routines only set the size in case of error
+	uint16_t sizeDone = pOp->SizeInBytes;
+
+	switch( pOp->Cmd ) {
+		case BRG_ASYNC_WRITE_SPI:
+			pOp->Status = m_brg.WriteSPI(pOp->pTxBuffer, pOp->SizeInBytes, &sizeDone);
+			break;
+		case BRG_ASYNC_READ_SPI:
+			pOp->Status = m_brg.ReadSPI(pOp->pRxBuffer, pOp->SizeInBytes, &sizeDone);
+			break;
+		case BRG_ASYNC_WRITE_I2C:
+			pOp->Status = m_brg.WriteI2C(pOp->pTxBuffer, pOp->Addr, pOp->AddrMode,
+			                             pOp->SizeInBytes, &sizeDone);
+			break;
+		case BRG_ASYNC_READ_I2C:
+			pOp->Status = m_brg.ReadI2C(pOp->pRxBuffer, pOp->Addr, pOp->AddrMode,
+			                            pOp->SizeInBytes, &sizeDone);
+			break;
+		default:
+			pOp->Status = BRG_PARAM_ERR;
+			break;
+	}
+	pOp->SizeDone = sizeDone;
+}
+/**
+ * @brief Worker thread: execute the queued operations in submission order until Stop().
+ */
+void BrgAsync::WorkerLoop(void)
+{
+	Brg_AsyncOpT *pOp;
+	Brg_AsyncCallbackT pCallback;
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while( true ) {
+		m_cvWork.wait(lock, [this]{ return (m_pFirst != NULL) || m_bStop; });
+		if( m_pFirst == NULL ) {
+			// Stop requested and queue empty
+			break;
+		}
+		pOp = m_pFirst;
+		m_pFirst = pOp->pNext;
+		if( m_pFirst == NULL ) {
+			m_pLast = NULL;
+		}
+
+		// USB transfer without lock: the caller can submit or poll meanwhile
+		pCallback = pOp->pCallback;
+		lock.unlock();
+		Execute(pOp);
+		lock.lock();
+
+		if( (pOp->Status != BRG_NO_ERR) && (m_firstErrStat == BRG_NO_ERR) ) {
+			m_firstErrStat = pOp->Status;
+		}
+		pOp->bDone = true;
+		m_doneNb++;
+		m_cvDone.notify_all();
+
+		// Completion callback once the operation is completed (Wait(), Flush() and GetPendingNb() consistent
+		// with it), without lock: it may submit new operations
+		if( pCallback != NULL ) {
+			lock.unlock();
+			pCallback(pOp);
+			lock.lock();
+		}
+	}
+}
+/**
+ * @brief Allocate the stream chunk buffers at first use.
+ */
+Brg_StatusT BrgAsync::AllocStreamBuffers(void)
+{
+	for( int i = 0; i < 2; i++ ) {
+		if( m_pStreamBuf[i] == NULL ) {
+			m_pStreamBuf[i] = new uint8_t[BRG_SPI_STREAM_CHUNK_SIZE];
+			if( m_pStreamBuf[i] == NULL ) {
+				return BRG_MEM_ALLOC_ERR;
+			}
+		}
+	}
+	return BRG_NO_ERR;
+}
+/**
+ * @brief Size of the next stream chunk.
+ */
+uint16_t BrgAsync::StreamChunkSize(uint64_t RemainingSize)
+{
+	if( RemainingSize > BRG_SPI_STREAM_CHUNK_SIZE ) {
+		return BRG_SPI_STREAM_CHUNK_SIZE;
+	}
+	return (uint16_t)RemainingSize;
+}
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
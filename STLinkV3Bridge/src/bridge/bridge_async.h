@@ -0,0 +1,160 @@
+/**
+  ******************************************************************************
+  * @file    bridge_async.h
+  * @author  MCD Application Team
+  * @brief   Header for bridge_async.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup ASYNC
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BRIDGE_ASYNC_H
+#define _BRIDGE_ASYNC_H
+/* Includes ------------------------------------------------------------------*/
+#include "bridge.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/* Exported types and constants ----------------------------------------------*/
+/// BrgAsync::Wait() timeout value waiting for ever
+#define BRG_ASYNC_WAIT_INFINITE 0xFFFFFFFF
+
+/// Command of an asynchronous operation
+typedef enum {
+	BRG_ASYNC_WRITE_SPI = 0, ///< Brg::WriteSPI()
+	BRG_ASYNC_READ_SPI = 1,  ///< Brg::ReadSPI()
+	BRG_ASYNC_WRITE_I2C = 2, ///< Brg::WriteI2C()
+	BRG_ASYNC_READ_I2C = 3   ///< Brg::ReadI2C()
+} Brg_AsyncCmdT;
+
+typedef struct Brg_AsyncOp Brg_AsyncOpT;
+
+/// Completion callback, called from the BrgAsync worker thread once the operation is completed (result set,
+/// BrgAsync::Wait() of the operation may already have returned).\n
+/// It may submit new operations (not pOp itself) but must not wait for an operation of the same BrgAsync.
+typedef void (*Brg_AsyncCallbackT)(Brg_AsyncOpT *pOp);
+
+/// Chunk callback of BrgAsync::ReadSPIStream() (pChunk holds the data read) and BrgAsync::WriteSPIStream()
+/// (pChunk to be filled with the data to send), called in the caller thread while the other chunk is
+/// transferred. Offset is the position of the chunk in the stream.
+typedef void (*Brg_StreamCallbackT)(uint8_t *pChunk, uint16_t ChunkSize, uint64_t Offset, void *pUserData);
+
+/// Asynchronous operation, allocated by the caller and given to a BrgAsync::Submit...() routine.\n
+/// The operation and its data buffer must stay valid until the operation is completed (BrgAsync::Wait()
+/// returned) and, if it has a completion callback, until the callback returned.
+struct Brg_AsyncOp {
+	// Request, set by BrgAsync::Submit...()
+	Brg_AsyncCmdT Cmd;            ///< Command
+	const uint8_t *pTxBuffer;     ///< Data to write (write commands)
+	uint8_t *pRxBuffer;           ///< Buffer receiving the data read (read commands)
+	uint16_t SizeInBytes;         ///< Data size
+	uint16_t Addr;                ///< I2C slave address
+	Brg_I2cAddrModeT AddrMode;    ///< I2C addressing mode
+	Brg_AsyncCallbackT pCallback; ///< Completion callback (NULL if none)
+	void *pUserData;              ///< Free for the caller (e.g. context of the callback)
+	// Result, valid once the operation is completed
+	uint32_t OpId;                ///< Submission order number (1 for the first operation of a BrgAsync)
+	Brg_StatusT Status;           ///< Status returned by the Brg routine
+	uint16_t SizeDone;            ///< Bytes read/written without error
+	// Private to BrgAsync
+	bool bDone;
+	Brg_AsyncOpT *pNext;
+};
+
+/* Class -------------------------------------------------------------------- */
+/// BrgAsync Class: asynchronous submission of Brg commands.\n
+/// Operations are queued and executed in submission order by a worker thread owned by the BrgAsync,
+/// so that the caller can run other processing during the USB transfers. Only one BrgAsync should be
+/// used per Brg; synchronous Brg calls from other threads remain possible but are interleaved
+/// with the queued operations.
+class BrgAsync
+{
+public:
+
+	BrgAsync(Brg &BrgDevice);
+
+	virtual ~BrgAsync(void);
+
+	Brg_StatusT Start(void);
+	void Stop(void);
+
+	Brg_StatusT SubmitWriteSPI(Brg_AsyncOpT *pOp, const uint8_t *pBuffer, uint16_t SizeInBytes,
+	                           Brg_AsyncCallbackT pCallback=NULL, void *pUserData=NULL);
+	Brg_StatusT SubmitReadSPI(Brg_AsyncOpT *pOp, uint8_t *pBuffer, uint16_t SizeInBytes,
+	                          Brg_AsyncCallbackT pCallback=NULL, void *pUserData=NULL);
+	Brg_StatusT SubmitWriteI2C(Brg_AsyncOpT *pOp, const uint8_t *pBuffer, uint16_t Addr,
+	                           Brg_I2cAddrModeT AddrMode, uint16_t SizeInBytes,
+	                           Brg_AsyncCallbackT pCallback=NULL, void *pUserData=NULL);
+	Brg_StatusT SubmitReadI2C(Brg_AsyncOpT *pOp, uint8_t *pBuffer, uint16_t Addr,
+	                          Brg_I2cAddrModeT AddrMode, uint16_t SizeInBytes,
+	                          Brg_AsyncCallbackT pCallback=NULL, void *pUserData=NULL);
+
+	Brg_StatusT ReadSPIStream(uint64_t SizeInBytes, Brg_StreamCallbackT pCallback, void *pUserData,
+	                          uint64_t *pSizeRead=NULL);
+	Brg_StatusT WriteSPIStream(uint64_t SizeInBytes, Brg_StreamCallbackT pCallback, void *pUserData,
+	                           uint64_t *pSizeWritten=NULL);
+
+	Brg_StatusT Wait(Brg_AsyncOpT *pOp, uint32_t TimeoutMs=BRG_ASYNC_WAIT_INFINITE);
+	bool IsDone(Brg_AsyncOpT *pOp);
+	Brg_StatusT Flush(void);
+
+	/**
+	 * @retval Number of submitted operations not yet completed.
+	 */
+	uint32_t GetPendingNb(void) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_submitNb - m_doneNb;
+	}
+
+private:
+
+	Brg_StatusT Submit(Brg_AsyncOpT *pOp);
+
+	void Execute(Brg_AsyncOpT *pOp);
+
+	void WorkerLoop(void);
+
+	Brg_StatusT AllocStreamBuffers(void);
+
+	static uint16_t StreamChunkSize(uint64_t RemainingSize);
+
+	Brg &m_brg;
+
+	std::thread m_worker;
+	bool m_bStarted;
+	bool m_bStop;
+
+	// Intrusive FIFO of the operations not yet executed
+	Brg_AsyncOpT *m_pFirst;
+	Brg_AsyncOpT *m_pLast;
+
+	uint32_t m_submitNb;        // Operations submitted since Start()
+	uint32_t m_doneNb;          // Operations completed since Start()
+	Brg_StatusT m_firstErrStat; // First error since the last Flush()
+
+	// Chunk buffers of ReadSPIStream()/WriteSPIStream(), allocated at first use
+	uint8_t *m_pStreamBuf[2];
+
+	// Protect all the above fields and the bDone field of the operations
+	std::mutex m_mutex;
+	std::condition_variable m_cvWork; // Worker wake up: new operation or stop request
+	std::condition_variable m_cvDone; // Operation completed
+};
+
+#endif //_BRIDGE_ASYNC_H
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
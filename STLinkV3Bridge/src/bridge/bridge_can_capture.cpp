@@ -0,0 +1,1032 @@
+/**
+  ******************************************************************************
+  * @file    bridge_can_capture.cpp
+  * @author  MCD Application Team
+  * @brief   Compact binary CAN capture files: memory-mapped writer with
+  *          delta-encoded timestamps and IDs and a seek index, reader and
+  *          candump/ASC text converters (see BrgCanCaptureWriter).
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup CAN
+ * @{
+ * Usage:\n
+ *   receiver.Start();\n
+ *   writer.Open("bus.brgcan", BrgCanReceiver::GetTimeNs());\n
+ *   while( bRun == true ) {\n
+ *     while( receiver.PopFrame(&frame) == true ) {\n
+ *       writer.Write(&frame);\n
+ *     }\n
+ *     ...\n
+ *   }\n
+ *   writer.Close();\n
+ *   reader.Open("bus.brgcan");\n
+ *   reader.ExportCandump("bus.log", "can0");
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_can_capture.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private defines -----------------------------------------------------------*/
+// Header fields offsets
+#define CAN_CAPTURE_HDR_MAGIC          0
+#define CAN_CAPTURE_HDR_VERSION        8
+#define CAN_CAPTURE_HDR_HEADER_SIZE    10
+#define CAN_CAPTURE_HDR_TIME_UNIT      12
+#define CAN_CAPTURE_HDR_START_NS       16
+#define CAN_CAPTURE_HDR_START_WALL_NS  24
+#define CAN_CAPTURE_HDR_INDEX_INTERVAL 32
+#define CAN_CAPTURE_HDR_INDEX_NB       36
+#define CAN_CAPTURE_HDR_FRAME_NB       40
+#define CAN_CAPTURE_HDR_DATA_END       48
+#define CAN_CAPTURE_HDR_INDEX_OFFSET   56
+
+// Record tag byte
+#define CAN_CAPTURE_TAG_DLC_MASK 0x0F
+#define CAN_CAPTURE_TAG_IDE      0x10
+#define CAN_CAPTURE_TAG_RTR      0x20
+#define CAN_CAPTURE_TAG_FIFO1    0x40
+#define CAN_CAPTURE_TAG_OVERRUN  0x80
+
+#define CAN_CAPTURE_ID_MASK 0x1FFFFFFF
+#define CAN_CAPTURE_INDEX_INIT_NB 256
+
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static const char s_canCaptureMagic[8] = {'S', 'T', 'B', 'R', 'G', 'C', 'A', 'N'};
+
+/* Global variables ----------------------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+static void PutLe(uint8_t *pDst, uint64_t Value, uint8_t SizeInBytes)
+{
+	for( uint8_t i=0; i<SizeInBytes; i++ ) {
+		pDst[i] = (uint8_t)(Value>>(8*i));
+	}
+}
+static uint64_t GetLe(const uint8_t *pSrc, uint8_t SizeInBytes)
+{
+	uint64_t value = 0;
+	for( uint8_t i=0; i<SizeInBytes; i++ ) {
+		value |= (uint64_t)pSrc[i]<<(8*i);
+	}
+	return value;
+}
+// LEB128: 7 bits per byte, bit 7 set if more bytes follow. Returns the number of bytes written.
+static uint32_t PutVarint(uint8_t *pDst, uint64_t Value)
+{
+	uint32_t size = 0;
+	while( Value >= 0x80 ) {
+		pDst[size++] = (uint8_t)(Value | 0x80);
+		Value >>= 7;
+	}
+	pDst[size++] = (uint8_t)Value;
+	return size;
+}
+// Returns false if the varint does not end before pEnd (or is longer than 64 bits).
+static bool GetVarint(const uint8_t **ppSrc, const uint8_t *pEnd, uint64_t *pValue)
+{
+	const uint8_t *pSrc = *ppSrc;
+	uint64_t value = 0;
+	uint8_t shift = 0;
+
+	while( (pSrc < pEnd) && (shift < 64) ) {
+		value |= (uint64_t)(*pSrc & 0x7F)<<shift;
+		if( (*pSrc++ & 0x80) == 0 ) {
+			*ppSrc = pSrc;
+			*pValue = value;
+			return true;
+		}
+		shift += 7;
+	}
+	return false;
+}
+
+/* Class Functions Definition ------------------------------------------------*/
+
+/**
+ * @ingroup CAN
+ * @brief BrgMappedFile constructor.
+ */
+BrgMappedFile::BrgMappedFile(void): m_bWrite(false), m_pData(NULL), m_size(0),
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	m_hFile(NULL), m_hMapping(NULL)
+#else
+	m_fd(-1)
+#endif
+{
+}
+/**
+ * @ingroup CAN
+ * @brief BrgMappedFile destructor: closes the file (without truncation).
+ */
+BrgMappedFile::~BrgMappedFile(void)
+{
+	Unmap();
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	if( m_hFile != NULL ) {
+		CloseHandle((HANDLE)m_hFile);
+	}
+#else
+	if( m_fd >= 0 ) {
+		close(m_fd);
+	}
+#endif
+}
+/**
+ * @ingroup CAN
+ * @brief This routine creates (or truncates) a file, extends it to SizeInBytes and maps it for writing.
+ * @param[in]  pPath        File path.
+ * @param[in]  SizeInBytes  Initial size, not 0.
+ *
+ * @retval #BRG_PARAM_ERR If a file is already opened or SizeInBytes is 0
+ * @retval #BRG_FILE_ERR If the file cannot be created, extended or mapped
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgMappedFile::Create(const char *pPath, uint64_t SizeInBytes)
+{
+	Brg_StatusT brgStat;
+
+	if( (pPath == NULL) || (SizeInBytes == 0) || (m_pData != NULL) ) {
+		return BRG_PARAM_ERR;
+	}
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	HANDLE hFile = CreateFileA(pPath, GENERIC_READ|GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+	                           FILE_ATTRIBUTE_NORMAL, NULL);
+	if( hFile == INVALID_HANDLE_VALUE ) {
+		return BRG_FILE_ERR;
+	}
+	m_hFile = (void*)hFile;
+#else
+	m_fd = open(pPath, O_RDWR|O_CREAT|O_TRUNC, 0644);
+	if( m_fd < 0 ) {
+		return BRG_FILE_ERR;
+	}
+#endif
+	m_bWrite = true;
+	m_size = SizeInBytes;
+	brgStat = Map();
+	if( brgStat != BRG_NO_ERR ) {
+		Close();
+	}
+	return brgStat;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine opens an existing file and maps it for reading.
+ * @param[in]  pPath  File path.
+ *
+ * @retval #BRG_PARAM_ERR If a file is already opened
+ * @retval #BRG_FILE_ERR If the file cannot be opened or mapped, or is empty
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgMappedFile::OpenRead(const char *pPath)
+{
+	Brg_StatusT brgStat;
+
+	if( (pPath == NULL) || (m_pData != NULL) ) {
+		return BRG_PARAM_ERR;
+	}
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	LARGE_INTEGER fileSize;
+	HANDLE hFile = CreateFileA(pPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+	                           FILE_ATTRIBUTE_NORMAL, NULL);
+	if( hFile == INVALID_HANDLE_VALUE ) {
+		return BRG_FILE_ERR;
+	}
+	m_hFile = (void*)hFile;
+	if( GetFileSizeEx(hFile, &fileSize) == 0 ) {
+		Close();
+		return BRG_FILE_ERR;
+	}
+	m_size = (uint64_t)fileSize.QuadPart;
+#else
+	struct stat fileStat;
+	m_fd = open(pPath, O_RDONLY);
+	if( m_fd < 0 ) {
+		return BRG_FILE_ERR;
+	}
+	if( fstat(m_fd, &fileStat) != 0 ) {
+		Close();
+		return BRG_FILE_ERR;
+	}
+	m_size = (uint64_t)fileStat.st_size;
+#endif
+	m_bWrite = false;
+	if( m_size == 0 ) {
+		Close();
+		return BRG_FILE_ERR;
+	}
+	brgStat = Map();
+	if( brgStat != BRG_NO_ERR ) {
+		Close();
+	}
+	return brgStat;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine extends a file created with Create() and remaps it: GetData() changes.
+ * @param[in]  SizeInBytes  New size, greater than GetSize().
+ *
+ * @retval #BRG_PARAM_ERR If the file is not opened for writing or SizeInBytes is not greater
+ * @retval #BRG_FILE_ERR If the file cannot be extended or mapped (the file is then closed)
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgMappedFile::Grow(uint64_t SizeInBytes)
+{
+	Brg_StatusT brgStat;
+
+	if( (m_pData == NULL) || (m_bWrite == false) || (SizeInBytes <= m_size) ) {
+		return BRG_PARAM_ERR;
+	}
+	Unmap();
+	m_size = SizeInBytes;
+	brgStat = Map();
+	if( brgStat != BRG_NO_ERR ) {
+		Close();
+	}
+	return brgStat;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine unmaps and closes the file.
+ * @param[in]  FinalSize  File size after closure for a file created with Create(), 0 to keep the
+ *             mapped size.
+ */
+void BrgMappedFile::Close(uint64_t FinalSize)
+{
+	Unmap();
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	if( m_hFile != NULL ) {
+		if( (m_bWrite == true) && (FinalSize != 0) ) {
+			LARGE_INTEGER pos;
+			pos.QuadPart = (LONGLONG)FinalSize;
+			if( SetFilePointerEx((HANDLE)m_hFile, pos, NULL, FILE_BEGIN) != 0 ) {
+				SetEndOfFile((HANDLE)m_hFile);
+			}
+		}
+		CloseHandle((HANDLE)m_hFile);
+		m_hFile = NULL;
+	}
+#else
+	if( m_fd >= 0 ) {
+		if( (m_bWrite == true) && (FinalSize != 0) ) {
+			if( ftruncate(m_fd, (off_t)FinalSize) != 0 ) {
+				// keep the preallocated size: the header gives the used size
+			}
+		}
+		close(m_fd);
+		m_fd = -1;
+	}
+#endif
+	m_size = 0;
+}
+/*
+ * private: extends the file to m_size when opened for writing and maps it
+ */
+Brg_StatusT BrgMappedFile::Map(void)
+{
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	// The mapping object extends the file to its size
+	HANDLE hMapping = CreateFileMappingA((HANDLE)m_hFile, NULL, (m_bWrite == true) ? PAGE_READWRITE : PAGE_READONLY,
+	                                     (DWORD)(m_size>>32), (DWORD)m_size, NULL);
+	if( hMapping == NULL ) {
+		return BRG_FILE_ERR;
+	}
+	m_hMapping = (void*)hMapping;
+	m_pData = (uint8_t*)MapViewOfFile(hMapping, (m_bWrite == true) ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0,
+	                                  (SIZE_T)m_size);
+	if( m_pData == NULL ) {
+		CloseHandle(hMapping);
+		m_hMapping = NULL;
+		return BRG_FILE_ERR;
+	}
+#else
+	void *pMap;
+	if( m_bWrite == true ) {
+#ifdef __linux__
+		// Allocate the blocks now: a full disk would raise SIGBUS on a write to a sparse mapping
+		if( posix_fallocate(m_fd, 0, (off_t)m_size) != 0 ) {
+#else
+		if( ftruncate(m_fd, (off_t)m_size) != 0 ) {
+#endif
+			return BRG_FILE_ERR;
+		}
+	}
+	pMap = mmap(NULL, (size_t)m_size, (m_bWrite == true) ? (PROT_READ|PROT_WRITE) : PROT_READ, MAP_SHARED,
+	            m_fd, 0);
+	if( pMap == MAP_FAILED ) {
+		return BRG_FILE_ERR;
+	}
+	m_pData = (uint8_t*)pMap;
+#endif
+	return BRG_NO_ERR;
+}
+/*
+ * private: unmaps the file (modified pages are written back by the system)
+ */
+void BrgMappedFile::Unmap(void)
+{
+	if( m_pData == NULL ) {
+		return;
+	}
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	UnmapViewOfFile(m_pData);
+	CloseHandle((HANDLE)m_hMapping);
+	m_hMapping = NULL;
+#else
+	munmap(m_pData, (size_t)m_size);
+#endif
+	m_pData = NULL;
+}
+
+/**
+ * @ingroup CAN
+ * @brief BrgCanCaptureWriter constructor.
+ */
+BrgCanCaptureWriter::BrgCanCaptureWriter(void): m_bOpened(false), m_startNs(0), m_offset(0), m_frameNb(0),
+	m_prevUnits(0), m_prevId(0), m_pIndex(NULL), m_indexNb(0), m_indexMax(0)
+{
+	GetDefaultConf(&m_conf);
+}
+/**
+ * @ingroup CAN
+ * @brief BrgCanCaptureWriter destructor: closes the file (see Close()).
+ */
+BrgCanCaptureWriter::~BrgCanCaptureWriter(void)
+{
+	Close();
+	delete [] m_pIndex;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine fills a #Brg_CanCaptureConfT with the default values (BRG_CAN_CAPTURE_xxx_DEFAULT).
+ * @param[out] pConf  Parameters.
+ */
+void BrgCanCaptureWriter::GetDefaultConf(Brg_CanCaptureConfT *pConf)
+{
+	if( pConf == NULL ) {
+		return;
+	}
+	pConf->TimeUnitNs = BRG_CAN_CAPTURE_TIME_UNIT_NS_DEFAULT;
+	pConf->IndexInterval = BRG_CAN_CAPTURE_INDEX_INTERVAL_DEFAULT;
+	pConf->GrowSize = BRG_CAN_CAPTURE_GROW_SIZE_DEFAULT;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine creates a capture file (an existing file is overwritten) and preallocates GrowSize bytes.
+ * @param[in]  pPath    File path.
+ * @param[in]  StartNs  Time origin of the capture, on the clock of the frame timestamps
+ *                      (BrgCanReceiver::GetTimeNs()): earlier frames are recorded at StartNs.
+ * @param[in]  pConf    Parameters, NULL for the default ones (see GetDefaultConf()).
+ *
+ * @retval #BRG_PARAM_ERR If a parameter is not supported (0 value, GrowSize lower than a header and a record)
+ *         or the writer is already opened
+ * @retval #BRG_MEM_ALLOC_ERR If the index cannot be allocated
+ * @retval #BRG_FILE_ERR If the file cannot be created or mapped
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanCaptureWriter::Open(const char *pPath, uint64_t StartNs, const Brg_CanCaptureConfT *pConf)
+{
+	Brg_CanCaptureConfT conf;
+	Brg_StatusT brgStat;
+	uint64_t steadyNs, wallNs;
+	uint8_t *pHeader;
+
+	if( pConf == NULL ) {
+		GetDefaultConf(&conf);
+	} else {
+		conf = *pConf;
+	}
+	if( (m_bOpened == true) || (conf.TimeUnitNs == 0) || (conf.IndexInterval == 0) ||
+	    (conf.GrowSize < BRG_CAN_CAPTURE_HEADER_SIZE+BRG_CAN_CAPTURE_RECORD_MAX) ) {
+		return BRG_PARAM_ERR;
+	}
+	if( m_pIndex == NULL ) {
+		m_pIndex = new uint8_t[CAN_CAPTURE_INDEX_INIT_NB*BRG_CAN_CAPTURE_INDEX_ENTRY_SIZE];
+		if( m_pIndex == NULL ) {
+			return BRG_MEM_ALLOC_ERR;
+		}
+		m_indexMax = CAN_CAPTURE_INDEX_INIT_NB;
+	}
+	brgStat = m_file.Create(pPath, conf.GrowSize);
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+
+	// Wall clock time of StartNs, from the current time of both clocks
+	steadyNs = BrgCanReceiver::GetTimeNs();
+	wallNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+	             std::chrono::system_clock::now().time_since_epoch()).count();
+	if( steadyNs >= StartNs ) {
+		wallNs -= steadyNs - StartNs;
+	} else {
+		wallNs += StartNs - steadyNs;
+	}
+
+	m_conf = conf;
+	m_startNs = StartNs;
+	m_offset = BRG_CAN_CAPTURE_HEADER_SIZE;
+	m_frameNb = 0;
+	m_prevUnits = 0;
+	m_prevId = 0;
+	m_indexNb = 0;
+
+	pHeader = m_file.GetData();
+	memset(pHeader, 0, BRG_CAN_CAPTURE_HEADER_SIZE);
+	memcpy(&pHeader[CAN_CAPTURE_HDR_MAGIC], s_canCaptureMagic, sizeof(s_canCaptureMagic));
+	PutLe(&pHeader[CAN_CAPTURE_HDR_VERSION], BRG_CAN_CAPTURE_VERSION, 2);
+	PutLe(&pHeader[CAN_CAPTURE_HDR_HEADER_SIZE], BRG_CAN_CAPTURE_HEADER_SIZE, 2);
+	PutLe(&pHeader[CAN_CAPTURE_HDR_TIME_UNIT], m_conf.TimeUnitNs, 4);
+	PutLe(&pHeader[CAN_CAPTURE_HDR_START_NS], StartNs, 8);
+	PutLe(&pHeader[CAN_CAPTURE_HDR_START_WALL_NS], wallNs, 8);
+	PutLe(&pHeader[CAN_CAPTURE_HDR_INDEX_INTERVAL], m_conf.IndexInterval, 4);
+	UpdateHeader();
+	m_bOpened = true;
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine appends a frame to the capture file.
+ * @param[in]  TimestampNs  Frame time, same clock as the StartNs given to Open().
+ * @param[in]  pMsg         Message header (Brg::GetRxMsgCAN() format).
+ * @param[in]  pData        pMsg->DLC data bytes (max 8), unused for a remote frame.
+ *
+ * @retval #BRG_COM_CMD_ORDER_ERR If Open() not called before
+ * @retval #BRG_PARAM_ERR If a parameter is NULL
+ * @retval #BRG_MEM_ALLOC_ERR If the index cannot grow
+ * @retval #BRG_FILE_ERR If the file cannot grow (the file is then closed)
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanCaptureWriter::Write(uint64_t TimestampNs, const Brg_CanRxMsgT *pMsg, const uint8_t *pData)
+{
+	Brg_StatusT brgStat;
+	uint8_t *pRecord;
+	uint64_t units, timeRef;
+	uint32_t id, idRef, dataSize, size;
+	int32_t idDiff;
+	uint8_t tag;
+
+	if( m_bOpened == false ) {
+		return BRG_COM_CMD_ORDER_ERR;
+	}
+	if( (pMsg == NULL) || ((pData == NULL) && (pMsg->RTR == CAN_DATA_FRAME) && (pMsg->DLC != 0)) ) {
+		return BRG_PARAM_ERR;
+	}
+	if( (m_offset+BRG_CAN_CAPTURE_RECORD_MAX) > m_file.GetSize() ) {
+		brgStat = Reserve(BRG_CAN_CAPTURE_RECORD_MAX);
+		if( brgStat != BRG_NO_ERR ) {
+			return brgStat;
+		}
+	}
+
+	units = 0;
+	if( TimestampNs > m_startNs ) {
+		units = (TimestampNs-m_startNs)/m_conf.TimeUnitNs;
+	}
+	if( units < m_prevUnits ) {
+		units = m_prevUnits;
+	}
+	// The first frame of a block is encoded relative to the capture start and ID 0
+	timeRef = m_prevUnits;
+	idRef = m_prevId;
+	if( (m_frameNb%m_conf.IndexInterval) == 0 ) {
+		brgStat = StartBlock(units);
+		if( brgStat != BRG_NO_ERR ) {
+			return brgStat;
+		}
+		timeRef = 0;
+		idRef = 0;
+	}
+
+	id = pMsg->ID & CAN_CAPTURE_ID_MASK;
+	tag = pMsg->DLC & CAN_CAPTURE_TAG_DLC_MASK;
+	if( pMsg->IDE == CAN_ID_EXTENDED ) {
+		tag |= CAN_CAPTURE_TAG_IDE;
+	}
+	if( pMsg->RTR == CAN_REMOTE_FRAME ) {
+		tag |= CAN_CAPTURE_TAG_RTR;
+	}
+	if( pMsg->Fifo == CAN_MSG_RX_FIFO1 ) {
+		tag |= CAN_CAPTURE_TAG_FIFO1;
+	}
+	if( pMsg->Overrun != CAN_RX_NO_OVERRUN ) {
+		tag |= CAN_CAPTURE_TAG_OVERRUN;
+	}
+
+	pRecord = m_file.GetData() + m_offset;
+	size = 0;
+	pRecord[size++] = tag;
+	if( (tag & CAN_CAPTURE_TAG_OVERRUN) != 0 ) {
+		pRecord[size++] = (uint8_t)pMsg->Overrun;
+	}
+	size += PutVarint(&pRecord[size], units-timeRef);
+	idDiff = (int32_t)(id-idRef);
+	size += PutVarint(&pRecord[size], ((uint32_t)idDiff<<1) ^ (uint32_t)(idDiff>>31));
+	if( pMsg->RTR == CAN_DATA_FRAME ) {
+		dataSize = (pMsg->DLC <= 8) ? pMsg->DLC : 8;
+		if( dataSize != 0 ) {
+			memcpy(&pRecord[size], pData, dataSize);
+			size += dataSize;
+		}
+	}
+	m_offset += size;
+	m_frameNb++;
+	m_prevUnits = units;
+	m_prevId = id;
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine appends a frame received by a BrgCanReceiver to the capture file, see Write().
+ * @param[in]  pFrame  Frame (BrgCanReceiver::PopFrame()), recorded at its TimestampNs.
+ */
+Brg_StatusT BrgCanCaptureWriter::Write(const Brg_CanRxFrameT *pFrame)
+{
+	if( pFrame == NULL ) {
+		return BRG_PARAM_ERR;
+	}
+	return Write(pFrame->TimestampNs, &pFrame->Msg, pFrame->Data);
+}
+/**
+ * @ingroup CAN
+ * @brief This routine writes the seek index and the final header, and truncates the file to its used size.
+ * Without effect if not opened.
+ *
+ * @retval #BRG_FILE_ERR If the file cannot grow for the index (the frames are kept, without index)
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanCaptureWriter::Close(void)
+{
+	Brg_StatusT brgStat;
+	uint64_t indexSize;
+	uint8_t *pHeader;
+
+	if( m_bOpened == false ) {
+		return BRG_NO_ERR;
+	}
+	m_bOpened = false;
+	UpdateHeader();
+	indexSize = (uint64_t)m_indexNb*BRG_CAN_CAPTURE_INDEX_ENTRY_SIZE;
+	brgStat = Reserve(indexSize);
+	if( brgStat != BRG_NO_ERR ) {
+		m_file.Close(m_offset);
+		return brgStat;
+	}
+	if( indexSize != 0 ) {
+		memcpy(m_file.GetData()+m_offset, m_pIndex, (size_t)indexSize);
+	}
+	pHeader = m_file.GetData();
+	PutLe(&pHeader[CAN_CAPTURE_HDR_INDEX_NB], m_indexNb, 4);
+	PutLe(&pHeader[CAN_CAPTURE_HDR_INDEX_OFFSET], m_offset, 8);
+	m_file.Close(m_offset+indexSize);
+	return BRG_NO_ERR;
+}
+/*
+ * private: makes room for SizeInBytes bytes at m_offset, growing the file by steps of GrowSize
+ */
+Brg_StatusT BrgCanCaptureWriter::Reserve(uint64_t SizeInBytes)
+{
+	uint64_t newSize;
+
+	if( (m_offset+SizeInBytes) <= m_file.GetSize() ) {
+		return BRG_NO_ERR;
+	}
+	newSize = m_file.GetSize() + m_conf.GrowSize;
+	if( newSize < (m_offset+SizeInBytes) ) {
+		newSize = m_offset + SizeInBytes;
+	}
+	if( m_file.Grow(newSize) != BRG_NO_ERR ) {
+		m_bOpened = false;
+		return BRG_FILE_ERR;
+	}
+	return BRG_NO_ERR;
+}
+/*
+ * private: adds the index entry of the block starting with the frame m_frameNb (recorded at Units),
+ * and updates the header (all the previous blocks are complete)
+ */
+Brg_StatusT BrgCanCaptureWriter::StartBlock(uint64_t Units)
+{
+	uint8_t *pEntry;
+
+	if( m_indexNb == m_indexMax ) {
+		uint8_t *pIndex = new uint8_t[(size_t)m_indexMax*2*BRG_CAN_CAPTURE_INDEX_ENTRY_SIZE];
+		if( pIndex == NULL ) {
+			return BRG_MEM_ALLOC_ERR;
+		}
+		memcpy(pIndex, m_pIndex, (size_t)m_indexNb*BRG_CAN_CAPTURE_INDEX_ENTRY_SIZE);
+		delete [] m_pIndex;
+		m_pIndex = pIndex;
+		m_indexMax *= 2;
+	}
+	pEntry = &m_pIndex[(size_t)m_indexNb*BRG_CAN_CAPTURE_INDEX_ENTRY_SIZE];
+	PutLe(&pEntry[0], m_frameNb, 8);
+	PutLe(&pEntry[8], m_offset, 8);
+	PutLe(&pEntry[16], m_startNs+Units*m_conf.TimeUnitNs, 8);
+	m_indexNb++;
+	UpdateHeader();
+	return BRG_NO_ERR;
+}
+/*
+ * private: writes the frame count and the end of the frame records in the header
+ */
+void BrgCanCaptureWriter::UpdateHeader(void)
+{
+	uint8_t *pHeader = m_file.GetData();
+
+	PutLe(&pHeader[CAN_CAPTURE_HDR_FRAME_NB], m_frameNb, 8);
+	PutLe(&pHeader[CAN_CAPTURE_HDR_DATA_END], m_offset, 8);
+}
+
+/**
+ * @ingroup CAN
+ * @brief BrgCanCaptureReader constructor.
+ */
+BrgCanCaptureReader::BrgCanCaptureReader(void): m_bOpened(false), m_pIndex(NULL), m_dataEnd(0), m_offset(0),
+	m_frameIdx(0), m_prevUnits(0), m_prevId(0)
+{
+	memset(&m_info, 0, sizeof(m_info));
+}
+/**
+ * @ingroup CAN
+ * @brief BrgCanCaptureReader destructor.
+ */
+BrgCanCaptureReader::~BrgCanCaptureReader(void)
+{
+	Close();
+}
+/**
+ * @ingroup CAN
+ * @brief This routine opens a capture file and checks its header. A file not closed by its writer is read
+ * up to the last complete block, without index (Seek() decodes from the start of the file).
+ * @param[in]  pPath  File path.
+ *
+ * @retval #BRG_PARAM_ERR If a file is already opened
+ * @retval #BRG_FILE_ERR If the file cannot be opened or is not a supported capture file
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanCaptureReader::Open(const char *pPath)
+{
+	Brg_StatusT brgStat;
+	const uint8_t *pHeader;
+	uint64_t indexOffset;
+
+	if( m_bOpened == true ) {
+		return BRG_PARAM_ERR;
+	}
+	brgStat = m_file.OpenRead(pPath);
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+	pHeader = m_file.GetData();
+	if( (m_file.GetSize() < BRG_CAN_CAPTURE_HEADER_SIZE) ||
+	    (memcmp(&pHeader[CAN_CAPTURE_HDR_MAGIC], s_canCaptureMagic, sizeof(s_canCaptureMagic)) != 0) ||
+	    (GetLe(&pHeader[CAN_CAPTURE_HDR_VERSION], 2) != BRG_CAN_CAPTURE_VERSION) ||
+	    (GetLe(&pHeader[CAN_CAPTURE_HDR_HEADER_SIZE], 2) != BRG_CAN_CAPTURE_HEADER_SIZE) ) {
+		m_file.Close();
+		return BRG_FILE_ERR;
+	}
+	m_info.TimeUnitNs = (uint32_t)GetLe(&pHeader[CAN_CAPTURE_HDR_TIME_UNIT], 4);
+	m_info.StartNs = GetLe(&pHeader[CAN_CAPTURE_HDR_START_NS], 8);
+	m_info.StartWallNs = GetLe(&pHeader[CAN_CAPTURE_HDR_START_WALL_NS], 8);
+	m_info.IndexInterval = (uint32_t)GetLe(&pHeader[CAN_CAPTURE_HDR_INDEX_INTERVAL], 4);
+	m_info.IndexNb = (uint32_t)GetLe(&pHeader[CAN_CAPTURE_HDR_INDEX_NB], 4);
+	m_info.FrameNb = GetLe(&pHeader[CAN_CAPTURE_HDR_FRAME_NB], 8);
+	m_dataEnd = GetLe(&pHeader[CAN_CAPTURE_HDR_DATA_END], 8);
+	indexOffset = GetLe(&pHeader[CAN_CAPTURE_HDR_INDEX_OFFSET], 8);
+	if( (m_info.TimeUnitNs == 0) || (m_info.IndexInterval == 0) || (m_dataEnd < BRG_CAN_CAPTURE_HEADER_SIZE) ||
+	    (m_dataEnd > m_file.GetSize()) ) {
+		m_file.Close();
+		return BRG_FILE_ERR;
+	}
+	m_info.DataSize = m_dataEnd - BRG_CAN_CAPTURE_HEADER_SIZE;
+	m_pIndex = NULL;
+	if( (indexOffset < m_dataEnd) || (indexOffset > m_file.GetSize()) ||
+	    (((m_file.GetSize()-indexOffset)/BRG_CAN_CAPTURE_INDEX_ENTRY_SIZE) < m_info.IndexNb) ) {
+		m_info.IndexNb = 0;
+	}
+	if( m_info.IndexNb != 0 ) {
+		m_pIndex = m_file.GetData() + indexOffset;
+	}
+	SetBlock(0);
+	m_bOpened = true;
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine closes the capture file.
+ */
+void BrgCanCaptureReader::Close(void)
+{
+	m_file.Close();
+	m_pIndex = NULL;
+	m_bOpened = false;
+}
+/**
+ * @ingroup CAN
+ * @brief Description of the opened capture file.
+ * @param[out] pInfo  File header content.
+ */
+void BrgCanCaptureReader::GetInfo(Brg_CanCaptureInfoT *pInfo) const
+{
+	if( pInfo != NULL ) {
+		*pInfo = m_info;
+	}
+}
+/**
+ * @ingroup CAN
+ * @brief This routine decodes the next frame of the file.
+ * @param[out] pFrame  Frame.
+ * @retval false If the end of the file is reached (or a record is corrupted).
+ */
+bool BrgCanCaptureReader::ReadFrame(Brg_CanCaptureFrameT *pFrame)
+{
+	const uint8_t *pSrc, *pEnd;
+	uint64_t value;
+	uint32_t id, dataSize;
+	uint8_t tag;
+
+	if( (m_bOpened == false) || (pFrame == NULL) || (m_frameIdx >= m_info.FrameNb) ) {
+		return false;
+	}
+	if( (m_frameIdx%m_info.IndexInterval) == 0 ) {
+		m_prevUnits = 0;
+		m_prevId = 0;
+	}
+	pSrc = m_file.GetData() + m_offset;
+	pEnd = m_file.GetData() + m_dataEnd;
+	if( pSrc >= pEnd ) {
+		return false;
+	}
+
+	tag = *pSrc++;
+	pFrame->Msg.Overrun = CAN_RX_NO_OVERRUN;
+	if( (tag & CAN_CAPTURE_TAG_OVERRUN) != 0 ) {
+		if( pSrc >= pEnd ) {
+			return false;
+		}
+		pFrame->Msg.Overrun = (Brg_CanRxOverrunT)*pSrc++;
+	}
+	if( GetVarint(&pSrc, pEnd, &value) == false ) {
+		return false;
+	}
+	m_prevUnits += value;
+	if( GetVarint(&pSrc, pEnd, &value) == false ) {
+		return false;
+	}
+	id = m_prevId + ((uint32_t)(value>>1) ^ (0-(uint32_t)(value&1)));
+
+	pFrame->TimestampNs = m_info.StartNs + m_prevUnits*m_info.TimeUnitNs;
+	pFrame->Msg.IDE = ((tag & CAN_CAPTURE_TAG_IDE) != 0) ? CAN_ID_EXTENDED : CAN_ID_STANDARD;
+	pFrame->Msg.ID = id & CAN_CAPTURE_ID_MASK;
+	pFrame->Msg.RTR = ((tag & CAN_CAPTURE_TAG_RTR) != 0) ? CAN_REMOTE_FRAME : CAN_DATA_FRAME;
+	pFrame->Msg.DLC = tag & CAN_CAPTURE_TAG_DLC_MASK;
+	pFrame->Msg.Fifo = ((tag & CAN_CAPTURE_TAG_FIFO1) != 0) ? CAN_MSG_RX_FIFO1 : CAN_MSG_RX_FIFO0;
+	pFrame->Msg.TimeStamp = 0;
+	if( pFrame->Msg.RTR == CAN_DATA_FRAME ) {
+		dataSize = (pFrame->Msg.DLC <= 8) ? pFrame->Msg.DLC : 8;
+		if( (uint64_t)(pEnd-pSrc) < dataSize ) {
+			return false;
+		}
+		memcpy(pFrame->Data, pSrc, dataSize);
+		pSrc += dataSize;
+	}
+	m_prevId = id;
+	m_offset = (uint64_t)(pSrc - m_file.GetData());
+	m_frameIdx++;
+	return true;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine positions the reader on the first frame recorded at or after TimestampNs: the
+ * index gives the last block starting before TimestampNs, decoded up to the frame.
+ * @param[in]  TimestampNs  Time (same clock as the frame timestamps), 0 for the start of the file.
+ *
+ * @retval #BRG_COM_CMD_ORDER_ERR If Open() not called before
+ * @retval #BRG_NO_ERR If no error (the reader is at the end of the file if all the frames are earlier)
+ */
+Brg_StatusT BrgCanCaptureReader::Seek(uint64_t TimestampNs)
+{
+	Brg_CanCaptureFrameT frame;
+	uint64_t offset, frameIdx, prevUnits;
+	uint32_t low, high, mid, prevId;
+
+	if( m_bOpened == false ) {
+		return BRG_COM_CMD_ORDER_ERR;
+	}
+	// Last block starting at or before TimestampNs
+	low = 0;
+	high = m_info.IndexNb;
+	while( (high-low) > 1 ) {
+		mid = low + (high-low)/2;
+		if( GetLe(&m_pIndex[(size_t)mid*BRG_CAN_CAPTURE_INDEX_ENTRY_SIZE+16], 8) <= TimestampNs ) {
+			low = mid;
+		} else {
+			high = mid;
+		}
+	}
+	SetBlock(low);
+
+	while( true ) {
+		offset = m_offset;
+		frameIdx = m_frameIdx;
+		prevUnits = m_prevUnits;
+		prevId = m_prevId;
+		if( ReadFrame(&frame) == false ) {
+			return BRG_NO_ERR;
+		}
+		if( frame.TimestampNs >= TimestampNs ) {
+			m_offset = offset;
+			m_frameIdx = frameIdx;
+			m_prevUnits = prevUnits;
+			m_prevId = prevId;
+			return BRG_NO_ERR;
+		}
+	}
+}
+/**
+ * @ingroup CAN
+ * @brief This routine converts the whole file to a candump log (candump -l format, wall clock timestamps):
+ * "(1571234567.123456) can0 123#1122334455667788". The overrun flags are not converted.
+ * The reader is then at the end of the file.
+ * @param[in]  pTextPath  Text file path (overwritten).
+ * @param[in]  pIfName    Interface name of the lines.
+ *
+ * @retval #BRG_COM_CMD_ORDER_ERR If Open() not called before
+ * @retval #BRG_PARAM_ERR If a parameter is NULL
+ * @retval #BRG_FILE_ERR If the text file cannot be created or written
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanCaptureReader::ExportCandump(const char *pTextPath, const char *pIfName)
+{
+	static const char hexDigit[] = "0123456789ABCDEF";
+	Brg_CanCaptureFrameT frame;
+	char line[80];
+	uint64_t wallNs;
+	int len;
+	bool bOk;
+	FILE *pFile;
+
+	if( m_bOpened == false ) {
+		return BRG_COM_CMD_ORDER_ERR;
+	}
+	if( (pTextPath == NULL) || (pIfName == NULL) ) {
+		return BRG_PARAM_ERR;
+	}
+	pFile = fopen(pTextPath, "w");
+	if( pFile == NULL ) {
+		return BRG_FILE_ERR;
+	}
+	Seek(0);
+	bOk = true;
+	while( (bOk == true) && (ReadFrame(&frame) == true) ) {
+		wallNs = m_info.StartWallNs + (frame.TimestampNs-m_info.StartNs);
+		len = snprintf(line, sizeof(line), (frame.Msg.IDE == CAN_ID_EXTENDED) ? "(%llu.%06u) %s %08X#" :
+		               "(%llu.%06u) %s %03X#", (unsigned long long)(wallNs/1000000000),
+		               (unsigned int)((wallNs%1000000000)/1000), pIfName, (unsigned int)frame.Msg.ID);
+		if( (len < 0) || (len > (int)sizeof(line)-20) ) {
+			bOk = false;
+			break;
+		}
+		if( frame.Msg.RTR == CAN_REMOTE_FRAME ) {
+			line[len++] = 'R';
+		} else {
+			for( uint8_t i=0; (i<frame.Msg.DLC) && (i<8); i++ ) {
+				line[len++] = hexDigit[frame.Data[i]>>4];
+				line[len++] = hexDigit[frame.Data[i]&0x0F];
+			}
+		}
+		line[len++] = '\n';
+		bOk = (fwrite(line, 1, (size_t)len, pFile) == (size_t)len);
+	}
+	if( fclose(pFile) != 0 ) {
+		bOk = false;
+	}
+	return (bOk == true) ? BRG_NO_ERR : BRG_FILE_ERR;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine converts the whole file to a Vector ASC log (hex IDs and data, timestamps in seconds
+ * from the capture start, all frames "Rx"). The overrun flags are not converted.
+ * The reader is then at the end of the file.
+ * @param[in]  pTextPath  Text file path (overwritten).
+ * @param[in]  Channel    Channel number of the lines (1 for the first CAN channel).
+ *
+ * @retval #BRG_COM_CMD_ORDER_ERR If Open() not called before
+ * @retval #BRG_PARAM_ERR If pTextPath is NULL
+ * @retval #BRG_FILE_ERR If the text file cannot be created or written
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanCaptureReader::ExportAsc(const char *pTextPath, uint8_t Channel)
+{
+	Brg_CanCaptureFrameT frame;
+	char date[64], id[16];
+	uint64_t relNs;
+	time_t startSec;
+	struct tm *pTm;
+	bool bOk;
+	FILE *pFile;
+
+	if( m_bOpened == false ) {
+		return BRG_COM_CMD_ORDER_ERR;
+	}
+	if( pTextPath == NULL ) {
+		return BRG_PARAM_ERR;
+	}
+	pFile = fopen(pTextPath, "w");
+	if( pFile == NULL ) {
+		return BRG_FILE_ERR;
+	}
+
+	// ASC date: "Fri Oct 18 02:15:42.123 pm 2019" (local time)
+	startSec = (time_t)(m_info.StartWallNs/1000000000);
+	pTm = localtime(&startSec);
+	date[0] = '\0';
+	if( pTm != NULL ) {
+		char hms[32], year[8];
+		strftime(hms, sizeof(hms), "%a %b %d %I:%M:%S", pTm);
+		strftime(year, sizeof(year), "%Y", pTm);
+		snprintf(date, sizeof(date), "%s.%03u %s %s", hms, (unsigned int)((m_info.StartWallNs%1000000000)/1000000),
+		         (pTm->tm_hour < 12) ? "am" : "pm", year);
+	}
+	fprintf(pFile, "date %s\nbase hex  timestamps absolute\ninternal events logged\n", date);
+	fprintf(pFile, "Begin Triggerblock %s\n   0.000000 Start of measurement\n", date);
+
+	Seek(0);
+	bOk = true;
+	while( (bOk == true) && (ReadFrame(&frame) == true) ) {
+		relNs = frame.TimestampNs - m_info.StartNs;
+		snprintf(id, sizeof(id), (frame.Msg.IDE == CAN_ID_EXTENDED) ? "%Xx" : "%X", (unsigned int)frame.Msg.ID);
+		fprintf(pFile, "%4llu.%06u %u  %-15s Rx   %c %X", (unsigned long long)(relNs/1000000000),
+		        (unsigned int)((relNs%1000000000)/1000), (unsigned int)Channel, id,
+		        (frame.Msg.RTR == CAN_REMOTE_FRAME) ? 'r' : 'd', (unsigned int)frame.Msg.DLC);
+		if( frame.Msg.RTR == CAN_DATA_FRAME ) {
+			for( uint8_t i=0; (i<frame.Msg.DLC) && (i<8); i++ ) {
+				fprintf(pFile, " %02X", frame.Data[i]);
+			}
+		}
+		bOk = (fputc('\n', pFile) != EOF);
+	}
+	if( fprintf(pFile, "End TriggerBlock\n") < 0 ) {
+		bOk = false;
+	}
+	if( fclose(pFile) != 0 ) {
+		bOk = false;
+	}
+	return (bOk == true) ? BRG_NO_ERR : BRG_FILE_ERR;
+}
+/*
+ * private: positions the decoding at the start of the block BlockIdx (index entry, 0: start of the file)
+ */
+void BrgCanCaptureReader::SetBlock(uint32_t BlockIdx)
+{
+	const uint8_t *pEntry;
+	uint64_t offset, frameIdx;
+
+	m_offset = BRG_CAN_CAPTURE_HEADER_SIZE;
+	m_frameIdx = 0;
+	m_prevUnits = 0;
+	m_prevId = 0;
+	if( (BlockIdx == 0) || (BlockIdx >= m_info.IndexNb) ) {
+		return;
+	}
+	pEntry = &m_pIndex[(size_t)BlockIdx*BRG_CAN_CAPTURE_INDEX_ENTRY_SIZE];
+	offset = GetLe(&pEntry[8], 8);
+	frameIdx = GetLe(&pEntry[0], 8);
+	if( (offset >= BRG_CAN_CAPTURE_HEADER_SIZE) && (offset <= m_dataEnd) && ((frameIdx%m_info.IndexInterval) == 0) ) {
+		m_offset = offset;
+		m_frameIdx = frameIdx;
+	}
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
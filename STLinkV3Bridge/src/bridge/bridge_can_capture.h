@@ -0,0 +1,224 @@
+/**
+  ******************************************************************************
+  * @file    bridge_can_capture.h
+  * @author  MCD Application Team
+  * @brief   Header for bridge_can_capture.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup CAN
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BRIDGE_CAN_CAPTURE_H
+#define _BRIDGE_CAN_CAPTURE_H
+/* Includes ------------------------------------------------------------------*/
+#include "bridge.h"
+#include "bridge_can_rx.h"
+
+/* Exported types and constants ----------------------------------------------*/
+/// Capture file format version, see BrgCanCaptureWriter
+#define BRG_CAN_CAPTURE_VERSION 1
+/// Capture file header size in bytes
+#define BRG_CAN_CAPTURE_HEADER_SIZE 64
+/// Seek index entry size in bytes
+#define BRG_CAN_CAPTURE_INDEX_ENTRY_SIZE 24
+/// Max size of a frame record in bytes
+#define BRG_CAN_CAPTURE_RECORD_MAX 25
+/// Default timestamp resolution, see #Brg_CanCaptureConfT
+#define BRG_CAN_CAPTURE_TIME_UNIT_NS_DEFAULT 1000
+/// Default number of frames per index block, see #Brg_CanCaptureConfT
+#define BRG_CAN_CAPTURE_INDEX_INTERVAL_DEFAULT 1024
+/// Default file preallocation step, see #Brg_CanCaptureConfT
+#define BRG_CAN_CAPTURE_GROW_SIZE_DEFAULT (16*1024*1024)
+
+/// BrgCanCaptureWriter::Open() parameters
+typedef struct {
+	uint32_t TimeUnitNs;     ///< Timestamp resolution in ns (1000: 1us)
+	uint32_t IndexInterval;  ///< Frames per index block (seek granularity, one index entry per block)
+	uint32_t GrowSize;       ///< Bytes preallocated (and mapped) each time the file is full
+} Brg_CanCaptureConfT;
+
+/// Capture file description, see BrgCanCaptureReader::GetInfo()
+typedef struct {
+	uint64_t StartNs;        ///< Time origin of the capture (monotonic clock, see BrgCanReceiver::GetTimeNs())
+	uint64_t StartWallNs;    ///< Wall clock time of StartNs, in ns since 1970-01-01 UTC
+	uint32_t TimeUnitNs;     ///< Timestamp resolution in ns
+	uint32_t IndexInterval;  ///< Frames per index block
+	uint64_t FrameNb;        ///< Number of frames in the file
+	uint32_t IndexNb;        ///< Number of seek index entries (0 if the file was not closed)
+	uint64_t DataSize;       ///< Size of the frame records in bytes
+} Brg_CanCaptureInfoT;
+
+/// Frame read by BrgCanCaptureReader::ReadFrame()
+typedef struct {
+	uint64_t TimestampNs;    ///< Frame time (monotonic clock), rounded down to the TimeUnitNs of the file
+	Brg_CanRxMsgT Msg;       ///< Message header (TimeStamp field unused)
+	uint8_t Data[8];         ///< Msg.DLC bytes for a data frame
+} Brg_CanCaptureFrameT;
+
+/* Class -------------------------------------------------------------------- */
+/// BrgMappedFile Class: file mapped in memory, used by the CAN capture writer and reader.\n
+/// A file created for writing is extended (preallocated on Linux, so that a full disk fails on Grow()
+/// instead of on a write to the mapping) and remapped by Grow(), and truncated to its used size by Close().
+class BrgMappedFile
+{
+public:
+
+	BrgMappedFile(void);
+
+	virtual ~BrgMappedFile(void);
+
+	Brg_StatusT Create(const char *pPath, uint64_t SizeInBytes);
+	Brg_StatusT OpenRead(const char *pPath);
+	Brg_StatusT Grow(uint64_t SizeInBytes);
+	void Close(uint64_t FinalSize=0);
+
+	/**
+	 * @brief Mapped file content, NULL if not opened.
+	 */
+	uint8_t *GetData(void) const {
+		return m_pData;
+	}
+	/**
+	 * @brief Mapped size in bytes.
+	 */
+	uint64_t GetSize(void) const {
+		return m_size;
+	}
+
+private:
+
+	Brg_StatusT Map(void);
+	void Unmap(void);
+
+	bool m_bWrite;
+	uint8_t *m_pData;
+	uint64_t m_size;
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	void *m_hFile;     // HANDLE
+	void *m_hMapping;  // HANDLE
+#else
+	int m_fd;
+#endif
+};
+
+/// BrgCanCaptureWriter Class: records CAN frames in a compact binary capture file.\n
+/// The file is mapped in memory and preallocated by steps of GrowSize bytes: a frame is encoded directly
+/// in the mapping, without system call except when the file grows.\n
+/// File format (little endian): a #BRG_CAN_CAPTURE_HEADER_SIZE bytes header, the frame records, then the
+/// seek index written by Close(). A record is:
+/// - tag byte: DLC (bits 0-3), IDE (bit 4), RTR (bit 5), FIFO1 (bit 6), overrun byte follows (bit 7),
+/// - [overrun byte: #Brg_CanRxOverrunT],
+/// - time: LEB128 varint, TimeUnitNs units since the previous frame,
+/// - ID: zigzag LEB128 varint, difference with the previous frame ID,
+/// - data: DLC (max 8) bytes, data frames only.
+///
+/// Frames are grouped in blocks of IndexInterval frames. The first frame of a block is encoded relative to
+/// the capture start and ID 0, so that the decoding can start at any block: the index holds one entry
+/// (frame number, record offset, timestamp, 8 bytes each) per block. The header frame count and data size
+/// are updated at each block: the complete blocks of a file not closed (application crash) can be read.\n
+/// A 1us resolution and repetitive IDs give about 3 bytes per frame plus the data bytes.
+/// Timestamps going backwards are recorded as the previous frame time. Not thread safe.
+class BrgCanCaptureWriter
+{
+public:
+
+	BrgCanCaptureWriter(void);
+
+	virtual ~BrgCanCaptureWriter(void);
+
+	static void GetDefaultConf(Brg_CanCaptureConfT *pConf);
+
+	Brg_StatusT Open(const char *pPath, uint64_t StartNs, const Brg_CanCaptureConfT *pConf=NULL);
+	Brg_StatusT Write(uint64_t TimestampNs, const Brg_CanRxMsgT *pMsg, const uint8_t *pData);
+	Brg_StatusT Write(const Brg_CanRxFrameT *pFrame);
+	Brg_StatusT Close(void);
+
+	/**
+	 * @brief Frames written since Open().
+	 */
+	uint64_t GetFrameNb(void) const {
+		return m_frameNb;
+	}
+	/**
+	 * @brief File size used by the header and the frame records (the index is added by Close()).
+	 */
+	uint64_t GetUsedSize(void) const {
+		return m_offset;
+	}
+
+private:
+
+	Brg_StatusT Reserve(uint64_t SizeInBytes);
+	Brg_StatusT StartBlock(uint64_t Units);
+	void UpdateHeader(void);
+
+	BrgMappedFile m_file;
+	bool m_bOpened;
+	Brg_CanCaptureConfT m_conf;
+	uint64_t m_startNs;
+	uint64_t m_offset;
+	uint64_t m_frameNb;
+
+	// Delta encoding state: previous frame time (TimeUnitNs units since m_startNs) and ID
+	uint64_t m_prevUnits;
+	uint32_t m_prevId;
+
+	// Seek index kept in memory until Close(): BRG_CAN_CAPTURE_INDEX_ENTRY_SIZE bytes per block
+	uint8_t *m_pIndex;
+	uint32_t m_indexNb;
+	uint32_t m_indexMax;
+};
+
+/// BrgCanCaptureReader Class: reads a capture file written by BrgCanCaptureWriter, seeks by time with the
+/// index, converts the file to candump log or Vector ASC text.
+class BrgCanCaptureReader
+{
+public:
+
+	BrgCanCaptureReader(void);
+
+	virtual ~BrgCanCaptureReader(void);
+
+	Brg_StatusT Open(const char *pPath);
+	void Close(void);
+
+	void GetInfo(Brg_CanCaptureInfoT *pInfo) const;
+
+	bool ReadFrame(Brg_CanCaptureFrameT *pFrame);
+	Brg_StatusT Seek(uint64_t TimestampNs);
+
+	Brg_StatusT ExportCandump(const char *pTextPath, const char *pIfName);
+	Brg_StatusT ExportAsc(const char *pTextPath, uint8_t Channel);
+
+private:
+
+	void SetBlock(uint32_t BlockIdx);
+
+	BrgMappedFile m_file;
+	bool m_bOpened;
+	Brg_CanCaptureInfoT m_info;
+	const uint8_t *m_pIndex;
+	uint64_t m_dataEnd;
+
+	// Decoding position and delta state
+	uint64_t m_offset;
+	uint64_t m_frameIdx;
+	uint64_t m_prevUnits;
+	uint32_t m_prevId;
+};
+
+#endif //_BRIDGE_CAN_CAPTURE_H
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,735 @@
+/**
+  ******************************************************************************
+  * @file    bridge_can_filter.cpp
+  * @author  MCD Application Team
+  * @brief   CAN filter banks planning: exact identifier lists first, then
+  *          ID/mask filters merged to fit the banks with the fewest
+  *          unwanted identifiers accepted (see BrgCanFilterPlanner).
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup CAN
+ * @{
+ * Usage:\n
+ *   brg.InitCAN(&canInit, BRG_INIT_FULL);\n
+ *   BrgCanFilterPlanner planner;\n
+ *   planner.Plan(wantedIds, wantedNb);\n
+ *   planner.GetPlan(&plan); // plan.FalseAcceptRatio\n
+ *   planner.Apply(brg);\n
+ *   brg.StartMsgReceptionCAN();
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_can_filter.h"
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+// Merge of two cubes evaluated by BrgCanFilterPlanner::MergeStep()
+typedef struct {
+	uint32_t I;
+	uint32_t J;
+	uint64_t Growth; // accepted identifiers added, absorbed cubes not counted
+} CanFilterMergeT;
+
+/* Private defines -----------------------------------------------------------*/
+// Frame identifier word: IDE[30], ID[29:1], RTR[0]
+#define CAN_FILTER_WORD_MASK 0x7FFFFFFFu
+#define CAN_FILTER_WORD_IDE 0x40000000u
+// ID[25:11]: not compared by 16bit filters
+#define CAN_FILTER_WORD_NOT_16BIT 0x07FFF000u
+// Bank slots in quarters of bank: 16bit list, 16bit mask or 32bit list, 32bit mask
+#define CAN_FILTER_SLOT_LIST16 1
+#define CAN_FILTER_SLOT_MASK16 2
+#define CAN_FILTER_SLOT_MASK32 4
+// Cheapest merges fully evaluated at each step
+#define CAN_FILTER_MERGE_CANDIDATES 256
+
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Global variables ----------------------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+static uint32_t CountBits(uint32_t Value)
+{
+	Value = Value - ((Value>>1) & 0x55555555u);
+	Value = (Value & 0x33333333u) + ((Value>>2) & 0x33333333u);
+	return (((Value + (Value>>4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+}
+
+/* Class Functions Definition ------------------------------------------------*/
+
+/**
+ * @ingroup CAN
+ * @brief BrgCanFilterPlanner constructor.
+ */
+BrgCanFilterPlanner::BrgCanFilterPlanner(void): m_pWanted(NULL), m_wantedNb(0), m_pCubes(NULL), m_cubeNb(0),
+	m_bPlanned(false), m_firstBankNb(0), m_bankMax(BRG_CAN_FILTER_BANK_NB), m_fifo(CAN_MSG_RX_FIFO0)
+{
+	memset(m_banks, 0, sizeof(m_banks));
+	memset(&m_plan, 0, sizeof(m_plan));
+}
+/**
+ * @ingroup CAN
+ * @brief BrgCanFilterPlanner destructor.
+ */
+BrgCanFilterPlanner::~BrgCanFilterPlanner(void)
+{
+	Reset();
+}
+/**
+ * @ingroup CAN
+ * @brief This routine computes the filter banks configuration accepting the desired frame identifiers,
+ * see BrgCanFilterPlanner. The result is given by GetPlan() and GetBankConf(), programmed by Apply().
+ * @param[in]  pIds          Desired frame identifiers (RTR, IDE, ID): a data and a remote frame of same ID
+ *                           are two identifiers. Duplicates are allowed.
+ * @param[in]  IdNb          Number of pIds, 0 to reject all the frames (all banks disabled by Apply()).
+ * @param[in]  FirstBankNb   First filter bank to use (0 to 13).
+ * @param[in]  BankNb        Number of filter banks that can be used, from FirstBankNb.
+ * @param[in]  AssignedFifo  Rx FIFO of the accepted messages.
+ *
+ * @retval #BRG_PARAM_ERR If an identifier is not coherent with its IDE bit, a wrong bank range, or a
+ *         single bank for both standard and extended identifiers
+ * @retval #BRG_MEM_ALLOC_ERR If the working buffers cannot be allocated
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanFilterPlanner::Plan(const Brg_FilterBitsT *pIds, uint32_t IdNb, uint8_t FirstBankNb,
+                                      uint8_t BankNb, Brg_CanRxFifoT AssignedFifo)
+{
+	uint32_t i, stdNb = 0, extNb = 0;
+
+	Reset();
+	if( ((pIds == NULL) && (IdNb != 0)) || (BankNb == 0) ||
+	    ((uint32_t)FirstBankNb + BankNb > BRG_CAN_FILTER_BANK_NB) ) {
+		return BRG_PARAM_ERR;
+	}
+	for( i=0; i<IdNb; i++ ) {
+		if( pIds[i].ID > ((pIds[i].IDE == CAN_ID_EXTENDED) ? 0x1FFFFFFFu : 0x7FFu) ) {
+			return BRG_PARAM_ERR;
+		}
+	}
+	m_firstBankNb = FirstBankNb;
+	m_bankMax = BankNb;
+	m_fifo = AssignedFifo;
+
+	if( IdNb != 0 ) {
+		m_pWanted = new (std::nothrow) uint32_t[IdNb];
+		m_pCubes = new (std::nothrow) CubeT[IdNb];
+		if( (m_pWanted == NULL) || (m_pCubes == NULL) ) {
+			Reset();
+			return BRG_MEM_ALLOC_ERR;
+		}
+	}
+	// Sorted desired set without duplicates, each one an exact match to start with
+	for( i=0; i<IdNb; i++ ) {
+		m_pWanted[i] = ToWord(&pIds[i]);
+	}
+	if( IdNb != 0 ) {
+		qsort(m_pWanted, IdNb, sizeof(uint32_t), CompareWords);
+	}
+	for( i=0; i<IdNb; i++ ) {
+		if( (m_wantedNb == 0) || (m_pWanted[i] != m_pWanted[m_wantedNb-1]) ) {
+			m_pWanted[m_wantedNb++] = m_pWanted[i];
+		}
+	}
+	for( i=0; i<m_wantedNb; i++ ) {
+		m_pCubes[i].Code = m_pWanted[i];
+		m_pCubes[i].Mask = CAN_FILTER_WORD_MASK;
+		if( (m_pWanted[i] & CAN_FILTER_WORD_IDE) != 0 ) {
+			extNb = 1;
+		} else {
+			stdNb = 1;
+		}
+	}
+	m_cubeNb = m_wantedNb;
+	if( stdNb + extNb > BankNb ) {
+		Reset();
+		return BRG_PARAM_ERR;
+	}
+
+	while( GetBankNb() > m_bankMax ) {
+		if( MergeStep() == false ) {
+			Reset();
+			return BRG_PARAM_ERR;
+		}
+	}
+	ShrinkCubes();
+	BuildBanks();
+	FillReport();
+	m_bPlanned = true;
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine gives the result of the last successful Plan() (all 0 if none).
+ * @param[out] pPlan  Banks used and accepted identifiers.
+ */
+void BrgCanFilterPlanner::GetPlan(Brg_CanFilterPlanT *pPlan) const
+{
+	if( pPlan != NULL ) {
+		*pPlan = m_plan;
+	}
+}
+/**
+ * @ingroup CAN
+ * @brief This routine gives the configuration of a filter bank used by the plan.
+ * @param[in]  BankIdx  Index in the plan: 0 to BankNb-1 of #Brg_CanFilterPlanT (FilterBankNb of the
+ *                      configuration is FirstBankNb+BankIdx).
+ * @param[out] pConf    Configuration to give to Brg::InitFilterCAN().
+ *
+ * @retval #BRG_PARAM_ERR If BankIdx is not used by the plan or pConf is NULL
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanFilterPlanner::GetBankConf(uint8_t BankIdx, Brg_CanFilterConfT *pConf) const
+{
+	if( (pConf == NULL) || (BankIdx >= m_plan.BankNb) ) {
+		return BRG_PARAM_ERR;
+	}
+	*pConf = m_banks[BankIdx];
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine programs the planned filter banks with Brg::InitFilterCAN() and disables the other
+ * banks of the FirstBankNb/BankNb range given to Plan().
+ * @param[in]  BrgDevice  Bridge with CAN initialized (Brg::InitCAN()).
+ *
+ * @retval #BRG_NO_STLINK If Brg::OpenStlink() not called before
+ * @retval #BRG_COM_INIT_NOT_DONE If CAN is not initialized
+ * @retval #BRG_CAN_ERR In case of CAN error
+ * @retval #BRG_PARAM_ERR If the last Plan() failed or was not called
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanFilterPlanner::Apply(Brg &BrgDevice) const
+{
+	Brg_CanFilterConfT disabledConf;
+	Brg_StatusT brgStat = BRG_NO_ERR;
+	uint8_t bank;
+
+	if( m_bPlanned == false ) {
+		return BRG_PARAM_ERR;
+	}
+	memset(&disabledConf, 0, sizeof(disabledConf));
+	for( bank=0; (bank<m_bankMax) && (brgStat == BRG_NO_ERR); bank++ ) {
+		if( bank < m_plan.BankNb ) {
+			brgStat = BrgDevice.InitFilterCAN(&m_banks[bank]);
+		} else {
+			disabledConf.FilterBankNb = m_firstBankNb + bank;
+			brgStat = BrgDevice.InitFilterCAN(&disabledConf);
+		}
+	}
+	return brgStat;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine tells whether the planned banks accept a frame identifier.
+ * @param[in]  pId  Frame identifier (RTR, IDE, ID).
+ *
+ * @retval true if the frame is received, false if rejected by the filters
+ */
+bool BrgCanFilterPlanner::IsAccepted(const Brg_FilterBitsT *pId) const
+{
+	uint32_t i, word;
+
+	if( pId == NULL ) {
+		return false;
+	}
+	word = ToWord(pId);
+	for( i=0; i<m_cubeNb; i++ ) {
+		if( ((word ^ m_pCubes[i].Code) & m_pCubes[i].Mask) == 0 ) {
+			return true;
+		}
+	}
+	return false;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine computes the false-accept ratio of the planned banks for a known bus traffic:
+ * share of the received frames that are not in the desired set.
+ * @param[in]  pIds           Frame identifiers present on the bus.
+ * @param[in]  pFramesPerSec  Rate of each of them (any unit, NULL: same rate for all).
+ * @param[in]  IdNb           Number of pIds.
+ *
+ * @retval Unwanted accepted rate / accepted rate, 0 if no frame is accepted
+ */
+double BrgCanFilterPlanner::GetTrafficFalseAcceptRatio(const Brg_FilterBitsT *pIds,
+                                                       const uint32_t *pFramesPerSec, uint32_t IdNb) const
+{
+	double acceptedRate = 0, falseRate = 0, rate;
+	uint32_t i, word;
+
+	if( pIds == NULL ) {
+		return 0;
+	}
+	for( i=0; i<IdNb; i++ ) {
+		if( IsAccepted(&pIds[i]) == false ) {
+			continue;
+		}
+		rate = (pFramesPerSec != NULL) ? (double)pFramesPerSec[i] : 1.0;
+		acceptedRate += rate;
+		word = ToWord(&pIds[i]);
+		if( (m_wantedNb == 0) ||
+		    (bsearch(&word, m_pWanted, m_wantedNb, sizeof(uint32_t), CompareWords) == NULL) ) {
+			falseRate += rate;
+		}
+	}
+	return (acceptedRate > 0) ? (falseRate / acceptedRate) : 0;
+}
+
+/*
+ * private: frame identifier word IDE[30], ID[29:1], RTR[0]
+ */
+uint32_t BrgCanFilterPlanner::ToWord(const Brg_FilterBitsT *pId)
+{
+	uint32_t word = (pId->ID & 0x1FFFFFFFu) << 1;
+
+	if( pId->IDE == CAN_ID_EXTENDED ) {
+		word |= CAN_FILTER_WORD_IDE;
+	}
+	if( pId->RTR == CAN_REMOTE_FRAME ) {
+		word |= 1;
+	}
+	return word;
+}
+/*
+ * private: identifier or mask word to Brg::InitFilterCAN() format. The IDE bit of a mask is always
+ * set (compared), which allows ID[28:11] mask bits for a standard identifier.
+ */
+void BrgCanFilterPlanner::ToFilterBits(uint32_t Word, Brg_FilterBitsT *pBits)
+{
+	pBits->RTR = ((Word & 1) != 0) ? CAN_REMOTE_FRAME : CAN_DATA_FRAME;
+	pBits->IDE = ((Word & CAN_FILTER_WORD_IDE) != 0) ? CAN_ID_EXTENDED : CAN_ID_STANDARD;
+	pBits->ID = (Word >> 1) & 0x1FFFFFFFu;
+}
+/*
+ * private: qsort()/bsearch() comparison of identifier words
+ */
+int BrgCanFilterPlanner::CompareWords(const void *pA, const void *pB)
+{
+	uint32_t a = *(const uint32_t*)pA, b = *(const uint32_t*)pB;
+
+	return (a < b) ? -1 : ((a > b) ? 1 : 0);
+}
+/*
+ * private: bank quarters used by a cube: exact standard identifier in a 16bit list, exact extended
+ * identifier in a 32bit list, 16bit mask (standard, or extended without ID[25:11] compared), 32bit mask
+ */
+uint32_t BrgCanFilterPlanner::GetSlotWeight(const CubeT *pCube)
+{
+	bool bIsExt = ((pCube->Code & CAN_FILTER_WORD_IDE) != 0);
+
+	if( pCube->Mask == CAN_FILTER_WORD_MASK ) {
+		return (bIsExt == true) ? CAN_FILTER_SLOT_MASK16 : CAN_FILTER_SLOT_LIST16;
+	}
+	if( (bIsExt == true) && ((pCube->Mask & CAN_FILTER_WORD_NOT_16BIT) != 0) ) {
+		return CAN_FILTER_SLOT_MASK32;
+	}
+	return CAN_FILTER_SLOT_MASK16;
+}
+/*
+ * private: number of frame identifiers accepted by a cube
+ */
+uint64_t BrgCanFilterPlanner::GetCubeSize(const CubeT *pCube)
+{
+	return 1ULL << CountBits(~pCube->Mask & CAN_FILTER_WORD_MASK);
+}
+/*
+ * private: exact standard identifiers put in the free halves of the 16bit mask banks (or grouped there)
+ * rather than in 16bit list banks, for the fewest banks
+ */
+uint32_t BrgCanFilterPlanner::GetMaskSlotExactNb(uint32_t StdExactNb, uint32_t Mask16Nb) const
+{
+	uint32_t k, banks, bestK = 0, bestBanks = 0xFFFFFFFF;
+
+	for( k=0; (k<4) && (k<=StdExactNb); k++ ) {
+		banks = (StdExactNb-k+3)/4 + (Mask16Nb+k+1)/2;
+		if( banks < bestBanks ) {
+			bestBanks = banks;
+			bestK = k;
+		}
+	}
+	return bestK;
+}
+/*
+ * private: banks needed by the current cubes
+ */
+uint32_t BrgCanFilterPlanner::GetBankNb(void) const
+{
+	uint32_t i, stdExactNb = 0, extExactNb = 0, mask16Nb = 0, mask32Nb = 0, k;
+
+	for( i=0; i<m_cubeNb; i++ ) {
+		if( m_pCubes[i].Mask == CAN_FILTER_WORD_MASK ) {
+			if( (m_pCubes[i].Code & CAN_FILTER_WORD_IDE) != 0 ) {
+				extExactNb++;
+			} else {
+				stdExactNb++;
+			}
+		} else if( GetSlotWeight(&m_pCubes[i]) == CAN_FILTER_SLOT_MASK32 ) {
+			mask32Nb++;
+		} else {
+			mask16Nb++;
+		}
+	}
+	k = GetMaskSlotExactNb(stdExactNb, mask16Nb);
+	return mask32Nb + (extExactNb+1)/2 + (stdExactNb-k+3)/4 + (mask16Nb+k+1)/2;
+}
+/*
+ * private: merges two cubes of same IDE into the smallest cube containing both, which also absorbs the
+ * cubes it contains. The cheapest merges by accepted identifiers added are evaluated with their
+ * absorptions, the one adding the fewest unwanted identifiers per bank quarter saved is done (the
+ * cheapest one if none saves a quarter yet). The quarters saved beyond the ones still missing to fit
+ * the banks are not counted: a merge absorbing most cubes would otherwise win on its average cost.
+ * Returns false if no merge is possible.
+ */
+bool BrgCanFilterPlanner::MergeStep(void)
+{
+	CanFilterMergeT cand[CAN_FILTER_MERGE_CANDIDATES];
+	uint32_t candNb = 0, i, j, c, worst = 0;
+	uint32_t mergedMask, saved, bestSaved = 0, bestIdx = CAN_FILTER_MERGE_CANDIDATES;
+	uint32_t missing = (GetBankNb() - m_bankMax) * CAN_FILTER_SLOT_MASK32;
+	uint64_t mergedSize, sizeI, sizeJ, growth, bestCost = 0;
+	bool bBestSaves = false;
+	CubeT merged;
+
+	// Cheapest merges, not counting the absorbed cubes
+	for( i=0; i<m_cubeNb; i++ ) {
+		sizeI = GetCubeSize(&m_pCubes[i]);
+		for( j=i+1; j<m_cubeNb; j++ ) {
+			if( ((m_pCubes[i].Code ^ m_pCubes[j].Code) & CAN_FILTER_WORD_IDE) != 0 ) {
+				continue;
+			}
+			mergedMask = m_pCubes[i].Mask & m_pCubes[j].Mask & ~(m_pCubes[i].Code ^ m_pCubes[j].Code);
+			mergedSize = 1ULL << CountBits(~mergedMask & CAN_FILTER_WORD_MASK);
+			sizeJ = GetCubeSize(&m_pCubes[j]);
+			growth = (mergedSize > sizeI + sizeJ) ? (mergedSize - sizeI - sizeJ) : 0;
+			if( candNb < CAN_FILTER_MERGE_CANDIDATES ) {
+				c = candNb++;
+			} else if( growth < cand[worst].Growth ) {
+				c = worst;
+			} else {
+				continue;
+			}
+			cand[c].I = i;
+			cand[c].J = j;
+			cand[c].Growth = growth;
+			if( candNb == CAN_FILTER_MERGE_CANDIDATES ) {
+				for( worst=0, c=1; c<candNb; c++ ) {
+					if( cand[c].Growth > cand[worst].Growth ) {
+						worst = c;
+					}
+				}
+			}
+		}
+	}
+	if( candNb == 0 ) {
+		return false;
+	}
+
+	// Evaluation with the absorbed cubes: unwanted identifiers added and bank quarters saved
+	for( c=0; c<candNb; c++ ) {
+		uint64_t absorbedSize = 0, cost;
+		uint32_t absorbedWeight = 0, mergedWeight;
+		bool bSaves;
+
+		i = cand[c].I;
+		j = cand[c].J;
+		merged.Mask = m_pCubes[i].Mask & m_pCubes[j].Mask & ~(m_pCubes[i].Code ^ m_pCubes[j].Code);
+		merged.Code = m_pCubes[i].Code & merged.Mask;
+		for( j=0; j<m_cubeNb; j++ ) {
+			if( (((m_pCubes[j].Code ^ merged.Code) & merged.Mask) == 0) &&
+			    ((m_pCubes[j].Mask & merged.Mask) == merged.Mask) ) {
+				absorbedSize += GetCubeSize(&m_pCubes[j]);
+				absorbedWeight += GetSlotWeight(&m_pCubes[j]);
+			}
+		}
+		mergedSize = GetCubeSize(&merged);
+		mergedWeight = GetSlotWeight(&merged);
+		cost = (mergedSize > absorbedSize) ? (mergedSize - absorbedSize) : 0;
+		bSaves = (absorbedWeight > mergedWeight);
+		if( bSaves == true ) {
+			saved = absorbedWeight - mergedWeight;
+			if( saved > missing ) {
+				saved = missing;
+			}
+			// cost per quarter saved compared without division
+			if( (bBestSaves == false) || (cost * bestSaved < bestCost * saved) ||
+			    ((cost * bestSaved == bestCost * saved) && (saved > bestSaved)) ) {
+				bBestSaves = true;
+				bestIdx = c;
+				bestCost = cost;
+				bestSaved = saved;
+			}
+		} else if( (bBestSaves == false) &&
+		           ((bestIdx == CAN_FILTER_MERGE_CANDIDATES) || (cost < bestCost)) ) {
+			bestIdx = c;
+			bestCost = cost;
+		}
+	}
+
+	// Replace the absorbed cubes by the merged one
+	i = cand[bestIdx].I;
+	j = cand[bestIdx].J;
+	merged.Mask = m_pCubes[i].Mask & m_pCubes[j].Mask & ~(m_pCubes[i].Code ^ m_pCubes[j].Code);
+	merged.Code = m_pCubes[i].Code & merged.Mask;
+	for( i=0, j=0; i<m_cubeNb; i++ ) {
+		if( (((m_pCubes[i].Code ^ merged.Code) & merged.Mask) != 0) ||
+		    ((m_pCubes[i].Mask & merged.Mask) != merged.Mask) ) {
+			m_pCubes[j++] = m_pCubes[i];
+		}
+	}
+	m_pCubes[j++] = merged;
+	m_cubeNb = j;
+	return true;
+}
+/*
+ * private: the merges can leave cubes larger than needed: compares again each masked bit of a cube for
+ * which one half of the cube holds no desired identifier that is not accepted by another cube (the
+ * 16bit mask banks of extended identifiers keep ID[25:11] masked), then removes the cubes contained
+ * in another one
+ */
+void BrgCanFilterPlanner::ShrinkCubes(void)
+{
+	uint32_t c, k, w, bit, value, bankNb = GetBankNb();
+	bool bChanged = true, bNeeded;
+	CubeT saved;
+
+	while( bChanged == true ) {
+		bChanged = false;
+		for( c=0; c<m_cubeNb; c++ ) {
+			for( bit=0; bit<31; bit++ ) {
+				if( ((m_pCubes[c].Mask >> bit) & 1) != 0 ) {
+					continue;
+				}
+				if( (GetSlotWeight(&m_pCubes[c]) == CAN_FILTER_SLOT_MASK16) &&
+				    (((CAN_FILTER_WORD_NOT_16BIT >> bit) & 1) != 0) ) {
+					continue;
+				}
+				for( value=0; value<2; value++ ) {
+					// Desired identifiers of the other half only accepted by this cube?
+					bNeeded = false;
+					for( w=0; (w<m_wantedNb) && (bNeeded == false); w++ ) {
+						if( (((m_pWanted[w] ^ m_pCubes[c].Code) & m_pCubes[c].Mask) != 0) ||
+						    (((m_pWanted[w] >> bit) & 1) == value) ) {
+							continue;
+						}
+						bNeeded = true;
+						for( k=0; (k<m_cubeNb) && (bNeeded == true); k++ ) {
+							if( (k != c) && (((m_pWanted[w] ^ m_pCubes[k].Code) & m_pCubes[k].Mask) == 0) ) {
+								bNeeded = false;
+							}
+						}
+					}
+					if( bNeeded == true ) {
+						continue;
+					}
+					saved = m_pCubes[c];
+					m_pCubes[c].Mask |= 1u << bit;
+					m_pCubes[c].Code |= value << bit;
+					if( GetBankNb() > bankNb ) {
+						m_pCubes[c] = saved;
+					} else {
+						bChanged = true;
+						break;
+					}
+				}
+			}
+		}
+	}
+	for( c=0; c<m_cubeNb; ) {
+		for( k=0; k<m_cubeNb; k++ ) {
+			if( (k != c) && (((m_pCubes[c].Code ^ m_pCubes[k].Code) & m_pCubes[k].Mask) == 0) &&
+			    ((m_pCubes[c].Mask & m_pCubes[k].Mask) == m_pCubes[k].Mask) ) {
+				break;
+			}
+		}
+		if( k < m_cubeNb ) {
+			m_pCubes[c] = m_pCubes[--m_cubeNb];
+		} else {
+			c++;
+		}
+	}
+}
+/*
+ * private: bank configurations of the cubes: 32bit masks, 32bit lists of exact extended identifiers,
+ * 16bit masks (with some exact standard identifiers, see GetMaskSlotExactNb()), 16bit lists of exact
+ * standard identifiers. A list or mask bank not full repeats its first entry.
+ */
+void BrgCanFilterPlanner::BuildBanks(void)
+{
+	uint32_t pass, i, slot = 0, pad, stdExactNb = 0, mask16Nb = 0, k, weight;
+	Brg_CanFilterConfT *pConf = NULL;
+	uint8_t bankNb = 0;
+
+	for( i=0; i<m_cubeNb; i++ ) {
+		weight = GetSlotWeight(&m_pCubes[i]);
+		if( weight == CAN_FILTER_SLOT_LIST16 ) {
+			stdExactNb++;
+		} else if( (weight == CAN_FILTER_SLOT_MASK16) && (m_pCubes[i].Mask != CAN_FILTER_WORD_MASK) ) {
+			mask16Nb++;
+		}
+	}
+	k = GetMaskSlotExactNb(stdExactNb, mask16Nb);
+
+	// pass 0: 32bit masks, 1: 32bit lists, 2: 16bit masks, 3: 16bit lists
+	for( pass=0; pass<4; pass++ ) {
+		uint32_t perBank = (pass == 0) ? 1 : ((pass == 3) ? 4 : 2);
+		uint32_t exactSeen = 0;
+
+		slot = 0;
+		for( i=0; i<m_cubeNb; i++ ) {
+			const CubeT *pCube = &m_pCubes[i];
+			bool bIsExact = (pCube->Mask == CAN_FILTER_WORD_MASK);
+			uint32_t cubePass;
+
+			weight = GetSlotWeight(pCube);
+			if( weight == CAN_FILTER_SLOT_MASK32 ) {
+				cubePass = 0;
+			} else if( (bIsExact == true) && (weight == CAN_FILTER_SLOT_MASK16) ) {
+				cubePass = 1;
+			} else if( bIsExact == false ) {
+				cubePass = 2;
+			} else {
+				cubePass = (exactSeen++ < k) ? 2 : 3;
+			}
+			if( cubePass != pass ) {
+				continue;
+			}
+			if( slot == 0 ) {
+				pConf = &m_banks[bankNb];
+				memset(pConf, 0, sizeof(Brg_CanFilterConfT));
+				pConf->FilterBankNb = m_firstBankNb + bankNb;
+				pConf->bIsFilterEn = true;
+				pConf->FilterMode = ((pass & 1) != 0) ? CAN_FILTER_ID_LIST : CAN_FILTER_ID_MASK;
+				pConf->FilterScale = (pass < 2) ? CAN_FILTER_32BIT : CAN_FILTER_16BIT;
+				pConf->AssignedFifo = m_fifo;
+				bankNb++;
+			}
+			ToFilterBits(pCube->Code, &pConf->Id[slot]);
+			if( pConf->FilterMode == CAN_FILTER_ID_MASK ) {
+				ToFilterBits(pCube->Mask, &pConf->Mask[slot]);
+			}
+			slot = (slot + 1) % perBank;
+			if( slot == 0 ) {
+				continue;
+			}
+			// Until the next entry: repeat the first one
+			for( pad=slot; pad<perBank; pad++ ) {
+				pConf->Id[pad] = pConf->Id[0];
+				if( pConf->FilterMode == CAN_FILTER_ID_MASK ) {
+					pConf->Mask[pad] = pConf->Mask[0];
+				}
+			}
+		}
+	}
+	m_plan.BankNb = bankNb;
+}
+/*
+ * private: number of words in the union of the cubes pIdx, on bits Bit to 0. pScratch holds
+ * m_cubeNb indexes per remaining bit.
+ */
+uint64_t BrgCanFilterPlanner::CountUnion(const uint32_t *pIdx, uint32_t IdxNb, int Bit,
+                                         uint32_t *pScratch) const
+{
+	uint32_t lowMask, careMask = 0, i, n, value;
+	uint64_t total = 0;
+	int bit;
+
+	if( IdxNb == 0 ) {
+		return 0;
+	}
+	if( Bit < 0 ) {
+		return 1;
+	}
+	lowMask = (uint32_t)((2ULL << Bit) - 1);
+	if( IdxNb == 1 ) {
+		return 1ULL << CountBits(~m_pCubes[pIdx[0]].Mask & lowMask);
+	}
+	for( i=0; i<IdxNb; i++ ) {
+		if( (m_pCubes[pIdx[i]].Mask & lowMask) == 0 ) {
+			return 1ULL << (Bit+1); // all the remaining words
+		}
+		careMask |= m_pCubes[pIdx[i]].Mask;
+	}
+	// Skip the bits compared by no cube: both values give the same count
+	careMask &= lowMask;
+	for( bit=Bit; ((careMask >> bit) & 1) == 0; bit-- ) {
+	}
+	for( value=0; value<2; value++ ) {
+		n = 0;
+		for( i=0; i<IdxNb; i++ ) {
+			const CubeT *pCube = &m_pCubes[pIdx[i]];
+			if( (((pCube->Mask >> bit) & 1) == 0) || (((pCube->Code >> bit) & 1) == value) ) {
+				pScratch[n++] = pIdx[i];
+			}
+		}
+		total += CountUnion(pScratch, n, bit-1, pScratch + m_cubeNb);
+	}
+	total <<= (Bit - bit);
+	return total;
+}
+/*
+ * private: accepted and unwanted identifiers of the cubes
+ */
+void BrgCanFilterPlanner::FillReport(void)
+{
+	uint32_t *pIdx = NULL, i;
+
+	m_plan.WantedNb = m_wantedNb;
+	m_plan.ExactNb = 0;
+	m_plan.MaskNb = 0;
+	for( i=0; i<m_cubeNb; i++ ) {
+		if( m_pCubes[i].Mask == CAN_FILTER_WORD_MASK ) {
+			m_plan.ExactNb++;
+		} else {
+			m_plan.MaskNb++;
+		}
+	}
+	m_plan.AcceptedNb = m_wantedNb;
+	if( m_cubeNb != 0 ) {
+		// Indexes of all the cubes, then m_cubeNb per bit
+		pIdx = new (std::nothrow) uint32_t[m_cubeNb * 33];
+	}
+	if( pIdx != NULL ) {
+		for( i=0; i<m_cubeNb; i++ ) {
+			pIdx[i] = i;
+		}
+		m_plan.AcceptedNb = CountUnion(pIdx, m_cubeNb, 30, pIdx + m_cubeNb);
+		delete [] pIdx;
+	}
+	m_plan.FalseAcceptNb = m_plan.AcceptedNb - m_wantedNb;
+	m_plan.FalseAcceptRatio = (m_plan.AcceptedNb != 0) ?
+	                          ((double)m_plan.FalseAcceptNb / (double)m_plan.AcceptedNb) : 0;
+}
+/*
+ * private: no plan
+ */
+void BrgCanFilterPlanner::Reset(void)
+{
+	delete [] m_pWanted;
+	delete [] m_pCubes;
+	m_pWanted = NULL;
+	m_pCubes = NULL;
+	m_wantedNb = 0;
+	m_cubeNb = 0;
+	m_bPlanned = false;
+	memset(m_banks, 0, sizeof(m_banks));
+	memset(&m_plan, 0, sizeof(m_plan));
+}
+
+/** @} */
+/******************* (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
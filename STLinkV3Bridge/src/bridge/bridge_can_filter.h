@@ -0,0 +1,117 @@
+/**
+  ******************************************************************************
+  * @file    bridge_can_filter.h
+  * @author  MCD Application Team
+  * @brief   Header for bridge_can_filter.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup CAN
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BRIDGE_CAN_FILTER_H
+#define _BRIDGE_CAN_FILTER_H
+/* Includes ------------------------------------------------------------------*/
+#include "bridge.h"
+
+/* Exported types and constants ----------------------------------------------*/
+/// Number of CAN filter banks, see Brg::InitFilterCAN()
+#define BRG_CAN_FILTER_BANK_NB 14
+
+/// Result of BrgCanFilterPlanner::Plan(). A frame identifier is an (IDE, ID, RTR) triplet.
+typedef struct {
+	uint32_t WantedNb;        ///< Distinct frame identifiers of the desired set
+	uint8_t BankNb;           ///< Filter banks used
+	uint32_t ExactNb;         ///< Desired frame identifiers matched exactly (identifier list or full mask)
+	uint32_t MaskNb;          ///< ID/mask filters accepting several frame identifiers
+	uint64_t AcceptedNb;      ///< Frame identifiers accepted by the banks (desired ones included)
+	uint64_t FalseAcceptNb;   ///< Accepted frame identifiers not in the desired set
+	double FalseAcceptRatio;  ///< FalseAcceptNb / AcceptedNb: expected share of unwanted frames among the
+	                          ///< received ones if all the accepted identifiers are equally used on the bus
+} Brg_CanFilterPlanT;
+
+/* Class -------------------------------------------------------------------- */
+/// BrgCanFilterPlanner Class: computes the CAN filter banks configuration accepting a set of frame
+/// identifiers (standard and extended) and programs it with Brg::InitFilterCAN().\n
+/// Plan() first gives each desired identifier an exact match: 4 per bank for standard identifiers
+/// (16bit identifier list), 2 per bank for extended ones (32bit identifier list). If more banks than
+/// available are needed, identifiers are merged into ID/mask filters (2 per bank for standard identifiers
+/// with 16bit masks, 1 per bank with a 32bit mask for extended ones, or 2 with 16bit masks when ID[25:11]
+/// are not compared): the merges are chosen one by one, each time the one adding the fewest accepted
+/// identifiers per bank slot saved, until the filters fit.
+/// Standard and extended identifiers are never merged together (IDE bit always compared), a data and a
+/// remote frame of same ID can be.\n
+/// The plan reports the accepted identifiers and the expected false-accept ratio;
+/// GetTrafficFalseAcceptRatio() gives this ratio for a known bus traffic. Not thread safe.
+class BrgCanFilterPlanner
+{
+public:
+
+	BrgCanFilterPlanner(void);
+
+	virtual ~BrgCanFilterPlanner(void);
+
+	Brg_StatusT Plan(const Brg_FilterBitsT *pIds, uint32_t IdNb, uint8_t FirstBankNb=0,
+	                 uint8_t BankNb=BRG_CAN_FILTER_BANK_NB, Brg_CanRxFifoT AssignedFifo=CAN_MSG_RX_FIFO0);
+
+	void GetPlan(Brg_CanFilterPlanT *pPlan) const;
+	Brg_StatusT GetBankConf(uint8_t BankIdx, Brg_CanFilterConfT *pConf) const;
+	Brg_StatusT Apply(Brg &BrgDevice) const;
+
+	bool IsAccepted(const Brg_FilterBitsT *pId) const;
+	double GetTrafficFalseAcceptRatio(const Brg_FilterBitsT *pIds, const uint32_t *pFramesPerSec,
+	                                  uint32_t IdNb) const;
+
+private:
+
+	// Set of frame identifiers accepted by one filter, on the 31bit word IDE[30], ID[29:1], RTR[0]:
+	// a word w belongs to the cube if ((w ^ Code) & Mask) == 0
+	typedef struct {
+		uint32_t Code;
+		uint32_t Mask;
+	} CubeT;
+
+	static uint32_t ToWord(const Brg_FilterBitsT *pId);
+	static void ToFilterBits(uint32_t Word, Brg_FilterBitsT *pBits);
+	static int CompareWords(const void *pA, const void *pB);
+
+	static uint32_t GetSlotWeight(const CubeT *pCube);
+	static uint64_t GetCubeSize(const CubeT *pCube);
+	uint32_t GetMaskSlotExactNb(uint32_t StdExactNb, uint32_t Mask16Nb) const;
+	uint32_t GetBankNb(void) const;
+	bool MergeStep(void);
+	void ShrinkCubes(void);
+
+	void BuildBanks(void);
+	uint64_t CountUnion(const uint32_t *pIdx, uint32_t IdxNb, int Bit, uint32_t *pScratch) const;
+	void FillReport(void);
+
+	void Reset(void);
+
+	uint32_t *m_pWanted;     // desired words, sorted
+	uint32_t m_wantedNb;
+	CubeT *m_pCubes;
+	uint32_t m_cubeNb;
+
+	bool m_bPlanned;
+	uint8_t m_firstBankNb;
+	uint8_t m_bankMax;
+	Brg_CanRxFifoT m_fifo;
+	Brg_CanFilterConfT m_banks[BRG_CAN_FILTER_BANK_NB];
+	Brg_CanFilterPlanT m_plan;
+};
+
+#endif //_BRIDGE_CAN_FILTER_H
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,746 @@
+/**
+  ******************************************************************************
+  * @file    bridge_can_isotp.cpp
+  * @author  MCD Application Team
+  * @brief   ISO-TP (ISO 15765-2) transport layer: segmentation, reassembly
+  *          and flow control on the BrgCanReceiver frames path
+  *          (see BrgCanIsoTp).
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup CAN
+ * @{
+ * Usage:\n
+ *   brg.InitCAN(&canInit, BRG_INIT_FULL);\n
+ *   brg.InitFilterCAN(&filterConf); // RxId of the links accepted\n
+ *   BrgCanReceiver receiver(brg);\n
+ *   BrgCanIsoTp isoTp(brg, receiver);\n
+ *   BrgCanIsoTp::GetDefaultLinkConf(&linkConf);\n
+ *   linkConf.TxId = 0x7E0; linkConf.RxId = 0x7E8;\n
+ *   isoTp.AddLink(&linkConf, &linkIdx);\n
+ *   BrgCanReceiver::GetDefaultConf(&rxConf);\n
+ *   rxConf.pHandler = &isoTp;\n
+ *   receiver.Start(&rxConf);\n
+ *   isoTp.Send(linkIdx, request, requestSize);\n
+ *   isoTp.Receive(linkIdx, response, sizeof(response), &responseSize, 2000);\n
+ *   receiver.Stop(); // before the BrgCanIsoTp is deleted
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_can_isotp.h"
+
+#include <chrono>
+#include <string.h>
+#include <thread>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private defines -----------------------------------------------------------*/
+// Frame type: protocol control information, high nibble of the first byte
+#define ISOTP_PCI_SF 0x00  // Single frame
+#define ISOTP_PCI_FF 0x10  // First frame
+#define ISOTP_PCI_CF 0x20  // Consecutive frame
+#define ISOTP_PCI_FC 0x30  // Flow control
+// Flow status of a flow control frame
+#define ISOTP_FS_CTS   0
+#define ISOTP_FS_WAIT  1
+#define ISOTP_FS_OVFLW 2
+// Data bytes of a single frame, of a first frame (FF_DL on 12bit, or escape sequence with FF_DL on 32bit
+// for the messages of more than ISOTP_FF_DL_MAX bytes) and of a consecutive frame
+#define ISOTP_SF_DATA_MAX    7
+#define ISOTP_FF_DATA_NB     6
+#define ISOTP_FF_ESC_DATA_NB 2
+#define ISOTP_CF_DATA_MAX    7
+#define ISOTP_FF_DL_MAX      4095
+// Reserved STmin values are handled as the longest one (127 ms)
+#define ISOTP_STMIN_MAX_MS 127
+// End of the STmin waits done by polling the clock (sleep granularity is coarse)
+#define ISOTP_SPIN_WAIT_NS 1000000
+
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Global variables ----------------------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+/*
+ * Wait until the given time (BrgCanReceiver::GetTimeNs() base): sleep for the most part, then poll the clock.
+ */
+static void IsoTpWaitUntilNs(uint64_t DeadlineNs)
+{
+	uint64_t nowNs = BrgCanReceiver::GetTimeNs();
+
+	while( nowNs < DeadlineNs ) {
+		if( (DeadlineNs - nowNs) > ISOTP_SPIN_WAIT_NS ) {
+			std::this_thread::sleep_for(std::chrono::nanoseconds(DeadlineNs - nowNs - ISOTP_SPIN_WAIT_NS/2));
+		} else {
+			std::this_thread::yield();
+		}
+		nowNs = BrgCanReceiver::GetTimeNs();
+	}
+}
+
+/* Class Functions Definition ------------------------------------------------*/
+
+/**
+ * @ingroup CAN
+ * @brief BrgCanIsoTp constructor.
+ * @param[in]  BrgDevice  Bridge with CAN initialized, its filters accepting the RxId of the links.
+ * @param[in]  Receiver   Receiver of BrgDevice, to be started with the BrgCanIsoTp as frames handler (pHandler
+ *             of #Brg_CanRxConfT). Both must not be deleted before the BrgCanIsoTp.
+ */
+BrgCanIsoTp::BrgCanIsoTp(Brg &BrgDevice, BrgCanReceiver &Receiver): m_brg(BrgDevice), m_receiver(Receiver),
+	m_linkNb(0)
+{
+	uint8_t i;
+
+	for( i = 0; i < BRG_CAN_ISOTP_LINK_MAX; i++ ) {
+		m_links[i].pRxBuf = NULL;
+		m_links[i].pRxSizes = NULL;
+	}
+}
+/**
+ * @ingroup CAN
+ * @brief BrgCanIsoTp destructor: the BrgCanReceiver using it must be stopped before.
+ */
+BrgCanIsoTp::~BrgCanIsoTp(void)
+{
+	uint8_t i;
+
+	for( i = 0; i < BRG_CAN_ISOTP_LINK_MAX; i++ ) {
+		delete [] m_links[i].pRxBuf;
+		delete [] m_links[i].pRxSizes;
+	}
+}
+/**
+ * @ingroup CAN
+ * @brief This routine fills a #Brg_CanIsoTpLinkConfT with the default values: standard identifiers 0x7E0
+ * (sent) and 0x7E8 (received) of an OBD tester, no block size, STmin 0, padding with 0xCC, messages up to
+ * 4095 bytes (BRG_CAN_ISOTP_xxx_DEFAULT).
+ * @param[out] pConf  Parameters.
+ */
+void BrgCanIsoTp::GetDefaultLinkConf(Brg_CanIsoTpLinkConfT *pConf)
+{
+	if( pConf == NULL ) {
+		return;
+	}
+	pConf->IDE = CAN_ID_STANDARD;
+	pConf->TxId = 0x7E0;
+	pConf->RxId = 0x7E8;
+	pConf->BlockSize = 0;
+	pConf->STmin = 0;
+	pConf->bPadding = true;
+	pConf->PadByte = 0xCC;
+	pConf->RxSizeMax = BRG_CAN_ISOTP_RX_SIZE_DEFAULT;
+	pConf->RxMsgNb = BRG_CAN_ISOTP_RX_MSG_NB_DEFAULT;
+	pConf->TimeoutMs = BRG_CAN_ISOTP_TIMEOUT_MS_DEFAULT;
+	pConf->WftMax = BRG_CAN_ISOTP_WFT_MAX_DEFAULT;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine adds a link (pair of identifiers to a peer) and allocates its reassembly buffers.
+ * @param[in]  pConf     Parameters (see GetDefaultLinkConf()).
+ * @param[out] pLinkIdx  Index of the link for Send(), Receive() and GetStats().
+ *
+ * @retval #BRG_PARAM_ERR If a parameter is not supported (identifier out of range, TxId equal to RxId, RxId
+ *         already used by a link, reserved STmin, RxMsgNb 0 ...) or #BRG_CAN_ISOTP_LINK_MAX links already added
+ * @retval #BRG_MEM_ALLOC_ERR If the buffers cannot be allocated
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanIsoTp::AddLink(const Brg_CanIsoTpLinkConfT *pConf, uint8_t *pLinkIdx)
+{
+	LinkT *pLink;
+	uint8_t *pRxBuf;
+	uint32_t *pRxSizes;
+	uint32_t idMax;
+
+	if( (pConf == NULL) || (pLinkIdx == NULL) ) {
+		return BRG_PARAM_ERR;
+	}
+	idMax = (pConf->IDE == CAN_ID_EXTENDED) ? 0x1FFFFFFF : 0x7FF;
+	if( (pConf->TxId > idMax) || (pConf->RxId > idMax) || (pConf->TxId == pConf->RxId)
+	    || (pConf->RxSizeMax == 0) || (pConf->RxMsgNb == 0) || (pConf->TimeoutMs == 0)
+	    || ((pConf->STmin > ISOTP_STMIN_MAX_MS) && ((pConf->STmin < 0xF1) || (pConf->STmin > 0xF9)))
+	    || ((uint64_t)pConf->RxMsgNb*pConf->RxSizeMax > (uint64_t)((size_t)-1)) ) {
+		return BRG_PARAM_ERR;
+	}
+	pRxBuf = new uint8_t[(size_t)pConf->RxMsgNb*pConf->RxSizeMax];
+	pRxSizes = new uint32_t[pConf->RxMsgNb];
+	if( (pRxBuf == NULL) || (pRxSizes == NULL) ) {
+		delete [] pRxBuf;
+		delete [] pRxSizes;
+		return BRG_MEM_ALLOC_ERR;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if( (m_linkNb >= BRG_CAN_ISOTP_LINK_MAX) || (FindLink(pConf->IDE, pConf->RxId) != NULL) ) {
+		delete [] pRxBuf;
+		delete [] pRxSizes;
+		return BRG_PARAM_ERR;
+	}
+	pLink = &m_links[m_linkNb];
+	pLink->Conf = *pConf;
+	pLink->pRxBuf = pRxBuf;
+	pLink->pRxSizes = pRxSizes;
+	pLink->RxFirst = 0;
+	pLink->RxReadyNb = 0;
+	pLink->bRxActive = false;
+	pLink->RxSize = 0;
+	pLink->RxDoneNb = 0;
+	pLink->RxSn = 0;
+	pLink->RxBlockNb = 0;
+	pLink->RxLastNs = 0;
+	pLink->TxState = TX_IDLE;
+	pLink->FcStatus = 0;
+	pLink->FcBlockSize = 0;
+	pLink->FcSTmin = 0;
+	memset(&pLink->Stats, 0, sizeof(pLink->Stats));
+	pLink->FcSumUs = 0;
+	pLink->FcNb = 0;
+	*pLinkIdx = m_linkNb;
+	m_linkNb++;
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine sends a message to the peer of a link and returns when its last frame is sent: single
+ * frame up to 7 bytes, else first frame and consecutive frames as allowed by the flow control frames of the
+ * peer (block size, STmin, FC WAIT). The BrgCanReceiver must be started.
+ * @param[in]  LinkIdx      Link, see AddLink().
+ * @param[in]  pData        Message.
+ * @param[in]  SizeInBytes  Message size (min 1).
+ *
+ * @retval #BRG_PARAM_ERR If a parameter is not supported
+ * @retval #BRG_TARGET_CMD_TIMEOUT If no flow control frame was received within TimeoutMs (N_Bs)
+ * @retval #BRG_OVERRUN_ERR If the peer answered with an overflow flow control frame (message too big)
+ * @retval #BRG_CAN_ERR If the peer sent more than WftMax FC WAIT or an invalid flow status
+ * @retval #BRG_NO_ERR If no error
+ * @retval Other Brg::WriteMsgCAN() and Brg::ExecuteBatch() errors
+ */
+Brg_StatusT BrgCanIsoTp::Send(uint8_t LinkIdx, const uint8_t *pData, uint32_t SizeInBytes)
+{
+	LinkT *pLink;
+	Brg_StatusT brgStat;
+	uint64_t stminNs, nextNs;
+	uint32_t doneNb, chunkSize, chunkNb, blockNb;
+	uint8_t frame[8];
+	uint8_t sn, blockSize;
+
+	if( (pData == NULL) || (SizeInBytes == 0) ) {
+		return BRG_PARAM_ERR;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if( LinkIdx >= m_linkNb ) {
+			return BRG_PARAM_ERR;
+		}
+	}
+	pLink = &m_links[LinkIdx];
+
+	std::lock_guard<std::mutex> txLock(pLink->TxLock);
+
+	if( SizeInBytes <= ISOTP_SF_DATA_MAX ) {
+		frame[0] = (uint8_t)(ISOTP_PCI_SF | SizeInBytes);
+		memcpy(&frame[1], pData, SizeInBytes);
+		brgStat = WriteFrame(pLink, frame, PadFrame(pLink, frame, (uint8_t)(SizeInBytes + 1)));
+	} else {
+		if( SizeInBytes <= ISOTP_FF_DL_MAX ) {
+			frame[0] = (uint8_t)(ISOTP_PCI_FF | (SizeInBytes >> 8));
+			frame[1] = (uint8_t)SizeInBytes;
+			doneNb = ISOTP_FF_DATA_NB;
+		} else {
+			frame[0] = ISOTP_PCI_FF;
+			frame[1] = 0;
+			frame[2] = (uint8_t)(SizeInBytes >> 24);
+			frame[3] = (uint8_t)(SizeInBytes >> 16);
+			frame[4] = (uint8_t)(SizeInBytes >> 8);
+			frame[5] = (uint8_t)SizeInBytes;
+			doneNb = ISOTP_FF_ESC_DATA_NB;
+		}
+		memcpy(&frame[8 - doneNb], pData, doneNb);
+		{
+			// Before the frame is sent: its FC may be processed before WriteFrame() returns
+			std::lock_guard<std::mutex> lock(m_mutex);
+			pLink->TxState = TX_WAIT_FC;
+		}
+		brgStat = WriteFrame(pLink, frame, 8);
+		sn = 1;
+
+		while( (brgStat == BRG_NO_ERR) && (doneNb < SizeInBytes) ) {
+			brgStat = WaitFlowControl(pLink, &blockSize, &stminNs);
+			// CFs of the block: by batches with STmin 0, else one by one
+			blockNb = 0;
+			nextNs = 0;
+			while( (brgStat == BRG_NO_ERR) && (doneNb < SizeInBytes)
+			       && ((blockSize == 0) || (blockNb < blockSize)) ) {
+				chunkNb = (stminNs == 0) ? BRG_CAN_ISOTP_BATCH_MAX : 1;
+				if( (blockSize != 0) && (chunkNb > (uint32_t)(blockSize - blockNb)) ) {
+					chunkNb = blockSize - blockNb;
+				}
+				chunkSize = chunkNb*ISOTP_CF_DATA_MAX;
+				if( chunkSize > (SizeInBytes - doneNb) ) {
+					chunkSize = SizeInBytes - doneNb;
+					chunkNb = (chunkSize + ISOTP_CF_DATA_MAX - 1)/ISOTP_CF_DATA_MAX;
+				}
+				blockNb += chunkNb;
+				if( (blockSize != 0) && (blockNb == blockSize) && ((doneNb + chunkSize) < SizeInBytes) ) {
+					std::lock_guard<std::mutex> lock(m_mutex);
+					pLink->TxState = TX_WAIT_FC;
+				}
+				if( stminNs != 0 ) {
+					IsoTpWaitUntilNs(nextNs);
+				}
+				brgStat = SendConsecutive(pLink, &pData[doneNb], chunkSize, &sn);
+				nextNs = BrgCanReceiver::GetTimeNs() + stminNs;
+				doneNb += chunkSize;
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	pLink->TxState = TX_IDLE;
+	if( brgStat == BRG_NO_ERR ) {
+		pLink->Stats.TxMsgNb++;
+	} else {
+		pLink->Stats.TxErrorNb++;
+		pLink->Stats.LastError = brgStat;
+	}
+	return brgStat;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine gets the oldest message received on a link, waiting for it if none is ready.
+ * @param[in]  LinkIdx         Link, see AddLink().
+ * @param[out] pBuffer         Message.
+ * @param[in]  BufSizeInBytes  pBuffer size.
+ * @param[out] pSizeInBytes    Message size.
+ * @param[in]  TimeoutMs       Max wait, 0 to return at once.
+ *
+ * @retval #BRG_PARAM_ERR If a parameter is not supported, or pBuffer is too small for the message: the
+ *         message is kept, *pSizeInBytes gives its size
+ * @retval #BRG_TARGET_CMD_TIMEOUT If no message was received within TimeoutMs
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanIsoTp::Receive(uint8_t LinkIdx, uint8_t *pBuffer, uint32_t BufSizeInBytes,
+                                 uint32_t *pSizeInBytes, uint32_t TimeoutMs)
+{
+	LinkT *pLink;
+	const uint8_t *pMsg;
+	uint32_t size;
+
+	if( (pBuffer == NULL) || (pSizeInBytes == NULL) ) {
+		return BRG_PARAM_ERR;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if( LinkIdx >= m_linkNb ) {
+			return BRG_PARAM_ERR;
+		}
+	}
+	pLink = &m_links[LinkIdx];
+
+	std::lock_guard<std::mutex> rxLock(pLink->RxLock);
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if( pLink->CvRx.wait_for(lock, std::chrono::milliseconds(TimeoutMs),
+	                         [pLink]{ return pLink->RxReadyNb > 0; }) == false ) {
+		return BRG_TARGET_CMD_TIMEOUT;
+	}
+	size = pLink->pRxSizes[pLink->RxFirst];
+	*pSizeInBytes = size;
+	if( size > BufSizeInBytes ) {
+		return BRG_PARAM_ERR;
+	}
+	// Buffer not reused by the worker until released below
+	pMsg = &pLink->pRxBuf[(size_t)pLink->RxFirst*pLink->Conf.RxSizeMax];
+	lock.unlock();
+	memcpy(pBuffer, pMsg, size);
+	lock.lock();
+	pLink->RxFirst = (uint8_t)((pLink->RxFirst + 1) % pLink->Conf.RxMsgNb);
+	pLink->RxReadyNb--;
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine gets the statistics of a link since AddLink().
+ * @param[in]  LinkIdx  Link, see AddLink().
+ * @param[out] pStats   Statistics.
+ * @retval #BRG_PARAM_ERR If a parameter is not supported
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanIsoTp::GetStats(uint8_t LinkIdx, Brg_CanIsoTpStatsT *pStats)
+{
+	if( pStats == NULL ) {
+		return BRG_PARAM_ERR;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if( LinkIdx >= m_linkNb ) {
+		return BRG_PARAM_ERR;
+	}
+	*pStats = m_links[LinkIdx].Stats;
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup CAN
+ * @brief BrgCanRxHandler routine, called by the BrgCanReceiver worker for each received frame: the frames of
+ * the links are processed (reassembly, FC sent, FC given to Send()) and consumed, other frames are left to
+ * the receiver queue.
+ * @param[in]  pFrame  Received frame.
+ * @retval true If the frame belongs to a link.
+ */
+bool BrgCanIsoTp::OnCanFrame(const Brg_CanRxFrameT *pFrame)
+{
+	const uint8_t *pData = pFrame->Data;
+	LinkT *pLink;
+	Brg_StatusT brgStat;
+	uint32_t size, offset, copyNb;
+	uint8_t fc[8];
+	uint8_t fcSize = 0, dlc;
+
+	if( pFrame->Msg.RTR != CAN_DATA_FRAME ) {
+		return false;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	pLink = FindLink(pFrame->Msg.IDE, pFrame->Msg.ID);
+	if( pLink == NULL ) {
+		return false;
+	}
+	pLink->Stats.RxFrameNb++;
+	dlc = (pFrame->Msg.DLC <= 8) ? pFrame->Msg.DLC : 8;
+	if( dlc == 0 ) {
+		return true;
+	}
+
+	switch( pData[0] & 0xF0 ) {
+		case ISOTP_PCI_SF:
+			size = pData[0] & 0x0F;
+			if( (size == 0) || (size >= dlc) ) {
+				pLink->Stats.RxErrorNb++;
+				break;
+			}
+			// A new message terminates the reception in progress
+			if( pLink->bRxActive == true ) {
+				EndReception(pLink, false);
+			}
+			if( (size > pLink->Conf.RxSizeMax) || (pLink->RxReadyNb >= pLink->Conf.RxMsgNb) ) {
+				pLink->Stats.RxOverflowNb++;
+				break;
+			}
+			pLink->RxSize = size;
+			pLink->RxDoneNb = size;
+			memcpy(&pLink->pRxBuf[(size_t)((pLink->RxFirst + pLink->RxReadyNb) % pLink->Conf.RxMsgNb)
+			                      *pLink->Conf.RxSizeMax], &pData[1], size);
+			EndReception(pLink, true);
+			break;
+
+		case ISOTP_PCI_FF:
+			if( dlc < 8 ) {
+				pLink->Stats.RxErrorNb++;
+				break;
+			}
+			size = ((uint32_t)(pData[0] & 0x0F) << 8) | pData[1];
+			offset = 8 - ISOTP_FF_DATA_NB;
+			if( size == 0 ) {
+				size = ((uint32_t)pData[2] << 24) | ((uint32_t)pData[3] << 16) | ((uint32_t)pData[4] << 8) | pData[5];
+				offset = 8 - ISOTP_FF_ESC_DATA_NB;
+				if( size <= ISOTP_FF_DL_MAX ) {
+					pLink->Stats.RxErrorNb++;
+					break;
+				}
+			} else if( size <= ISOTP_SF_DATA_MAX ) {
+				pLink->Stats.RxErrorNb++;
+				break;
+			}
+			if( pLink->bRxActive == true ) {
+				EndReception(pLink, false);
+			}
+			if( (size > pLink->Conf.RxSizeMax) || (pLink->RxReadyNb >= pLink->Conf.RxMsgNb) ) {
+				pLink->Stats.RxOverflowNb++;
+				fcSize = BuildFlowControl(pLink, ISOTP_FS_OVFLW, fc);
+				break;
+			}
+			pLink->bRxActive = true;
+			pLink->RxSize = size;
+			pLink->RxDoneNb = 8 - offset;
+			pLink->RxSn = 1;
+			pLink->RxBlockNb = 0;
+			pLink->RxLastNs = pFrame->TimestampNs;
+			memcpy(&pLink->pRxBuf[(size_t)((pLink->RxFirst + pLink->RxReadyNb) % pLink->Conf.RxMsgNb)
+			                      *pLink->Conf.RxSizeMax], &pData[offset], pLink->RxDoneNb);
+			fcSize = BuildFlowControl(pLink, ISOTP_FS_CTS, fc);
+			break;
+
+		case ISOTP_PCI_CF:
+			if( pLink->bRxActive == false ) {
+				break;
+			}
+			if( ((pFrame->TimestampNs > pLink->RxLastNs)
+			     && ((pFrame->TimestampNs - pLink->RxLastNs) > (uint64_t)pLink->Conf.TimeoutMs*1000000))
+			    || ((pData[0] & 0x0F) != pLink->RxSn) ) {
+				// N_Cr timeout or frame lost
+				EndReception(pLink, false);
+				break;
+			}
+			copyNb = pLink->RxSize - pLink->RxDoneNb;
+			if( copyNb > ISOTP_CF_DATA_MAX ) {
+				copyNb = ISOTP_CF_DATA_MAX;
+			}
+			if( dlc < (copyNb + 1) ) {
+				EndReception(pLink, false);
+				break;
+			}
+			memcpy(&pLink->pRxBuf[(size_t)((pLink->RxFirst + pLink->RxReadyNb) % pLink->Conf.RxMsgNb)
+			                      *pLink->Conf.RxSizeMax + pLink->RxDoneNb], &pData[1], copyNb);
+			pLink->RxDoneNb += copyNb;
+			pLink->RxSn = (uint8_t)((pLink->RxSn + 1) & 0x0F);
+			pLink->RxLastNs = pFrame->TimestampNs;
+			if( pLink->RxDoneNb == pLink->RxSize ) {
+				EndReception(pLink, true);
+			} else if( pLink->Conf.BlockSize != 0 ) {
+				pLink->RxBlockNb++;
+				if( pLink->RxBlockNb == pLink->Conf.BlockSize ) {
+					pLink->RxBlockNb = 0;
+					fcSize = BuildFlowControl(pLink, ISOTP_FS_CTS, fc);
+				}
+			}
+			break;
+
+		case ISOTP_PCI_FC:
+			if( (pLink->TxState != TX_WAIT_FC) || (dlc < 3) ) {
+				break;
+			}
+			pLink->FcStatus = (uint8_t)(pData[0] & 0x0F);
+			pLink->FcBlockSize = pData[1];
+			pLink->FcSTmin = pData[2];
+			pLink->TxState = TX_FC_RECEIVED;
+			pLink->CvTx.notify_one();
+			break;
+
+		default:
+			// Reserved frame type: ignored
+			break;
+	}
+	lock.unlock();
+
+	if( fcSize != 0 ) {
+		// FC sent at once, the receiver polling fast for the CFs it releases
+		brgStat = WriteFrame(pLink, fc, fcSize);
+		if( brgStat != BRG_NO_ERR ) {
+			lock.lock();
+			if( pLink->bRxActive == true ) {
+				EndReception(pLink, false);
+			}
+		} else if( fc[0] == (ISOTP_PCI_FC | ISOTP_FS_CTS) ) {
+			m_receiver.RequestFastPoll((uint32_t)pLink->Conf.TimeoutMs*1000);
+		}
+	}
+	return true;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine converts an STmin value of a flow control frame to ns.
+ * @param[in]  STmin  0x00-0x7F: ms, 0xF1-0xF9: 100-900 us, reserved values handled as 127 ms.
+ * @retval Min separation time between two consecutive frames in ns.
+ */
+uint64_t BrgCanIsoTp::GetSTminNs(uint8_t STmin)
+{
+	if( STmin <= ISOTP_STMIN_MAX_MS ) {
+		return (uint64_t)STmin*1000000;
+	}
+	if( (STmin >= 0xF1) && (STmin <= 0xF9) ) {
+		return (uint64_t)(STmin - 0xF0)*100000;
+	}
+	return (uint64_t)ISOTP_STMIN_MAX_MS*1000000;
+}
+/*
+ * private: link receiving the frames of this identifier, NULL if none (m_mutex locked)
+ */
+BrgCanIsoTp::LinkT *BrgCanIsoTp::FindLink(Brg_CanMsgIdT IDE, uint32_t ID)
+{
+	uint8_t i;
+
+	for( i = 0; i < m_linkNb; i++ ) {
+		if( (m_links[i].Conf.RxId == ID) && (m_links[i].Conf.IDE == IDE) ) {
+			return &m_links[i];
+		}
+	}
+	return NULL;
+}
+/*
+ * private: flow control frame of the link parameters, returns its size
+ */
+uint8_t BrgCanIsoTp::BuildFlowControl(const LinkT *pLink, uint8_t FlowStatus, uint8_t *pFrame) const
+{
+	pFrame[0] = (uint8_t)(ISOTP_PCI_FC | FlowStatus);
+	pFrame[1] = pLink->Conf.BlockSize;
+	pFrame[2] = pLink->Conf.STmin;
+	return PadFrame(pLink, pFrame, 3);
+}
+/*
+ * private: padding of a frame of Size bytes, returns the size to send
+ */
+uint8_t BrgCanIsoTp::PadFrame(const LinkT *pLink, uint8_t *pFrame, uint8_t Size) const
+{
+	if( pLink->Conf.bPadding == false ) {
+		return Size;
+	}
+	memset(&pFrame[Size], pLink->Conf.PadByte, 8 - Size);
+	return 8;
+}
+/*
+ * private: one frame sent on TxId
+ */
+Brg_StatusT BrgCanIsoTp::WriteFrame(LinkT *pLink, const uint8_t *pFrame, uint8_t Size)
+{
+	Brg_CanTxMsgT canMsg;
+	Brg_StatusT brgStat;
+
+	canMsg.IDE = pLink->Conf.IDE;
+	canMsg.ID = pLink->Conf.TxId;
+	canMsg.RTR = CAN_DATA_FRAME;
+	canMsg.DLC = Size;
+	brgStat = m_brg.WriteMsgCAN(&canMsg, pFrame, Size);
+	if( brgStat == BRG_NO_ERR ) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		pLink->Stats.TxFrameNb++;
+	}
+	return brgStat;
+}
+/*
+ * private: waits for the FC of the FF or last CF of a block sent (TxState TX_WAIT_FC): FC WAIT restart the
+ * wait (up to WftMax), returns the block size and STmin of an FC CTS
+ */
+Brg_StatusT BrgCanIsoTp::WaitFlowControl(LinkT *pLink, uint8_t *pBlockSize, uint64_t *pSTminNs)
+{
+	uint64_t startNs = BrgCanReceiver::GetTimeNs();
+	uint32_t fcUs;
+	uint8_t waitNb = 0;
+
+	m_receiver.RequestFastPoll((uint32_t)pLink->Conf.TimeoutMs*1000);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while( true ) {
+		if( pLink->CvTx.wait_for(lock, std::chrono::milliseconds(pLink->Conf.TimeoutMs),
+		                         [pLink]{ return pLink->TxState == TX_FC_RECEIVED; }) == false ) {
+			return BRG_TARGET_CMD_TIMEOUT;
+		}
+		if( pLink->FcStatus != ISOTP_FS_WAIT ) {
+			break;
+		}
+		// N_Bs restarted
+		pLink->Stats.FcWaitNb++;
+		waitNb++;
+		if( waitNb > pLink->Conf.WftMax ) {
+			return BRG_CAN_ERR;
+		}
+		pLink->TxState = TX_WAIT_FC;
+		startNs = BrgCanReceiver::GetTimeNs();
+		lock.unlock();
+		m_receiver.RequestFastPoll((uint32_t)pLink->Conf.TimeoutMs*1000);
+		lock.lock();
+	}
+	pLink->TxState = TX_IDLE;
+	if( pLink->FcStatus == ISOTP_FS_OVFLW ) {
+		return BRG_OVERRUN_ERR;
+	}
+	if( pLink->FcStatus != ISOTP_FS_CTS ) {
+		return BRG_CAN_ERR;
+	}
+
+	fcUs = (uint32_t)((BrgCanReceiver::GetTimeNs() - startNs)/1000);
+	if( (pLink->FcNb == 0) || (fcUs < pLink->Stats.MinFcUs) ) {
+		pLink->Stats.MinFcUs = fcUs;
+	}
+	if( fcUs > pLink->Stats.MaxFcUs ) {
+		pLink->Stats.MaxFcUs = fcUs;
+	}
+	pLink->FcNb++;
+	pLink->FcSumUs += fcUs;
+	pLink->Stats.MeanFcUs = (uint32_t)(pLink->FcSumUs/pLink->FcNb);
+	*pBlockSize = pLink->FcBlockSize;
+	*pSTminNs = GetSTminNs(pLink->FcSTmin);
+	return BRG_NO_ERR;
+}
+/*
+ * private: CFs of SizeInBytes bytes (at most BRG_CAN_ISOTP_BATCH_MAX frames) sent by one Brg::ExecuteBatch(),
+ * *pSn sequence number of the first one, updated
+ */
+Brg_StatusT BrgCanIsoTp::SendConsecutive(LinkT *pLink, const uint8_t *pData, uint32_t SizeInBytes, uint8_t *pSn)
+{
+	Brg_BatchOpT ops[BRG_CAN_ISOTP_BATCH_MAX];
+	uint8_t frames[BRG_CAN_ISOTP_BATCH_MAX][8];
+	Brg_StatusT brgStat;
+	uint32_t frameNb = 0, offset = 0, dataNb, sentNb, i;
+
+	while( (offset < SizeInBytes) && (frameNb < BRG_CAN_ISOTP_BATCH_MAX) ) {
+		dataNb = SizeInBytes - offset;
+		if( dataNb > ISOTP_CF_DATA_MAX ) {
+			dataNb = ISOTP_CF_DATA_MAX;
+		}
+		frames[frameNb][0] = (uint8_t)(ISOTP_PCI_CF | *pSn);
+		memcpy(&frames[frameNb][1], &pData[offset], dataNb);
+		ops[frameNb].OpType = BATCH_CAN_WRITE;
+		ops[frameNb].pTxBuffer = frames[frameNb];
+		ops[frameNb].SizeInBytes = PadFrame(pLink, frames[frameNb], (uint8_t)(dataNb + 1));
+		ops[frameNb].CanMsg.IDE = pLink->Conf.IDE;
+		ops[frameNb].CanMsg.ID = pLink->Conf.TxId;
+		ops[frameNb].CanMsg.RTR = CAN_DATA_FRAME;
+		ops[frameNb].CanMsg.DLC = (uint8_t)ops[frameNb].SizeInBytes;
+		*pSn = (uint8_t)((*pSn + 1) & 0x0F);
+		offset += dataNb;
+		frameNb++;
+	}
+	if( frameNb == 1 ) {
+		return WriteFrame(pLink, frames[0], (uint8_t)ops[0].SizeInBytes);
+	}
+	brgStat = m_brg.ExecuteBatch(ops, frameNb);
+
+	sentNb = frameNb;
+	if( brgStat != BRG_NO_ERR ) {
+		sentNb = 0;
+		for( i = 0; i < frameNb; i++ ) {
+			if( ops[i].Status == BRG_NO_ERR ) {
+				sentNb++;
+			}
+		}
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	pLink->Stats.TxFrameNb += sentNb;
+	return brgStat;
+}
+/*
+ * private: end of the reception in progress (m_mutex locked): complete message made available to Receive(),
+ * or reception aborted
+ */
+void BrgCanIsoTp::EndReception(LinkT *pLink, bool bComplete)
+{
+	pLink->bRxActive = false;
+	if( bComplete == false ) {
+		pLink->Stats.RxErrorNb++;
+		return;
+	}
+	pLink->pRxSizes[(pLink->RxFirst + pLink->RxReadyNb) % pLink->Conf.RxMsgNb] = pLink->RxSize;
+	pLink->RxReadyNb++;
+	pLink->Stats.RxMsgNb++;
+	pLink->CvRx.notify_one();
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,175 @@
+/**
+  ******************************************************************************
+  * @file    bridge_can_isotp.h
+  * @author  MCD Application Team
+  * @brief   Header for bridge_can_isotp.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup CAN
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BRIDGE_CAN_ISOTP_H
+#define _BRIDGE_CAN_ISOTP_H
+/* Includes ------------------------------------------------------------------*/
+#include "bridge.h"
+#include "bridge_can_rx.h"
+
+#include <condition_variable>
+#include <mutex>
+
+/* Exported types and constants ----------------------------------------------*/
+/// Max number of links of a BrgCanIsoTp
+#define BRG_CAN_ISOTP_LINK_MAX 8
+/// Max number of consecutive frames sent by one Brg::ExecuteBatch() (STmin 0)
+#define BRG_CAN_ISOTP_BATCH_MAX 16
+/// Default N_Bs/N_Cr timeout, see #Brg_CanIsoTpLinkConfT
+#define BRG_CAN_ISOTP_TIMEOUT_MS_DEFAULT 1000
+/// Default max received message size (max FF_DL without escape sequence), see #Brg_CanIsoTpLinkConfT
+#define BRG_CAN_ISOTP_RX_SIZE_DEFAULT 4095
+/// Default number of reassembly buffers, see #Brg_CanIsoTpLinkConfT
+#define BRG_CAN_ISOTP_RX_MSG_NB_DEFAULT 2
+/// Default max number of FC WAIT in a row, see #Brg_CanIsoTpLinkConfT
+#define BRG_CAN_ISOTP_WFT_MAX_DEFAULT 8
+
+/// ISO-TP link parameters (ISO 15765-2 normal addressing on classic CAN), see BrgCanIsoTp::AddLink()
+typedef struct {
+	Brg_CanMsgIdT IDE;   ///< Identifier type of TxId and RxId
+	uint32_t TxId;       ///< Identifier of the frames sent (SF, FF, CF, and FC of the received messages)
+	uint32_t RxId;       ///< Identifier of the frames received from the peer
+	uint8_t BlockSize;   ///< BS sent in the flow control frames: CFs received between two FCs (0: one FC
+	                     ///< per message)
+	uint8_t STmin;       ///< STmin sent in the flow control frames: 0x00-0x7F ms, 0xF1-0xF9 100-900 us
+	bool bPadding;       ///< Frames sent padded to 8 bytes with PadByte (else DLC of the bytes used)
+	uint8_t PadByte;     ///< Padding byte value
+	uint32_t RxSizeMax;  ///< Max size of a received message (size of a reassembly buffer), larger ones are
+	                     ///< refused with an overflow FC
+	uint8_t RxMsgNb;     ///< Number of reassembly buffers: received messages waiting for Receive() plus the
+	                     ///< one being received
+	uint16_t TimeoutMs;  ///< N_Bs (FC wait of a transmission) and N_Cr (CF wait of a reception) timeout
+	uint8_t WftMax;      ///< Max number of FC WAIT in a row before a transmission is aborted
+} Brg_CanIsoTpLinkConfT;
+
+/// Statistics of a link, see BrgCanIsoTp::GetStats()
+typedef struct {
+	uint32_t TxMsgNb;       ///< Messages sent
+	uint32_t TxErrorNb;     ///< Transmissions aborted (timeout, overflow FC, Brg error)
+	Brg_StatusT LastError;  ///< Last of these errors (#BRG_NO_ERR if none)
+	uint32_t RxMsgNb;       ///< Messages received
+	uint32_t RxErrorNb;     ///< Receptions aborted: N_Cr timeout, wrong sequence number, new FF/SF, format
+	uint32_t RxOverflowNb;  ///< Messages refused: larger than RxSizeMax or no free reassembly buffer
+	uint32_t TxFrameNb;     ///< CAN frames sent (FCs included)
+	uint32_t RxFrameNb;     ///< CAN frames received on RxId
+	uint32_t FcWaitNb;      ///< FC WAIT received
+	uint32_t MinFcUs;       ///< Min time from the FF or last CF of a block sent to the FC processed
+	uint32_t MaxFcUs;       ///< Max of this time
+	uint32_t MeanFcUs;      ///< Mean of this time
+} Brg_CanIsoTpStatsT;
+
+/* Class -------------------------------------------------------------------- */
+/// BrgCanIsoTp Class: ISO-TP (ISO 15765-2) transport layer on a Brg, for diagnostic transfers (UDS) of up
+/// to 4 GB: segmentation, reassembly and flow control, normal addressing on classic CAN.\n
+/// The frames are received by a BrgCanReceiver given the BrgCanIsoTp as frames handler (pHandler of
+/// #Brg_CanRxConfT): the frames of the links are processed in the receiver worker as soon as they are
+/// retrieved, other frames are queued for the application as usual. A reception sends its flow control
+/// frames from the worker, the FC received by a transmission wakes the sender at once, and the receiver
+/// polls at MinPollUs while an FC or a CF is expected (BrgCanReceiver::RequestFastPoll()).\n
+/// Send() transmits from the calling thread: CFs are sent by Brg::ExecuteBatch() batches when the peer
+/// asks for STmin 0 (a block without interleaved commands), else one by one, STmin apart. Received
+/// messages are reassembled into buffers allocated by AddLink() and read with Receive(): no allocation
+/// per message.\n
+/// Links can be added while the receiver runs. Send() and Receive() of the links can be called from
+/// several threads (calls on the same link are serialized).
+class BrgCanIsoTp : public BrgCanRxHandler
+{
+public:
+
+	BrgCanIsoTp(Brg &BrgDevice, BrgCanReceiver &Receiver);
+
+	virtual ~BrgCanIsoTp(void);
+
+	static void GetDefaultLinkConf(Brg_CanIsoTpLinkConfT *pConf);
+
+	Brg_StatusT AddLink(const Brg_CanIsoTpLinkConfT *pConf, uint8_t *pLinkIdx);
+
+	Brg_StatusT Send(uint8_t LinkIdx, const uint8_t *pData, uint32_t SizeInBytes);
+	Brg_StatusT Receive(uint8_t LinkIdx, uint8_t *pBuffer, uint32_t BufSizeInBytes, uint32_t *pSizeInBytes,
+	                    uint32_t TimeoutMs);
+
+	Brg_StatusT GetStats(uint8_t LinkIdx, Brg_CanIsoTpStatsT *pStats);
+
+	virtual bool OnCanFrame(const Brg_CanRxFrameT *pFrame);
+
+	static uint64_t GetSTminNs(uint8_t STmin);
+
+private:
+
+	// Transmission state of a link
+	typedef enum {
+		TX_IDLE = 0,    // No FC expected
+		TX_WAIT_FC,     // FF or last CF of a block sent
+		TX_FC_RECEIVED  // FC received, not yet processed by Send()
+	} TxStateT;
+
+	typedef struct {
+		Brg_CanIsoTpLinkConfT Conf;
+		// Reassembly buffers: RxMsgNb buffers of RxSizeMax bytes, RxReadyNb complete messages from RxFirst
+		uint8_t *pRxBuf;
+		uint32_t *pRxSizes;
+		uint8_t RxFirst;
+		uint8_t RxReadyNb;
+		// Reception in progress (receiver worker): FF_DL, bytes received, next SN, CFs since the last FC,
+		// time of the last frame
+		bool bRxActive;
+		uint32_t RxSize;
+		uint32_t RxDoneNb;
+		uint8_t RxSn;
+		uint8_t RxBlockNb;
+		uint64_t RxLastNs;
+		// Transmission in progress: last FC received
+		TxStateT TxState;
+		uint8_t FcStatus;
+		uint8_t FcBlockSize;
+		uint8_t FcSTmin;
+		// Serialize Send() and Receive() calls of the link
+		std::mutex TxLock;
+		std::mutex RxLock;
+		std::condition_variable CvTx;
+		std::condition_variable CvRx;
+		Brg_CanIsoTpStatsT Stats;
+		uint64_t FcSumUs;
+		uint32_t FcNb;
+	} LinkT;
+
+	LinkT *FindLink(Brg_CanMsgIdT IDE, uint32_t ID);
+	uint8_t BuildFlowControl(const LinkT *pLink, uint8_t FlowStatus, uint8_t *pFrame) const;
+	uint8_t PadFrame(const LinkT *pLink, uint8_t *pFrame, uint8_t Size) const;
+	Brg_StatusT WriteFrame(LinkT *pLink, const uint8_t *pFrame, uint8_t Size);
+	Brg_StatusT WaitFlowControl(LinkT *pLink, uint8_t *pBlockSize, uint64_t *pSTminNs);
+	Brg_StatusT SendConsecutive(LinkT *pLink, const uint8_t *pData, uint32_t SizeInBytes, uint8_t *pSn);
+	void EndReception(LinkT *pLink, bool bComplete);
+
+	Brg &m_brg;
+	BrgCanReceiver &m_receiver;
+
+	LinkT m_links[BRG_CAN_ISOTP_LINK_MAX];
+	uint8_t m_linkNb;
+
+	// Protect the links states, buffers indexes and statistics
+	std::mutex m_mutex;
+};
+
+#endif //_BRIDGE_CAN_ISOTP_H
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
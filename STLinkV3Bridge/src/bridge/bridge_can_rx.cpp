@@ -0,0 +1,469 @@
+/**
+  ******************************************************************************
+  * @file    bridge_can_rx.cpp
+  * @author  MCD Application Team
+  * @brief   Background CAN reception: worker thread polling the STLink at a
+  *          rate following the message rate, lock-free frame queue
+  *          (see BrgCanReceiver).
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup CAN
+ * @{
+ * Usage:\n
+ *   brg.InitCAN(&canInit, BRG_INIT_FULL);\n
+ *   brg.InitFilterCAN(&filterConf);\n
+ *   BrgCanReceiver receiver(brg);\n
+ *   receiver.Start();\n
+ *   while( bRun == true ) {\n
+ *     while( receiver.PopFrame(&frame) == true ) {\n
+ *       Process(&frame);\n
+ *     }\n
+ *     ... other processing ...\n
+ *   }\n
+ *   receiver.Stop();
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_can_rx.h"
+
+#include <chrono>
+#include <new>
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private defines -----------------------------------------------------------*/
+// Shortest CAN frame on the bus in bits (standard data frame without data, interframe space included,
+// no stuff bit)
+#define CAN_RX_FRAME_MIN_BITS 47
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Global variables ----------------------------------------------------------*/
+/* Class Functions Definition ------------------------------------------------*/
+
+/**
+ * @ingroup CAN
+ * @brief BrgCanReceiver constructor.
+ * @param[in]  BrgDevice  Bridge with CAN initialized (Brg::InitCAN() and Brg::InitFilterCAN()), must not
+ *             be deleted before the BrgCanReceiver.
+ */
+BrgCanReceiver::BrgCanReceiver(Brg &BrgDevice): m_brg(BrgDevice), m_pMsgs(NULL), m_pData(NULL),
+	m_bStarted(false), m_bStop(false), m_bWakeUp(false), m_fastPollEndNs(0), m_seqNb(0), m_pendingOverrun(CAN_RX_NO_OVERRUN), m_lastPollNs(0),
+	m_msgRate(0), m_pollNs(0), m_rttMinNs(0), m_lastReqNs(0), m_lastCountNs(0), m_frameMinNs(0)
+{
+	GetDefaultConf(&m_conf);
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+/**
+ * @ingroup CAN
+ * @brief BrgCanReceiver destructor: stops the worker thread.
+ */
+BrgCanReceiver::~BrgCanReceiver(void)
+{
+	Stop();
+	delete [] m_pMsgs;
+	delete [] m_pData;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine fills a #Brg_CanRxConfT with the default values (BRG_CAN_RX_xxx_DEFAULT).
+ * @param[out] pConf  Parameters.
+ */
+void BrgCanReceiver::GetDefaultConf(Brg_CanRxConfT *pConf)
+{
+	if( pConf == NULL ) {
+		return;
+	}
+	pConf->QueueSize = BRG_CAN_RX_QUEUE_DEFAULT;
+	pConf->MinPollUs = BRG_CAN_RX_MIN_POLL_US_DEFAULT;
+	pConf->MaxPollUs = BRG_CAN_RX_MAX_POLL_US_DEFAULT;
+	pConf->TargetMsgNb = BRG_CAN_RX_TARGET_MSG_NB_DEFAULT;
+	pConf->BitRate = 0;
+	pConf->pFilter = NULL;
+	pConf->pHandler = NULL;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine empties the frame queue, resets the statistics, starts the CAN message reception
+ * (Brg::StartMsgReceptionCAN()) and the worker thread.
+ * @param[in]  pConf  Parameters, NULL for the default ones (see GetDefaultConf()).
+ *
+ * @retval #BRG_NO_STLINK If Brg::OpenStlink() not called before
+ * @retval #BRG_PARAM_ERR If a parameter is not supported (MinPollUs > MaxPollUs, TargetMsgNb 0 ...)
+ * @retval #BRG_MEM_ALLOC_ERR If the buffers cannot be allocated
+ * @retval #BRG_NO_ERR If no error (or already started)
+ * @retval Other Brg::StartMsgReceptionCAN() errors
+ */
+Brg_StatusT BrgCanReceiver::Start(const Brg_CanRxConfT *pConf)
+{
+	Brg_CanRxConfT conf;
+	Brg_StatusT brgStat;
+
+	if( m_brg.GetIsStlinkConnected() == false ) {
+		return BRG_NO_STLINK;
+	}
+	if( pConf == NULL ) {
+		GetDefaultConf(&conf);
+	} else {
+		conf = *pConf;
+	}
+	if( (conf.MinPollUs > conf.MaxPollUs) || (conf.MaxPollUs == 0) || (conf.TargetMsgNb == 0) ) {
+		return BRG_PARAM_ERR;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if( m_bStarted == true ) {
+		return BRG_NO_ERR;
+	}
+	if( m_pMsgs == NULL ) {
+		m_pMsgs = new (std::nothrow) Brg_CanRxMsgT[BRG_CAN_RX_CHUNK_NB];
+		if( m_pMsgs == NULL ) {
+			return BRG_MEM_ALLOC_ERR;
+		}
+	}
+	if( m_pData == NULL ) {
+		m_pData = new (std::nothrow) uint8_t[BRG_CAN_RX_CHUNK_NB*8];
+		if( m_pData == NULL ) {
+			return BRG_MEM_ALLOC_ERR;
+		}
+	}
+	brgStat = m_queue.Init(sizeof(Brg_CanRxFrameT), conf.QueueSize);
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+	// Frames of the first poll spread from the reception start, but the STLink buffer may hold older ones
+	m_lastReqNs = 0;
+	m_lastCountNs = GetTimeNs();
+	brgStat = m_brg.StartMsgReceptionCAN();
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+
+	m_conf = conf;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_seqNb = 0;
+	m_pendingOverrun = CAN_RX_NO_OVERRUN;
+	m_lastPollNs = 0;
+	m_msgRate = 0;
+	m_pollNs = (uint64_t)m_conf.MinPollUs*1000;
+	m_rttMinNs = 0xFFFFFFFFFFFFFFFFULL;
+	m_frameMinNs = 0;
+	if( m_conf.BitRate != 0 ) {
+		m_frameMinNs = (uint64_t)CAN_RX_FRAME_MIN_BITS*1000000000/m_conf.BitRate;
+	}
+	m_stats.PollUs = m_conf.MinPollUs;
+	m_bStop = false;
+	m_bWakeUp = false;
+	m_fastPollEndNs = 0;
+	m_worker = std::thread(&BrgCanReceiver::WorkerLoop, this);
+	m_bStarted = true;
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine stops the worker thread (after the poll in progress) and the CAN message reception
+ * (Brg::StopMsgReceptionCAN()). The frames already queued can still be read with PopFrame().
+ */
+void BrgCanReceiver::Stop(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if( m_bStarted == false ) {
+			return;
+		}
+		m_bStop = true;
+	}
+	m_cvStop.notify_one();
+	m_worker.join();
+	m_brg.StopMsgReceptionCAN();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_bStarted = false;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine gets the oldest frame of the queue, without blocking.
+ * Must always be called from the same thread.
+ * @param[out] pFrame  Frame.
+ * @retval false If the queue is empty.
+ */
+bool BrgCanReceiver::PopFrame(Brg_CanRxFrameT *pFrame)
+{
+	if( pFrame == NULL ) {
+		return false;
+	}
+	return m_queue.Pop(pFrame);
+}
+/**
+ * @ingroup CAN
+ * @brief This routine makes the worker poll at MinPollUs intervals, whatever the message rate, for the
+ * given duration: for a frames handler waiting for an answer. The wait in progress is shortened at once.
+ * @param[in]  DurationUs  Duration from now (a longer request in progress is kept).
+ */
+void BrgCanReceiver::RequestFastPoll(uint32_t DurationUs)
+{
+	uint64_t endNs = GetTimeNs() + (uint64_t)DurationUs*1000;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if( endNs > m_fastPollEndNs ) {
+			m_fastPollEndNs = endNs;
+		}
+		m_bWakeUp = true;
+	}
+	m_cvStop.notify_one();
+}
+/**
+ * @ingroup CAN
+ * @brief This routine gets the statistics since Start().
+ * @param[out] pStats  Statistics.
+ */
+void BrgCanReceiver::GetStats(Brg_CanRxStatsT *pStats)
+{
+	if( pStats == NULL ) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	*pStats = m_stats;
+}
+/**
+ * @ingroup CAN
+ * @brief Time base of the frames: monotonic clock in ns, the one of StlinkCmdStats::GetTimeNs().
+ */
+uint64_t BrgCanReceiver::GetTimeNs(void)
+{
+	return StlinkCmdStats::GetTimeNs();
+}
+/*
+ * private: one poll of the STLink, the messages found are retrieved by chunks of BRG_CAN_RX_CHUNK_NB
+ * and queued. Returns the number of messages found, *pPollNs the end of the message count command.
+ */
+uint32_t BrgCanReceiver::Poll(uint64_t *pPollNs)
+{
+	Brg_CanRxFrameT dropped;
+	Brg_CanRxFrameT *pFrame;
+	Brg_StatusT brgStat;
+	uint32_t dropNb = 0, overrunNb = 0, filteredNb = 0, handledNb = 0, doneNb = 0;
+	uint64_t reqNs, countNs;
+	uint16_t msgNb, chunkNb, dataSize, dataOffset, i;
+
+	reqNs = GetTimeNs();
+	brgStat = m_brg.GetRxMsgNbCAN(&msgNb);
+	*pPollNs = GetTimeNs();
+	if( brgStat != BRG_NO_ERR ) {
+		msgNb = 0;
+	} else if( (*pPollNs - reqNs) < m_rttMinNs ) {
+		m_rttMinNs = *pPollNs - reqNs;
+	}
+	// Message count taken by the STLink when it received the command
+	countNs = reqNs + m_rttMinNs/2;
+	if( countNs > *pPollNs ) {
+		countNs = *pPollNs;
+	}
+
+	while( (brgStat == BRG_NO_ERR) && (doneNb < msgNb) ) {
+		chunkNb = (uint16_t)(msgNb - doneNb);
+		if( chunkNb > BRG_CAN_RX_CHUNK_NB ) {
+			chunkNb = BRG_CAN_RX_CHUNK_NB;
+		}
+		brgStat = m_brg.GetRxMsgCAN(m_pMsgs, chunkNb, m_pData, chunkNb*8, &dataSize);
+		if( brgStat == BRG_OVERRUN_ERR ) {
+			// STLink overrun flagged in the messages (data buffer always big enough): counted below
+			brgStat = BRG_NO_ERR;
+		}
+		if( brgStat != BRG_NO_ERR ) {
+			break;
+		}
+		if( m_conf.pFilter != NULL ) {
+			m_conf.pFilter->Evaluate(m_pMsgs, chunkNb, m_accept);
+		}
+		dataOffset = 0;
+		for( i = 0; i < chunkNb; i++ ) {
+			if( m_pMsgs[i].Overrun != CAN_RX_NO_OVERRUN ) {
+				overrunNb++;
+			}
+			if( (m_conf.pFilter != NULL) && (m_accept[i] == 0) ) {
+				// Data skipped, overrun flag kept for the next queued frame
+				if( (m_pMsgs[i].RTR == CAN_DATA_FRAME) && (m_pMsgs[i].DLC > 0) ) {
+					dataOffset = (uint16_t)(dataOffset + m_pMsgs[i].DLC);
+				}
+				if( m_pendingOverrun == CAN_RX_NO_OVERRUN ) {
+					m_pendingOverrun = m_pMsgs[i].Overrun;
+				}
+				filteredNb++;
+				continue;
+			}
+			pFrame = (Brg_CanRxFrameT *)m_queue.GetWriteSlot();
+			if( pFrame == NULL ) {
+				pFrame = &dropped;
+			}
+			SetFrameTime(pFrame, doneNb + i, msgNb, *pPollNs, countNs);
+			pFrame->Msg = m_pMsgs[i];
+			if( pFrame->Msg.Overrun == CAN_RX_NO_OVERRUN ) {
+				pFrame->Msg.Overrun = m_pendingOverrun;
+			}
+			m_pendingOverrun = CAN_RX_NO_OVERRUN;
+			if( (m_pMsgs[i].RTR == CAN_DATA_FRAME) && (m_pMsgs[i].DLC > 0) ) {
+				memcpy(pFrame->Data, &m_pData[dataOffset], (m_pMsgs[i].DLC <= 8) ? m_pMsgs[i].DLC : 8);
+				dataOffset = (uint16_t)(dataOffset + m_pMsgs[i].DLC);
+			}
+			if( (m_conf.pHandler != NULL) && (m_conf.pHandler->OnCanFrame(pFrame) == true) ) {
+				// Consumed: slot not committed, reused by the next frame
+				handledNb++;
+				continue;
+			}
+			pFrame->SeqNb = m_seqNb++;
+			if( pFrame == &dropped ) {
+				dropNb++;
+			} else {
+				m_queue.Commit();
+			}
+		}
+		doneNb += chunkNb;
+	}
+
+	if( brgStat == BRG_NO_ERR ) {
+		m_lastReqNs = reqNs;
+		m_lastCountNs = countNs;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.PollNb++;
+	m_stats.UsbRttUs = (uint32_t)(m_rttMinNs/1000);
+	if( msgNb == 0 ) {
+		m_stats.EmptyPollNb++;
+	}
+	if( msgNb > m_stats.MaxPollMsgNb ) {
+		m_stats.MaxPollMsgNb = msgNb;
+	}
+	m_stats.FrameNb += doneNb;
+	m_stats.DropNb += dropNb;
+	m_stats.FilteredNb += filteredNb;
+	m_stats.HandledNb += handledNb;
+	m_stats.OverrunNb += overrunNb;
+	if( brgStat != BRG_NO_ERR ) {
+		m_stats.ErrorNb++;
+		m_stats.LastError = brgStat;
+	}
+	return doneNb;
+}
+/*
+ * private: times of the frame Idx among the MsgNb frames found by the poll answered at AnswerNs, with
+ * the message count estimated at CountNs (see BrgCanReceiver)
+ */
+void BrgCanReceiver::SetFrameTime(Brg_CanRxFrameT *pFrame, uint32_t Idx, uint32_t MsgNb, uint64_t AnswerNs,
+                                  uint64_t CountNs) const
+{
+	uint64_t minNs, maxNs, estNs;
+
+	minNs = m_lastReqNs;
+	maxNs = AnswerNs;
+	if( (minNs != 0) && ((maxNs - minNs) > (uint64_t)(MsgNb - 1)*m_frameMinNs) ) {
+		minNs += (uint64_t)Idx*m_frameMinNs;
+		maxNs -= (uint64_t)(MsgNb - 1 - Idx)*m_frameMinNs;
+	}
+	estNs = m_lastCountNs;
+	if( CountNs > m_lastCountNs ) {
+		estNs += (CountNs - m_lastCountNs)*(Idx + 1)/MsgNb;
+	}
+	if( estNs < minNs ) {
+		estNs = minNs;
+	} else if( estNs > maxNs ) {
+		estNs = maxNs;
+	}
+	pFrame->TimestampNs = estNs;
+	pFrame->TimeMinNs = minNs;
+	pFrame->TimeMaxNs = maxNs;
+}
+/*
+ * private: message rate and next poll interval after a poll that found MsgNb messages.
+ * The rate follows an increase at once (no STLink buffer overrun at the start of a burst) and decreases
+ * smoothly; the interval is TargetMsgNb/rate within [MinPollUs, MaxPollUs].
+ */
+void BrgCanReceiver::UpdatePollInterval(uint32_t MsgNb, uint64_t PollNs)
+{
+	uint64_t rate, pollNs;
+
+	if( (m_lastPollNs != 0) && (PollNs > m_lastPollNs) ) {
+		rate = (uint64_t)MsgNb*1000000000/(PollNs - m_lastPollNs);
+		if( rate > m_msgRate ) {
+			m_msgRate = rate;
+		} else {
+			m_msgRate = (3*m_msgRate + rate)/4;
+		}
+	}
+	m_lastPollNs = PollNs;
+
+	if( m_msgRate == 0 ) {
+		pollNs = (uint64_t)m_conf.MaxPollUs*1000;
+	} else {
+		pollNs = (uint64_t)m_conf.TargetMsgNb*1000000000/m_msgRate;
+	}
+	if( pollNs < (uint64_t)m_conf.MinPollUs*1000 ) {
+		pollNs = (uint64_t)m_conf.MinPollUs*1000;
+	} else if( pollNs > (uint64_t)m_conf.MaxPollUs*1000 ) {
+		pollNs = (uint64_t)m_conf.MaxPollUs*1000;
+	}
+	m_pollNs = pollNs;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.MsgRate = (uint32_t)m_msgRate;
+	m_stats.PollUs = (uint32_t)(m_pollNs/1000);
+}
+/*
+ * private: interval until the next poll (m_mutex locked): the one of the message rate, MinPollUs during a
+ * RequestFastPoll()
+ */
+uint64_t BrgCanReceiver::GetPollIntervalNs(uint64_t NowNs) const
+{
+	if( (NowNs < m_fastPollEndNs) && (m_pollNs > (uint64_t)m_conf.MinPollUs*1000) ) {
+		return (uint64_t)m_conf.MinPollUs*1000;
+	}
+	return m_pollNs;
+}
+/*
+ * private: worker thread, polls the STLink until Stop()
+ */
+void BrgCanReceiver::WorkerLoop(void)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	uint64_t pollNs, nextNs, nowNs;
+	uint32_t msgNb;
+
+	while( m_bStop == false ) {
+		lock.unlock();
+		msgNb = Poll(&pollNs);
+		UpdatePollInterval(msgNb, pollNs);
+		lock.lock();
+		// Wait for the next poll, recomputed when woken up by RequestFastPoll()
+		while( m_bStop == false ) {
+			nowNs = GetTimeNs();
+			nextNs = pollNs + GetPollIntervalNs(nowNs);
+			if( nextNs <= nowNs ) {
+				break;
+			}
+			m_bWakeUp = false;
+			m_cvStop.wait_for(lock, std::chrono::nanoseconds(nextNs - nowNs),
+			                  [this]{ return (m_bStop == true) || (m_bWakeUp == true); });
+		}
+	}
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
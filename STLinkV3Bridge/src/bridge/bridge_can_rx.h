@@ -0,0 +1,199 @@
+/**
+  ******************************************************************************
+  * @file    bridge_can_rx.h
+  * @author  MCD Application Team
+  * @brief   Header for bridge_can_rx.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup CAN
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BRIDGE_CAN_RX_H
+#define _BRIDGE_CAN_RX_H
+/* Includes ------------------------------------------------------------------*/
+#include "bridge.h"
+#include "bridge_can_soft_filter.h"
+#include "bridge_spsc_ring.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/* Exported types and constants ----------------------------------------------*/
+class BrgCanRxHandler;
+
+/// Max number of messages retrieved by one Brg::GetRxMsgCAN() of the BrgCanReceiver
+#define BRG_CAN_RX_CHUNK_NB 128
+/// Default frame queue size, see #Brg_CanRxConfT
+#define BRG_CAN_RX_QUEUE_DEFAULT 4096
+/// Default min poll interval, see #Brg_CanRxConfT
+#define BRG_CAN_RX_MIN_POLL_US_DEFAULT 250
+/// Default max poll interval, see #Brg_CanRxConfT
+#define BRG_CAN_RX_MAX_POLL_US_DEFAULT 10000
+/// Default number of messages expected per poll, see #Brg_CanRxConfT
+#define BRG_CAN_RX_TARGET_MSG_NB_DEFAULT 32
+
+/// BrgCanReceiver::Start() parameters
+typedef struct {
+	uint32_t QueueSize;    ///< Min number of frames the queue can hold (rounded up to a power of 2)
+	uint32_t MinPollUs;    ///< Min interval between two polls of the STLink (high message rate)
+	uint32_t MaxPollUs;    ///< Max interval between two polls of the STLink (idle bus)
+	uint16_t TargetMsgNb;  ///< Messages expected per poll: the interval is TargetMsgNb / measured rate,
+	                       ///< must leave margin with the STLink RX buffer size
+	uint32_t BitRate;      ///< CAN bit rate in bit/s (see Brg::GetCANbaudratePrescal()), 0 if unknown:
+	                       ///< the min frame duration on the bus narrows the frame time bounds
+	const BrgCanSoftFilter *pFilter; ///< Host filter of the received frames, NULL to queue all of them: must
+	                       ///< not be modified or deleted before Stop()
+	BrgCanRxHandler *pHandler; ///< Frames handler called before queuing (see BrgCanRxHandler), or NULL: must
+	                       ///< not be deleted before Stop()
+} Brg_CanRxConfT;
+
+/// Frame delivered by BrgCanReceiver::PopFrame()
+typedef struct {
+	uint64_t TimestampNs;  ///< Estimated reception time, monotonic clock (std::chrono::steady_clock), see
+	                       ///< BrgCanReceiver: within [TimeMinNs, TimeMaxNs]
+	uint64_t TimeMinNs;    ///< The frame was received by the STLink after TimeMinNs (0 for the frames of
+	                       ///< the first poll: the STLink buffer may hold frames received before Start())
+	uint64_t TimeMaxNs;    ///< and before TimeMaxNs
+	uint32_t SeqNb;        ///< Frame number since Start(): a gap means frames dropped (queue full)
+	Brg_CanRxMsgT Msg;     ///< Message header (Overrun: frames lost by the STLink before this one)
+	uint8_t Data[8];       ///< Msg.DLC bytes for a data frame
+} Brg_CanRxFrameT;
+
+/// Statistics of a BrgCanReceiver, see BrgCanReceiver::GetStats()
+typedef struct {
+	uint32_t FrameNb;       ///< Frames retrieved from the STLink
+	uint32_t DropNb;        ///< Frames lost because the queue was full (application too slow)
+	uint32_t FilteredNb;    ///< Frames discarded by the host filter (pFilter of #Brg_CanRxConfT)
+	uint32_t HandledNb;     ///< Frames consumed by the frames handler (pHandler of #Brg_CanRxConfT)
+	uint32_t OverrunNb;     ///< Frames flagged with an STLink overrun (frames lost before them)
+	uint32_t PollNb;        ///< Brg::GetRxMsgNbCAN() calls
+	uint32_t EmptyPollNb;   ///< Polls that found no message
+	uint32_t MaxPollMsgNb;  ///< Max messages found by one poll
+	uint32_t ErrorNb;       ///< Brg errors (overrun excluded)
+	Brg_StatusT LastError;  ///< Last of these errors (#BRG_NO_ERR if none)
+	uint32_t MsgRate;       ///< Measured message rate (messages/s)
+	uint32_t PollUs;        ///< Current poll interval
+	uint32_t UsbRttUs;      ///< Min Brg::GetRxMsgNbCAN() duration (USB round trip used for the timestamps)
+} Brg_CanRxStatsT;
+
+/* Class -------------------------------------------------------------------- */
+/// BrgCanRxHandler Class: interface of a protocol layer (e.g. BrgCanIsoTp) taking its frames from the
+/// BrgCanReceiver worker as soon as they are retrieved, before they are queued.
+class BrgCanRxHandler
+{
+public:
+	virtual ~BrgCanRxHandler(void) {}
+
+	/// Frame accepted by the host filter, timestamped, called from the BrgCanReceiver worker thread in
+	/// reception order. Delays the next poll: may send a few Brg commands (e.g. Brg::WriteMsgCAN()) but must
+	/// not wait. Return true if the frame is consumed: it is not queued and takes no SeqNb.
+	virtual bool OnCanFrame(const Brg_CanRxFrameT *pFrame) = 0;
+};
+
+/// BrgCanReceiver Class: background reception of the CAN messages of a Brg.\n
+/// A worker thread owned by the BrgCanReceiver polls the STLink with Brg::GetRxMsgNbCAN() and retrieves
+/// the messages with Brg::GetRxMsgCAN() into preallocated buffers. The poll interval follows the measured
+/// message rate (about TargetMsgNb messages per poll, between MinPollUs and MaxPollUs): few USB commands
+/// on an idle bus, short intervals before the STLink buffer overruns under load.\n
+/// Frames are timestamped and pushed in a lock-free queue (BrgSpscRing) read by the application with
+/// PopFrame(), from a single thread, without blocking the worker. With a host filter (BrgCanSoftFilter),
+/// each chunk of messages is evaluated in one batch and the rejected frames are not queued (they take no
+/// SeqNb, and the overrun flag of a rejected frame is moved to the next queued one). A frames handler
+/// (BrgCanRxHandler) sees each accepted frame before it is queued and can consume it; RequestFastPoll()
+/// lets it poll at MinPollUs while it expects an answer.\n
+/// The STLink does not timestamp the messages: the frames found by a poll were received between the
+/// message count of the previous poll and this one. The count is taken by the STLink during the
+/// Brg::GetRxMsgNbCAN() command, estimated at half the min USB round trip after its start. The n frames
+/// of a poll are spread evenly over the interval between the two estimated counts, in reception order.
+/// TimeMinNs and TimeMaxNs bound each frame with the start of the previous poll command and the end of
+/// this one, narrowed by the min frame duration when BitRate is given (a frame cannot end before the
+/// frames received before it are transferred, nor after the time needed by the ones received after it).
+/// The uncertainty is about the poll interval: lower MaxPollUs for a better time base on a quiet bus.\n
+/// Other Brg commands (e.g. Brg::WriteMsgCAN()) can be sent by other threads while started, but
+/// Brg::GetRxMsgNbCAN() and Brg::GetRxMsgCAN() must only be called by the BrgCanReceiver.
+class BrgCanReceiver
+{
+public:
+
+	BrgCanReceiver(Brg &BrgDevice);
+
+	virtual ~BrgCanReceiver(void);
+
+	static void GetDefaultConf(Brg_CanRxConfT *pConf);
+
+	Brg_StatusT Start(const Brg_CanRxConfT *pConf=NULL);
+	void Stop(void);
+
+	bool PopFrame(Brg_CanRxFrameT *pFrame);
+
+	void RequestFastPoll(uint32_t DurationUs);
+
+	void GetStats(Brg_CanRxStatsT *pStats);
+
+	static uint64_t GetTimeNs(void);
+
+private:
+
+	uint32_t Poll(uint64_t *pPollNs);
+	uint64_t GetPollIntervalNs(uint64_t NowNs) const;
+	void SetFrameTime(Brg_CanRxFrameT *pFrame, uint32_t Idx, uint32_t MsgNb, uint64_t AnswerNs,
+	                  uint64_t CountNs) const;
+	void UpdatePollInterval(uint32_t MsgNb, uint64_t PollNs);
+
+	void WorkerLoop(void);
+
+	Brg &m_brg;
+	Brg_CanRxConfT m_conf;
+
+	// GetRxMsgCAN() output, allocated by the first Start(), and host filter result
+	Brg_CanRxMsgT *m_pMsgs;
+	uint8_t *m_pData;
+	uint8_t m_accept[BRG_CAN_RX_CHUNK_NB];
+
+	// Frames from the worker (producer) to PopFrame() (consumer)
+	BrgSpscRing m_queue;
+
+	std::thread m_worker;
+	bool m_bStarted;
+	bool m_bStop;
+	// RequestFastPoll(): polls at MinPollUs until m_fastPollEndNs, worker woken up to shorten its wait
+	bool m_bWakeUp;
+	uint64_t m_fastPollEndNs;
+	uint32_t m_seqNb;
+	// Overrun flag of frames rejected by the host filter, for the next queued frame (worker only)
+	Brg_CanRxOverrunT m_pendingOverrun;
+
+	// Poll rate adaptation (worker only): previous poll time, message rate (messages/s, 1/4 smoothing)
+	uint64_t m_lastPollNs;
+	uint64_t m_msgRate;
+	uint64_t m_pollNs;
+
+	// Timestamps (worker only): min GetRxMsgNbCAN() duration, start and estimated count time of the
+	// previous poll, min frame duration (0 if BitRate unknown)
+	uint64_t m_rttMinNs;
+	uint64_t m_lastReqNs;
+	uint64_t m_lastCountNs;
+	uint64_t m_frameMinNs;
+
+	// Protect m_bStop, the fast poll request and the statistics
+	std::mutex m_mutex;
+	std::condition_variable m_cvStop;
+	Brg_CanRxStatsT m_stats;
+};
+
+#endif //_BRIDGE_CAN_RX_H
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,374 @@
+/**
+  ******************************************************************************
+  * @file    bridge_can_soft_filter.cpp
+  * @author  MCD Application Team
+  * @brief   Host CAN acceptance filter: bitmap of the standard identifiers,
+  *          hash set and ranges of the extended ones, batch evaluation of
+  *          received messages (see BrgCanSoftFilter).
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup CAN
+ * @{
+ * Usage:\n
+ *   BrgCanSoftFilter softFilter;\n
+ *   softFilter.AddIds(wantedIds, wantedNb);\n
+ *   BrgCanReceiver::GetDefaultConf(&rxConf);\n
+ *   rxConf.pFilter = &softFilter;\n
+ *   receiver.Start(&rxConf);
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_can_soft_filter.h"
+
+#include <string.h>
+#include <new>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private defines -----------------------------------------------------------*/
+// Empty hash slot (not a 29bit identifier)
+#define CAN_SOFT_FILTER_EMPTY 0xFFFFFFFFu
+// First hash set and range list sizes
+#define CAN_SOFT_FILTER_HASH_INIT 64
+#define CAN_SOFT_FILTER_RANGE_INIT 16
+// Messages evaluated at once by FilterArrays()
+#define CAN_SOFT_FILTER_CHUNK_NB 256
+
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Global variables ----------------------------------------------------------*/
+/* Class Functions Definition ------------------------------------------------*/
+
+/**
+ * @ingroup CAN
+ * @brief BrgCanSoftFilter constructor: no identifier accepted.
+ */
+BrgCanSoftFilter::BrgCanSoftFilter(void): m_pHash(NULL), m_hashSize(0), m_hashShift(32), m_extIdNb(0),
+	m_pRanges(NULL), m_rangeNb(0), m_rangeMax(0)
+{
+	memset(m_stdBitmap, 0, sizeof(m_stdBitmap));
+}
+/**
+ * @ingroup CAN
+ * @brief BrgCanSoftFilter destructor.
+ */
+BrgCanSoftFilter::~BrgCanSoftFilter(void)
+{
+	delete [] m_pHash;
+	delete [] m_pRanges;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine removes all the identifiers (buffers kept for the next ones).
+ */
+void BrgCanSoftFilter::Clear(void)
+{
+	memset(m_stdBitmap, 0, sizeof(m_stdBitmap));
+	if( m_pHash != NULL ) {
+		memset(m_pHash, 0xFF, m_hashSize*sizeof(uint32_t));
+	}
+	m_extIdNb = 0;
+	m_rangeNb = 0;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine adds an accepted identifier.
+ * @param[in]  IDE  Standard or extended identifier.
+ * @param[in]  ID   Identifier (max 0x7FF or 0x1FFFFFFF according to IDE).
+ *
+ * @retval #BRG_PARAM_ERR If ID is not coherent with IDE
+ * @retval #BRG_MEM_ALLOC_ERR If the hash set cannot be grown
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanSoftFilter::AddId(Brg_CanMsgIdT IDE, uint32_t ID)
+{
+	Brg_StatusT brgStat;
+	uint32_t slot;
+
+	if( IDE != CAN_ID_EXTENDED ) {
+		if( ID > 0x7FF ) {
+			return BRG_PARAM_ERR;
+		}
+		m_stdBitmap[ID>>6] |= 1ULL << (ID&63);
+		return BRG_NO_ERR;
+	}
+	if( ID > 0x1FFFFFFF ) {
+		return BRG_PARAM_ERR;
+	}
+	if( (m_extIdNb+1)*2 > m_hashSize ) {
+		brgStat = GrowHash();
+		if( brgStat != BRG_NO_ERR ) {
+			return brgStat;
+		}
+	}
+	for( slot = GetHashSlot(ID); m_pHash[slot] != CAN_SOFT_FILTER_EMPTY; slot = (slot+1) & (m_hashSize-1) ) {
+		if( m_pHash[slot] == ID ) {
+			return BRG_NO_ERR;
+		}
+	}
+	m_pHash[slot] = ID;
+	m_extIdNb++;
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine adds a range of accepted identifiers. Extended ranges are merged with the
+ * overlapping or contiguous ones.
+ * @param[in]  IDE      Standard or extended identifiers.
+ * @param[in]  FirstId  First identifier of the range.
+ * @param[in]  LastId   Last identifier of the range (included, max 0x7FF or 0x1FFFFFFF according to IDE).
+ *
+ * @retval #BRG_PARAM_ERR If FirstId > LastId or LastId not coherent with IDE
+ * @retval #BRG_MEM_ALLOC_ERR If the range list cannot be grown
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanSoftFilter::AddRange(Brg_CanMsgIdT IDE, uint32_t FirstId, uint32_t LastId)
+{
+	ExtRangeT *pRanges;
+	uint32_t id, pos, i, j;
+
+	if( (FirstId > LastId) || (LastId > ((IDE == CAN_ID_EXTENDED) ? 0x1FFFFFFFu : 0x7FFu)) ) {
+		return BRG_PARAM_ERR;
+	}
+	if( (IDE != CAN_ID_EXTENDED) || (FirstId == LastId) ) {
+		for( id=FirstId; id<LastId; id++ ) {
+			AddId(IDE, id);
+		}
+		return AddId(IDE, LastId);
+	}
+
+	if( m_rangeNb == m_rangeMax ) {
+		pRanges = new (std::nothrow) ExtRangeT[(m_rangeMax == 0) ? CAN_SOFT_FILTER_RANGE_INIT : m_rangeMax*2];
+		if( pRanges == NULL ) {
+			return BRG_MEM_ALLOC_ERR;
+		}
+		if( m_rangeNb != 0 ) {
+			memcpy(pRanges, m_pRanges, m_rangeNb*sizeof(ExtRangeT));
+		}
+		delete [] m_pRanges;
+		m_pRanges = pRanges;
+		m_rangeMax = (m_rangeMax == 0) ? CAN_SOFT_FILTER_RANGE_INIT : m_rangeMax*2;
+	}
+	// Insert sorted by FirstId
+	for( pos=m_rangeNb; (pos > 0) && (m_pRanges[pos-1].FirstId > FirstId); pos-- ) {
+		m_pRanges[pos] = m_pRanges[pos-1];
+	}
+	m_pRanges[pos].FirstId = FirstId;
+	m_pRanges[pos].LastId = LastId;
+	m_rangeNb++;
+	// Merge the overlapping or contiguous ranges
+	for( i=0, j=1; j<m_rangeNb; j++ ) {
+		if( (uint64_t)m_pRanges[i].LastId + 1 >= m_pRanges[j].FirstId ) {
+			if( m_pRanges[j].LastId > m_pRanges[i].LastId ) {
+				m_pRanges[i].LastId = m_pRanges[j].LastId;
+			}
+		} else {
+			m_pRanges[++i] = m_pRanges[j];
+		}
+	}
+	m_rangeNb = i+1;
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine adds accepted identifiers, e.g. the desired set given to BrgCanFilterPlanner::Plan().
+ * @param[in]  pIds   Identifiers (IDE and ID fields used, RTR not filtered).
+ * @param[in]  IdNb   Number of pIds.
+ *
+ * @retval #BRG_PARAM_ERR If pIds is NULL or an ID is not coherent with its IDE (the previous ones are added)
+ * @retval #BRG_MEM_ALLOC_ERR If the hash set cannot be grown
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanSoftFilter::AddIds(const Brg_FilterBitsT *pIds, uint32_t IdNb)
+{
+	Brg_StatusT brgStat = BRG_NO_ERR;
+	uint32_t i;
+
+	if( (pIds == NULL) && (IdNb != 0) ) {
+		return BRG_PARAM_ERR;
+	}
+	for( i=0; (i<IdNb) && (brgStat == BRG_NO_ERR); i++ ) {
+		brgStat = AddId(pIds[i].IDE, pIds[i].ID);
+	}
+	return brgStat;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine evaluates a batch of messages received by Brg::GetRxMsgCAN().
+ * @param[in]  pMsgs    Messages.
+ * @param[in]  MsgNb    Number of pMsgs.
+ * @param[out] pAccept  MsgNb bytes: 1 if the message is accepted, 0 if rejected.
+ *
+ * @retval Number of accepted messages (0 if a pointer is NULL)
+ */
+uint32_t BrgCanSoftFilter::Evaluate(const Brg_CanRxMsgT *pMsgs, uint32_t MsgNb, uint8_t *pAccept) const
+{
+	uint32_t i, id, acceptedNb = 0;
+
+	if( (pMsgs == NULL) || (pAccept == NULL) ) {
+		return 0;
+	}
+	for( i=0; i<MsgNb; i++ ) {
+		id = pMsgs[i].ID;
+		if( pMsgs[i].IDE == CAN_ID_EXTENDED ) {
+			pAccept[i] = (IsExtAccepted(id) == true) ? 1 : 0;
+		} else {
+			pAccept[i] = (uint8_t)((m_stdBitmap[(id>>6)&31] >> (id&63)) & 1);
+		}
+		acceptedNb += pAccept[i];
+	}
+	return acceptedNb;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine evaluates a batch of messages received by Brg::GetRxMsgArraysCAN().
+ * @param[in]  pId      MsgNb identifiers (pId of #Brg_CanRxArraysT).
+ * @param[in]  pFlags   MsgNb BRG_CAN_RX_FLAG_xxx (pFlags of #Brg_CanRxArraysT).
+ * @param[in]  MsgNb    Number of messages.
+ * @param[out] pAccept  MsgNb bytes: 1 if the message is accepted, 0 if rejected.
+ *
+ * @retval Number of accepted messages (0 if a pointer is NULL)
+ */
+uint32_t BrgCanSoftFilter::Evaluate(const uint32_t *pId, const uint8_t *pFlags, uint32_t MsgNb,
+                                    uint8_t *pAccept) const
+{
+	uint32_t i, id, acceptedNb = 0;
+
+	if( (pId == NULL) || (pFlags == NULL) || (pAccept == NULL) ) {
+		return 0;
+	}
+	for( i=0; i<MsgNb; i++ ) {
+		id = pId[i];
+		if( (pFlags[i] & BRG_CAN_RX_FLAG_IDE) != 0 ) {
+			pAccept[i] = (IsExtAccepted(id) == true) ? 1 : 0;
+		} else {
+			pAccept[i] = (uint8_t)((m_stdBitmap[(id>>6)&31] >> (id&63)) & 1);
+		}
+		acceptedNb += pAccept[i];
+	}
+	return acceptedNb;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine removes the rejected messages from arrays filled by Brg::GetRxMsgArraysCAN(): the
+ * accepted ones are moved to the first entries, in the same order.
+ * @param[in]  MsgNb    Number of messages in the arrays.
+ * @param[in]  pArrays  Arrays (pId and pFlags required, pDlc and pData compacted if not NULL).
+ *
+ * @retval Number of accepted messages, now in entries 0 to this number-1 (0 if a pointer is NULL)
+ */
+uint32_t BrgCanSoftFilter::FilterArrays(uint32_t MsgNb, const Brg_CanRxArraysT *pArrays) const
+{
+	uint8_t accept[CAN_SOFT_FILTER_CHUNK_NB];
+	uint32_t done, chunkNb, i, j, keptNb = 0;
+
+	if( (pArrays == NULL) || (pArrays->pId == NULL) || (pArrays->pFlags == NULL) ) {
+		return 0;
+	}
+	for( done=0; done<MsgNb; done+=chunkNb ) {
+		chunkNb = MsgNb - done;
+		if( chunkNb > CAN_SOFT_FILTER_CHUNK_NB ) {
+			chunkNb = CAN_SOFT_FILTER_CHUNK_NB;
+		}
+		Evaluate(&pArrays->pId[done], &pArrays->pFlags[done], chunkNb, accept);
+		for( i=0; i<chunkNb; i++ ) {
+			if( accept[i] == 0 ) {
+				continue;
+			}
+			j = done + i;
+			if( j != keptNb ) {
+				pArrays->pId[keptNb] = pArrays->pId[j];
+				pArrays->pFlags[keptNb] = pArrays->pFlags[j];
+				if( pArrays->pDlc != NULL ) {
+					pArrays->pDlc[keptNb] = pArrays->pDlc[j];
+				}
+				if( pArrays->pData != NULL ) {
+					memcpy(&pArrays->pData[keptNb*8], &pArrays->pData[j*8], 8);
+				}
+			}
+			keptNb++;
+		}
+	}
+	return keptNb;
+}
+
+/*
+ * private: extended identifier in the hash set or in a range
+ */
+bool BrgCanSoftFilter::IsExtAccepted(uint32_t ID) const
+{
+	const ExtRangeT *pRange;
+	uint32_t slot, n, half;
+
+	if( m_extIdNb != 0 ) {
+		for( slot = GetHashSlot(ID); m_pHash[slot] != CAN_SOFT_FILTER_EMPTY; slot = (slot+1) & (m_hashSize-1) ) {
+			if( m_pHash[slot] == ID ) {
+				return true;
+			}
+		}
+	}
+	if( m_rangeNb == 0 ) {
+		return false;
+	}
+	// Last range with FirstId <= ID (or first range), halving without unpredictable branch
+	pRange = m_pRanges;
+	for( n = m_rangeNb; n > 1; n -= half ) {
+		half = n / 2;
+		pRange = (pRange[half].FirstId <= ID) ? &pRange[half] : pRange;
+	}
+	return (pRange->FirstId <= ID) && (ID <= pRange->LastId);
+}
+/*
+ * private: first hash slot of an identifier (multiplicative hash, high bits)
+ */
+uint32_t BrgCanSoftFilter::GetHashSlot(uint32_t ID) const
+{
+	return (uint32_t)((ID * 0x9E3779B1u) >> m_hashShift);
+}
+/*
+ * private: doubles the hash set (first allocation of CAN_SOFT_FILTER_HASH_INIT slots)
+ */
+Brg_StatusT BrgCanSoftFilter::GrowHash(void)
+{
+	uint32_t *pOldHash = m_pHash;
+	uint32_t oldSize = m_hashSize, i, slot;
+
+	m_hashSize = (oldSize == 0) ? CAN_SOFT_FILTER_HASH_INIT : oldSize*2;
+	m_pHash = new (std::nothrow) uint32_t[m_hashSize];
+	if( m_pHash == NULL ) {
+		m_pHash = pOldHash;
+		m_hashSize = oldSize;
+		return BRG_MEM_ALLOC_ERR;
+	}
+	memset(m_pHash, 0xFF, m_hashSize*sizeof(uint32_t));
+	for( m_hashShift=32, i=m_hashSize; i>1; i>>=1 ) {
+		m_hashShift--;
+	}
+	for( i=0; i<oldSize; i++ ) {
+		if( pOldHash[i] != CAN_SOFT_FILTER_EMPTY ) {
+			for( slot = GetHashSlot(pOldHash[i]); m_pHash[slot] != CAN_SOFT_FILTER_EMPTY;
+			     slot = (slot+1) & (m_hashSize-1) ) {
+			}
+			m_pHash[slot] = pOldHash[i];
+		}
+	}
+	delete [] pOldHash;
+	return BRG_NO_ERR;
+}
+
+/** @} */
+/******************* (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+  * @file    bridge_can_soft_filter.h
+  * @author  MCD Application Team
+  * @brief   Header for bridge_can_soft_filter.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup CAN
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BRIDGE_CAN_SOFT_FILTER_H
+#define _BRIDGE_CAN_SOFT_FILTER_H
+/* Includes ------------------------------------------------------------------*/
+#include "bridge.h"
+
+/* Class -------------------------------------------------------------------- */
+/// BrgCanSoftFilter Class: host CAN acceptance filter, exact for any set of identifiers, for the frames
+/// the filter banks (Brg::InitFilterCAN(), see BrgCanFilterPlanner) accept in excess.\n
+/// Standard identifiers are looked up in a 2048 bits bitmap. Extended identifiers are looked up in an
+/// open addressing hash set (single identifiers) and in a sorted list of disjoint ranges (binary search).
+/// The RTR bit is not filtered.\n
+/// Evaluate() and FilterArrays() process a batch of decoded messages in one loop: a bitmap test per
+/// standard identifier (a few ns per message), the hash set and ranges only for the extended ones. A
+/// BrgCanReceiver given the filter in #Brg_CanRxConfT discards the rejected frames before they are queued.\n
+/// The Add/Clear functions are not thread safe and must not be called while a started BrgCanReceiver
+/// uses the filter; the lookups are (const).
+class BrgCanSoftFilter
+{
+public:
+
+	BrgCanSoftFilter(void);
+
+	virtual ~BrgCanSoftFilter(void);
+
+	void Clear(void);
+
+	Brg_StatusT AddId(Brg_CanMsgIdT IDE, uint32_t ID);
+	Brg_StatusT AddRange(Brg_CanMsgIdT IDE, uint32_t FirstId, uint32_t LastId);
+	Brg_StatusT AddIds(const Brg_FilterBitsT *pIds, uint32_t IdNb);
+
+	/**
+	 * @brief Tells whether a frame of this identifier is accepted.
+	 */
+	bool IsAccepted(Brg_CanMsgIdT IDE, uint32_t ID) const {
+		if( IDE == CAN_ID_EXTENDED ) {
+			return IsExtAccepted(ID);
+		}
+		return ((m_stdBitmap[(ID>>6)&31] >> (ID&63)) & 1) != 0;
+	}
+
+	uint32_t Evaluate(const Brg_CanRxMsgT *pMsgs, uint32_t MsgNb, uint8_t *pAccept) const;
+	uint32_t Evaluate(const uint32_t *pId, const uint8_t *pFlags, uint32_t MsgNb, uint8_t *pAccept) const;
+	uint32_t FilterArrays(uint32_t MsgNb, const Brg_CanRxArraysT *pArrays) const;
+
+private:
+
+	// Extended identifiers range, FirstId to LastId included
+	typedef struct {
+		uint32_t FirstId;
+		uint32_t LastId;
+	} ExtRangeT;
+
+	bool IsExtAccepted(uint32_t ID) const;
+	uint32_t GetHashSlot(uint32_t ID) const;
+	Brg_StatusT GrowHash(void);
+
+	// Standard identifiers: bit ID of the 2048 bits
+	uint64_t m_stdBitmap[32];
+
+	// Extended identifiers: hash set of m_hashSize (power of 2) slots, empty ones 0xFFFFFFFF, at most
+	// half used, and ranges sorted by FirstId
+	uint32_t *m_pHash;
+	uint32_t m_hashSize;
+	uint32_t m_hashShift;
+	uint32_t m_extIdNb;
+	ExtRangeT *m_pRanges;
+	uint32_t m_rangeNb;
+	uint32_t m_rangeMax;
+};
+
+#endif //_BRIDGE_CAN_SOFT_FILTER_H
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,444 @@
+/**
+  ******************************************************************************
+  * @file    bridge_can_tx.cpp
+  * @author  MCD Application Team
+  * @brief   Background CAN transmission: priority queue ordered by CAN ID,
+  *          token bucket pacing, worker thread sending the frames by
+  *          Brg::ExecuteBatch() batches (see BrgCanTransmitter).
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup CAN
+ * @{
+ * Usage:\n
+ *   brg.InitCAN(&canInit, BRG_INIT_FULL);\n
+ *   BrgCanTransmitter transmitter(brg);\n
+ *   transmitter.Start(&txConf);\n
+ *   transmitter.Push(&txMsg, data, 8);\n
+ *   ...\n
+ *   transmitter.Flush(1000);\n
+ *   transmitter.Stop();
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_can_tx.h"
+
+#include <chrono>
+#include <new>
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private defines -----------------------------------------------------------*/
+// One frame in the token bucket
+#define CAN_TX_TOKEN 1000000000ULL
+
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Global variables ----------------------------------------------------------*/
+/* Class Functions Definition ------------------------------------------------*/
+
+/**
+ * @ingroup CAN
+ * @brief BrgCanTransmitter constructor.
+ * @param[in]  BrgDevice  Bridge with CAN initialized (Brg::InitCAN()), must not be deleted before the
+ *             BrgCanTransmitter.
+ */
+BrgCanTransmitter::BrgCanTransmitter(Brg &BrgDevice): m_brg(BrgDevice), m_pHeap(NULL), m_heapMax(0),
+	m_queueNb(0), m_seqNb(0), m_inFlightNb(0), m_tokens(0), m_tokenNs(0), m_bStarted(false), m_bStop(false),
+	m_latencySumUs(0)
+{
+	GetDefaultConf(&m_conf);
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+/**
+ * @ingroup CAN
+ * @brief BrgCanTransmitter destructor: stops the worker thread.
+ */
+BrgCanTransmitter::~BrgCanTransmitter(void)
+{
+	Stop();
+	delete [] m_pHeap;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine fills a #Brg_CanTxConfT with the default values: BRG_CAN_TX_xxx_DEFAULT, no pacing.
+ * @param[out] pConf  Parameters.
+ */
+void BrgCanTransmitter::GetDefaultConf(Brg_CanTxConfT *pConf)
+{
+	if( pConf == NULL ) {
+		return;
+	}
+	pConf->QueueSize = BRG_CAN_TX_QUEUE_DEFAULT;
+	pConf->FramesPerSec = 0;
+	pConf->BurstNb = BRG_CAN_TX_BATCH_DEFAULT;
+	pConf->BatchMax = BRG_CAN_TX_BATCH_DEFAULT;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine empties the queue, resets the statistics and starts the worker thread.
+ * @param[in]  pConf  Parameters, NULL for the default ones (see GetDefaultConf()).
+ *
+ * @retval #BRG_NO_STLINK If Brg::OpenStlink() not called before
+ * @retval #BRG_PARAM_ERR If a parameter is not supported (QueueSize 0, BatchMax out of range, BurstNb 0
+ *         with FramesPerSec)
+ * @retval #BRG_MEM_ALLOC_ERR If the queue cannot be allocated
+ * @retval #BRG_NO_ERR If no error (or already started)
+ */
+Brg_StatusT BrgCanTransmitter::Start(const Brg_CanTxConfT *pConf)
+{
+	Brg_CanTxConfT conf;
+
+	if( m_brg.GetIsStlinkConnected() == false ) {
+		return BRG_NO_STLINK;
+	}
+	if( pConf == NULL ) {
+		GetDefaultConf(&conf);
+	} else {
+		conf = *pConf;
+	}
+	if( (conf.QueueSize == 0) || (conf.BatchMax == 0) || (conf.BatchMax > BRG_CAN_TX_BATCH_MAX) ||
+	    ((conf.FramesPerSec != 0) && (conf.BurstNb == 0)) ) {
+		return BRG_PARAM_ERR;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if( m_bStarted == true ) {
+		return BRG_NO_ERR;
+	}
+	if( conf.QueueSize > m_heapMax ) {
+		delete [] m_pHeap;
+		m_heapMax = 0;
+		m_pHeap = new (std::nothrow) CanTxEntryT[conf.QueueSize];
+		if( m_pHeap == NULL ) {
+			return BRG_MEM_ALLOC_ERR;
+		}
+		m_heapMax = conf.QueueSize;
+	}
+
+	m_conf = conf;
+	m_queueNb = 0;
+	m_inFlightNb = 0;
+	m_seqNb = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_latencySumUs = 0;
+	// Full bucket: the first BurstNb frames are sent at once
+	m_tokens = (uint64_t)m_conf.BurstNb*CAN_TX_TOKEN;
+	m_tokenNs = StlinkCmdStats::GetTimeNs();
+	m_bStop = false;
+	m_worker = std::thread(&BrgCanTransmitter::WorkerLoop, this);
+	m_bStarted = true;
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine stops the worker thread after the batch in progress. The frames still queued are
+ * not sent (see Flush()) and are discarded by the next Start().
+ */
+void BrgCanTransmitter::Stop(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if( m_bStarted == false ) {
+			return;
+		}
+		m_bStop = true;
+	}
+	m_cvWork.notify_one();
+	m_worker.join();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_bStarted = false;
+	m_cvDone.notify_all();
+}
+/**
+ * @ingroup CAN
+ * @brief This routine queues a copy of a CAN message, without blocking and without USB command.
+ * @param[in]  pCanMsg  Message "header", see Brg::WriteMsgCAN().
+ * @param[in]  pBuffer  Data (SizeInBytes bytes).
+ * @param[in]  SizeInBytes  Number of data bytes (max 8).
+ *
+ * @retval #BRG_COM_CMD_ORDER_ERR If Start() not called before
+ * @retval #BRG_PARAM_ERR If a parameter is wrong (NULL pointer, size, ID out of range)
+ * @retval #BRG_OVERRUN_ERR If the queue is full: message not queued
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanTransmitter::Push(const Brg_CanTxMsgT *pCanMsg, const uint8_t *pBuffer, uint8_t SizeInBytes)
+{
+	CanTxEntryT entry;
+
+	if( (pCanMsg == NULL) || (pBuffer == NULL) || (pCanMsg->DLC > 8) || (SizeInBytes > 8) ) {
+		return BRG_PARAM_ERR;
+	}
+	if( pCanMsg->ID > ((pCanMsg->IDE == CAN_ID_EXTENDED) ? 0x1FFFFFFFu : 0x7FFu) ) {
+		return BRG_PARAM_ERR;
+	}
+	entry.Key = GetArbitrationKey(pCanMsg);
+	entry.PushNs = StlinkCmdStats::GetTimeNs();
+	entry.Msg = *pCanMsg;
+	entry.Size = SizeInBytes;
+	memcpy(entry.Data, pBuffer, SizeInBytes);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if( m_bStarted == false ) {
+			return BRG_COM_CMD_ORDER_ERR;
+		}
+		if( m_queueNb >= m_conf.QueueSize ) {
+			m_stats.FullNb++;
+			return BRG_OVERRUN_ERR;
+		}
+		entry.SeqNb = m_seqNb++;
+		HeapPush(&entry);
+		m_stats.PushNb++;
+		if( m_queueNb > m_stats.MaxQueuedNb ) {
+			m_stats.MaxQueuedNb = m_queueNb;
+		}
+	}
+	m_cvWork.notify_one();
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine waits until all the queued frames are sent (or discarded after an error).
+ * @param[in]  TimeoutMs  Max wait.
+ *
+ * @retval #BRG_COM_CMD_ORDER_ERR If not started with frames in the queue
+ * @retval #BRG_TARGET_CMD_TIMEOUT If frames are still queued after TimeoutMs
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgCanTransmitter::Flush(uint32_t TimeoutMs)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if( m_cvDone.wait_for(lock, std::chrono::milliseconds(TimeoutMs),
+	                      [this]{ return ((m_queueNb == 0) && (m_inFlightNb == 0)) || (m_bStarted == false); })
+	    == false ) {
+		return BRG_TARGET_CMD_TIMEOUT;
+	}
+	if( (m_queueNb != 0) || (m_inFlightNb != 0) ) {
+		return BRG_COM_CMD_ORDER_ERR;
+	}
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup CAN
+ * @brief This routine gets the statistics since Start() or ResetStats().
+ * @param[out] pStats  Statistics.
+ */
+void BrgCanTransmitter::GetStats(Brg_CanTxStatsT *pStats)
+{
+	if( pStats == NULL ) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	*pStats = m_stats;
+	pStats->QueuedNb = m_queueNb;
+	if( m_stats.SentNb != 0 ) {
+		pStats->MeanLatencyUs = (uint32_t)(m_latencySumUs/m_stats.SentNb);
+	}
+}
+/**
+ * @ingroup CAN
+ * @brief This routine resets the statistics (MaxQueuedNb restarts from the current queue depth).
+ */
+void BrgCanTransmitter::ResetStats(void)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_stats.MaxQueuedNb = m_queueNb;
+	m_latencySumUs = 0;
+}
+/*
+ * private: key ordered as the CAN arbitration fields, lowest wins: base ID (11 bits), RTR (standard) or
+ * SRR (extended, recessive), IDE, extended ID (18 bits), RTR (extended)
+ */
+uint32_t BrgCanTransmitter::GetArbitrationKey(const Brg_CanTxMsgT *pCanMsg)
+{
+	uint32_t rtr = (pCanMsg->RTR == CAN_REMOTE_FRAME) ? 1 : 0;
+
+	if( pCanMsg->IDE == CAN_ID_EXTENDED ) {
+		return (((pCanMsg->ID>>18) & 0x7FF)<<21) | (1<<20) | (1<<19) | ((pCanMsg->ID & 0x3FFFF)<<1) | rtr;
+	}
+	return ((pCanMsg->ID & 0x7FF)<<21) | (rtr<<20);
+}
+/*
+ * private: heap order, same arbitration key in push order
+ */
+bool BrgCanTransmitter::IsBefore(const CanTxEntryT *pA, const CanTxEntryT *pB)
+{
+	if( pA->Key != pB->Key ) {
+		return (pA->Key < pB->Key);
+	}
+	return ((int32_t)(pA->SeqNb - pB->SeqNb) < 0);
+}
+/*
+ * private: adds an entry to the heap (m_mutex locked, queue not full)
+ */
+void BrgCanTransmitter::HeapPush(const CanTxEntryT *pEntry)
+{
+	uint32_t idx = m_queueNb++;
+	uint32_t parent;
+
+	while( idx > 0 ) {
+		parent = (idx-1)/2;
+		if( IsBefore(pEntry, &m_pHeap[parent]) == false ) {
+			break;
+		}
+		m_pHeap[idx] = m_pHeap[parent];
+		idx = parent;
+	}
+	m_pHeap[idx] = *pEntry;
+}
+/*
+ * private: removes the first entry of the heap (m_mutex locked, queue not empty)
+ */
+void BrgCanTransmitter::HeapPop(CanTxEntryT *pEntry)
+{
+	uint32_t idx = 0;
+	uint32_t child;
+	const CanTxEntryT *pLast;
+
+	*pEntry = m_pHeap[0];
+	m_queueNb--;
+	pLast = &m_pHeap[m_queueNb];
+	while( true ) {
+		child = 2*idx + 1;
+		if( child >= m_queueNb ) {
+			break;
+		}
+		if( ((child+1) < m_queueNb) && (IsBefore(&m_pHeap[child+1], &m_pHeap[child]) == true) ) {
+			child++;
+		}
+		if( IsBefore(&m_pHeap[child], pLast) == false ) {
+			break;
+		}
+		m_pHeap[idx] = m_pHeap[child];
+		idx = child;
+	}
+	m_pHeap[idx] = *pLast;
+}
+/*
+ * private: number of frames that can be sent now (m_mutex locked, queue not empty), else *pWaitNs the
+ * time before the next token
+ */
+uint32_t BrgCanTransmitter::GetSendableNb(uint64_t NowNs, uint64_t *pWaitNs)
+{
+	uint32_t frameNb = (m_queueNb < m_conf.BatchMax) ? m_queueNb : m_conf.BatchMax;
+	uint64_t maxTokens, elapsedNs;
+
+	*pWaitNs = 0;
+	if( m_conf.FramesPerSec == 0 ) {
+		return frameNb;
+	}
+	// Refill: FramesPerSec tokens per second, up to BurstNb frames
+	maxTokens = (uint64_t)m_conf.BurstNb*CAN_TX_TOKEN;
+	elapsedNs = (NowNs > m_tokenNs) ? (NowNs - m_tokenNs) : 0;
+	m_tokenNs = NowNs;
+	if( elapsedNs >= (maxTokens/m_conf.FramesPerSec) ) {
+		m_tokens = maxTokens;
+	} else {
+		m_tokens += elapsedNs*m_conf.FramesPerSec;
+		if( m_tokens > maxTokens ) {
+			m_tokens = maxTokens;
+		}
+	}
+	if( (m_tokens/CAN_TX_TOKEN) < frameNb ) {
+		frameNb = (uint32_t)(m_tokens/CAN_TX_TOKEN);
+	}
+	if( frameNb == 0 ) {
+		*pWaitNs = (CAN_TX_TOKEN - m_tokens + m_conf.FramesPerSec - 1)/m_conf.FramesPerSec;
+	}
+	return frameNb;
+}
+/*
+ * private: sends the FrameNb frames of m_batch (m_mutex not locked) and updates the statistics
+ */
+void BrgCanTransmitter::SendBatch(uint32_t FrameNb)
+{
+	Brg_StatusT brgStat;
+	uint64_t endNs, latencyUs;
+	uint32_t i;
+
+	for( i = 0; i < FrameNb; i++ ) {
+		m_ops[i].OpType = BATCH_CAN_WRITE;
+		m_ops[i].CanMsg = m_batch[i].Msg;
+		m_ops[i].pTxBuffer = m_batch[i].Data;
+		m_ops[i].SizeInBytes = m_batch[i].Size;
+		m_ops[i].Status = BRG_COM_CMD_ORDER_ERR;
+	}
+	brgStat = m_brg.ExecuteBatch(m_ops, FrameNb);
+	endNs = StlinkCmdStats::GetTimeNs();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.BatchNb++;
+	for( i = 0; i < FrameNb; i++ ) {
+		if( (brgStat == BRG_NO_ERR) || (m_ops[i].Status == BRG_NO_ERR) ) {
+			latencyUs = (endNs - m_batch[i].PushNs)/1000;
+			if( (m_stats.SentNb == 0) || (latencyUs < m_stats.MinLatencyUs) ) {
+				m_stats.MinLatencyUs = (uint32_t)latencyUs;
+			}
+			if( latencyUs > m_stats.MaxLatencyUs ) {
+				m_stats.MaxLatencyUs = (uint32_t)latencyUs;
+			}
+			m_latencySumUs += latencyUs;
+			m_stats.SentNb++;
+		} else {
+			// Failing frame, or not sent after the failure
+			m_stats.ErrorNb++;
+		}
+	}
+	if( brgStat != BRG_NO_ERR ) {
+		m_stats.LastError = brgStat;
+	}
+	m_inFlightNb = 0;
+}
+/*
+ * private: worker thread, sends the frames of the queue by batches, as the pacing allows
+ */
+void BrgCanTransmitter::WorkerLoop(void)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	uint64_t waitNs;
+	uint32_t frameNb, i;
+
+	while( m_bStop == false ) {
+		if( m_queueNb == 0 ) {
+			m_cvDone.notify_all();
+			m_cvWork.wait(lock, [this]{ return (m_bStop == true) || (m_queueNb != 0); });
+			continue;
+		}
+		frameNb = GetSendableNb(StlinkCmdStats::GetTimeNs(), &waitNs);
+		if( frameNb == 0 ) {
+			m_cvWork.wait_for(lock, std::chrono::nanoseconds(waitNs), [this]{ return m_bStop; });
+			continue;
+		}
+		for( i = 0; i < frameNb; i++ ) {
+			HeapPop(&m_batch[i]);
+		}
+		m_tokens -= (m_conf.FramesPerSec != 0) ? (uint64_t)frameNb*CAN_TX_TOKEN : 0;
+		m_inFlightNb = frameNb;
+		lock.unlock();
+		SendBatch(frameNb);
+		lock.lock();
+	}
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
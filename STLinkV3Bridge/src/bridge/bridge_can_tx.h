@@ -0,0 +1,151 @@
+/**
+  ******************************************************************************
+  * @file    bridge_can_tx.h
+  * @author  MCD Application Team
+  * @brief   Header for bridge_can_tx.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup CAN
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BRIDGE_CAN_TX_H
+#define _BRIDGE_CAN_TX_H
+/* Includes ------------------------------------------------------------------*/
+#include "bridge.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/* Exported types and constants ----------------------------------------------*/
+/// Default queue size, see #Brg_CanTxConfT
+#define BRG_CAN_TX_QUEUE_DEFAULT 1024
+/// Default max number of frames sent by one Brg::ExecuteBatch(), see #Brg_CanTxConfT
+#define BRG_CAN_TX_BATCH_DEFAULT 16
+/// Max value of BatchMax, see #Brg_CanTxConfT
+#define BRG_CAN_TX_BATCH_MAX 64
+
+/// BrgCanTransmitter::Start() parameters
+typedef struct {
+	uint32_t QueueSize;     ///< Max number of frames waiting in the queue
+	uint32_t FramesPerSec;  ///< Max average transmit rate, 0 for no pacing (frames sent back-to-back)
+	uint32_t BurstNb;       ///< Paced mode: max number of frames sent back-to-back after an idle period
+	uint16_t BatchMax;      ///< Max frames per Brg::ExecuteBatch() (1 to #BRG_CAN_TX_BATCH_MAX): a frame of
+	                        ///< higher priority queued during a batch waits for its end
+} Brg_CanTxConfT;
+
+/// Statistics of a BrgCanTransmitter, see BrgCanTransmitter::GetStats()
+typedef struct {
+	uint32_t QueuedNb;       ///< Frames currently in the queue (not yet given to Brg::ExecuteBatch())
+	uint32_t MaxQueuedNb;    ///< Max queue depth
+	uint32_t PushNb;         ///< Frames accepted by Push()
+	uint32_t FullNb;         ///< Frames refused by Push() because the queue was full
+	uint32_t SentNb;         ///< Frames sent without error
+	uint32_t ErrorNb;        ///< Frames not sent because of a Brg error (discarded)
+	Brg_StatusT LastError;   ///< Last of these errors (#BRG_NO_ERR if none)
+	uint32_t BatchNb;        ///< Brg::ExecuteBatch() calls
+	uint32_t MinLatencyUs;   ///< Min time from Push() to the end of the batch that sent the frame
+	uint32_t MaxLatencyUs;   ///< Max of this time
+	uint32_t MeanLatencyUs;  ///< Mean of this time
+} Brg_CanTxStatsT;
+
+/* Class -------------------------------------------------------------------- */
+/// BrgCanTransmitter Class: CAN transmit queue of a Brg, emptied by a worker thread.\n
+/// Push() queues a copy of the frame and returns without USB command. The queue is ordered as the CAN
+/// arbitration (lowest identifier first, a standard frame before an extended one of same base identifier,
+/// a data frame before a remote one), frames of same identifier in push order.\n
+/// The worker sends the frames by batches of up to BatchMax #BATCH_CAN_WRITE operations of
+/// Brg::ExecuteBatch(), under one Brg lock. Each frame has its own status read, a CAN frame being a status
+/// window of its own in #RW_STATUS_DEFERRED mode too (see #Brg_RwOpStatusT). A failing frame stops its batch:
+/// it is counted and discarded with the frames of the batch not sent after it.\n
+/// With FramesPerSec, the transmission is paced by a token bucket: BurstNb frames can be sent back-to-back,
+/// then one frame every 1/FramesPerSec.\n
+/// Push() can be called from several threads. Other Brg commands can be sent by other threads while started
+/// (the Brg serializes the batches with them).
+class BrgCanTransmitter
+{
+public:
+
+	BrgCanTransmitter(Brg &BrgDevice);
+
+	virtual ~BrgCanTransmitter(void);
+
+	static void GetDefaultConf(Brg_CanTxConfT *pConf);
+
+	Brg_StatusT Start(const Brg_CanTxConfT *pConf=NULL);
+	void Stop(void);
+
+	Brg_StatusT Push(const Brg_CanTxMsgT *pCanMsg, const uint8_t *pBuffer, uint8_t SizeInBytes);
+	Brg_StatusT Flush(uint32_t TimeoutMs);
+
+	void GetStats(Brg_CanTxStatsT *pStats);
+	void ResetStats(void);
+
+private:
+
+	// Queued frame: Key gives the arbitration order (lowest first), SeqNb the push order
+	typedef struct {
+		uint32_t Key;
+		uint32_t SeqNb;
+		uint64_t PushNs;
+		Brg_CanTxMsgT Msg;
+		uint8_t Size;
+		uint8_t Data[8];
+	} CanTxEntryT;
+
+	static uint32_t GetArbitrationKey(const Brg_CanTxMsgT *pCanMsg);
+	static bool IsBefore(const CanTxEntryT *pA, const CanTxEntryT *pB);
+	void HeapPush(const CanTxEntryT *pEntry);
+	void HeapPop(CanTxEntryT *pEntry);
+
+	uint32_t GetSendableNb(uint64_t NowNs, uint64_t *pWaitNs);
+	void SendBatch(uint32_t FrameNb);
+
+	void WorkerLoop(void);
+
+	Brg &m_brg;
+	Brg_CanTxConfT m_conf;
+
+	// Priority queue: binary heap of m_queueNb entries, allocated by Start()
+	CanTxEntryT *m_pHeap;
+	uint32_t m_heapMax;
+	uint32_t m_queueNb;
+	uint32_t m_seqNb;
+
+	// Batch being sent (worker only): frames popped from the heap and their operations
+	CanTxEntryT m_batch[BRG_CAN_TX_BATCH_MAX];
+	Brg_BatchOpT m_ops[BRG_CAN_TX_BATCH_MAX];
+	uint32_t m_inFlightNb;
+
+	// Token bucket (worker only): frames that can be sent x 1e9 (FramesPerSec added per ns), time of the
+	// last refill
+	uint64_t m_tokens;
+	uint64_t m_tokenNs;
+
+	std::thread m_worker;
+	bool m_bStarted;
+	bool m_bStop;
+
+	// Protect the queue, m_inFlightNb, m_bStop and the statistics
+	std::mutex m_mutex;
+	std::condition_variable m_cvWork;
+	std::condition_variable m_cvDone;
+	Brg_CanTxStatsT m_stats;
+	uint64_t m_latencySumUs;
+};
+
+#endif //_BRIDGE_CAN_TX_H
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
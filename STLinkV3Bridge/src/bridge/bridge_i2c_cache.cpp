@@ -0,0 +1,487 @@
+/**
+  ******************************************************************************
+  * @file    bridge_i2c_cache.cpp
+  * @author  MCD Application Team
+  * @brief   Register map cache of an I2C slave: cached reads of the non-volatile
+  *          registers and dirty registers coalesced in burst writes (see BrgI2cRegCache).
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup I2C
+ * @{
+ * Usage:\n
+ *   BrgI2cRegCache regs(brg, 0x68, I2C_ADDR_7BIT);\n
+ *   regs.Init(128);\n
+ *   regs.SetRangeType(0x3B, 14, REG_CACHE_VOLATILE); // measurement registers\n
+ *   regs.UpdateReg(0x1B, 0x18, 0x08); // local read-modify-write\n
+ *   regs.UpdateReg(0x1C, 0x18, 0x10);\n
+ *   regs.Flush(); // 0x1B and 0x1C written in one burst
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_i2c_cache.h"
+
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private defines -----------------------------------------------------------*/
+// m_pFlags bits
+#define REG_FLAG_VALID    0x01 // m_pValues holds the slave register value (or the pending one if dirty)
+#define REG_FLAG_DIRTY    0x02 // Modified by UpdateReg(), not yet written to the slave
+#define REG_FLAG_VOLATILE 0x04 // REG_CACHE_VOLATILE register
+
+// Max register address size (bytes)
+#define REG_ADDR_MAX_SIZE 2
+
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Global variables ----------------------------------------------------------*/
+/* Class Functions Definition ------------------------------------------------*/
+
+/**
+ * @ingroup I2C
+ * @brief BrgI2cRegCache constructor. BrgI2cRegCache::Init() must be called before the register accesses.
+ * @param[in]  BrgDevice   Bridge with I2C initialized (Brg::InitI2C()), must not be deleted before the cache.
+ * @param[in]  Addr        I2C slave address.
+ * @param[in]  AddrMode    #I2C_ADDR_7BIT or #I2C_ADDR_10BIT.
+ * @param[in]  RegAddrSize Size of the register address sent before the data: 1 or 2 bytes (MSB first).
+ */
+BrgI2cRegCache::BrgI2cRegCache(Brg &BrgDevice, uint16_t Addr, Brg_I2cAddrModeT AddrMode, uint8_t RegAddrSize):
+	m_brg(BrgDevice), m_slaveAddr(Addr), m_regAddrSize(RegAddrSize), m_maxGap(BRG_REG_CACHE_DEFAULT_MAX_GAP),
+	m_pValues(NULL), m_pFlags(NULL), m_regNb(0), m_dirtyNb(0)
+{
+	if( AddrMode == I2C_ADDR_10BIT ) {
+		m_slaveAddr = I2C_10B_ADDR(Addr);
+	}
+	ResetStats();
+}
+/**
+ * @ingroup I2C
+ * @brief BrgI2cRegCache destructor: dirty registers not written by BrgI2cRegCache::Flush() are lost.
+ */
+BrgI2cRegCache::~BrgI2cRegCache(void)
+{
+	delete [] m_pValues;
+	delete [] m_pFlags;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine allocates the cache of registers 0 to RegNb-1, all non-volatile and not yet read.
+ * Any previous content (dirty registers included) is dropped.
+ * @param[in]  RegNb Number of registers: 1 to 256 (1 byte register address) or 65536 (2 bytes).
+ *
+ * @retval #BRG_PARAM_ERR If RegNb or the register address size is not supported
+ * @retval #BRG_MEM_ALLOC_ERR If the cache cannot be allocated
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgI2cRegCache::Init(uint32_t RegNb)
+{
+	if( (m_regAddrSize == 0) || (m_regAddrSize > REG_ADDR_MAX_SIZE) ||
+	    (RegNb == 0) || (RegNb > ((uint32_t)1 << (8*m_regAddrSize))) ) {
+		return BRG_PARAM_ERR;
+	}
+
+	delete [] m_pValues;
+	delete [] m_pFlags;
+	m_regNb = 0;
+	m_dirtyNb = 0;
+	m_pValues = new uint8_t[RegNb];
+	m_pFlags = new uint8_t[RegNb];
+	if( (m_pValues == NULL) || (m_pFlags == NULL) ) {
+		delete [] m_pValues;
+		delete [] m_pFlags;
+		m_pValues = NULL;
+		m_pFlags = NULL;
+		return BRG_MEM_ALLOC_ERR;
+	}
+	memset(m_pValues, 0, RegNb);
+	memset(m_pFlags, 0, RegNb);
+	m_regNb = RegNb;
+	ResetStats();
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine sets the cache policy of a register range (all registers are
+ * #REG_CACHE_NON_VOLATILE after BrgI2cRegCache::Init()). The cached values of the range are dropped,
+ * dirty registers are kept and written by the next BrgI2cRegCache::Flush().
+ * @param[in]  FirstReg First register of the range.
+ * @param[in]  RegNb    Number of registers of the range.
+ * @param[in]  Type     #REG_CACHE_NON_VOLATILE or #REG_CACHE_VOLATILE.
+ *
+ * @retval #BRG_COM_INIT_NOT_DONE If BrgI2cRegCache::Init() not called before
+ * @retval #BRG_PARAM_ERR If the range is outside the cache or Type unknown
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgI2cRegCache::SetRangeType(uint16_t FirstReg, uint32_t RegNb, Brg_RegCacheTypeT Type)
+{
+	Brg_StatusT brgStat;
+
+	brgStat = CheckRange(FirstReg, RegNb);
+	if( (brgStat == BRG_NO_ERR) && (Type != REG_CACHE_NON_VOLATILE) && (Type != REG_CACHE_VOLATILE) ) {
+		brgStat = BRG_PARAM_ERR;
+	}
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+
+	for( uint32_t reg = FirstReg; reg < ((uint32_t)FirstReg + RegNb); reg++ ) {
+		if( (m_pFlags[reg] & REG_FLAG_DIRTY) == 0 ) {
+			m_pFlags[reg] &= (uint8_t)~REG_FLAG_VALID;
+		}
+		if( Type == REG_CACHE_VOLATILE ) {
+			m_pFlags[reg] |= REG_FLAG_VOLATILE;
+		} else {
+			m_pFlags[reg] &= (uint8_t)~REG_FLAG_VOLATILE;
+		}
+	}
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine reads one register, see BrgI2cRegCache::ReadRegs().
+ */
+Brg_StatusT BrgI2cRegCache::ReadReg(uint16_t Reg, uint8_t *pValue)
+{
+	return ReadRegs(Reg, pValue, 1);
+}
+/**
+ * @ingroup I2C
+ * @brief This routine reads consecutive registers: cached non-volatile registers are taken from
+ * the cache, the others are read from the slave in one burst (from the first to the last register
+ * missing in the cache). Dirty registers return their value pending for BrgI2cRegCache::Flush().
+ * @param[out] pBuffer  Register values.
+ * @param[in]  FirstReg First register to read.
+ * @param[in]  RegNb    Number of registers to read.
+ *
+ * @retval #BRG_COM_INIT_NOT_DONE If BrgI2cRegCache::Init() not called before
+ * @retval #BRG_PARAM_ERR If the range is outside the cache or pBuffer is NULL
+ * @return Brg::WriteI2C() and Brg::ReadI2C() errors
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgI2cRegCache::ReadRegs(uint16_t FirstReg, uint8_t *pBuffer, uint16_t RegNb)
+{
+	Brg_StatusT brgStat;
+	uint16_t first = RegNb, last = 0, missNb = 0;
+	uint8_t flags;
+
+	brgStat = CheckRange(FirstReg, RegNb);
+	if( (brgStat == BRG_NO_ERR) && (pBuffer == NULL) ) {
+		brgStat = BRG_PARAM_ERR;
+	}
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+
+	// Registers to be read on the slave
+	for( uint16_t i = 0; i < RegNb; i++ ) {
+		flags = m_pFlags[FirstReg + i];
+		if( ((flags & REG_FLAG_DIRTY) == 0) &&
+		    (((flags & REG_FLAG_VOLATILE) != 0) || ((flags & REG_FLAG_VALID) == 0)) ) {
+			if( first == RegNb ) {
+				first = i;
+			}
+			last = i;
+			missNb++;
+		}
+	}
+	if( missNb != 0 ) {
+		brgStat = BusRead(FirstReg + first, &pBuffer[first], last - first + 1);
+		if( brgStat != BRG_NO_ERR ) {
+			return brgStat;
+		}
+	}
+	m_stats.ReadMissNb += missNb;
+	m_stats.ReadHitNb += RegNb - missNb;
+
+	for( uint16_t i = 0; i < RegNb; i++ ) {
+		uint32_t reg = FirstReg + i;
+		if( (missNb != 0) && (i >= first) && (i <= last) && ((m_pFlags[reg] & REG_FLAG_DIRTY) == 0) ) {
+			// Value read on the slave
+			if( (m_pFlags[reg] & REG_FLAG_VOLATILE) == 0 ) {
+				m_pValues[reg] = pBuffer[i];
+				m_pFlags[reg] |= REG_FLAG_VALID;
+			}
+		} else {
+			pBuffer[i] = m_pValues[reg];
+		}
+	}
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine writes one register, see BrgI2cRegCache::WriteRegs().
+ */
+Brg_StatusT BrgI2cRegCache::WriteReg(uint16_t Reg, uint8_t Value)
+{
+	return WriteRegs(Reg, &Value, 1);
+}
+/**
+ * @ingroup I2C
+ * @brief This routine writes consecutive registers through the cache, in one I2C transaction.
+ * The write is skipped if all the registers are non-volatile and already hold these values.
+ * A pending dirty value of these registers is replaced by the written one.
+ * @param[in]  FirstReg First register to write.
+ * @param[in]  pBuffer  Register values.
+ * @param[in]  RegNb    Number of registers to write.
+ *
+ * @retval #BRG_COM_INIT_NOT_DONE If BrgI2cRegCache::Init() not called before
+ * @retval #BRG_PARAM_ERR If the range is outside the cache or pBuffer is NULL
+ * @return Brg::WriteI2C() errors (the cached values of the range are then dropped)
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgI2cRegCache::WriteRegs(uint16_t FirstReg, const uint8_t *pBuffer, uint16_t RegNb)
+{
+	Brg_StatusT brgStat;
+	bool bChanged = false;
+
+	brgStat = CheckRange(FirstReg, RegNb);
+	if( (brgStat == BRG_NO_ERR) && (pBuffer == NULL) ) {
+		brgStat = BRG_PARAM_ERR;
+	}
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+
+	for( uint16_t i = 0; (i < RegNb) && (bChanged == false); i++ ) {
+		uint32_t reg = FirstReg + i;
+		if( (m_pFlags[reg] != REG_FLAG_VALID) || (m_pValues[reg] != pBuffer[i]) ) {
+			bChanged = true;
+		}
+	}
+	if( bChanged == false ) {
+		return BRG_NO_ERR;
+	}
+
+	brgStat = BusWrite(FirstReg, pBuffer, RegNb);
+	if( brgStat != BRG_NO_ERR ) {
+		// Slave content unknown
+		Invalidate(FirstReg, RegNb);
+		return brgStat;
+	}
+
+	for( uint16_t i = 0; i < RegNb; i++ ) {
+		uint32_t reg = FirstReg + i;
+		if( (m_pFlags[reg] & REG_FLAG_DIRTY) != 0 ) {
+			m_pFlags[reg] &= (uint8_t)~REG_FLAG_DIRTY;
+			m_dirtyNb--;
+		}
+		if( (m_pFlags[reg] & REG_FLAG_VOLATILE) == 0 ) {
+			m_pValues[reg] = pBuffer[i];
+			m_pFlags[reg] |= REG_FLAG_VALID;
+		}
+	}
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine modifies the bits selected by Mask of a register.\n
+ * Non-volatile register: the value is read on the slave only if not cached, modified in the cache
+ * and marked dirty if changed; it is written by BrgI2cRegCache::Flush().\n
+ * Volatile register: read-modify-write on the slave (2 I2C transactions).
+ * @param[in]  Reg   Register to modify.
+ * @param[in]  Mask  Bits to modify.
+ * @param[in]  Value New value of the bits selected by Mask (other bits ignored).
+ *
+ * @retval #BRG_COM_INIT_NOT_DONE If BrgI2cRegCache::Init() not called before
+ * @retval #BRG_PARAM_ERR If Reg is outside the cache
+ * @return Brg::WriteI2C() and Brg::ReadI2C() errors
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgI2cRegCache::UpdateReg(uint16_t Reg, uint8_t Mask, uint8_t Value)
+{
+	Brg_StatusT brgStat;
+	uint8_t value;
+
+	brgStat = CheckRange(Reg, 1);
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+
+	if( (m_pFlags[Reg] & REG_FLAG_VOLATILE) != 0 ) {
+		brgStat = BusRead(Reg, &value, 1);
+		m_stats.ReadMissNb++;
+		if( brgStat == BRG_NO_ERR ) {
+			value = (uint8_t)((value & ~Mask) | (Value & Mask));
+			brgStat = BusWrite(Reg, &value, 1);
+		}
+		return brgStat;
+	}
+
+	if( (m_pFlags[Reg] & REG_FLAG_VALID) == 0 ) {
+		brgStat = BusRead(Reg, &m_pValues[Reg], 1);
+		m_stats.ReadMissNb++;
+		if( brgStat != BRG_NO_ERR ) {
+			return brgStat;
+		}
+		m_pFlags[Reg] |= REG_FLAG_VALID;
+	} else {
+		m_stats.ReadHitNb++;
+	}
+
+	value = (uint8_t)((m_pValues[Reg] & ~Mask) | (Value & Mask));
+	if( value != m_pValues[Reg] ) {
+		m_pValues[Reg] = value;
+		if( (m_pFlags[Reg] & REG_FLAG_DIRTY) == 0 ) {
+			m_pFlags[Reg] |= REG_FLAG_DIRTY;
+			m_dirtyNb++;
+		}
+	}
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine writes the dirty registers to the slave, in increasing register order.
+ * Consecutive dirty registers are written in one burst; runs separated by at most
+ * BrgI2cRegCache::SetMaxGap() clean cached non-volatile registers are merged in the same burst.
+ *
+ * @retval #BRG_COM_INIT_NOT_DONE If BrgI2cRegCache::Init() not called before
+ * @return Brg::WriteI2C() errors (registers not written stay dirty)
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgI2cRegCache::Flush(void)
+{
+	Brg_StatusT brgStat;
+	uint32_t reg = 0, first, last, gap;
+	uint32_t maxBurst = 0xFFFF - m_regAddrSize; // Brg::WriteI2C() max size
+
+	if( m_pValues == NULL ) {
+		return BRG_COM_INIT_NOT_DONE;
+	}
+
+	while( (m_dirtyNb != 0) && (reg < m_regNb) ) {
+		if( (m_pFlags[reg] & REG_FLAG_DIRTY) == 0 ) {
+			reg++;
+			continue;
+		}
+		// Extend the burst while the next dirty register is close enough
+		first = reg;
+		last = reg;
+		gap = 0;
+		for( reg = first + 1; (reg < m_regNb) && ((reg - first) < maxBurst); reg++ ) {
+			if( (m_pFlags[reg] & REG_FLAG_DIRTY) != 0 ) {
+				last = reg;
+				gap = 0;
+			} else if( (gap < m_maxGap) && IsGapWritable((uint16_t)reg) ) {
+				gap++;
+			} else {
+				break;
+			}
+		}
+
+		brgStat = BusWrite((uint16_t)first, &m_pValues[first], (uint16_t)(last - first + 1));
+		if( brgStat != BRG_NO_ERR ) {
+			return brgStat;
+		}
+		for( reg = first; reg <= last; reg++ ) {
+			if( (m_pFlags[reg] & REG_FLAG_DIRTY) != 0 ) {
+				m_pFlags[reg] &= (uint8_t)~REG_FLAG_DIRTY;
+				m_dirtyNb--;
+			}
+		}
+	}
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine drops all the cached values and the dirty registers not yet written
+ * (e.g. after a reset of the slave). Register cache policies are kept.
+ */
+void BrgI2cRegCache::Invalidate(void)
+{
+	if( m_pFlags != NULL ) {
+		Invalidate(0, m_regNb);
+	}
+}
+/**
+ * @ingroup I2C
+ * @brief This routine drops the cached values and the dirty registers of a register range.
+ * @param[in]  FirstReg First register of the range.
+ * @param[in]  RegNb    Number of registers of the range.
+ */
+void BrgI2cRegCache::Invalidate(uint16_t FirstReg, uint32_t RegNb)
+{
+	if( CheckRange(FirstReg, RegNb) != BRG_NO_ERR ) {
+		return;
+	}
+	for( uint32_t reg = FirstReg; reg < ((uint32_t)FirstReg + RegNb); reg++ ) {
+		if( (m_pFlags[reg] & REG_FLAG_DIRTY) != 0 ) {
+			m_dirtyNb--;
+		}
+		m_pFlags[reg] &= REG_FLAG_VOLATILE;
+	}
+}
+
+/*
+ * private: check that the register range is inside the cache
+ */
+Brg_StatusT BrgI2cRegCache::CheckRange(uint16_t FirstReg, uint32_t RegNb) const
+{
+	if( m_pValues == NULL ) {
+		return BRG_COM_INIT_NOT_DONE;
+	}
+	if( (RegNb == 0) || (((uint32_t)FirstReg + RegNb) > m_regNb) ) {
+		return BRG_PARAM_ERR;
+	}
+	return BRG_NO_ERR;
+}
+/*
+ * private: a clean register can be rewritten inside a burst only if its value is known
+ * and writing it has no side effect
+ */
+bool BrgI2cRegCache::IsGapWritable(uint16_t Reg) const
+{
+	return (m_pFlags[Reg] == REG_FLAG_VALID);
+}
+/*
+ * private: read registers on the slave: register address write, repeated START and data read
+ */
+Brg_StatusT BrgI2cRegCache::BusRead(uint16_t FirstReg, uint8_t *pBuffer, uint16_t RegNb)
+{
+	Brg_StatusT brgStat;
+	uint8_t regAddr[REG_ADDR_MAX_SIZE];
+	uint16_t sizeDone = 0;
+
+	regAddr[0] = (uint8_t)(FirstReg >> 8);
+	regAddr[1] = (uint8_t)FirstReg;
+	m_stats.BusReadNb++;
+	brgStat = m_brg.WriteReadI2C(m_slaveAddr, &regAddr[REG_ADDR_MAX_SIZE - m_regAddrSize], m_regAddrSize,
+	                             pBuffer, RegNb, &sizeDone);
+	return brgStat;
+}
+/*
+ * private: write registers on the slave: register address followed by the data
+ * in one I2C transaction (no copy of the data)
+ */
+Brg_StatusT BrgI2cRegCache::BusWrite(uint16_t FirstReg, const uint8_t *pBuffer, uint16_t RegNb)
+{
+	uint8_t regAddr[REG_ADDR_MAX_SIZE];
+	Brg_SpanT spans[2];
+	uint16_t sizeDone = 0;
+
+	regAddr[0] = (uint8_t)(FirstReg >> 8);
+	regAddr[1] = (uint8_t)FirstReg;
+	spans[0].pData = &regAddr[REG_ADDR_MAX_SIZE - m_regAddrSize];
+	spans[0].SizeInBytes = m_regAddrSize;
+	spans[1].pData = pBuffer;
+	spans[1].SizeInBytes = RegNb;
+	m_stats.BusWriteNb++;
+	return m_brg.WriteI2C(spans, 2, m_slaveAddr, &sizeDone);
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,126 @@
+/**
+  ******************************************************************************
+  * @file    bridge_i2c_cache.h
+  * @author  MCD Application Team
+  * @brief   Header for bridge_i2c_cache.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup I2C
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BRIDGE_I2C_CACHE_H
+#define _BRIDGE_I2C_CACHE_H
+/* Includes ------------------------------------------------------------------*/
+#include "bridge.h"
+
+/* Exported types and constants ----------------------------------------------*/
+/// Default BrgI2cRegCache::SetMaxGap() value: clean registers rewritten to merge two dirty runs
+#define BRG_REG_CACHE_DEFAULT_MAX_GAP 2
+
+/// Cache policy of a register range, see BrgI2cRegCache::SetRangeType()
+typedef enum {
+	REG_CACHE_NON_VOLATILE = 0, ///< Default: only changed by the host, read once then served from the cache
+	REG_CACHE_VOLATILE = 1      ///< Changed by the slave (status, data, clear on read): always accessed on the bus
+} Brg_RegCacheTypeT;
+
+/// Access counters of a BrgI2cRegCache, see BrgI2cRegCache::GetStats()
+typedef struct {
+	uint32_t ReadHitNb;  ///< Registers read from the cache
+	uint32_t ReadMissNb; ///< Registers read from the slave
+	uint32_t BusReadNb;  ///< I2C read transactions (register address write + data read)
+	uint32_t BusWriteNb; ///< I2C write transactions
+} Brg_RegCacheStatsT;
+
+/* Class -------------------------------------------------------------------- */
+/// BrgI2cRegCache Class: cache of the 8-bit register map of one I2C slave, layered over the Brg I2C API.\n
+/// Registers are accessed with a 1 or 2 bytes register address (MSB first) followed by the data, the
+/// slave incrementing the register address for burst accesses.\n
+/// WriteReg()/WriteRegs() write through the cache; UpdateReg() only modifies the cached value and marks it
+/// dirty, the dirty registers being written by Flush() in as few burst writes as possible.\n
+/// Not thread safe. Read data are checked as in #RW_STATUS_IMMEDIATE mode: the Brg should not be in
+/// #RW_STATUS_DEFERRED mode while the cache reads the slave.
+class BrgI2cRegCache
+{
+public:
+
+	BrgI2cRegCache(Brg &BrgDevice, uint16_t Addr, Brg_I2cAddrModeT AddrMode, uint8_t RegAddrSize=1);
+
+	virtual ~BrgI2cRegCache(void);
+
+	Brg_StatusT Init(uint32_t RegNb);
+	Brg_StatusT SetRangeType(uint16_t FirstReg, uint32_t RegNb, Brg_RegCacheTypeT Type);
+	/**
+	 * @brief Number of clean registers that Flush() may rewrite (with their cached value) to merge
+	 * two runs of dirty registers in the same burst write instead of two I2C transactions.
+	 */
+	void SetMaxGap(uint16_t MaxGap) {
+		m_maxGap = MaxGap;
+	}
+
+	Brg_StatusT ReadReg(uint16_t Reg, uint8_t *pValue);
+	Brg_StatusT ReadRegs(uint16_t FirstReg, uint8_t *pBuffer, uint16_t RegNb);
+	Brg_StatusT WriteReg(uint16_t Reg, uint8_t Value);
+	Brg_StatusT WriteRegs(uint16_t FirstReg, const uint8_t *pBuffer, uint16_t RegNb);
+	Brg_StatusT UpdateReg(uint16_t Reg, uint8_t Mask, uint8_t Value);
+	Brg_StatusT Flush(void);
+
+	void Invalidate(void);
+	void Invalidate(uint16_t FirstReg, uint32_t RegNb);
+
+	/**
+	 * @retval Number of registers modified by UpdateReg() and not yet written by Flush().
+	 */
+	uint32_t GetDirtyNb(void) const {
+		return m_dirtyNb;
+	}
+	/**
+	 * @brief Access counters since Init() or the last ResetStats().
+	 */
+	void GetStats(Brg_RegCacheStatsT *pStats) const {
+		*pStats = m_stats;
+	}
+	void ResetStats(void) {
+		m_stats.ReadHitNb = 0;
+		m_stats.ReadMissNb = 0;
+		m_stats.BusReadNb = 0;
+		m_stats.BusWriteNb = 0;
+	}
+
+private:
+
+	Brg_StatusT CheckRange(uint16_t FirstReg, uint32_t RegNb) const;
+
+	Brg_StatusT BusRead(uint16_t FirstReg, uint8_t *pBuffer, uint16_t RegNb);
+	Brg_StatusT BusWrite(uint16_t FirstReg, const uint8_t *pBuffer, uint16_t RegNb);
+
+	bool IsGapWritable(uint16_t Reg) const;
+
+	Brg &m_brg;
+	uint16_t m_slaveAddr;  // Addr with I2C_10B_ADDR() applied in 10-bit mode
+	uint8_t m_regAddrSize;
+	uint16_t m_maxGap;
+
+	// Cached values and REG_FLAG_... of each register, allocated by Init()
+	uint8_t *m_pValues;
+	uint8_t *m_pFlags;
+	uint32_t m_regNb;
+	uint32_t m_dirtyNb;
+
+	Brg_RegCacheStatsT m_stats;
+};
+
+#endif //_BRIDGE_I2C_CACHE_H
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
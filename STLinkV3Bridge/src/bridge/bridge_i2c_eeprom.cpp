@@ -0,0 +1,363 @@
+/**
+  ******************************************************************************
+  * @file    bridge_i2c_eeprom.cpp
+  * @author  MCD Application Team
+  * @brief   Programming of 24Cxx I2C EEPROMs: page writes with ACK polling
+  *          of the write cycle and burst readback (see BrgI2cEeprom).
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup I2C
+ * @{
+ * Usage:\n
+ *   Brg_I2cEepromConfT conf = {0x50, 32768, 64, 2, 10}; // 24C256\n
+ *   BrgI2cEeprom eeprom(brg);\n
+ *   eeprom.Init(&conf);\n
+ *   brgStat = eeprom.Program(0, image, sizeof(image), &errorAddr);
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_i2c_eeprom.h"
+
+#include <chrono>
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private defines -----------------------------------------------------------*/
+// Max memory address size (bytes)
+#define EEPROM_ADDR_MAX_SIZE 2
+// Max number of block select bits in the slave address
+#define EEPROM_BLOCK_BITS_MAX 3
+
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Global variables ----------------------------------------------------------*/
+/* Class Functions Definition ------------------------------------------------*/
+
+/**
+ * @ingroup I2C
+ * @brief BrgI2cEeprom constructor. BrgI2cEeprom::Init() must be called before the EEPROM accesses.
+ * @param[in]  BrgDevice  Bridge with I2C initialized (Brg::InitI2C()), must not be deleted before the BrgI2cEeprom.
+ */
+BrgI2cEeprom::BrgI2cEeprom(Brg &BrgDevice): m_brg(BrgDevice), m_bInit(false), m_bWriteCycle(false),
+	m_pReadBuf(NULL)
+{
+	memset(&m_conf, 0, sizeof(m_conf));
+	ResetStats();
+}
+/**
+ * @ingroup I2C
+ * @brief BrgI2cEeprom destructor
+ */
+BrgI2cEeprom::~BrgI2cEeprom(void)
+{
+	delete [] m_pReadBuf;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine sets the EEPROM description used by the following accesses.
+ * @param[in]  pConf  EEPROM description, see #Brg_I2cEepromConfT.
+ *
+ * @retval #BRG_PARAM_ERR If pConf is NULL or the description is not supported
+ * @retval #BRG_MEM_ALLOC_ERR If the readback buffer cannot be allocated
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgI2cEeprom::Init(const Brg_I2cEepromConfT *pConf)
+{
+	uint32_t blockSize;
+
+	if( pConf == NULL ) {
+		return BRG_PARAM_ERR;
+	}
+	if( (pConf->AddrSizeInBytes == 0) || (pConf->AddrSizeInBytes > EEPROM_ADDR_MAX_SIZE) ) {
+		return BRG_PARAM_ERR;
+	}
+	blockSize = (uint32_t)1 << (8*pConf->AddrSizeInBytes);
+	if( (pConf->Addr > 0x7F) || (pConf->SizeInBytes == 0) ||
+	    (pConf->SizeInBytes > (blockSize << EEPROM_BLOCK_BITS_MAX)) ||
+	    (pConf->PageSize == 0) || (pConf->PageSize > blockSize) ||
+	    (((uint32_t)pConf->PageSize + pConf->AddrSizeInBytes) > 0xFFFF) ) {
+		return BRG_PARAM_ERR;
+	}
+
+	if( m_pReadBuf == NULL ) {
+		m_pReadBuf = new uint8_t[BRG_I2C_EEPROM_READ_CHUNK];
+		if( m_pReadBuf == NULL ) {
+			return BRG_MEM_ALLOC_ERR;
+		}
+	}
+	m_conf = *pConf;
+	m_bInit = true;
+	m_bWriteCycle = false;
+	ResetStats();
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine reads the EEPROM in burst reads (after the end of a write cycle in progress).
+ * @param[in]  MemAddr     Memory address of the first byte.
+ * @param[out] pBuffer     Data read.
+ * @param[in]  SizeInBytes Number of bytes to read.
+ *
+ * @retval #BRG_COM_INIT_NOT_DONE If BrgI2cEeprom::Init() not called before
+ * @retval #BRG_PARAM_ERR If pBuffer is NULL or the range is outside the EEPROM
+ * @retval #BRG_TARGET_CMD_TIMEOUT If the EEPROM is still busy after the write timeout
+ * @return Brg::WriteI2C() and Brg::ReadI2C() errors
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgI2cEeprom::Read(uint32_t MemAddr, uint8_t *pBuffer, uint32_t SizeInBytes)
+{
+	Brg_StatusT brgStat;
+	uint32_t blockSize, chunk;
+
+	brgStat = CheckRange(MemAddr, SizeInBytes, pBuffer);
+	if( (brgStat == BRG_NO_ERR) && (m_bWriteCycle == true) ) {
+		brgStat = PollAck(MemAddr);
+	}
+
+	blockSize = (uint32_t)1 << (8*m_conf.AddrSizeInBytes);
+	while( (brgStat == BRG_NO_ERR) && (SizeInBytes != 0) ) {
+		// A burst does not cross the block select boundaries
+		chunk = blockSize - (MemAddr % blockSize);
+		if( chunk > 0xFFFF ) {
+			chunk = 0xFFFF;
+		}
+		if( chunk > SizeInBytes ) {
+			chunk = SizeInBytes;
+		}
+		brgStat = ReadChunk(MemAddr, pBuffer, (uint16_t)chunk);
+		MemAddr += chunk;
+		pBuffer += chunk;
+		SizeInBytes -= chunk;
+	}
+	return brgStat;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine writes the EEPROM: the data are split on the page boundaries, one page write
+ * per page. Before each page write the end of the previous write cycle is detected by ACK polling;
+ * the routine returns once the last write cycle is done.
+ * @param[in]  MemAddr     Memory address of the first byte.
+ * @param[in]  pBuffer     Data to write.
+ * @param[in]  SizeInBytes Number of bytes to write.
+ *
+ * @retval #BRG_COM_INIT_NOT_DONE If BrgI2cEeprom::Init() not called before
+ * @retval #BRG_PARAM_ERR If pBuffer is NULL or the range is outside the EEPROM
+ * @retval #BRG_TARGET_CMD_TIMEOUT If the EEPROM is still busy after the write timeout
+ * @return Brg::WriteI2C() errors (e.g. #BRG_I2C_ERR if a data byte is NACKed: write protected EEPROM)
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgI2cEeprom::Write(uint32_t MemAddr, const uint8_t *pBuffer, uint32_t SizeInBytes)
+{
+	Brg_StatusT brgStat;
+	uint8_t addrBytes[EEPROM_ADDR_MAX_SIZE];
+	Brg_SpanT spans[2];
+	uint32_t chunk;
+	uint16_t slaveAddr, sizeWritten;
+
+	brgStat = CheckRange(MemAddr, SizeInBytes, pBuffer);
+
+	while( (brgStat == BRG_NO_ERR) && (SizeInBytes != 0) ) {
+		chunk = m_conf.PageSize - (MemAddr % m_conf.PageSize);
+		if( chunk > SizeInBytes ) {
+			chunk = SizeInBytes;
+		}
+		if( m_bWriteCycle == true ) {
+			brgStat = PollAck(MemAddr);
+			if( brgStat != BRG_NO_ERR ) {
+				break;
+			}
+		}
+
+		slaveAddr = SetMemAddr(MemAddr, addrBytes);
+		spans[0].pData = addrBytes;
+		spans[0].SizeInBytes = m_conf.AddrSizeInBytes;
+		spans[1].pData = pBuffer;
+		spans[1].SizeInBytes = (uint16_t)chunk;
+		brgStat = m_brg.WriteI2C(spans, 2, slaveAddr, &sizeWritten);
+		// Also in case of data NACK: the bytes received before may be programmed
+		m_bWriteCycle = true;
+		m_stats.PageWriteNb++;
+
+		MemAddr += chunk;
+		pBuffer += chunk;
+		SizeInBytes -= chunk;
+	}
+
+	if( brgStat == BRG_NO_ERR ) {
+		brgStat = WaitReady();
+	}
+	return brgStat;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine reads back the EEPROM in burst reads and compares it with the expected data.
+ * @param[in]  MemAddr     Memory address of the first byte.
+ * @param[in]  pBuffer     Expected data.
+ * @param[in]  SizeInBytes Number of bytes to check.
+ * @param[out] pErrorAddr  If not NULL and in case of #BRG_VERIF_ERR, memory address of the first
+ *             byte different from the expected data.
+ *
+ * @retval #BRG_VERIF_ERR If the EEPROM content is not the expected one
+ * @return BrgI2cEeprom::Read() errors
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgI2cEeprom::Verify(uint32_t MemAddr, const uint8_t *pBuffer, uint32_t SizeInBytes,
+                                 uint32_t *pErrorAddr)
+{
+	Brg_StatusT brgStat;
+	uint32_t blockSize, chunk, i;
+
+	brgStat = CheckRange(MemAddr, SizeInBytes, pBuffer);
+	if( (brgStat == BRG_NO_ERR) && (m_bWriteCycle == true) ) {
+		brgStat = PollAck(MemAddr);
+	}
+
+	blockSize = (uint32_t)1 << (8*m_conf.AddrSizeInBytes);
+	while( (brgStat == BRG_NO_ERR) && (SizeInBytes != 0) ) {
+		chunk = blockSize - (MemAddr % blockSize);
+		if( chunk > BRG_I2C_EEPROM_READ_CHUNK ) {
+			chunk = BRG_I2C_EEPROM_READ_CHUNK;
+		}
+		if( chunk > SizeInBytes ) {
+			chunk = SizeInBytes;
+		}
+		brgStat = ReadChunk(MemAddr, m_pReadBuf, (uint16_t)chunk);
+		if( (brgStat == BRG_NO_ERR) && (memcmp(m_pReadBuf, pBuffer, chunk) != 0) ) {
+			for( i = 0; m_pReadBuf[i] == pBuffer[i]; i++ ) {
+			}
+			if( pErrorAddr != NULL ) {
+				*pErrorAddr = MemAddr + i;
+			}
+			brgStat = BRG_VERIF_ERR;
+		}
+		MemAddr += chunk;
+		pBuffer += chunk;
+		SizeInBytes -= chunk;
+	}
+	return brgStat;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine writes the EEPROM then verifies it, see BrgI2cEeprom::Write() and
+ * BrgI2cEeprom::Verify().
+ */
+Brg_StatusT BrgI2cEeprom::Program(uint32_t MemAddr, const uint8_t *pBuffer, uint32_t SizeInBytes,
+                                  uint32_t *pErrorAddr)
+{
+	Brg_StatusT brgStat;
+
+	brgStat = Write(MemAddr, pBuffer, SizeInBytes);
+	if( brgStat == BRG_NO_ERR ) {
+		brgStat = Verify(MemAddr, pBuffer, SizeInBytes, pErrorAddr);
+	}
+	return brgStat;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine waits for the end of the write cycle in progress, if any, by ACK polling.
+ *
+ * @retval #BRG_COM_INIT_NOT_DONE If BrgI2cEeprom::Init() not called before
+ * @retval #BRG_TARGET_CMD_TIMEOUT If the EEPROM is still busy after the write timeout
+ * @return Brg::WriteI2C() errors other than #BRG_I2C_ERR
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgI2cEeprom::WaitReady(void)
+{
+	if( m_bInit == false ) {
+		return BRG_COM_INIT_NOT_DONE;
+	}
+	if( m_bWriteCycle == false ) {
+		return BRG_NO_ERR;
+	}
+	return PollAck(0);
+}
+
+/*
+ * private: check the parameters of an access
+ */
+Brg_StatusT BrgI2cEeprom::CheckRange(uint32_t MemAddr, uint32_t SizeInBytes, const void *pBuffer) const
+{
+	if( m_bInit == false ) {
+		return BRG_COM_INIT_NOT_DONE;
+	}
+	if( (pBuffer == NULL) || (SizeInBytes == 0) || (MemAddr >= m_conf.SizeInBytes) ||
+	    (SizeInBytes > (m_conf.SizeInBytes - MemAddr)) ) {
+		return BRG_PARAM_ERR;
+	}
+	return BRG_NO_ERR;
+}
+/*
+ * private: fill the memory address bytes sent after the slave address (MSB first) and
+ * return the slave address with the block select bits of MemAddr
+ */
+uint16_t BrgI2cEeprom::SetMemAddr(uint32_t MemAddr, uint8_t *pAddrBytes) const
+{
+	uint8_t i;
+
+	for( i = 0; i < m_conf.AddrSizeInBytes; i++ ) {
+		pAddrBytes[i] = (uint8_t)(MemAddr >> (8*(m_conf.AddrSizeInBytes - 1 - i)));
+	}
+	return (uint16_t)(m_conf.Addr | (MemAddr >> (8*m_conf.AddrSizeInBytes)));
+}
+/*
+ * private: ACK polling until the end of the write cycle: the EEPROM NACKs its address while busy.
+ * Each poll only sends the memory address (no data, so no write cycle is started), which also
+ * sets the EEPROM address counter for the next access.
+ */
+Brg_StatusT BrgI2cEeprom::PollAck(uint32_t MemAddr)
+{
+	Brg_StatusT brgStat;
+	uint8_t addrBytes[EEPROM_ADDR_MAX_SIZE];
+	uint16_t slaveAddr, sizeWritten;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::milliseconds timeout(m_conf.WriteTimeoutMs);
+
+	slaveAddr = SetMemAddr(MemAddr, addrBytes);
+	do {
+		brgStat = m_brg.WriteI2C(addrBytes, slaveAddr, m_conf.AddrSizeInBytes, &sizeWritten);
+		m_stats.PollNb++;
+		if( brgStat != BRG_I2C_ERR ) {
+			// Ready (address ACKed) or communication error
+			break;
+		}
+	} while( (std::chrono::steady_clock::now() - start) <= timeout );
+
+	if( brgStat == BRG_NO_ERR ) {
+		m_bWriteCycle = false;
+	} else if( brgStat == BRG_I2C_ERR ) {
+		brgStat = BRG_TARGET_CMD_TIMEOUT;
+	}
+	return brgStat;
+}
+/*
+ * private: random read: memory address write, repeated START and burst read
+ */
+Brg_StatusT BrgI2cEeprom::ReadChunk(uint32_t MemAddr, uint8_t *pBuffer, uint16_t SizeInBytes)
+{
+	Brg_StatusT brgStat;
+	uint8_t addrBytes[EEPROM_ADDR_MAX_SIZE];
+	uint16_t slaveAddr, sizeDone;
+
+	slaveAddr = SetMemAddr(MemAddr, addrBytes);
+	m_stats.ReadNb++;
+	brgStat = m_brg.WriteReadI2C(slaveAddr, addrBytes, m_conf.AddrSizeInBytes, pBuffer, SizeInBytes, &sizeDone);
+	return brgStat;
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
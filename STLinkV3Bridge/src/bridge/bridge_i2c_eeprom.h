@@ -0,0 +1,108 @@
+/**
+  ******************************************************************************
+  * @file    bridge_i2c_eeprom.h
+  * @author  MCD Application Team
+  * @brief   Header for bridge_i2c_eeprom.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup I2C
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BRIDGE_I2C_EEPROM_H
+#define _BRIDGE_I2C_EEPROM_H
+/* Includes ------------------------------------------------------------------*/
+#include "bridge.h"
+
+/* Exported types and constants ----------------------------------------------*/
+/// Max size of the bursts read by BrgI2cEeprom::Read() and BrgI2cEeprom::Verify()
+#define BRG_I2C_EEPROM_READ_CHUNK 4096
+
+/// I2C EEPROM description, see BrgI2cEeprom::Init()
+typedef struct {
+	uint16_t Addr;            ///< 7bit slave address with the block select bits at 0 (e.g. 0x50)
+	uint32_t SizeInBytes;     ///< Memory size (e.g. 32768 for a 24C256)
+	uint16_t PageSize;        ///< Page write buffer size (e.g. 64 for a 24C256)
+	uint8_t AddrSizeInBytes;  ///< Memory address bytes: 1 (24C01 to 24C16) or 2 (24C32 and above);
+	                          ///< address bits above are sent as block select bits of the slave address
+	uint16_t WriteTimeoutMs;  ///< Max write cycle time (tWR max): ACK polling timeout
+} Brg_I2cEepromConfT;
+
+/// Counters of a BrgI2cEeprom, see BrgI2cEeprom::GetStats()
+typedef struct {
+	uint32_t PageWriteNb;  ///< Page writes (write cycles started)
+	uint32_t PollNb;       ///< ACK polling transactions (NACKed ones included)
+	uint32_t ReadNb;       ///< Burst reads
+} Brg_I2cEepromStatsT;
+
+/* Class -------------------------------------------------------------------- */
+/// BrgI2cEeprom Class: programming of 24Cxx I2C EEPROMs through Brg::WriteI2C() and Brg::ReadI2C().\n
+/// Data are written in page writes aligned on the page boundaries; the end of each write cycle is
+/// detected by ACK polling (the EEPROM NACKs its address until the write cycle is done), so that the
+/// next access starts as soon as the EEPROM is ready instead of after the max write cycle time.\n
+/// Not thread safe. Errors are detected as in #RW_STATUS_IMMEDIATE mode: the Brg should not be in
+/// #RW_STATUS_DEFERRED mode while the EEPROM is accessed.
+class BrgI2cEeprom
+{
+public:
+
+	BrgI2cEeprom(Brg &BrgDevice);
+
+	virtual ~BrgI2cEeprom(void);
+
+	Brg_StatusT Init(const Brg_I2cEepromConfT *pConf);
+
+	Brg_StatusT Read(uint32_t MemAddr, uint8_t *pBuffer, uint32_t SizeInBytes);
+	Brg_StatusT Write(uint32_t MemAddr, const uint8_t *pBuffer, uint32_t SizeInBytes);
+	Brg_StatusT Verify(uint32_t MemAddr, const uint8_t *pBuffer, uint32_t SizeInBytes,
+	                   uint32_t *pErrorAddr=NULL);
+	Brg_StatusT Program(uint32_t MemAddr, const uint8_t *pBuffer, uint32_t SizeInBytes,
+	                    uint32_t *pErrorAddr=NULL);
+	Brg_StatusT WaitReady(void);
+
+	/**
+	 * @brief Counters since Init() or the last ResetStats().
+	 */
+	void GetStats(Brg_I2cEepromStatsT *pStats) const {
+		*pStats = m_stats;
+	}
+	void ResetStats(void) {
+		m_stats.PageWriteNb = 0;
+		m_stats.PollNb = 0;
+		m_stats.ReadNb = 0;
+	}
+
+private:
+
+	Brg_StatusT CheckRange(uint32_t MemAddr, uint32_t SizeInBytes, const void *pBuffer) const;
+
+	uint16_t SetMemAddr(uint32_t MemAddr, uint8_t *pAddrBytes) const;
+
+	Brg_StatusT PollAck(uint32_t MemAddr);
+	Brg_StatusT ReadChunk(uint32_t MemAddr, uint8_t *pBuffer, uint16_t SizeInBytes);
+
+	Brg &m_brg;
+	Brg_I2cEepromConfT m_conf;
+	bool m_bInit;
+	bool m_bWriteCycle;   // A write cycle may be in progress (page written, ready not yet detected)
+
+	// Readback buffer of Verify(), allocated by Init()
+	uint8_t *m_pReadBuf;
+
+	Brg_I2cEepromStatsT m_stats;
+};
+
+#endif //_BRIDGE_I2C_EEPROM_H
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
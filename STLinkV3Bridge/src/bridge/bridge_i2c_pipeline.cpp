@@ -0,0 +1,326 @@
+/**
+  ******************************************************************************
+  * @file    bridge_i2c_pipeline.cpp
+  * @author  MCD Application Team
+  * @brief   Pipelined I2C reads overlapping the bus transfers with the host
+  *          processing (see BrgI2cReadPipeline).
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup I2C
+ * @{
+ * Usage:\n
+ *   Brg_I2cPipelineConfT conf = {0x68, I2C_ADDR_7BIT, 14, 1, 0x3B, 0}; // 14 registers from 0x3B\n
+ *   BrgI2cReadPipeline pipe(brg);\n
+ *   brgStat = pipe.Start(&conf);\n
+ *   while( (brgStat == BRG_NO_ERR) && (bRun == true) ) {\n
+ *     brgStat = pipe.Read(sample); // next sample read on the bus ...\n
+ *     Process(sample);             // ... during the processing\n
+ *   }\n
+ *   pipe.Stop();
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_i2c_pipeline.h"
+
+#include <string.h>
+#include <thread>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private defines -----------------------------------------------------------*/
+// Waits shorter than this are done by polling the clock (sleep granularity is coarse)
+#define PIPELINE_SPIN_WAIT_US 1000
+// Host side margin added to the firmware timeout before giving up on a BUSY read
+#define PIPELINE_HOST_TIMEOUT_MARGIN_MS 1000
+// Firmware timeout used when CmdTimeoutMs is DEFAULT_CMD_TIMEOUT
+#define PIPELINE_FW_DEFAULT_TIMEOUT_MS 200
+
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Global variables ----------------------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+/*
+ * Wait until the given time: sleep for the most part, then poll the clock.
+ */
+static void PipelineWaitUntil(std::chrono::steady_clock::time_point Deadline)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	std::chrono::microseconds spinWait(PIPELINE_SPIN_WAIT_US);
+
+	while( now < Deadline ) {
+		if( (Deadline - now) > spinWait ) {
+			std::this_thread::sleep_for((Deadline - now) - spinWait/2);
+		} else {
+			std::this_thread::yield();
+		}
+		now = std::chrono::steady_clock::now();
+	}
+}
+
+static uint32_t PipelineElapsedUs(std::chrono::steady_clock::time_point From,
+                                  std::chrono::steady_clock::time_point To)
+{
+	return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(To - From).count();
+}
+
+/* Class Functions Definition ------------------------------------------------*/
+
+/**
+ * @ingroup I2C
+ * @brief BrgI2cReadPipeline constructor.
+ * @param[in]  BrgDevice  Bridge with I2C initialized (Brg::InitI2C()), must not be deleted before the
+ *             BrgI2cReadPipeline.
+ */
+BrgI2cReadPipeline::BrgI2cReadPipeline(Brg &BrgDevice): m_brg(BrgDevice), m_slaveAddr(0),
+	m_bStarted(false), m_bBusy(false), m_estBusyUs(0), m_issueStat(BRG_NO_ERR), m_issueSizeRead(0)
+{
+	memset(&m_conf, 0, sizeof(m_conf));
+	memset(m_regAddr, 0, sizeof(m_regAddr));
+	ResetStats();
+}
+
+/**
+ * @ingroup I2C
+ * @brief BrgI2cReadPipeline destructor: waits for the read in progress (see Stop()).
+ */
+BrgI2cReadPipeline::~BrgI2cReadPipeline(void)
+{
+	Stop();
+}
+
+/**
+ * @ingroup I2C
+ * @brief Issues the first read of the sample. Then the Brg must only be used through Read() until Stop().
+ * @param[in]  pConf  Sample description.
+ *
+ * @retval #BRG_PARAM_ERR If pConf is NULL or not supported
+ * @retval #BRG_COM_CMD_ORDER_ERR If already started
+ * @retval #BRG_CMD_NOT_SUPPORTED If the firmware does not support Brg::ReadNoWaitI2C()
+ * @return Brg::WriteI2C() and Brg::ReadNoWaitI2C() errors
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgI2cReadPipeline::Start(const Brg_I2cPipelineConfT *pConf)
+{
+	Brg_StatusT brgStat;
+
+	if( pConf == NULL ) {
+		return BRG_PARAM_ERR;
+	}
+	if( (pConf->SizeInBytes == 0) || (pConf->SizeInBytes > BRG_I2C_PIPELINE_MAX_SIZE)
+	    || (pConf->RegAddrSize > sizeof(m_regAddr)) ) {
+		return BRG_PARAM_ERR;
+	}
+	if( m_bStarted == true ) {
+		return BRG_COM_CMD_ORDER_ERR;
+	}
+	if( m_brg.IsReadNoWaitI2CSupport() == false ) {
+		return BRG_CMD_NOT_SUPPORTED;
+	}
+
+	m_conf = *pConf;
+	m_slaveAddr = m_conf.Addr;
+	if( m_conf.AddrMode == I2C_ADDR_10BIT ) {
+		m_slaveAddr = I2C_10B_ADDR(m_conf.Addr);
+	}
+	if( m_conf.RegAddrSize == 2 ) {
+		m_regAddr[0] = (uint8_t)(m_conf.RegAddr>>8);
+		m_regAddr[1] = (uint8_t)m_conf.RegAddr;
+	} else {
+		m_regAddr[0] = (uint8_t)m_conf.RegAddr;
+	}
+	m_estBusyUs = 0;
+	m_issueStat = BRG_NO_ERR;
+	ResetStats();
+
+	brgStat = Issue();
+	if( brgStat == BRG_NO_ERR ) {
+		m_bStarted = true;
+	}
+	return brgStat;
+}
+
+/**
+ * @ingroup I2C
+ * @brief Returns the sample read in background, after having issued the read of the next one.
+ * In case of error the pipeline is stopped (IsStarted() false): Start() must be called again.
+ * @param[out] pBuffer  Sample data (Brg_I2cPipelineConfT SizeInBytes bytes).
+ * @param[out] pSizeRead  If not NULL and in case of error, number of bytes read before the error.
+ *
+ * @retval #BRG_PARAM_ERR If pBuffer is NULL
+ * @retval #BRG_COM_CMD_ORDER_ERR If not started
+ * @retval #BRG_TARGET_CMD_TIMEOUT If the firmware is still BUSY after its timeout
+ * @return Read errors of the sample (e.g. #BRG_I2C_ERR), or errors of the next read issue
+ *         (reported by the next call, the returned sample being valid)
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgI2cReadPipeline::Read(uint8_t *pBuffer, uint16_t *pSizeRead)
+{
+	Brg_StatusT brgStat;
+
+	if( pBuffer == NULL ) {
+		return BRG_PARAM_ERR;
+	}
+	if( m_bStarted == false ) {
+		// Issue of the next read failed at previous call
+		brgStat = m_issueStat;
+		m_issueStat = BRG_NO_ERR;
+		if( brgStat == BRG_NO_ERR ) {
+			return BRG_COM_CMD_ORDER_ERR;
+		}
+		if( pSizeRead != NULL ) {
+			*pSizeRead = m_issueSizeRead;
+		}
+		return brgStat;
+	}
+
+	brgStat = WaitDone(pSizeRead);
+	if( brgStat == BRG_NO_ERR ) {
+		brgStat = m_brg.GetReadDataI2C(pBuffer, m_conf.SizeInBytes);
+	}
+	if( brgStat != BRG_NO_ERR ) {
+		m_bStarted = false;
+		return brgStat;
+	}
+	m_stats.SampleNb++;
+
+	// Next sample read on the bus while the caller processes this one
+	m_issueStat = Issue();
+	if( m_issueStat != BRG_NO_ERR ) {
+		m_bStarted = false;
+	}
+	return BRG_NO_ERR;
+}
+
+/**
+ * @ingroup I2C
+ * @brief Waits for the read in progress (data discarded): the Brg can then be used again.
+ *
+ * @retval #BRG_TARGET_CMD_TIMEOUT If the firmware is still BUSY after its timeout
+ * @return Errors of the read in progress
+ * @retval #BRG_NO_ERR If no error or not started
+ */
+Brg_StatusT BrgI2cReadPipeline::Stop(void)
+{
+	Brg_StatusT brgStat = BRG_NO_ERR;
+
+	if( m_bStarted == true ) {
+		brgStat = WaitDone(NULL);
+		m_bStarted = false;
+	}
+	m_issueStat = BRG_NO_ERR;
+	return brgStat;
+}
+
+/*
+ * private: register address write (if any) then Brg::ReadNoWaitI2C()
+ */
+Brg_StatusT BrgI2cReadPipeline::Issue(void)
+{
+	Brg_StatusT brgStat = BRG_NO_ERR;
+
+	m_issueSizeRead = 0;
+	if( m_conf.RegAddrSize != 0 ) {
+		brgStat = m_brg.WriteI2C(m_regAddr, m_slaveAddr, m_conf.RegAddrSize, &m_issueSizeRead);
+		m_issueSizeRead = 0;
+	}
+	if( brgStat == BRG_NO_ERR ) {
+		brgStat = m_brg.ReadNoWaitI2C(m_slaveAddr, m_conf.SizeInBytes, &m_issueSizeRead, m_conf.CmdTimeoutMs);
+	}
+	m_issueTime = std::chrono::steady_clock::now();
+
+	m_bBusy = (brgStat == BRG_CMD_BUSY);
+	if( m_bBusy == true ) {
+		brgStat = BRG_NO_ERR;
+	} else if( brgStat == BRG_NO_ERR ) {
+		// Read already done at the answer: poll earlier next time
+		m_estBusyUs -= m_estBusyUs/4;
+	}
+	return brgStat;
+}
+/*
+ * private: polls the status of the read issued until no more BRG_CMD_BUSY.
+ * The first poll is done when the read is expected to be done (m_estBusyUs after the issue), the delay
+ * between polls then grows exponentially. m_estBusyUs follows the completion time observed between
+ * the last BUSY poll and the first poll that is not BUSY.
+ */
+Brg_StatusT BrgI2cReadPipeline::WaitDone(uint16_t *pSizeRead)
+{
+	Brg_StatusT brgStat;
+	std::chrono::steady_clock::time_point pollTime, lastBusyTime;
+	std::chrono::steady_clock::time_point deadline;
+	uint32_t backoffUs = BRG_I2C_PIPELINE_MIN_BACKOFF_US;
+	uint32_t doneUs, timeoutMs;
+	bool bFirstPollLate;
+	uint16_t bytesOk = 0;
+
+	if( m_bBusy == false ) {
+		return BRG_NO_ERR;
+	}
+
+	timeoutMs = (m_conf.CmdTimeoutMs == DEFAULT_CMD_TIMEOUT) ? PIPELINE_FW_DEFAULT_TIMEOUT_MS : m_conf.CmdTimeoutMs;
+	deadline = m_issueTime + std::chrono::milliseconds(timeoutMs + PIPELINE_HOST_TIMEOUT_MARGIN_MS);
+
+	// Caller processing may already have covered the read time
+	bFirstPollLate = (PipelineElapsedUs(m_issueTime, std::chrono::steady_clock::now()) > m_estBusyUs);
+	if( bFirstPollLate == false ) {
+		PipelineWaitUntil(m_issueTime + std::chrono::microseconds(m_estBusyUs));
+	}
+
+	lastBusyTime = m_issueTime;
+	while( true ) {
+		pollTime = std::chrono::steady_clock::now();
+		brgStat = m_brg.GetLastReadWriteStatus(&bytesOk, NULL);
+		m_stats.PollNb++;
+		if( brgStat != BRG_CMD_BUSY ) {
+			break;
+		}
+		m_stats.BusyPollNb++;
+		lastBusyTime = pollTime;
+		if( pollTime > deadline ) {
+			m_bBusy = false;
+			return BRG_TARGET_CMD_TIMEOUT;
+		}
+		PipelineWaitUntil(std::chrono::steady_clock::now() + std::chrono::microseconds(backoffUs));
+		backoffUs *= 2;
+		if( backoffUs > BRG_I2C_PIPELINE_MAX_BACKOFF_US ) {
+			backoffUs = BRG_I2C_PIPELINE_MAX_BACKOFF_US;
+		}
+	}
+	m_bBusy = false;
+
+	if( lastBusyTime != m_issueTime ) {
+		// Done between the last BUSY poll and this one: a BUSY poll costs a USB round trip, so the
+		// estimate follows the poll that succeeded rather than the middle of the interval
+		doneUs = PipelineElapsedUs(m_issueTime, pollTime);
+		if( doneUs > m_estBusyUs ) {
+			m_estBusyUs += (doneUs - m_estBusyUs + 1)/2;
+		} else {
+			m_estBusyUs -= (m_estBusyUs - doneUs)/2;
+		}
+	} else if( bFirstPollLate == false ) {
+		// Done at the first poll: estimate may be too long
+		m_estBusyUs -= m_estBusyUs/16;
+	}
+
+	if( (brgStat != BRG_NO_ERR) && (pSizeRead != NULL) ) {
+		*pSizeRead = bytesOk;
+	}
+	return brgStat;
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
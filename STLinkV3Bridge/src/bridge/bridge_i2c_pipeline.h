@@ -0,0 +1,123 @@
+/**
+  ******************************************************************************
+  * @file    bridge_i2c_pipeline.h
+  * @author  MCD Application Team
+  * @brief   Header for bridge_i2c_pipeline.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup I2C
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BRIDGE_I2C_PIPELINE_H
+#define _BRIDGE_I2C_PIPELINE_H
+/* Includes ------------------------------------------------------------------*/
+#include "bridge.h"
+
+#include <chrono>
+
+/* Exported types and constants ----------------------------------------------*/
+/// Max sample size of a BrgI2cReadPipeline (Brg::ReadNoWaitI2C() limit)
+#define BRG_I2C_PIPELINE_MAX_SIZE 512
+/// First delay (us) between two BRG_CMD_BUSY status polls, doubled at each BUSY answer
+#define BRG_I2C_PIPELINE_MIN_BACKOFF_US 20
+/// Max delay (us) between two BRG_CMD_BUSY status polls
+#define BRG_I2C_PIPELINE_MAX_BACKOFF_US 2000
+
+/// Sample read by a BrgI2cReadPipeline, see BrgI2cReadPipeline::Start()
+typedef struct {
+	uint16_t Addr;              ///< Slave address
+	Brg_I2cAddrModeT AddrMode;  ///< 7 or 10bit slave address
+	uint16_t SizeInBytes;       ///< Sample size: 1 to #BRG_I2C_PIPELINE_MAX_SIZE bytes
+	uint8_t RegAddrSize;        ///< 0: plain read, 1 or 2: register address (MSB first) written before each read
+	uint16_t RegAddr;           ///< First register of the sample (if RegAddrSize != 0)
+	uint16_t CmdTimeoutMs;      ///< Firmware timeout of each read, see Brg::ReadNoWaitI2C()
+} Brg_I2cPipelineConfT;
+
+/// Counters of a BrgI2cReadPipeline, see BrgI2cReadPipeline::GetStats()
+typedef struct {
+	uint32_t SampleNb;     ///< Samples returned by BrgI2cReadPipeline::Read()
+	uint32_t PollNb;       ///< Brg::GetLastReadWriteStatus() polls
+	uint32_t BusyPollNb;   ///< Polls answered #BRG_CMD_BUSY
+	uint32_t EstBusyUs;    ///< Current estimate of the read time left after the Brg::ReadNoWaitI2C() answer
+} Brg_I2cPipelineStatsT;
+
+/* Class -------------------------------------------------------------------- */
+/// BrgI2cReadPipeline Class: repeated reads of the same I2C sample (e.g. a block of sensor registers)
+/// overlapping the I2C transfer with the host processing, using Brg::ReadNoWaitI2C() (firmware >= V3B3).\n
+/// Read() fetches the data of the read in progress with Brg::GetReadDataI2C(), issues the next
+/// Brg::ReadNoWaitI2C() and returns: the next sample is read on the bus while the caller processes the
+/// current one. The firmware only keeps one read, so the next read cannot be issued before the
+/// previous data are fetched.\n
+/// The completion is polled with Brg::GetLastReadWriteStatus(): the first poll is delayed by the read time
+/// measured on the previous samples, then the delay between polls is doubled at each #BRG_CMD_BUSY answer.\n
+/// @warning While started, the firmware may be BUSY between two Read() calls: no other command must be sent
+/// to the Brg (from any thread) before Stop().\n
+/// Not thread safe.
+class BrgI2cReadPipeline
+{
+public:
+
+	BrgI2cReadPipeline(Brg &BrgDevice);
+
+	virtual ~BrgI2cReadPipeline(void);
+
+	Brg_StatusT Start(const Brg_I2cPipelineConfT *pConf);
+	Brg_StatusT Read(uint8_t *pBuffer, uint16_t *pSizeRead=NULL);
+	Brg_StatusT Stop(void);
+
+	/**
+	 * @retval true Between Start() and Stop() (or a Read() error): Brg must not be used.
+	 */
+	bool IsStarted(void) const {
+		return m_bStarted;
+	}
+	/**
+	 * @brief Counters since Start() or the last ResetStats().
+	 */
+	void GetStats(Brg_I2cPipelineStatsT *pStats) const {
+		*pStats = m_stats;
+		pStats->EstBusyUs = m_estBusyUs;
+	}
+	void ResetStats(void) {
+		m_stats.SampleNb = 0;
+		m_stats.PollNb = 0;
+		m_stats.BusyPollNb = 0;
+		m_stats.EstBusyUs = 0;
+	}
+
+private:
+
+	Brg_StatusT Issue(void);
+	Brg_StatusT WaitDone(uint16_t *pSizeRead);
+
+	Brg &m_brg;
+	Brg_I2cPipelineConfT m_conf;
+	uint16_t m_slaveAddr;  // Addr with I2C_10B_ADDR() applied in 10-bit mode
+	uint8_t m_regAddr[2];
+
+	bool m_bStarted;
+	bool m_bBusy;          // Last Brg::ReadNoWaitI2C() answered BRG_CMD_BUSY, completion not yet polled
+	std::chrono::steady_clock::time_point m_issueTime;  // Brg::ReadNoWaitI2C() answer
+	uint32_t m_estBusyUs;
+	// Error of the next read issue, reported by the next Read()
+	Brg_StatusT m_issueStat;
+	uint16_t m_issueSizeRead;
+
+	Brg_I2cPipelineStatsT m_stats;
+};
+
+#endif //_BRIDGE_I2C_PIPELINE_H
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,559 @@
+/**
+  ******************************************************************************
+  * @file    bridge_i2c_sampler.cpp
+  * @author  MCD Application Team
+  * @brief   Fixed rate sampling of several I2C slaves: earliest-deadline-first
+  *          worker thread and lock-free sample queue (see BrgI2cSampler).
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup I2C
+ * @{
+ * Usage:\n
+ *   Brg_I2cSampleJobT accel = {0x68, I2C_ADDR_7BIT, 1, 0x3B, 6, 5000};   // 6 bytes from 0x3B at 200Hz\n
+ *   Brg_I2cSampleJobT temp = {0x48, I2C_ADDR_7BIT, 1, 0x00, 2, 100000}; // 2 bytes from 0x00 at 10Hz\n
+ *   BrgI2cSampler sampler(brg);\n
+ *   sampler.AddJob(&accel, &accelId);\n
+ *   sampler.AddJob(&temp, &tempId);\n
+ *   sampler.Start();\n
+ *   while( bRun == true ) {\n
+ *     while( sampler.PopSample(&sample) == true ) {\n
+ *       Process(&sample);\n
+ *     }\n
+ *     ... other processing ...\n
+ *   }\n
+ *   sampler.Stop();
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_i2c_sampler.h"
+
+#include <chrono>
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private defines -----------------------------------------------------------*/
+// End of the idle waits done by polling the clock (sleep granularity is coarse)
+#define SAMPLER_SPIN_WAIT_NS 1000000
+// NextJob() next release when all the jobs are released
+#define SAMPLER_NO_RELEASE_NS 0xFFFFFFFFFFFFFFFFULL
+// PlanPhases() limits: jobs placed over the hyperperiod (LCM of the periods) if it is not longer than
+// SAMPLER_PLAN_MAX_HYPERPERIOD_US and does not hold more than SAMPLER_PLAN_MAX_READS reads
+#define SAMPLER_PLAN_MAX_HYPERPERIOD_US 10000000
+#define SAMPLER_PLAN_MAX_READS 1024
+// Read time measures done by Start() per job (min kept)
+#define SAMPLER_PLAN_READ_NB 2
+
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Global variables ----------------------------------------------------------*/
+/* Class Functions Definition ------------------------------------------------*/
+
+/**
+ * @ingroup I2C
+ * @brief BrgI2cSampler constructor.
+ * @param[in]  BrgDevice  Bridge with I2C initialized (Brg::InitI2C()), must not be deleted before the
+ *             BrgI2cSampler.
+ */
+BrgI2cSampler::BrgI2cSampler(Brg &BrgDevice): m_brg(BrgDevice), m_jobNb(0), m_bStarted(false),
+	m_bStarting(false), m_bStop(false), m_startNs(0), m_stopNs(0), m_busyNs(0), m_sampleNb(0), m_dropNb(0)
+{
+	memset(m_jobs, 0, sizeof(m_jobs));
+}
+/**
+ * @ingroup I2C
+ * @brief BrgI2cSampler destructor: stops the worker thread.
+ */
+BrgI2cSampler::~BrgI2cSampler(void)
+{
+	Stop();
+}
+/**
+ * @ingroup I2C
+ * @brief This routine adds a periodic read. Jobs can only be added while stopped.
+ * @param[in]  pJob  Job description (copied).
+ * @param[out] pJobId  Id of the job: Brg_I2cSampleT JobId of its samples.
+ *
+ * @retval #BRG_PARAM_ERR If a pointer is NULL or the job is not supported
+ * @retval #BRG_COM_CMD_ORDER_ERR If started or being started
+ * @retval #BRG_NOT_SUPPORTED If #BRG_I2C_SAMPLER_JOB_MAX jobs already added
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgI2cSampler::AddJob(const Brg_I2cSampleJobT *pJob, uint16_t *pJobId)
+{
+	SamplerJobT *pSJob;
+
+	if( (pJob == NULL) || (pJobId == NULL) ) {
+		return BRG_PARAM_ERR;
+	}
+	if( (pJob->SizeInBytes == 0) || (pJob->SizeInBytes > BRG_I2C_SAMPLE_MAX_SIZE)
+	    || (pJob->RegAddrSize > 2) || (pJob->PeriodUs == 0) ) {
+		return BRG_PARAM_ERR;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if( (m_bStarted == true) || (m_bStarting == true) ) {
+		return BRG_COM_CMD_ORDER_ERR;
+	}
+	if( m_jobNb >= BRG_I2C_SAMPLER_JOB_MAX ) {
+		return BRG_NOT_SUPPORTED;
+	}
+
+	pSJob = &m_jobs[m_jobNb];
+	memset(pSJob, 0, sizeof(SamplerJobT));
+	pSJob->Job = *pJob;
+	pSJob->SlaveAddr = pJob->Addr;
+	if( pJob->AddrMode == I2C_ADDR_10BIT ) {
+		pSJob->SlaveAddr = I2C_10B_ADDR(pJob->Addr);
+	}
+	if( pJob->RegAddrSize == 2 ) {
+		pSJob->RegAddr[0] = (uint8_t)(pJob->RegAddr>>8);
+		pSJob->RegAddr[1] = (uint8_t)pJob->RegAddr;
+	} else {
+		pSJob->RegAddr[0] = (uint8_t)pJob->RegAddr;
+	}
+	pSJob->PeriodNs = (uint64_t)pJob->PeriodUs*1000;
+
+	*pJobId = m_jobNb;
+	m_jobNb++;
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine removes all the jobs. Only possible while stopped.
+ *
+ * @retval #BRG_COM_CMD_ORDER_ERR If started or being started
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgI2cSampler::ClearJobs(void)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if( (m_bStarted == true) || (m_bStarting == true) ) {
+		return BRG_COM_CMD_ORDER_ERR;
+	}
+	m_jobNb = 0;
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine empties the sample queue, resets the statistics and starts the worker thread.\n
+ * The read time of each job is first measured (reads not queued), then each job gets a release offset
+ * (PhaseUs of Brg_I2cJobStatsT, less than its period) spreading the reads over the bus time:
+ * a job is released at Start() time + PhaseUs, then every PeriodUs.
+ * @param[in]  QueueSize  Min number of samples the queue can hold (rounded up to a power of 2).
+ *
+ * @retval #BRG_NO_STLINK If Brg::OpenStlink() not called before
+ * @retval #BRG_PARAM_ERR If no job added or QueueSize not supported
+ * @retval #BRG_MEM_ALLOC_ERR If the queue cannot be allocated
+ * @retval #BRG_CMD_BUSY If another Start() is in progress
+ * @retval #BRG_NO_ERR If no error (or already started)
+ */
+Brg_StatusT BrgI2cSampler::Start(uint32_t QueueSize)
+{
+	Brg_StatusT brgStat;
+	uint16_t jobIdx;
+
+	if( m_brg.GetIsStlinkConnected() == false ) {
+		return BRG_NO_STLINK;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if( m_bStarted == true ) {
+			return BRG_NO_ERR;
+		}
+		if( m_bStarting == true ) {
+			return BRG_CMD_BUSY;
+		}
+		if( m_jobNb == 0 ) {
+			return BRG_PARAM_ERR;
+		}
+		brgStat = m_queue.Init(sizeof(Brg_I2cSampleT), QueueSize);
+		if( brgStat != BRG_NO_ERR ) {
+			return brgStat;
+		}
+		m_bStarting = true;
+	}
+
+	// Bus reads without m_mutex (jobs not modified while m_bStarting): GetStats() and GetJobStats()
+	// are not blocked by them
+	MeasureReadTimes();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_bStarting = false;
+	PlanPhases();
+
+	m_startNs = GetTimeNs();
+	for( jobIdx = 0; jobIdx < m_jobNb; jobIdx++ ) {
+		m_jobs[jobIdx].ReleaseNs = m_startNs + m_jobs[jobIdx].PhaseNs;
+		m_jobs[jobIdx].SeqNb = 0;
+		memset(&m_jobs[jobIdx].Stats, 0, sizeof(Brg_I2cJobStatsT));
+		m_jobs[jobIdx].Stats.ReadTimeUs = (uint32_t)(m_jobs[jobIdx].ReadNs/1000);
+		m_jobs[jobIdx].Stats.PhaseUs = (uint32_t)(m_jobs[jobIdx].PhaseNs/1000);
+	}
+	m_busyNs = 0;
+	m_sampleNb = 0;
+	m_dropNb = 0;
+	m_bStop = false;
+	m_worker = std::thread(&BrgI2cSampler::WorkerLoop, this);
+	m_bStarted = true;
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine stops the worker thread (after the read in progress). The samples already
+ * queued can still be read with PopSample().
+ */
+void BrgI2cSampler::Stop(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if( m_bStarted == false ) {
+			return;
+		}
+		m_bStop = true;
+	}
+	m_cvStop.notify_one();
+	m_worker.join();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stopNs = GetTimeNs();
+	m_bStarted = false;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine gets the oldest sample of the queue, without blocking.
+ * Must always be called from the same thread.
+ * @param[out] pSample  Sample.
+ * @retval false If the queue is empty.
+ */
+bool BrgI2cSampler::PopSample(Brg_I2cSampleT *pSample)
+{
+	if( pSample == NULL ) {
+		return false;
+	}
+	return m_queue.Pop(pSample);
+}
+/**
+ * @ingroup I2C
+ * @brief This routine gets the deadline statistics of a job since Start().
+ * @param[in]  JobId  Id returned by AddJob().
+ * @param[out] pStats  Statistics.
+ *
+ * @retval #BRG_PARAM_ERR If pStats is NULL or JobId unknown
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgI2cSampler::GetJobStats(uint16_t JobId, Brg_I2cJobStatsT *pStats)
+{
+	if( pStats == NULL ) {
+		return BRG_PARAM_ERR;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if( JobId >= m_jobNb ) {
+		return BRG_PARAM_ERR;
+	}
+	*pStats = m_jobs[JobId].Stats;
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup I2C
+ * @brief This routine gets the global statistics since Start().
+ * @param[out] pStats  Statistics.
+ */
+void BrgI2cSampler::GetStats(Brg_I2cSamplerStatsT *pStats)
+{
+	uint64_t endNs;
+
+	if( pStats == NULL ) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	endNs = (m_bStarted == true) ? GetTimeNs() : m_stopNs;
+	pStats->SampleNb = m_sampleNb;
+	pStats->DropNb = m_dropNb;
+	pStats->BusyUs = m_busyNs/1000;
+	pStats->ElapsedUs = (endNs > m_startNs) ? (endNs - m_startNs)/1000 : 0;
+}
+/**
+ * @ingroup I2C
+ * @brief Time base of the samples: monotonic clock in ns, the one of StlinkCmdStats::GetTimeNs().
+ */
+uint64_t BrgI2cSampler::GetTimeNs(void)
+{
+	return StlinkCmdStats::GetTimeNs();
+}
+/*
+ * private: one read of a job
+ */
+Brg_StatusT BrgI2cSampler::ReadJob(const SamplerJobT *pJob, uint8_t *pData)
+{
+	uint16_t sizeRead;
+
+	if( pJob->Job.RegAddrSize != 0 ) {
+		return m_brg.WriteReadI2C(pJob->SlaveAddr, pJob->RegAddr, pJob->Job.RegAddrSize,
+		                          pData, pJob->Job.SizeInBytes, &sizeRead);
+	}
+	return m_brg.ReadI2C(pData, pJob->SlaveAddr, pJob->Job.SizeInBytes, &sizeRead);
+}
+/*
+ * private: measure the read time of the jobs (min of a few reads), called by Start() without m_mutex
+ */
+void BrgI2cSampler::MeasureReadTimes(void)
+{
+	uint8_t data[BRG_I2C_SAMPLE_MAX_SIZE];
+	uint64_t startNs, readNs;
+	uint16_t jobIdx;
+	uint32_t i;
+
+	for( jobIdx = 0; jobIdx < m_jobNb; jobIdx++ ) {
+		m_jobs[jobIdx].ReadNs = 0;
+		for( i = 0; i < SAMPLER_PLAN_READ_NB; i++ ) {
+			startNs = GetTimeNs();
+			ReadJob(&m_jobs[jobIdx], data);
+			readNs = GetTimeNs() - startNs;
+			if( (i == 0) || (readNs < m_jobs[jobIdx].ReadNs) ) {
+				m_jobs[jobIdx].ReadNs = readNs;
+			}
+		}
+	}
+}
+/*
+ * private: choose the release offsets of the jobs from their read time (m_mutex locked, worker not
+ * started).
+ * Jobs are placed by increasing period: each one gets the first offset for which none of its reads
+ * over the hyperperiod overlaps a read of the jobs already placed. If there is none (bus too loaded)
+ * or the hyperperiod is too long, the offset is the sum of the read times of the jobs placed before
+ * (modulo the period): reads released at the same time are still avoided for the first ones.
+ */
+void BrgI2cSampler::PlanPhases(void)
+{
+	uint16_t order[BRG_I2C_SAMPLER_JOB_MAX];
+	uint64_t *pReadStart, *pReadEnd; // Reads placed in the hyperperiod (us, may end after it)
+	uint64_t hyperUs = 1, a, b, p, q, periodUs, readUs, phaseUs, sumReadUs = 0;
+	uint64_t nextPhaseUs;
+	int64_t startUs, endUs;
+	uint32_t readNb = 0, totalReadNb = 0, i, k, n;
+	uint16_t jobIdx, idx;
+	bool bConflict;
+	int shift;
+
+	// Increasing periods (insertion sort, same period: id order)
+	for( jobIdx = 0; jobIdx < m_jobNb; jobIdx++ ) {
+		for( idx = jobIdx; (idx > 0) && (m_jobs[order[idx-1]].Job.PeriodUs > m_jobs[jobIdx].Job.PeriodUs); idx-- ) {
+			order[idx] = order[idx-1];
+		}
+		order[idx] = jobIdx;
+	}
+
+	// Hyperperiod: LCM of the periods
+	for( jobIdx = 0; (jobIdx < m_jobNb) && (hyperUs != 0); jobIdx++ ) {
+		periodUs = m_jobs[jobIdx].Job.PeriodUs;
+		for( p = hyperUs, q = periodUs; q != 0; ) { // GCD
+			a = p % q;
+			p = q;
+			q = a;
+		}
+		hyperUs = (hyperUs/p)*periodUs;
+		if( hyperUs > SAMPLER_PLAN_MAX_HYPERPERIOD_US ) {
+			hyperUs = 0;
+		}
+	}
+	for( jobIdx = 0; (jobIdx < m_jobNb) && (hyperUs != 0); jobIdx++ ) {
+		totalReadNb += (uint32_t)(hyperUs/m_jobs[jobIdx].Job.PeriodUs);
+	}
+	pReadStart = NULL;
+	pReadEnd = NULL;
+	if( (hyperUs != 0) && (totalReadNb <= SAMPLER_PLAN_MAX_READS) ) {
+		pReadStart = new uint64_t[totalReadNb];
+		pReadEnd = new uint64_t[totalReadNb];
+	}
+
+	for( idx = 0; idx < m_jobNb; idx++ ) {
+		SamplerJobT *pJob = &m_jobs[order[idx]];
+		periodUs = pJob->Job.PeriodUs;
+		readUs = (pJob->ReadNs + 999)/1000;
+		phaseUs = sumReadUs % periodUs; // Default offset
+		sumReadUs += readUs;
+
+		if( (pReadStart != NULL) && (pReadEnd != NULL) ) {
+			n = (uint32_t)(hyperUs/periodUs);
+			// First offset without overlap: on a conflict, move after the read in conflict
+			bConflict = true;
+			for( p = 0; (p + readUs <= periodUs) && (bConflict == true); p = nextPhaseUs ) {
+				bConflict = false;
+				nextPhaseUs = p;
+				for( k = 0; (k < n) && (bConflict == false); k++ ) {
+					a = p + k*periodUs;
+					b = a + readUs;
+					for( i = 0; (i < readNb) && (bConflict == false); i++ ) {
+						// Placed reads repeat every hyperperiod
+						for( shift = -1; shift <= 1; shift++ ) {
+							startUs = (int64_t)pReadStart[i] + shift*(int64_t)hyperUs;
+							endUs = (int64_t)pReadEnd[i] + shift*(int64_t)hyperUs;
+							if( ((int64_t)a < endUs) && (startUs < (int64_t)b) ) {
+								bConflict = true;
+								nextPhaseUs = (uint64_t)endUs - k*periodUs;
+								break;
+							}
+						}
+					}
+				}
+			}
+			if( bConflict == false ) {
+				phaseUs = p;
+			}
+			for( k = 0; k < n; k++ ) {
+				pReadStart[readNb] = phaseUs + k*periodUs;
+				pReadEnd[readNb] = pReadStart[readNb] + readUs;
+				readNb++;
+			}
+		}
+		pJob->PhaseNs = phaseUs*1000;
+	}
+
+	delete [] pReadStart;
+	delete [] pReadEnd;
+}
+/*
+ * private: earliest-deadline-first choice among the released jobs (deadline = release + period,
+ * lowest id first for the same deadline).
+ * Returns the job index, or -1 if no job is released (*pNextReleaseNs: next release time).
+ */
+int BrgI2cSampler::NextJob(uint64_t NowNs, uint64_t *pNextReleaseNs) const
+{
+	int bestIdx = -1;
+	uint64_t bestDeadlineNs = 0;
+	uint64_t deadlineNs;
+	uint16_t jobIdx;
+
+	*pNextReleaseNs = SAMPLER_NO_RELEASE_NS;
+	for( jobIdx = 0; jobIdx < m_jobNb; jobIdx++ ) {
+		if( m_jobs[jobIdx].ReleaseNs > NowNs ) {
+			if( m_jobs[jobIdx].ReleaseNs < *pNextReleaseNs ) {
+				*pNextReleaseNs = m_jobs[jobIdx].ReleaseNs;
+			}
+			continue;
+		}
+		deadlineNs = m_jobs[jobIdx].ReleaseNs + m_jobs[jobIdx].PeriodNs;
+		if( (bestIdx < 0) || (deadlineNs < bestDeadlineNs) ) {
+			bestIdx = jobIdx;
+			bestDeadlineNs = deadlineNs;
+		}
+	}
+	return bestIdx;
+}
+/*
+ * private: read one sample of a released job, directly in the queue slot when there is one
+ */
+void BrgI2cSampler::RunJob(SamplerJobT *pJob)
+{
+	Brg_I2cSampleT dropped;
+	Brg_I2cSampleT *pSample;
+	Brg_StatusT brgStat;
+	uint64_t startNs, endNs, skipNb, latenessUs;
+
+	startNs = GetTimeNs();
+	// Periods whose deadline already passed are not sampled
+	skipNb = 0;
+	if( startNs >= (pJob->ReleaseNs + pJob->PeriodNs) ) {
+		skipNb = (startNs - pJob->ReleaseNs)/pJob->PeriodNs;
+		pJob->ReleaseNs += skipNb*pJob->PeriodNs;
+		pJob->SeqNb += (uint32_t)skipNb;
+	}
+
+	pSample = (Brg_I2cSampleT *)m_queue.GetWriteSlot();
+	if( pSample == NULL ) {
+		pSample = &dropped;
+	}
+	brgStat = ReadJob(pJob, pSample->Data);
+	endNs = GetTimeNs();
+
+	pSample->TimestampNs = startNs + (endNs - startNs)/2;
+	pSample->ReleaseNs = pJob->ReleaseNs;
+	pSample->SeqNb = pJob->SeqNb;
+	pSample->JobId = (uint16_t)(pJob - m_jobs);
+	pSample->SizeInBytes = pJob->Job.SizeInBytes;
+	pSample->Status = brgStat;
+	if( pSample != &dropped ) {
+		m_queue.Commit();
+	}
+
+	latenessUs = (startNs - pJob->ReleaseNs)/1000;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		pJob->Stats.SampleNb++;
+		if( brgStat != BRG_NO_ERR ) {
+			pJob->Stats.ErrorNb++;
+		}
+		if( endNs > (pJob->ReleaseNs + pJob->PeriodNs) ) {
+			pJob->Stats.MissNb++;
+		}
+		pJob->Stats.SkipNb += (uint32_t)skipNb;
+		if( latenessUs > pJob->Stats.MaxLatenessUs ) {
+			pJob->Stats.MaxLatenessUs = (uint32_t)latenessUs;
+		}
+		pJob->Stats.SumLatenessUs += latenessUs;
+		m_busyNs += endNs - startNs;
+		m_sampleNb++;
+		if( pSample == &dropped ) {
+			m_dropNb++;
+		}
+	}
+
+	pJob->ReleaseNs += pJob->PeriodNs;
+	pJob->SeqNb++;
+}
+/*
+ * private: worker thread, runs the released jobs until Stop()
+ */
+void BrgI2cSampler::WorkerLoop(void)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	uint64_t nowNs, nextReleaseNs;
+	int jobIdx;
+
+	while( m_bStop == false ) {
+		lock.unlock();
+		nowNs = GetTimeNs();
+		jobIdx = NextJob(nowNs, &nextReleaseNs);
+		if( jobIdx >= 0 ) {
+			RunJob(&m_jobs[jobIdx]);
+			lock.lock();
+			continue;
+		}
+		// Idle until the next release: sleep, then poll the clock
+		if( (nextReleaseNs - nowNs) <= SAMPLER_SPIN_WAIT_NS ) {
+			std::this_thread::yield();
+			lock.lock();
+			continue;
+		}
+		lock.lock();
+		m_cvStop.wait_for(lock, std::chrono::nanoseconds(nextReleaseNs - nowNs - SAMPLER_SPIN_WAIT_NS/2),
+		                  [this]{ return m_bStop; });
+	}
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,163 @@
+/**
+  ******************************************************************************
+  * @file    bridge_i2c_sampler.h
+  * @author  MCD Application Team
+  * @brief   Header for bridge_i2c_sampler.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup I2C
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BRIDGE_I2C_SAMPLER_H
+#define _BRIDGE_I2C_SAMPLER_H
+/* Includes ------------------------------------------------------------------*/
+#include "bridge.h"
+#include "bridge_spsc_ring.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/* Exported types and constants ----------------------------------------------*/
+/// Max number of jobs of a BrgI2cSampler
+#define BRG_I2C_SAMPLER_JOB_MAX 32
+/// Max data size of a sample
+#define BRG_I2C_SAMPLE_MAX_SIZE 32
+/// Default sample queue size, see BrgI2cSampler::Start()
+#define BRG_I2C_SAMPLER_QUEUE_DEFAULT 1024
+
+/// Periodic read of a BrgI2cSampler, see BrgI2cSampler::AddJob()
+typedef struct {
+	uint16_t Addr;              ///< Slave address
+	Brg_I2cAddrModeT AddrMode;  ///< 7 or 10bit slave address
+	uint8_t RegAddrSize;        ///< 0: plain read, 1 or 2: register address (MSB first) written before the read
+	uint16_t RegAddr;           ///< First register read (if RegAddrSize != 0)
+	uint16_t SizeInBytes;       ///< Bytes read: 1 to #BRG_I2C_SAMPLE_MAX_SIZE
+	uint32_t PeriodUs;          ///< Sampling period (min 1)
+} Brg_I2cSampleJobT;
+
+/// Sample delivered by BrgI2cSampler::PopSample()
+typedef struct {
+	uint64_t TimestampNs;  ///< Monotonic time of the read (std::chrono::steady_clock): middle of the I2C command(s)
+	uint64_t ReleaseNs;    ///< Scheduled time of the sample (same clock): Start() time + PhaseUs + SeqNb*PeriodUs
+	uint32_t SeqNb;        ///< Period number of the job since Start(): a gap means skipped periods
+	uint16_t JobId;        ///< Job id returned by BrgI2cSampler::AddJob()
+	uint16_t SizeInBytes;  ///< Data size (job SizeInBytes)
+	Brg_StatusT Status;    ///< Read status, Data not valid if != #BRG_NO_ERR
+	uint8_t Data[BRG_I2C_SAMPLE_MAX_SIZE];
+} Brg_I2cSampleT;
+
+/// Deadline statistics of a job, see BrgI2cSampler::GetJobStats()
+typedef struct {
+	uint32_t SampleNb;        ///< Samples read (errors included)
+	uint32_t ErrorNb;         ///< Samples with Status != #BRG_NO_ERR
+	uint32_t MissNb;          ///< Samples completed after their deadline (ReleaseNs + PeriodUs)
+	uint32_t SkipNb;          ///< Periods not sampled: their deadline passed before the read could start
+	uint32_t MaxLatenessUs;   ///< Max delay between ReleaseNs and the start of the read
+	uint64_t SumLatenessUs;   ///< Sum of the delays (mean = SumLatenessUs/SampleNb)
+	uint32_t ReadTimeUs;      ///< Read duration measured by Start()
+	uint32_t PhaseUs;         ///< Offset of the releases chosen by Start() (ReleaseNs of SeqNb 0)
+} Brg_I2cJobStatsT;
+
+/// Global statistics of a BrgI2cSampler, see BrgI2cSampler::GetStats()
+typedef struct {
+	uint32_t SampleNb;   ///< Samples read, all jobs
+	uint32_t DropNb;     ///< Samples lost because the queue was full (application too slow)
+	uint64_t BusyUs;     ///< Time spent in I2C commands
+	uint64_t ElapsedUs;  ///< Time since Start() (or Stop() time): BusyUs/ElapsedUs is the load
+} Brg_I2cSamplerStatsT;
+
+/* Class -------------------------------------------------------------------- */
+/// BrgI2cSampler Class: fixed rate sampling of several I2C slaves (e.g. sensors) on one Brg.\n
+/// Each job reads a block of registers every PeriodUs. A worker thread owned by the BrgI2cSampler runs
+/// the released jobs one after the other with earliest-deadline-first order (deadline: end of the period),
+/// using Brg::WriteReadI2C() (or Brg::ReadI2C()). It sleeps only when no job is released.\n
+/// Start() measures the read time of each job and offsets the job releases so that, as far as possible,
+/// the reads of different jobs do not fall at the same time (less waiting behind other jobs, less jitter).\n
+/// Samples are timestamped and pushed in a lock-free queue (BrgSpscRing) read by the application with
+/// PopSample(), from a single thread, without blocking the worker.\n
+/// A job late by more than a period skips the periods whose deadline already passed (SkipNb): the queue
+/// never holds more than one sample per period and job.\n
+/// The Brg should not be used by other threads while started: their commands delay the jobs.
+class BrgI2cSampler
+{
+public:
+
+	BrgI2cSampler(Brg &BrgDevice);
+
+	virtual ~BrgI2cSampler(void);
+
+	Brg_StatusT AddJob(const Brg_I2cSampleJobT *pJob, uint16_t *pJobId);
+	Brg_StatusT ClearJobs(void);
+
+	Brg_StatusT Start(uint32_t QueueSize=BRG_I2C_SAMPLER_QUEUE_DEFAULT);
+	void Stop(void);
+
+	bool PopSample(Brg_I2cSampleT *pSample);
+
+	Brg_StatusT GetJobStats(uint16_t JobId, Brg_I2cJobStatsT *pStats);
+	void GetStats(Brg_I2cSamplerStatsT *pStats);
+
+	static uint64_t GetTimeNs(void);
+
+private:
+
+	/// Job and its scheduling state
+	typedef struct {
+		Brg_I2cSampleJobT Job;
+		uint16_t SlaveAddr;    // Addr with I2C_10B_ADDR() applied in 10-bit mode
+		uint8_t RegAddr[2];
+		uint64_t PeriodNs;
+		uint64_t ReadNs;       // Read duration measured by Start()
+		uint64_t PhaseNs;      // Release offset from the Start() time
+		uint64_t ReleaseNs;    // Release of the next sample
+		uint32_t SeqNb;        // Period number of the next sample
+		Brg_I2cJobStatsT Stats;
+	} SamplerJobT;
+
+	Brg_StatusT ReadJob(const SamplerJobT *pJob, uint8_t *pData);
+	void MeasureReadTimes(void);
+	void PlanPhases(void);
+	int NextJob(uint64_t NowNs, uint64_t *pNextReleaseNs) const;
+	void RunJob(SamplerJobT *pJob);
+
+	void WorkerLoop(void);
+
+	Brg &m_brg;
+
+	SamplerJobT m_jobs[BRG_I2C_SAMPLER_JOB_MAX];
+	uint16_t m_jobNb;
+
+	// Samples from the worker (producer) to PopSample() (consumer)
+	BrgSpscRing m_queue;
+
+	std::thread m_worker;
+	bool m_bStarted;
+	bool m_bStarting;  // Start() measuring the read times, m_mutex released
+	bool m_bStop;
+	uint64_t m_startNs;
+	uint64_t m_stopNs;
+	uint64_t m_busyNs;
+	uint32_t m_sampleNb;
+	uint32_t m_dropNb;
+
+	// Protect m_bStarting, m_bStop and the statistics (jobs scheduling state is only used by the worker while started)
+	std::mutex m_mutex;
+	std::condition_variable m_cvStop;
+};
+
+#endif //_BRIDGE_I2C_SAMPLER_H
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
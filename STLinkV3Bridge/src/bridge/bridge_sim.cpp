@@ -0,0 +1,1906 @@
+/**
+  ******************************************************************************
+  * @file    bridge_sim.cpp
+  * @author  MCD Application Team
+  * @brief   In-process model of the STLINK-V3 bridge firmware, used as STLinkTransport
+  *          to run and benchmark Brg without STLink (see BrgSimTransport).
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup SIMULATOR
+ * @{
+ * Usage:\n
+ *   BrgSimTransport sim;\n
+ *   STLinkInterface stlinkIf(STLINK_BRIDGE);\n
+ *   stlinkIf.SetTransport(&sim);\n
+ *   stlinkIf.LoadStlinkLibrary(NULL);\n
+ *   Brg brg(stlinkIf); brg.OpenStlink(0); ...\n\n
+ * Model limitations:
+ * - Only master modes; SPI slave answers through BrgSimSpiSlave, I2C slaves through BrgSimI2cSlave.
+ * - Bus durations do not include bit stuffing (CAN), clock stretching (I2C) or inter-byte gaps.
+ * - CAN frames are delivered immediately to the other devices; acceptance filters are evaluated
+ *   in bank order (first enabled matching bank gives the FIFO).
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_sim.h"
+#include "stlink_cmd_stats.h"
+
+#include <chrono>
+#include <thread>
+#include <stdio.h>
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private defines -----------------------------------------------------------*/
+#define SIM_USB_VID_ST          0x0483
+#define SIM_USB_PID_STLINK_V3   0x374F
+
+// STLINK_BRIDGE_GET_RWCMD_STATUS and READ_NO_WAIT answer size
+#define SIM_RW_STATUS_LEN       8
+
+// I2C partial transaction state
+#define SIM_I2C_TRANS_IDLE      0
+#define SIM_I2C_TRANS_READ      1
+#define SIM_I2C_TRANS_WRITE     2
+
+// Firmware timeout of READ_NO_WAIT (CDB[7]) unit
+#define SIM_I2C_NO_WAIT_TIMEOUT_UNIT_MS  200
+
+// CAN modes (see Brg_CanModeT)
+#define SIM_CAN_MODE_NORMAL          0
+#define SIM_CAN_MODE_LOOPBACK        1
+#define SIM_CAN_MODE_SILENT          2
+#define SIM_CAN_MODE_SILENT_LOOPBACK 3
+
+// GPIO configuration field: bit1-0 mode, bit5-4 pull
+#define SIM_GPIO_MODE(_conf)    ((_conf)&0x03)
+#define SIM_GPIO_PULL(_conf)    (((_conf)>>4)&0x03)
+#define SIM_GPIO_MODE_OUTPUT    1
+#define SIM_GPIO_MODE_ANALOG    3
+#define SIM_GPIO_PULL_UP        1
+
+// Waiting for less than this duration is done by polling the clock instead of sleeping
+#define SIM_SPIN_WAIT_NS        200000
+
+/* Private macros ------------------------------------------------------------*/
+#define SIM_GET_U16(_p)  ((uint16_t)((_p)[0] | ((uint16_t)(_p)[1]<<8)))
+#define SIM_GET_U32(_p)  ((uint32_t)(_p)[0] | ((uint32_t)(_p)[1]<<8) | \
+                          ((uint32_t)(_p)[2]<<16) | ((uint32_t)(_p)[3]<<24))
+
+/* Private variables ---------------------------------------------------------*/
+/* Global variables ----------------------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+static void PutU16(uint8_t *pDest, uint16_t Value)
+{
+	pDest[0] = (uint8_t)Value;
+	pDest[1] = (uint8_t)(Value>>8);
+}
+
+static void PutU32(uint8_t *pDest, uint32_t Value)
+{
+	pDest[0] = (uint8_t)Value;
+	pDest[1] = (uint8_t)(Value>>8);
+	pDest[2] = (uint8_t)(Value>>16);
+	pDest[3] = (uint8_t)(Value>>24);
+}
+
+// Copy the firmware answer in the host buffer (within its size), return the answer size
+static uint32_t PutAnswer(uint8_t *pData, uint32_t DataSize, const uint8_t *pAnswer, uint32_t AnswerSize)
+{
+	if( pData != NULL ) {
+		memcpy(pData, pAnswer, (AnswerSize < DataSize) ? AnswerSize : DataSize);
+	}
+	return AnswerSize;
+}
+
+// 2 bytes status answer of the init/configuration commands
+static uint32_t PutStatus(uint8_t *pData, uint32_t DataSize, uint16_t Status)
+{
+	uint8_t answer[2];
+
+	PutU16(answer, Status);
+	return PutAnswer(pData, DataSize, answer, sizeof(answer));
+}
+
+/* Class Functions Definition ------------------------------------------------*/
+
+/*
+ * @brief BrgSimI2cMemSlave constructor.
+ * @param[in]  SizeInBytes  Memory size (register addresses wrap around).
+ * @param[in]  AddrSizeInBytes  Number of register address bytes sent after the slave address (1 to 4).
+ */
+BrgSimI2cMemSlave::BrgSimI2cMemSlave(uint32_t SizeInBytes, uint8_t AddrSizeInBytes):
+	m_size(SizeInBytes), m_addrSize(AddrSizeInBytes), m_nbAddrBytes(0), m_addr(0)
+{
+	if( m_size == 0 ) {
+		m_size = 1;
+	}
+	if( (m_addrSize == 0) || (m_addrSize > 4) ) {
+		m_addrSize = 1;
+	}
+	m_pMem = new uint8_t[m_size];
+	memset(m_pMem, 0xFF, m_size);
+}
+
+BrgSimI2cMemSlave::~BrgSimI2cMemSlave(void)
+{
+	delete [] m_pMem;
+}
+
+bool BrgSimI2cMemSlave::Start(bool bRead)
+{
+	if( bRead == false ) {
+		// Write transaction starts with the register address
+		m_nbAddrBytes = 0;
+	} // else read from current address
+	return true;
+}
+
+bool BrgSimI2cMemSlave::WriteByte(uint8_t Data)
+{
+	if( m_nbAddrBytes < m_addrSize ) {
+		if( m_nbAddrBytes == 0 ) {
+			m_addr = 0;
+		}
+		m_addr = (m_addr<<8) | Data;
+		m_nbAddrBytes++;
+		if( m_nbAddrBytes == m_addrSize ) {
+			m_addr %= m_size;
+		}
+	} else {
+		m_pMem[m_addr] = Data;
+		m_addr = (m_addr+1) % m_size;
+	}
+	return true;
+}
+
+uint8_t BrgSimI2cMemSlave::ReadByte(void)
+{
+	uint8_t data = m_pMem[m_addr];
+
+	m_addr = (m_addr+1) % m_size;
+	return data;
+}
+
+/*
+ * @brief BrgSimI2cEeprom constructor.
+ * @param[in]  SizeInBytes  Memory size.
+ * @param[in]  PageSize  Page size: data written in a page write wrap around inside the page.
+ * @param[in]  AddrSizeInBytes  Number of memory address bytes sent after the slave address.
+ * @param[in]  WriteCycleUs  Write cycle duration (tWR) started by the STOP of a write with data.
+ */
+BrgSimI2cEeprom::BrgSimI2cEeprom(uint32_t SizeInBytes, uint16_t PageSize, uint8_t AddrSizeInBytes,
+                                 uint32_t WriteCycleUs):
+	BrgSimI2cMemSlave(SizeInBytes, AddrSizeInBytes), m_pageSize(PageSize),
+	m_writeCycleNs((uint64_t)WriteCycleUs*1000), m_startNs(0), m_stopNs(0), m_busyUntilNs(0),
+	m_nbDataBytes(0), m_writeCycleNb(0), m_busyNackNb(0)
+{
+	if( m_pageSize == 0 ) {
+		m_pageSize = 1;
+	}
+}
+
+void BrgSimI2cEeprom::SetTime(uint64_t StartNs, uint64_t StopNs)
+{
+	m_startNs = StartNs;
+	m_stopNs = StopNs;
+}
+
+bool BrgSimI2cEeprom::Start(bool bRead)
+{
+	m_nbDataBytes = 0;
+	if( m_startNs < m_busyUntilNs ) {
+		// Write cycle in progress: address NACK
+		m_busyNackNb++;
+		return false;
+	}
+	return BrgSimI2cMemSlave::Start(bRead);
+}
+
+bool BrgSimI2cEeprom::WriteByte(uint8_t Data)
+{
+	uint32_t pageStart;
+
+	if( m_nbAddrBytes < m_addrSize ) {
+		return BrgSimI2cMemSlave::WriteByte(Data);
+	}
+	// Page write: address counter rolls over inside the page
+	pageStart = m_addr - (m_addr % m_pageSize);
+	m_pMem[m_addr] = Data;
+	m_addr = pageStart + ((m_addr - pageStart + 1) % m_pageSize);
+	if( m_addr >= m_size ) {
+		m_addr = pageStart;
+	}
+	m_nbDataBytes++;
+	return true;
+}
+
+void BrgSimI2cEeprom::Stop(void)
+{
+	if( m_nbDataBytes != 0 ) {
+		m_busyUntilNs = m_stopNs + m_writeCycleNs;
+		m_writeCycleNb++;
+		m_nbDataBytes = 0;
+	}
+}
+
+/*
+ * SPI NOR flash commands of BrgSimSpiFlash
+ */
+#define SIM_FLASH_CMD_NONE      0x00  // Command ignored (flash busy)
+#define SIM_FLASH_CMD_PP        0x02
+#define SIM_FLASH_CMD_READ      0x03
+#define SIM_FLASH_CMD_WRDI      0x04
+#define SIM_FLASH_CMD_RDSR      0x05
+#define SIM_FLASH_CMD_WREN      0x06
+#define SIM_FLASH_CMD_FAST_READ 0x0B
+#define SIM_FLASH_CMD_SE        0x20
+#define SIM_FLASH_CMD_BE32K     0x52
+#define SIM_FLASH_CMD_RDSFDP    0x5A
+#define SIM_FLASH_CMD_CE        0x60
+#define SIM_FLASH_CMD_RDID      0x9F
+#define SIM_FLASH_CMD_EN4B      0xB7
+#define SIM_FLASH_CMD_CE2       0xC7
+#define SIM_FLASH_CMD_BE        0xD8
+#define SIM_FLASH_CMD_EX4B      0xE9
+#define SIM_FLASH_PAGE_SIZE     256
+#define SIM_FLASH_SFDP_BFPT     0x30  // JEDEC Basic Flash Parameter table offset (16 DWORDs)
+
+/*
+ * SFDP typical time field: (count-1) | unit<<5, unit index of the smallest unit giving count <= 32
+ */
+static uint32_t SimSfdpTime(uint64_t TimeUs, const uint32_t *pUnitUs, uint8_t UnitNb)
+{
+	uint64_t count;
+	uint8_t unit;
+
+	for( unit = 0; unit < UnitNb-1; unit++ ) {
+		if( TimeUs <= (uint64_t)pUnitUs[unit]*32 ) {
+			break;
+		}
+	}
+	count = (TimeUs + pUnitUs[unit] - 1)/pUnitUs[unit];
+	if( count == 0 ) {
+		count = 1;
+	} else if( count > 32 ) {
+		count = 32;
+	}
+	return (uint32_t)(count - 1) | ((uint32_t)unit<<5);
+}
+
+/*
+ * @brief BrgSimSpiFlash constructor: erased flash (0xFF) with 256 bytes pages.
+ * @param[in]  SizeInBytes  Memory size, multiple of 64KB.
+ * @param[in]  PageProgramUs  Page program time.
+ * @param[in]  SectorEraseUs  4KB sector erase time.
+ * @param[in]  BlockEraseUs  64KB block erase time (32KB block erase: average of sector and block
+ *             times, chip erase: block time for each 64KB block).
+ */
+BrgSimSpiFlash::BrgSimSpiFlash(uint32_t SizeInBytes, uint32_t PageProgramUs, uint32_t SectorEraseUs,
+                               uint32_t BlockEraseUs):
+	m_size(SizeInBytes), m_programNs((uint64_t)PageProgramUs*1000),
+	m_sectorEraseNs((uint64_t)SectorEraseUs*1000), m_blockEraseNs((uint64_t)BlockEraseUs*1000),
+	m_startNs(0), m_byteNs(0), m_byteIdx(0), m_busyUntilNs(0), m_bSelected(false),
+	m_cmd(SIM_FLASH_CMD_NONE), m_cmdByteNb(0), m_addr(0), m_bWel(false), m_b4ByteAddr(false),
+	m_pageDataNb(0), m_programNb(0), m_eraseNb(0), m_busyStatusNb(0)
+{
+	const uint32_t eraseUnitUs[4] = {1000, 16000, 128000, 1000000};
+	const uint32_t chipUnitUs[4] = {16000, 256000, 4000000, 64000000};
+	uint32_t dword[16];
+	uint32_t addrBytes;
+	int i;
+
+	if( (m_size == 0) || ((m_size % 0x10000) != 0) ) {
+		m_size = ((m_size/0x10000) + 1)*0x10000;
+	}
+	m_pMem = new uint8_t[m_size];
+	memset(m_pMem, 0xFF, m_size);
+
+	// SFDP header (1 parameter header) and JEDEC Basic Flash Parameter header (rev 1.6, 16 DWORDs)
+	memset(m_sfdp, 0xFF, sizeof(m_sfdp));
+	memcpy(m_sfdp, "SFDP", 4);
+	m_sfdp[4] = 0x06;
+	m_sfdp[5] = 0x01;
+	m_sfdp[6] = 0x00;
+	m_sfdp[8] = 0x00;
+	m_sfdp[9] = 0x06;
+	m_sfdp[10] = 0x01;
+	m_sfdp[11] = 16;
+	m_sfdp[12] = SIM_FLASH_SFDP_BFPT;
+	m_sfdp[13] = 0x00;
+	m_sfdp[14] = 0x00;
+	m_sfdp[15] = 0xFF;
+
+	memset(dword, 0, sizeof(dword));
+	addrBytes = (m_size > 0x1000000) ? 1 : 0; // 3 or 4 bytes / 3 bytes only
+	dword[0] = 0xFF800000 | (addrBytes<<17) | ((uint32_t)SIM_FLASH_CMD_SE<<8) | 0x04 | 0x01;
+	dword[1] = m_size*8 - 1;
+	dword[7] = 12 | ((uint32_t)SIM_FLASH_CMD_SE<<8) | (15<<16) | ((uint32_t)SIM_FLASH_CMD_BE32K<<24);
+	dword[8] = 16 | ((uint32_t)SIM_FLASH_CMD_BE<<8);
+	dword[9] = 3 | (SimSfdpTime(SectorEraseUs, eraseUnitUs, 4)<<4)
+	           | (SimSfdpTime(((uint64_t)SectorEraseUs + BlockEraseUs)/2, eraseUnitUs, 4)<<11)
+	           | (SimSfdpTime(BlockEraseUs, eraseUnitUs, 4)<<18);
+	{
+		const uint32_t programUnitUs[2] = {8, 64};
+		dword[10] = 3 | (8<<4) | (SimSfdpTime(PageProgramUs, programUnitUs, 2)<<8)
+		            | (SimSfdpTime((uint64_t)BlockEraseUs*(m_size/0x10000), chipUnitUs, 4)<<24);
+	}
+	for( i = 0; i < 16; i++ ) {
+		m_sfdp[SIM_FLASH_SFDP_BFPT + 4*i] = (uint8_t)dword[i];
+		m_sfdp[SIM_FLASH_SFDP_BFPT + 4*i + 1] = (uint8_t)(dword[i]>>8);
+		m_sfdp[SIM_FLASH_SFDP_BFPT + 4*i + 2] = (uint8_t)(dword[i]>>16);
+		m_sfdp[SIM_FLASH_SFDP_BFPT + 4*i + 3] = (uint8_t)(dword[i]>>24);
+	}
+}
+
+BrgSimSpiFlash::~BrgSimSpiFlash(void)
+{
+	delete [] m_pMem;
+}
+
+void BrgSimSpiFlash::SetTime(uint64_t StartNs, uint64_t ByteNs)
+{
+	m_startNs = StartNs;
+	m_byteNs = ByteNs;
+	m_byteIdx = 0;
+}
+
+void BrgSimSpiFlash::Select(bool bSelected)
+{
+	if( (m_bSelected == true) && (bSelected == false) ) {
+		EndCommand();
+	}
+	m_bSelected = bSelected;
+	m_cmdByteNb = 0;
+}
+
+uint8_t BrgSimSpiFlash::Transfer(uint8_t Mosi)
+{
+	uint64_t nowNs = GetByteTimeNs();
+	bool bBusy = (nowNs < m_busyUntilNs);
+	uint32_t addrSize = (m_b4ByteAddr == true) ? 4 : 3;
+	uint32_t dummySize = 0;
+	uint32_t byteIdx, pageStart;
+	uint8_t status;
+
+	m_byteIdx++;
+	if( m_bSelected == false ) {
+		return 0xFF;
+	}
+	if( m_cmdByteNb == 0 ) {
+		// Opcode: only the status can be read while busy
+		m_cmd = ((bBusy == true) && (Mosi != SIM_FLASH_CMD_RDSR)) ? SIM_FLASH_CMD_NONE : Mosi;
+		m_cmdByteNb = 1;
+		m_addr = 0;
+		m_pageDataNb = 0;
+		if( m_cmd == SIM_FLASH_CMD_WREN ) {
+			m_bWel = true;
+		} else if( m_cmd == SIM_FLASH_CMD_WRDI ) {
+			m_bWel = false;
+		} else if( m_cmd == SIM_FLASH_CMD_EN4B ) {
+			m_b4ByteAddr = true;
+		} else if( m_cmd == SIM_FLASH_CMD_EX4B ) {
+			m_b4ByteAddr = false;
+		}
+		return 0xFF;
+	}
+	byteIdx = m_cmdByteNb; // Index of the current byte after the opcode + 1
+	m_cmdByteNb++;
+
+	switch( m_cmd ) {
+		case SIM_FLASH_CMD_RDSR:
+			// WIP bit0, WEL bit1, output continuously
+			status = (uint8_t)(((bBusy == true) ? 0x01 : 0x00) | ((m_bWel == true) ? 0x02 : 0x00));
+			if( bBusy == true ) {
+				m_busyStatusNb++;
+			}
+			return status;
+
+		case SIM_FLASH_CMD_RDID:
+			if( byteIdx == 1 ) {
+				return 0xEF;
+			} else if( byteIdx == 2 ) {
+				return 0x40;
+			} else if( byteIdx == 3 ) {
+				for( status = 0; ((uint32_t)1<<status) < m_size; status++ ) {
+				}
+				return status;
+			}
+			return 0xFF;
+
+		case SIM_FLASH_CMD_RDSFDP:
+			// 3 address bytes, 1 dummy byte
+			if( byteIdx <= 3 ) {
+				m_addr = (m_addr<<8) | Mosi;
+				return 0xFF;
+			} else if( byteIdx == 4 ) {
+				return 0xFF;
+			}
+			status = (m_addr < sizeof(m_sfdp)) ? m_sfdp[m_addr] : 0xFF;
+			m_addr++;
+			return status;
+
+		case SIM_FLASH_CMD_FAST_READ:
+			dummySize = 1;
+			// fall through
+		case SIM_FLASH_CMD_READ:
+		case SIM_FLASH_CMD_PP:
+		case SIM_FLASH_CMD_SE:
+		case SIM_FLASH_CMD_BE32K:
+		case SIM_FLASH_CMD_BE:
+			if( byteIdx <= addrSize ) {
+				m_addr = (m_addr<<8) | Mosi;
+				if( byteIdx == addrSize ) {
+					m_addr %= m_size;
+				}
+				return 0xFF;
+			}
+			if( byteIdx <= addrSize + dummySize ) {
+				return 0xFF;
+			}
+			if( (m_cmd == SIM_FLASH_CMD_READ) || (m_cmd == SIM_FLASH_CMD_FAST_READ) ) {
+				status = m_pMem[m_addr];
+				m_addr = (m_addr + 1) % m_size;
+				return status;
+			}
+			if( (m_cmd == SIM_FLASH_CMD_PP) && (m_bWel == true) ) {
+				// Data wrap around inside the page, programming only clears bits
+				pageStart = m_addr - (m_addr % SIM_FLASH_PAGE_SIZE);
+				m_pMem[pageStart + ((m_addr - pageStart + m_pageDataNb) % SIM_FLASH_PAGE_SIZE)] &= Mosi;
+				m_pageDataNb++;
+			}
+			return 0xFF;
+
+		default:
+			return 0xFF;
+	}
+}
+
+/*
+ * private: deselection, start of the program/erase of the command
+ */
+void BrgSimSpiFlash::EndCommand(void)
+{
+	uint32_t addrSize = (m_b4ByteAddr == true) ? 4 : 3;
+	uint32_t eraseSize = 0;
+	uint64_t busyNs = 0;
+
+	if( m_bWel == false ) {
+		return;
+	}
+	switch( m_cmd ) {
+		case SIM_FLASH_CMD_PP:
+			if( m_pageDataNb != 0 ) {
+				busyNs = m_programNs;
+				m_programNb++;
+			}
+			break;
+		case SIM_FLASH_CMD_SE:
+			eraseSize = 0x1000;
+			busyNs = m_sectorEraseNs;
+			break;
+		case SIM_FLASH_CMD_BE32K:
+			eraseSize = 0x8000;
+			busyNs = (m_sectorEraseNs + m_blockEraseNs)/2;
+			break;
+		case SIM_FLASH_CMD_BE:
+			eraseSize = 0x10000;
+			busyNs = m_blockEraseNs;
+			break;
+		case SIM_FLASH_CMD_CE:
+		case SIM_FLASH_CMD_CE2:
+			if( m_cmdByteNb == 1 ) {
+				memset(m_pMem, 0xFF, m_size);
+				busyNs = m_blockEraseNs*(m_size/0x10000);
+				m_eraseNb++;
+			}
+			break;
+		default:
+			break;
+	}
+	if( (eraseSize != 0) && (m_cmdByteNb == 1 + addrSize) ) {
+		memset(&m_pMem[m_addr - (m_addr % eraseSize)], 0xFF, eraseSize);
+		m_eraseNb++;
+	} else if( eraseSize != 0 ) {
+		busyNs = 0;
+	}
+	if( busyNs != 0 ) {
+		m_busyUntilNs = GetByteTimeNs() + busyNs;
+		m_bWel = false;
+	}
+}
+
+/*
+ * @brief BrgSimTransport constructor: default configuration (see BrgSimTransport::GetDefaultConf()).
+ */
+BrgSimTransport::BrgSimTransport(void): m_nbEnumDevices(0)
+{
+	int i;
+
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	InitializeCriticalSection(&m_csList);
+	InitializeCriticalSection(&m_csCanBus);
+#else
+	pthread_mutex_init(&m_csList, NULL);
+	pthread_mutex_init(&m_csCanBus, NULL);
+#endif
+	for( i=0; i<BRG_SIM_MAX_DEVICES; i++ ) {
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+		InitializeCriticalSection(&m_devices[i].Cs);
+#else
+		pthread_mutex_init(&m_devices[i].Cs, NULL);
+#endif
+		m_devices[i].Idx = (uint8_t)i;
+		m_devices[i].OpenCount = 0;
+		m_devices[i].bOpenExclusive = false;
+		ResetDevice(&m_devices[i]);
+	}
+	GetDefaultConf(&m_conf);
+	m_startTimeNs = StlinkCmdStats::GetTimeNs();
+}
+/*
+ * @brief BrgSimTransport destructor. Attached slaves are not deleted (owned by the caller).
+ */
+BrgSimTransport::~BrgSimTransport(void)
+{
+	int i;
+
+	for( i=0; i<BRG_SIM_MAX_DEVICES; i++ ) {
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+		DeleteCriticalSection(&m_devices[i].Cs);
+#else
+		pthread_mutex_destroy(&m_devices[i].Cs);
+#endif
+	}
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	DeleteCriticalSection(&m_csCanBus);
+	DeleteCriticalSection(&m_csList);
+#else
+	pthread_mutex_destroy(&m_csCanBus);
+	pthread_mutex_destroy(&m_csList);
+#endif
+}
+/**
+ * @ingroup SIMULATOR
+ * @brief Default configuration: 1 STLINK-V3 with last bridge firmware on USB High Speed
+ * (~200us per command, ~35MB/s), bus timing modeled, real time.
+ * @param[out] pConf Filled with default configuration.
+ */
+void BrgSimTransport::GetDefaultConf(BrgSimConfT *pConf)
+{
+	if( pConf == NULL ) {
+		return;
+	}
+	pConf->NbDevices = 1;
+	pConf->BridgeFwVersion = FIRMWARE_BRIDGE_STLINK_V3_LAST_VERSION;
+	pConf->UsbLatencyUs = 200;
+	pConf->UsbBandwidthKBps = 35000;
+	pConf->bBusTiming = true;
+	pConf->bRealTime = true;
+	pConf->SpiInputClkKHz = 48000;
+	pConf->I2cInputClkKHz = 48000;
+	pConf->CanInputClkKHz = 48000;
+	pConf->HClkKHz = 192000;
+}
+/**
+ * @ingroup SIMULATOR
+ * @brief Apply a new configuration. All the simulated devices are reset (firmware state,
+ * attached slaves, counters): to be called before attaching slaves and opening the devices.
+ * @param[in] pConf New configuration.
+ *
+ * @retval SS_BAD_PARAMETER NULL pConf or NbDevices out of range
+ * @retval SS_PERMISSION_ERR A device is opened
+ * @retval SS_OK if successful
+ */
+uint32_t BrgSimTransport::SetConf(const BrgSimConfT *pConf)
+{
+	int i;
+
+	if( (pConf == NULL) || (pConf->NbDevices == 0) || (pConf->NbDevices > BRG_SIM_MAX_DEVICES) ) {
+		return SS_BAD_PARAMETER;
+	}
+
+	CSLocker locker(m_csList);
+
+	for( i=0; i<BRG_SIM_MAX_DEVICES; i++ ) {
+		if( m_devices[i].OpenCount != 0 ) {
+			return SS_PERMISSION_ERR;
+		}
+	}
+	m_conf = *pConf;
+	for( i=0; i<BRG_SIM_MAX_DEVICES; i++ ) {
+		ResetDevice(&m_devices[i]);
+	}
+	m_nbEnumDevices = 0;
+	m_startTimeNs = StlinkCmdStats::GetTimeNs();
+	return SS_OK;
+}
+/*
+ * @brief Power-on state of a simulated device (attached slaves are detached).
+ */
+void BrgSimTransport::ResetDevice(SimDeviceT *pDev)
+{
+	int i;
+
+	memset(&pDev->Stats, 0, sizeof(pDev->Stats));
+	pDev->ClockNs = 0;
+	pDev->BusyUntilNs = 0;
+	pDev->RwStatus = STLINK_BRIDGE_OK;
+	pDev->RwBytesOk = 0;
+	pDev->RwErrorInfo = 0;
+
+	pDev->bSpiInit = false;
+	pDev->SpiBaudrate = 0;
+	pDev->bSpiDelay = false;
+	pDev->bSpiNssHard = false;
+	pDev->pSpiSlave = NULL;
+
+	pDev->bI2cInit = false;
+	pDev->I2cTimingReg = 0;
+	pDev->I2cTransState = SIM_I2C_TRANS_IDLE;
+	pDev->pI2cTransSlave = NULL;
+	pDev->I2cSlaves.clear();
+	pDev->bI2cNoWaitBusy = false;
+	pDev->I2cNoWaitDoneNs = 0;
+	pDev->I2cNoWaitStatus = STLINK_BRIDGE_OK;
+	pDev->I2cNoWaitSize = 0;
+
+	pDev->bCanInit = false;
+	pDev->CanMode = SIM_CAN_MODE_NORMAL;
+	pDev->CanBitTimeNs = 0;
+	pDev->bCanRxStarted = false;
+	pDev->bCanRxOverrun = false;
+	for( i=0; i<BRG_SIM_CAN_FILTER_NB; i++ ) {
+		pDev->CanFilters[i].Conf = 0;
+		pDev->CanFilters[i].Id = 0;
+		pDev->CanFilters[i].Mask = 0;
+	}
+	pDev->CanRxFirst = 0;
+	pDev->CanRxNb = 0;
+
+	for( i=0; i<4; i++ ) {
+		pDev->GpioConf[i] = 0;
+	}
+	pDev->GpioInitMask = 0;
+	pDev->GpioOutput = 0;
+	pDev->GpioInput = 0;
+	pDev->GpioInputDriven = 0;
+}
+
+BrgSimTransport::SimDeviceT *BrgSimTransport::GetDevice(uint8_t DevIdx)
+{
+	if( DevIdx >= m_conf.NbDevices ) {
+		return NULL;
+	}
+	return &m_devices[DevIdx];
+}
+/**
+ * @ingroup SIMULATOR
+ * @brief Connect an I2C slave model to the I2C bus of a simulated device.
+ * @param[in] DevIdx  Simulated device index (as in STLinkInterface::OpenDevice()).
+ * @param[in] Addr    7bit slave address, or #I2C_10B_ADDR(Addr) for a 10bit address.
+ * @param[in] pSlave  Slave model (not owned), NULL to disconnect the slave at this address.
+ *
+ * @retval SS_BAD_PARAMETER Wrong DevIdx
+ * @retval SS_OK if successful
+ */
+uint32_t BrgSimTransport::AttachI2cSlave(uint8_t DevIdx, uint16_t Addr, BrgSimI2cSlave *pSlave)
+{
+	SimDeviceT *pDev = GetDevice(DevIdx);
+
+	if( pDev == NULL ) {
+		return SS_BAD_PARAMETER;
+	}
+	CSLocker locker(pDev->Cs);
+	if( pSlave == NULL ) {
+		if( (pDev->pI2cTransSlave != NULL) && (pDev->pI2cTransSlave == pDev->I2cSlaves[Addr]) ) {
+			I2cAbort(pDev);
+		}
+		pDev->I2cSlaves.erase(Addr);
+	} else {
+		pDev->I2cSlaves[Addr] = pSlave;
+	}
+	return SS_OK;
+}
+/**
+ * @ingroup SIMULATOR
+ * @brief Connect a SPI slave model to the SPI bus of a simulated device.
+ * Without slave, written data are lost and read data are 0xFF.
+ * @param[in] DevIdx  Simulated device index.
+ * @param[in] pSlave  Slave model (not owned), NULL to disconnect.
+ *
+ * @retval SS_BAD_PARAMETER Wrong DevIdx
+ * @retval SS_OK if successful
+ */
+uint32_t BrgSimTransport::AttachSpiSlave(uint8_t DevIdx, BrgSimSpiSlave *pSlave)
+{
+	SimDeviceT *pDev = GetDevice(DevIdx);
+
+	if( pDev == NULL ) {
+		return SS_BAD_PARAMETER;
+	}
+	CSLocker locker(pDev->Cs);
+	pDev->pSpiSlave = pSlave;
+	return SS_OK;
+}
+/**
+ * @ingroup SIMULATOR
+ * @brief Drive the level of GPIO inputs of a simulated device (GPIOs not driven follow their pull).
+ * @param[in] DevIdx      Simulated device index.
+ * @param[in] GpioMask    GPIO(s) to drive (one or several value of #Brg_GpioMaskT).
+ * @param[in] GpioLevels  Level of the GPIOs: bit0 for GPIO_0 ... bit3 for GPIO_3.
+ *
+ * @retval SS_BAD_PARAMETER Wrong DevIdx
+ * @retval SS_OK if successful
+ */
+uint32_t BrgSimTransport::SetGpioInput(uint8_t DevIdx, uint8_t GpioMask, uint8_t GpioLevels)
+{
+	SimDeviceT *pDev = GetDevice(DevIdx);
+
+	if( pDev == NULL ) {
+		return SS_BAD_PARAMETER;
+	}
+	CSLocker locker(pDev->Cs);
+	pDev->GpioInputDriven |= GpioMask & 0x0F;
+	pDev->GpioInput = (uint8_t)((pDev->GpioInput & ~GpioMask) | (GpioLevels & GpioMask));
+	return SS_OK;
+}
+/**
+ * @ingroup SIMULATOR
+ * @brief Send a frame on the simulated CAN bus from an external node: received by all the devices
+ * listening to the bus (#CAN_MODE_NORMAL or #CAN_MODE_SILENT) according to their filters.
+ * @param[in] pFrame  Frame to send.
+ *
+ * @retval SS_BAD_PARAMETER NULL pFrame, DLC > 8 or ID not coherent with IDE
+ * @retval SS_OK if successful
+ */
+uint32_t BrgSimTransport::InjectCanFrame(const BrgSimCanFrameT *pFrame)
+{
+	int i;
+
+	if( (pFrame == NULL) || (pFrame->DLC > 8) ) {
+		return SS_BAD_PARAMETER;
+	}
+	if( pFrame->ID > ((pFrame->bIde == true) ? 0x1FFFFFFFu : 0x7FFu) ) {
+		return SS_BAD_PARAMETER;
+	}
+
+	CSLocker locker(m_csCanBus);
+
+	for( i=0; i<m_conf.NbDevices; i++ ) {
+		if( (m_devices[i].CanMode == SIM_CAN_MODE_NORMAL) || (m_devices[i].CanMode == SIM_CAN_MODE_SILENT) ) {
+			CanDeliver(&m_devices[i], pFrame);
+		}
+	}
+	return SS_OK;
+}
+/**
+ * @ingroup SIMULATOR
+ * @brief Get the counters of a simulated device, see #BrgSimStatsT.
+ * @param[in]  DevIdx  Simulated device index.
+ * @param[out] pStats  Filled with the counters.
+ *
+ * @retval SS_BAD_PARAMETER Wrong DevIdx or NULL pStats
+ * @retval SS_OK if successful
+ */
+uint32_t BrgSimTransport::GetStats(uint8_t DevIdx, BrgSimStatsT *pStats)
+{
+	SimDeviceT *pDev = GetDevice(DevIdx);
+
+	if( (pDev == NULL) || (pStats == NULL) ) {
+		return SS_BAD_PARAMETER;
+	}
+	CSLocker locker(pDev->Cs);
+	*pStats = pDev->Stats;
+	return SS_OK;
+}
+/**
+ * @ingroup SIMULATOR
+ * @brief Reset the counters of a simulated device.
+ * @param[in]  DevIdx  Simulated device index.
+ *
+ * @retval SS_BAD_PARAMETER Wrong DevIdx
+ * @retval SS_OK if successful
+ */
+uint32_t BrgSimTransport::ResetStats(uint8_t DevIdx)
+{
+	SimDeviceT *pDev = GetDevice(DevIdx);
+
+	if( pDev == NULL ) {
+		return SS_BAD_PARAMETER;
+	}
+	CSLocker locker(pDev->Cs);
+	memset(&pDev->Stats, 0, sizeof(pDev->Stats));
+	return SS_OK;
+}
+
+// ------------------------------ Transport --------------------------------- //
+/*
+ * @brief See STLink_Reenumerate() in STLinkUSBDriver.h: the simulated devices are always present.
+ *
+ * @retval SS_BAD_PARAMETER IfId is not STLINK_BRIDGE
+ * @retval SS_OK if successful
+ */
+uint32_t BrgSimTransport::Reenumerate(STLink_EnumStlinkInterfaceT IfId, uint8_t bClearList)
+{
+	(void)bClearList;
+	if( IfId != STLINK_BRIDGE ) {
+		return SS_BAD_PARAMETER;
+	}
+	CSLocker locker(m_csList);
+	m_nbEnumDevices = m_conf.NbDevices;
+	return SS_OK;
+}
+
+uint32_t BrgSimTransport::GetNbDevices(STLink_EnumStlinkInterfaceT IfId)
+{
+	if( IfId != STLINK_BRIDGE ) {
+		return 0;
+	}
+	return m_nbEnumDevices;
+}
+/*
+ * @brief See STLink_GetDeviceInfo2() in STLinkUSBDriver.h.
+ * Serial number of device N is "53494D425247" ("SIMBRG" in hexa) followed by N+1 on 12 digits.
+ *
+ * @retval SS_BAD_PARAMETER Wrong IfId, DevIdxInList or NULL pInfo
+ * @retval SS_TRUNCATED_DATA InfoSize greater than sizeof(STLink_DeviceInfo2T): exceeding bytes set to 0
+ * @retval SS_OK if successful
+ */
+uint32_t BrgSimTransport::GetDeviceInfo2(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+                                         STLink_DeviceInfo2T *pInfo, uint32_t InfoSize)
+{
+	STLink_DeviceInfo2T info;
+	uint32_t status = SS_OK;
+	uint32_t copySize = InfoSize;
+
+	if( (IfId != STLINK_BRIDGE) || (pInfo == NULL) ) {
+		return SS_BAD_PARAMETER;
+	}
+
+	CSLocker locker(m_csList);
+
+	if( DevIdxInList >= m_nbEnumDevices ) {
+		return SS_BAD_PARAMETER;
+	}
+	memset(&info, 0, sizeof(info));
+	info.StLinkUsbId = DevIdxInList;
+	snprintf(info.EnumUniqueId, SERIAL_NUM_STR_MAX_LEN, "53494D425247%012u", (unsigned int)DevIdxInList+1);
+	info.VendorId = SIM_USB_VID_ST;
+	info.ProductId = SIM_USB_PID_STLINK_V3;
+	info.DeviceUsed = (m_devices[DevIdxInList].OpenCount != 0) ? 1 : 0;
+
+	if( InfoSize > sizeof(STLink_DeviceInfo2T) ) {
+		memset(pInfo, 0, InfoSize);
+		copySize = sizeof(STLink_DeviceInfo2T);
+		status = SS_TRUNCATED_DATA;
+	}
+	memcpy(pInfo, &info, copySize);
+	return status;
+}
+/*
+ * @brief Open a simulated device: shared opening allowed unless exclusive access is required.
+ *
+ * @retval SS_BAD_PARAMETER Wrong IfId, DevIdxInList or NULL pHandle
+ * @retval SS_PERMISSION_ERR Device already opened in exclusive mode, or opened while exclusive
+ *                           access is required
+ * @retval SS_OK if successful
+ */
+uint32_t BrgSimTransport::OpenDevice(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+                                     uint8_t bExclusiveAccess, void **pHandle)
+{
+	SimDeviceT *pDev;
+
+	if( (IfId != STLINK_BRIDGE) || (pHandle == NULL) ) {
+		return SS_BAD_PARAMETER;
+	}
+
+	CSLocker locker(m_csList);
+
+	if( DevIdxInList >= m_nbEnumDevices ) {
+		return SS_BAD_PARAMETER;
+	}
+	pDev = &m_devices[DevIdxInList];
+	if( (pDev->OpenCount != 0) && ((pDev->bOpenExclusive == true) || (bExclusiveAccess != 0)) ) {
+		return SS_PERMISSION_ERR;
+	}
+	pDev->OpenCount++;
+	pDev->bOpenExclusive = (bExclusiveAccess != 0);
+	*pHandle = pDev;
+	return SS_OK;
+}
+/*
+ * @brief Close a simulated device opened with BrgSimTransport::OpenDevice(); firmware state is kept
+ * as on a real STLink.
+ *
+ * @retval SS_BAD_PARAMETER Unknown or not opened handle
+ * @retval SS_OK if successful
+ */
+uint32_t BrgSimTransport::CloseDevice(void *pHandle)
+{
+	int i;
+
+	CSLocker locker(m_csList);
+
+	for( i=0; i<BRG_SIM_MAX_DEVICES; i++ ) {
+		if( (pHandle == &m_devices[i]) && (m_devices[i].OpenCount != 0) ) {
+			m_devices[i].OpenCount--;
+			if( m_devices[i].OpenCount == 0 ) {
+				m_devices[i].bOpenExclusive = false;
+			}
+			return SS_OK;
+		}
+	}
+	return SS_BAD_PARAMETER;
+}
+/*
+ * @brief Execute a command on the simulated firmware, then wait (bRealTime) or advance the
+ * device clock up to the end of the command:
+ * - USB cost: UsbLatencyUs + transferred bytes / UsbBandwidthKBps.
+ * - Read commands return once the bus transfer is done.
+ * - Write commands return after the USB transfer; the bus transfer delays the next command
+ *   of the device (as the firmware handles commands one at a time).
+ * - READ_NO_WAIT bus transfer does not delay the next commands: firmware is BUSY meanwhile.
+ *
+ * @retval SS_BAD_PARAMETER Unknown or not opened handle, NULL pRequest or NULL data buffer
+ * @retval SS_TRANSFER_ERR Unknown command, or command other than GET_RWCMD_STATUS in BUSY state
+ * @retval SS_TRUNCATED_DATA Firmware answer size is not the one expected by the host
+ * @retval SS_TIMEOUT Command duration greater than TimeoutMs
+ * @retval SS_OK if successful
+ */
+uint32_t BrgSimTransport::SendCommand(void *pHandle, STLink_DeviceRequestT *pRequest, uint32_t TimeoutMs)
+{
+	SimDeviceT *pDev = NULL;
+	const uint8_t *pCdb;
+	uint8_t *pData;
+	uint32_t dataSize, answerSize = 0, usbBytes;
+	uint32_t ssStatus = SS_OK;
+	uint64_t startNs, cmdNs, busNs = 0, endNs;
+	bool bWriteCmd = false;
+	int i;
+
+	for( i=0; i<BRG_SIM_MAX_DEVICES; i++ ) {
+		if( (pHandle == &m_devices[i]) && (m_devices[i].OpenCount != 0) ) {
+			pDev = &m_devices[i];
+		}
+	}
+	if( (pDev == NULL) || (pRequest == NULL) ) {
+		return SS_BAD_PARAMETER;
+	}
+	pCdb = pRequest->CDBByte;
+	pData = (uint8_t*)pRequest->Buffer;
+	dataSize = pRequest->BufferLength;
+	if( (pData == NULL) && (dataSize != 0) ) {
+		return SS_BAD_PARAMETER;
+	}
+
+	CSLocker locker(pDev->Cs);
+
+	startNs = GetTimeNs(pDev);
+	pDev->Stats.NbCommands++;
+
+	// READ_NO_WAIT completion
+	if( (pDev->bI2cNoWaitBusy == true) && (startNs >= pDev->I2cNoWaitDoneNs) ) {
+		pDev->bI2cNoWaitBusy = false;
+		pDev->RwStatus = pDev->I2cNoWaitStatus;
+		pDev->RwBytesOk = pDev->I2cNoWaitSize;
+		pDev->RwErrorInfo = 0;
+	}
+
+	if( pCdb[0] == STLINK_BRIDGE_COMMAND ) {
+		if( pCdb[1] == STLINK_BRIDGE_GET_RWCMD_STATUS ) {
+			pDev->Stats.NbStatusCommands++;
+		} else if( pDev->bI2cNoWaitBusy == true ) {
+			// Only GET_RWCMD_STATUS is allowed in BUSY state (see Brg::ReadNoWaitI2C())
+			pDev->Stats.NbBusyErrors++;
+			return SS_TRANSFER_ERR;
+		}
+		bWriteCmd = (pCdb[1] == STLINK_BRIDGE_WRITE_SPI) || (pCdb[1] == STLINK_BRIDGE_WRITE_I2C)
+		            || (pCdb[1] == STLINK_BRIDGE_WRITE_MSG_CAN);
+	}
+
+	// Firmware handles the command once previous bus transfer is done
+	cmdNs = (startNs > pDev->BusyUntilNs) ? startNs : pDev->BusyUntilNs;
+
+	if( pCdb[0] == STLINK_BRIDGE_COMMAND ) {
+		busNs = ExecBridgeCmd(pDev, pCdb, pData, dataSize, cmdNs, &answerSize);
+	} else if( pCdb[0] == ST_GETVERSION_EXT ) {
+		uint8_t version[12];
+		memset(version, 0, sizeof(version));
+		version[0] = 3; // STLINK-V3
+		version[2] = 7; // JTAG/SWD version
+		version[3] = 2; // MSC/VCP version
+		version[4] = m_conf.BridgeFwVersion;
+		PutU16(&version[8], SIM_USB_VID_ST);
+		PutU16(&version[10], SIM_USB_PID_STLINK_V3);
+		answerSize = PutAnswer(pData, dataSize, version, sizeof(version));
+	} else if( pCdb[0] == STLINK_GET_TARGET_VOLTAGE ) {
+		// VREFINT measure, T_VCC measure (not connected on bridge connector: 0V)
+		uint8_t adcMeasures[8];
+		PutU32(&adcMeasures[0], 1489);
+		PutU32(&adcMeasures[4], 0);
+		answerSize = PutAnswer(pData, dataSize, adcMeasures, sizeof(adcMeasures));
+	} else {
+		ssStatus = SS_TRANSFER_ERR;
+	}
+
+	if( pRequest->InputRequest == REQUEST_WRITE_1ST_EPOUT ) {
+		usbBytes = STLINK_CMD_SIZE_16 + dataSize;
+		pDev->Stats.UsbBytesOut += usbBytes;
+	} else {
+		usbBytes = STLINK_CMD_SIZE_16 + ((answerSize < dataSize) ? answerSize : dataSize);
+		pDev->Stats.UsbBytesOut += STLINK_CMD_SIZE_16;
+		pDev->Stats.UsbBytesIn += usbBytes - STLINK_CMD_SIZE_16;
+		if( (ssStatus == SS_OK) && (answerSize != dataSize) ) {
+			ssStatus = SS_TRUNCATED_DATA;
+		}
+	}
+
+	endNs = cmdNs + (uint64_t)m_conf.UsbLatencyUs*1000 + UsbTimeNs(usbBytes);
+	if( m_conf.bBusTiming == false ) {
+		busNs = 0;
+	}
+	if( bWriteCmd == true ) {
+		pDev->BusyUntilNs = endNs + busNs;
+	} else {
+		endNs += busNs;
+	}
+	if( (TimeoutMs != 0) && ((endNs - startNs) > (uint64_t)TimeoutMs*1000000) ) {
+		endNs = startNs + (uint64_t)TimeoutMs*1000000;
+		ssStatus = SS_TIMEOUT;
+	}
+	WaitUntilNs(pDev, endNs);
+	pDev->Stats.SimTimeNs += endNs - startNs;
+
+	return ssStatus;
+}
+
+// -------------------------------- Timing ---------------------------------- //
+uint64_t BrgSimTransport::GetTimeNs(const SimDeviceT *pDev) const
+{
+	if( m_conf.bRealTime == true ) {
+		return StlinkCmdStats::GetTimeNs() - m_startTimeNs;
+	}
+	return pDev->ClockNs;
+}
+
+void BrgSimTransport::WaitUntilNs(SimDeviceT *pDev, uint64_t TimeNs)
+{
+	if( m_conf.bRealTime == true ) {
+		uint64_t nowNs = GetTimeNs(pDev);
+		while( nowNs < TimeNs ) {
+			if( (TimeNs - nowNs) > SIM_SPIN_WAIT_NS ) {
+				// Sleep granularity is coarse: keep the end of the wait for polling
+				std::this_thread::sleep_for(std::chrono::nanoseconds(TimeNs - nowNs - SIM_SPIN_WAIT_NS/2));
+			} else {
+				std::this_thread::yield();
+			}
+			nowNs = GetTimeNs(pDev);
+		}
+	} else if( TimeNs > pDev->ClockNs ) {
+		pDev->ClockNs = TimeNs;
+	}
+}
+
+uint64_t BrgSimTransport::UsbTimeNs(uint32_t NbBytes) const
+{
+	if( m_conf.UsbBandwidthKBps == 0 ) {
+		return 0;
+	}
+	return (uint64_t)NbBytes*1000000/m_conf.UsbBandwidthKBps;
+}
+/*
+ * SCK = SPI input clock / prescaler (2 to 256), 8 clocks per byte, 4us inter-byte delay if required
+ */
+uint64_t BrgSimTransport::SpiTimeNs(const SimDeviceT *pDev, uint32_t NbBytes) const
+{
+	uint64_t timeNs;
+
+	timeNs = (uint64_t)NbBytes*8*(2u<<pDev->SpiBaudrate)*1000000/m_conf.SpiInputClkKHz;
+	if( pDev->bSpiDelay == true ) {
+		timeNs += (uint64_t)NbBytes*4000;
+	}
+	return timeNs;
+}
+/*
+ * SCL period from TimingReg: (SCLL+1 + SCLH+1) * (PRESC+1) / I2C input clock,
+ * 9 clocks per byte (address byte included) plus START and STOP.
+ */
+uint64_t BrgSimTransport::I2cTimeNs(const SimDeviceT *pDev, uint32_t NbBytes) const
+{
+	uint32_t presc, scll, sclh;
+	uint64_t sclPeriodPs;
+
+	presc = (pDev->I2cTimingReg>>28) & 0xF;
+	sclh = (pDev->I2cTimingReg>>8) & 0xFF;
+	scll = pDev->I2cTimingReg & 0xFF;
+	sclPeriodPs = (uint64_t)(scll+1+sclh+1)*(presc+1)*1000000000/m_conf.I2cInputClkKHz;
+
+	return ((uint64_t)(NbBytes+1)*9 + 2)*sclPeriodPs/1000;
+}
+/*
+ * Frame length without bit stuffing: 47 bits + data for standard frame, 67 bits + data for extended
+ * (interframe space included).
+ */
+uint64_t BrgSimTransport::CanTimeNs(const SimDeviceT *pDev, const BrgSimCanFrameT *pFrame) const
+{
+	uint32_t nbBits;
+
+	nbBits = (pFrame->bIde == true) ? 67 : 47;
+	if( pFrame->bRtr == false ) {
+		nbBits += 8*(uint32_t)pFrame->DLC;
+	}
+	return (uint64_t)nbBits*pDev->CanBitTimeNs;
+}
+
+// ------------------------------- Commands --------------------------------- //
+/*
+ * @brief STLINK_BRIDGE_COMMAND decoding.
+ * @return Duration of the bus transfer in ns.
+ */
+uint64_t BrgSimTransport::ExecBridgeCmd(SimDeviceT *pDev, const uint8_t *pCdb, uint8_t *pData,
+                                        uint32_t DataSize, uint64_t NowNs, uint32_t *pAnswerSize)
+{
+	uint8_t answer[12];
+	uint32_t inputClk;
+
+	switch( pCdb[1] ) {
+		case STLINK_BRIDGE_CLOSE:
+			*pAnswerSize = PutStatus(pData, DataSize, CloseCom(pDev, pCdb[2]));
+			return 0;
+
+		case STLINK_BRIDGE_GET_RWCMD_STATUS:
+			memset(answer, 0, sizeof(answer));
+			if( pDev->bI2cNoWaitBusy == true ) {
+				PutU16(&answer[0], STLINK_BRIDGE_CMD_BUSY);
+			} else {
+				PutU16(&answer[0], pDev->RwStatus);
+				PutU16(&answer[2], pDev->RwBytesOk);
+				PutU32(&answer[4], pDev->RwErrorInfo);
+			}
+			*pAnswerSize = PutAnswer(pData, DataSize, answer, SIM_RW_STATUS_LEN);
+			return 0;
+
+		case STLINK_BRIDGE_GET_CLOCK:
+			memset(answer, 0, sizeof(answer));
+			PutU16(&answer[0], STLINK_BRIDGE_OK);
+			if( pCdb[2] == STLINK_SPI_COM ) {
+				inputClk = m_conf.SpiInputClkKHz;
+			} else if( pCdb[2] == STLINK_I2C_COM ) {
+				inputClk = m_conf.I2cInputClkKHz;
+			} else if( pCdb[2] == STLINK_CAN_COM ) {
+				inputClk = m_conf.CanInputClkKHz;
+			} else if( pCdb[2] == STLINK_GPIO_COM ) {
+				inputClk = 0;
+			} else {
+				inputClk = 0;
+				PutU16(&answer[0], STLINK_BRIDGE_BAD_PARAM);
+			}
+			PutU32(&answer[4], inputClk);
+			PutU32(&answer[8], m_conf.HClkKHz);
+			*pAnswerSize = PutAnswer(pData, DataSize, answer, 12);
+			return 0;
+
+		case STLINK_BRIDGE_INIT_SPI:
+		case STLINK_BRIDGE_WRITE_SPI:
+		case STLINK_BRIDGE_READ_SPI:
+		case STLINK_BRIDGE_CS_SPI:
+			return ExecSpiCmd(pDev, pCdb, pData, DataSize, NowNs, pAnswerSize);
+
+		case STLINK_BRIDGE_READ_NO_WAIT_I2C:
+		case STLINK_BRIDGE_GET_READ_DATA_I2C:
+			if( m_conf.BridgeFwVersion < FIRMWARE_BRIDGE_MIN_VER_FOR_READ_NO_WAIT_I2C ) {
+				break;
+			}
+			return ExecI2cCmd(pDev, pCdb, pData, DataSize, NowNs, pAnswerSize);
+		case STLINK_BRIDGE_INIT_I2C:
+		case STLINK_BRIDGE_WRITE_I2C:
+		case STLINK_BRIDGE_READ_I2C:
+			return ExecI2cCmd(pDev, pCdb, pData, DataSize, NowNs, pAnswerSize);
+
+		case STLINK_BRIDGE_INIT_CAN:
+		case STLINK_BRIDGE_WRITE_MSG_CAN:
+		case STLINK_BRIDGE_INIT_FILTER_CAN:
+		case STLINK_BRIDGE_START_MSG_RECEPTION_CAN:
+		case STLINK_BRIDGE_STOP_MSG_RECEPTION_CAN:
+		case STLINK_BRIDGE_GET_NB_RXMSG_CAN:
+		case STLINK_BRIDGE_GET_RXMSG_CAN:
+			if( m_conf.BridgeFwVersion < FIRMWARE_BRIDGE_MIN_VER_FOR_CAN ) {
+				break;
+			}
+			return ExecCanCmd(pDev, pCdb, pData, DataSize, pAnswerSize);
+
+		case STLINK_BRIDGE_INIT_GPIO:
+		case STLINK_BRIDGE_SET_RESET_GPIO:
+		case STLINK_BRIDGE_READ_GPIO:
+			ExecGpioCmd(pDev, pCdb, pData, DataSize, pAnswerSize);
+			return 0;
+
+		default:
+			break;
+	}
+	*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_UNKNOWN_CMD);
+	return 0;
+}
+/*
+ * @brief STLINK_BRIDGE_CLOSE: de-initialize the given com (0 for all).
+ * @return Firmware status
+ */
+uint16_t BrgSimTransport::CloseCom(SimDeviceT *pDev, uint8_t Com)
+{
+	if( (Com != 0) && (Com != STLINK_SPI_COM) && (Com != STLINK_I2C_COM)
+	    && (Com != STLINK_CAN_COM) && (Com != STLINK_GPIO_COM) ) {
+		return STLINK_BRIDGE_BAD_PARAM;
+	}
+	if( (Com == 0) || (Com == STLINK_SPI_COM) ) {
+		pDev->bSpiInit = false;
+	}
+	if( (Com == 0) || (Com == STLINK_I2C_COM) ) {
+		I2cAbort(pDev);
+		pDev->bI2cInit = false;
+		pDev->I2cNoWaitSize = 0;
+	}
+	if( (Com == 0) || (Com == STLINK_CAN_COM) ) {
+		CSLocker locker(m_csCanBus);
+		pDev->bCanInit = false;
+		pDev->CanMode = SIM_CAN_MODE_NORMAL;
+		pDev->bCanRxStarted = false;
+		pDev->bCanRxOverrun = false;
+		pDev->CanRxFirst = 0;
+		pDev->CanRxNb = 0;
+	}
+	if( (Com == 0) || (Com == STLINK_GPIO_COM) ) {
+		pDev->GpioInitMask = 0;
+	}
+	return STLINK_BRIDGE_OK;
+}
+
+// --------------------------------- SPI ------------------------------------ //
+uint64_t BrgSimTransport::ExecSpiCmd(SimDeviceT *pDev, const uint8_t *pCdb, uint8_t *pData,
+                                     uint32_t DataSize, uint64_t NowNs, uint32_t *pAnswerSize)
+{
+	uint16_t size = SIM_GET_U16(&pCdb[2]);
+	uint32_t i;
+
+	if( (pDev->pSpiSlave != NULL) && (pDev->bSpiInit == true) ) {
+		pDev->pSpiSlave->SetTime(NowNs, (m_conf.bBusTiming == true) ? SpiTimeNs(pDev, 1) : 0);
+	}
+
+	switch( pCdb[1] ) {
+		case STLINK_BRIDGE_INIT_SPI:
+			// Direction, data size and baudrate prescaler range check
+			if( (pCdb[2] > 3) || (pCdb[4] > 1) || (pCdb[6] > 7) ) {
+				*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_BAD_PARAM);
+				return 0;
+			}
+			pDev->SpiBaudrate = pCdb[6];
+			pDev->bSpiNssHard = ((pCdb[5]&0x01) != 0);
+			pDev->bSpiDelay = (pCdb[9] != 0);
+			pDev->bSpiInit = true;
+			*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_OK);
+			return 0;
+
+		case STLINK_BRIDGE_CS_SPI:
+			if( pDev->bSpiInit == false ) {
+				*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_INIT_NOT_DONE);
+				return 0;
+			}
+			if( pDev->pSpiSlave != NULL ) {
+				pDev->pSpiSlave->Select(pCdb[2] == 0);
+			}
+			*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_OK);
+			return 0;
+
+		case STLINK_BRIDGE_WRITE_SPI:
+			// No answer, status through GET_RWCMD_STATUS
+			*pAnswerSize = 0;
+			pDev->RwErrorInfo = 0;
+			if( pDev->bSpiInit == false ) {
+				pDev->RwStatus = STLINK_BRIDGE_INIT_NOT_DONE;
+				pDev->RwBytesOk = 0;
+				return 0;
+			}
+			if( (size > 8) && (DataSize < (uint32_t)size-8) ) {
+				pDev->RwStatus = STLINK_BRIDGE_BAD_PARAM;
+				pDev->RwBytesOk = 0;
+				return 0;
+			}
+			if( pDev->pSpiSlave != NULL ) {
+				if( pDev->bSpiNssHard == true ) {
+					pDev->pSpiSlave->Select(true);
+				}
+				for( i=0; i<size; i++ ) {
+					// 8 first bytes in the CDB, the others in the data stage
+					pDev->pSpiSlave->Transfer((i<8) ? pCdb[4+i] : pData[i-8]);
+				}
+				if( pDev->bSpiNssHard == true ) {
+					pDev->pSpiSlave->Select(false);
+				}
+			}
+			pDev->RwStatus = STLINK_BRIDGE_OK;
+			pDev->RwBytesOk = size;
+			pDev->Stats.BusBytes += size;
+			return SpiTimeNs(pDev, size);
+
+		case STLINK_BRIDGE_READ_SPI:
+			*pAnswerSize = size;
+			pDev->RwErrorInfo = 0;
+			if( pDev->bSpiInit == false ) {
+				memset(pData, 0, (size < DataSize) ? size : DataSize);
+				pDev->RwStatus = STLINK_BRIDGE_INIT_NOT_DONE;
+				pDev->RwBytesOk = 0;
+				return 0;
+			}
+			if( (pDev->pSpiSlave != NULL) && (pDev->bSpiNssHard == true) ) {
+				pDev->pSpiSlave->Select(true);
+			}
+			for( i=0; i<size; i++ ) {
+				uint8_t miso = (pDev->pSpiSlave != NULL) ? pDev->pSpiSlave->Transfer(0xFF) : 0xFF;
+				if( i < DataSize ) {
+					pData[i] = miso;
+				}
+			}
+			if( (pDev->pSpiSlave != NULL) && (pDev->bSpiNssHard == true) ) {
+				pDev->pSpiSlave->Select(false);
+			}
+			pDev->RwStatus = STLINK_BRIDGE_OK;
+			pDev->RwBytesOk = size;
+			pDev->Stats.BusBytes += size;
+			return SpiTimeNs(pDev, size);
+
+		default:
+			break;
+	}
+	*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_UNKNOWN_CMD);
+	return 0;
+}
+
+// --------------------------------- I2C ------------------------------------ //
+uint64_t BrgSimTransport::ExecI2cCmd(SimDeviceT *pDev, const uint8_t *pCdb, uint8_t *pData,
+                                     uint32_t DataSize, uint64_t NowNs, uint32_t *pAnswerSize)
+{
+	uint16_t size = SIM_GET_U16(&pCdb[2]);
+	uint16_t addr = SIM_GET_U16(&pCdb[4]);
+	uint16_t status, bytesOk;
+	uint8_t answer[SIM_RW_STATUS_LEN];
+	uint64_t busNs, timeoutNs, answerNs;
+	uint32_t i;
+
+	switch( pCdb[1] ) {
+		case STLINK_BRIDGE_INIT_I2C:
+			I2cAbort(pDev);
+			pDev->I2cTimingReg = SIM_GET_U32(&pCdb[2]);
+			pDev->bI2cInit = true;
+			*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_OK);
+			return 0;
+
+		case STLINK_BRIDGE_WRITE_I2C:
+			// No answer, status through GET_RWCMD_STATUS
+			*pAnswerSize = 0;
+			if( (size > 4) && (DataSize < (uint32_t)size-4) ) {
+				pDev->RwStatus = STLINK_BRIDGE_BAD_PARAM;
+				pDev->RwBytesOk = 0;
+				pDev->RwErrorInfo = 0;
+				return 0;
+			}
+			// 4 first bytes in the CDB, the others in the data stage
+			pDev->Scratch.resize(size);
+			for( i=0; i<size; i++ ) {
+				pDev->Scratch[i] = (i<4) ? pCdb[8+i] : pData[i-4];
+			}
+			pDev->RwStatus = I2cTransfer(pDev, addr, pCdb[6], false, pDev->Scratch.data(), size, NowNs, &bytesOk);
+			pDev->RwBytesOk = bytesOk;
+			pDev->RwErrorInfo = 0;
+			if( pDev->RwStatus == STLINK_BRIDGE_INIT_NOT_DONE ) {
+				return 0;
+			}
+			pDev->Stats.BusBytes += bytesOk;
+			return I2cTimeNs(pDev, bytesOk);
+
+		case STLINK_BRIDGE_READ_I2C:
+			*pAnswerSize = size;
+			pDev->Scratch.resize(size);
+			pDev->RwStatus = I2cTransfer(pDev, addr, pCdb[6], true, pDev->Scratch.data(), size, NowNs, &bytesOk);
+			pDev->RwBytesOk = bytesOk;
+			pDev->RwErrorInfo = 0;
+			memcpy(pData, pDev->Scratch.data(), (size < DataSize) ? size : DataSize);
+			if( pDev->RwStatus == STLINK_BRIDGE_INIT_NOT_DONE ) {
+				return 0;
+			}
+			pDev->Stats.BusBytes += bytesOk;
+			return I2cTimeNs(pDev, bytesOk);
+
+		case STLINK_BRIDGE_READ_NO_WAIT_I2C:
+			// Answer in GET_RWCMD_STATUS format
+			memset(answer, 0, sizeof(answer));
+			if( (size == 0) || (size > BRG_SIM_I2C_NO_WAIT_MAX) ) {
+				PutU16(&answer[0], STLINK_BRIDGE_BAD_PARAM);
+				*pAnswerSize = PutAnswer(pData, DataSize, answer, sizeof(answer));
+				return 0;
+			}
+			status = I2cTransfer(pDev, addr, pCdb[6], true, pDev->I2cNoWaitData, size, NowNs, &bytesOk);
+			pDev->I2cNoWaitSize = size;
+			if( status == STLINK_BRIDGE_INIT_NOT_DONE ) {
+				pDev->RwStatus = status;
+				pDev->RwBytesOk = 0;
+				PutU16(&answer[0], status);
+				*pAnswerSize = PutAnswer(pData, DataSize, answer, sizeof(answer));
+				return 0;
+			}
+			pDev->Stats.BusBytes += bytesOk;
+			busNs = (m_conf.bBusTiming == true) ? I2cTimeNs(pDev, bytesOk) : 0;
+			timeoutNs = (uint64_t)((pCdb[7] == 0) ? 1 : pCdb[7])*SIM_I2C_NO_WAIT_TIMEOUT_UNIT_MS*1000000;
+			if( busNs > timeoutNs ) {
+				busNs = timeoutNs;
+				status = STLINK_BRIDGE_TIMEOUT_ERR;
+			}
+			// Transfer starts once the command is received, answer is sent right away
+			answerNs = NowNs + (uint64_t)m_conf.UsbLatencyUs*1000 + UsbTimeNs(STLINK_CMD_SIZE_16 + sizeof(answer));
+			pDev->I2cNoWaitStatus = status;
+			pDev->I2cNoWaitDoneNs = NowNs + busNs;
+			if( pDev->I2cNoWaitDoneNs > answerNs ) {
+				pDev->bI2cNoWaitBusy = true;
+				PutU16(&answer[0], STLINK_BRIDGE_CMD_BUSY);
+			} else {
+				pDev->RwStatus = status;
+				pDev->RwBytesOk = bytesOk;
+				pDev->RwErrorInfo = 0;
+				PutU16(&answer[0], status);
+				PutU16(&answer[2], bytesOk);
+			}
+			*pAnswerSize = PutAnswer(pData, DataSize, answer, sizeof(answer));
+			return 0;
+
+		case STLINK_BRIDGE_GET_READ_DATA_I2C:
+			*pAnswerSize = size;
+			for( i=0; (i<size) && (i<DataSize); i++ ) {
+				pData[i] = (i < pDev->I2cNoWaitSize) ? pDev->I2cNoWaitData[i] : 0;
+			}
+			return 0;
+
+		default:
+			break;
+	}
+	*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_UNKNOWN_CMD);
+	return 0;
+}
+/*
+ * @brief I2C master transaction on the simulated bus, full or partial (see Brg_I2cRWTransfer):
+ * START (or repeated START) with address for full/start, data, STOP for full/stop. A cont/stop in the
+ * other direction than the ongoing transaction starts with a repeated START: assumed firmware behaviour
+ * used by Brg::WriteReadI2C(), not documented by the firmware interface nor verified on hardware.
+ * Bytes not read because of an error are set to 0xFF.
+ * @param[out] pBytesOk Number of bytes transferred before the error.
+ * @return Firmware status
+ */
+uint16_t BrgSimTransport::I2cTransfer(SimDeviceT *pDev, uint16_t Addr, uint8_t TransType, bool bRead,
+                                      uint8_t *pData, uint16_t Size, uint64_t NowNs, uint16_t *pBytesOk)
+{
+	BrgSimI2cSlave *pSlave;
+	std::map<uint16_t, BrgSimI2cSlave*>::iterator it;
+	uint64_t stopNs;
+	uint16_t i;
+
+	*pBytesOk = 0;
+	if( bRead == true ) {
+		memset(pData, 0xFF, Size);
+	}
+	if( pDev->bI2cInit == false ) {
+		return STLINK_BRIDGE_INIT_NOT_DONE;
+	}
+
+	stopNs = NowNs + ((m_conf.bBusTiming == true) ? I2cTimeNs(pDev, Size) : 0);
+	if( (TransType == 0) || (TransType == 1) ) { // I2C_FULL_RW_TRANS, I2C_START_RW_TRANS
+		it = pDev->I2cSlaves.find(Addr);
+		pSlave = (it != pDev->I2cSlaves.end()) ? it->second : NULL;
+		if( (pDev->pI2cTransSlave != NULL) && (pDev->pI2cTransSlave != pSlave) ) {
+			// Repeated START to another slave: end of the previous transaction for that one
+			pDev->pI2cTransSlave->Stop();
+		}
+		pDev->pI2cTransSlave = NULL;
+		pDev->I2cTransState = SIM_I2C_TRANS_IDLE;
+		if( pSlave != NULL ) {
+			pSlave->SetTime(NowNs, stopNs);
+		}
+		if( (pSlave == NULL) || (pSlave->Start(bRead) == false) ) {
+			// Address NACK
+			if( pSlave != NULL ) {
+				pSlave->Stop();
+			}
+			return STLINK_BRIDGE_I2C_ERROR;
+		}
+	} else if( (TransType == 2) || (TransType == 3) ) { // I2C_CONT_RW_TRANS, I2C_STOP_RW_TRANS
+		if( (pDev->I2cTransState == SIM_I2C_TRANS_IDLE) || (pDev->pI2cTransSlave == NULL) ) {
+			I2cAbort(pDev);
+			return STLINK_BRIDGE_ABORT_TRANS;
+		}
+		pSlave = pDev->pI2cTransSlave;
+		pSlave->SetTime(NowNs, stopNs);
+		if( pDev->I2cTransState != ((bRead == true) ? SIM_I2C_TRANS_READ : SIM_I2C_TRANS_WRITE) ) {
+			// Direction change: repeated START with the transaction address
+			if( pSlave->Start(bRead) == false ) {
+				pSlave->Stop();
+				pDev->pI2cTransSlave = NULL;
+				pDev->I2cTransState = SIM_I2C_TRANS_IDLE;
+				return STLINK_BRIDGE_I2C_ERROR;
+			}
+		}
+	} else {
+		return STLINK_BRIDGE_BAD_PARAM;
+	}
+
+	for( i=0; i<Size; i++ ) {
+		if( bRead == true ) {
+			pData[i] = pSlave->ReadByte();
+		} else if( pSlave->WriteByte(pData[i]) == false ) {
+			// Data NACK: firmware sends STOP
+			pSlave->Stop();
+			pDev->pI2cTransSlave = NULL;
+			pDev->I2cTransState = SIM_I2C_TRANS_IDLE;
+			*pBytesOk = i;
+			return STLINK_BRIDGE_I2C_ERROR;
+		}
+	}
+	*pBytesOk = Size;
+
+	if( (TransType == 0) || (TransType == 3) ) {
+		pSlave->Stop();
+		pDev->pI2cTransSlave = NULL;
+		pDev->I2cTransState = SIM_I2C_TRANS_IDLE;
+	} else {
+		pDev->pI2cTransSlave = pSlave;
+		pDev->I2cTransState = (bRead == true) ? SIM_I2C_TRANS_READ : SIM_I2C_TRANS_WRITE;
+	}
+	return STLINK_BRIDGE_OK;
+}
+
+void BrgSimTransport::I2cAbort(SimDeviceT *pDev)
+{
+	if( pDev->pI2cTransSlave != NULL ) {
+		pDev->pI2cTransSlave->Stop();
+	}
+	pDev->pI2cTransSlave = NULL;
+	pDev->I2cTransState = SIM_I2C_TRANS_IDLE;
+}
+
+// --------------------------------- CAN ------------------------------------ //
+uint64_t BrgSimTransport::ExecCanCmd(SimDeviceT *pDev, const uint8_t *pCdb, uint8_t *pData,
+                                     uint32_t DataSize, uint32_t *pAnswerSize)
+{
+	BrgSimCanFrameT frame;
+	uint8_t answer[SIM_RW_STATUS_LEN];
+	uint32_t prescaler, nbTq, nbMsg, i, j;
+	int dev;
+
+	CSLocker locker(m_csCanBus);
+
+	switch( pCdb[1] ) {
+		case STLINK_BRIDGE_INIT_CAN:
+			prescaler = SIM_GET_U16(&pCdb[6]);
+			if( (pCdb[2] > SIM_CAN_MODE_SILENT_LOOPBACK) || (prescaler == 0) || (prescaler > 1024) ) {
+				*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_BAD_PARAM);
+				return 0;
+			}
+			// SYNC + PropSeg + PhaseSeg1 + PhaseSeg2
+			nbTq = 1 + (((pCdb[3]>>3)&0x07)+1) + ((pCdb[3]&0x07)+1) + ((pCdb[4]&0x07)+1);
+			pDev->CanBitTimeNs = (uint32_t)((uint64_t)prescaler*nbTq*1000000/m_conf.CanInputClkKHz);
+			pDev->CanMode = pCdb[2];
+			if( (pCdb[8] == 0) || (pDev->bCanInit == false) ) { // BRG_INIT_FULL: filters reset
+				for( i=0; i<BRG_SIM_CAN_FILTER_NB; i++ ) {
+					pDev->CanFilters[i].Conf = 0;
+				}
+				pDev->bCanRxStarted = false;
+				pDev->bCanRxOverrun = false;
+				pDev->CanRxFirst = 0;
+				pDev->CanRxNb = 0;
+			}
+			pDev->bCanInit = true;
+			*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_OK);
+			return 0;
+
+		case STLINK_BRIDGE_INIT_FILTER_CAN:
+			if( pDev->bCanInit == false ) {
+				*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_INIT_NOT_DONE);
+				return 0;
+			}
+			if( pCdb[11] >= BRG_SIM_CAN_FILTER_NB ) {
+				*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_BAD_PARAM);
+				return 0;
+			}
+			pDev->CanFilters[pCdb[11]].Conf = pCdb[2];
+			pDev->CanFilters[pCdb[11]].Id = SIM_GET_U32(&pCdb[3]);
+			pDev->CanFilters[pCdb[11]].Mask = SIM_GET_U32(&pCdb[7]);
+			*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_OK);
+			return 0;
+
+		case STLINK_BRIDGE_START_MSG_RECEPTION_CAN:
+			memset(answer, 0, sizeof(answer));
+			if( pDev->bCanInit == false ) {
+				PutU16(&answer[0], STLINK_BRIDGE_INIT_NOT_DONE);
+			} else if( pCdb[2] != CAN_MSG_FORMAT_V1 ) {
+				PutU16(&answer[0], STLINK_BRIDGE_BAD_PARAM);
+			} else {
+				pDev->bCanRxStarted = true;
+				PutU16(&answer[0], STLINK_BRIDGE_OK);
+			}
+			answer[2] = CAN_MSG_FORMAT_V1;
+			*pAnswerSize = PutAnswer(pData, DataSize, answer, 4);
+			return 0;
+
+		case STLINK_BRIDGE_STOP_MSG_RECEPTION_CAN:
+			if( pDev->bCanInit == false ) {
+				*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_INIT_NOT_DONE);
+				return 0;
+			}
+			pDev->bCanRxStarted = false;
+			*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_OK);
+			return 0;
+
+		case STLINK_BRIDGE_GET_NB_RXMSG_CAN:
+			memset(answer, 0, sizeof(answer));
+			nbMsg = pDev->CanRxNb;
+			PutU16(&answer[0], (pDev->bCanInit == true) ? STLINK_BRIDGE_OK : STLINK_BRIDGE_INIT_NOT_DONE);
+			PutU16(&answer[2], (uint16_t)((nbMsg > 0xFFFF) ? 0xFFFF : nbMsg));
+			answer[4] = CAN_MSG_FORMAT_V1;
+			*pAnswerSize = PutAnswer(pData, DataSize, answer, sizeof(answer));
+			return 0;
+
+		case STLINK_BRIDGE_GET_RXMSG_CAN:
+			nbMsg = SIM_GET_U16(&pCdb[2]);
+			if( (nbMsg == 0) || (nbMsg > pDev->CanRxNb) ) {
+				// Only a status is returned (see Brg::GetRxMsgCAN())
+				*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_BAD_PARAM);
+				return 0;
+			}
+			*pAnswerSize = nbMsg*CAN_READ_MSG_SIZE_V1;
+			for( i=0; i<nbMsg; i++ ) {
+				uint8_t msg[CAN_READ_MSG_SIZE_V1];
+				const CanRxMsgT *pRxMsg = &pDev->CanRxMsgs[pDev->CanRxFirst];
+				memset(msg, 0, sizeof(msg));
+				PutU32(&msg[0], pRxMsg->Frame.ID);
+				msg[4] = pRxMsg->Flags;
+				msg[5] = pRxMsg->Frame.DLC;
+				// msg[6-7] timestamp unused
+				if( pRxMsg->Frame.bRtr == false ) {
+					memcpy(&msg[CAN_READ_MSG_HEADER_SIZE_V1], pRxMsg->Frame.Data, pRxMsg->Frame.DLC);
+				}
+				for( j=0; j<CAN_READ_MSG_SIZE_V1; j++ ) {
+					if( i*CAN_READ_MSG_SIZE_V1+j < DataSize ) {
+						pData[i*CAN_READ_MSG_SIZE_V1+j] = msg[j];
+					}
+				}
+				pDev->CanRxFirst = (uint16_t)((pDev->CanRxFirst+1) % BRG_SIM_CAN_RX_BUFF_NB);
+				pDev->CanRxNb--;
+			}
+			return 0;
+
+		case STLINK_BRIDGE_WRITE_MSG_CAN:
+			// No answer, status through GET_RWCMD_STATUS
+			*pAnswerSize = 0;
+			pDev->RwBytesOk = 0;
+			pDev->RwErrorInfo = 0;
+			if( pDev->bCanInit == false ) {
+				pDev->RwStatus = STLINK_BRIDGE_INIT_NOT_DONE;
+				return 0;
+			}
+			memset(&frame, 0, sizeof(frame));
+			frame.ID = SIM_GET_U32(&pCdb[2]);
+			frame.bIde = ((pCdb[6]&0x01) != 0);
+			frame.bRtr = ((pCdb[6]&0x02) != 0);
+			frame.DLC = pCdb[7];
+			if( (frame.DLC > 8) || (frame.ID > ((frame.bIde == true) ? 0x1FFFFFFFu : 0x7FFu))
+			    || ((frame.bRtr == false) && (frame.DLC > 4) && (DataSize < (uint32_t)frame.DLC-4)) ) {
+				pDev->RwStatus = STLINK_BRIDGE_BAD_PARAM;
+				return 0;
+			}
+			if( frame.bRtr == false ) {
+				// 4 first bytes in the CDB, the others in the data stage
+				for( i=0; i<frame.DLC; i++ ) {
+					frame.Data[i] = (i<4) ? pCdb[8+i] : pData[i-4];
+				}
+			}
+			if( pDev->CanMode == SIM_CAN_MODE_SILENT ) {
+				// Cannot transmit in silent mode
+				pDev->RwStatus = STLINK_BRIDGE_CAN_ERROR;
+				return 0;
+			}
+			if( (pDev->CanMode == SIM_CAN_MODE_LOOPBACK) || (pDev->CanMode == SIM_CAN_MODE_SILENT_LOOPBACK) ) {
+				// Internal feedback: own frame received, acknowledge errors ignored
+				CanDeliver(pDev, &frame);
+				pDev->RwStatus = STLINK_BRIDGE_OK;
+			} else {
+				// Normal mode: requires another node in normal mode to acknowledge the frame
+				pDev->RwStatus = STLINK_BRIDGE_CAN_ERROR;
+				for( dev=0; dev<m_conf.NbDevices; dev++ ) {
+					if( (&m_devices[dev] != pDev) && (m_devices[dev].bCanInit == true) ) {
+						if( m_devices[dev].CanMode == SIM_CAN_MODE_NORMAL ) {
+							pDev->RwStatus = STLINK_BRIDGE_OK;
+						}
+					}
+				}
+			}
+			if( (pDev->CanMode == SIM_CAN_MODE_LOOPBACK) || (pDev->RwStatus == STLINK_BRIDGE_OK) ) {
+				// Frame on the bus (also monitored on CANTX in loopback mode)
+				for( dev=0; dev<m_conf.NbDevices; dev++ ) {
+					if( (&m_devices[dev] != pDev) && ((m_devices[dev].CanMode == SIM_CAN_MODE_NORMAL)
+					    || (m_devices[dev].CanMode == SIM_CAN_MODE_SILENT)) ) {
+						CanDeliver(&m_devices[dev], &frame);
+					}
+				}
+			}
+			if( pDev->RwStatus == STLINK_BRIDGE_OK ) {
+				pDev->RwBytesOk = (frame.bRtr == false) ? frame.DLC : 0;
+				pDev->Stats.BusBytes += pDev->RwBytesOk;
+			}
+			return CanTimeNs(pDev, &frame);
+
+		default:
+			break;
+	}
+	*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_UNKNOWN_CMD);
+	return 0;
+}
+/*
+ * @brief Reception of a frame by a device (m_csCanBus locked): acceptance filtering then storage
+ * in the firmware buffer.
+ */
+void BrgSimTransport::CanDeliver(SimDeviceT *pDev, const BrgSimCanFrameT *pFrame)
+{
+	CanRxMsgT rxMsg;
+	int i;
+
+	if( (pDev->bCanInit == false) || (pDev->bCanRxStarted == false) ) {
+		return;
+	}
+	for( i=0; i<BRG_SIM_CAN_FILTER_NB; i++ ) {
+		if( CanFilterMatch(&pDev->CanFilters[i], pFrame) == true ) {
+			break;
+		}
+	}
+	if( i == BRG_SIM_CAN_FILTER_NB ) {
+		// No enabled filter accepts the frame
+		return;
+	}
+	if( pDev->CanRxNb >= BRG_SIM_CAN_RX_BUFF_NB ) {
+		pDev->bCanRxOverrun = true;
+		return;
+	}
+	rxMsg.Frame = *pFrame;
+	rxMsg.Flags = (uint8_t)(((pFrame->bIde == true) ? 0x01 : 0) | ((pFrame->bRtr == true) ? 0x02 : 0));
+	if( (pDev->CanFilters[i].Conf & 0x08) != 0 ) {
+		rxMsg.Flags |= 1<<2; // FIFO1
+	}
+	if( pDev->bCanRxOverrun == true ) {
+		rxMsg.Flags |= 2<<3; // CAN_RX_BUFF_OVERRUN
+		pDev->bCanRxOverrun = false;
+	}
+	pDev->CanRxMsgs[(pDev->CanRxFirst+pDev->CanRxNb) % BRG_SIM_CAN_RX_BUFF_NB] = rxMsg;
+	pDev->CanRxNb++;
+}
+/*
+ * @brief Acceptance filtering with the register format of Brg::InitFilterCAN():
+ * 32bit: [31:21] = Id[10:0], [20:3]= Id[28:11], [2]=IDE, [1]=RTR
+ * 16bit: [15:5] = Id[10:0], [4]=RTR, [3]=IDE, [2:0]= Id[28:26]
+ */
+bool BrgSimTransport::CanFilterMatch(const CanFilterT *pFilter, const BrgSimCanFrameT *pFrame)
+{
+	uint32_t ide = (pFrame->bIde == true) ? 1 : 0;
+	uint32_t rtr = (pFrame->bRtr == true) ? 1 : 0;
+	uint32_t code;
+	uint16_t id[4];
+	int i;
+
+	if( (pFilter->Conf & 0x04) == 0 ) { // disabled
+		return false;
+	}
+	if( (pFilter->Conf & 0x02) != 0 ) { // 32bit
+		code = ((pFrame->ID&0x7FF)<<21) | (((pFrame->ID>>11)&0x3FFFF)<<3) | (ide<<2) | (rtr<<1);
+		if( (pFilter->Conf & 0x01) != 0 ) { // list
+			return (code == pFilter->Id) || (code == pFilter->Mask);
+		}
+		return ((code ^ pFilter->Id) & pFilter->Mask) == 0;
+	}
+	// 16bit
+	code = ((pFrame->ID&0x7FF)<<5) | (rtr<<4) | (ide<<3) | ((pFrame->ID>>26)&0x07);
+	id[0] = (uint16_t)pFilter->Id;
+	id[1] = (uint16_t)(pFilter->Id>>16);
+	id[2] = (uint16_t)pFilter->Mask;
+	id[3] = (uint16_t)(pFilter->Mask>>16);
+	if( (pFilter->Conf & 0x01) != 0 ) { // list: 4 identifiers
+		for( i=0; i<4; i++ ) {
+			if( code == id[i] ) {
+				return true;
+			}
+		}
+		return false;
+	}
+	// mask: (IdLow, MaskLow) and (IdHigh, MaskHigh)
+	return (((code ^ id[0]) & id[2]) == 0) || (((code ^ id[1]) & id[3]) == 0);
+}
+
+// -------------------------------- GPIO ------------------------------------ //
+void BrgSimTransport::ExecGpioCmd(SimDeviceT *pDev, const uint8_t *pCdb, uint8_t *pData,
+                                  uint32_t DataSize, uint32_t *pAnswerSize)
+{
+	uint8_t answer[8];
+	uint8_t mask = pCdb[2] & 0x0F;
+	uint8_t errMask = 0, levels = 0;
+	int i;
+
+	memset(answer, 0, sizeof(answer));
+	PutU16(&answer[0], STLINK_BRIDGE_OK);
+
+	switch( pCdb[1] ) {
+		case STLINK_BRIDGE_INIT_GPIO:
+			for( i=0; i<4; i++ ) {
+				if( (mask & (1<<i)) != 0 ) {
+					pDev->GpioConf[i] = pCdb[3+i];
+					pDev->GpioOutput &= (uint8_t)~(1<<i);
+				}
+			}
+			pDev->GpioInitMask |= mask;
+			*pAnswerSize = PutAnswer(pData, DataSize, answer, 2);
+			return;
+
+		case STLINK_BRIDGE_SET_RESET_GPIO:
+			for( i=0; i<4; i++ ) {
+				if( (mask & (1<<i)) != 0 ) {
+					if( ((pDev->GpioInitMask & (1<<i)) == 0)
+					    || (SIM_GPIO_MODE(pDev->GpioConf[i]) != SIM_GPIO_MODE_OUTPUT) ) {
+						errMask |= (uint8_t)(1<<i);
+					} else if( (pCdb[3] & (1<<i)) != 0 ) {
+						pDev->GpioOutput |= (uint8_t)(1<<i);
+					} else {
+						pDev->GpioOutput &= (uint8_t)~(1<<i);
+					}
+				}
+			}
+			answer[2] = errMask;
+			*pAnswerSize = PutAnswer(pData, DataSize, answer, sizeof(answer));
+			return;
+
+		case STLINK_BRIDGE_READ_GPIO:
+			for( i=0; i<4; i++ ) {
+				if( (mask & (1<<i)) == 0 ) {
+					continue;
+				}
+				if( (pDev->GpioInitMask & (1<<i)) == 0 ) {
+					errMask |= (uint8_t)(1<<i);
+				} else if( SIM_GPIO_MODE(pDev->GpioConf[i]) == SIM_GPIO_MODE_OUTPUT ) {
+					levels |= pDev->GpioOutput & (1<<i);
+				} else if( SIM_GPIO_MODE(pDev->GpioConf[i]) != SIM_GPIO_MODE_ANALOG ) {
+					if( (pDev->GpioInputDriven & (1<<i)) != 0 ) {
+						levels |= pDev->GpioInput & (1<<i);
+					} else if( SIM_GPIO_PULL(pDev->GpioConf[i]) == SIM_GPIO_PULL_UP ) {
+						levels |= (uint8_t)(1<<i);
+					}
+				}
+			}
+			answer[2] = errMask;
+			answer[3] = levels;
+			*pAnswerSize = PutAnswer(pData, DataSize, answer, sizeof(answer));
+			return;
+
+		default:
+			break;
+	}
+	*pAnswerSize = PutStatus(pData, DataSize, STLINK_BRIDGE_UNKNOWN_CMD);
+}
+// end group SIMULATOR
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
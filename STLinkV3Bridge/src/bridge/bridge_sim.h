@@ -0,0 +1,377 @@
+/**
+  ******************************************************************************
+  * @file    bridge_sim.h
+  * @author  MCD Application Team
+  * @brief   Header for bridge_sim.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup SIMULATOR
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BRIDGE_SIM_H
+#define _BRIDGE_SIM_H
+/* Includes ------------------------------------------------------------------*/
+#include "stlink_transport.h"
+#include "stlink_fw_const_bridge.h"
+#include "criticalsectionlock.h"
+
+#include <map>
+#include <vector>
+
+/* Exported types and constants ----------------------------------------------*/
+/// Max number of simulated STLink devices
+#define BRG_SIM_MAX_DEVICES        8
+/// Number of CAN messages the simulated firmware can buffer before reporting a buffer overrun
+#define BRG_SIM_CAN_RX_BUFF_NB     256
+/// Number of CAN filter banks
+#define BRG_SIM_CAN_FILTER_NB      14
+/// Max data size of STLINK_BRIDGE_READ_NO_WAIT_I2C
+#define BRG_SIM_I2C_NO_WAIT_MAX    512
+
+/// Simulator configuration, see BrgSimTransport::SetConf().\n
+/// Default values model an STLINK-V3 on a USB High Speed port.
+typedef struct {
+	uint8_t  NbDevices;        ///< Number of simulated STLink devices (1 to #BRG_SIM_MAX_DEVICES)
+	uint8_t  BridgeFwVersion;  ///< Bridge firmware version returned by GETVERSION_EXT
+	uint32_t UsbLatencyUs;     ///< Fixed cost of one USB command (CDB, optional data stage, answer)
+	uint32_t UsbBandwidthKBps; ///< USB payload throughput in KBytes/s (0: unlimited)
+	bool bBusTiming;           ///< Account for the SPI/I2C/CAN bus duration of the commands
+	bool bRealTime;            ///< true: SendCommand() waits for the simulated duration (benchmarks)\n
+	                           ///< false: only the simulated clock is advanced (fast regression tests)
+	uint32_t SpiInputClkKHz;   ///< SPI IP input clock returned by GET_CLOCK
+	uint32_t I2cInputClkKHz;   ///< I2C IP input clock returned by GET_CLOCK
+	uint32_t CanInputClkKHz;   ///< CAN IP input clock returned by GET_CLOCK
+	uint32_t HClkKHz;          ///< STLink HCLK returned by GET_CLOCK
+} BrgSimConfT;
+
+/// Per device counters, see BrgSimTransport::GetStats()
+typedef struct {
+	uint32_t NbCommands;       ///< Number of USB commands received
+	uint32_t NbStatusCommands; ///< Number of STLINK_BRIDGE_GET_RWCMD_STATUS among NbCommands
+	uint32_t NbBusyErrors;     ///< Commands other than GET_RWCMD_STATUS received in BUSY state
+	uint64_t UsbBytesOut;      ///< Bytes sent by the host (CDB and data stage)
+	uint64_t UsbBytesIn;       ///< Bytes returned to the host
+	uint64_t BusBytes;         ///< Bytes transferred on SPI/I2C bus and CAN data bytes
+	uint64_t SimTimeNs;        ///< Simulated time of the device
+} BrgSimStatsT;
+
+/// CAN frame on the simulated bus, see BrgSimTransport::InjectCanFrame()
+typedef struct {
+	uint32_t ID;    ///< 11bit or 29bit identifier
+	bool bIde;      ///< Extended identifier
+	bool bRtr;      ///< Remote frame
+	uint8_t DLC;    ///< Data length (max 8)
+	uint8_t Data[8];///< Data (DLC first bytes significant for data frame)
+} BrgSimCanFrameT;
+
+/* Class -------------------------------------------------------------------- */
+/// Simulated I2C slave, see BrgSimTransport::AttachI2cSlave().
+/// Called from BrgSimTransport::SendCommand() context.
+class BrgSimI2cSlave
+{
+public:
+	virtual ~BrgSimI2cSlave(void) {}
+
+	/// START or repeated START addressing this slave: return false to NACK the address.
+	virtual bool Start(bool bRead) { (void)bRead; return true; }
+
+	/// Byte written by the master: return false to NACK it.
+	virtual bool WriteByte(uint8_t Data) = 0;
+
+	/// Byte read by the master.
+	virtual uint8_t ReadByte(void) = 0;
+
+	/// STOP condition (or transaction aborted).
+	virtual void Stop(void) {}
+
+	/// Simulated times of the START and STOP conditions of the transfer about to be done
+	/// (called before Start(), WriteByte() and ReadByte() of each command).
+	virtual void SetTime(uint64_t StartNs, uint64_t StopNs) { (void)StartNs; (void)StopNs; }
+};
+
+/// Simulated I2C memory slave: 1 or 2 bytes register address (auto incremented) followed by data,
+/// like most I2C sensors and small EEPROMs.
+class BrgSimI2cMemSlave : public BrgSimI2cSlave
+{
+public:
+	BrgSimI2cMemSlave(uint32_t SizeInBytes, uint8_t AddrSizeInBytes=1);
+
+	virtual ~BrgSimI2cMemSlave(void);
+
+	virtual bool Start(bool bRead);
+	virtual bool WriteByte(uint8_t Data);
+	virtual uint8_t ReadByte(void);
+
+	/// Direct access to the memory content (no bus transaction)
+	uint8_t *GetMem(void) { return m_pMem; }
+	uint32_t GetSize(void) const { return m_size; }
+
+protected:
+	uint8_t *m_pMem;
+	uint32_t m_size;
+	uint8_t m_addrSize;
+	// Register address bytes received since last START
+	uint8_t m_nbAddrBytes;
+	uint32_t m_addr;
+};
+
+/// Simulated I2C EEPROM (24Cxx): BrgSimI2cMemSlave with page write roll-over and a write cycle
+/// started by the STOP of a write transaction, during which the EEPROM NACKs its address.
+class BrgSimI2cEeprom : public BrgSimI2cMemSlave
+{
+public:
+	BrgSimI2cEeprom(uint32_t SizeInBytes, uint16_t PageSize, uint8_t AddrSizeInBytes, uint32_t WriteCycleUs);
+
+	virtual void SetTime(uint64_t StartNs, uint64_t StopNs);
+	virtual bool Start(bool bRead);
+	virtual bool WriteByte(uint8_t Data);
+	virtual void Stop(void);
+
+	/// Number of write cycles (page writes) since construction
+	uint32_t GetWriteCycleNb(void) const { return m_writeCycleNb; }
+	/// Number of addressing NACKed during a write cycle since construction
+	uint32_t GetBusyNackNb(void) const { return m_busyNackNb; }
+
+private:
+	uint16_t m_pageSize;
+	uint64_t m_writeCycleNs;
+	uint64_t m_startNs;
+	uint64_t m_stopNs;
+	uint64_t m_busyUntilNs;  // End of the write cycle in progress
+	uint32_t m_nbDataBytes;  // Data bytes written since START
+	uint32_t m_writeCycleNb;
+	uint32_t m_busyNackNb;
+};
+
+/// Simulated SPI slave, see BrgSimTransport::AttachSpiSlave().
+/// Called from BrgSimTransport::SendCommand() context.
+class BrgSimSpiSlave
+{
+public:
+	virtual ~BrgSimSpiSlave(void) {}
+
+	/// NSS (slave select) level change: bSelected true when NSS is low.
+	virtual void Select(bool bSelected) { (void)bSelected; }
+
+	/// Full duplex exchange of one byte: Mosi received, returned value sent on MISO.
+	virtual uint8_t Transfer(uint8_t Mosi) = 0;
+
+	/// Simulated time of the command (ns): bus start of its first byte and duration of one byte
+	/// (0 if bus timing not modeled), called before Select() and Transfer() of each command.
+	virtual void SetTime(uint64_t StartNs, uint64_t ByteNs) { (void)StartNs; (void)ByteNs; }
+};
+
+/// Simulated SPI NOR flash: JEDEC ID (9Fh), SFDP (5Ah) with a JEDEC Basic Flash Parameter table,
+/// read (03h/0Bh), page program (02h), 4KB/32KB/64KB and chip erase (20h/52h/D8h/C7h),
+/// write enable latch (06h/04h), 4-byte address mode (B7h/E9h) and status register (05h) read
+/// continuously while selected. Programming and erasing start when the slave is deselected and
+/// keep the flash busy (WIP) for the configured time, during which other commands are ignored.
+class BrgSimSpiFlash : public BrgSimSpiSlave
+{
+public:
+	BrgSimSpiFlash(uint32_t SizeInBytes, uint32_t PageProgramUs, uint32_t SectorEraseUs, uint32_t BlockEraseUs);
+
+	virtual ~BrgSimSpiFlash(void);
+
+	virtual void Select(bool bSelected);
+	virtual uint8_t Transfer(uint8_t Mosi);
+	virtual void SetTime(uint64_t StartNs, uint64_t ByteNs);
+
+	/// Direct access to the memory content (no bus transaction)
+	uint8_t *GetMem(void) { return m_pMem; }
+	uint32_t GetSize(void) const { return m_size; }
+	/// Page programs and erases since construction
+	uint32_t GetProgramNb(void) const { return m_programNb; }
+	uint32_t GetEraseNb(void) const { return m_eraseNb; }
+	/// Status bytes read while busy since construction
+	uint32_t GetBusyStatusNb(void) const { return m_busyStatusNb; }
+
+private:
+	uint64_t GetByteTimeNs(void) const { return m_startNs + m_byteIdx*m_byteNs; }
+	void EndCommand(void);
+
+	uint8_t *m_pMem;
+	uint32_t m_size;
+	uint8_t m_sfdp[0x70];
+	uint64_t m_programNs;
+	uint64_t m_sectorEraseNs;
+	uint64_t m_blockEraseNs;
+	// Time of the current command bytes
+	uint64_t m_startNs;
+	uint64_t m_byteNs;
+	uint32_t m_byteIdx;
+	uint64_t m_busyUntilNs;
+	// Command decoding since selection
+	bool m_bSelected;
+	uint8_t m_cmd;
+	uint32_t m_cmdByteNb;    // Bytes received since selection
+	uint32_t m_addr;
+	bool m_bWel;             // Write enable latch
+	bool m_b4ByteAddr;
+	uint32_t m_pageDataNb;   // Page program data bytes received
+	uint32_t m_programNb;
+	uint32_t m_eraseNb;
+	uint32_t m_busyStatusNb;
+};
+
+/// BrgSimTransport Class: in-process model of the STLINK-V3 bridge firmware.\n
+/// Decodes the STLINK_BRIDGE_COMMAND CDBs (see stlink_fw_api_bridge.h) of SPI, I2C, CAN and GPIO
+/// and answers as the firmware does, with a configurable USB latency/bandwidth and bus timing.
+/// To be given to STLinkInterface::SetTransport() before STLinkInterface::LoadStlinkLibrary().\n
+/// All simulated devices share the same CAN bus: a frame sent by a device in #CAN_MODE_NORMAL is
+/// received by the other devices of the bus (according to their filters).
+class BrgSimTransport : public STLinkTransport
+{
+public:
+
+	BrgSimTransport(void);
+
+	virtual ~BrgSimTransport(void);
+
+	static void GetDefaultConf(BrgSimConfT *pConf);
+
+	uint32_t SetConf(const BrgSimConfT *pConf);
+	void GetConf(BrgSimConfT *pConf) const { *pConf = m_conf; }
+
+	uint32_t AttachI2cSlave(uint8_t DevIdx, uint16_t Addr, BrgSimI2cSlave *pSlave);
+	uint32_t AttachSpiSlave(uint8_t DevIdx, BrgSimSpiSlave *pSlave);
+	uint32_t SetGpioInput(uint8_t DevIdx, uint8_t GpioMask, uint8_t GpioLevels);
+	uint32_t InjectCanFrame(const BrgSimCanFrameT *pFrame);
+	uint32_t GetStats(uint8_t DevIdx, BrgSimStatsT *pStats);
+	uint32_t ResetStats(uint8_t DevIdx);
+
+	virtual uint32_t Reenumerate(STLink_EnumStlinkInterfaceT IfId, uint8_t bClearList);
+
+	virtual uint32_t GetNbDevices(STLink_EnumStlinkInterfaceT IfId);
+
+	virtual uint32_t GetDeviceInfo2(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+	                                STLink_DeviceInfo2T *pInfo, uint32_t InfoSize);
+
+	virtual uint32_t OpenDevice(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+	                            uint8_t bExclusiveAccess, void **pHandle);
+
+	virtual uint32_t CloseDevice(void *pHandle);
+
+	virtual uint32_t SendCommand(void *pHandle, STLink_DeviceRequestT *pRequest, uint32_t TimeoutMs);
+
+private:
+
+	/// CAN filter bank as received in STLINK_BRIDGE_INIT_FILTER_CAN
+	typedef struct {
+		uint8_t Conf;   ///< bit0 list, bit1 32bit, bit2 enabled, bit3 FIFO1
+		uint32_t Id;    ///< FilterIdHigh<<16 | FilterIdLow
+		uint32_t Mask;  ///< FilterMaskHigh<<16 | FilterMaskLow
+	} CanFilterT;
+
+	/// CAN message buffered by the firmware
+	typedef struct {
+		BrgSimCanFrameT Frame;
+		uint8_t Flags;  ///< Byte 4 of the message header: bit2 FIFO1, bit3-4 overrun
+	} CanRxMsgT;
+
+	/// Simulated device (firmware state)
+	typedef struct {
+		uint8_t Idx;
+		uint32_t OpenCount;
+		bool bOpenExclusive;
+		CriticalSection_ObjectT Cs;   // Serialize the commands of the device
+		BrgSimStatsT Stats;
+		uint64_t ClockNs;             // Simulated clock (bRealTime false)
+		uint64_t BusyUntilNs;         // Firmware busy (bus transfer in progress) until this time
+		// Last read/write command status (STLINK_BRIDGE_GET_RWCMD_STATUS)
+		uint16_t RwStatus;
+		uint16_t RwBytesOk;
+		uint32_t RwErrorInfo;
+		// SPI
+		bool bSpiInit;
+		uint8_t SpiBaudrate;
+		bool bSpiDelay;
+		bool bSpiNssHard;
+		BrgSimSpiSlave *pSpiSlave;
+		// I2C
+		bool bI2cInit;
+		uint32_t I2cTimingReg;
+		uint8_t I2cTransState;        // 0 idle, 1 read ongoing, 2 write ongoing
+		BrgSimI2cSlave *pI2cTransSlave; // Slave of the ongoing partial transaction
+		std::map<uint16_t, BrgSimI2cSlave*> I2cSlaves;
+		bool bI2cNoWaitBusy;          // READ_NO_WAIT transaction in progress (firmware BUSY)
+		uint64_t I2cNoWaitDoneNs;
+		uint16_t I2cNoWaitStatus;
+		uint16_t I2cNoWaitSize;
+		uint8_t I2cNoWaitData[BRG_SIM_I2C_NO_WAIT_MAX];
+		// CAN (fields accessed by other devices protected by m_csCanBus)
+		bool bCanInit;
+		uint8_t CanMode;
+		uint32_t CanBitTimeNs;
+		bool bCanRxStarted;
+		bool bCanRxOverrun;
+		CanFilterT CanFilters[BRG_SIM_CAN_FILTER_NB];
+		CanRxMsgT CanRxMsgs[BRG_SIM_CAN_RX_BUFF_NB]; // Firmware RX buffer (circular)
+		uint16_t CanRxFirst;          // Index of the oldest message in CanRxMsgs
+		uint16_t CanRxNb;             // Number of messages in CanRxMsgs
+		// GPIO
+		uint8_t GpioConf[4];
+		uint8_t GpioInitMask;
+		uint8_t GpioOutput;
+		uint8_t GpioInput;
+		uint8_t GpioInputDriven;      // Inputs forced by SetGpioInput(), others follow their pull
+		// Command data assembled from CDB and data stage
+		std::vector<uint8_t> Scratch;
+	} SimDeviceT;
+
+	SimDeviceT *GetDevice(uint8_t DevIdx);
+	void ResetDevice(SimDeviceT *pDev);
+
+	uint64_t GetTimeNs(const SimDeviceT *pDev) const;
+	void WaitUntilNs(SimDeviceT *pDev, uint64_t TimeNs);
+	uint64_t UsbTimeNs(uint32_t NbBytes) const;
+	uint64_t SpiTimeNs(const SimDeviceT *pDev, uint32_t NbBytes) const;
+	uint64_t I2cTimeNs(const SimDeviceT *pDev, uint32_t NbBytes) const;
+	uint64_t CanTimeNs(const SimDeviceT *pDev, const BrgSimCanFrameT *pFrame) const;
+
+	uint64_t ExecBridgeCmd(SimDeviceT *pDev, const uint8_t *pCdb, uint8_t *pData, uint32_t DataSize,
+	                       uint64_t NowNs, uint32_t *pAnswerSize);
+	uint64_t ExecSpiCmd(SimDeviceT *pDev, const uint8_t *pCdb, uint8_t *pData, uint32_t DataSize,
+	                    uint64_t NowNs, uint32_t *pAnswerSize);
+	uint64_t ExecI2cCmd(SimDeviceT *pDev, const uint8_t *pCdb, uint8_t *pData, uint32_t DataSize,
+	                    uint64_t NowNs, uint32_t *pAnswerSize);
+	uint64_t ExecCanCmd(SimDeviceT *pDev, const uint8_t *pCdb, uint8_t *pData, uint32_t DataSize,
+	                    uint32_t *pAnswerSize);
+	void ExecGpioCmd(SimDeviceT *pDev, const uint8_t *pCdb, uint8_t *pData, uint32_t DataSize,
+	                 uint32_t *pAnswerSize);
+	uint16_t CloseCom(SimDeviceT *pDev, uint8_t Com);
+
+	uint16_t I2cTransfer(SimDeviceT *pDev, uint16_t Addr, uint8_t TransType, bool bRead,
+	                     uint8_t *pData, uint16_t Size, uint64_t NowNs, uint16_t *pBytesOk);
+	void I2cAbort(SimDeviceT *pDev);
+
+	void CanDeliver(SimDeviceT *pDev, const BrgSimCanFrameT *pFrame);
+	static bool CanFilterMatch(const CanFilterT *pFilter, const BrgSimCanFrameT *pFrame);
+
+	BrgSimConfT m_conf;
+	SimDeviceT m_devices[BRG_SIM_MAX_DEVICES];
+	uint8_t m_nbEnumDevices;
+	uint64_t m_startTimeNs;
+
+	// Protect the device list (enumeration, open, close)
+	CriticalSection_ObjectT m_csList;
+	// Protect the CAN bus: reception state and queues of all devices
+	CriticalSection_ObjectT m_csCanBus;
+};
+
+#endif //_BRIDGE_SIM_H
+// end group SIMULATOR
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
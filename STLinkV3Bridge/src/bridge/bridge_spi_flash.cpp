@@ -0,0 +1,857 @@
+/**
+  ******************************************************************************
+  * @file    bridge_spi_flash.cpp
+  * @author  MCD Application Team
+  * @brief   SPI NOR flash driver on top of the Brg SPI commands: SFDP discovery,
+  *          fast read, page program and erase with batched status polling
+  *          (see BrgSpiFlash).
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup SPI
+ * @{
+ * Usage:\n
+ *   spiParam.Nss = SPI_NSS_SOFT; ... brg.InitSPI(&spiParam);\n
+ *   BrgSpiFlash flash(brg);\n
+ *   flash.Probe(sckFreqKHz, &info);\n
+ *   brgStat = flash.Program(0, image, imageSize, &errorAddr); // imageSize multiple of info.EraseSize[0]\n
+ *   brgStat = flash.Read(0, dump, info.SizeInBytes);
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_spi_flash.h"
+
+#include <chrono>
+#include <thread>
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private defines -----------------------------------------------------------*/
+// Instructions
+#define SPI_FLASH_CMD_PP         0x02
+#define SPI_FLASH_CMD_RDSR       0x05
+#define SPI_FLASH_CMD_WREN       0x06
+#define SPI_FLASH_CMD_FAST_READ  0x0B
+#define SPI_FLASH_CMD_RDSFDP     0x5A
+#define SPI_FLASH_CMD_RDID       0x9F
+#define SPI_FLASH_CMD_EN4B       0xB7
+#define SPI_FLASH_CMD_CE         0xC7
+// Status register: write in progress
+#define SPI_FLASH_SR_WIP         0x01
+// Instruction + 4 address bytes + dummy byte
+#define SPI_FLASH_CMD_MAX_SIZE   6
+
+// Program/erase operations (m_opIdx)
+#define SPI_FLASH_OP_PROGRAM     0
+#define SPI_FLASH_OP_ERASE       1  // + erase type index
+#define SPI_FLASH_OP_CHIP_ERASE  5
+#define SPI_FLASH_OP_NB          6
+
+// Status read sizes: bus time of one read between SPI_FLASH_POLL_MIN_BYTES and SPI_FLASH_POLL_MAX_US,
+// waits longer than SPI_FLASH_SLEEP_MIN_US are slept first
+#define SPI_FLASH_POLL_MIN_BYTES 4
+#define SPI_FLASH_POLL_MAX_US    2000
+#define SPI_FLASH_SLEEP_MIN_US   5000
+// Margin added to the learned busy time of the first status read
+#define SPI_FLASH_POLL_MARGIN_NS 20000
+// Once the typical time elapsed, status reads cover 1/SPI_FLASH_POLL_STEP_DIV of it
+#define SPI_FLASH_POLL_STEP_DIV  16
+// Added to the max program/erase times
+#define SPI_FLASH_TIMEOUT_MARGIN_NS 10000000ULL
+
+// Description used without SFDP (typical values of 3V serial NOR flashes)
+#define SPI_FLASH_DEFAULT_PAGE_SIZE        256
+#define SPI_FLASH_DEFAULT_PROGRAM_US       700
+#define SPI_FLASH_DEFAULT_SECTOR_ERASE_US  45000
+#define SPI_FLASH_DEFAULT_BLOCK_ERASE_US   150000
+#define SPI_FLASH_DEFAULT_MAX_TIME_FACTOR  10
+
+/* Private macros ------------------------------------------------------------*/
+#define SPI_FLASH_SFDP_DWORD(_p) ((uint32_t)(_p)[0] | ((uint32_t)(_p)[1]<<8) | \
+                                  ((uint32_t)(_p)[2]<<16) | ((uint32_t)(_p)[3]<<24))
+
+/* Private variables ---------------------------------------------------------*/
+/* Global variables ----------------------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+/*
+ * Fill a SPI operation of Brg::ExecuteBatch()
+ */
+static void SetSpiOp(Brg_BatchOpT *pOp, Brg_BatchOpTypeT OpType, const uint8_t *pTxBuffer,
+                     uint8_t *pRxBuffer, uint16_t SizeInBytes, Brg_SpiNssLevelT NssLevel)
+{
+	memset(pOp, 0, sizeof(Brg_BatchOpT));
+	pOp->OpType = OpType;
+	pOp->pTxBuffer = pTxBuffer;
+	pOp->pRxBuffer = pRxBuffer;
+	pOp->SizeInBytes = SizeInBytes;
+	pOp->NssLevel = NssLevel;
+}
+
+/* Class Functions Definition ------------------------------------------------*/
+
+/**
+ * @ingroup SPI
+ * @brief BrgSpiFlash constructor. BrgSpiFlash::Probe() must be called before the flash accesses.
+ * @param[in]  BrgDevice  Bridge with SPI initialized (Brg::InitSPI()), must not be deleted before the BrgSpiFlash.
+ */
+BrgSpiFlash::BrgSpiFlash(Brg &BrgDevice): m_brg(BrgDevice), m_bProbed(false), m_byteNs(1),
+	m_bCsLow(false), m_opIdx(0), m_opStartNs(0), m_pWriteBuf(NULL), m_pReadBuf(NULL)
+{
+	memset(&m_info, 0, sizeof(m_info));
+	memset(m_opTypNs, 0, sizeof(m_opTypNs));
+	memset(m_opMaxNs, 0, sizeof(m_opMaxNs));
+	memset(m_opEstNs, 0, sizeof(m_opEstNs));
+	ResetStats();
+}
+/**
+ * @ingroup SPI
+ * @brief BrgSpiFlash destructor
+ */
+BrgSpiFlash::~BrgSpiFlash(void)
+{
+	delete [] m_pWriteBuf;
+	delete [] m_pReadBuf;
+}
+/**
+ * @ingroup SPI
+ * @brief This routine identifies the flash: JEDEC ID, then SFDP JEDEC Basic Flash Parameter table
+ * (defaults deduced from the JEDEC ID capacity if the flash has no SFDP). Memories above 16MB are
+ * switched to 4-byte address mode (B7h).
+ * @param[in]  SckFreqKHz  SPI clock frequency (see Brg::GetSPIbaudratePrescal()), used to size the
+ *             status reads.
+ * @param[out] pInfo  If not NULL, flash description (see also BrgSpiFlash::GetInfo()).
+ *
+ * @retval #BRG_PARAM_ERR If SckFreqKHz is 0
+ * @retval #BRG_TARGET_CMD_ERR If no flash answers (JEDEC ID all 0x00 or 0xFF)
+ * @retval #BRG_NOT_SUPPORTED If the flash size or description is not supported
+ * @retval #BRG_MEM_ALLOC_ERR If the buffers cannot be allocated
+ * @return Brg::ExecuteBatch() errors
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgSpiFlash::Probe(uint32_t SckFreqKHz, Brg_SpiFlashInfoT *pInfo)
+{
+	Brg_StatusT brgStat;
+	uint8_t cmd = SPI_FLASH_CMD_RDID;
+	uint8_t id[3];
+	uint8_t opIdx;
+
+	if( SckFreqKHz == 0 ) {
+		return BRG_PARAM_ERR;
+	}
+	m_bProbed = false;
+	m_byteNs = 8000000/SckFreqKHz;
+	if( m_byteNs == 0 ) {
+		m_byteNs = 1;
+	}
+
+	// Chip select state unknown
+	m_bCsLow = true;
+	brgStat = ReleaseCs();
+	if( brgStat == BRG_NO_ERR ) {
+		brgStat = Transfer(&cmd, 1, id, sizeof(id));
+	}
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+	if( ((id[0] == 0x00) && (id[1] == 0x00) && (id[2] == 0x00)) ||
+	    ((id[0] == 0xFF) && (id[1] == 0xFF) && (id[2] == 0xFF)) ) {
+		return BRG_TARGET_CMD_ERR;
+	}
+
+	memset(&m_info, 0, sizeof(m_info));
+	memcpy(m_info.JedecId, id, sizeof(id));
+	brgStat = ParseSfdp();
+	if( (brgStat == BRG_NO_ERR) && (m_info.bSfdp == false) ) {
+		SetDefaultInfo();
+		if( m_info.SizeInBytes == 0 ) {
+			brgStat = BRG_NOT_SUPPORTED;
+		}
+	}
+	if( (brgStat == BRG_NO_ERR) && ((m_info.PageSize == 0) || (m_info.PageSize > 0x8000)) ) {
+		brgStat = BRG_NOT_SUPPORTED;
+	}
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+	m_info.AddrSizeInBytes = 3;
+	if( m_info.SizeInBytes > 0x1000000 ) {
+		cmd = SPI_FLASH_CMD_EN4B;
+		brgStat = Transfer(&cmd, 1, NULL, 0);
+		if( brgStat != BRG_NO_ERR ) {
+			return brgStat;
+		}
+		m_info.AddrSizeInBytes = 4;
+	}
+
+	delete [] m_pWriteBuf;
+	m_pWriteBuf = new uint8_t[SPI_FLASH_CMD_MAX_SIZE + m_info.PageSize];
+	if( m_pWriteBuf == NULL ) {
+		return BRG_MEM_ALLOC_ERR;
+	}
+	if( m_pReadBuf == NULL ) {
+		m_pReadBuf = new uint8_t[BRG_SPI_STREAM_CHUNK_SIZE];
+		if( m_pReadBuf == NULL ) {
+			return BRG_MEM_ALLOC_ERR;
+		}
+	}
+
+	memset(m_opTypNs, 0, sizeof(m_opTypNs));
+	m_opTypNs[SPI_FLASH_OP_PROGRAM] = (uint64_t)m_info.PageProgramTypUs*1000;
+	for( opIdx = 0; opIdx < m_info.EraseTypeNb; opIdx++ ) {
+		m_opTypNs[SPI_FLASH_OP_ERASE + opIdx] = (uint64_t)m_info.EraseTypUs[opIdx]*1000;
+	}
+	m_opTypNs[SPI_FLASH_OP_CHIP_ERASE] = (uint64_t)m_info.ChipEraseTypMs*1000000;
+	for( opIdx = 0; opIdx < SPI_FLASH_OP_NB; opIdx++ ) {
+		m_opMaxNs[opIdx] = m_opTypNs[opIdx]*m_info.MaxTimeFactor + SPI_FLASH_TIMEOUT_MARGIN_NS;
+		m_opEstNs[opIdx] = m_opTypNs[opIdx];
+	}
+
+	ResetStats();
+	m_bProbed = true;
+	if( pInfo != NULL ) {
+		*pInfo = m_info;
+	}
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup SPI
+ * @brief This routine reads the flash with fast read (0Bh) transactions of up to
+ * #BRG_SPI_FLASH_READ_CHUNK_NB x #BRG_SPI_STREAM_CHUNK_SIZE bytes.
+ * @param[in]  MemAddr     Memory address of the first byte.
+ * @param[out] pBuffer     Data read.
+ * @param[in]  SizeInBytes Number of bytes to read.
+ *
+ * @retval #BRG_COM_INIT_NOT_DONE If BrgSpiFlash::Probe() not called before
+ * @retval #BRG_PARAM_ERR If pBuffer is NULL or the range is outside the flash
+ * @return Brg::ExecuteBatch() errors
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgSpiFlash::Read(uint32_t MemAddr, uint8_t *pBuffer, uint32_t SizeInBytes)
+{
+	Brg_StatusT brgStat;
+	uint8_t cmd[SPI_FLASH_CMD_MAX_SIZE];
+	uint32_t chunk;
+	uint16_t cmdSize;
+	bool bRestore;
+
+	brgStat = CheckRange(MemAddr, SizeInBytes);
+	if( pBuffer == NULL ) {
+		brgStat = BRG_PARAM_ERR;
+	}
+	bRestore = (brgStat == BRG_NO_ERR) ? SetDeferredMode() : false;
+
+	while( (brgStat == BRG_NO_ERR) && (SizeInBytes != 0) ) {
+		chunk = (uint32_t)BRG_SPI_FLASH_READ_CHUNK_NB*BRG_SPI_STREAM_CHUNK_SIZE;
+		if( chunk > SizeInBytes ) {
+			chunk = SizeInBytes;
+		}
+		cmdSize = SetCmdAddr(cmd, SPI_FLASH_CMD_FAST_READ, MemAddr);
+		cmd[cmdSize++] = 0x00; // Dummy byte
+		m_stats.ReadNb++;
+		brgStat = Transfer(cmd, cmdSize, pBuffer, chunk);
+		MemAddr += chunk;
+		pBuffer += chunk;
+		SizeInBytes -= chunk;
+	}
+	return RestoreRwStatusMode(bRestore, brgStat);
+}
+/**
+ * @ingroup SPI
+ * @brief This routine programs erased flash areas: the data are split on the page boundaries,
+ * one page program per page, pages of 0xFF only are skipped. The end of each program is waited
+ * for before the next one; the routine returns once the last one is done.
+ * @param[in]  MemAddr     Memory address of the first byte.
+ * @param[in]  pBuffer     Data to write.
+ * @param[in]  SizeInBytes Number of bytes to write.
+ *
+ * @retval #BRG_COM_INIT_NOT_DONE If BrgSpiFlash::Probe() not called before
+ * @retval #BRG_PARAM_ERR If pBuffer is NULL or the range is outside the flash
+ * @retval #BRG_TARGET_CMD_TIMEOUT If the flash is still busy after the max program time
+ * @return Brg::ExecuteBatch() errors
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgSpiFlash::Write(uint32_t MemAddr, const uint8_t *pBuffer, uint32_t SizeInBytes)
+{
+	Brg_StatusT brgStat;
+	uint32_t chunk, i;
+	uint16_t cmdSize;
+	bool bRestore;
+
+	brgStat = CheckRange(MemAddr, SizeInBytes);
+	if( pBuffer == NULL ) {
+		brgStat = BRG_PARAM_ERR;
+	}
+	bRestore = (brgStat == BRG_NO_ERR) ? SetDeferredMode() : false;
+
+	while( (brgStat == BRG_NO_ERR) && (SizeInBytes != 0) ) {
+		chunk = m_info.PageSize - (MemAddr % m_info.PageSize);
+		if( chunk > SizeInBytes ) {
+			chunk = SizeInBytes;
+		}
+		for( i = 0; (i < chunk) && (pBuffer[i] == 0xFF); i++ ) {
+		}
+		if( i < chunk ) {
+			cmdSize = SetCmdAddr(m_pWriteBuf, SPI_FLASH_CMD_PP, MemAddr);
+			memcpy(&m_pWriteBuf[cmdSize], pBuffer, chunk);
+			m_stats.PageProgramNb++;
+			brgStat = StartOp(m_pWriteBuf, (uint16_t)(cmdSize + chunk), SPI_FLASH_OP_PROGRAM);
+		}
+		MemAddr += chunk;
+		pBuffer += chunk;
+		SizeInBytes -= chunk;
+	}
+
+	if( brgStat == BRG_NO_ERR ) {
+		brgStat = ReleaseCs();
+	}
+	return RestoreRwStatusMode(bRestore, brgStat);
+}
+/**
+ * @ingroup SPI
+ * @brief This routine erases a flash area with the biggest erase types fitting the area alignment
+ * and size (chip erase if the area is the whole flash). The routine returns once the last erase is done.
+ * @param[in]  MemAddr     Memory address of the first byte, multiple of the smallest erase size.
+ * @param[in]  SizeInBytes Number of bytes to erase, multiple of the smallest erase size.
+ *
+ * @retval #BRG_COM_INIT_NOT_DONE If BrgSpiFlash::Probe() not called before
+ * @retval #BRG_PARAM_ERR If the range is outside the flash or not aligned
+ * @retval #BRG_NOT_SUPPORTED If the flash has no erase type
+ * @retval #BRG_TARGET_CMD_TIMEOUT If the flash is still busy after the max erase time
+ * @return Brg::ExecuteBatch() errors
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgSpiFlash::Erase(uint32_t MemAddr, uint32_t SizeInBytes)
+{
+	Brg_StatusT brgStat;
+	uint8_t cmd[SPI_FLASH_CMD_MAX_SIZE];
+	uint16_t cmdSize;
+	int typeIdx;
+	bool bRestore;
+
+	brgStat = CheckRange(MemAddr, SizeInBytes);
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+	if( m_info.EraseTypeNb == 0 ) {
+		return BRG_NOT_SUPPORTED;
+	}
+	if( ((MemAddr % m_info.EraseSize[0]) != 0) || ((SizeInBytes % m_info.EraseSize[0]) != 0) ) {
+		return BRG_PARAM_ERR;
+	}
+	if( (MemAddr == 0) && (SizeInBytes == m_info.SizeInBytes) ) {
+		return EraseChip();
+	}
+
+	bRestore = SetDeferredMode();
+	while( (brgStat == BRG_NO_ERR) && (SizeInBytes != 0) ) {
+		// Biggest erase aligned on MemAddr inside the area (the smallest one always fits)
+		for( typeIdx = m_info.EraseTypeNb - 1; typeIdx > 0; typeIdx-- ) {
+			if( ((MemAddr % m_info.EraseSize[typeIdx]) == 0) && (SizeInBytes >= m_info.EraseSize[typeIdx]) ) {
+				break;
+			}
+		}
+		cmdSize = SetCmdAddr(cmd, m_info.EraseOpcode[typeIdx], MemAddr);
+		m_stats.EraseNb++;
+		brgStat = StartOp(cmd, cmdSize, (uint8_t)(SPI_FLASH_OP_ERASE + typeIdx));
+		MemAddr += m_info.EraseSize[typeIdx];
+		SizeInBytes -= m_info.EraseSize[typeIdx];
+	}
+
+	if( brgStat == BRG_NO_ERR ) {
+		brgStat = ReleaseCs();
+	}
+	return RestoreRwStatusMode(bRestore, brgStat);
+}
+/**
+ * @ingroup SPI
+ * @brief This routine erases the whole flash (C7h) and returns once the erase is done.
+ *
+ * @retval #BRG_COM_INIT_NOT_DONE If BrgSpiFlash::Probe() not called before
+ * @retval #BRG_TARGET_CMD_TIMEOUT If the flash is still busy after the max chip erase time
+ * @return Brg::ExecuteBatch() errors
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgSpiFlash::EraseChip(void)
+{
+	Brg_StatusT brgStat;
+	uint8_t cmd = SPI_FLASH_CMD_CE;
+	bool bRestore;
+
+	if( m_bProbed == false ) {
+		return BRG_COM_INIT_NOT_DONE;
+	}
+	bRestore = SetDeferredMode();
+	m_stats.EraseNb++;
+	brgStat = StartOp(&cmd, 1, SPI_FLASH_OP_CHIP_ERASE);
+	if( brgStat == BRG_NO_ERR ) {
+		brgStat = ReleaseCs();
+	}
+	return RestoreRwStatusMode(bRestore, brgStat);
+}
+/**
+ * @ingroup SPI
+ * @brief This routine reads back the flash and compares it with the expected data.
+ * @param[in]  MemAddr     Memory address of the first byte.
+ * @param[in]  pBuffer     Expected data.
+ * @param[in]  SizeInBytes Number of bytes to check.
+ * @param[out] pErrorAddr  If not NULL and in case of #BRG_VERIF_ERR, memory address of the first
+ *             byte different from the expected data.
+ *
+ * @retval #BRG_VERIF_ERR If the flash content is not the expected one
+ * @return BrgSpiFlash::Read() errors
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgSpiFlash::Verify(uint32_t MemAddr, const uint8_t *pBuffer, uint32_t SizeInBytes,
+                                uint32_t *pErrorAddr)
+{
+	Brg_StatusT brgStat;
+	uint32_t chunk, i;
+	bool bRestore;
+
+	brgStat = CheckRange(MemAddr, SizeInBytes);
+	if( pBuffer == NULL ) {
+		brgStat = BRG_PARAM_ERR;
+	}
+	bRestore = (brgStat == BRG_NO_ERR) ? SetDeferredMode() : false;
+
+	while( (brgStat == BRG_NO_ERR) && (SizeInBytes != 0) ) {
+		chunk = BRG_SPI_STREAM_CHUNK_SIZE;
+		if( chunk > SizeInBytes ) {
+			chunk = SizeInBytes;
+		}
+		brgStat = Read(MemAddr, m_pReadBuf, chunk);
+		if( (brgStat == BRG_NO_ERR) && (memcmp(m_pReadBuf, pBuffer, chunk) != 0) ) {
+			for( i = 0; m_pReadBuf[i] == pBuffer[i]; i++ ) {
+			}
+			if( pErrorAddr != NULL ) {
+				*pErrorAddr = MemAddr + i;
+			}
+			brgStat = BRG_VERIF_ERR;
+		}
+		MemAddr += chunk;
+		pBuffer += chunk;
+		SizeInBytes -= chunk;
+	}
+	return RestoreRwStatusMode(bRestore, brgStat);
+}
+/**
+ * @ingroup SPI
+ * @brief This routine erases, writes then verifies a flash area, see BrgSpiFlash::Erase(),
+ * BrgSpiFlash::Write() and BrgSpiFlash::Verify(): MemAddr and SizeInBytes must be multiples
+ * of the smallest erase size.
+ */
+Brg_StatusT BrgSpiFlash::Program(uint32_t MemAddr, const uint8_t *pBuffer, uint32_t SizeInBytes,
+                                 uint32_t *pErrorAddr)
+{
+	Brg_StatusT brgStat;
+	bool bRestore;
+
+	if( pBuffer == NULL ) {
+		return BRG_PARAM_ERR;
+	}
+	brgStat = CheckRange(MemAddr, SizeInBytes);
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+	bRestore = SetDeferredMode();
+	brgStat = Erase(MemAddr, SizeInBytes);
+	if( brgStat == BRG_NO_ERR ) {
+		brgStat = Write(MemAddr, pBuffer, SizeInBytes);
+	}
+	if( brgStat == BRG_NO_ERR ) {
+		brgStat = Verify(MemAddr, pBuffer, SizeInBytes, pErrorAddr);
+	}
+	return RestoreRwStatusMode(bRestore, brgStat);
+}
+
+/*
+ * private: switch the Brg to RW_STATUS_DEFERRED mode (status read once per batch) for an access,
+ * returns true if RestoreRwStatusMode() must switch it back
+ */
+bool BrgSpiFlash::SetDeferredMode(void)
+{
+	if( m_brg.GetRwStatusMode() != RW_STATUS_IMMEDIATE ) {
+		return false;
+	}
+	return (m_brg.SetRwStatusMode(RW_STATUS_DEFERRED, 0) == BRG_NO_ERR);
+}
+/*
+ * private: back to RW_STATUS_IMMEDIATE mode after an access (status errors not yet reported returned
+ * if BrgStat is BRG_NO_ERR)
+ */
+Brg_StatusT BrgSpiFlash::RestoreRwStatusMode(bool bRestore, Brg_StatusT BrgStat)
+{
+	Brg_StatusT brgStat;
+
+	if( bRestore == false ) {
+		return BrgStat;
+	}
+	brgStat = m_brg.SetRwStatusMode(RW_STATUS_IMMEDIATE);
+	return (BrgStat != BRG_NO_ERR) ? BrgStat : brgStat;
+}
+/*
+ * private: check the parameters of an access
+ */
+Brg_StatusT BrgSpiFlash::CheckRange(uint32_t MemAddr, uint32_t SizeInBytes) const
+{
+	if( m_bProbed == false ) {
+		return BRG_COM_INIT_NOT_DONE;
+	}
+	if( (SizeInBytes == 0) || (MemAddr >= m_info.SizeInBytes) ||
+	    (SizeInBytes > (m_info.SizeInBytes - MemAddr)) ) {
+		return BRG_PARAM_ERR;
+	}
+	return BRG_NO_ERR;
+}
+/*
+ * private: instruction followed by the memory address (MSB first), returns the size
+ */
+uint16_t BrgSpiFlash::SetCmdAddr(uint8_t *pCmd, uint8_t Opcode, uint32_t MemAddr) const
+{
+	uint8_t i;
+
+	pCmd[0] = Opcode;
+	for( i = 0; i < m_info.AddrSizeInBytes; i++ ) {
+		pCmd[1+i] = (uint8_t)(MemAddr >> (8*(m_info.AddrSizeInBytes - 1 - i)));
+	}
+	return (uint16_t)(1 + m_info.AddrSizeInBytes);
+}
+/*
+ * private: one transaction in one batch: chip select low, instruction write, read of RxSize bytes
+ * (up to BRG_SPI_FLASH_READ_CHUNK_NB ReadSPI commands), chip select high
+ */
+Brg_StatusT BrgSpiFlash::Transfer(const uint8_t *pTxBuffer, uint16_t TxSize, uint8_t *pRxBuffer, uint32_t RxSize)
+{
+	Brg_BatchOpT ops[4 + BRG_SPI_FLASH_READ_CHUNK_NB];
+	Brg_StatusT brgStat;
+	uint32_t opNb = 0;
+	uint16_t chunk;
+
+	if( m_bCsLow == true ) {
+		// End of the status read of the last program/erase
+		SetSpiOp(&ops[opNb++], BATCH_SPI_CS, NULL, NULL, 0, SPI_NSS_HIGH);
+	}
+	SetSpiOp(&ops[opNb++], BATCH_SPI_CS, NULL, NULL, 0, SPI_NSS_LOW);
+	SetSpiOp(&ops[opNb++], BATCH_SPI_WRITE, pTxBuffer, NULL, TxSize, SPI_NSS_LOW);
+	while( (RxSize != 0) && (opNb < (3 + BRG_SPI_FLASH_READ_CHUNK_NB)) ) {
+		chunk = (RxSize > BRG_SPI_STREAM_CHUNK_SIZE) ? BRG_SPI_STREAM_CHUNK_SIZE : (uint16_t)RxSize;
+		SetSpiOp(&ops[opNb++], BATCH_SPI_READ, NULL, pRxBuffer, chunk, SPI_NSS_LOW);
+		pRxBuffer += chunk;
+		RxSize -= chunk;
+	}
+	SetSpiOp(&ops[opNb++], BATCH_SPI_CS, NULL, NULL, 0, SPI_NSS_HIGH);
+
+	brgStat = m_brg.ExecuteBatch(ops, opNb);
+	if( brgStat == BRG_NO_ERR ) {
+		m_bCsLow = false;
+	}
+	return brgStat;
+}
+/*
+ * private: SFDP read (5Ah: 3 address bytes and 8 dummy clocks)
+ */
+Brg_StatusT BrgSpiFlash::ReadSfdp(uint32_t SfdpAddr, uint8_t *pBuffer, uint16_t SizeInBytes)
+{
+	uint8_t cmd[5];
+
+	cmd[0] = SPI_FLASH_CMD_RDSFDP;
+	cmd[1] = (uint8_t)(SfdpAddr>>16);
+	cmd[2] = (uint8_t)(SfdpAddr>>8);
+	cmd[3] = (uint8_t)SfdpAddr;
+	cmd[4] = 0x00;
+	return Transfer(cmd, sizeof(cmd), pBuffer, SizeInBytes);
+}
+/*
+ * private: fill m_info from the SFDP JEDEC Basic Flash Parameter table (JESD216), if any
+ * (m_info.bSfdp false if the flash has no SFDP).
+ */
+Brg_StatusT BrgSpiFlash::ParseSfdp(void)
+{
+	Brg_StatusT brgStat;
+	uint8_t header[16];
+	uint8_t table[16*4];
+	uint32_t dword[16];
+	uint32_t tableAddr, field, exp, i, j;
+	uint32_t eraseUnitMs[4] = {1, 16, 128, 1000};
+	uint32_t chipEraseUnitMs[4] = {16, 256, 4000, 64000};
+	uint8_t dwordNb, maxFactor;
+
+	brgStat = ReadSfdp(0, header, sizeof(header));
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+	// Signature, then first parameter header: always the Basic Flash Parameter table (ID FF00h)
+	if( (memcmp(header, "SFDP", 4) != 0) || (header[8] != 0x00) || (header[15] != 0xFF) || (header[11] < 9) ) {
+		return BRG_NO_ERR;
+	}
+	dwordNb = (header[11] > 16) ? 16 : header[11];
+	tableAddr = (uint32_t)header[12] | ((uint32_t)header[13]<<8) | ((uint32_t)header[14]<<16);
+	brgStat = ReadSfdp(tableAddr, table, (uint16_t)(dwordNb*4));
+	if( brgStat != BRG_NO_ERR ) {
+		return brgStat;
+	}
+	memset(dword, 0, sizeof(dword));
+	for( i = 0; i < dwordNb; i++ ) {
+		dword[i] = SPI_FLASH_SFDP_DWORD(&table[4*i]);
+	}
+
+	// DWORD2: density in bits
+	if( (dword[1] & 0x80000000) != 0 ) {
+		exp = dword[1] & 0x7FFFFFFF;
+		if( (exp < 3) || (exp > 34) ) {
+			return BRG_NOT_SUPPORTED;
+		}
+		m_info.SizeInBytes = (uint32_t)((uint64_t)1 << (exp - 3));
+	} else {
+		m_info.SizeInBytes = (uint32_t)(((uint64_t)dword[1] + 1)/8);
+	}
+
+	// DWORD8-9: erase types (size 2^N, instruction), DWORD10: typical erase times
+	for( i = 0; i < BRG_SPI_FLASH_ERASE_TYPE_MAX; i++ ) {
+		field = dword[7 + i/2] >> (16*(i%2));
+		if( (field & 0xFF) == 0 ) {
+			continue;
+		}
+		m_info.EraseSize[m_info.EraseTypeNb] = (uint32_t)1 << (field & 0x1F);
+		m_info.EraseOpcode[m_info.EraseTypeNb] = (uint8_t)(field >> 8);
+		if( dwordNb >= 10 ) {
+			field = (dword[9] >> (4 + 7*i)) & 0x7F;
+			m_info.EraseTypUs[m_info.EraseTypeNb] = ((field & 0x1F) + 1)*eraseUnitMs[field >> 5]*1000;
+		}
+		m_info.EraseTypeNb++;
+	}
+	if( (m_info.EraseTypeNb == 0) && ((dword[0] & 0x3) == 0x1) ) {
+		// DWORD1: 4KB erase only
+		m_info.EraseSize[0] = 0x1000;
+		m_info.EraseOpcode[0] = (uint8_t)(dword[0] >> 8);
+		m_info.EraseTypeNb = 1;
+	}
+	// By increasing size
+	for( i = 1; i < m_info.EraseTypeNb; i++ ) {
+		for( j = i; (j > 0) && (m_info.EraseSize[j-1] > m_info.EraseSize[j]); j-- ) {
+			uint32_t size = m_info.EraseSize[j];
+			uint32_t timeUs = m_info.EraseTypUs[j];
+			uint8_t opcode = m_info.EraseOpcode[j];
+			m_info.EraseSize[j] = m_info.EraseSize[j-1];
+			m_info.EraseTypUs[j] = m_info.EraseTypUs[j-1];
+			m_info.EraseOpcode[j] = m_info.EraseOpcode[j-1];
+			m_info.EraseSize[j-1] = size;
+			m_info.EraseTypUs[j-1] = timeUs;
+			m_info.EraseOpcode[j-1] = opcode;
+		}
+	}
+
+	// DWORD11: page size, typical page program and chip erase times; DWORD10-11: max time factors
+	m_info.PageSize = SPI_FLASH_DEFAULT_PAGE_SIZE;
+	m_info.MaxTimeFactor = SPI_FLASH_DEFAULT_MAX_TIME_FACTOR;
+	if( dwordNb >= 11 ) {
+		m_info.PageSize = (uint32_t)1 << ((dword[10] >> 4) & 0xF);
+		m_info.PageProgramTypUs = (((dword[10] >> 8) & 0x1F) + 1)*(((dword[10] & 0x2000) != 0) ? 64 : 8);
+		m_info.ChipEraseTypMs = (((dword[10] >> 24) & 0x1F) + 1)*chipEraseUnitMs[(dword[10] >> 29) & 0x3];
+		maxFactor = (uint8_t)(2*((dword[9] & 0xF) + 1));
+		m_info.MaxTimeFactor = (uint8_t)(2*((dword[10] & 0xF) + 1));
+		if( maxFactor > m_info.MaxTimeFactor ) {
+			m_info.MaxTimeFactor = maxFactor;
+		}
+	}
+	// Times not given by the table
+	if( m_info.PageProgramTypUs == 0 ) {
+		m_info.PageProgramTypUs = SPI_FLASH_DEFAULT_PROGRAM_US;
+	}
+	for( i = 0; i < m_info.EraseTypeNb; i++ ) {
+		if( m_info.EraseTypUs[i] == 0 ) {
+			m_info.EraseTypUs[i] = (m_info.EraseSize[i] <= 0x1000) ? SPI_FLASH_DEFAULT_SECTOR_ERASE_US
+			                                                       : SPI_FLASH_DEFAULT_BLOCK_ERASE_US;
+		}
+	}
+	if( m_info.ChipEraseTypMs == 0 ) {
+		m_info.ChipEraseTypMs = (m_info.SizeInBytes/0x10000 + 1)*(SPI_FLASH_DEFAULT_BLOCK_ERASE_US/1000);
+	}
+	m_info.bSfdp = true;
+	return BRG_NO_ERR;
+}
+/*
+ * private: description of a flash without SFDP: size from the JEDEC ID capacity byte (2^N bytes),
+ * 256 bytes pages, 4KB/32KB/64KB erases (20h/52h/D8h), typical times of 3V serial NOR flashes
+ */
+void BrgSpiFlash::SetDefaultInfo(void)
+{
+	if( (m_info.JedecId[2] >= 16) && (m_info.JedecId[2] <= 31) ) {
+		m_info.SizeInBytes = (uint32_t)1 << m_info.JedecId[2];
+	}
+	m_info.PageSize = SPI_FLASH_DEFAULT_PAGE_SIZE;
+	m_info.EraseTypeNb = 3;
+	m_info.EraseSize[0] = 0x1000;
+	m_info.EraseOpcode[0] = 0x20;
+	m_info.EraseTypUs[0] = SPI_FLASH_DEFAULT_SECTOR_ERASE_US;
+	m_info.EraseSize[1] = 0x8000;
+	m_info.EraseOpcode[1] = 0x52;
+	m_info.EraseTypUs[1] = SPI_FLASH_DEFAULT_BLOCK_ERASE_US;
+	m_info.EraseSize[2] = 0x10000;
+	m_info.EraseOpcode[2] = 0xD8;
+	m_info.EraseTypUs[2] = SPI_FLASH_DEFAULT_BLOCK_ERASE_US;
+	m_info.PageProgramTypUs = SPI_FLASH_DEFAULT_PROGRAM_US;
+	m_info.ChipEraseTypMs = (m_info.SizeInBytes/0x10000 + 1)*(SPI_FLASH_DEFAULT_BLOCK_ERASE_US/1000);
+	m_info.MaxTimeFactor = SPI_FLASH_DEFAULT_MAX_TIME_FACTOR;
+}
+/*
+ * private: program/erase in one batch: write enable, instruction, then status register read kept
+ * running (chip select left low) and waited for the end of the operation
+ */
+Brg_StatusT BrgSpiFlash::StartOp(const uint8_t *pCmd, uint16_t CmdSize, uint8_t OpIdx)
+{
+	Brg_BatchOpT ops[10];
+	Brg_StatusT brgStat;
+	uint8_t wren = SPI_FLASH_CMD_WREN;
+	uint8_t rdsr = SPI_FLASH_CMD_RDSR;
+	uint32_t opNb = 0;
+	uint16_t statusSize;
+
+	m_opIdx = OpIdx;
+	// First status read: busy time learned from the previous operations of the same type
+	statusSize = GetStatusSize(m_opEstNs[OpIdx] + m_opEstNs[OpIdx]/8 + SPI_FLASH_POLL_MARGIN_NS);
+
+	if( m_bCsLow == true ) {
+		SetSpiOp(&ops[opNb++], BATCH_SPI_CS, NULL, NULL, 0, SPI_NSS_HIGH);
+	}
+	SetSpiOp(&ops[opNb++], BATCH_SPI_CS, NULL, NULL, 0, SPI_NSS_LOW);
+	SetSpiOp(&ops[opNb++], BATCH_SPI_WRITE, &wren, NULL, 1, SPI_NSS_LOW);
+	SetSpiOp(&ops[opNb++], BATCH_SPI_CS, NULL, NULL, 0, SPI_NSS_HIGH);
+	SetSpiOp(&ops[opNb++], BATCH_SPI_CS, NULL, NULL, 0, SPI_NSS_LOW);
+	SetSpiOp(&ops[opNb++], BATCH_SPI_WRITE, pCmd, NULL, CmdSize, SPI_NSS_LOW);
+	SetSpiOp(&ops[opNb++], BATCH_SPI_CS, NULL, NULL, 0, SPI_NSS_HIGH);
+	SetSpiOp(&ops[opNb++], BATCH_SPI_CS, NULL, NULL, 0, SPI_NSS_LOW);
+	SetSpiOp(&ops[opNb++], BATCH_SPI_WRITE, &rdsr, NULL, 1, SPI_NSS_LOW);
+	SetSpiOp(&ops[opNb++], BATCH_SPI_READ, NULL, m_pReadBuf, statusSize, SPI_NSS_LOW);
+
+	m_opStartNs = StlinkCmdStats::GetTimeNs();
+	m_bCsLow = true;
+	brgStat = m_brg.ExecuteBatch(ops, opNb);
+	if( brgStat == BRG_NO_ERR ) {
+		brgStat = WaitOpEnd(statusSize);
+	}
+	return brgStat;
+}
+/*
+ * private: status bytes of the last read (StatusSize) checked, then new status reads (chip select
+ * still low) until the write in progress bit is cleared. The busy time seen by the first read updates
+ * the estimate of the operation; longer waits sleep on the typical time, then poll every 1/16 of it,
+ * and the end seen by these polls updates the typical time.
+ */
+Brg_StatusT BrgSpiFlash::WaitOpEnd(uint16_t StatusSize)
+{
+	Brg_BatchOpT op;
+	Brg_StatusT brgStat;
+	uint64_t elapsedNs, waitNs;
+	bool bFirst = true, bPolled = false;
+	uint16_t i;
+
+	for( ;; ) {
+		for( i = 0; (i < StatusSize) && ((m_pReadBuf[i] & SPI_FLASH_SR_WIP) != 0); i++ ) {
+		}
+		m_stats.PollNb++;
+		m_stats.BusyStatusNb += i;
+		if( bFirst == true ) {
+			if( i == 0 ) {
+				// Ready before the first read: shorter next time
+				m_opEstNs[m_opIdx] -= m_opEstNs[m_opIdx]/8;
+			} else if( i < StatusSize ) {
+				m_opEstNs[m_opIdx] = (m_opEstNs[m_opIdx] + i*m_byteNs)/2;
+			} else if( m_opEstNs[m_opIdx] < m_opMaxNs[m_opIdx] ) {
+				m_opEstNs[m_opIdx] = 2*m_opEstNs[m_opIdx] + m_byteNs;
+			}
+			bFirst = false;
+		}
+		if( i < StatusSize ) {
+			break;
+		}
+		bPolled = true;
+
+		elapsedNs = StlinkCmdStats::GetTimeNs() - m_opStartNs;
+		if( elapsedNs > m_opMaxNs[m_opIdx] ) {
+			ReleaseCs();
+			return BRG_TARGET_CMD_TIMEOUT;
+		}
+		if( elapsedNs < m_opTypNs[m_opIdx] ) {
+			waitNs = m_opTypNs[m_opIdx] - elapsedNs;
+		} else {
+			waitNs = m_opTypNs[m_opIdx]/SPI_FLASH_POLL_STEP_DIV;
+		}
+		if( waitNs > (uint64_t)SPI_FLASH_SLEEP_MIN_US*1000 ) {
+			// Long wait: sleep, then status read over the end of it
+			std::this_thread::sleep_for(std::chrono::nanoseconds(waitNs - (uint64_t)SPI_FLASH_POLL_MAX_US*1000/2));
+			waitNs = (uint64_t)SPI_FLASH_POLL_MAX_US*1000/2;
+		}
+		StatusSize = GetStatusSize(waitNs);
+		SetSpiOp(&op, BATCH_SPI_READ, NULL, m_pReadBuf, StatusSize, SPI_NSS_LOW);
+		brgStat = m_brg.ExecuteBatch(&op, 1);
+		if( brgStat != BRG_NO_ERR ) {
+			return brgStat;
+		}
+	}
+
+	elapsedNs = StlinkCmdStats::GetTimeNs() - m_opStartNs;
+	if( bPolled == true ) {
+		// Typical time learned from the end seen by the polls (the SFDP times are rounded up)
+		if( i == 0 ) {
+			m_opTypNs[m_opIdx] -= m_opTypNs[m_opIdx]/8;
+		} else if( elapsedNs > (StatusSize - i)*m_byteNs ) {
+			m_opTypNs[m_opIdx] = (m_opTypNs[m_opIdx] + elapsedNs - (StatusSize - i)*m_byteNs)/2;
+		}
+	}
+	m_stats.WaitUs += elapsedNs/1000;
+	return BRG_NO_ERR;
+}
+/*
+ * private: end of the status read of the last program/erase, if any
+ */
+Brg_StatusT BrgSpiFlash::ReleaseCs(void)
+{
+	Brg_StatusT brgStat;
+
+	if( m_bCsLow == false ) {
+		return BRG_NO_ERR;
+	}
+	brgStat = m_brg.SetSPIpinCS(SPI_NSS_HIGH);
+	if( brgStat == BRG_NO_ERR ) {
+		m_bCsLow = false;
+	}
+	return brgStat;
+}
+/*
+ * private: number of status bytes read in WaitNs, between SPI_FLASH_POLL_MIN_BYTES and
+ * SPI_FLASH_POLL_MAX_US of bus time
+ */
+uint16_t BrgSpiFlash::GetStatusSize(uint64_t WaitNs) const
+{
+	uint64_t size = WaitNs/m_byteNs;
+	uint64_t maxSize = (uint64_t)SPI_FLASH_POLL_MAX_US*1000/m_byteNs;
+
+	if( maxSize > BRG_SPI_STREAM_CHUNK_SIZE ) {
+		maxSize = BRG_SPI_STREAM_CHUNK_SIZE;
+	}
+	if( size > maxSize ) {
+		size = maxSize;
+	}
+	if( size < SPI_FLASH_POLL_MIN_BYTES ) {
+		size = SPI_FLASH_POLL_MIN_BYTES;
+	}
+	return (uint16_t)size;
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,158 @@
+/**
+  ******************************************************************************
+  * @file    bridge_spi_flash.h
+  * @author  MCD Application Team
+  * @brief   Header for bridge_spi_flash.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup SPI
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BRIDGE_SPI_FLASH_H
+#define _BRIDGE_SPI_FLASH_H
+/* Includes ------------------------------------------------------------------*/
+#include "bridge.h"
+
+/* Exported types and constants ----------------------------------------------*/
+/// Max number of erase types of a SPI NOR flash (SFDP)
+#define BRG_SPI_FLASH_ERASE_TYPE_MAX 4
+/// Max number of ReadSPI commands of BRG_SPI_STREAM_CHUNK_SIZE bytes in one BrgSpiFlash::Read() transaction
+#define BRG_SPI_FLASH_READ_CHUNK_NB 16
+
+/// SPI NOR flash description found by BrgSpiFlash::Probe()
+typedef struct {
+	uint8_t JedecId[3];          ///< Manufacturer id, memory type, capacity (9Fh command)
+	bool bSfdp;                  ///< Description read from the SFDP JEDEC Basic Flash Parameter table,
+	                             ///< else defaults deduced from JedecId
+	uint32_t SizeInBytes;        ///< Memory size
+	uint32_t PageSize;           ///< Page program buffer size
+	uint8_t AddrSizeInBytes;     ///< 3, or 4 for memories above 16MB (4-byte address mode entered by Probe())
+	uint8_t EraseTypeNb;         ///< Number of erase types, sorted by increasing size
+	uint32_t EraseSize[BRG_SPI_FLASH_ERASE_TYPE_MAX];   ///< Erase type size in bytes
+	uint8_t EraseOpcode[BRG_SPI_FLASH_ERASE_TYPE_MAX];  ///< Erase type instruction
+	uint32_t EraseTypUs[BRG_SPI_FLASH_ERASE_TYPE_MAX];  ///< Erase type typical time
+	uint32_t PageProgramTypUs;   ///< Page program typical time
+	uint32_t ChipEraseTypMs;     ///< Chip erase typical time
+	uint8_t MaxTimeFactor;       ///< Max time = MaxTimeFactor * typical time (program/erase timeouts)
+} Brg_SpiFlashInfoT;
+
+/// Counters of a BrgSpiFlash, see BrgSpiFlash::GetStats()
+typedef struct {
+	uint32_t ReadNb;         ///< Read transactions (Read() and Verify())
+	uint32_t PageProgramNb;  ///< Pages programmed (pages of 0xFF skipped)
+	uint32_t EraseNb;        ///< Erase operations (chip erase included)
+	uint32_t PollNb;         ///< Status register reads sent while waiting for a program/erase end
+	uint32_t BusyStatusNb;   ///< Status bytes read with the flash busy
+	uint64_t WaitUs;         ///< Time from the program/erase batches to the detection of their end
+} Brg_SpiFlashStatsT;
+
+/* Class -------------------------------------------------------------------- */
+/// BrgSpiFlash Class: read, erase and programming of SPI NOR flash memories through Brg SPI commands.\n
+/// Probe() reads the JEDEC ID and the SFDP JEDEC Basic Flash Parameter table (size, page size, erase
+/// types and typical times). Each flash transaction (chip select, instruction, data) is sent in one
+/// Brg::ExecuteBatch(); a Brg in #RW_STATUS_IMMEDIATE mode is switched to #RW_STATUS_DEFERRED mode during
+/// the accesses, so that each batch costs a single status round trip.\n
+/// The status register read (05h) that follows a program or erase is appended to the same batch and
+/// kept running while the chip select stays low: the flash outputs its status continuously, so a
+/// single ReadSPI command of n bytes samples the busy bit n times. The size of this first read is
+/// learned from the previous operations, so that it usually ends just after the flash is ready; longer
+/// waits sleep on the typical time before polling.\n
+/// The SPI must be initialized in master mode with #SPI_NSS_SOFT, 8 bit, MSB first, mode 0 or 3.
+/// Not thread safe: the Brg should not be used by other threads while a flash access is in progress.
+class BrgSpiFlash
+{
+public:
+
+	BrgSpiFlash(Brg &BrgDevice);
+
+	virtual ~BrgSpiFlash(void);
+
+	Brg_StatusT Probe(uint32_t SckFreqKHz, Brg_SpiFlashInfoT *pInfo=NULL);
+
+	Brg_StatusT Read(uint32_t MemAddr, uint8_t *pBuffer, uint32_t SizeInBytes);
+	Brg_StatusT Write(uint32_t MemAddr, const uint8_t *pBuffer, uint32_t SizeInBytes);
+	Brg_StatusT Erase(uint32_t MemAddr, uint32_t SizeInBytes);
+	Brg_StatusT EraseChip(void);
+	Brg_StatusT Verify(uint32_t MemAddr, const uint8_t *pBuffer, uint32_t SizeInBytes,
+	                   uint32_t *pErrorAddr=NULL);
+	Brg_StatusT Program(uint32_t MemAddr, const uint8_t *pBuffer, uint32_t SizeInBytes,
+	                    uint32_t *pErrorAddr=NULL);
+
+	/**
+	 * @brief Flash description found by the last successful Probe().
+	 */
+	void GetInfo(Brg_SpiFlashInfoT *pInfo) const {
+		*pInfo = m_info;
+	}
+	/**
+	 * @brief Counters since Probe() or the last ResetStats().
+	 */
+	void GetStats(Brg_SpiFlashStatsT *pStats) const {
+		*pStats = m_stats;
+	}
+	void ResetStats(void) {
+		m_stats.ReadNb = 0;
+		m_stats.PageProgramNb = 0;
+		m_stats.EraseNb = 0;
+		m_stats.PollNb = 0;
+		m_stats.BusyStatusNb = 0;
+		m_stats.WaitUs = 0;
+	}
+
+private:
+
+	bool SetDeferredMode(void);
+	Brg_StatusT RestoreRwStatusMode(bool bRestore, Brg_StatusT BrgStat);
+
+	Brg_StatusT CheckRange(uint32_t MemAddr, uint32_t SizeInBytes) const;
+	uint16_t SetCmdAddr(uint8_t *pCmd, uint8_t Opcode, uint32_t MemAddr) const;
+
+	Brg_StatusT Transfer(const uint8_t *pTxBuffer, uint16_t TxSize, uint8_t *pRxBuffer, uint32_t RxSize);
+	Brg_StatusT ReadSfdp(uint32_t SfdpAddr, uint8_t *pBuffer, uint16_t SizeInBytes);
+	Brg_StatusT ParseSfdp(void);
+	void SetDefaultInfo(void);
+
+	Brg_StatusT StartOp(const uint8_t *pCmd, uint16_t CmdSize, uint8_t OpIdx);
+	Brg_StatusT WaitOpEnd(uint16_t StatusSize);
+	Brg_StatusT ReleaseCs(void);
+	uint16_t GetStatusSize(uint64_t WaitNs) const;
+
+	Brg &m_brg;
+	Brg_SpiFlashInfoT m_info;
+	bool m_bProbed;
+	uint64_t m_byteNs;        // SPI byte duration
+
+	// Chip select left low by the status read of the last program/erase (released by the next transaction)
+	bool m_bCsLow;
+
+	// Program/erase in progress: operation (0: page program, 1 to 4: erase types, 5: chip erase),
+	// start time, typical and max durations, learned busy time seen by the first status read
+	uint8_t m_opIdx;
+	uint64_t m_opStartNs;
+	uint64_t m_opTypNs[6];
+	uint64_t m_opMaxNs[6];
+	uint64_t m_opEstNs[6];
+
+	// Instruction + page data of the page programs, and read buffer of Verify() and of the status reads,
+	// allocated by Probe()
+	uint8_t *m_pWriteBuf;
+	uint8_t *m_pReadBuf;
+
+	Brg_SpiFlashStatsT m_stats;
+};
+
+#endif //_BRIDGE_SPI_FLASH_H
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
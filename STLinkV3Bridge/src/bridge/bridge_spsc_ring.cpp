@@ -0,0 +1,192 @@
+/**
+  ******************************************************************************
+  * @file    bridge_spsc_ring.cpp
+  * @author  MCD Application Team
+  * @brief   Lock-free single producer / single consumer ring (see BrgSpscRing),
+  *          used to hand data from a Brg worker thread to the application.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup BRIDGE
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_spsc_ring.h"
+
+#include <new>
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private defines -----------------------------------------------------------*/
+// Max number of elements (power of 2, indexes difference must fit in uint32_t)
+#define SPSC_RING_MAX_ELEM_NB 0x40000000
+
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Global variables ----------------------------------------------------------*/
+/* Class Functions Definition ------------------------------------------------*/
+
+/**
+ * @ingroup BRIDGE
+ * @brief BrgSpscRing constructor. BrgSpscRing::Init() must be called before use.
+ */
+BrgSpscRing::BrgSpscRing(void): m_pBuf(NULL), m_elemSize(0), m_mask(0), m_head(0), m_tailCache(0),
+	m_tail(0), m_headCache(0)
+{
+}
+/**
+ * @ingroup BRIDGE
+ * @brief BrgSpscRing destructor.
+ */
+BrgSpscRing::~BrgSpscRing(void)
+{
+	delete [] m_pBuf;
+}
+/**
+ * @ingroup BRIDGE
+ * @brief This routine allocates the ring and empties it. Must not be called while the ring is used.
+ * @param[in]  ElemSize  Element size in bytes (min 1).
+ * @param[in]  ElemNb  Min number of elements: rounded up to a power of 2 (min 2).
+ *
+ * @retval #BRG_PARAM_ERR If ElemSize is 0 or ElemNb too high
+ * @retval #BRG_MEM_ALLOC_ERR If the ring cannot be allocated
+ * @retval #BRG_NO_ERR If no error
+ */
+Brg_StatusT BrgSpscRing::Init(uint32_t ElemSize, uint32_t ElemNb)
+{
+	uint32_t capacity = 2;
+
+	if( (ElemSize == 0) || (ElemNb > SPSC_RING_MAX_ELEM_NB) ) {
+		return BRG_PARAM_ERR;
+	}
+	while( capacity < ElemNb ) {
+		capacity <<= 1;
+	}
+	if( ((uint64_t)capacity*ElemSize) > 0xFFFFFFFF ) {
+		return BRG_PARAM_ERR;
+	}
+
+	if( (m_pBuf == NULL) || ((m_mask + 1)*m_elemSize != capacity*ElemSize) ) {
+		delete [] m_pBuf;
+		m_mask = 0;
+		m_pBuf = new (std::nothrow) uint8_t[capacity*ElemSize];
+		if( m_pBuf == NULL ) {
+			return BRG_MEM_ALLOC_ERR;
+		}
+	}
+	m_elemSize = ElemSize;
+	m_mask = capacity - 1;
+	m_head.store(0, std::memory_order_relaxed);
+	m_tail.store(0, std::memory_order_relaxed);
+	m_tailCache = 0;
+	m_headCache = 0;
+	return BRG_NO_ERR;
+}
+/**
+ * @ingroup BRIDGE
+ * @brief Producer: returns the next free slot (ElemSize bytes), to be filled then published by Commit().
+ * @retval NULL if the ring is full (or not initialized).
+ */
+void *BrgSpscRing::GetWriteSlot(void)
+{
+	uint32_t head = m_head.load(std::memory_order_relaxed);
+
+	if( m_pBuf == NULL ) {
+		return NULL;
+	}
+	if( (head - m_tailCache) > m_mask ) {
+		// Looks full: refresh the consumer index (only shared access on this side)
+		m_tailCache = m_tail.load(std::memory_order_acquire);
+		if( (head - m_tailCache) > m_mask ) {
+			return NULL;
+		}
+	}
+	return &m_pBuf[(head & m_mask)*m_elemSize];
+}
+/**
+ * @ingroup BRIDGE
+ * @brief Producer: publishes the slot returned by GetWriteSlot().
+ */
+void BrgSpscRing::Commit(void)
+{
+	m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+/**
+ * @ingroup BRIDGE
+ * @brief Producer: copies an element in the ring.
+ * @retval false if the ring is full (element not written).
+ */
+bool BrgSpscRing::Push(const void *pElem)
+{
+	void *pSlot = GetWriteSlot();
+
+	if( pSlot == NULL ) {
+		return false;
+	}
+	memcpy(pSlot, pElem, m_elemSize);
+	Commit();
+	return true;
+}
+/**
+ * @ingroup BRIDGE
+ * @brief Consumer: returns the oldest element, valid until Release().
+ * @retval NULL if the ring is empty (or not initialized).
+ */
+const void *BrgSpscRing::GetReadSlot(void)
+{
+	uint32_t tail = m_tail.load(std::memory_order_relaxed);
+
+	if( m_pBuf == NULL ) {
+		return NULL;
+	}
+	if( tail == m_headCache ) {
+		// Looks empty: refresh the producer index (only shared access on this side)
+		m_headCache = m_head.load(std::memory_order_acquire);
+		if( tail == m_headCache ) {
+			return NULL;
+		}
+	}
+	return &m_pBuf[(tail & m_mask)*m_elemSize];
+}
+/**
+ * @ingroup BRIDGE
+ * @brief Consumer: gives back the slot returned by GetReadSlot() to the producer.
+ */
+void BrgSpscRing::Release(void)
+{
+	m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+/**
+ * @ingroup BRIDGE
+ * @brief Consumer: copies the oldest element out of the ring.
+ * @retval false if the ring is empty (pElem not written).
+ */
+bool BrgSpscRing::Pop(void *pElem)
+{
+	const void *pSlot = GetReadSlot();
+
+	if( pSlot == NULL ) {
+		return false;
+	}
+	memcpy(pElem, pSlot, m_elemSize);
+	Release();
+	return true;
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
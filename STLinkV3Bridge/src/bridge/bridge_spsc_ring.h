@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+  * @file    bridge_spsc_ring.h
+  * @author  MCD Application Team
+  * @brief   Header for bridge_spsc_ring.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup BRIDGE
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BRIDGE_SPSC_RING_H
+#define _BRIDGE_SPSC_RING_H
+/* Includes ------------------------------------------------------------------*/
+#include "bridge.h"
+
+#include <atomic>
+
+/* Exported types and constants ----------------------------------------------*/
+/// Padding separating the producer and consumer indexes of a BrgSpscRing (cache line size)
+#define BRG_SPSC_CACHE_LINE_SIZE 64
+
+/* Class -------------------------------------------------------------------- */
+/// BrgSpscRing Class: lock-free single producer / single consumer ring of fixed size elements.\n
+/// One thread writes (GetWriteSlot()/Commit() or Push()), one thread reads (GetReadSlot()/Release()
+/// or Pop()), without lock nor allocation after Init(). Elements are written and read in place in the
+/// ring slots, the slot being published by Commit() and given back by Release().
+class BrgSpscRing
+{
+public:
+
+	BrgSpscRing(void);
+
+	virtual ~BrgSpscRing(void);
+
+	Brg_StatusT Init(uint32_t ElemSize, uint32_t ElemNb);
+
+	// Producer side
+	void *GetWriteSlot(void);
+	void Commit(void);
+	bool Push(const void *pElem);
+
+	// Consumer side
+	const void *GetReadSlot(void);
+	void Release(void);
+	bool Pop(void *pElem);
+
+	/**
+	 * @retval Number of elements in the ring (exact if called by the producer or the consumer
+	 *         while the other side is idle, else a snapshot).
+	 */
+	uint32_t GetCount(void) const {
+		// Tail first: m_head only grows after, so the count cannot underflow
+		uint32_t tail = m_tail.load(std::memory_order_acquire);
+		uint32_t head = m_head.load(std::memory_order_acquire);
+		return head - tail;
+	}
+	/**
+	 * @retval Number of elements the ring can hold (ElemNb of Init() rounded up to a power of 2).
+	 */
+	uint32_t GetCapacity(void) const {
+		return m_mask + 1;
+	}
+
+private:
+
+	uint8_t *m_pBuf;
+	uint32_t m_elemSize;
+	uint32_t m_mask;
+
+	// Free running indexes, masked to access the slots. Producer and consumer fields are kept
+	// on different cache lines.
+	uint8_t m_pad0[BRG_SPSC_CACHE_LINE_SIZE];
+	std::atomic<uint32_t> m_head;  // Next slot written (producer)
+	uint32_t m_tailCache;          // Last m_tail seen by the producer
+	uint8_t m_pad1[BRG_SPSC_CACHE_LINE_SIZE];
+	std::atomic<uint32_t> m_tail;  // Next slot read (consumer)
+	uint32_t m_headCache;          // Last m_head seen by the consumer
+	uint8_t m_pad2[BRG_SPSC_CACHE_LINE_SIZE];
+};
+
+#endif //_BRIDGE_SPSC_RING_H
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
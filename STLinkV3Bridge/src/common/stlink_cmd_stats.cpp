@@ -0,0 +1,448 @@
+/**
+  ******************************************************************************
+  * @file    stlink_cmd_stats.cpp
+  * @author  MCD Application Team
+  * @brief   Per command latency histograms and byte counters of the USB
+  *          commands sent by StlinkDevice (see StlinkCmdStats).
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "stlink_cmd_stats.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+// Command latencies measured with the time stamp counter on x86 (see StlinkCmdStats::GetTicks())
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define STATS_USE_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private defines -----------------------------------------------------------*/
+#define STATS_SUB_BUCKET_NB    (1 << STLINK_CMD_STATS_SUB_BITS)
+
+// Key of the entry counting the commands beyond STLINK_CMD_STATS_MAX_CMD
+#define STATS_OTHER_KEY        0xFFFF
+
+// Fractional bits of StlinkCmdStats::m_tickNsMult
+#define STATS_TICK_NS_SHIFT    24
+// Duration of the tick calibration against GetTimeNs()
+#define STATS_TICK_CALIB_NS    2000000
+// TicksToNs() saturation (no overflow down to a 100 MHz tick, 68s at 1 GHz)
+#define STATS_TICK_MAX         ((uint64_t)1 << 36)
+
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Global variables ----------------------------------------------------------*/
+/* Class Functions Definition ------------------------------------------------*/
+
+/*
+ * @brief StlinkCmdStats constructor: all the entries are allocated here so that
+ * Record() never allocates. The ticks are calibrated by the first object constructed.
+ */
+StlinkCmdStats::StlinkCmdStats(void): m_entryNb(0), m_bEnabled(true)
+{
+	static const uint64_t s_tickNsMult = CalibrateTicks();
+
+	m_tickNsMult = s_tickNsMult;
+	m_pEntries = new CmdEntryT[STLINK_CMD_STATS_MAX_CMD];
+	Reset();
+}
+/*
+ * @brief StlinkCmdStats destructor
+ */
+StlinkCmdStats::~StlinkCmdStats(void)
+{
+	if( m_pEntries != NULL ) {
+		delete [] m_pEntries;
+		m_pEntries = NULL;
+	}
+}
+/*
+ * @brief Monotonic time in ns.
+ */
+uint64_t StlinkCmdStats::GetTimeNs(void)
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+	                    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+/*
+ * @brief Monotonic tick counter: time stamp counter on x86 (invariant on the processors the
+ * STLink hosts run on), GetTimeNs() otherwise.
+ */
+uint64_t StlinkCmdStats::GetTicks(void)
+{
+#ifdef STATS_USE_TSC
+	return (uint64_t)__rdtsc();
+#else
+	return GetTimeNs();
+#endif
+}
+/*
+ * @brief ns per tick of GetTicks(), fixed point with STATS_TICK_NS_SHIFT fractional bits,
+ * measured against GetTimeNs() for STATS_TICK_CALIB_NS.
+ */
+uint64_t StlinkCmdStats::CalibrateTicks(void)
+{
+#ifdef STATS_USE_TSC
+	uint64_t startNs, startTicks, durationNs, durationTicks;
+
+	startNs = GetTimeNs();
+	startTicks = GetTicks();
+	do {
+		durationNs = GetTimeNs() - startNs;
+	} while( durationNs < STATS_TICK_CALIB_NS );
+	durationTicks = GetTicks() - startTicks;
+	if( durationTicks != 0 ) {
+		return (durationNs << STATS_TICK_NS_SHIFT) / durationTicks;
+	}
+#endif
+	return (uint64_t)1 << STATS_TICK_NS_SHIFT;
+}
+/*
+ * @brief Duration in ns of DeltaTicks ticks of GetTicks() (0 if negative, saturated to STATS_TICK_MAX ticks).
+ */
+uint64_t StlinkCmdStats::TicksToNs(uint64_t DeltaTicks) const
+{
+	if( (int64_t)DeltaTicks < 0 ) {
+		return 0;
+	}
+	if( DeltaTicks > STATS_TICK_MAX ) {
+		DeltaTicks = STATS_TICK_MAX;
+	}
+	return (DeltaTicks * m_tickNsMult) >> STATS_TICK_NS_SHIFT;
+}
+/*
+ * @brief Enable (default) or disable the recording: while disabled StlinkDevice::SendRequest()
+ * neither times nor records the commands, the statistics already recorded are kept.
+ */
+void StlinkCmdStats::SetEnabled(bool bEnabled)
+{
+	m_bEnabled.store(bEnabled, std::memory_order_relaxed);
+}
+/*
+ * @brief Histogram bucket of a latency: values below 2^SUB_BITS have their own bucket,
+ * above each power of 2 range is split in 2^SUB_BITS linear sub-buckets.
+ */
+uint32_t StlinkCmdStats::BucketIndex(uint64_t LatencyNs)
+{
+	uint32_t msb = 0;
+	uint64_t val;
+
+	if( LatencyNs < STATS_SUB_BUCKET_NB ) {
+		return (uint32_t)LatencyNs;
+	}
+	if( LatencyNs >= ((uint64_t)1 << STLINK_CMD_STATS_MAX_LOG2) ) {
+		return STLINK_CMD_STATS_BUCKET_NB - 1;
+	}
+	// Position of the most significant bit (binary search, no compiler intrinsic)
+	val = LatencyNs;
+	if( val >= ((uint64_t)1 << 16) ) { val >>= 16; msb += 16; }
+	if( val >= ((uint64_t)1 << 8) ) { val >>= 8; msb += 8; }
+	if( val >= ((uint64_t)1 << 4) ) { val >>= 4; msb += 4; }
+	if( val >= ((uint64_t)1 << 2) ) { val >>= 2; msb += 2; }
+	if( val >= ((uint64_t)1 << 1) ) { msb += 1; }
+
+	return ((msb - STLINK_CMD_STATS_SUB_BITS + 1) << STLINK_CMD_STATS_SUB_BITS) +
+	       (uint32_t)(LatencyNs >> (msb - STLINK_CMD_STATS_SUB_BITS)) - STATS_SUB_BUCKET_NB;
+}
+/*
+ * @brief Highest latency of a histogram bucket.
+ */
+uint64_t StlinkCmdStats::BucketUpperNs(uint32_t BucketIdx)
+{
+	uint32_t range = BucketIdx >> STLINK_CMD_STATS_SUB_BITS;
+	uint32_t sub = BucketIdx & (STATS_SUB_BUCKET_NB - 1);
+
+	if( range == 0 ) {
+		return BucketIdx;
+	}
+	// Range r covers [2^(r+SUB_BITS-1), 2^(r+SUB_BITS)) with steps of 2^(r-1)
+	return (((uint64_t)(STATS_SUB_BUCKET_NB + sub + 1)) << (range - 1)) - 1;
+}
+/*
+ * @brief Record a command: called by StlinkDevice::SendRequest() after each USB command, within
+ * the device critical section. Lock free once the entry of the command exists (see FindEntry()),
+ * one Record() at a time (see AddCounter()).
+ * @param[in]  Cmd       CDBByte[0] of the command.
+ * @param[in]  SubCmd    CDBByte[1] of the command.
+ * @param[in]  LatencyNs Duration of the USB command.
+ * @param[in]  BytesOut  Bytes sent (CDB and data stage).
+ * @param[in]  BytesIn   Bytes received.
+ * @param[in]  bError    USB error.
+ */
+void StlinkCmdStats::Record(uint8_t Cmd, uint8_t SubCmd, uint64_t LatencyNs,
+                            uint32_t BytesOut, uint32_t BytesIn, bool bError)
+{
+	uint16_t key = (uint16_t)(((uint16_t)Cmd << 8) | SubCmd);
+	uint32_t idx = m_lastEntryOfSubCmd[SubCmd].load(std::memory_order_acquire);
+	CmdEntryT *pEntry;
+
+	if( (idx != 0) && (m_pEntries[idx-1].Key.load(std::memory_order_relaxed) == key) ) {
+		pEntry = &m_pEntries[idx-1];
+	} else {
+		// Same SubCmd with another Cmd, or first use of the command
+		pEntry = FindEntry(key, SubCmd);
+	}
+
+	AddCounter<uint32_t>(pEntry->Count, 1);
+	if( bError == true ) {
+		AddCounter<uint32_t>(pEntry->ErrorCount, 1);
+	}
+	AddCounter<uint64_t>(pEntry->BytesOut, BytesOut);
+	if( BytesIn != 0 ) {
+		AddCounter<uint64_t>(pEntry->BytesIn, BytesIn);
+	}
+	AddCounter<uint64_t>(pEntry->TotalNs, LatencyNs);
+	if( LatencyNs < pEntry->MinNs.load(std::memory_order_relaxed) ) {
+		pEntry->MinNs.store(LatencyNs, std::memory_order_relaxed);
+	}
+	if( LatencyNs > pEntry->MaxNs.load(std::memory_order_relaxed) ) {
+		pEntry->MaxNs.store(LatencyNs, std::memory_order_relaxed);
+	}
+	AddCounter<uint32_t>(pEntry->Buckets[BucketIndex(LatencyNs)], 1);
+}
+/*
+ * @brief Counter increment by its only writer: atomic load and store, without the locked
+ * read-modify-write of fetch_add() (about 11 ns each, 4 to 6 per command). Readers see each
+ * counter whole, concurrent Record() calls would lose increments.
+ */
+template<typename T>
+void StlinkCmdStats::AddCounter(std::atomic<T> &Counter, T Value)
+{
+	Counter.store(Counter.load(std::memory_order_relaxed) + Value, std::memory_order_relaxed);
+}
+/*
+ * @brief Entry of a command (created at its first use), locked: only called by Record() when the
+ * entry is not the last one seen for SubCmd.
+ */
+StlinkCmdStats::CmdEntryT *StlinkCmdStats::FindEntry(uint16_t Key, uint8_t SubCmd)
+{
+	CmdEntryT *pEntry = NULL;
+	uint32_t idx;
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for( idx = 0; idx < m_entryNb; idx++ ) {
+		if( m_pEntries[idx].Key.load(std::memory_order_relaxed) == Key ) {
+			pEntry = &m_pEntries[idx];
+			break;
+		}
+	}
+	if( pEntry == NULL ) {
+		if( m_entryNb < (STLINK_CMD_STATS_MAX_CMD - 1) ) {
+			idx = m_entryNb;
+			m_entryNb++;
+			m_pEntries[idx].Key.store(Key, std::memory_order_relaxed);
+		} else {
+			// Last entry shared by all the other commands
+			idx = STLINK_CMD_STATS_MAX_CMD - 1;
+			m_pEntries[idx].Key.store(STATS_OTHER_KEY, std::memory_order_relaxed);
+			if( m_entryNb < STLINK_CMD_STATS_MAX_CMD ) {
+				m_entryNb = STLINK_CMD_STATS_MAX_CMD;
+			}
+		}
+		pEntry = &m_pEntries[idx];
+	}
+	if( pEntry->Key.load(std::memory_order_relaxed) == Key ) {
+		// Key stored before: seen by the Record() finding this index
+		m_lastEntryOfSubCmd[SubCmd].store((uint8_t)(idx + 1), std::memory_order_release);
+	}
+	return pEntry;
+}
+/*
+ * @brief Latency below which PerThousand/1000 of the commands are (bucket upper bound, capped to MaxNs).
+ */
+uint64_t StlinkCmdStats::Percentile(const CmdEntryT *pEntry, uint32_t PerThousand) const
+{
+	uint64_t target, cumul = 0;
+	uint64_t latency;
+
+	uint64_t count = pEntry->Count.load(std::memory_order_relaxed);
+	uint64_t maxNs = pEntry->MaxNs.load(std::memory_order_relaxed);
+
+	if( count == 0 ) {
+		return 0;
+	}
+	// Rank of the searched command (rounded up, at least 1)
+	target = (count * PerThousand + 999) / 1000;
+	if( target == 0 ) {
+		target = 1;
+	}
+	for( uint32_t i = 0; i < STLINK_CMD_STATS_BUCKET_NB; i++ ) {
+		cumul += pEntry->Buckets[i].load(std::memory_order_relaxed);
+		if( cumul >= target ) {
+			latency = BucketUpperNs(i);
+			return (latency > maxNs) ? maxNs : latency;
+		}
+	}
+	return maxNs;
+}
+/*
+ * @brief Convert an entry to the exported statistics.
+ */
+void StlinkCmdStats::FillStats(const CmdEntryT *pEntry, StlinkCmdStatsT *pStats) const
+{
+	uint16_t key = pEntry->Key.load(std::memory_order_relaxed);
+
+	pStats->Cmd = (uint8_t)(key >> 8);
+	pStats->SubCmd = (uint8_t)key;
+	pStats->Count = pEntry->Count.load(std::memory_order_relaxed);
+	pStats->ErrorCount = pEntry->ErrorCount.load(std::memory_order_relaxed);
+	pStats->BytesOut = pEntry->BytesOut.load(std::memory_order_relaxed);
+	pStats->BytesIn = pEntry->BytesIn.load(std::memory_order_relaxed);
+	pStats->TotalNs = pEntry->TotalNs.load(std::memory_order_relaxed);
+	pStats->MinNs = (pStats->Count != 0) ? pEntry->MinNs.load(std::memory_order_relaxed) : 0;
+	pStats->MaxNs = pEntry->MaxNs.load(std::memory_order_relaxed);
+	pStats->P50Ns = Percentile(pEntry, 500);
+	pStats->P90Ns = Percentile(pEntry, 900);
+	pStats->P99Ns = Percentile(pEntry, 990);
+	pStats->P999Ns = Percentile(pEntry, 999);
+}
+/*
+ * @brief Get the statistics of one command.
+ * @param[in]  Cmd     CDBByte[0] of the command.
+ * @param[in]  SubCmd  CDBByte[1] of the command.
+ * @param[out] pStats  Statistics (all counters 0 if the command was not sent).
+ *
+ * @retval false if the command was not sent since the last Reset()
+ */
+bool StlinkCmdStats::GetStats(uint8_t Cmd, uint8_t SubCmd, StlinkCmdStatsT *pStats) const
+{
+	uint16_t key = (uint16_t)(((uint16_t)Cmd << 8) | SubCmd);
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	memset(pStats, 0, sizeof(StlinkCmdStatsT));
+	pStats->Cmd = Cmd;
+	pStats->SubCmd = SubCmd;
+	for( uint32_t i = 0; i < m_entryNb; i++ ) {
+		if( m_pEntries[i].Key.load(std::memory_order_relaxed) == key ) {
+			FillStats(&m_pEntries[i], pStats);
+			return true;
+		}
+	}
+	return false;
+}
+/*
+ * @brief Get the statistics of all the commands sent, in order of first use.
+ * @param[out] pStatsList  Array of MaxNb statistics.
+ * @param[in]  MaxNb       Size of pStatsList.
+ *
+ * @return Number of commands filled in pStatsList
+ */
+uint32_t StlinkCmdStats::GetStatsList(StlinkCmdStatsT *pStatsList, uint32_t MaxNb) const
+{
+	uint32_t nb = 0;
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for( uint32_t i = 0; (i < m_entryNb) && (nb < MaxNb); i++ ) {
+		if( m_pEntries[i].Count.load(std::memory_order_relaxed) != 0 ) {
+			FillStats(&m_pEntries[i], &pStatsList[nb]);
+			nb++;
+		}
+	}
+	return nb;
+}
+/*
+ * @brief Write the statistics of all the commands sent as a text table (latencies in us).
+ * @param[out] pBuffer     Buffer receiving the '\0' terminated text (truncated if too small).
+ * @param[in]  BufferSize  Size of pBuffer.
+ *
+ * @return Number of characters written (without '\0')
+ */
+uint32_t StlinkCmdStats::Dump(char *pBuffer, uint32_t BufferSize) const
+{
+	StlinkCmdStatsT stats;
+	uint32_t len;
+	int ret;
+
+	if( (pBuffer == NULL) || (BufferSize == 0) ) {
+		return 0;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	ret = snprintf(pBuffer, BufferSize, "%-7s %8s %6s %9s %9s %9s %9s %9s %9s %9s %12s %12s\n",
+	               "CMD", "COUNT", "ERR", "MIN_US", "MEAN_US", "P50_US", "P90_US", "P99_US",
+	               "P999_US", "MAX_US", "BYTES_OUT", "BYTES_IN");
+	len = DumpLength(0, ret, BufferSize);
+
+	for( uint32_t i = 0; (i < m_entryNb) && (len < (BufferSize - 1)); i++ ) {
+		if( m_pEntries[i].Count.load(std::memory_order_relaxed) == 0 ) {
+			continue;
+		}
+		FillStats(&m_pEntries[i], &stats);
+		ret = snprintf(&pBuffer[len], BufferSize - len,
+		               "%02X %02X   %8lu %6lu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %12llu %12llu\n",
+		               (unsigned)stats.Cmd, (unsigned)stats.SubCmd,
+		               (unsigned long)stats.Count, (unsigned long)stats.ErrorCount,
+		               stats.MinNs/1000.0, (stats.TotalNs/1000.0)/stats.Count,
+		               stats.P50Ns/1000.0, stats.P90Ns/1000.0, stats.P99Ns/1000.0,
+		               stats.P999Ns/1000.0, stats.MaxNs/1000.0,
+		               (unsigned long long)stats.BytesOut, (unsigned long long)stats.BytesIn);
+		len = DumpLength(len, ret, BufferSize);
+	}
+	return len;
+}
+/*
+ * @brief Text length after a snprintf() of Dump() (truncated output counted up to the buffer end).
+ */
+uint32_t StlinkCmdStats::DumpLength(uint32_t Len, int Ret, uint32_t BufferSize)
+{
+	if( Ret < 0 ) {
+		return Len;
+	}
+	if( (uint32_t)Ret >= (BufferSize - Len) ) {
+		return BufferSize - 1;
+	}
+	return Len + (uint32_t)Ret;
+}
+/*
+ * @brief Clear all the statistics (a command recorded at the same time may be counted before or
+ * after the reset, or in an entry left unused).
+ */
+void StlinkCmdStats::Reset(void)
+{
+	uint32_t i, j;
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for( i = 0; i < 256; i++ ) {
+		m_lastEntryOfSubCmd[i].store(0, std::memory_order_relaxed);
+	}
+	for( i = 0; i < STLINK_CMD_STATS_MAX_CMD; i++ ) {
+		m_pEntries[i].Key.store(0, std::memory_order_relaxed);
+		m_pEntries[i].Count.store(0, std::memory_order_relaxed);
+		m_pEntries[i].ErrorCount.store(0, std::memory_order_relaxed);
+		m_pEntries[i].BytesOut.store(0, std::memory_order_relaxed);
+		m_pEntries[i].BytesIn.store(0, std::memory_order_relaxed);
+		m_pEntries[i].TotalNs.store(0, std::memory_order_relaxed);
+		m_pEntries[i].MinNs.store((uint64_t)-1, std::memory_order_relaxed);
+		m_pEntries[i].MaxNs.store(0, std::memory_order_relaxed);
+		for( j = 0; j < STLINK_CMD_STATS_BUCKET_NB; j++ ) {
+			m_pEntries[i].Buckets[j].store(0, std::memory_order_relaxed);
+		}
+	}
+	m_entryNb = 0;
+}
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,143 @@
+/**
+  ******************************************************************************
+  * @file    stlink_cmd_stats.h
+  * @author  MCD Application Team
+  * @brief   Header for stlink_cmd_stats.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup DEVICE
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _STLINK_CMD_STATS_H
+#define _STLINK_CMD_STATS_H
+/* Includes ------------------------------------------------------------------*/
+#include "stlink_type.h"
+
+#include <atomic>
+#include <mutex>
+
+/* Exported types and constants ----------------------------------------------*/
+/// Max number of different commands (CDBByte[0], CDBByte[1]) with their own statistics,
+/// the following ones are counted together in the last entry (Cmd = SubCmd = 0xFF)
+#define STLINK_CMD_STATS_MAX_CMD      32
+
+/// Latency histogram: log2 ranges of 2^STLINK_CMD_STATS_SUB_BITS linear sub-buckets
+/// (relative precision 1/16), from 0 to 2^STLINK_CMD_STATS_MAX_LOG2 ns (~4.3s, saturated above)
+#define STLINK_CMD_STATS_SUB_BITS     4
+#define STLINK_CMD_STATS_MAX_LOG2     32
+#define STLINK_CMD_STATS_BUCKET_NB    ((STLINK_CMD_STATS_MAX_LOG2 - STLINK_CMD_STATS_SUB_BITS + 1) << STLINK_CMD_STATS_SUB_BITS)
+
+/// Statistics of one command, see StlinkCmdStats::GetStats()
+typedef struct {
+	uint8_t  Cmd;         ///< CDBByte[0] (e.g. STLINK_BRIDGE_COMMAND)
+	uint8_t  SubCmd;      ///< CDBByte[1] (e.g. STLINK_BRIDGE_WRITE_SPI)
+	uint32_t Count;       ///< Number of commands sent
+	uint32_t ErrorCount;  ///< Number of USB errors among Count
+	uint64_t BytesOut;    ///< Bytes sent to the STLink (CDB and data stage)
+	uint64_t BytesIn;     ///< Bytes received from the STLink
+	uint64_t TotalNs;     ///< Sum of the command latencies
+	uint64_t MinNs;       ///< Lowest latency
+	uint64_t MaxNs;       ///< Highest latency
+	uint64_t P50Ns;       ///< Median latency (histogram bucket upper bound)
+	uint64_t P90Ns;       ///< 90th percentile latency
+	uint64_t P99Ns;       ///< 99th percentile latency
+	uint64_t P999Ns;      ///< 99.9th percentile latency
+} StlinkCmdStatsT;
+
+/* Class -------------------------------------------------------------------- */
+/// StlinkCmdStats Class: per command latency histograms and byte counters, recorded by
+/// StlinkDevice::SendRequest() for every USB command while enabled (see SetEnabled()).\n
+/// Record() is lock free (atomic counters of the command entry, written by one Record() at a time:
+/// StlinkDevice::SendRequest() calls it within StlinkDevice::m_csDevice), so that recording never
+/// waits for a thread reading or dumping the statistics; a lock is only taken by the first Record()
+/// of a command (entry creation) and by the readers. A reading concurrent with Record() may see the
+/// counters of a command a few ns apart.\n
+/// The latency is measured in ticks of GetTicks() (x86 time stamp counter, cheaper to read than
+/// GetTimeNs()), converted by TicksToNs().
+class StlinkCmdStats
+{
+public:
+
+	StlinkCmdStats(void);
+
+	virtual ~StlinkCmdStats(void);
+
+	/// Monotonic time in ns used for the latency measurement
+	static uint64_t GetTimeNs(void);
+	/// Monotonic tick counter for the command latencies (see TicksToNs())
+	static uint64_t GetTicks(void);
+
+	/// Duration in ns of DeltaTicks GetTicks() ticks
+	uint64_t TicksToNs(uint64_t DeltaTicks) const;
+
+	void SetEnabled(bool bEnabled);
+	/// Recording enabled (default), StlinkDevice::SendRequest() does not time the commands otherwise
+	bool IsEnabled(void) const {
+		return m_bEnabled.load(std::memory_order_relaxed);
+	}
+
+	void Record(uint8_t Cmd, uint8_t SubCmd, uint64_t LatencyNs,
+	            uint32_t BytesOut, uint32_t BytesIn, bool bError);
+
+	bool GetStats(uint8_t Cmd, uint8_t SubCmd, StlinkCmdStatsT *pStats) const;
+	uint32_t GetStatsList(StlinkCmdStatsT *pStatsList, uint32_t MaxNb) const;
+	uint32_t Dump(char *pBuffer, uint32_t BufferSize) const;
+
+	void Reset(void);
+
+private:
+
+	typedef struct {
+		std::atomic<uint16_t> Key;     // CDBByte[0]<<8 | CDBByte[1]
+		std::atomic<uint32_t> Count;
+		std::atomic<uint32_t> ErrorCount;
+		std::atomic<uint64_t> BytesOut;
+		std::atomic<uint64_t> BytesIn;
+		std::atomic<uint64_t> TotalNs;
+		std::atomic<uint64_t> MinNs;
+		std::atomic<uint64_t> MaxNs;
+		std::atomic<uint32_t> Buckets[STLINK_CMD_STATS_BUCKET_NB];
+	} CmdEntryT;
+
+	static uint32_t BucketIndex(uint64_t LatencyNs);
+	static uint64_t BucketUpperNs(uint32_t BucketIdx);
+	static uint32_t DumpLength(uint32_t Len, int Ret, uint32_t BufferSize);
+	static uint64_t CalibrateTicks(void);
+	template<typename T> static void AddCounter(std::atomic<T> &Counter, T Value);
+
+	CmdEntryT *FindEntry(uint16_t Key, uint8_t SubCmd);
+	uint64_t Percentile(const CmdEntryT *pEntry, uint32_t PerThousand) const;
+	void FillStats(const CmdEntryT *pEntry, StlinkCmdStatsT *pStats) const;
+
+	// Entries allocated once, in order of first use of the commands
+	CmdEntryT *m_pEntries;
+	uint32_t m_entryNb;
+
+	// Entry index + 1 of the last command seen for each CDBByte[1] (0: none), avoids a search
+	std::atomic<uint8_t> m_lastEntryOfSubCmd[256];
+
+	std::atomic<bool> m_bEnabled;
+
+	// ns per tick of GetTicks(), fixed point with 24 fractional bits
+	uint64_t m_tickNsMult;
+
+	// Protect the entry creation and the readers (not taken by Record() once its entry exists)
+	mutable std::mutex m_mutex;
+};
+
+#endif //_STLINK_CMD_STATS_H
+// end group DEVICE
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
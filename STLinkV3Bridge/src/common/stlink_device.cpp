@@ -52,6 +52,17 @@ StlinkDevice::StlinkDevice(STLinkInterface &StlinkIf): m_bStlinkConnected(false)
 	m_Version.VID = 0;
 	m_Version.PID = 0;
 
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	// Critical sections are recursive on windows
+	InitializeCriticalSection(&m_csDevice);
+#else
+	pthread_mutexattr_t csAttr;
+	pthread_mutexattr_init(&csAttr);
+	pthread_mutexattr_settype(&csAttr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&m_csDevice, &csAttr);
+	pthread_mutexattr_destroy(&csAttr);
+#endif
+
 #ifdef USING_ERRORLOG
 	// Error log management
 	m_pErrLog = NULL;
@@ -65,6 +76,12 @@ StlinkDevice::~StlinkDevice(void)
 	// Close STLink even if failure
 	PrivCloseStlink();
 
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	DeleteCriticalSection(&m_csDevice);
+#else
+	pthread_mutex_destroy(&m_csDevice);
+#endif
+
 #ifdef WIN32 //Defined for applications for Win32 and Win64.
 #ifdef USING_ERRORLOG
 	// Flush the trace log system after closing
@@ -114,6 +131,8 @@ STLinkIf_StatusT StlinkDevice::PrivOpenStlink(int StlinkInstId)
 {
 	STLinkIf_StatusT ifStatus=STLINKIF_NO_ERR;
 
+	CSLocker locker(m_csDevice);
+
 	if( m_bStlinkConnected == false ) {
 		// Open the device
 		ifStatus = m_pStlinkInterface->OpenDevice(StlinkInstId, 0, m_bOpenExclusive, &m_handle);
@@ -172,6 +191,8 @@ STLinkIf_StatusT StlinkDevice::PrivOpenStlink(const char *pSerialNumber, bool bS
 		return STLINKIF_DLL_ERR;
 	}
 
+	CSLocker locker(m_csDevice);
+
 	if( m_bStlinkConnected == false )
 	{
 		ifStatus = m_pStlinkInterface->OpenDevice(pSerialNumber, bStrict, 0, m_bOpenExclusive, &m_handle);
@@ -188,6 +209,9 @@ STLinkIf_StatusT StlinkDevice::PrivOpenStlink(const char *pSerialNumber, bool bS
  */
 STLinkIf_StatusT StlinkDevice::PrivCloseStlink(void)
 {
+	// Wait for the end of the command possibly in progress from another thread
+	CSLocker locker(m_csDevice);
+
 	if( m_bStlinkConnected == true )
 	{
 		if( (m_handle != NULL) )
@@ -213,7 +237,8 @@ STLinkIf_StatusT StlinkDevice::PrivCloseStlink(void)
  */
 STLinkIf_StatusT StlinkDevice::PrivGetVersionExt(Stlk_VersionExtT* pVersion)
 {
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	STLinkIf_StatusT ifStatus;
 	uint8_t version[12];
 
@@ -222,7 +247,6 @@ STLinkIf_StatusT StlinkDevice::PrivGetVersionExt(Stlk_VersionExtT* pVersion)
 		return STLINKIF_NO_STLINK;
 	}
 
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBLength = STLINK_CMD_SIZE_16;
@@ -236,7 +260,6 @@ STLinkIf_StatusT StlinkDevice::PrivGetVersionExt(Stlk_VersionExtT* pVersion)
 	// PrivGetVersionExt is called after m_bStlinkConnected=true, so we can call SendRequest
 	// (preferable for semaphore management and status code analysis)
 	ifStatus = SendRequest(pRq);
-	delete pRq;
 
 	if( ifStatus == STLINKIF_NO_ERR ) {
 		pVersion->Major_Ver = version[0];
@@ -266,20 +289,41 @@ STLinkIf_StatusT StlinkDevice::SendRequest(STLink_DeviceRequestT *pDevReq,
 											 const uint16_t UsbTimeoutMs)
 {
 	STLinkIf_StatusT ifStatus;
+	uint64_t startTicks, latencyNs;
+	bool bStats = m_cmdStats.IsEnabled();
 
 	if( pDevReq == NULL ) {
 		return STLINKIF_PARAM_ERR;
 	}
 
-	if( m_bStlinkConnected == false ) {
-		return STLINKIF_NO_STLINK;
-	}
+	{
+		// Only the commands to this device are serialized: other devices can be accessed in parallel
+		CSLocker locker(m_csDevice);
 
-	if( m_pStlinkInterface == NULL ) {
-		return STLINKIF_DLL_ERR;
-	}
+		if( m_bStlinkConnected == false ) {
+			return STLINKIF_NO_STLINK;
+		}
 
-	ifStatus = m_pStlinkInterface->SendCommand(m_handle, 0, pDevReq, UsbTimeoutMs);
+		if( m_pStlinkInterface == NULL ) {
+			return STLINKIF_DLL_ERR;
+		}
+
+		if( bStats == false ) {
+			ifStatus = m_pStlinkInterface->SendCommand(m_handle, 0, pDevReq, UsbTimeoutMs);
+		} else {
+			startTicks = StlinkCmdStats::GetTicks();
+			ifStatus = m_pStlinkInterface->SendCommand(m_handle, 0, pDevReq, UsbTimeoutMs);
+			latencyNs = m_cmdStats.TicksToNs(StlinkCmdStats::GetTicks() - startTicks);
+			// Recorded (lock free, one writer per device) within the command critical section
+			if( pDevReq->InputRequest == REQUEST_WRITE_1ST_EPOUT ) {
+				m_cmdStats.Record(pDevReq->CDBByte[0], pDevReq->CDBByte[1], latencyNs,
+				                  pDevReq->CDBLength + pDevReq->BufferLength, 0, (ifStatus != STLINKIF_NO_ERR));
+			} else {
+				m_cmdStats.Record(pDevReq->CDBByte[0], pDevReq->CDBByte[1], latencyNs,
+				                  pDevReq->CDBLength, pDevReq->BufferLength, (ifStatus != STLINKIF_NO_ERR));
+			}
+		}
+	}
 	if( ifStatus != STLINKIF_NO_ERR) {
 		ifStatus = STLINKIF_USB_COMM_ERR;
 	} else {
@@ -303,7 +347,8 @@ STLinkIf_StatusT StlinkDevice::SendRequest(STLink_DeviceRequestT *pDevReq,
 STLinkIf_StatusT StlinkDevice::PrivGetTargetVoltage(float *pVoltage)
 {
 	uint32_t adcMeasures[2];
-	STLink_DeviceRequestT *pRq;
+	STLink_DeviceRequestT devReq;
+	STLink_DeviceRequestT *pRq = &devReq;
 	STLinkIf_StatusT ifStatus;
 
 	if( m_bStlinkConnected == false ) {
@@ -311,7 +356,6 @@ STLinkIf_StatusT StlinkDevice::PrivGetTargetVoltage(float *pVoltage)
 		return STLINKIF_NO_STLINK;
 	}
 
-	pRq = new STLink_DeviceRequestT;
 	memset(pRq, 0, sizeof(STLink_DeviceRequestT));
 
 	pRq->CDBLength = STLINK_CMD_SIZE_16;
@@ -324,8 +368,6 @@ STLinkIf_StatusT StlinkDevice::PrivGetTargetVoltage(float *pVoltage)
 
 	ifStatus = SendRequest(pRq);
 
-	delete pRq;
-
 	if( ifStatus == STLINKIF_NO_ERR )
 	{
 		// First returned value is the ADC measure for VREFINT (according to datasheet: 1.2V);
@@ -27,6 +27,8 @@
 #include "stlink_if_common.h"
 #include "stlink_interface.h"
 #include "stlink_fw_api_common.h"
+#include "criticalsectionlock.h"
+#include "stlink_cmd_stats.h"
 
 #ifdef USING_ERRORLOG
 #include "ErrLog.h"
@@ -99,6 +101,13 @@ protected:
 
 	STLinkIf_StatusT SendRequest(STLink_DeviceRequestT *pDevReq, const uint16_t UsbTimeoutMs=0);
 	void LogTrace(const char *pMessage, ...);
+
+	// Serialize the commands sent to this device (recursive: can be held around a sequence
+	// of SendRequest() that must not be interleaved with other threads)
+	CriticalSection_ObjectT m_csDevice;
+
+	// Latency and byte counters of the commands sent by SendRequest() (recorded within m_csDevice)
+	StlinkCmdStats m_cmdStats;
 private:
 	// Opened device handle
 	void*   m_handle;
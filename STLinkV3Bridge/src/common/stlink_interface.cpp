@@ -6,6 +6,9 @@
   *          Manage communication interfaces (USB) to connect to the STLink device. \n
   *          STLinkInterface class manages USB enumeration and STLink devices detection. 
   *          STLinkInterface object to be initialized before being used by Brg.
+  *          The devices are reached through a STLinkTransport: STLinkUSBDriver library
+  *          by default, native libusb backend if USING_LIBUSB is defined (non Windows),
+  *          or any transport given by STLinkInterface::SetTransport().
   ******************************************************************************
   * @attention
   *
@@ -27,9 +30,8 @@
 
 #include "criticalsectionlock.h"
 #include "stlink_interface.h"
-#ifdef WIN32 //Defined for applications for Win32 and Win64.
-#include "shlwapi.h"
-#endif // WIN32
+#include "stlink_usbdriver.h"
+#include "stlink_libusb.h"
 /* Private typedef -----------------------------------------------------------*/
 /* Private defines -----------------------------------------------------------*/
 /* Private macros ------------------------------------------------------------*/
@@ -56,12 +58,9 @@ const char * LogIfString[STLINK_NB_INTERFACES] =
  * @param[in]  IfId  STLink USB interface to be used: #STLINK_BRIDGE for Bridge interface.
  *                   Other interfaces not supported currently.
  */
-STLinkInterface::STLinkInterface(STLink_EnumStlinkInterfaceT IfId): m_ifId(IfId), m_nbEnumDevices(0), m_bApiDllLoaded(false),
-	m_bDevInterfaceEnumerated(false)
+STLinkInterface::STLinkInterface(STLink_EnumStlinkInterfaceT IfId): m_pTransport(NULL), m_pOwnedTransport(NULL),
+	m_ifId(IfId), m_nbEnumDevices(0), m_bApiDllLoaded(false), m_bDevInterfaceEnumerated(false)
 {
-#ifdef WIN32 //Defined for applications for Win32 and Win64.
-	m_hMod = NULL;
-#endif
 	m_pathOfProcess[0]='\0';
 
 #ifdef WIN32 //Defined for applications for Win32 and Win64.
@@ -91,20 +90,16 @@ STLinkInterface::~STLinkInterface(void)
 		m_pErrLog->Dump();
 	}
 #endif
-
-	if( m_hMod != NULL )
-	{
-		if( FreeLibrary(m_hMod) != 0 )
-		{
-			// Successful
-			m_hMod = NULL;
-		}
-	}
 #else
 	// critical section deletion not needed because static mutex
-
-	STLink_FreeLibrary();
 #endif // WIN32
+
+	// Free the STLinkUSBDriver library or the libusb context
+	if( m_pOwnedTransport != NULL ) {
+		delete m_pOwnedTransport;
+		m_pOwnedTransport = NULL;
+	}
+	m_pTransport = NULL;
 }
 /*
  * Trace logging mechanism, under compilation switch USING_ERRORLOG (requiring ErrLog.h and ErrLog.cpp)
@@ -124,6 +119,8 @@ void STLinkInterface::LogTrace(const char *pMessage, ...)
 /**
  * @ingroup INTERFACE
  * @brief If not already done: load the STLinkUSBDriver library (windows only), open log files.
+ * When USING_LIBUSB is defined (non Windows), initialize the native libusb transport instead.
+ * Nothing is loaded if a transport has been given by STLinkInterface::SetTransport().
  *
  * @param[in]  pPathOfProcess  Path, in ASCII, where STLinkUSBDriver library is searched
  *                             when not found in current dir, for Windows.
@@ -152,58 +149,32 @@ STLinkIf_StatusT  STLinkInterface::LoadStlinkLibrary(const char *pPathOfProcess)
 #endif
 		}
 
-#ifdef WIN32 //Defined for applications for Win32 and Win64.
-		if( m_hMod == NULL ) {
-			// First try from this DLL path
-			if( pPathOfProcess != NULL ) {
-				char szDllPath[_MAX_PATH];
-#if defined(_MSC_VER) &&  (_MSC_VER >= 1400) /* VC8+ (VS2005) */
-				::strncpy_s(szDllPath, _MAX_PATH, m_pathOfProcess, _MAX_PATH);
-#else
-				::strncpy(szDllPath, m_pathOfProcess, _MAX_PATH);
-#endif
-				// Note: Unicode is not supported (would require T_CHAR szDllPath, to include <tchar.h> 
-				// and to use generic function PathAppend(szDllPath, _T("STLinkUSBDriver.dll")) 
-				::PathAppendA(szDllPath, "STLinkUSBDriver.dll");
+		if( m_pTransport == NULL ) {
+#ifdef USING_STLINK_USBDRIVER
+			STLinkUsbDriverTransport *pUsbDriver = new STLinkUsbDriverTransport();
 
-				m_hMod = LoadLibraryA(szDllPath);
+			if( pUsbDriver->Load((pPathOfProcess != NULL) ? m_pathOfProcess : NULL) == true ) {
+				LogTrace("STLinkInterface STLinkUSBDriver library loaded");
+				m_pOwnedTransport = pUsbDriver;
+			} else {
+				LogTrace("STLinkInterface Failure loading STLinkUSBDriver library");
+				delete pUsbDriver;
+				ifStatus = STLINKIF_DLL_ERR;
 			}
-		}
-
-		if( m_hMod == NULL ) {
-			// Second try using the whole procedure for path resolution (including PATH environment variable)
-			m_hMod = LoadLibraryA("STLinkUSBDriver.dll");
-		}
-
-		if( m_hMod == NULL ) {
-			LogTrace("STLinkInterface Failure loading STLinkUSBDriver.dll");
-			ifStatus = STLINKIF_DLL_ERR;
-		}
+#else // USING_LIBUSB
+			STLinkLibUsbTransport *pLibUsb = new STLinkLibUsbTransport();
 
-		if( ifStatus == STLINKIF_NO_ERR ) {
-			LogTrace("STLinkInterface STLinkUSBDriver.dll loaded");
-			if( m_ifId == STLINK_BRIDGE ) {
-				// Get the needed API
-				STLink_Reenumerate    = (pSTLink_Reenumerate)   GetProcAddress(m_hMod, ("STLink_Reenumerate"));
-				STLink_GetNbDevices   = (pSTLink_GetNbDevices)  GetProcAddress(m_hMod, ("STLink_GetNbDevices"));
-				STLink_GetDeviceInfo2 = (pSTLink_GetDeviceInfo2)GetProcAddress(m_hMod, ("STLink_GetDeviceInfo2"));
-				STLink_OpenDevice     = (pSTLink_OpenDevice)    GetProcAddress(m_hMod, ("STLink_OpenDevice"));
-				STLink_CloseDevice    = (pSTLink_CloseDevice)   GetProcAddress(m_hMod, ("STLink_CloseDevice"));
-				STLink_SendCommand    = (pSTLink_SendCommand)   GetProcAddress(m_hMod, ("STLink_SendCommand"));
-
-				// Check if DLL supports at least required function, this is mandatory but not enough for BRIDGE support
-				// STLink_Reenumerate will return SS_BAD_PARAMETER if DLL is too old and Bridge interface is not supported.
-				if( (STLink_Reenumerate == NULL) || (STLink_GetNbDevices == NULL) 
-					|| (STLink_GetDeviceInfo2 == NULL) || (STLink_OpenDevice == NULL) || (STLink_CloseDevice == NULL)
-					|| (STLink_SendCommand == NULL) ) {
-					// TCP routines are required and missing
-					ifStatus = STLINKIF_DLL_ERR;
-				}
+			if( pLibUsb->Init() == SS_OK ) {
+				LogTrace("STLinkInterface libusb transport initialized");
+				m_pOwnedTransport = pLibUsb;
+			} else {
+				LogTrace("STLinkInterface Failure initializing libusb");
+				delete pLibUsb;
+				ifStatus = STLINKIF_DLL_ERR;
 			}
-		}
-#else // !WIN32
-        // nothing to do
 #endif
+			m_pTransport = m_pOwnedTransport;
+		}
 		if( ifStatus == STLINKIF_NO_ERR ) {
 			m_bApiDllLoaded = true;
 		}
@@ -216,6 +187,20 @@ STLinkIf_StatusT  STLinkInterface::LoadStlinkLibrary(const char *pPathOfProcess)
 bool STLinkInterface::IsLibraryLoaded() {
 	return m_bApiDllLoaded;
 }
+/**
+ * @ingroup INTERFACE
+ * @brief Use the given transport instead of the STLinkUSBDriver library (or libusb backend).
+ * To be called before STLinkInterface::LoadStlinkLibrary(). The transport remains owned by
+ * the caller and must outlive this STLinkInterface object.
+ *
+ * @param[in]  pTransport  Transport to use (e.g. simulator).
+ */
+void STLinkInterface::SetTransport(STLinkTransport *pTransport)
+{
+	if( m_bApiDllLoaded == false ) {
+		m_pTransport = pTransport;
+	}
+}
 /**
  * @ingroup INTERFACE
  * @brief USB enumeration routine.
@@ -250,7 +235,10 @@ STLinkIf_StatusT STLinkInterface::EnumDevices(uint32_t *pNumDevices, bool bClear
 
 	if( IsLibraryLoaded() == true ) {
 		if( m_ifId == STLINK_BRIDGE ) {
-			status = STLink_Reenumerate(m_ifId, bClearList);
+			// Mutex to avoid concurrent update of the device list
+			CSLocker locker(g_csInterface);
+
+			status = m_pTransport->Reenumerate(m_ifId, bClearList);
 			if( status == SS_BAD_PARAMETER ) {
 				// DLL is too old and does not support BRIDGE interface
 				m_bApiDllLoaded = false;
@@ -258,7 +246,7 @@ STLinkIf_StatusT STLinkInterface::EnumDevices(uint32_t *pNumDevices, bool bClear
 			}
 			// Note that STLink_Reenumerate might fail because of issue during serial number retrieving
 			// which is not a blocking error here; 
-			m_nbEnumDevices = STLink_GetNbDevices(m_ifId);
+			m_nbEnumDevices = m_pTransport->GetNbDevices(m_ifId);
 
 			if( m_nbEnumDevices == 0 ) {
 				LogTrace("No STLink device with %s interface detected on the USB", LogIfString[m_ifId]);
@@ -365,13 +353,6 @@ STLinkIf_StatusT STLinkInterface::GetDeviceInfo2(int StlinkInstId, STLink_Device
 	STLinkIf_StatusT ifStatus = STLINKIF_NO_ERR;
 
 	if( IsLibraryLoaded() == true ) {
-#ifdef WIN32
-		if( STLink_GetDeviceInfo2 == NULL ) {
-			// STLinkUSBDriver is too old 
-			return STLINKIF_NOT_SUPPORTED;
-		}
-#endif
-
 		// Enumerate the current STLink interface if not already done
 		ifStatus = EnumDevicesIfRequired(NULL, false, false);
 		if( ifStatus != STLINKIF_NO_ERR ) {
@@ -388,7 +369,8 @@ STLinkIf_StatusT STLinkInterface::GetDeviceInfo2(int StlinkInstId, STLink_Device
 				return STLINKIF_PARAM_ERR;
 			}
 
-			if( STLink_GetDeviceInfo2(m_ifId, StlinkInstId, pInfo, InfoSize) != SS_OK ) {
+			CSLocker locker(g_csInterface);
+			if( m_pTransport->GetDeviceInfo2(m_ifId, StlinkInstId, pInfo, InfoSize) != SS_OK ) {
 				return STLINKIF_GET_INFO_ERR;
 			}
 		} else {
@@ -433,7 +415,8 @@ STLinkIf_StatusT STLinkInterface::OpenDevice(int StlinkInstId, uint32_t StlinkId
 				return STLINKIF_PARAM_ERR;
 			}
 			// Open the device
-			status = STLink_OpenDevice(m_ifId, StlinkInstId, (bOpenExclusive==true)?1:0, pHandle);
+			CSLocker locker(g_csInterface);
+			status = m_pTransport->OpenDevice(m_ifId, StlinkInstId, (bOpenExclusive==true)?1:0, pHandle);
 			if( status != SS_OK ) {
 				LogTrace("%s STLink device USB connection failure", LogIfString[m_ifId]);
 				ifStatus = STLINKIF_CONNECT_ERR;
@@ -524,7 +507,8 @@ STLinkIf_StatusT STLinkInterface::CloseDevice(void *pHandle, uint32_t StlinkIdTc
 	if( IsLibraryLoaded() == true ) {
 		if( m_ifId == STLINK_BRIDGE ) {
 			if( (pHandle != NULL) ) {
-				status = STLink_CloseDevice(pHandle);
+				CSLocker locker(g_csInterface);
+				status = m_pTransport->CloseDevice(pHandle);
 				if( status != SS_OK ) {
 					LogTrace("%s Error closing USB communication", LogIfString[m_ifId]);
 					ifStatus = STLINKIF_CLOSE_ERR;
@@ -565,16 +549,15 @@ STLinkIf_StatusT STLinkInterface::SendCommand(void *pHandle,
 		return STLINKIF_PARAM_ERR;
 	}
 
-	// Create a Mutex to avoid concurrent access to STLink_SendCommand 
-	CSLocker locker(g_csInterface);
-
+	// No global lock here: commands are serialized per device by the caller (StlinkDevice),
+	// the transport supports concurrent commands on different handles.
 	if( IsLibraryLoaded() == true ) {
 		if( m_ifId == STLINK_BRIDGE ) {
 			// UsbTimeoutMs if 0 use default (5s) else use UsbTimeoutMs.
 			if( UsbTimeoutMs != 0 ) {
 				usbTimeout = (uint32_t) UsbTimeoutMs;
 			}
-			ret=STLink_SendCommand(pHandle, pDevReq, usbTimeout);
+			ret=m_pTransport->SendCommand(pHandle, pDevReq, usbTimeout);
 
 			if( ret != SS_OK ) {
 				LogTrace("%s USB communication error (%d) after target cmd %02hX %02hX %02hX %02hX %02hX %02hX %02hX %02hX %02hX %02hX",
@@ -24,6 +24,7 @@
 #define _STLINK_INTERFACE_H
 /* Includes ------------------------------------------------------------------*/
 #include "STLinkUSBDriver.h"
+#include "stlink_transport.h"
 
 #ifdef USING_ERRORLOG
 #include "ErrLog.h"
@@ -65,6 +66,8 @@ public:
 
 	bool IsLibraryLoaded();
 
+	void SetTransport(STLinkTransport *pTransport);
+
 	STLinkIf_StatusT EnumDevices(uint32_t *pNumDevices, bool bClearList);
 
 	STLinkIf_StatusT GetDeviceInfo2(int StlinkInstId, STLink_DeviceInfo2T *pInfo, uint32_t InfoSize);
@@ -86,21 +89,12 @@ private:
 
 	STLinkIf_StatusT EnumDevicesIfRequired(uint32_t *pNumDevices, bool bForceRenum, bool bClearList);
 
-#ifdef WIN32 //Defined for applications for Win32 and Win64.
-	// New API of STLinkUSBDriver.dll; should be used if available
-	pSTLink_Reenumerate     STLink_Reenumerate;
-	pSTLink_GetNbDevices    STLink_GetNbDevices;
-	pSTLink_GetDeviceInfo2  STLink_GetDeviceInfo2;
-	pSTLink_OpenDevice      STLink_OpenDevice;
-	pSTLink_CloseDevice     STLink_CloseDevice;
-	pSTLink_SendCommand     STLink_SendCommand;
-#endif
-
 	void LogTrace(const char *pMessage, ...);
 
-#ifdef WIN32 //Defined for applications for Win32 and Win64.
-	HMODULE  m_hMod;
-#endif
+	// Transport used to reach the devices (STLinkUSBDriver library, libusb, simulator ...)
+	STLinkTransport *m_pTransport;
+	// Transport created by LoadStlinkLibrary() (deleted with this object), NULL if given by SetTransport()
+	STLinkTransport *m_pOwnedTransport;
 	STLink_EnumStlinkInterfaceT m_ifId;
 	uint32_t    m_nbEnumDevices;
 
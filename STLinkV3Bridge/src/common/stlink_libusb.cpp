@@ -0,0 +1,615 @@
+/**
+  ******************************************************************************
+  * @file    stlink_libusb.cpp
+  * @author  MCD Application Team
+  * @brief   Native libusb-1.0 STLinkTransport implementation.
+  *          Enumerates the STLINK-V3 devices, claims their bridge interface and
+  *          exchanges the commands through asynchronous bulk transfers, without
+  *          the STLinkUSBDriver library. Built when USING_LIBUSB is defined.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "stlink_libusb.h"
+
+#ifdef USING_LIBUSB
+/* Private typedef -----------------------------------------------------------*/
+/// Opened bridge interface
+struct STLinkLibUsbHandle {
+	libusb_device_handle *pDevHandle;
+	uint8_t IfNb;
+	uint8_t EpOut;
+	uint8_t EpIn;
+	uint8_t EpIn2;
+	// Transfers allocated once at opening, reused by every command
+	struct libusb_transfer *pCmdTransfer;
+	struct libusb_transfer *pDataTransfer;
+	// OpenDevice() calls sharing the handle (always 1 if bExclusive)
+	uint32_t OpenNb;
+	bool bExclusive;
+	// Serialize the commands of the callers sharing the handle
+	CriticalSection_ObjectT CsCommand;
+	STLinkLibUsbHandleT *pNext;
+};
+
+/* Private defines -----------------------------------------------------------*/
+#define STLINK_USB_VID_ST            0x0483
+#define USB_CLASS_MASS_STORAGE       0x08
+
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+// STLINK-V3 product IDs providing a bridge interface
+static const uint16_t StlinkV3BridgePids[] = {
+	0x374E, // STLINK-V3E
+	0x374F, // STLINK-V3S
+	0x3753, // STLINK-V3 with 2 VCP
+	0x3754, // STLINK-V3 without mass storage
+	0x3757  // STLINK-V3PWR
+};
+
+/* Global variables ----------------------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+static bool IsStlinkV3Bridge(const struct libusb_device_descriptor *pDesc)
+{
+	unsigned int i;
+
+	if( pDesc->idVendor != STLINK_USB_VID_ST ) {
+		return false;
+	}
+	for( i=0; i<sizeof(StlinkV3BridgePids)/sizeof(StlinkV3BridgePids[0]); i++ ) {
+		if( pDesc->idProduct == StlinkV3BridgePids[i] ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static uint32_t ConvLibUsbErrToSs(int LibUsbErr)
+{
+	switch( LibUsbErr ) {
+		case LIBUSB_SUCCESS:
+			return SS_OK;
+		case LIBUSB_ERROR_ACCESS:
+		case LIBUSB_ERROR_BUSY:
+			return SS_PERMISSION_ERR;
+		case LIBUSB_ERROR_NO_DEVICE:
+		case LIBUSB_ERROR_NOT_FOUND:
+			return SS_NO_DEVICE;
+		case LIBUSB_ERROR_TIMEOUT:
+			return SS_TIMEOUT;
+		case LIBUSB_ERROR_NO_MEM:
+			return SS_MEMORY_PROBLEM;
+		default:
+			return SS_TRANSFER_ERR;
+	}
+}
+
+static uint32_t ConvTransferStatusToSs(const struct libusb_transfer *pTransfer)
+{
+	switch( pTransfer->status ) {
+		case LIBUSB_TRANSFER_COMPLETED:
+			if( pTransfer->actual_length != pTransfer->length ) {
+				// Firmware did not send/receive the expected data size
+				return SS_TRUNCATED_DATA;
+			}
+			return SS_OK;
+		case LIBUSB_TRANSFER_TIMED_OUT:
+			return SS_TIMEOUT;
+		case LIBUSB_TRANSFER_NO_DEVICE:
+			return SS_NO_DEVICE;
+		default:
+			return SS_TRANSFER_ERR;
+	}
+}
+
+// Transfer completion callback: user_data points to the completion flag
+static void LIBUSB_CALL TransferDoneCb(struct libusb_transfer *pTransfer)
+{
+	*((int*)pTransfer->user_data) = 1;
+}
+
+// Handle the libusb events until the given transfer is completed
+static void WaitTransfer(libusb_context *pCtx, struct libusb_transfer *pTransfer, int *pCompleted)
+{
+	while( *pCompleted == 0 ) {
+		int ret = libusb_handle_events_completed(pCtx, pCompleted);
+		if( (ret < 0) && (ret != LIBUSB_ERROR_INTERRUPTED) ) {
+			// Event handling failure: abort the transfer, its callback will still be called
+			libusb_cancel_transfer(pTransfer);
+		}
+	}
+}
+
+/* Class Functions Definition ------------------------------------------------*/
+
+/*
+ * @brief STLinkLibUsbTransport constructor, STLinkLibUsbTransport::Init() to be called before use.
+ */
+STLinkLibUsbTransport::STLinkLibUsbTransport(void): m_pCtx(NULL), m_nbEnumDevices(0), m_pOpenedList(NULL)
+{
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	InitializeCriticalSection(&m_csList);
+#else
+	pthread_mutex_init(&m_csList, NULL);
+#endif
+}
+/*
+ * @brief STLinkLibUsbTransport destructor: close all opened devices and release libusb.
+ */
+STLinkLibUsbTransport::~STLinkLibUsbTransport(void)
+{
+	while( m_pOpenedList != NULL ) {
+		PrivCloseDevice(m_pOpenedList);
+	}
+	FreeEnumList();
+	if( m_pCtx != NULL ) {
+		libusb_exit(m_pCtx);
+		m_pCtx = NULL;
+	}
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	DeleteCriticalSection(&m_csList);
+#else
+	pthread_mutex_destroy(&m_csList);
+#endif
+}
+/*
+ * @brief Initialize the libusb context.
+ *
+ * @retval SS_OK if successful, error otherwise
+ */
+uint32_t STLinkLibUsbTransport::Init(void)
+{
+	if( m_pCtx != NULL ) {
+		return SS_OK;
+	}
+	return ConvLibUsbErrToSs(libusb_init(&m_pCtx));
+}
+
+void STLinkLibUsbTransport::FreeEnumList(void)
+{
+	uint32_t i;
+
+	for( i=0; i<m_nbEnumDevices; i++ ) {
+		libusb_unref_device(m_enumDevices[i].pDevice);
+		m_enumDevices[i].pDevice = NULL;
+	}
+	m_nbEnumDevices = 0;
+}
+/*
+ * @brief Look for the bridge interface of a STLINK-V3 device and for its bulk endpoints.
+ * The bridge interface is #STLINK_USB_BRIDGE_IF_NB when the device provides a mass storage
+ * interface, #STLINK_USB_BRIDGE_IF_NB_NO_MSD otherwise.
+ *
+ * @retval true if the bridge interface has been found (pEnumDev IfNb and Ep fields updated)
+ */
+bool STLinkLibUsbTransport::GetBridgeInterface(libusb_device *pDevice, EnumDeviceT *pEnumDev)
+{
+	struct libusb_config_descriptor *pConfig;
+	const struct libusb_interface_descriptor *pIfDesc = NULL;
+	uint8_t ifNb = STLINK_USB_BRIDGE_IF_NB_NO_MSD;
+	int i;
+
+	if( libusb_get_active_config_descriptor(pDevice, &pConfig) != LIBUSB_SUCCESS ) {
+		if( libusb_get_config_descriptor(pDevice, 0, &pConfig) != LIBUSB_SUCCESS ) {
+			return false;
+		}
+	}
+
+	for( i=0; i<pConfig->bNumInterfaces; i++ ) {
+		if( (pConfig->interface[i].num_altsetting > 0) &&
+		    (pConfig->interface[i].altsetting[0].bInterfaceClass == USB_CLASS_MASS_STORAGE) ) {
+			ifNb = STLINK_USB_BRIDGE_IF_NB;
+		}
+	}
+	for( i=0; i<pConfig->bNumInterfaces; i++ ) {
+		if( (pConfig->interface[i].num_altsetting > 0) &&
+		    (pConfig->interface[i].altsetting[0].bInterfaceNumber == ifNb) ) {
+			pIfDesc = &pConfig->interface[i].altsetting[0];
+		}
+	}
+
+	pEnumDev->IfNb = ifNb;
+	pEnumDev->EpOut = 0;
+	pEnumDev->EpIn = 0;
+	pEnumDev->EpIn2 = 0;
+	if( pIfDesc != NULL ) {
+		for( i=0; i<pIfDesc->bNumEndpoints; i++ ) {
+			const struct libusb_endpoint_descriptor *pEp = &pIfDesc->endpoint[i];
+			if( (pEp->bmAttributes & LIBUSB_TRANSFER_TYPE_MASK) != LIBUSB_TRANSFER_TYPE_BULK ) {
+				continue;
+			}
+			if( (pEp->bEndpointAddress & LIBUSB_ENDPOINT_DIR_MASK) == LIBUSB_ENDPOINT_IN ) {
+				if( pEnumDev->EpIn == 0 ) {
+					pEnumDev->EpIn = pEp->bEndpointAddress;
+				} else if( pEnumDev->EpIn2 == 0 ) {
+					pEnumDev->EpIn2 = pEp->bEndpointAddress;
+				}
+			} else if( pEnumDev->EpOut == 0 ) {
+				pEnumDev->EpOut = pEp->bEndpointAddress;
+			}
+		}
+	}
+	libusb_free_config_descriptor(pConfig);
+
+	return ((pEnumDev->EpOut != 0) && (pEnumDev->EpIn != 0));
+}
+/*
+ * @brief Build the list of connected STLINK-V3 devices providing the bridge interface.
+ * See STLink_Reenumerate() in STLinkUSBDriver.h. Handles of opened devices remain valid
+ * if bClearList is 0, they are all closed otherwise.
+ *
+ * @retval SS_BAD_PARAMETER IfId is not STLINK_BRIDGE
+ * @retval SS_PERMISSION_ERR At least one device could not be opened for reading its serial number
+ * @retval SS_OK if successful, error otherwise
+ */
+uint32_t STLinkLibUsbTransport::Reenumerate(STLink_EnumStlinkInterfaceT IfId, uint8_t bClearList)
+{
+	libusb_device **pList;
+	ssize_t nbUsbDevices, i;
+	uint32_t status = SS_OK;
+
+	if( IfId != STLINK_BRIDGE ) {
+		return SS_BAD_PARAMETER;
+	}
+	if( m_pCtx == NULL ) {
+		return SS_FAILED_INIT;
+	}
+
+	CSLocker locker(m_csList);
+
+	if( bClearList != 0 ) {
+		while( m_pOpenedList != NULL ) {
+			PrivCloseDevice(m_pOpenedList);
+		}
+	}
+	FreeEnumList();
+
+	nbUsbDevices = libusb_get_device_list(m_pCtx, &pList);
+	if( nbUsbDevices < 0 ) {
+		return ConvLibUsbErrToSs((int)nbUsbDevices);
+	}
+
+	for( i=0; (i<nbUsbDevices) && (m_nbEnumDevices<STLINK_LIBUSB_MAX_DEVICES); i++ ) {
+		struct libusb_device_descriptor desc;
+		EnumDeviceT *pEnumDev = &m_enumDevices[m_nbEnumDevices];
+		libusb_device_handle *pDevHandle = NULL;
+		STLinkLibUsbHandleT *pOpened;
+		bool bTmpOpen = false;
+
+		if( libusb_get_device_descriptor(pList[i], &desc) != LIBUSB_SUCCESS ) {
+			continue;
+		}
+		if( IsStlinkV3Bridge(&desc) == false ) {
+			continue;
+		}
+		if( GetBridgeInterface(pList[i], pEnumDev) == false ) {
+			continue;
+		}
+
+		memset(&pEnumDev->Info, 0, sizeof(pEnumDev->Info));
+		pEnumDev->Info.VendorId = desc.idVendor;
+		pEnumDev->Info.ProductId = desc.idProduct;
+
+		// Serial number: reuse the handle if the device is already opened, else open it temporarily
+		for( pOpened = m_pOpenedList; pOpened != NULL; pOpened = pOpened->pNext ) {
+			if( libusb_get_device(pOpened->pDevHandle) == pList[i] ) {
+				pDevHandle = pOpened->pDevHandle;
+				break;
+			}
+		}
+		if( pDevHandle == NULL ) {
+			int ret = libusb_open(pList[i], &pDevHandle);
+			if( ret != LIBUSB_SUCCESS ) {
+				// Device listed anyway (as STLinkUSBDriver does), without serial number
+				pDevHandle = NULL;
+				status = (ret == LIBUSB_ERROR_ACCESS) ? SS_PERMISSION_ERR : ConvLibUsbErrToSs(ret);
+			} else {
+				bTmpOpen = true;
+			}
+		}
+		if( (pDevHandle != NULL) && (desc.iSerialNumber != 0) ) {
+			if( libusb_get_string_descriptor_ascii(pDevHandle, desc.iSerialNumber,
+			            (unsigned char*)pEnumDev->Info.EnumUniqueId, SERIAL_NUM_STR_MAX_LEN) < 0 ) {
+				pEnumDev->Info.EnumUniqueId[0] = '\0';
+			}
+			pEnumDev->Info.EnumUniqueId[SERIAL_NUM_STR_MAX_LEN-1] = '\0';
+		}
+		if( bTmpOpen == true ) {
+			libusb_close(pDevHandle);
+		}
+
+		pEnumDev->pDevice = libusb_ref_device(pList[i]);
+		m_nbEnumDevices++;
+	}
+	libusb_free_device_list(pList, 1);
+
+	return status;
+}
+/*
+ * @brief Number of devices found by the last STLinkLibUsbTransport::Reenumerate().
+ */
+uint32_t STLinkLibUsbTransport::GetNbDevices(STLink_EnumStlinkInterfaceT IfId)
+{
+	if( IfId != STLINK_BRIDGE ) {
+		return 0;
+	}
+	return m_nbEnumDevices;
+}
+/*
+ * @brief See STLink_GetDeviceInfo2() in STLinkUSBDriver.h.
+ *
+ * @retval SS_BAD_PARAMETER Wrong IfId, DevIdxInList or NULL pInfo
+ * @retval SS_TRUNCATED_DATA InfoSize greater than sizeof(STLink_DeviceInfo2T): exceeding bytes set to 0
+ * @retval SS_OK if successful
+ */
+uint32_t STLinkLibUsbTransport::GetDeviceInfo2(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+                                               STLink_DeviceInfo2T *pInfo, uint32_t InfoSize)
+{
+	uint32_t status = SS_OK;
+	uint32_t copySize = InfoSize;
+
+	if( (IfId != STLINK_BRIDGE) || (pInfo == NULL) ) {
+		return SS_BAD_PARAMETER;
+	}
+
+	CSLocker locker(m_csList);
+
+	if( DevIdxInList >= m_nbEnumDevices ) {
+		return SS_BAD_PARAMETER;
+	}
+	if( InfoSize > sizeof(STLink_DeviceInfo2T) ) {
+		memset(pInfo, 0, InfoSize);
+		copySize = sizeof(STLink_DeviceInfo2T);
+		status = SS_TRUNCATED_DATA;
+	}
+	memcpy(pInfo, &m_enumDevices[DevIdxInList].Info, copySize);
+	return status;
+}
+/*
+ * @brief Open the bridge interface of an enumerated device and preallocate its transfers.
+ * The interface is claimed, so it can not be used by another process whatever bExclusiveAccess
+ * (libusb does not provide shared access between processes). Within the process, bExclusiveAccess
+ * is honoured: a device opened in shared mode (0) returns the same handle to the next shared
+ * OpenDevice() calls (commands serialized per handle, closed by the last CloseDevice()), and a
+ * device opened in exclusive mode can not be opened again until closed.
+ *
+ * @retval SS_BAD_PARAMETER Wrong IfId, DevIdxInList or NULL pHandle
+ * @retval SS_PERMISSION_ERR Device not accessible, already in use by another process, or opened
+ *                           in this process while one of the accesses is exclusive
+ * @retval SS_OK if successful, error otherwise
+ */
+uint32_t STLinkLibUsbTransport::OpenDevice(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+                                           uint8_t bExclusiveAccess, void **pHandle)
+{
+	STLinkLibUsbHandleT *pDevHandle;
+	EnumDeviceT *pEnumDev;
+	int ret;
+
+	if( (IfId != STLINK_BRIDGE) || (pHandle == NULL) ) {
+		return SS_BAD_PARAMETER;
+	}
+	*pHandle = NULL;
+
+	CSLocker locker(m_csList);
+
+	if( DevIdxInList >= m_nbEnumDevices ) {
+		return SS_BAD_PARAMETER;
+	}
+	pEnumDev = &m_enumDevices[DevIdxInList];
+
+	// Already opened in this process: shared if both accesses are shared
+	for( pDevHandle = m_pOpenedList; pDevHandle != NULL; pDevHandle = pDevHandle->pNext ) {
+		if( libusb_get_device(pDevHandle->pDevHandle) == pEnumDev->pDevice ) {
+			if( (bExclusiveAccess != 0) || (pDevHandle->bExclusive == true) ) {
+				return SS_PERMISSION_ERR;
+			}
+			pDevHandle->OpenNb++;
+			*pHandle = pDevHandle;
+			return SS_OK;
+		}
+	}
+
+	pDevHandle = new STLinkLibUsbHandleT;
+	memset(pDevHandle, 0, sizeof(STLinkLibUsbHandleT));
+	pDevHandle->OpenNb = 1;
+	pDevHandle->bExclusive = (bExclusiveAccess != 0);
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	InitializeCriticalSection(&pDevHandle->CsCommand);
+#else
+	pthread_mutex_init(&pDevHandle->CsCommand, NULL);
+#endif
+	pDevHandle->IfNb = pEnumDev->IfNb;
+	pDevHandle->EpOut = pEnumDev->EpOut;
+	pDevHandle->EpIn = pEnumDev->EpIn;
+	pDevHandle->EpIn2 = pEnumDev->EpIn2;
+
+	ret = libusb_open(pEnumDev->pDevice, &pDevHandle->pDevHandle);
+	if( ret != LIBUSB_SUCCESS ) {
+		pDevHandle->pDevHandle = NULL;
+		pDevHandle->pNext = m_pOpenedList;
+		m_pOpenedList = pDevHandle;
+		PrivCloseDevice(pDevHandle);
+		return ConvLibUsbErrToSs(ret);
+	}
+	// Not supported on all platforms, ignore the error
+	libusb_set_auto_detach_kernel_driver(pDevHandle->pDevHandle, 1);
+
+	ret = libusb_claim_interface(pDevHandle->pDevHandle, pDevHandle->IfNb);
+	if( ret != LIBUSB_SUCCESS ) {
+		libusb_close(pDevHandle->pDevHandle);
+		pDevHandle->pDevHandle = NULL;
+		pDevHandle->pNext = m_pOpenedList;
+		m_pOpenedList = pDevHandle;
+		PrivCloseDevice(pDevHandle);
+		return ConvLibUsbErrToSs(ret);
+	}
+
+	pDevHandle->pCmdTransfer = libusb_alloc_transfer(0);
+	pDevHandle->pDataTransfer = libusb_alloc_transfer(0);
+	if( (pDevHandle->pCmdTransfer == NULL) || (pDevHandle->pDataTransfer == NULL) ) {
+		pDevHandle->pNext = NULL;
+		m_pOpenedList = pDevHandle;
+		PrivCloseDevice(pDevHandle);
+		return SS_MEMORY_PROBLEM;
+	}
+
+	pDevHandle->pNext = m_pOpenedList;
+	m_pOpenedList = pDevHandle;
+	*pHandle = pDevHandle;
+	return SS_OK;
+}
+/*
+ * @brief Release the interface and free the handle (m_csList must be locked by the caller).
+ */
+void STLinkLibUsbTransport::PrivCloseDevice(STLinkLibUsbHandleT *pDevHandle)
+{
+	STLinkLibUsbHandleT **ppPrev = &m_pOpenedList;
+
+	// Remove from the opened list
+	while( *ppPrev != NULL ) {
+		if( *ppPrev == pDevHandle ) {
+			*ppPrev = pDevHandle->pNext;
+			break;
+		}
+		ppPrev = &((*ppPrev)->pNext);
+	}
+
+	if( pDevHandle->pCmdTransfer != NULL ) {
+		libusb_free_transfer(pDevHandle->pCmdTransfer);
+	}
+	if( pDevHandle->pDataTransfer != NULL ) {
+		libusb_free_transfer(pDevHandle->pDataTransfer);
+	}
+	if( pDevHandle->pDevHandle != NULL ) {
+		libusb_release_interface(pDevHandle->pDevHandle, pDevHandle->IfNb);
+		libusb_close(pDevHandle->pDevHandle);
+	}
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	DeleteCriticalSection(&pDevHandle->CsCommand);
+#else
+	pthread_mutex_destroy(&pDevHandle->CsCommand);
+#endif
+	delete pDevHandle;
+}
+/*
+ * @brief Close a device opened by STLinkLibUsbTransport::OpenDevice(): the interface is released
+ * by the last CloseDevice() of a shared handle.
+ *
+ * @retval SS_BAD_PARAMETER Unknown handle
+ * @retval SS_OK if successful
+ */
+uint32_t STLinkLibUsbTransport::CloseDevice(void *pHandle)
+{
+	STLinkLibUsbHandleT *pOpened;
+
+	CSLocker locker(m_csList);
+
+	for( pOpened = m_pOpenedList; pOpened != NULL; pOpened = pOpened->pNext ) {
+		if( pOpened == pHandle ) {
+			pOpened->OpenNb--;
+			if( pOpened->OpenNb == 0 ) {
+				PrivCloseDevice(pOpened);
+			}
+			return SS_OK;
+		}
+	}
+	return SS_BAD_PARAMETER;
+}
+/*
+ * @brief Send a command to the bridge interface: the CDB is sent on the bulk OUT endpoint,
+ * followed by the data stage (if any) on the endpoint selected by pRequest->InputRequest.
+ * Both transfers are submitted at once so that the data stage is queued in the host
+ * controller before the firmware answers; the calling thread then waits for their completion.
+ * Commands to different handles can be sent concurrently from different threads; commands
+ * to the same handle (shared access) are serialized by the handle lock.
+ *
+ * @retval SS_BAD_PARAMETER NULL pointer or inconsistent request
+ * @retval SS_TIMEOUT Transfer not completed within TimeoutMs
+ * @retval SS_TRUNCATED_DATA Data stage shorter than BufferLength
+ * @retval SS_OK if successful, error otherwise
+ */
+uint32_t STLinkLibUsbTransport::SendCommand(void *pHandle, STLink_DeviceRequestT *pRequest, uint32_t TimeoutMs)
+{
+	STLinkLibUsbHandleT *pDevHandle = (STLinkLibUsbHandleT*)pHandle;
+	int cmdCompleted = 0, dataCompleted = 1;
+	int cmdLength = STLINK_CMD_SIZE_16;
+	uint8_t dataEp;
+	uint32_t status;
+	int ret;
+
+	if( (pDevHandle == NULL) || (pRequest == NULL) ) {
+		return SS_BAD_PARAMETER;
+	}
+	if( (pRequest->BufferLength != 0) && (pRequest->Buffer == NULL) ) {
+		return SS_BAD_PARAMETER;
+	}
+	if( (pRequest->CDBLength != 0) && (pRequest->CDBLength < STLINK_CMD_SIZE_16) ) {
+		cmdLength = pRequest->CDBLength;
+	}
+
+	if( pRequest->InputRequest == REQUEST_WRITE_1ST_EPOUT ) {
+		dataEp = pDevHandle->EpOut;
+	} else if( pRequest->InputRequest == REQUEST_READ_DATA_2ND_EPIN ) {
+		dataEp = pDevHandle->EpIn2;
+		if( dataEp == 0 ) {
+			return SS_BAD_PARAMETER;
+		}
+	} else {
+		dataEp = pDevHandle->EpIn;
+	}
+
+	CSLocker locker(pDevHandle->CsCommand);
+
+	libusb_fill_bulk_transfer(pDevHandle->pCmdTransfer, pDevHandle->pDevHandle, pDevHandle->EpOut,
+	                          pRequest->CDBByte, cmdLength, TransferDoneCb, &cmdCompleted, TimeoutMs);
+	ret = libusb_submit_transfer(pDevHandle->pCmdTransfer);
+	if( ret != LIBUSB_SUCCESS ) {
+		return ConvLibUsbErrToSs(ret);
+	}
+
+	if( pRequest->BufferLength != 0 ) {
+		libusb_fill_bulk_transfer(pDevHandle->pDataTransfer, pDevHandle->pDevHandle, dataEp,
+		                          (unsigned char*)pRequest->Buffer, (int)pRequest->BufferLength,
+		                          TransferDoneCb, &dataCompleted, TimeoutMs);
+		dataCompleted = 0;
+		ret = libusb_submit_transfer(pDevHandle->pDataTransfer);
+		if( ret != LIBUSB_SUCCESS ) {
+			dataCompleted = 1;
+			libusb_cancel_transfer(pDevHandle->pCmdTransfer);
+			WaitTransfer(m_pCtx, pDevHandle->pCmdTransfer, &cmdCompleted);
+			return ConvLibUsbErrToSs(ret);
+		}
+	}
+
+	WaitTransfer(m_pCtx, pDevHandle->pCmdTransfer, &cmdCompleted);
+	status = ConvTransferStatusToSs(pDevHandle->pCmdTransfer);
+
+	if( dataCompleted == 0 ) {
+		if( status != SS_OK ) {
+			// Command not sent: no data stage to expect
+			libusb_cancel_transfer(pDevHandle->pDataTransfer);
+			WaitTransfer(m_pCtx, pDevHandle->pDataTransfer, &dataCompleted);
+		} else {
+			WaitTransfer(m_pCtx, pDevHandle->pDataTransfer, &dataCompleted);
+			status = ConvTransferStatusToSs(pDevHandle->pDataTransfer);
+		}
+	}
+	return status;
+}
+#endif // USING_LIBUSB
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
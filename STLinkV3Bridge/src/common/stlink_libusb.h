@@ -0,0 +1,101 @@
+/**
+  ******************************************************************************
+  * @file    stlink_libusb.h
+  * @author  MCD Application Team
+  * @brief   Header for stlink_libusb.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup INTERFACE
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _STLINK_LIBUSB_H
+#define _STLINK_LIBUSB_H
+/* Includes ------------------------------------------------------------------*/
+#include "stlink_transport.h"
+
+#ifdef USING_LIBUSB
+#include "criticalsectionlock.h"
+#include <libusb.h>
+
+/* Exported types and constants ----------------------------------------------*/
+/// Max number of STLink devices kept in the enumeration list (same limit as STLinkUSBDriver)
+#define STLINK_LIBUSB_MAX_DEVICES 60
+
+/// Opened device handle, returned as void* by STLinkLibUsbTransport::OpenDevice()
+typedef struct STLinkLibUsbHandle STLinkLibUsbHandleT;
+
+/* Class -------------------------------------------------------------------- */
+/// STLinkLibUsbTransport Class: native libusb-1.0 transport, reaching directly the
+/// bridge interface of the STLINK-V3 (#STLINK_USB_BRIDGE_IF_NB or #STLINK_USB_BRIDGE_IF_NB_NO_MSD)
+/// without the STLinkUSBDriver library.
+class STLinkLibUsbTransport : public STLinkTransport
+{
+public:
+
+	STLinkLibUsbTransport(void);
+
+	virtual ~STLinkLibUsbTransport(void);
+
+	uint32_t Init(void);
+
+	virtual uint32_t Reenumerate(STLink_EnumStlinkInterfaceT IfId, uint8_t bClearList);
+
+	virtual uint32_t GetNbDevices(STLink_EnumStlinkInterfaceT IfId);
+
+	virtual uint32_t GetDeviceInfo2(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+	                                STLink_DeviceInfo2T *pInfo, uint32_t InfoSize);
+
+	virtual uint32_t OpenDevice(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+	                            uint8_t bExclusiveAccess, void **pHandle);
+
+	virtual uint32_t CloseDevice(void *pHandle);
+
+	virtual uint32_t SendCommand(void *pHandle, STLink_DeviceRequestT *pRequest, uint32_t TimeoutMs);
+
+private:
+
+	/// Enumerated STLink bridge interface
+	typedef struct {
+		libusb_device *pDevice;   ///< Referenced libusb device
+		STLink_DeviceInfo2T Info; ///< Information returned by GetDeviceInfo2()
+		uint8_t IfNb;             ///< Bridge interface number
+		uint8_t EpOut;            ///< Bulk OUT endpoint (command and write data)
+		uint8_t EpIn;             ///< 1st bulk IN endpoint (read data)
+		uint8_t EpIn2;            ///< 2nd bulk IN endpoint (0 if none)
+	} EnumDeviceT;
+
+	void FreeEnumList(void);
+
+	bool GetBridgeInterface(libusb_device *pDevice, EnumDeviceT *pEnumDev);
+
+	void PrivCloseDevice(STLinkLibUsbHandleT *pDevHandle);
+
+	libusb_context *m_pCtx;
+
+	EnumDeviceT m_enumDevices[STLINK_LIBUSB_MAX_DEVICES];
+	uint32_t m_nbEnumDevices;
+
+	// List of opened devices
+	STLinkLibUsbHandleT *m_pOpenedList;
+
+	// Protect the enumeration and opened devices lists
+	CriticalSection_ObjectT m_csList;
+};
+#endif // USING_LIBUSB
+
+#endif //_STLINK_LIBUSB_H
+// end group INTERFACE
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
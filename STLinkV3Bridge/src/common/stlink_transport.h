@@ -0,0 +1,65 @@
+/**
+  ******************************************************************************
+  * @file    stlink_transport.h
+  * @author  MCD Application Team
+  * @brief   Transport abstraction used by STLinkInterface to reach STLink devices
+  *          (STLinkUSBDriver library, native libusb backend, simulator ...).
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup INTERFACE
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _STLINK_TRANSPORT_H
+#define _STLINK_TRANSPORT_H
+/* Includes ------------------------------------------------------------------*/
+#include "STLinkUSBDriver.h"
+
+/* Class -------------------------------------------------------------------- */
+/// STLinkTransport Class: low level access to the STLink devices.\n
+/// The routines have the same semantic and return the same SS_xxx codes as the
+/// routines of the STLinkUSBDriver library (see STLinkUSBDriver.h), so that
+/// STLinkInterface does not depend on the way devices are reached.
+class STLinkTransport
+{
+public:
+
+	virtual ~STLinkTransport(void) {}
+
+	/// Build the list of connected devices providing the given interface (see STLink_Reenumerate).
+	virtual uint32_t Reenumerate(STLink_EnumStlinkInterfaceT IfId, uint8_t bClearList) = 0;
+
+	/// Number of devices found by the last Reenumerate() (see STLink_GetNbDevices).
+	virtual uint32_t GetNbDevices(STLink_EnumStlinkInterfaceT IfId) = 0;
+
+	/// Information on an enumerated device (see STLink_GetDeviceInfo2).
+	virtual uint32_t GetDeviceInfo2(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+	                                STLink_DeviceInfo2T *pInfo, uint32_t InfoSize) = 0;
+
+	/// Open an enumerated device (see STLink_OpenDevice).
+	virtual uint32_t OpenDevice(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+	                            uint8_t bExclusiveAccess, void **pHandle) = 0;
+
+	/// Close a device opened with OpenDevice() (see STLink_CloseDevice).
+	virtual uint32_t CloseDevice(void *pHandle) = 0;
+
+	/// Send a command to an opened device and wait for its completion (see STLink_SendCommand).
+	/// Can be called concurrently for different handles.
+	virtual uint32_t SendCommand(void *pHandle, STLink_DeviceRequestT *pRequest, uint32_t TimeoutMs) = 0;
+};
+
+#endif //_STLINK_TRANSPORT_H
+// end group INTERFACE
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
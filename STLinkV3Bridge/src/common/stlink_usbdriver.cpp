@@ -0,0 +1,223 @@
+/**
+  ******************************************************************************
+  * @file    stlink_usbdriver.cpp
+  * @author  MCD Application Team
+  * @brief   STLinkTransport implementation on top of the STLinkUSBDriver library
+  *          (STLinkUSBDriver.h): STLinkUSBDriver.dll on Windows,
+  *          libSTLinkUSBDriver.so on Linux when USING_LIBUSB is not defined.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "stlink_usbdriver.h"
+
+#ifdef USING_STLINK_USBDRIVER
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+#include "shlwapi.h"
+#endif // WIN32
+/* Private typedef -----------------------------------------------------------*/
+/* Private defines -----------------------------------------------------------*/
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Global variables ----------------------------------------------------------*/
+/* Class Functions Definition ------------------------------------------------*/
+
+/*
+ * @brief STLinkUsbDriverTransport constructor
+ */
+STLinkUsbDriverTransport::STLinkUsbDriverTransport(void)
+{
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	m_hMod = NULL;
+	STLink_Reenumerate    = NULL;
+	STLink_GetNbDevices   = NULL;
+	STLink_GetDeviceInfo2 = NULL;
+	STLink_OpenDevice     = NULL;
+	STLink_CloseDevice    = NULL;
+	STLink_SendCommand    = NULL;
+#endif
+}
+/*
+ * @brief STLinkUsbDriverTransport destructor: free the STLinkUSBDriver library.
+ */
+STLinkUsbDriverTransport::~STLinkUsbDriverTransport(void)
+{
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	if( m_hMod != NULL )
+	{
+		if( FreeLibrary(m_hMod) != 0 )
+		{
+			// Successful
+			m_hMod = NULL;
+		}
+	}
+#else
+	::STLink_FreeLibrary();
+#endif // WIN32
+}
+/*
+ * @brief Load the STLinkUSBDriver library (windows only) and get the required API.
+ *
+ * @param[in]  pPathOfProcess  Path, in ASCII, where STLinkUSBDriver library is searched
+ *                             when not found in current dir. Can be NULL.
+ *
+ * @retval false if the library or one of the required routines is not found
+ * @retval true  otherwise
+ */
+bool STLinkUsbDriverTransport::Load(const char *pPathOfProcess)
+{
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	if( m_hMod == NULL ) {
+		// First try from this DLL path
+		if( pPathOfProcess != NULL ) {
+			char szDllPath[_MAX_PATH];
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1400) /* VC8+ (VS2005) */
+			::strncpy_s(szDllPath, _MAX_PATH, pPathOfProcess, _MAX_PATH);
+#else
+			::strncpy(szDllPath, pPathOfProcess, _MAX_PATH);
+#endif
+			// Note: Unicode is not supported (would require T_CHAR szDllPath, to include <tchar.h>
+			// and to use generic function PathAppend(szDllPath, _T("STLinkUSBDriver.dll"))
+			::PathAppendA(szDllPath, "STLinkUSBDriver.dll");
+
+			m_hMod = LoadLibraryA(szDllPath);
+		}
+	}
+
+	if( m_hMod == NULL ) {
+		// Second try using the whole procedure for path resolution (including PATH environment variable)
+		m_hMod = LoadLibraryA("STLinkUSBDriver.dll");
+	}
+
+	if( m_hMod == NULL ) {
+		return false;
+	}
+
+	// Get the needed API
+	STLink_Reenumerate    = (pSTLink_Reenumerate)   GetProcAddress(m_hMod, ("STLink_Reenumerate"));
+	STLink_GetNbDevices   = (pSTLink_GetNbDevices)  GetProcAddress(m_hMod, ("STLink_GetNbDevices"));
+	STLink_GetDeviceInfo2 = (pSTLink_GetDeviceInfo2)GetProcAddress(m_hMod, ("STLink_GetDeviceInfo2"));
+	STLink_OpenDevice     = (pSTLink_OpenDevice)    GetProcAddress(m_hMod, ("STLink_OpenDevice"));
+	STLink_CloseDevice    = (pSTLink_CloseDevice)   GetProcAddress(m_hMod, ("STLink_CloseDevice"));
+	STLink_SendCommand    = (pSTLink_SendCommand)   GetProcAddress(m_hMod, ("STLink_SendCommand"));
+
+	// Check if DLL supports at least required function, this is mandatory but not enough for BRIDGE support
+	// STLink_Reenumerate will return SS_BAD_PARAMETER if DLL is too old and Bridge interface is not supported.
+	if( (STLink_Reenumerate == NULL) || (STLink_GetNbDevices == NULL)
+		|| (STLink_GetDeviceInfo2 == NULL) || (STLink_OpenDevice == NULL) || (STLink_CloseDevice == NULL)
+		|| (STLink_SendCommand == NULL) ) {
+		return false;
+	}
+#else // !WIN32
+	// nothing to do: libSTLinkUSBDriver.so is linked with the application
+	(void)pPathOfProcess;
+#endif
+	return true;
+}
+
+uint32_t STLinkUsbDriverTransport::Reenumerate(STLink_EnumStlinkInterfaceT IfId, uint8_t bClearList)
+{
+	return STLink_Reenumerate(IfId, bClearList);
+}
+
+uint32_t STLinkUsbDriverTransport::GetNbDevices(STLink_EnumStlinkInterfaceT IfId)
+{
+	return STLink_GetNbDevices(IfId);
+}
+
+uint32_t STLinkUsbDriverTransport::GetDeviceInfo2(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+                                                  STLink_DeviceInfo2T *pInfo, uint32_t InfoSize)
+{
+	return STLink_GetDeviceInfo2(IfId, DevIdxInList, pInfo, InfoSize);
+}
+
+/*
+ * @brief Open a device with STLink_OpenDevice(): the returned handle (STLinkUsbDriverHandleT) holds
+ * the STLinkUSBDriver handle and the lock of its commands.
+ *
+ * @retval SS_BAD_PARAMETER NULL pHandle
+ * @retval SS_OK if successful, STLink_OpenDevice() error otherwise
+ */
+uint32_t STLinkUsbDriverTransport::OpenDevice(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+                                              uint8_t bExclusiveAccess, void **pHandle)
+{
+	STLinkUsbDriverHandleT *pDevHandle;
+	void *pDrvHandle = NULL;
+	uint32_t status;
+
+	if( pHandle == NULL ) {
+		return SS_BAD_PARAMETER;
+	}
+	*pHandle = NULL;
+	status = STLink_OpenDevice(IfId, DevIdxInList, bExclusiveAccess, &pDrvHandle);
+	if( status != SS_OK ) {
+		return status;
+	}
+	pDevHandle = new STLinkUsbDriverHandleT;
+	pDevHandle->pDrvHandle = pDrvHandle;
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	InitializeCriticalSection(&pDevHandle->CsCommand);
+#else
+	pthread_mutex_init(&pDevHandle->CsCommand, NULL);
+#endif
+	*pHandle = pDevHandle;
+	return SS_OK;
+}
+/*
+ * @brief Close a device opened by STLinkUsbDriverTransport::OpenDevice() and free its handle.
+ *
+ * @retval SS_BAD_PARAMETER NULL pHandle
+ * @retval SS_OK if successful, STLink_CloseDevice() error otherwise
+ */
+uint32_t STLinkUsbDriverTransport::CloseDevice(void *pHandle)
+{
+	STLinkUsbDriverHandleT *pDevHandle = (STLinkUsbDriverHandleT*)pHandle;
+	uint32_t status;
+
+	if( pDevHandle == NULL ) {
+		return SS_BAD_PARAMETER;
+	}
+	status = STLink_CloseDevice(pDevHandle->pDrvHandle);
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	DeleteCriticalSection(&pDevHandle->CsCommand);
+#else
+	pthread_mutex_destroy(&pDevHandle->CsCommand);
+#endif
+	delete pDevHandle;
+	return status;
+}
+/*
+ * @brief Send a command with STLink_SendCommand(). The commands are serialized per handle only:
+ * each STLinkUSBDriver handle owns its USB pipes, so that different devices are driven concurrently.
+ *
+ * @retval SS_BAD_PARAMETER NULL pHandle
+ * @retval SS_OK if successful, STLink_SendCommand() error otherwise
+ */
+uint32_t STLinkUsbDriverTransport::SendCommand(void *pHandle, STLink_DeviceRequestT *pRequest, uint32_t TimeoutMs)
+{
+	STLinkUsbDriverHandleT *pDevHandle = (STLinkUsbDriverHandleT*)pHandle;
+
+	if( pDevHandle == NULL ) {
+		return SS_BAD_PARAMETER;
+	}
+	CSLocker locker(pDevHandle->CsCommand);
+
+	return STLink_SendCommand(pDevHandle->pDrvHandle, pRequest, TimeoutMs);
+}
+#endif // USING_STLINK_USBDRIVER
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,91 @@
+/**
+  ******************************************************************************
+  * @file    stlink_usbdriver.h
+  * @author  MCD Application Team
+  * @brief   Header for stlink_usbdriver.cpp module
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup INTERFACE
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _STLINK_USBDRIVER_H
+#define _STLINK_USBDRIVER_H
+/* Includes ------------------------------------------------------------------*/
+#include "stlink_transport.h"
+
+// The STLinkUSBDriver library is used on Windows, and on other platforms
+// when the native libusb backend is not selected (USING_LIBUSB).
+#if defined(WIN32) || !defined(USING_LIBUSB)
+#define USING_STLINK_USBDRIVER
+#endif
+
+#ifdef USING_STLINK_USBDRIVER
+#include "criticalsectionlock.h"
+
+/* Exported types and constants ----------------------------------------------*/
+/// Opened device, returned as void* by STLinkUsbDriverTransport::OpenDevice(): STLinkUSBDriver
+/// handle and the lock serializing its commands
+typedef struct {
+	void *pDrvHandle;
+	CriticalSection_ObjectT CsCommand;
+} STLinkUsbDriverHandleT;
+
+/* Class -------------------------------------------------------------------- */
+/// STLinkUsbDriverTransport Class: transport through the STLinkUSBDriver library
+/// (STLinkUSBDriver.dll loaded at run time on Windows, libSTLinkUSBDriver.so linked otherwise).
+class STLinkUsbDriverTransport : public STLinkTransport
+{
+public:
+
+	STLinkUsbDriverTransport(void);
+
+	virtual ~STLinkUsbDriverTransport(void);
+
+	bool Load(const char *pPathOfProcess);
+
+	virtual uint32_t Reenumerate(STLink_EnumStlinkInterfaceT IfId, uint8_t bClearList);
+
+	virtual uint32_t GetNbDevices(STLink_EnumStlinkInterfaceT IfId);
+
+	virtual uint32_t GetDeviceInfo2(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+	                                STLink_DeviceInfo2T *pInfo, uint32_t InfoSize);
+
+	virtual uint32_t OpenDevice(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+	                            uint8_t bExclusiveAccess, void **pHandle);
+
+	virtual uint32_t CloseDevice(void *pHandle);
+
+	virtual uint32_t SendCommand(void *pHandle, STLink_DeviceRequestT *pRequest, uint32_t TimeoutMs);
+
+private:
+
+#ifdef WIN32 //Defined for applications for Win32 and Win64.
+	// New API of STLinkUSBDriver.dll; should be used if available
+	pSTLink_Reenumerate     STLink_Reenumerate;
+	pSTLink_GetNbDevices    STLink_GetNbDevices;
+	pSTLink_GetDeviceInfo2  STLink_GetDeviceInfo2;
+	pSTLink_OpenDevice      STLink_OpenDevice;
+	pSTLink_CloseDevice     STLink_CloseDevice;
+	pSTLink_SendCommand     STLink_SendCommand;
+
+	HMODULE  m_hMod;
+#endif
+};
+#endif // USING_STLINK_USBDRIVER
+
+#endif //_STLINK_USBDRIVER_H
+// end group INTERFACE
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
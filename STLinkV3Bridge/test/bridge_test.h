@@ -0,0 +1,115 @@
+/**
+  ******************************************************************************
+  * @file    bridge_test.h
+  * @author  MCD Application Team
+  * @brief   Header of the STLINK-V3-BRIDGE library test program: checks,
+  *          simulator setup and test suites.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BRIDGE_TEST_H
+#define _BRIDGE_TEST_H
+/* Includes ------------------------------------------------------------------*/
+#include "bridge.h"
+#include "bridge_sim.h"
+
+#include <stdio.h>
+
+/* Exported types and constants ----------------------------------------------*/
+/// Test suite: checks run by default, benchmark run with --bench (NULL if none)
+typedef struct {
+	const char *pName;
+	void (*pTest)(void);
+	void (*pBench)(void);
+} BrgTestSuiteT;
+
+/* Exported macros -----------------------------------------------------------*/
+/// Count and print a failed check, the test goes on
+#define BRG_TEST_CHECK(cond) \
+	do { \
+		if( !(cond) ) { \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			g_brgTestFailNb++; \
+		} \
+	} while( 0 )
+
+/* Exported variables --------------------------------------------------------*/
+/// Number of failed checks since the program start
+extern int g_brgTestFailNb;
+
+/* Exported functions --------------------------------------------------------*/
+uint64_t BrgTestSimTimeNs(BrgSimTransport &Sim, int DevIdx);
+Brg_StatusT BrgTestInitI2C(Brg &BrgDevice, I2cModeT Mode, int SpeedKHz);
+Brg_StatusT BrgTestRefI2cTimingReg(I2cModeT I2CSpeedMode, int SpeedFrequency, double ClockSource, int DNFn,
+                                   int RiseTime, int FallTime, bool bAF, uint32_t *pTimingReg);
+
+/* Class -------------------------------------------------------------------- */
+/// BrgTestBench Class: simulated bridges (BrgSimTransport) and the STLinkInterface using them, the Brg
+/// of each device being opened by the test (Brg::OpenStlink(DevIdx)).
+class BrgTestBench
+{
+public:
+	BrgTestBench(bool bRealTime, uint8_t NbDevices=1)
+		: m_itf(STLINK_BRIDGE) {
+		BrgSimConfT conf;
+		BrgSimTransport::GetDefaultConf(&conf);
+		conf.bRealTime = bRealTime;
+		conf.NbDevices = NbDevices;
+		m_sim.SetConf(&conf);
+		m_itf.SetTransport(&m_sim);
+		m_itf.LoadStlinkLibrary(NULL);
+	}
+
+	BrgSimTransport m_sim;
+	STLinkInterface m_itf;
+};
+
+/* Test suites (one file each) -----------------------------------------------*/
+void TestAlloc(void);
+void TestAsync(void);
+void TestBatch(void);
+void TestGather(void);
+void TestCmdStats(void);
+void BenchCmdStats(void);
+void TestI2cTiming(void);
+void BenchI2cTiming(void);
+void TestI2cEeprom(void);
+void BenchI2cEeprom(void);
+void TestI2cWriteRead(void);
+void BenchI2cWriteRead(void);
+void TestSpiFlash(void);
+void BenchSpiFlash(void);
+void TestCanCapture(void);
+void BenchCanCapture(void);
+void TestCanIsoTp(void);
+void BenchCanIsoTp(void);
+void TestDeviceLock(void);
+void BenchDeviceLock(void);
+void TestSpiStream(void);
+void BenchSpiStream(void);
+void TestI2cPipeline(void);
+void TestSpscRing(void);
+void TestCanRx(void);
+void TestCanTx(void);
+void TestCanFilter(void);
+void BenchCanFilter(void);
+void TestCanSoftFilter(void);
+void BenchCanSoftFilter(void);
+
+#endif //_BRIDGE_TEST_H
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,42 @@
+QT -= gui core
+
+TARGET = bridge_test
+
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+# Test program of the STLINK-V3-BRIDGE library: the library sources are built
+# in, the suites run on the bridge simulator (BrgSimTransport), no STLink needed.
+# Run "bridge_test" for the checks, "bridge_test --bench" for the benchmarks too.
+include(../STLinkV3Bridge.pri)
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    test_main.cpp \
+    test_alloc.cpp \
+    test_async.cpp \
+    test_batch.cpp \
+    test_gather.cpp \
+    test_cmd_stats.cpp \
+    test_i2c_timing.cpp \
+    i2c_timing_ref.cpp \
+    test_i2c_eeprom.cpp \
+    test_i2c_write_read.cpp \
+    test_spi_flash.cpp \
+    test_can_capture.cpp \
+    test_can_isotp.cpp \
+    test_device_lock.cpp \
+    test_spi_stream.cpp \
+    test_i2c_pipeline.cpp \
+    test_spsc_ring.cpp \
+    test_can_rx.cpp \
+    test_can_tx.cpp \
+    test_can_filter.cpp \
+    test_can_soft_filter.cpp
+
+HEADERS += \
+    bridge_test.h
+
+unix: LIBS += -lpthread
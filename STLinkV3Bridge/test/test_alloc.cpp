@@ -0,0 +1,171 @@
+/**
+  ******************************************************************************
+  * @file    test_alloc.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "alloc": no heap allocation in the Brg command path
+  *          once the device is opened and initialized.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+
+/* Private variables ---------------------------------------------------------*/
+// Number of operator new calls of the program (all the test program allocations are counted)
+static std::atomic<long> s_allocNb(0);
+
+/* Global operators ----------------------------------------------------------*/
+void *operator new(size_t Size)
+{
+	void *p;
+
+	s_allocNb++;
+	p = malloc((Size != 0) ? Size : 1);
+	if( p == NULL ) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void *operator new[](size_t Size)
+{
+	return operator new(Size);
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+
+/*
+ * private: I2C, SPI, GPIO and CAN commands of Brg on device 0, CAN messages received by BrgRx on device 1
+ */
+static void RunCommands(Brg &BrgTx, Brg &BrgRx)
+{
+	uint8_t data[64];
+	uint16_t sizeRw;
+	uint16_t rxNb;
+	uint16_t dataSize;
+	uint8_t gpioErr;
+	Brg_GpioValT gpioVals[BRG_GPIO_MAX_NB];
+	Brg_CanTxMsgT txMsg;
+	Brg_CanRxMsgT rxMsgs[4];
+	int i;
+
+	memset(data, 0, sizeof(data));
+	txMsg.IDE = CAN_ID_STANDARD;
+	txMsg.ID = 0x12;
+	txMsg.RTR = CAN_DATA_FRAME;
+	txMsg.DLC = 0;
+	for( i = 0; i < 20; i++ ) {
+		BRG_TEST_CHECK(BrgTx.WriteI2C(data, 0x50, 16, &sizeRw) == BRG_NO_ERR);
+		BRG_TEST_CHECK(BrgTx.ReadI2C(data, 0x50, 16, &sizeRw) == BRG_NO_ERR);
+		BRG_TEST_CHECK(BrgTx.WriteSPI(data, 32, &sizeRw) == BRG_NO_ERR);
+		BRG_TEST_CHECK(BrgTx.ReadSPI(data, 32, &sizeRw) == BRG_NO_ERR);
+		BRG_TEST_CHECK(BrgTx.ReadGPIO(BRG_GPIO_ALL, gpioVals, &gpioErr) == BRG_NO_ERR);
+		BRG_TEST_CHECK(BrgTx.SetResetGPIO(BRG_GPIO_ALL, gpioVals, &gpioErr) == BRG_NO_ERR);
+		BRG_TEST_CHECK(BrgTx.WriteMsgCAN(&txMsg, data, 8) == BRG_NO_ERR);
+		BRG_TEST_CHECK(BrgRx.GetRxMsgNbCAN(&rxNb) == BRG_NO_ERR);
+		if( rxNb > 4 ) {
+			rxNb = 4;
+		}
+		if( rxNb != 0 ) {
+			BRG_TEST_CHECK(BrgRx.GetRxMsgCAN(rxMsgs, rxNb, data, sizeof(data), &dataSize) == BRG_NO_ERR);
+		}
+	}
+}
+
+/**
+ * @ingroup TEST
+ * @brief Allocations counted around a second run of the same commands: the first run allocates what is
+ *        kept (per device buffers), the second one must not allocate.
+ */
+void TestAlloc(void)
+{
+	BrgTestBench bench(false, 2);
+	BrgSimI2cMemSlave eeprom(256, 1);
+	Brg brgTx(bench.m_itf);
+	Brg brgRx(bench.m_itf);
+	Brg_SpiInitT spiInit;
+	Brg_GpioConfT gpioConf;
+	Brg_GpioInitT gpioInit;
+	Brg_CanInitT canInit;
+	Brg_CanFilterConfT filterConf;
+	long allocNb;
+
+	bench.m_sim.AttachI2cSlave(0, 0x50, &eeprom);
+	BRG_TEST_CHECK(brgTx.OpenStlink(0) == BRG_NO_ERR);
+	BRG_TEST_CHECK(brgRx.OpenStlink(1) == BRG_NO_ERR);
+	BRG_TEST_CHECK(BrgTestInitI2C(brgTx, I2C_FAST, 400) == BRG_NO_ERR);
+
+	memset(&spiInit, 0, sizeof(spiInit));
+	spiInit.Baudrate = SPI_BAUDRATEPRESCALER_16;
+	BRG_TEST_CHECK(brgTx.InitSPI(&spiInit) == BRG_NO_ERR);
+
+	gpioConf.Mode = GPIO_MODE_OUTPUT;
+	gpioConf.Speed = GPIO_SPEED_LOW;
+	gpioConf.Pull = GPIO_NO_PULL;
+	gpioConf.OutputType = GPIO_OUTPUT_PUSHPULL;
+	gpioInit.GpioMask = BRG_GPIO_ALL;
+	gpioInit.ConfigNb = 1;
+	gpioInit.pGpioConf = &gpioConf;
+	BRG_TEST_CHECK(brgTx.InitGPIO(&gpioInit) == BRG_NO_ERR);
+
+	memset(&canInit, 0, sizeof(canInit));
+	canInit.BitTimeConf.PropSegInTq = 1;
+	canInit.BitTimeConf.PhaseSeg1InTq = 4;
+	canInit.BitTimeConf.PhaseSeg2InTq = 2;
+	canInit.BitTimeConf.SjwInTq = 1;
+	canInit.Prescaler = 48;
+	BRG_TEST_CHECK(brgTx.InitCAN(&canInit, BRG_INIT_FULL) == BRG_NO_ERR);
+	BRG_TEST_CHECK(brgRx.InitCAN(&canInit, BRG_INIT_FULL) == BRG_NO_ERR);
+	memset(&filterConf, 0, sizeof(filterConf));
+	filterConf.bIsFilterEn = true;
+	filterConf.FilterMode = CAN_FILTER_ID_MASK;
+	filterConf.FilterScale = CAN_FILTER_32BIT;
+	BRG_TEST_CHECK(brgRx.InitFilterCAN(&filterConf) == BRG_NO_ERR);
+	BRG_TEST_CHECK(brgRx.StartMsgReceptionCAN() == BRG_NO_ERR);
+
+	RunCommands(brgTx, brgRx);
+	allocNb = s_allocNb;
+	RunCommands(brgTx, brgRx);
+	allocNb = s_allocNb - allocNb;
+	printf("allocations in steady state: %ld\n", allocNb);
+	BRG_TEST_CHECK(allocNb == 0);
+
+	brgRx.CloseBridge(COM_UNDEF_ALL);
+	brgTx.CloseBridge(COM_UNDEF_ALL);
+	brgRx.CloseStlink();
+	brgTx.CloseStlink();
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,132 @@
+/**
+  ******************************************************************************
+  * @file    test_async.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "async": BrgAsync queue order, results and completion
+  *          callbacks.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+#include "bridge_async.h"
+
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_ASYNC_OP_NB 64
+
+/* Private variables ---------------------------------------------------------*/
+// Filled by the completion callback (worker thread, read once the BrgAsync is stopped)
+static uint32_t s_cbOpIds[TEST_ASYNC_OP_NB];
+static uint32_t s_cbNb;
+static uint32_t s_cbNotDoneNb;
+
+/*
+ * private: completion callback, pUserData is the BrgAsync: the operation must already be completed
+ */
+static void OnOpDone(Brg_AsyncOpT *pOp)
+{
+	BrgAsync *pAsync = (BrgAsync *)pOp->pUserData;
+
+	if( pAsync->IsDone(pOp) == false ) {
+		s_cbNotDoneNb++;
+	}
+	if( s_cbNb < TEST_ASYNC_OP_NB ) {
+		s_cbOpIds[s_cbNb] = pOp->OpId;
+	}
+	s_cbNb++;
+}
+
+/**
+ * @ingroup TEST
+ * @brief Writes then reads of an I2C memory through the queue: submission order, data, first error
+ *        of Flush(), callbacks called in order once their operation is completed.
+ */
+void TestAsync(void)
+{
+	BrgTestBench bench(false);
+	BrgSimI2cMemSlave mem(256, 1);
+	Brg brg(bench.m_itf);
+	BrgAsync brgAsync(brg);
+	Brg_AsyncOpT ops[TEST_ASYNC_OP_NB];
+	uint8_t dataOut[TEST_ASYNC_OP_NB/2][5];
+	uint8_t dataIn[TEST_ASYNC_OP_NB/2][4];
+	int i, k;
+
+	bench.m_sim.AttachI2cSlave(0, 0x50, &mem);
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+	BRG_TEST_CHECK(BrgTestInitI2C(brg, I2C_FAST_PLUS, 1000) == BRG_NO_ERR);
+
+	BRG_TEST_CHECK(brgAsync.SubmitWriteI2C(&ops[0], dataOut[0], 0x50, I2C_ADDR_7BIT, 5) == BRG_COM_CMD_ORDER_ERR);
+	BRG_TEST_CHECK(brgAsync.Start() == BRG_NO_ERR);
+
+	// Writes with callback
+	s_cbNb = 0;
+	s_cbNotDoneNb = 0;
+	for( i = 0; i < TEST_ASYNC_OP_NB/2; i++ ) {
+		dataOut[i][0] = (uint8_t)(i*4);
+		for( k = 0; k < 4; k++ ) {
+			dataOut[i][1+k] = (uint8_t)(i*10 + k);
+		}
+		BRG_TEST_CHECK(brgAsync.SubmitWriteI2C(&ops[i], dataOut[i], 0x50, I2C_ADDR_7BIT, 5,
+		                                       OnOpDone, &brgAsync) == BRG_NO_ERR);
+	}
+	for( i = 0; i < TEST_ASYNC_OP_NB/2; i++ ) {
+		BRG_TEST_CHECK(brgAsync.SubmitWriteI2C(&ops[TEST_ASYNC_OP_NB/2 + i], dataOut[i], 0x50, I2C_ADDR_7BIT, 1,
+		                                       OnOpDone, &brgAsync) == BRG_NO_ERR);
+	}
+	BRG_TEST_CHECK(brgAsync.Flush() == BRG_NO_ERR);
+	BRG_TEST_CHECK(brgAsync.GetPendingNb() == 0);
+	// Flush() may return before the last callback: Stop() waits for the worker
+	brgAsync.Stop();
+	BRG_TEST_CHECK(s_cbNb == TEST_ASYNC_OP_NB);
+	BRG_TEST_CHECK(s_cbNotDoneNb == 0);
+	for( i = 0; i < TEST_ASYNC_OP_NB; i++ ) {
+		BRG_TEST_CHECK(s_cbOpIds[i] == (uint32_t)(i + 1));
+	}
+
+	// Register pointer write then read, in order
+	BRG_TEST_CHECK(brgAsync.Start() == BRG_NO_ERR);
+	for( i = 0; i < TEST_ASYNC_OP_NB/2; i++ ) {
+		BRG_TEST_CHECK(brgAsync.SubmitWriteI2C(&ops[i], dataOut[i], 0x50, I2C_ADDR_7BIT, 1) == BRG_NO_ERR);
+		BRG_TEST_CHECK(brgAsync.SubmitReadI2C(&ops[TEST_ASYNC_OP_NB/2 + i], dataIn[i], 0x50, I2C_ADDR_7BIT, 4)
+		               == BRG_NO_ERR);
+	}
+	for( i = 0; i < TEST_ASYNC_OP_NB/2; i++ ) {
+		BRG_TEST_CHECK(brgAsync.Wait(&ops[TEST_ASYNC_OP_NB/2 + i]) == BRG_NO_ERR);
+		BRG_TEST_CHECK(ops[TEST_ASYNC_OP_NB/2 + i].SizeDone == 4);
+		BRG_TEST_CHECK(memcmp(dataIn[i], &dataOut[i][1], 4) == 0);
+	}
+
+	// Error: returned by Wait(), then once by Flush()
+	BRG_TEST_CHECK(brgAsync.SubmitReadI2C(&ops[0], dataIn[0], 0x51, I2C_ADDR_7BIT, 4) == BRG_NO_ERR);
+	BRG_TEST_CHECK(brgAsync.Wait(&ops[0]) == BRG_I2C_ERR);
+	BRG_TEST_CHECK(brgAsync.Flush() == BRG_I2C_ERR);
+	BRG_TEST_CHECK(brgAsync.Flush() == BRG_NO_ERR);
+	brgAsync.Stop();
+
+	brg.CloseBridge(COM_UNDEF_ALL);
+	brg.CloseStlink();
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,205 @@
+/**
+  ******************************************************************************
+  * @file    test_batch.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "batch": Brg::ExecuteBatch() in immediate and deferred
+  *          Read/Write status modes.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_BATCH_OP_NB 8
+
+/*
+ * private: SPI frame, I2C register write then read back, GPIO set and SPI read
+ */
+static void BuildOps(Brg_BatchOpT *pOps, uint8_t *pI2cOut, uint8_t *pI2cIn, uint8_t *pSpiBuf)
+{
+	memset(pOps, 0, TEST_BATCH_OP_NB*sizeof(Brg_BatchOpT));
+	pOps[0].OpType = BATCH_SPI_CS;
+	pOps[0].NssLevel = SPI_NSS_LOW;
+	pOps[1].OpType = BATCH_SPI_WRITE;
+	pOps[1].pTxBuffer = pSpiBuf;
+	pOps[1].SizeInBytes = 16;
+	pOps[2].OpType = BATCH_SPI_CS;
+	pOps[2].NssLevel = SPI_NSS_HIGH;
+	pOps[3].OpType = BATCH_I2C_WRITE;
+	pOps[3].pTxBuffer = pI2cOut;
+	pOps[3].Addr = 0x50;
+	pOps[3].SizeInBytes = 5;
+	pOps[4].OpType = BATCH_I2C_WRITE;
+	pOps[4].pTxBuffer = pI2cOut;
+	pOps[4].Addr = 0x50;
+	pOps[4].SizeInBytes = 1;
+	pOps[5].OpType = BATCH_I2C_READ;
+	pOps[5].pRxBuffer = pI2cIn;
+	pOps[5].Addr = 0x50;
+	pOps[5].SizeInBytes = 4;
+	pOps[6].OpType = BATCH_GPIO_SET;
+	pOps[6].GpioMask = BRG_GPIO_0;
+	pOps[6].GpioVal[0] = GPIO_SET;
+	pOps[7].OpType = BATCH_SPI_READ;
+	pOps[7].pRxBuffer = pSpiBuf;
+	pOps[7].SizeInBytes = 16;
+}
+
+/**
+ * @ingroup TEST
+ * @brief Results of the batch operations, error stopping the batch, parameter check, and in deferred mode
+ *        the error tied to the failing I2C command and the status of the commands sent before the batch
+ *        kept apart from the batch result.
+ */
+void TestBatch(void)
+{
+	BrgTestBench bench(false);
+	BrgSimI2cMemSlave mem(256, 1);
+	Brg brg(bench.m_itf);
+	Brg_SpiInitT spiInit;
+	Brg_GpioConfT gpioConf;
+	Brg_GpioInitT gpioInit;
+	Brg_BatchOpT ops[TEST_BATCH_OP_NB];
+	Brg_BatchOpT writeOps[4];
+	Brg_RwOpStatusT rwStatus;
+	uint8_t i2cOut[5] = {0x10, 1, 2, 3, 4};
+	uint8_t i2cIn[4];
+	uint8_t spiBuf[16];
+	uint16_t sizeDone;
+	uint32_t opDoneNb;
+	int mode, i;
+
+	bench.m_sim.AttachI2cSlave(0, 0x50, &mem);
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+	BRG_TEST_CHECK(BrgTestInitI2C(brg, I2C_FAST_PLUS, 1000) == BRG_NO_ERR);
+	gpioConf.Mode = GPIO_MODE_OUTPUT;
+	gpioConf.Speed = GPIO_SPEED_LOW;
+	gpioConf.Pull = GPIO_NO_PULL;
+	gpioConf.OutputType = GPIO_OUTPUT_PUSHPULL;
+	gpioInit.GpioMask = BRG_GPIO_ALL;
+	gpioInit.ConfigNb = 1;
+	gpioInit.pGpioConf = &gpioConf;
+	BRG_TEST_CHECK(brg.InitGPIO(&gpioInit) == BRG_NO_ERR);
+	memset(&spiInit, 0, sizeof(spiInit));
+	spiInit.Baudrate = SPI_BAUDRATEPRESCALER_16;
+	spiInit.Nss = SPI_NSS_SOFT;
+	BRG_TEST_CHECK(brg.InitSPI(&spiInit) == BRG_NO_ERR);
+	memset(spiBuf, 0x5A, sizeof(spiBuf));
+	BuildOps(ops, i2cOut, i2cIn, spiBuf);
+
+	for( mode = 0; mode < 2; mode++ ) {
+		BRG_TEST_CHECK(brg.SetRwStatusMode((mode == 0) ? RW_STATUS_IMMEDIATE : RW_STATUS_DEFERRED) == BRG_NO_ERR);
+		memset(i2cIn, 0, sizeof(i2cIn));
+		BRG_TEST_CHECK(brg.ExecuteBatch(ops, TEST_BATCH_OP_NB, &opDoneNb) == BRG_NO_ERR);
+		BRG_TEST_CHECK(opDoneNb == TEST_BATCH_OP_NB);
+		for( i = 0; i < TEST_BATCH_OP_NB; i++ ) {
+			BRG_TEST_CHECK(ops[i].Status == BRG_NO_ERR);
+		}
+		BRG_TEST_CHECK(memcmp(i2cIn, &i2cOut[1], 4) == 0);
+		BRG_TEST_CHECK(ops[5].SizeDone == 4);
+
+		if( mode == 0 ) {
+			// Failing operation stops the batch
+			ops[4].Addr = 0x51;
+			BRG_TEST_CHECK(brg.ExecuteBatch(ops, TEST_BATCH_OP_NB, &opDoneNb) == BRG_I2C_ERR);
+			BRG_TEST_CHECK(opDoneNb == 5);
+			BRG_TEST_CHECK(ops[4].Status == BRG_I2C_ERR);
+			BRG_TEST_CHECK(ops[5].Status == BRG_COM_CMD_ORDER_ERR);
+			ops[4].Addr = 0x50;
+		} else {
+			// Failing last operation: reported on this I2C operation only
+			ops[5].Addr = 0x51;
+			BRG_TEST_CHECK(brg.ExecuteBatch(ops, 6, &opDoneNb) == BRG_I2C_ERR);
+			BRG_TEST_CHECK(opDoneNb == 6);
+			BRG_TEST_CHECK(ops[5].Status == BRG_I2C_ERR);
+			BRG_TEST_CHECK(ops[4].Status == BRG_NO_ERR);
+			BRG_TEST_CHECK(ops[1].Status == BRG_NO_ERR);
+			ops[5].Addr = 0x50;
+			// Failing operation in the middle: stops the batch as in immediate mode
+			ops[3].Addr = 0x51;
+			BRG_TEST_CHECK(brg.ExecuteBatch(ops, TEST_BATCH_OP_NB, &opDoneNb) == BRG_I2C_ERR);
+			BRG_TEST_CHECK(opDoneNb == 4);
+			BRG_TEST_CHECK(ops[3].Status == BRG_I2C_ERR);
+			BRG_TEST_CHECK(ops[1].Status == BRG_NO_ERR);
+			BRG_TEST_CHECK(ops[4].Status == BRG_COM_CMD_ORDER_ERR);
+			ops[3].Addr = 0x50;
+		}
+	}
+
+	// Deferred mode: failing command pending before the batch
+	BRG_TEST_CHECK(brg.WriteI2C(i2cOut, 0x51, 1, &sizeDone) == BRG_NO_ERR);
+	BRG_TEST_CHECK(brg.ExecuteBatch(ops, TEST_BATCH_OP_NB, &opDoneNb) == BRG_NO_ERR);
+	for( i = 0; i < TEST_BATCH_OP_NB; i++ ) {
+		BRG_TEST_CHECK(ops[i].Status == BRG_NO_ERR);
+	}
+	BRG_TEST_CHECK(brg.SyncRwStatus(&rwStatus) == BRG_I2C_ERR);
+	BRG_TEST_CHECK(rwStatus.OpId == rwStatus.FirstOpId);
+	BRG_TEST_CHECK(rwStatus.OpId < brg.GetLastRwOpId());
+	BRG_TEST_CHECK(brg.SyncRwStatus() == BRG_NO_ERR);
+
+	// Deferred mode: 4 I2C writes, the 2nd one NACKed, reported by SyncRwStatus() after the 2 next ones
+	for( i = 0; i < 4; i++ ) {
+		BRG_TEST_CHECK(brg.WriteI2C(i2cOut, (i == 1) ? 0x51 : 0x50, 5, &sizeDone) == BRG_NO_ERR);
+	}
+	BRG_TEST_CHECK(brg.SyncRwStatus(&rwStatus) == BRG_I2C_ERR);
+	BRG_TEST_CHECK(rwStatus.OpId == brg.GetLastRwOpId() - 2);
+	BRG_TEST_CHECK(rwStatus.FirstOpId == rwStatus.OpId);
+	BRG_TEST_CHECK(rwStatus.BrgCom == COM_I2C);
+	BRG_TEST_CHECK(rwStatus.BytesWithoutError == 0);
+	BRG_TEST_CHECK(brg.SyncRwStatus() == BRG_NO_ERR);
+	// Same in a batch: stopped after the 2nd write
+	memset(writeOps, 0, sizeof(writeOps));
+	for( i = 0; i < 4; i++ ) {
+		writeOps[i].OpType = BATCH_I2C_WRITE;
+		writeOps[i].pTxBuffer = i2cOut;
+		writeOps[i].Addr = (i == 1) ? 0x51 : 0x50;
+		writeOps[i].SizeInBytes = 5;
+	}
+	BRG_TEST_CHECK(brg.ExecuteBatch(writeOps, 4, &opDoneNb) == BRG_I2C_ERR);
+	BRG_TEST_CHECK(opDoneNb == 2);
+	BRG_TEST_CHECK(writeOps[0].Status == BRG_NO_ERR);
+	BRG_TEST_CHECK(writeOps[1].Status == BRG_I2C_ERR);
+	BRG_TEST_CHECK(writeOps[2].Status == BRG_COM_CMD_ORDER_ERR);
+	BRG_TEST_CHECK(brg.SyncRwStatus() == BRG_NO_ERR);
+
+	// Deferred mode: error already kept (window ended by BatchSize) before the batch
+	BRG_TEST_CHECK(brg.SetRwStatusMode(RW_STATUS_DEFERRED, 1) == BRG_NO_ERR);
+	BRG_TEST_CHECK(brg.WriteI2C(i2cOut, 0x51, 1, &sizeDone) == BRG_I2C_ERR);
+	BRG_TEST_CHECK(brg.ExecuteBatch(ops, TEST_BATCH_OP_NB, &opDoneNb) == BRG_NO_ERR);
+	BRG_TEST_CHECK(ops[7].Status == BRG_NO_ERR);
+	BRG_TEST_CHECK(brg.SyncRwStatus() == BRG_I2C_ERR);
+	BRG_TEST_CHECK(brg.SyncRwStatus() == BRG_NO_ERR);
+	BRG_TEST_CHECK(brg.SetRwStatusMode(RW_STATUS_IMMEDIATE) == BRG_NO_ERR);
+
+	// Wrong parameter: nothing executed
+	ops[2].NssLevel = (Brg_SpiNssLevelT)7;
+	BRG_TEST_CHECK(brg.ExecuteBatch(ops, TEST_BATCH_OP_NB, &opDoneNb) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(opDoneNb == 0);
+
+	brg.CloseBridge(COM_UNDEF_ALL);
+	brg.CloseStlink();
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
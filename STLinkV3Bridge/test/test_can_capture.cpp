@@ -0,0 +1,351 @@
+/**
+  ******************************************************************************
+  * @file    test_can_capture.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "capture": BrgCanCaptureWriter / BrgCanCaptureReader
+  *          round trip, seek and unclosed file, write rate and file size.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+#include "bridge_can_capture.h"
+#include "stlink_cmd_stats.h"
+
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+// Capture files, in the current directory, removed at the end
+#define TEST_CAPTURE_PATH          "test_capture.brgcan"
+#define TEST_CAPTURE_CRASH_PATH    "test_capture_crash.brgcan"
+#define TEST_CAPTURE_TEXT_PATH     "test_capture.log"
+#define TEST_CAPTURE_RAW_PATH      "test_capture.raw"
+#define TEST_CAPTURE_FRAME_NB      20000
+#define TEST_CAPTURE_INTERVAL      100
+// Frames written when the unclosed file is copied: in the middle of a block
+#define TEST_CAPTURE_CRASH_NB      12345
+#define TEST_CAPTURE_SEEK_NB       2000
+#define TEST_CAPTURE_START_NS      1000000000ULL
+#define TEST_CAPTURE_BENCH_NB      5000000
+#define TEST_CAPTURE_BENCH_SEEK_NB 10000
+
+/* Private typedef -----------------------------------------------------------*/
+// Frame written and its expected timestamp read back
+typedef struct {
+	uint64_t TimestampNs;
+	Brg_CanRxMsgT Msg;
+	uint8_t Data[8];
+} TestCaptureRefT;
+
+/* Private variables ---------------------------------------------------------*/
+static TestCaptureRefT s_ref[TEST_CAPTURE_FRAME_NB];
+static uint32_t s_seed;
+
+/*
+ * private: pseudo-random number (LCG)
+ */
+static uint32_t Rand(void)
+{
+	s_seed = s_seed*1103515245 + 12345;
+	return s_seed >> 8;
+}
+
+/*
+ * private: copy of the first SizeInBytes bytes of a file (file of a writer still opened)
+ */
+static bool CopyFile(const char *pSrcPath, const char *pDstPath, uint64_t SizeInBytes)
+{
+	static uint8_t buffer[4096];
+	FILE *pSrc, *pDst;
+	size_t size;
+	bool bOk = true;
+
+	pSrc = fopen(pSrcPath, "rb");
+	pDst = fopen(pDstPath, "wb");
+	if( (pSrc == NULL) || (pDst == NULL) ) {
+		bOk = false;
+	}
+	while( (bOk == true) && (SizeInBytes > 0) ) {
+		size = (SizeInBytes > sizeof(buffer)) ? sizeof(buffer) : (size_t)SizeInBytes;
+		if( (fread(buffer, 1, size, pSrc) != size) || (fwrite(buffer, 1, size, pDst) != size) ) {
+			bOk = false;
+		}
+		SizeInBytes -= size;
+	}
+	if( pSrc != NULL ) {
+		fclose(pSrc);
+	}
+	if( pDst != NULL ) {
+		fclose(pDst);
+	}
+	return bOk;
+}
+
+/*
+ * private: frame read equal to the reference frame
+ */
+static bool IsSameFrame(const Brg_CanCaptureFrameT *pFrame, const TestCaptureRefT *pRef)
+{
+	return (pFrame->TimestampNs == pRef->TimestampNs) && (pFrame->Msg.ID == pRef->Msg.ID) &&
+	       (pFrame->Msg.IDE == pRef->Msg.IDE) && (pFrame->Msg.RTR == pRef->Msg.RTR) &&
+	       (pFrame->Msg.DLC == pRef->Msg.DLC) && (pFrame->Msg.Fifo == pRef->Msg.Fifo) &&
+	       (pFrame->Msg.Overrun == pRef->Msg.Overrun) &&
+	       ((pRef->Msg.RTR == CAN_REMOTE_FRAME) || (memcmp(pFrame->Data, pRef->Data, pRef->Msg.DLC) == 0));
+}
+
+/*
+ * private: frames read from the current position equal to the reference frames [FirstIdx, FrameNb[
+ */
+static void CheckFrames(BrgCanCaptureReader &Reader, uint32_t FirstIdx, uint32_t FrameNb)
+{
+	Brg_CanCaptureFrameT frame;
+	uint32_t i = FirstIdx;
+
+	while( (Reader.ReadFrame(&frame) == true) && (i < FrameNb) ) {
+		if( IsSameFrame(&frame, &s_ref[i]) == false ) {
+			break;
+		}
+		i++;
+	}
+	BRG_TEST_CHECK(i == FrameNb);
+	BRG_TEST_CHECK(Reader.ReadFrame(&frame) == false);
+}
+
+/*
+ * private: Seek() then ReadFrame() gives the first reference frame at or after TimestampNs, returns the
+ * index of the next frame
+ */
+static uint32_t CheckSeek(BrgCanCaptureReader &Reader, uint64_t TimestampNs, uint32_t FrameNb)
+{
+	Brg_CanCaptureFrameT frame;
+	uint32_t i = 0;
+
+	while( (i < FrameNb) && (s_ref[i].TimestampNs < TimestampNs) ) {
+		i++;
+	}
+	BRG_TEST_CHECK(Reader.Seek(TimestampNs) == BRG_NO_ERR);
+	if( i == FrameNb ) {
+		BRG_TEST_CHECK(Reader.ReadFrame(&frame) == false);
+	} else {
+		BRG_TEST_CHECK((Reader.ReadFrame(&frame) == true) && (IsSameFrame(&frame, &s_ref[i]) == true));
+		i++;
+	}
+	return i;
+}
+
+/**
+ * @ingroup TEST
+ * @brief Write, Close, Open, ReadFrame round trip of all the frame kinds (standard/extended ID, remote
+ *        frame, DLC 0-8, FIFO1, overrun, time going backwards, frames before the capture start), seek
+ *        by time, text export, copy of the unclosed file truncated in the middle of a block, bad files.
+ */
+void TestCanCapture(void)
+{
+	BrgCanCaptureWriter writer;
+	BrgCanCaptureReader reader;
+	Brg_CanCaptureConfT conf;
+	Brg_CanCaptureInfoT info;
+	TestCaptureRefT *pRef;
+	uint64_t timeNs, expectedNs;
+	uint32_t i, kind;
+
+	BrgCanCaptureWriter::GetDefaultConf(&conf);
+	conf.IndexInterval = TEST_CAPTURE_INTERVAL;
+	// Small steps: the file grows many times
+	conf.GrowSize = 4096;
+	BRG_TEST_CHECK(writer.Write(TEST_CAPTURE_START_NS, &s_ref[0].Msg, s_ref[0].Data) == BRG_COM_CMD_ORDER_ERR);
+	BRG_TEST_CHECK(writer.Open(TEST_CAPTURE_PATH, TEST_CAPTURE_START_NS, &conf) == BRG_NO_ERR);
+
+	s_seed = 1;
+	timeNs = TEST_CAPTURE_START_NS - 5000;
+	for( i = 0; i < TEST_CAPTURE_FRAME_NB; i++ ) {
+		pRef = &s_ref[i];
+		memset(pRef, 0, sizeof(*pRef));
+		kind = Rand() % 100;
+		if( kind < 3 ) {
+			timeNs -= 3000;
+		} else {
+			timeNs += Rand() % 2000000;
+		}
+		pRef->Msg.IDE = ((kind % 7) == 0) ? CAN_ID_EXTENDED : CAN_ID_STANDARD;
+		pRef->Msg.ID = (pRef->Msg.IDE == CAN_ID_EXTENDED) ? (Rand() & 0x1FFFFFFF) : (0x100 + Rand() % 8);
+		pRef->Msg.RTR = ((kind % 11) == 0) ? CAN_REMOTE_FRAME : CAN_DATA_FRAME;
+		pRef->Msg.DLC = (uint8_t)(Rand() % 9);
+		pRef->Msg.Fifo = ((kind % 5) == 0) ? CAN_MSG_RX_FIFO1 : CAN_MSG_RX_FIFO0;
+		pRef->Msg.Overrun = (kind == 42) ? CAN_RX_BUFF_OVERRUN : CAN_RX_NO_OVERRUN;
+		for( kind = 0; kind < 8; kind++ ) {
+			pRef->Data[kind] = (uint8_t)Rand();
+		}
+		BRG_TEST_CHECK(writer.Write(timeNs, &pRef->Msg, pRef->Data) == BRG_NO_ERR);
+
+		// Rounded down to 1us since the start, never before the start nor the previous frame
+		expectedNs = (timeNs > TEST_CAPTURE_START_NS) ? timeNs : TEST_CAPTURE_START_NS;
+		expectedNs = TEST_CAPTURE_START_NS + (expectedNs - TEST_CAPTURE_START_NS)/1000*1000;
+		if( (i > 0) && (expectedNs < s_ref[i-1].TimestampNs) ) {
+			expectedNs = s_ref[i-1].TimestampNs;
+		}
+		pRef->TimestampNs = expectedNs;
+
+		// Application crash: file copied up to the middle of the last record
+		if( i == TEST_CAPTURE_CRASH_NB - 1 ) {
+			BRG_TEST_CHECK(CopyFile(TEST_CAPTURE_PATH, TEST_CAPTURE_CRASH_PATH, writer.GetUsedSize() - 3) == true);
+		}
+	}
+	BRG_TEST_CHECK(writer.GetFrameNb() == TEST_CAPTURE_FRAME_NB);
+	BRG_TEST_CHECK(writer.Close() == BRG_NO_ERR);
+
+	// Round trip
+	BRG_TEST_CHECK(reader.Open(TEST_CAPTURE_PATH) == BRG_NO_ERR);
+	reader.GetInfo(&info);
+	BRG_TEST_CHECK(info.StartNs == TEST_CAPTURE_START_NS);
+	BRG_TEST_CHECK(info.TimeUnitNs == conf.TimeUnitNs);
+	BRG_TEST_CHECK(info.FrameNb == TEST_CAPTURE_FRAME_NB);
+	BRG_TEST_CHECK(info.IndexNb == TEST_CAPTURE_FRAME_NB/TEST_CAPTURE_INTERVAL);
+	CheckFrames(reader, 0, TEST_CAPTURE_FRAME_NB);
+
+	// Seek: before the first frame, after the last one, between frames and on frames
+	CheckSeek(reader, 0, TEST_CAPTURE_FRAME_NB);
+	CheckSeek(reader, s_ref[TEST_CAPTURE_FRAME_NB-1].TimestampNs + 1, TEST_CAPTURE_FRAME_NB);
+	for( i = 0; i < TEST_CAPTURE_SEEK_NB; i++ ) {
+		CheckSeek(reader, s_ref[Rand() % TEST_CAPTURE_FRAME_NB].TimestampNs + (Rand() % 3)*(Rand() % 1000000),
+		          TEST_CAPTURE_FRAME_NB);
+	}
+	i = CheckSeek(reader, s_ref[TEST_CAPTURE_FRAME_NB/2].TimestampNs, TEST_CAPTURE_FRAME_NB);
+	CheckFrames(reader, i, TEST_CAPTURE_FRAME_NB);
+
+	BRG_TEST_CHECK(reader.ExportCandump(TEST_CAPTURE_TEXT_PATH, "can0") == BRG_NO_ERR);
+	BRG_TEST_CHECK(reader.ExportAsc(TEST_CAPTURE_TEXT_PATH, 1) == BRG_NO_ERR);
+	BRG_TEST_CHECK(reader.Open(TEST_CAPTURE_PATH) == BRG_PARAM_ERR);
+	reader.Close();
+
+	// Unclosed file: complete blocks only, no index (Seek() decodes from the start)
+	BRG_TEST_CHECK(reader.Open(TEST_CAPTURE_CRASH_PATH) == BRG_NO_ERR);
+	reader.GetInfo(&info);
+	BRG_TEST_CHECK(info.FrameNb == TEST_CAPTURE_CRASH_NB/TEST_CAPTURE_INTERVAL*TEST_CAPTURE_INTERVAL);
+	BRG_TEST_CHECK(info.IndexNb == 0);
+	CheckFrames(reader, 0, (uint32_t)info.FrameNb);
+	CheckSeek(reader, s_ref[TEST_CAPTURE_CRASH_NB/2].TimestampNs, (uint32_t)info.FrameNb);
+	CheckSeek(reader, s_ref[TEST_CAPTURE_CRASH_NB-1].TimestampNs, (uint32_t)info.FrameNb);
+	reader.Close();
+
+	// Not a capture file, capture file shorter than its header data size, no file
+	BRG_TEST_CHECK(reader.Open(TEST_CAPTURE_TEXT_PATH) == BRG_FILE_ERR);
+	BRG_TEST_CHECK(CopyFile(TEST_CAPTURE_PATH, TEST_CAPTURE_CRASH_PATH, 1000) == true);
+	BRG_TEST_CHECK(reader.Open(TEST_CAPTURE_CRASH_PATH) == BRG_FILE_ERR);
+	remove(TEST_CAPTURE_CRASH_PATH);
+	BRG_TEST_CHECK(reader.Open(TEST_CAPTURE_CRASH_PATH) == BRG_FILE_ERR);
+
+	remove(TEST_CAPTURE_PATH);
+	remove(TEST_CAPTURE_TEXT_PATH);
+}
+
+/**
+ * @ingroup TEST
+ * @brief Capture of a saturated 1 Mbit/s bus (8-byte frames of 16 IDs, about 130us apart): write rate
+ *        and bytes per frame against a raw fwrite() of Brg_CanRxFrameT, read and candump export rates,
+ *        seek time.
+ */
+void BenchCanCapture(void)
+{
+	static Brg_CanRxFrameT frames[4096];
+	BrgCanCaptureWriter writer;
+	BrgCanCaptureReader reader;
+	Brg_CanCaptureFrameT frame;
+	uint64_t startNs, durationNs, timeNs, usedSize, textSize;
+	FILE *pFile;
+	uint32_t i, j, readNb;
+
+	s_seed = 3;
+	memset(frames, 0, sizeof(frames));
+	for( i = 0; i < 4096; i++ ) {
+		frames[i].Msg.ID = 0x100 + Rand() % 16;
+		frames[i].Msg.DLC = 8;
+		for( j = 0; j < 8; j++ ) {
+			frames[i].Data[j] = (uint8_t)Rand();
+		}
+	}
+
+	timeNs = TEST_CAPTURE_START_NS;
+	startNs = StlinkCmdStats::GetTimeNs();
+	BRG_TEST_CHECK(writer.Open(TEST_CAPTURE_PATH, TEST_CAPTURE_START_NS) == BRG_NO_ERR);
+	for( i = 0; i < TEST_CAPTURE_BENCH_NB; i++ ) {
+		timeNs += 128000 + (Rand() & 0x3FFF);
+		frames[i & 4095].TimestampNs = timeNs;
+		writer.Write(&frames[i & 4095]);
+	}
+	BRG_TEST_CHECK(writer.Close() == BRG_NO_ERR);
+	durationNs = StlinkCmdStats::GetTimeNs() - startNs;
+	usedSize = writer.GetUsedSize();
+	printf("Capture write: %.1f Mframes/s, %.1f MB/s, %.2f bytes/frame\n",
+	       (double)TEST_CAPTURE_BENCH_NB*1000/durationNs, (double)usedSize*1000/durationNs,
+	       (double)usedSize/TEST_CAPTURE_BENCH_NB);
+
+	startNs = StlinkCmdStats::GetTimeNs();
+	pFile = fopen(TEST_CAPTURE_RAW_PATH, "wb");
+	BRG_TEST_CHECK(pFile != NULL);
+	if( pFile != NULL ) {
+		for( i = 0; i < TEST_CAPTURE_BENCH_NB; i++ ) {
+			fwrite(&frames[i & 4095], sizeof(Brg_CanRxFrameT), 1, pFile);
+		}
+		fclose(pFile);
+	}
+	durationNs = StlinkCmdStats::GetTimeNs() - startNs;
+	printf("Raw fwrite:    %.1f Mframes/s, %u bytes/frame\n", (double)TEST_CAPTURE_BENCH_NB*1000/durationNs,
+	       (uint32_t)sizeof(Brg_CanRxFrameT));
+	remove(TEST_CAPTURE_RAW_PATH);
+
+	BRG_TEST_CHECK(reader.Open(TEST_CAPTURE_PATH) == BRG_NO_ERR);
+	readNb = 0;
+	startNs = StlinkCmdStats::GetTimeNs();
+	while( reader.ReadFrame(&frame) == true ) {
+		readNb++;
+	}
+	durationNs = StlinkCmdStats::GetTimeNs() - startNs;
+	BRG_TEST_CHECK(readNb == TEST_CAPTURE_BENCH_NB);
+	printf("Capture read:  %.1f Mframes/s\n", (double)readNb*1000/durationNs);
+
+	startNs = StlinkCmdStats::GetTimeNs();
+	BRG_TEST_CHECK(reader.ExportCandump(TEST_CAPTURE_TEXT_PATH, "can0") == BRG_NO_ERR);
+	durationNs = StlinkCmdStats::GetTimeNs() - startNs;
+	textSize = 0;
+	pFile = fopen(TEST_CAPTURE_TEXT_PATH, "rb");
+	if( pFile != NULL ) {
+		fseek(pFile, 0, SEEK_END);
+		textSize = (uint64_t)ftell(pFile);
+		fclose(pFile);
+	}
+	printf("Candump export: %.1f Mframes/s, %.2f bytes/frame\n", (double)TEST_CAPTURE_BENCH_NB*1000/durationNs,
+	       (double)textSize/TEST_CAPTURE_BENCH_NB);
+	remove(TEST_CAPTURE_TEXT_PATH);
+
+	startNs = StlinkCmdStats::GetTimeNs();
+	for( i = 0; i < TEST_CAPTURE_BENCH_SEEK_NB; i++ ) {
+		reader.Seek(TEST_CAPTURE_START_NS + (uint64_t)(Rand() % TEST_CAPTURE_BENCH_NB)*136000);
+		reader.ReadFrame(&frame);
+	}
+	durationNs = StlinkCmdStats::GetTimeNs() - startNs;
+	printf("Seek + ReadFrame: %.2f us\n", (double)durationNs/TEST_CAPTURE_BENCH_SEEK_NB/1000);
+	reader.Close();
+	remove(TEST_CAPTURE_PATH);
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
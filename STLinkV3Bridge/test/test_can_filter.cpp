@@ -0,0 +1,447 @@
+/**
+  ******************************************************************************
+  * @file    test_can_filter.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "canfilter": BrgCanFilterPlanner banks programmed in the
+  *          simulated firmware, identifier lists and masks, banks exhausted.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+#include "bridge_can_filter.h"
+#include "stlink_cmd_stats.h"
+
+#include <string.h>
+#include <vector>
+
+/* Private defines -----------------------------------------------------------*/
+// Standard frame identifiers: 2048 IDs, data and remote
+#define TEST_FILTER_STD_NB    4096
+// Frames injected between two reads of the STLink RX buffer
+#define TEST_FILTER_CHUNK_NB  128
+// Plan() calls timed per benchmark line: at most TEST_FILTER_BENCH_REPEAT, stopped after
+// TEST_FILTER_BENCH_NS
+#define TEST_FILTER_BENCH_REPEAT 20
+#define TEST_FILTER_BENCH_NS     100000000ULL
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t s_seed;
+
+/* Private functions ---------------------------------------------------------*/
+/*
+ * private: pseudo-random number (LCG)
+ */
+static uint32_t Rand(void)
+{
+	s_seed = s_seed*1103515245 + 12345;
+	return s_seed >> 8;
+}
+
+/*
+ * private: frame identifier
+ */
+static Brg_FilterBitsT MakeId(uint32_t Id, bool bIde, bool bRtr)
+{
+	Brg_FilterBitsT bits;
+
+	bits.ID = Id;
+	bits.IDE = (bIde == true) ? CAN_ID_EXTENDED : CAN_ID_STANDARD;
+	bits.RTR = (bRtr == true) ? CAN_REMOTE_FRAME : CAN_DATA_FRAME;
+	return bits;
+}
+
+/*
+ * private: CAN at 1 Mbit/s in normal mode, reception started, all filter banks disabled
+ */
+static void InitCan(Brg &BrgDevice)
+{
+	Brg_CanInitT canInit;
+	uint32_t prescal, finalBaudrate;
+
+	memset(&canInit, 0, sizeof(canInit));
+	canInit.BitTimeConf.PropSegInTq = 1;
+	canInit.BitTimeConf.PhaseSeg1InTq = 4;
+	canInit.BitTimeConf.PhaseSeg2InTq = 2;
+	canInit.BitTimeConf.SjwInTq = 1;
+	BRG_TEST_CHECK(BrgDevice.GetCANbaudratePrescal(&canInit.BitTimeConf, 1000000, &prescal,
+	                                               &finalBaudrate) == BRG_NO_ERR);
+	canInit.Prescaler = prescal;
+	canInit.Mode = CAN_MODE_NORMAL;
+	BRG_TEST_CHECK(BrgDevice.InitCAN(&canInit, BRG_INIT_FULL) == BRG_NO_ERR);
+	BRG_TEST_CHECK(BrgDevice.StartMsgReceptionCAN() == BRG_NO_ERR);
+}
+
+/*
+ * private: frames pIds injected on the simulated bus and received by the device whose banks were
+ * programmed with Planner.Apply(): returns the number of frames whose reception differs from
+ * Planner.IsAccepted() (or received in the wrong FIFO), *pAcceptedNb the number received
+ */
+static uint32_t CheckSimAccepted(BrgSimTransport &Sim, Brg &BrgDevice, const BrgCanFilterPlanner &Planner,
+                                 const Brg_FilterBitsT *pIds, uint32_t IdNb, Brg_CanRxFifoT Fifo,
+                                 uint32_t *pAcceptedNb)
+{
+	Brg_CanRxMsgT msgs[TEST_FILTER_CHUNK_NB];
+	uint8_t data[TEST_FILTER_CHUNK_NB*8];
+	BrgSimCanFrameT frame;
+	uint32_t errorNb = 0, first, i, chunkNb;
+	uint16_t msgNb, dataSize, m;
+
+	*pAcceptedNb = 0;
+	memset(&frame, 0, sizeof(frame));
+	for( first = 0; first < IdNb; first += chunkNb ) {
+		chunkNb = ((IdNb - first) < TEST_FILTER_CHUNK_NB) ? (IdNb - first) : TEST_FILTER_CHUNK_NB;
+		for( i = first; i < first + chunkNb; i++ ) {
+			frame.ID = pIds[i].ID;
+			frame.bIde = (pIds[i].IDE == CAN_ID_EXTENDED);
+			frame.bRtr = (pIds[i].RTR == CAN_REMOTE_FRAME);
+			frame.DLC = 1;
+			frame.Data[0] = (uint8_t)i;
+			Sim.InjectCanFrame(&frame);
+		}
+		msgNb = 0;
+		if( BrgDevice.GetRxMsgNbCAN(&msgNb) != BRG_NO_ERR ) {
+			return IdNb;
+		}
+		if( (msgNb != 0) &&
+		    (BrgDevice.GetRxMsgCAN(msgs, msgNb, data, sizeof(data), &dataSize) != BRG_NO_ERR) ) {
+			return IdNb;
+		}
+		// Frames received in injection order: the accepted ones of the chunk
+		m = 0;
+		for( i = first; i < first + chunkNb; i++ ) {
+			bool bReceived = (m < msgNb) && (msgs[m].ID == pIds[i].ID) && (msgs[m].IDE == pIds[i].IDE) &&
+			                 (msgs[m].RTR == pIds[i].RTR);
+			if( bReceived == true ) {
+				if( msgs[m].Fifo != Fifo ) {
+					errorNb++;
+				}
+				m++;
+			}
+			if( bReceived != Planner.IsAccepted(&pIds[i]) ) {
+				errorNb++;
+			}
+		}
+		errorNb += msgNb - m;
+		*pAcceptedNb += m;
+	}
+	return errorNb;
+}
+
+/*
+ * private: plan of pIds on BankNb banks from FirstBankNb, programmed in the simulated device (the other
+ * banks disabled), checked against all the standard identifiers (AllStd) and the frames pOthers: every
+ * desired identifier accepted, received frames as IsAccepted(), AcceptedNb and FalseAcceptNb of the plan
+ * coherent. Returns the number of errors, *pPlan the plan.
+ */
+static uint32_t CheckPlan(BrgSimTransport &Sim, Brg &BrgDevice, BrgCanFilterPlanner &Planner,
+                          const Brg_FilterBitsT *pIds, uint32_t IdNb, uint8_t FirstBankNb, uint8_t BankNb,
+                          Brg_CanRxFifoT Fifo, const std::vector<Brg_FilterBitsT> &AllStd,
+                          const Brg_FilterBitsT *pOthers, uint32_t OtherNb, Brg_CanFilterPlanT *pPlan)
+{
+	Brg_CanFilterConfT conf;
+	uint32_t errorNb = 0, acceptedNb, otherAcceptedNb, i;
+	bool bHasExt = false;
+
+	memset(pPlan, 0, sizeof(*pPlan));
+	// Banks out of the range left by the previous plans disabled
+	if( (Planner.Plan(NULL, 0) != BRG_NO_ERR) || (Planner.Apply(BrgDevice) != BRG_NO_ERR) ) {
+		return 1;
+	}
+	if( (Planner.Plan(pIds, IdNb, FirstBankNb, BankNb, Fifo) != BRG_NO_ERR) ||
+	    (Planner.Apply(BrgDevice) != BRG_NO_ERR) ) {
+		return 1;
+	}
+	Planner.GetPlan(pPlan);
+	if( (pPlan->BankNb > BankNb) || (pPlan->AcceptedNb != pPlan->WantedNb + pPlan->FalseAcceptNb) ) {
+		errorNb++;
+	}
+	for( i = 0; i < pPlan->BankNb; i++ ) {
+		if( (Planner.GetBankConf((uint8_t)i, &conf) != BRG_NO_ERR) || (conf.FilterBankNb != FirstBankNb + i) ||
+		    (conf.bIsFilterEn == false) || (conf.AssignedFifo != Fifo) ) {
+			errorNb++;
+		}
+	}
+	for( i = 0; i < IdNb; i++ ) {
+		if( Planner.IsAccepted(&pIds[i]) == false ) {
+			errorNb++;
+		}
+		if( pIds[i].IDE == CAN_ID_EXTENDED ) {
+			bHasExt = true;
+		}
+	}
+	errorNb += CheckSimAccepted(Sim, BrgDevice, Planner, AllStd.data(), (uint32_t)AllStd.size(), Fifo,
+	                            &acceptedNb);
+	errorNb += CheckSimAccepted(Sim, BrgDevice, Planner, pIds, IdNb, Fifo, &otherAcceptedNb);
+	errorNb += CheckSimAccepted(Sim, BrgDevice, Planner, pOthers, OtherNb, Fifo, &otherAcceptedNb);
+	// All the standard identifiers tried: exact count of a standard only plan
+	if( (bHasExt == false) && (acceptedNb != pPlan->AcceptedNb) ) {
+		errorNb++;
+	}
+	return errorNb;
+}
+
+/*
+ * private: banks of the plan with the given mode and scale
+ */
+static uint32_t CountBanks(const BrgCanFilterPlanner &Planner, Brg_CanFilterModeT Mode,
+                           Brg_CanFilterScaleT Scale)
+{
+	Brg_CanFilterPlanT plan;
+	Brg_CanFilterConfT conf;
+	uint32_t bankNb = 0;
+	uint8_t i;
+
+	Planner.GetPlan(&plan);
+	for( i = 0; i < plan.BankNb; i++ ) {
+		if( (Planner.GetBankConf(i, &conf) == BRG_NO_ERR) && (conf.FilterMode == Mode) &&
+		    (conf.FilterScale == Scale) ) {
+			bankNb++;
+		}
+	}
+	return bankNb;
+}
+
+/**
+ * @ingroup TEST
+ * @brief Plans programmed in a simulated device, all the standard identifiers (data and remote) and
+ *        extended neighbours of the desired ones injected: exactly the desired set with identifier lists,
+ *        16bit masks of aligned groups without false accept, lists and masks together, merges with false
+ *        accepts when the banks run out, extended identifiers, bank range and FIFO1, errors.
+ */
+void TestCanFilter(void)
+{
+	BrgTestBench bench(false);
+	Brg brg(bench.m_itf);
+	BrgCanFilterPlanner planner;
+	Brg_CanFilterPlanT plan;
+	Brg_CanFilterConfT conf;
+	std::vector<Brg_FilterBitsT> allStd;
+	std::vector<Brg_FilterBitsT> ids;
+	std::vector<Brg_FilterBitsT> others;
+	uint32_t i, g, acceptedNb;
+	int bit;
+
+	for( i = 0; i < TEST_FILTER_STD_NB; i++ ) {
+		allStd.push_back(MakeId(i >> 1, false, (i & 1) != 0));
+	}
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+	InitCan(brg);
+
+	// Parameters, plan not done
+	BRG_TEST_CHECK(planner.Apply(brg) == BRG_PARAM_ERR);
+	ids.push_back(MakeId(0x800, false, false));
+	BRG_TEST_CHECK(planner.Plan(ids.data(), 1) == BRG_PARAM_ERR);
+	ids[0] = MakeId(0x123, false, false);
+	BRG_TEST_CHECK(planner.Plan(NULL, 1) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(planner.Plan(ids.data(), 1, 0, 0) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(planner.Plan(ids.data(), 1, 10, 5) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(planner.GetBankConf(0, &conf) == BRG_PARAM_ERR);
+
+	// Identifier lists: exactly the desired set, duplicates counted once, 4 per bank
+	ids.clear();
+	for( i = 0; i < 10; i++ ) {
+		ids.push_back(MakeId(0x101 + i*0x53, false, (i % 3) == 0));
+	}
+	ids.push_back(ids[4]);
+	BRG_TEST_CHECK(CheckPlan(bench.m_sim, brg, planner, ids.data(), (uint32_t)ids.size(), 0,
+	                         BRG_CAN_FILTER_BANK_NB, CAN_MSG_RX_FIFO0, allStd, NULL, 0, &plan) == 0);
+	BRG_TEST_CHECK((plan.WantedNb == 10) && (plan.ExactNb == 10) && (plan.MaskNb == 0));
+	BRG_TEST_CHECK((plan.BankNb == 3) && (plan.AcceptedNb == 10) && (plan.FalseAcceptNb == 0));
+	BRG_TEST_CHECK(CountBanks(planner, CAN_FILTER_ID_LIST, CAN_FILTER_16BIT) == 3);
+	BRG_TEST_CHECK(planner.GetBankConf(3, &conf) == BRG_PARAM_ERR);
+
+	// 14 banks of 4 identifiers, one more needs a mask
+	ids.clear();
+	for( i = 0; i < 4*BRG_CAN_FILTER_BANK_NB; i++ ) {
+		ids.push_back(MakeId(i*37, false, false));
+	}
+	BRG_TEST_CHECK(CheckPlan(bench.m_sim, brg, planner, ids.data(), (uint32_t)ids.size(), 0,
+	                         BRG_CAN_FILTER_BANK_NB, CAN_MSG_RX_FIFO0, allStd, NULL, 0, &plan) == 0);
+	BRG_TEST_CHECK((plan.BankNb == BRG_CAN_FILTER_BANK_NB) && (plan.MaskNb == 0) && (plan.FalseAcceptNb == 0));
+	ids.push_back(MakeId(0x7FF, false, false));
+	BRG_TEST_CHECK(CheckPlan(bench.m_sim, brg, planner, ids.data(), (uint32_t)ids.size(), 0,
+	                         BRG_CAN_FILTER_BANK_NB, CAN_MSG_RX_FIFO0, allStd, NULL, 0, &plan) == 0);
+	BRG_TEST_CHECK((plan.BankNb <= BRG_CAN_FILTER_BANK_NB) && (plan.MaskNb >= 1));
+
+	// Aligned groups of 4 identifiers: 16bit masks without false accept, 2 per bank
+	ids.clear();
+	const uint32_t groups[] = { 0x100, 0x204, 0x318, 0x43C };
+	for( g = 0; g < 4; g++ ) {
+		for( i = 0; i < 4; i++ ) {
+			ids.push_back(MakeId(groups[g] + i, false, false));
+		}
+	}
+	BRG_TEST_CHECK(CheckPlan(bench.m_sim, brg, planner, ids.data(), (uint32_t)ids.size(), 0, 2,
+	                         CAN_MSG_RX_FIFO0, allStd, NULL, 0, &plan) == 0);
+	BRG_TEST_CHECK((plan.BankNb == 2) && (plan.MaskNb == 4) && (plan.ExactNb == 0) && (plan.FalseAcceptNb == 0));
+	BRG_TEST_CHECK(CountBanks(planner, CAN_FILTER_ID_MASK, CAN_FILTER_16BIT) == 2);
+
+	// Same groups and 2 other identifiers on 3 banks: one list bank, two mask banks
+	ids.push_back(MakeId(0x555, false, false));
+	ids.push_back(MakeId(0x2AA, false, true));
+	BRG_TEST_CHECK(CheckPlan(bench.m_sim, brg, planner, ids.data(), (uint32_t)ids.size(), 0, 3,
+	                         CAN_MSG_RX_FIFO0, allStd, NULL, 0, &plan) == 0);
+	BRG_TEST_CHECK((plan.BankNb == 3) && (plan.MaskNb == 4) && (plan.ExactNb == 2) && (plan.FalseAcceptNb == 0));
+	BRG_TEST_CHECK(CountBanks(planner, CAN_FILTER_ID_LIST, CAN_FILTER_16BIT) == 1);
+	BRG_TEST_CHECK(CountBanks(planner, CAN_FILTER_ID_MASK, CAN_FILTER_16BIT) == 2);
+
+	// Banks run out: scattered identifiers merged with false accepts, down to a single bank
+	ids.clear();
+	for( i = 0; i < 9; i++ ) {
+		ids.push_back(MakeId((i*0x2B5 + 0x11) & 0x7FF, false, false));
+	}
+	BRG_TEST_CHECK(CheckPlan(bench.m_sim, brg, planner, ids.data(), (uint32_t)ids.size(), 0, 2,
+	                         CAN_MSG_RX_FIFO0, allStd, NULL, 0, &plan) == 0);
+	BRG_TEST_CHECK((plan.BankNb <= 2) && (plan.MaskNb >= 1) && (plan.FalseAcceptNb > 0));
+	BRG_TEST_CHECK(plan.FalseAcceptRatio == (double)plan.FalseAcceptNb/plan.AcceptedNb);
+	BRG_TEST_CHECK(CheckPlan(bench.m_sim, brg, planner, ids.data(), (uint32_t)ids.size(), 0, 1,
+	                         CAN_MSG_RX_FIFO0, allStd, NULL, 0, &plan) == 0);
+	BRG_TEST_CHECK((plan.BankNb == 1) && (plan.MaskNb >= 1));
+
+	// Extended identifiers (2 per 32bit list bank) and standard ones, neighbours of the extended ones
+	// (one ID bit, RTR or IDE different) rejected
+	ids.clear();
+	ids.push_back(MakeId(0x1ABCDEF0, true, false));
+	ids.push_back(MakeId(0x00000001, true, true));
+	ids.push_back(MakeId(0x1FFFFFFF, true, false));
+	ids.push_back(MakeId(0x123, false, false));
+	ids.push_back(MakeId(0x7FF, false, true));
+	others.clear();
+	for( i = 0; i < 3; i++ ) {
+		for( bit = 0; bit < 29; bit++ ) {
+			others.push_back(MakeId(ids[i].ID ^ (1u << bit), true, ids[i].RTR == CAN_REMOTE_FRAME));
+		}
+		others.push_back(MakeId(ids[i].ID, true, ids[i].RTR != CAN_REMOTE_FRAME));
+		others.push_back(MakeId(ids[i].ID & 0x7FF, false, ids[i].RTR == CAN_REMOTE_FRAME));
+	}
+	BRG_TEST_CHECK(CheckPlan(bench.m_sim, brg, planner, ids.data(), (uint32_t)ids.size(), 0,
+	                         BRG_CAN_FILTER_BANK_NB, CAN_MSG_RX_FIFO0, allStd, others.data(),
+	                         (uint32_t)others.size(), &plan) == 0);
+	BRG_TEST_CHECK((plan.BankNb == 3) && (plan.ExactNb == 5) && (plan.FalseAcceptNb == 0));
+	BRG_TEST_CHECK(CountBanks(planner, CAN_FILTER_ID_LIST, CAN_FILTER_32BIT) == 2);
+	BRG_TEST_CHECK(CheckSimAccepted(bench.m_sim, brg, planner, others.data(), (uint32_t)others.size(),
+	                                CAN_MSG_RX_FIFO0, &acceptedNb) == 0);
+	BRG_TEST_CHECK(acceptedNb == 0);
+	// 3 extended identifiers in one bank: 32bit mask
+	BRG_TEST_CHECK(CheckPlan(bench.m_sim, brg, planner, ids.data(), (uint32_t)ids.size(), 0, 2,
+	                         CAN_MSG_RX_FIFO0, allStd, others.data(), (uint32_t)others.size(), &plan) == 0);
+	BRG_TEST_CHECK((plan.BankNb == 2) && (plan.MaskNb >= 1) && (plan.FalseAcceptNb > 0));
+	// Standard and extended identifiers never share a bank
+	BRG_TEST_CHECK(planner.Plan(ids.data(), (uint32_t)ids.size(), 0, 1) == BRG_PARAM_ERR);
+	planner.GetPlan(&plan);
+	BRG_TEST_CHECK((plan.BankNb == 0) && (plan.WantedNb == 0));
+	BRG_TEST_CHECK(planner.Apply(brg) == BRG_PARAM_ERR);
+
+	// Bank range and FIFO1: banks 4 to 6
+	ids.clear();
+	for( i = 0; i < 12; i++ ) {
+		ids.push_back(MakeId(0x600 + i*3, false, false));
+	}
+	BRG_TEST_CHECK(CheckPlan(bench.m_sim, brg, planner, ids.data(), (uint32_t)ids.size(), 4, 3,
+	                         CAN_MSG_RX_FIFO1, allStd, NULL, 0, &plan) == 0);
+	BRG_TEST_CHECK((plan.BankNb == 3) && (plan.FalseAcceptNb == 0));
+
+	// Empty set: all the banks of the range disabled, nothing received
+	BRG_TEST_CHECK(CheckPlan(bench.m_sim, brg, planner, NULL, 0, 0, BRG_CAN_FILTER_BANK_NB,
+	                         CAN_MSG_RX_FIFO0, allStd, NULL, 0, &plan) == 0);
+	BRG_TEST_CHECK((plan.BankNb == 0) && (plan.AcceptedNb == 0));
+
+	brg.CloseBridge(COM_UNDEF_ALL);
+	brg.CloseStlink();
+}
+
+/**
+ * @brief Benchmark "canfilter": Plan() duration and plan quality for random identifier sets
+ *        (standard, extended, mixed) on the 14 banks, false-accept ratio as the banks run out,
+ *        Apply() duration with the USB latency of the simulated STLink.
+ */
+void BenchCanFilter(void)
+{
+	BrgTestBench bench(true);
+	Brg brg(bench.m_itf);
+	BrgCanFilterPlanner planner;
+	Brg_CanFilterPlanT plan;
+	std::vector<Brg_FilterBitsT> ids;
+	const uint32_t stdNbs[] = { 16, 64, 256, 1024 };
+	const uint32_t extNbs[] = { 8, 64, 256 };
+	const uint8_t bankNbs[] = { 14, 8, 4, 2, 1 };
+	uint64_t startNs, planNs, applyNs;
+	uint32_t i, r, extNb;
+	unsigned int c;
+
+	s_seed = 7;
+	for( c = 0; c < sizeof(stdNbs)/sizeof(stdNbs[0]) + sizeof(extNbs)/sizeof(extNbs[0]) + 1; c++ ) {
+		ids.clear();
+		if( c < sizeof(stdNbs)/sizeof(stdNbs[0]) ) {
+			for( i = 0; i < stdNbs[c]; i++ ) {
+				ids.push_back(MakeId(Rand() & 0x7FF, false, (Rand() & 3) == 0));
+			}
+			extNb = 0;
+		} else if( c < sizeof(stdNbs)/sizeof(stdNbs[0]) + sizeof(extNbs)/sizeof(extNbs[0]) ) {
+			extNb = extNbs[c - sizeof(stdNbs)/sizeof(stdNbs[0])];
+		} else {
+			for( i = 0; i < 32; i++ ) {
+				ids.push_back(MakeId(0x100 + (Rand() & 0xFF), false, false));
+			}
+			extNb = 32;
+		}
+		for( i = 0; i < extNb; i++ ) {
+			ids.push_back(MakeId(0x18DA0000 | (Rand() & 0xFFFF), true, false));
+		}
+		startNs = StlinkCmdStats::GetTimeNs();
+		for( r = 0; (r < TEST_FILTER_BENCH_REPEAT) &&
+		            ((r == 0) || (StlinkCmdStats::GetTimeNs() - startNs < TEST_FILTER_BENCH_NS)); r++ ) {
+			BRG_TEST_CHECK(planner.Plan(ids.data(), (uint32_t)ids.size()) == BRG_NO_ERR);
+		}
+		planNs = (StlinkCmdStats::GetTimeNs() - startNs) / r;
+		planner.GetPlan(&plan);
+		printf("Plan %4u std + %3u ext identifiers: %8.1f us, %2u banks, %3u exact, %3u masks, "
+		       "false-accept ratio %.3f\n", (unsigned int)(ids.size() - extNb), extNb, planNs/1000.0,
+		       plan.BankNb, plan.ExactNb, plan.MaskNb, plan.FalseAcceptRatio);
+	}
+
+	ids.clear();
+	for( i = 0; i < 40; i++ ) {
+		ids.push_back(MakeId(Rand() & 0x7FF, false, false));
+	}
+	for( c = 0; c < sizeof(bankNbs)/sizeof(bankNbs[0]); c++ ) {
+		BRG_TEST_CHECK(planner.Plan(ids.data(), (uint32_t)ids.size(), 0, bankNbs[c]) == BRG_NO_ERR);
+		planner.GetPlan(&plan);
+		printf("40 std identifiers on %2u banks: %2u exact, %2u masks, %5u accepted, false-accept ratio %.3f\n",
+		       bankNbs[c], plan.ExactNb, plan.MaskNb, (unsigned int)plan.AcceptedNb, plan.FalseAcceptRatio);
+	}
+
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+	InitCan(brg);
+	BRG_TEST_CHECK(planner.Plan(ids.data(), (uint32_t)ids.size()) == BRG_NO_ERR);
+	planner.GetPlan(&plan);
+	startNs = StlinkCmdStats::GetTimeNs();
+	BRG_TEST_CHECK(planner.Apply(brg) == BRG_NO_ERR);
+	applyNs = StlinkCmdStats::GetTimeNs() - startNs;
+	printf("Apply (%u banks): %.2f ms\n", plan.BankNb, applyNs/1000000.0);
+
+	brg.CloseBridge(COM_UNDEF_ALL);
+	brg.CloseStlink();
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,414 @@
+/**
+  ******************************************************************************
+  * @file    test_can_isotp.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "isotp": BrgCanIsoTp segmentation, flow control, STmin,
+  *          overflow and timeout, loopback and two devices throughput.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+#include "bridge_can_isotp.h"
+#include "stlink_cmd_stats.h"
+
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_ISOTP_SIZE_MAX      8000
+// Messages of the benchmarks: FF and 585 CFs
+#define TEST_ISOTP_BENCH_SIZE    4095
+#define TEST_ISOTP_BENCH_NB      20
+#define TEST_ISOTP_RX_TIMEOUT_MS 3000
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t s_txBuf[TEST_ISOTP_SIZE_MAX + 16];
+static uint8_t s_rxBuf[TEST_ISOTP_SIZE_MAX + 16];
+
+/*
+ * private: CAN at 1 Mbit/s in the given mode, all the frames accepted in FIFO0
+ */
+static void InitCan(Brg &BrgDevice, Brg_CanModeT Mode)
+{
+	Brg_CanInitT canInit;
+	Brg_CanFilterConfT filterConf;
+	uint32_t prescal, finalBaudrate;
+
+	memset(&canInit, 0, sizeof(canInit));
+	canInit.BitTimeConf.PropSegInTq = 1;
+	canInit.BitTimeConf.PhaseSeg1InTq = 4;
+	canInit.BitTimeConf.PhaseSeg2InTq = 2;
+	canInit.BitTimeConf.SjwInTq = 1;
+	BRG_TEST_CHECK(BrgDevice.GetCANbaudratePrescal(&canInit.BitTimeConf, 1000000, &prescal,
+	                                               &finalBaudrate) == BRG_NO_ERR);
+	canInit.Prescaler = prescal;
+	canInit.Mode = Mode;
+	BRG_TEST_CHECK(BrgDevice.InitCAN(&canInit, BRG_INIT_FULL) == BRG_NO_ERR);
+
+	memset(&filterConf, 0, sizeof(filterConf));
+	filterConf.bIsFilterEn = true;
+	filterConf.FilterMode = CAN_FILTER_ID_MASK;
+	filterConf.FilterScale = CAN_FILTER_32BIT;
+	filterConf.AssignedFifo = CAN_MSG_RX_FIFO0;
+	BRG_TEST_CHECK(BrgDevice.InitFilterCAN(&filterConf) == BRG_NO_ERR);
+}
+
+/*
+ * private: message of SizeInBytes bytes sent on link TxLink, received on link RxLink by a thread.
+ * Returns true if received unchanged, the Send() duration in pDurationNs.
+ */
+static bool Transfer(BrgCanIsoTp &IsoTp, uint8_t TxLink, uint8_t RxLink, uint32_t SizeInBytes, uint32_t Seed,
+                     uint64_t *pDurationNs=NULL)
+{
+	Brg_StatusT txStat, rxStat = BRG_NO_ERR;
+	uint32_t rxSize = 0;
+	uint64_t startNs, durationNs;
+	uint32_t i;
+
+	for( i = 0; i < SizeInBytes; i++ ) {
+		s_txBuf[i] = (uint8_t)(i*7 + Seed + (i >> 8));
+	}
+	std::thread receiver([&]() {
+		rxStat = IsoTp.Receive(RxLink, s_rxBuf, sizeof(s_rxBuf), &rxSize, TEST_ISOTP_RX_TIMEOUT_MS);
+	});
+	startNs = StlinkCmdStats::GetTimeNs();
+	txStat = IsoTp.Send(TxLink, s_txBuf, SizeInBytes);
+	durationNs = StlinkCmdStats::GetTimeNs() - startNs;
+	receiver.join();
+	if( pDurationNs != NULL ) {
+		*pDurationNs = durationNs;
+	}
+	return (txStat == BRG_NO_ERR) && (rxStat == BRG_NO_ERR) && (rxSize == SizeInBytes) &&
+	       (memcmp(s_txBuf, s_rxBuf, SizeInBytes) == 0);
+}
+
+/*
+ * private: links 0x700 -> 0x708 (returned in pTxLink) and 0x708 -> 0x700 (pRxLink, sending the FCs
+ * with the given BS and STmin)
+ */
+static void AddLinkPair(BrgCanIsoTp &IsoTp, uint8_t BlockSize, uint8_t STmin, uint8_t *pTxLink,
+                        uint8_t *pRxLink)
+{
+	Brg_CanIsoTpLinkConfT linkConf;
+
+	BrgCanIsoTp::GetDefaultLinkConf(&linkConf);
+	linkConf.TxId = 0x700;
+	linkConf.RxId = 0x708;
+	BRG_TEST_CHECK(IsoTp.AddLink(&linkConf, pTxLink) == BRG_NO_ERR);
+	linkConf.TxId = 0x708;
+	linkConf.RxId = 0x700;
+	linkConf.BlockSize = BlockSize;
+	linkConf.STmin = STmin;
+	BRG_TEST_CHECK(IsoTp.AddLink(&linkConf, pRxLink) == BRG_NO_ERR);
+}
+
+/**
+ * @ingroup TEST
+ * @brief Link parameter checks, messages of 1 to 7999 bytes (single frame, FF/CF boundaries, RxSizeMax),
+ *        other frames still queued, overflow FC, N_Bs and N_Cr timeouts, BS 8 and STmin (ms and us).
+ *        CAN loopback of a real time simulated bridge.
+ */
+void TestCanIsoTp(void)
+{
+	const uint32_t sizes[] = {62, 63, 64, 500, 4095, 4096, 7998, 7999};
+	BrgTestBench bench(true);
+	Brg brg(bench.m_itf);
+	BrgCanReceiver receiver(brg);
+	Brg_CanRxConfT rxConf;
+	Brg_CanIsoTpLinkConfT linkConf;
+	Brg_CanIsoTpStatsT txStats, rxStats;
+	Brg_CanRxFrameT frame;
+	Brg_CanTxMsgT txMsg;
+	uint8_t linkA, linkB, linkC, otherData[2] = {0x10, 0x55};
+	uint64_t startNs, durationNs;
+	uint32_t i, rxSize, otherNb;
+
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+	InitCan(brg, CAN_MODE_LOOPBACK);
+	BrgCanReceiver::GetDefaultConf(&rxConf);
+	rxConf.BitRate = 1000000;
+
+	{
+		BrgCanIsoTp isoTp(brg, receiver);
+
+		// A: 0x7E0 -> 0x7E8, B: 0x7E8 -> 0x7E0, C: no peer
+		BrgCanIsoTp::GetDefaultLinkConf(&linkConf);
+		linkConf.RxSizeMax = TEST_ISOTP_SIZE_MAX;
+		BRG_TEST_CHECK(isoTp.AddLink(&linkConf, &linkA) == BRG_NO_ERR);
+		linkConf.TxId = 0x7E8;
+		linkConf.RxId = 0x7E0;
+		BRG_TEST_CHECK(isoTp.AddLink(&linkConf, &linkB) == BRG_NO_ERR);
+		BRG_TEST_CHECK(isoTp.AddLink(&linkConf, &linkC) == BRG_PARAM_ERR);
+		linkConf.RxId = 0x7E8;
+		BRG_TEST_CHECK(isoTp.AddLink(&linkConf, &linkC) == BRG_PARAM_ERR);
+		linkConf.TxId = 0x800;
+		linkConf.RxId = 0x7E1;
+		BRG_TEST_CHECK(isoTp.AddLink(&linkConf, &linkC) == BRG_PARAM_ERR);
+		linkConf.TxId = 0x600;
+		linkConf.RxId = 0x601;
+		linkConf.STmin = 0x80;
+		BRG_TEST_CHECK(isoTp.AddLink(&linkConf, &linkC) == BRG_PARAM_ERR);
+		linkConf.STmin = 0;
+		linkConf.TimeoutMs = 200;
+		BRG_TEST_CHECK(isoTp.AddLink(&linkConf, &linkC) == BRG_NO_ERR);
+		rxConf.pHandler = &isoTp;
+		BRG_TEST_CHECK(receiver.Start(&rxConf) == BRG_NO_ERR);
+
+		// Single frames, first CFs, boundaries of the last CF, RxSizeMax
+		for( i = 1; i <= 21; i++ ) {
+			BRG_TEST_CHECK(Transfer(isoTp, linkA, linkB, i, i) == true);
+		}
+		for( i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++ ) {
+			BRG_TEST_CHECK(Transfer(isoTp, linkA, linkB, sizes[i], i) == true);
+		}
+		BRG_TEST_CHECK(Transfer(isoTp, linkB, linkA, 3000, 9) == true);
+		BRG_TEST_CHECK(isoTp.GetStats(linkA, &txStats) == BRG_NO_ERR);
+		BRG_TEST_CHECK((txStats.TxMsgNb == 21 + sizeof(sizes)/sizeof(sizes[0])) && (txStats.TxErrorNb == 0));
+		BRG_TEST_CHECK(txStats.MinFcUs <= txStats.MeanFcUs);
+
+		// Frames of other IDs (here a FF PCI) queued for PopFrame(), the ISO-TP ones are not
+		memset(&txMsg, 0, sizeof(txMsg));
+		txMsg.ID = 0x100;
+		BRG_TEST_CHECK(brg.WriteMsgCAN(&txMsg, otherData, 2) == BRG_NO_ERR);
+		std::this_thread::sleep_for(std::chrono::milliseconds(30));
+		otherNb = 0;
+		while( receiver.PopFrame(&frame) == true ) {
+			BRG_TEST_CHECK(frame.Msg.ID == 0x100);
+			otherNb++;
+		}
+		BRG_TEST_CHECK(otherNb == 1);
+
+		// Larger than RxSizeMax of B: overflow FC
+		BRG_TEST_CHECK(isoTp.Send(linkA, s_txBuf, TEST_ISOTP_SIZE_MAX + 1) == BRG_OVERRUN_ERR);
+		BRG_TEST_CHECK(isoTp.GetStats(linkB, &rxStats) == BRG_NO_ERR);
+		BRG_TEST_CHECK(rxStats.RxOverflowNb == 1);
+
+		// No peer: N_Bs timeout of a FF, single frame sent without FC, N_Cr timeout
+		startNs = StlinkCmdStats::GetTimeNs();
+		BRG_TEST_CHECK(isoTp.Send(linkC, s_txBuf, 100) == BRG_TARGET_CMD_TIMEOUT);
+		durationNs = StlinkCmdStats::GetTimeNs() - startNs;
+		BRG_TEST_CHECK((durationNs >= 190000000) && (durationNs < 400000000));
+		BRG_TEST_CHECK(isoTp.Send(linkC, s_txBuf, 7) == BRG_NO_ERR);
+		BRG_TEST_CHECK(isoTp.Receive(linkC, s_rxBuf, 16, &rxSize, 50) == BRG_TARGET_CMD_TIMEOUT);
+		BRG_TEST_CHECK(isoTp.GetStats(linkC, &txStats) == BRG_NO_ERR);
+		BRG_TEST_CHECK((txStats.TxErrorNb == 1) && (txStats.LastError == BRG_TARGET_CMD_TIMEOUT));
+		receiver.Stop();
+	}
+
+	// BS 8: one FC per 8 CFs (4095 bytes: FF, 585 CFs, 74 FCs)
+	{
+		BrgCanIsoTp isoTp(brg, receiver);
+
+		AddLinkPair(isoTp, 8, 0, &linkA, &linkB);
+		rxConf.pHandler = &isoTp;
+		BRG_TEST_CHECK(receiver.Start(&rxConf) == BRG_NO_ERR);
+		BRG_TEST_CHECK(Transfer(isoTp, linkA, linkB, 4095, 5) == true);
+		isoTp.GetStats(linkA, &txStats);
+		isoTp.GetStats(linkB, &rxStats);
+		BRG_TEST_CHECK(txStats.TxFrameNb == 1 + 585);
+		BRG_TEST_CHECK(rxStats.TxFrameNb == 1 + 73);
+		receiver.Stop();
+	}
+
+	// STmin 2 ms and 500 us (0xF5): 300 bytes, FF and 42 CFs, at least STmin between two CFs
+	{
+		BrgCanIsoTp isoTp(brg, receiver);
+
+		AddLinkPair(isoTp, 0, 2, &linkA, &linkB);
+		rxConf.pHandler = &isoTp;
+		BRG_TEST_CHECK(receiver.Start(&rxConf) == BRG_NO_ERR);
+		BRG_TEST_CHECK(Transfer(isoTp, linkA, linkB, 300, 6, &durationNs) == true);
+		BRG_TEST_CHECK(durationNs >= 41*2000000ULL);
+		receiver.Stop();
+	}
+	{
+		BrgCanIsoTp isoTp(brg, receiver);
+
+		AddLinkPair(isoTp, 0, 0xF5, &linkA, &linkB);
+		rxConf.pHandler = &isoTp;
+		BRG_TEST_CHECK(receiver.Start(&rxConf) == BRG_NO_ERR);
+		BRG_TEST_CHECK(Transfer(isoTp, linkA, linkB, 300, 6, &durationNs) == true);
+		BRG_TEST_CHECK(durationNs >= 41*500000ULL);
+		receiver.Stop();
+	}
+
+	brg.CloseBridge(COM_UNDEF_ALL);
+	brg.CloseStlink();
+}
+
+/**
+ * @ingroup TEST
+ * @brief 4095-byte messages (real time simulation, 1 Mbit/s): throughput over the CAN loopback with
+ *        immediate and deferred status, and between two devices with the engine against an
+ *        application polling Brg::GetRxMsgNbCAN() every ms for the FC and sending the CFs one by one.
+ */
+void BenchCanIsoTp(void)
+{
+	BrgTestBench bench(true, 2);
+	Brg brg(bench.m_itf), ecu(bench.m_itf);
+	BrgCanReceiver receiver(brg), ecuReceiver(ecu);
+	Brg_CanRxConfT rxConf;
+	Brg_CanIsoTpLinkConfT linkConf;
+	Brg_CanIsoTpStatsT stats;
+	Brg_CanRxStatsT rxStats;
+	Brg_CanTxMsgT txMsg;
+	Brg_CanRxMsgT rxMsg[8];
+	uint8_t frame[8], rxData[64];
+	uint8_t linkA, linkB, ecuLink, sn;
+	uint64_t startNs, durationNs, totalNs, appNs, engineNs;
+	uint32_t i, offset, size;
+	uint16_t msgNb, dataSize;
+	int mode, ecuOkNb = 0;
+	bool bOk;
+
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+	InitCan(brg, CAN_MODE_LOOPBACK);
+	BrgCanReceiver::GetDefaultConf(&rxConf);
+	rxConf.BitRate = 1000000;
+	for( mode = 0; mode < 2; mode++ ) {
+		BrgCanIsoTp isoTp(brg, receiver);
+
+		AddLinkPair(isoTp, 0, 0, &linkA, &linkB);
+		BRG_TEST_CHECK(brg.SetRwStatusMode((mode == 0) ? RW_STATUS_IMMEDIATE : RW_STATUS_DEFERRED) == BRG_NO_ERR);
+		rxConf.pHandler = &isoTp;
+		BRG_TEST_CHECK(receiver.Start(&rxConf) == BRG_NO_ERR);
+		totalNs = 0;
+		bOk = true;
+		for( i = 0; i < TEST_ISOTP_BENCH_NB; i++ ) {
+			bOk &= Transfer(isoTp, linkA, linkB, TEST_ISOTP_BENCH_SIZE, i, &durationNs);
+			totalNs += durationNs;
+		}
+		BRG_TEST_CHECK(bOk == true);
+		isoTp.GetStats(linkA, &stats);
+		receiver.GetStats(&rxStats);
+		printf("Loopback, %s status: %.1f ms/msg, %.1f KB/s, FC %u..%u us (mean %u), overruns %u\n",
+		       (mode == 0) ? "immediate" : "deferred", (double)totalNs/TEST_ISOTP_BENCH_NB/1000000,
+		       (double)TEST_ISOTP_BENCH_SIZE*TEST_ISOTP_BENCH_NB*1000000000/1024/totalNs,
+		       stats.MinFcUs, stats.MaxFcUs, stats.MeanFcUs, rxStats.OverrunNb);
+		receiver.Stop();
+	}
+	BRG_TEST_CHECK(brg.SetRwStatusMode(RW_STATUS_IMMEDIATE) == BRG_NO_ERR);
+	brg.CloseBridge(COM_CAN);
+
+	// Two devices on the bus: tester (device 0) to ECU engine (device 1)
+	InitCan(brg, CAN_MODE_NORMAL);
+	BRG_TEST_CHECK(ecu.OpenStlink(1) == BRG_NO_ERR);
+	InitCan(ecu, CAN_MODE_NORMAL);
+	BRG_TEST_CHECK(ecu.SetRwStatusMode(RW_STATUS_DEFERRED) == BRG_NO_ERR);
+	for( i = 0; i < TEST_ISOTP_BENCH_SIZE; i++ ) {
+		s_txBuf[i] = (uint8_t)(i*7 + 1 + (i >> 8));
+	}
+	{
+		BrgCanIsoTp ecuIsoTp(ecu, ecuReceiver);
+		BrgCanIsoTp isoTp(brg, receiver);
+		Brg_CanRxConfT ecuRxConf;
+
+		BrgCanIsoTp::GetDefaultLinkConf(&linkConf);
+		linkConf.TxId = 0x7E8;
+		linkConf.RxId = 0x7E0;
+		BRG_TEST_CHECK(ecuIsoTp.AddLink(&linkConf, &ecuLink) == BRG_NO_ERR);
+		BrgCanReceiver::GetDefaultConf(&ecuRxConf);
+		ecuRxConf.pHandler = &ecuIsoTp;
+		BRG_TEST_CHECK(ecuReceiver.Start(&ecuRxConf) == BRG_NO_ERR);
+		std::thread ecuThread([&]() {
+			uint32_t rxSize;
+			for( int k = 0; k < 2*TEST_ISOTP_BENCH_NB; k++ ) {
+				if( (ecuIsoTp.Receive(ecuLink, s_rxBuf, sizeof(s_rxBuf), &rxSize, 5000) == BRG_NO_ERR) &&
+				    (rxSize == TEST_ISOTP_BENCH_SIZE) && (memcmp(s_rxBuf, s_txBuf, rxSize) == 0) ) {
+					ecuOkNb++;
+				}
+			}
+		});
+
+		// Application: FF, FC polled every ms, CFs written one by one (no BS, no STmin from the ECU)
+		memset(&txMsg, 0, sizeof(txMsg));
+		txMsg.ID = 0x7E0;
+		txMsg.DLC = 8;
+		BRG_TEST_CHECK(brg.StartMsgReceptionCAN() == BRG_NO_ERR);
+		startNs = StlinkCmdStats::GetTimeNs();
+		for( i = 0; i < TEST_ISOTP_BENCH_NB; i++ ) {
+			frame[0] = 0x10 | (uint8_t)(TEST_ISOTP_BENCH_SIZE >> 8);
+			frame[1] = (uint8_t)TEST_ISOTP_BENCH_SIZE;
+			memcpy(&frame[2], s_txBuf, 6);
+			brg.WriteMsgCAN(&txMsg, frame, 8);
+			for( ;; ) {
+				msgNb = 0;
+				brg.GetRxMsgNbCAN(&msgNb);
+				if( msgNb != 0 ) {
+					brg.GetRxMsgCAN(rxMsg, (msgNb > 8) ? 8 : msgNb, rxData, sizeof(rxData), &dataSize);
+					if( rxData[0] == 0x30 ) {
+						break;
+					}
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			offset = 6;
+			sn = 1;
+			while( offset < TEST_ISOTP_BENCH_SIZE ) {
+				size = TEST_ISOTP_BENCH_SIZE - offset;
+				if( size > 7 ) {
+					size = 7;
+				}
+				frame[0] = 0x20 | sn;
+				sn = (sn + 1) & 0x0F;
+				memcpy(&frame[1], &s_txBuf[offset], size);
+				memset(&frame[1 + size], 0xCC, 7 - size);
+				brg.WriteMsgCAN(&txMsg, frame, 8);
+				offset += size;
+			}
+		}
+		appNs = StlinkCmdStats::GetTimeNs() - startNs;
+		BRG_TEST_CHECK(brg.StopMsgReceptionCAN() == BRG_NO_ERR);
+
+		// Engine
+		BrgCanIsoTp::GetDefaultLinkConf(&linkConf);
+		BRG_TEST_CHECK(isoTp.AddLink(&linkConf, &linkA) == BRG_NO_ERR);
+		BrgCanReceiver::GetDefaultConf(&rxConf);
+		rxConf.pHandler = &isoTp;
+		BRG_TEST_CHECK(receiver.Start(&rxConf) == BRG_NO_ERR);
+		BRG_TEST_CHECK(brg.SetRwStatusMode(RW_STATUS_DEFERRED) == BRG_NO_ERR);
+		startNs = StlinkCmdStats::GetTimeNs();
+		for( i = 0; i < TEST_ISOTP_BENCH_NB; i++ ) {
+			BRG_TEST_CHECK(isoTp.Send(linkA, s_txBuf, TEST_ISOTP_BENCH_SIZE) == BRG_NO_ERR);
+		}
+		engineNs = StlinkCmdStats::GetTimeNs() - startNs;
+		ecuThread.join();
+		BRG_TEST_CHECK(ecuOkNb == 2*TEST_ISOTP_BENCH_NB);
+		isoTp.GetStats(linkA, &stats);
+		printf("Two devices: application polling %.1f ms/msg (%.1f KB/s), engine %.1f ms/msg (%.1f KB/s), "
+		       "FC mean %u us\n", (double)appNs/TEST_ISOTP_BENCH_NB/1000000,
+		       (double)TEST_ISOTP_BENCH_SIZE*TEST_ISOTP_BENCH_NB*1000000000/1024/appNs,
+		       (double)engineNs/TEST_ISOTP_BENCH_NB/1000000,
+		       (double)TEST_ISOTP_BENCH_SIZE*TEST_ISOTP_BENCH_NB*1000000000/1024/engineNs, stats.MeanFcUs);
+		receiver.Stop();
+		ecuReceiver.Stop();
+	}
+
+	brg.CloseBridge(COM_UNDEF_ALL);
+	brg.CloseStlink();
+	ecu.CloseBridge(COM_UNDEF_ALL);
+	ecu.CloseStlink();
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
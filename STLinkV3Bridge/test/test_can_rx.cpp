@@ -0,0 +1,374 @@
+/**
+  ******************************************************************************
+  * @file    test_can_rx.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "canrx": BrgCanReceiver frames decoded from the simulated
+  *          bus, queue full and wrap, timestamps, STLink RX buffer overrun.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+#include "bridge_can_rx.h"
+
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_CANRX_QUEUE_SIZE  16
+#define TEST_CANRX_TIMEOUT_MS  2000
+// Poll interval long enough to fill the STLink RX buffer between two polls
+#define TEST_CANRX_SLOW_POLL_US 300000
+// Frames of the timestamp check, injected TEST_CANRX_TIME_GAP_US apart (more than a frame at 1 Mbit/s)
+#define TEST_CANRX_TIME_NB     40
+#define TEST_CANRX_TIME_GAP_US 200
+
+/* Private typedef -----------------------------------------------------------*/
+// Frame injected on the simulated bus
+typedef struct {
+	uint32_t ID;
+	bool bIde;
+	bool bRtr;
+	uint8_t DLC;
+} TestCanRxRefT;
+
+/* Private variables ---------------------------------------------------------*/
+// Standard and extended identifiers (limits included), data and remote frames, DLC 0 to 8
+static const TestCanRxRefT s_decodeRef[] = {
+	{ 0x123, false, false, 8 },
+	{ 0x1ABCDEF0, true, false, 3 },
+	{ 0x7FF, false, true, 4 },
+	{ 0x1FFFFFFF, true, true, 0 },
+	{ 0x000, false, false, 0 },
+	{ 0x00000001, true, false, 8 },
+	{ 0x400, false, true, 8 },
+};
+
+/*
+ * private: CAN at 1 Mbit/s in normal mode (frames of BrgSimTransport::InjectCanFrame() received),
+ * all the frames accepted in FIFO0
+ */
+static void InitCan(Brg &BrgDevice)
+{
+	Brg_CanInitT canInit;
+	Brg_CanFilterConfT filterConf;
+	uint32_t prescal, finalBaudrate;
+
+	memset(&canInit, 0, sizeof(canInit));
+	canInit.BitTimeConf.PropSegInTq = 1;
+	canInit.BitTimeConf.PhaseSeg1InTq = 4;
+	canInit.BitTimeConf.PhaseSeg2InTq = 2;
+	canInit.BitTimeConf.SjwInTq = 1;
+	BRG_TEST_CHECK(BrgDevice.GetCANbaudratePrescal(&canInit.BitTimeConf, 1000000, &prescal,
+	                                               &finalBaudrate) == BRG_NO_ERR);
+	canInit.Prescaler = prescal;
+	canInit.Mode = CAN_MODE_NORMAL;
+	BRG_TEST_CHECK(BrgDevice.InitCAN(&canInit, BRG_INIT_FULL) == BRG_NO_ERR);
+
+	memset(&filterConf, 0, sizeof(filterConf));
+	filterConf.bIsFilterEn = true;
+	filterConf.FilterMode = CAN_FILTER_ID_MASK;
+	filterConf.FilterScale = CAN_FILTER_32BIT;
+	filterConf.AssignedFifo = CAN_MSG_RX_FIFO0;
+	BRG_TEST_CHECK(BrgDevice.InitFilterCAN(&filterConf) == BRG_NO_ERR);
+}
+
+/*
+ * private: data byte Idx of a frame
+ */
+static uint8_t GetRefData(uint32_t Id, uint32_t Idx)
+{
+	return (uint8_t)(Id + Idx*17 + (Id >> 8));
+}
+
+/*
+ * private: frame sent on the simulated bus by another node
+ */
+static void InjectFrame(BrgSimTransport &Sim, const TestCanRxRefT *pRef)
+{
+	BrgSimCanFrameT frame;
+	uint32_t i;
+
+	memset(&frame, 0, sizeof(frame));
+	frame.ID = pRef->ID;
+	frame.bIde = pRef->bIde;
+	frame.bRtr = pRef->bRtr;
+	frame.DLC = pRef->DLC;
+	for( i = 0; i < 8; i++ ) {
+		frame.Data[i] = GetRefData(pRef->ID, i);
+	}
+	BRG_TEST_CHECK(Sim.InjectCanFrame(&frame) == SS_OK);
+}
+
+/*
+ * private: data frame of standard identifier Id (0 to 0x7FF), 2 data bytes
+ */
+static void InjectStdFrame(BrgSimTransport &Sim, uint32_t Id)
+{
+	TestCanRxRefT ref = { Id, false, false, 2 };
+
+	InjectFrame(Sim, &ref);
+}
+
+/*
+ * private: frame received equal to the injected one
+ */
+static bool IsSameFrame(const Brg_CanRxFrameT *pFrame, const TestCanRxRefT *pRef)
+{
+	uint32_t i;
+
+	if( (pFrame->Msg.ID != pRef->ID) || (pFrame->Msg.DLC != pRef->DLC) ||
+	    (pFrame->Msg.IDE != ((pRef->bIde == true) ? CAN_ID_EXTENDED : CAN_ID_STANDARD)) ||
+	    (pFrame->Msg.RTR != ((pRef->bRtr == true) ? CAN_REMOTE_FRAME : CAN_DATA_FRAME)) ||
+	    (pFrame->Msg.Fifo != CAN_MSG_RX_FIFO0) ) {
+		return false;
+	}
+	if( pRef->bRtr == false ) {
+		for( i = 0; i < pRef->DLC; i++ ) {
+			if( pFrame->Data[i] != GetRefData(pRef->ID, i) ) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/*
+ * private: waits until the receiver retrieved FrameNb frames from the STLink since Start()
+ */
+static bool WaitFrameNb(BrgCanReceiver &Receiver, uint32_t FrameNb)
+{
+	Brg_CanRxStatsT stats;
+	int ms;
+
+	for( ms = 0; ms < TEST_CANRX_TIMEOUT_MS; ms++ ) {
+		Receiver.GetStats(&stats);
+		if( stats.FrameNb >= FrameNb ) {
+			return (stats.FrameNb == FrameNb);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return false;
+}
+
+/*
+ * private: next frame of the queue is the standard data frame Id with the sequence number SeqNb
+ */
+static bool PopStdFrame(BrgCanReceiver &Receiver, uint32_t Id, uint32_t SeqNb)
+{
+	TestCanRxRefT ref = { Id, false, false, 2 };
+	Brg_CanRxFrameT frame;
+
+	return (Receiver.PopFrame(&frame) == true) && (frame.SeqNb == SeqNb) && IsSameFrame(&frame, &ref) &&
+	       (frame.Msg.Overrun == CAN_RX_NO_OVERRUN);
+}
+
+/*
+ * private: times of the frames injected by TestCanRx(), in SeqNb order: TimestampNs within
+ * [TimeMinNs, TimeMaxNs] and non-decreasing, bounds holding the injection time (between
+ * pInjectNs[2*i] and pInjectNs[2*i + 1]), after StartNs (TimeMinNs 0 for the first poll) and before
+ * EndNs. Returns the number of wrong frames.
+ */
+static uint32_t CheckFrameTimes(const Brg_CanRxFrameT *pFrames, uint32_t FrameNb, const uint64_t *pInjectNs,
+                                uint64_t StartNs, uint64_t EndNs)
+{
+	uint64_t lastNs = 0;
+	uint32_t errorNb = 0;
+	uint32_t i;
+
+	for( i = 0; i < FrameNb; i++ ) {
+		if( (pFrames[i].TimestampNs < pFrames[i].TimeMinNs) || (pFrames[i].TimestampNs > pFrames[i].TimeMaxNs) ||
+		    (pFrames[i].TimestampNs < lastNs) ||
+		    (pFrames[i].TimeMinNs > pInjectNs[2*i + 1]) || (pFrames[i].TimeMaxNs < pInjectNs[2*i]) ||
+		    ((pFrames[i].TimeMinNs != 0) && (pFrames[i].TimeMinNs < StartNs)) || (pFrames[i].TimeMaxNs > EndNs) ) {
+			errorNb++;
+		}
+		lastNs = pFrames[i].TimestampNs;
+	}
+	return errorNb;
+}
+
+/**
+ * @ingroup TEST
+ * @brief Frames injected on the simulated bus and read back through the STLink firmware answer and
+ *        BrgCanReceiver: standard and extended identifiers, remote frames (no data), DLC 0 to 8.
+ *        Queue full (frames dropped, SeqNb gap) and queue wrap, frames spread over several polls received
+ *        in order with consistent timestamps, STLink RX buffer overrun flagged on the next frame
+ *        received, with Brg::GetRxMsgCAN() and through the receiver.
+ */
+void TestCanRx(void)
+{
+	BrgTestBench bench(false);
+	Brg brg(bench.m_itf);
+	BrgCanReceiver receiver(brg);
+	Brg_CanRxConfT conf;
+	Brg_CanRxFrameT frame;
+	Brg_CanRxFrameT timeFrames[TEST_CANRX_TIME_NB];
+	Brg_CanRxStatsT stats;
+	uint64_t injectNs[2*TEST_CANRX_TIME_NB];
+	uint64_t startNs;
+	Brg_CanRxMsgT msgs[BRG_SIM_CAN_RX_BUFF_NB];
+	uint8_t data[BRG_SIM_CAN_RX_BUFF_NB*8];
+	uint32_t i, round, seqNb, errorNb;
+	uint16_t msgNb, dataSize;
+
+	BRG_TEST_CHECK(receiver.Start() == BRG_NO_STLINK);
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+	InitCan(brg);
+
+	BrgCanReceiver::GetDefaultConf(&conf);
+	conf.QueueSize = TEST_CANRX_QUEUE_SIZE;
+	conf.MinPollUs = 100;
+	conf.BitRate = 1000000;
+	conf.MaxPollUs = 0;
+	BRG_TEST_CHECK(receiver.Start(&conf) == BRG_PARAM_ERR);
+	conf.MaxPollUs = 1000;
+
+	// Decoding of the firmware answer: identifiers, IDE, RTR, DLC, data
+	BRG_TEST_CHECK(receiver.Start(&conf) == BRG_NO_ERR);
+	for( i = 0; i < sizeof(s_decodeRef)/sizeof(s_decodeRef[0]); i++ ) {
+		InjectFrame(bench.m_sim, &s_decodeRef[i]);
+	}
+	BRG_TEST_CHECK(WaitFrameNb(receiver, sizeof(s_decodeRef)/sizeof(s_decodeRef[0])) == true);
+	errorNb = 0;
+	for( i = 0; i < sizeof(s_decodeRef)/sizeof(s_decodeRef[0]); i++ ) {
+		if( (receiver.PopFrame(&frame) == false) || (frame.SeqNb != i) ||
+		    (IsSameFrame(&frame, &s_decodeRef[i]) == false) || (frame.Msg.Overrun != CAN_RX_NO_OVERRUN) ) {
+			errorNb++;
+		}
+	}
+	BRG_TEST_CHECK(errorNb == 0);
+	BRG_TEST_CHECK(receiver.PopFrame(&frame) == false);
+
+	// Queue full: the frames beyond TEST_CANRX_QUEUE_SIZE are dropped but take a SeqNb
+	seqNb = sizeof(s_decodeRef)/sizeof(s_decodeRef[0]);
+	for( i = 0; i < 40; i++ ) {
+		InjectStdFrame(bench.m_sim, 0x100 + i);
+	}
+	BRG_TEST_CHECK(WaitFrameNb(receiver, seqNb + 40) == true);
+	receiver.GetStats(&stats);
+	BRG_TEST_CHECK(stats.DropNb == 40 - TEST_CANRX_QUEUE_SIZE);
+	errorNb = 0;
+	for( i = 0; i < TEST_CANRX_QUEUE_SIZE; i++ ) {
+		if( PopStdFrame(receiver, 0x100 + i, seqNb + i) == false ) {
+			errorNb++;
+		}
+	}
+	BRG_TEST_CHECK(errorNb == 0);
+	BRG_TEST_CHECK(receiver.PopFrame(&frame) == false);
+	seqNb += 40;
+
+	// Queue slots reused: frames in order over several wraps, SeqNb gap only after the drops above
+	errorNb = 0;
+	for( round = 0; round < 5; round++ ) {
+		for( i = 0; i < TEST_CANRX_QUEUE_SIZE - 3; i++ ) {
+			InjectStdFrame(bench.m_sim, 0x200 + round*16 + i);
+		}
+		BRG_TEST_CHECK(WaitFrameNb(receiver, seqNb + TEST_CANRX_QUEUE_SIZE - 3) == true);
+		for( i = 0; i < TEST_CANRX_QUEUE_SIZE - 3; i++ ) {
+			if( PopStdFrame(receiver, 0x200 + round*16 + i, seqNb++) == false ) {
+				errorNb++;
+			}
+		}
+	}
+	BRG_TEST_CHECK(errorNb == 0);
+	receiver.GetStats(&stats);
+	BRG_TEST_CHECK(stats.DropNb == 40 - TEST_CANRX_QUEUE_SIZE);
+	BRG_TEST_CHECK((stats.OverrunNb == 0) && (stats.ErrorNb == 0));
+	receiver.Stop();
+
+	// Timestamps: frames injected one by one over several polls, popped in order, injection time within
+	// the bounds of each frame
+	conf.QueueSize = TEST_CANRX_TIME_NB;
+	startNs = BrgCanReceiver::GetTimeNs();
+	BRG_TEST_CHECK(receiver.Start(&conf) == BRG_NO_ERR);
+	for( i = 0; i < TEST_CANRX_TIME_NB; i++ ) {
+		injectNs[2*i] = BrgCanReceiver::GetTimeNs();
+		InjectStdFrame(bench.m_sim, 0x300 + i);
+		injectNs[2*i + 1] = BrgCanReceiver::GetTimeNs();
+		std::this_thread::sleep_for(std::chrono::microseconds(TEST_CANRX_TIME_GAP_US));
+	}
+	BRG_TEST_CHECK(WaitFrameNb(receiver, TEST_CANRX_TIME_NB) == true);
+	errorNb = 0;
+	for( i = 0; i < TEST_CANRX_TIME_NB; i++ ) {
+		TestCanRxRefT ref = { 0x300 + i, false, false, 2 };
+		if( (receiver.PopFrame(&timeFrames[i]) == false) || (timeFrames[i].SeqNb != i) ||
+		    (IsSameFrame(&timeFrames[i], &ref) == false) ) {
+			errorNb++;
+		}
+	}
+	BRG_TEST_CHECK(errorNb == 0);
+	BRG_TEST_CHECK(CheckFrameTimes(timeFrames, TEST_CANRX_TIME_NB, injectNs, startNs,
+	                               BrgCanReceiver::GetTimeNs()) == 0);
+	receiver.Stop();
+	BRG_TEST_CHECK(receiver.PopFrame(&frame) == false);
+	receiver.GetStats(&stats);
+	BRG_TEST_CHECK((stats.PollNb - stats.EmptyPollNb) > 1);
+
+	// STLink RX buffer overrun with Brg::GetRxMsgCAN(): flag on the first message received after it
+	BRG_TEST_CHECK(brg.StartMsgReceptionCAN() == BRG_NO_ERR);
+	for( i = 0; i < BRG_SIM_CAN_RX_BUFF_NB + 10; i++ ) {
+		InjectStdFrame(bench.m_sim, i & 0x7FF);
+	}
+	BRG_TEST_CHECK((brg.GetRxMsgNbCAN(&msgNb) == BRG_NO_ERR) && (msgNb == BRG_SIM_CAN_RX_BUFF_NB));
+	BRG_TEST_CHECK(brg.GetRxMsgCAN(msgs, msgNb, data, sizeof(data), &dataSize) == BRG_NO_ERR);
+	BRG_TEST_CHECK((msgs[msgNb - 1].ID == BRG_SIM_CAN_RX_BUFF_NB - 1) && (dataSize == msgNb*2));
+	InjectStdFrame(bench.m_sim, 0x555);
+	BRG_TEST_CHECK((brg.GetRxMsgNbCAN(&msgNb) == BRG_NO_ERR) && (msgNb == 1));
+	BRG_TEST_CHECK(brg.GetRxMsgCAN(msgs, 1, data, sizeof(data), &dataSize) == BRG_OVERRUN_ERR);
+	BRG_TEST_CHECK((msgs[0].ID == 0x555) && (msgs[0].Overrun == CAN_RX_BUFF_OVERRUN));
+	BRG_TEST_CHECK(brg.StopMsgReceptionCAN() == BRG_NO_ERR);
+
+	// Same through the receiver, polling slower than the frames fill the STLink buffer
+	conf.MinPollUs = TEST_CANRX_SLOW_POLL_US;
+	conf.MaxPollUs = TEST_CANRX_SLOW_POLL_US;
+	conf.QueueSize = BRG_SIM_CAN_RX_BUFF_NB*2;
+	BRG_TEST_CHECK(receiver.Start(&conf) == BRG_NO_ERR);
+	do {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		receiver.GetStats(&stats);
+	} while( stats.PollNb == 0 );
+	for( i = 0; i < BRG_SIM_CAN_RX_BUFF_NB + 10; i++ ) {
+		InjectStdFrame(bench.m_sim, i & 0x7FF);
+	}
+	BRG_TEST_CHECK(WaitFrameNb(receiver, BRG_SIM_CAN_RX_BUFF_NB) == true);
+	InjectStdFrame(bench.m_sim, 0x555);
+	BRG_TEST_CHECK(WaitFrameNb(receiver, BRG_SIM_CAN_RX_BUFF_NB + 1) == true);
+	errorNb = 0;
+	for( i = 0; i < BRG_SIM_CAN_RX_BUFF_NB; i++ ) {
+		if( PopStdFrame(receiver, i, i) == false ) {
+			errorNb++;
+		}
+	}
+	BRG_TEST_CHECK(errorNb == 0);
+	BRG_TEST_CHECK((receiver.PopFrame(&frame) == true) && (frame.Msg.ID == 0x555) &&
+	               (frame.Msg.Overrun == CAN_RX_BUFF_OVERRUN) && (frame.SeqNb == BRG_SIM_CAN_RX_BUFF_NB));
+	receiver.GetStats(&stats);
+	BRG_TEST_CHECK((stats.OverrunNb == 1) && (stats.DropNb == 0) && (stats.ErrorNb == 0));
+	receiver.Stop();
+
+	brg.CloseBridge(COM_UNDEF_ALL);
+	brg.CloseStlink();
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
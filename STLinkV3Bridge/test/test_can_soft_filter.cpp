@@ -0,0 +1,538 @@
+/**
+  ******************************************************************************
+  * @file    test_can_soft_filter.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "cansoft": BrgCanSoftFilter accept/reject decisions
+  *          compared with a linear reference, batch evaluation, receiver
+  *          frames discarded by the host filter.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+#include "bridge_can_soft_filter.h"
+#include "bridge_can_rx.h"
+#include "stlink_cmd_stats.h"
+
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/* Private defines -----------------------------------------------------------*/
+// Extended identifiers added one by one (hash set grown several times)
+#define TEST_SOFT_EXT_ID_NB   1000
+// Extended ranges (range list grown), random identifiers checked against the reference
+#define TEST_SOFT_RANGE_NB    40
+#define TEST_SOFT_RANDOM_NB   100000
+// Messages of the batch checks (more than a FilterArrays() chunk)
+#define TEST_SOFT_BATCH_NB    700
+// Frames injected for the receiver check
+#define TEST_SOFT_RX_NB       20
+#define TEST_SOFT_TIMEOUT_MS  2000
+// Benchmark: messages per Evaluate() call and calls timed per line
+#define TEST_SOFT_BENCH_NB     256
+#define TEST_SOFT_BENCH_REPEAT 4000
+
+/* Private typedef -----------------------------------------------------------*/
+// Accepted identifiers FirstId to LastId included
+typedef struct {
+	Brg_CanMsgIdT IDE;
+	uint32_t FirstId;
+	uint32_t LastId;
+} TestSoftRangeT;
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t s_seed;
+
+/* Private functions ---------------------------------------------------------*/
+/*
+ * private: pseudo-random number (LCG)
+ */
+static uint32_t Rand(void)
+{
+	s_seed = s_seed*1103515245 + 12345;
+	return s_seed >> 8;
+}
+
+/*
+ * private: pseudo-random extended identifier (29 bits)
+ */
+static uint32_t RandExtId(void)
+{
+	return ((Rand() << 8) ^ Rand()) & 0x1FFFFFFF;
+}
+
+/*
+ * private: reference decision, linear search of the identifiers added to the filter
+ */
+static bool IsRefAccepted(const std::vector<TestSoftRangeT> &Ref, Brg_CanMsgIdT IDE, uint32_t ID)
+{
+	size_t i;
+
+	for( i = 0; i < Ref.size(); i++ ) {
+		if( (Ref[i].IDE == IDE) && (Ref[i].FirstId <= ID) && (ID <= Ref[i].LastId) ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * private: adds a range to the filter and to the reference
+ */
+static void AddRef(BrgCanSoftFilter &Filter, std::vector<TestSoftRangeT> &Ref, Brg_CanMsgIdT IDE,
+                   uint32_t FirstId, uint32_t LastId)
+{
+	TestSoftRangeT range = { IDE, FirstId, LastId };
+
+	BRG_TEST_CHECK(Filter.AddRange(IDE, FirstId, LastId) == BRG_NO_ERR);
+	Ref.push_back(range);
+}
+
+/*
+ * private: returns the number of identifiers whose decision differs from the reference: all the
+ * standard ones, the limits and neighbours of the reference ranges, RandomNb random extended ones
+ */
+static uint32_t CheckRef(const BrgCanSoftFilter &Filter, const std::vector<TestSoftRangeT> &Ref,
+                         uint32_t RandomNb)
+{
+	const uint32_t extIds[] = { 0, 1, 0x7FF, 0x800, 0x1FFFFFFE, 0x1FFFFFFF };
+	uint32_t errorNb = 0, i, id;
+	size_t r;
+
+	for( id = 0; id <= 0x7FF; id++ ) {
+		errorNb += (Filter.IsAccepted(CAN_ID_STANDARD, id) != IsRefAccepted(Ref, CAN_ID_STANDARD, id)) ? 1 : 0;
+	}
+	for( i = 0; i < sizeof(extIds)/sizeof(extIds[0]); i++ ) {
+		id = extIds[i];
+		errorNb += (Filter.IsAccepted(CAN_ID_EXTENDED, id) != IsRefAccepted(Ref, CAN_ID_EXTENDED, id)) ? 1 : 0;
+	}
+	for( r = 0; r < Ref.size(); r++ ) {
+		if( Ref[r].IDE != CAN_ID_EXTENDED ) {
+			continue;
+		}
+		for( i = 0; i < 4; i++ ) {
+			id = ((i < 2) ? Ref[r].FirstId : Ref[r].LastId) + (i & 1) - ((i < 2) ? 1 : 0);
+			if( id <= 0x1FFFFFFF ) {
+				errorNb += (Filter.IsAccepted(CAN_ID_EXTENDED, id) !=
+				            IsRefAccepted(Ref, CAN_ID_EXTENDED, id)) ? 1 : 0;
+			}
+		}
+	}
+	for( i = 0; i < RandomNb; i++ ) {
+		id = RandExtId();
+		errorNb += (Filter.IsAccepted(CAN_ID_EXTENDED, id) != IsRefAccepted(Ref, CAN_ID_EXTENDED, id)) ? 1 : 0;
+	}
+	return errorNb;
+}
+
+/*
+ * private: CAN at 1 Mbit/s in normal mode, all the frames accepted in FIFO0 by the filter banks
+ */
+static void InitCan(Brg &BrgDevice)
+{
+	Brg_CanInitT canInit;
+	Brg_CanFilterConfT filterConf;
+	uint32_t prescal, finalBaudrate;
+
+	memset(&canInit, 0, sizeof(canInit));
+	canInit.BitTimeConf.PropSegInTq = 1;
+	canInit.BitTimeConf.PhaseSeg1InTq = 4;
+	canInit.BitTimeConf.PhaseSeg2InTq = 2;
+	canInit.BitTimeConf.SjwInTq = 1;
+	BRG_TEST_CHECK(BrgDevice.GetCANbaudratePrescal(&canInit.BitTimeConf, 1000000, &prescal,
+	                                               &finalBaudrate) == BRG_NO_ERR);
+	canInit.Prescaler = prescal;
+	canInit.Mode = CAN_MODE_NORMAL;
+	BRG_TEST_CHECK(BrgDevice.InitCAN(&canInit, BRG_INIT_FULL) == BRG_NO_ERR);
+
+	memset(&filterConf, 0, sizeof(filterConf));
+	filterConf.bIsFilterEn = true;
+	filterConf.FilterMode = CAN_FILTER_ID_MASK;
+	filterConf.FilterScale = CAN_FILTER_32BIT;
+	filterConf.AssignedFifo = CAN_MSG_RX_FIFO0;
+	BRG_TEST_CHECK(BrgDevice.InitFilterCAN(&filterConf) == BRG_NO_ERR);
+}
+
+/*
+ * private: BrgCanReceiver with the filter: the rejected frames are counted in FilteredNb and take
+ * no SeqNb, the accepted ones are queued in reception order
+ */
+static void CheckReceiver(const BrgCanSoftFilter &Filter)
+{
+	BrgTestBench bench(false);
+	Brg brg(bench.m_itf);
+	BrgCanReceiver receiver(brg);
+	Brg_CanRxConfT conf;
+	Brg_CanRxFrameT frame;
+	Brg_CanRxStatsT stats;
+	BrgSimCanFrameT simFrame;
+	uint32_t i, acceptedNb = 0;
+	uint8_t lastNb = 0;
+	int ms;
+
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+	InitCan(brg);
+	BrgCanReceiver::GetDefaultConf(&conf);
+	conf.QueueSize = TEST_SOFT_RX_NB;
+	conf.MinPollUs = 100;
+	conf.MaxPollUs = 1000;
+	conf.pFilter = &Filter;
+	BRG_TEST_CHECK(receiver.Start(&conf) == BRG_NO_ERR);
+	for( i = 0; i < TEST_SOFT_RX_NB; i++ ) {
+		memset(&simFrame, 0, sizeof(simFrame));
+		simFrame.bIde = (i & 1) != 0;
+		simFrame.ID = (simFrame.bIde == true) ? 0x1ABC0000 + i : 0x200 + i;
+		simFrame.DLC = 1;
+		simFrame.Data[0] = (uint8_t)i;
+		BRG_TEST_CHECK(bench.m_sim.InjectCanFrame(&simFrame) == SS_OK);
+		acceptedNb += (Filter.IsAccepted((simFrame.bIde == true) ? CAN_ID_EXTENDED : CAN_ID_STANDARD,
+		                                 simFrame.ID) == true) ? 1 : 0;
+	}
+	for( ms = 0; ms < TEST_SOFT_TIMEOUT_MS; ms++ ) {
+		receiver.GetStats(&stats);
+		if( stats.FrameNb >= TEST_SOFT_RX_NB ) {
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	receiver.Stop();
+	receiver.GetStats(&stats);
+	BRG_TEST_CHECK((stats.FrameNb == TEST_SOFT_RX_NB) && (stats.FilteredNb == TEST_SOFT_RX_NB - acceptedNb));
+	BRG_TEST_CHECK((acceptedNb != 0) && (acceptedNb != TEST_SOFT_RX_NB) && (stats.DropNb == 0));
+	for( i = 0; i < acceptedNb; i++ ) {
+		// Data[0]: injection number, increasing
+		BRG_TEST_CHECK((receiver.PopFrame(&frame) == true) && (frame.SeqNb == i) &&
+		               (Filter.IsAccepted(frame.Msg.IDE, frame.Msg.ID) == true) &&
+		               ((i == 0) || (frame.Data[0] > lastNb)));
+		lastNb = frame.Data[0];
+	}
+	BRG_TEST_CHECK(receiver.PopFrame(&frame) == false);
+	brg.CloseStlink();
+}
+
+/* Test functions ------------------------------------------------------------*/
+/**
+ * @brief Test suite "cansoft": BrgCanSoftFilter decisions against a linear reference (standard
+ *        identifiers, extended identifiers in the hash set, merged extended ranges, limits),
+ *        Evaluate() and FilterArrays() batches, Clear(), BrgCanReceiver with a host filter.
+ */
+void TestCanSoftFilter(void)
+{
+	BrgCanSoftFilter filter;
+	std::vector<TestSoftRangeT> ref;
+	std::vector<Brg_CanRxMsgT> msgs(TEST_SOFT_BATCH_NB);
+	std::vector<uint32_t> ids(TEST_SOFT_BATCH_NB);
+	std::vector<uint8_t> flags(TEST_SOFT_BATCH_NB);
+	std::vector<uint8_t> dlcs(TEST_SOFT_BATCH_NB);
+	std::vector<uint8_t> data(TEST_SOFT_BATCH_NB*8);
+	std::vector<uint8_t> accept(TEST_SOFT_BATCH_NB);
+	std::vector<uint8_t> accept2(TEST_SOFT_BATCH_NB);
+	Brg_CanRxArraysT arrays;
+	Brg_FilterBitsT bits[3];
+	uint32_t i, j, id, acceptedNb, keptNb;
+	bool bOk;
+
+	s_seed = 5;
+
+	// Empty filter: everything rejected
+	BRG_TEST_CHECK(filter.IsAccepted(CAN_ID_STANDARD, 0) == false);
+	BRG_TEST_CHECK(filter.IsAccepted(CAN_ID_STANDARD, 0x7FF) == false);
+	BRG_TEST_CHECK(filter.IsAccepted(CAN_ID_EXTENDED, 0) == false);
+	BRG_TEST_CHECK(filter.IsAccepted(CAN_ID_EXTENDED, 0x1FFFFFFF) == false);
+	BRG_TEST_CHECK(CheckRef(filter, ref, 1000) == 0);
+
+	// Parameters: nothing added on error
+	BRG_TEST_CHECK(filter.AddId(CAN_ID_STANDARD, 0x800) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(filter.AddId(CAN_ID_EXTENDED, 0x20000000) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(filter.AddRange(CAN_ID_STANDARD, 0x10, 0x0F) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(filter.AddRange(CAN_ID_STANDARD, 0x700, 0x800) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(filter.AddRange(CAN_ID_EXTENDED, 0x1FFFFF00, 0x20000000) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(filter.AddIds(NULL, 1) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(filter.AddIds(NULL, 0) == BRG_NO_ERR);
+	BRG_TEST_CHECK(filter.Evaluate((const Brg_CanRxMsgT*)NULL, 1, accept.data()) == 0);
+	BRG_TEST_CHECK(filter.Evaluate(ids.data(), NULL, 1, accept.data()) == 0);
+	BRG_TEST_CHECK(filter.FilterArrays(1, NULL) == 0);
+	BRG_TEST_CHECK(CheckRef(filter, ref, 1000) == 0);
+
+	// Standard identifiers: limits, single ones and a range, not accepted as extended ones (and the
+	// reverse), RTR not filtered
+	AddRef(filter, ref, CAN_ID_STANDARD, 0, 0);
+	AddRef(filter, ref, CAN_ID_STANDARD, 0x7FF, 0x7FF);
+	AddRef(filter, ref, CAN_ID_STANDARD, 0x123, 0x123);
+	AddRef(filter, ref, CAN_ID_STANDARD, 0x400, 0x43F);
+	AddRef(filter, ref, CAN_ID_EXTENDED, 0x555, 0x555);
+	BRG_TEST_CHECK(filter.IsAccepted(CAN_ID_EXTENDED, 0x123) == false);
+	BRG_TEST_CHECK(filter.IsAccepted(CAN_ID_STANDARD, 0x555) == false);
+	BRG_TEST_CHECK((filter.IsAccepted(CAN_ID_STANDARD, 0x3FF) == false) &&
+	               (filter.IsAccepted(CAN_ID_STANDARD, 0x440) == false));
+	BRG_TEST_CHECK(CheckRef(filter, ref, 1000) == 0);
+	memset(msgs.data(), 0, 4*sizeof(Brg_CanRxMsgT));
+	msgs[0].IDE = CAN_ID_STANDARD;
+	msgs[0].ID = 0x123;
+	msgs[0].RTR = CAN_DATA_FRAME;
+	msgs[1] = msgs[0];
+	msgs[1].RTR = CAN_REMOTE_FRAME;
+	msgs[2] = msgs[1];
+	msgs[2].ID = 0x124;
+	msgs[3] = msgs[0];
+	msgs[3].IDE = CAN_ID_EXTENDED;
+	BRG_TEST_CHECK(filter.Evaluate(msgs.data(), 4, accept.data()) == 2);
+	BRG_TEST_CHECK((accept[0] == 1) && (accept[1] == 1) && (accept[2] == 0) && (accept[3] == 0));
+
+	// Extended identifiers in the hash set: duplicates, hash set grown (previous ones kept)
+	for( i = 0; i < TEST_SOFT_EXT_ID_NB; i++ ) {
+		id = RandExtId();
+		AddRef(filter, ref, CAN_ID_EXTENDED, id, id);
+		if( (i % 10) == 0 ) {
+			BRG_TEST_CHECK(filter.AddId(CAN_ID_EXTENDED, id) == BRG_NO_ERR);
+		}
+	}
+	AddRef(filter, ref, CAN_ID_EXTENDED, 0, 0);
+	AddRef(filter, ref, CAN_ID_EXTENDED, 0x1FFFFFFF, 0x1FFFFFFF);
+	BRG_TEST_CHECK(CheckRef(filter, ref, TEST_SOFT_RANDOM_NB) == 0);
+	for( bOk = true, i = 0; i < ref.size(); i++ ) {
+		for( id = ref[i].FirstId; id <= ref[i].LastId; id++ ) {
+			bOk = bOk && filter.IsAccepted(ref[i].IDE, id);
+		}
+	}
+	BRG_TEST_CHECK(bOk == true);
+
+	// AddIds(): IDE of each identifier, stops at the first wrong one (the previous ones added)
+	bits[0].IDE = CAN_ID_EXTENDED;
+	bits[0].ID = 0x0ABCDEF;
+	bits[0].RTR = CAN_REMOTE_FRAME;
+	bits[1].IDE = CAN_ID_STANDARD;
+	bits[1].ID = 0x800;
+	bits[1].RTR = CAN_DATA_FRAME;
+	bits[2].IDE = CAN_ID_STANDARD;
+	bits[2].ID = 0x7AB;
+	bits[2].RTR = CAN_DATA_FRAME;
+	BRG_TEST_CHECK(filter.AddIds(bits, 3) == BRG_PARAM_ERR);
+	AddRef(filter, ref, CAN_ID_EXTENDED, 0x0ABCDEF, 0x0ABCDEF);
+	BRG_TEST_CHECK(filter.IsAccepted(CAN_ID_STANDARD, 0x7AB) == false);
+	BRG_TEST_CHECK(CheckRef(filter, ref, 1000) == 0);
+
+	// Extended ranges: merged when overlapping or contiguous, included, limits, list grown
+	AddRef(filter, ref, CAN_ID_EXTENDED, 0x10001000, 0x10001FFF);
+	AddRef(filter, ref, CAN_ID_EXTENDED, 0x10003000, 0x10003FFF);
+	AddRef(filter, ref, CAN_ID_EXTENDED, 0x10002000, 0x10002FFF);
+	AddRef(filter, ref, CAN_ID_EXTENDED, 0x10000500, 0x10001800);
+	AddRef(filter, ref, CAN_ID_EXTENDED, 0x10003100, 0x10003200);
+	AddRef(filter, ref, CAN_ID_EXTENDED, 0x1FFFFF00, 0x1FFFFFFE);
+	AddRef(filter, ref, CAN_ID_EXTENDED, 1, 0xFF);
+	BRG_TEST_CHECK((filter.IsAccepted(CAN_ID_EXTENDED, 0x100004FF) == IsRefAccepted(ref, CAN_ID_EXTENDED,
+	                                                                               0x100004FF)) &&
+	               (filter.IsAccepted(CAN_ID_EXTENDED, 0x10002FFF) == true) &&
+	               (filter.IsAccepted(CAN_ID_EXTENDED, 0x10003000) == true) &&
+	               (filter.IsAccepted(CAN_ID_EXTENDED, 0x10003FFF) == true));
+	BRG_TEST_CHECK(CheckRef(filter, ref, TEST_SOFT_RANDOM_NB) == 0);
+	for( i = 0; i < TEST_SOFT_RANGE_NB; i++ ) {
+		id = RandExtId() & 0x1FFF0000;
+		AddRef(filter, ref, CAN_ID_EXTENDED, id, id + (Rand() & 0x3FFF));
+	}
+	BRG_TEST_CHECK(CheckRef(filter, ref, TEST_SOFT_RANDOM_NB) == 0);
+
+	// Batches: both Evaluate() equal to IsAccepted(), FilterArrays() keeps the accepted messages in order
+	for( i = 0; i < TEST_SOFT_BATCH_NB; i++ ) {
+		j = Rand() % ref.size();
+		msgs[i].IDE = ((Rand() & 1) == 0) ? ref[j].IDE : CAN_ID_STANDARD;
+		msgs[i].ID = ((Rand() & 3) != 0) ? ref[j].FirstId : Rand() & 0x7FF;
+		msgs[i].RTR = ((Rand() & 1) == 0) ? CAN_DATA_FRAME : CAN_REMOTE_FRAME;
+		if( (msgs[i].IDE == CAN_ID_STANDARD) && (msgs[i].ID > 0x7FF) ) {
+			msgs[i].IDE = CAN_ID_EXTENDED;
+		}
+		msgs[i].DLC = (uint8_t)(i % 9);
+		ids[i] = msgs[i].ID;
+		flags[i] = (uint8_t)(((msgs[i].IDE == CAN_ID_EXTENDED) ? BRG_CAN_RX_FLAG_IDE : 0) |
+		                     ((msgs[i].RTR == CAN_REMOTE_FRAME) ? BRG_CAN_RX_FLAG_RTR : 0));
+		dlcs[i] = msgs[i].DLC;
+		for( j = 0; j < 8; j++ ) {
+			data[i*8 + j] = (uint8_t)(i + j);
+		}
+	}
+	acceptedNb = filter.Evaluate(msgs.data(), TEST_SOFT_BATCH_NB, accept.data());
+	BRG_TEST_CHECK(filter.Evaluate(ids.data(), flags.data(), TEST_SOFT_BATCH_NB, accept2.data()) == acceptedNb);
+	BRG_TEST_CHECK((acceptedNb != 0) && (acceptedNb != TEST_SOFT_BATCH_NB));
+	for( bOk = true, i = 0; i < TEST_SOFT_BATCH_NB; i++ ) {
+		bOk = bOk && (accept[i] == accept2[i]) &&
+		      ((accept[i] == 1) == filter.IsAccepted(msgs[i].IDE, msgs[i].ID)) &&
+		      ((accept[i] == 1) == IsRefAccepted(ref, msgs[i].IDE, msgs[i].ID));
+	}
+	BRG_TEST_CHECK(bOk == true);
+	arrays.pId = ids.data();
+	arrays.pFlags = flags.data();
+	arrays.pDlc = dlcs.data();
+	arrays.pData = data.data();
+	keptNb = filter.FilterArrays(TEST_SOFT_BATCH_NB, &arrays);
+	BRG_TEST_CHECK(keptNb == acceptedNb);
+	for( bOk = true, i = 0, j = 0; i < TEST_SOFT_BATCH_NB; i++ ) {
+		if( accept[i] == 0 ) {
+			continue;
+		}
+		bOk = bOk && (ids[j] == msgs[i].ID) && (dlcs[j] == msgs[i].DLC) && (data[j*8] == (uint8_t)i) &&
+		      (data[j*8 + 7] == (uint8_t)(i + 7)) &&
+		      (((flags[j] & BRG_CAN_RX_FLAG_IDE) != 0) == (msgs[i].IDE == CAN_ID_EXTENDED));
+		j++;
+	}
+	BRG_TEST_CHECK(bOk == true);
+	arrays.pDlc = NULL;
+	arrays.pData = NULL;
+	BRG_TEST_CHECK(filter.FilterArrays(keptNb, &arrays) == keptNb);
+
+	// Receiver: rejected frames discarded before the queue
+	filter.Clear();
+	ref.clear();
+	BRG_TEST_CHECK(CheckRef(filter, ref, 1000) == 0);
+	for( i = 0; i < TEST_SOFT_RX_NB; i += 3 ) {
+		id = ((i & 1) != 0) ? 0x1ABC0000 + i : 0x200 + i;
+		AddRef(filter, ref, ((i & 1) != 0) ? CAN_ID_EXTENDED : CAN_ID_STANDARD, id, id);
+	}
+	BRG_TEST_CHECK(CheckRef(filter, ref, 1000) == 0);
+	CheckReceiver(filter);
+}
+
+/*
+ * private: messages per second in millions
+ */
+static double GetRateM(uint64_t MsgNb, uint64_t DurationNs)
+{
+	return (DurationNs != 0) ? (MsgNb * 1000.0 / DurationNs) : 0;
+}
+
+/**
+ * @brief Benchmark "cansoft": Evaluate() and FilterArrays() throughput for standard traffic and
+ *        extended traffic against hash sets and range lists of several sizes, compared with a linear
+ *        search of the accepted identifiers.
+ */
+void BenchCanSoftFilter(void)
+{
+	const uint32_t idNbs[] = { 16, 256, 4096 };
+	const uint32_t rangeNbs[] = { 4, 64 };
+	std::vector<Brg_CanRxMsgT> msgs(TEST_SOFT_BENCH_NB);
+	std::vector<uint32_t> ids(TEST_SOFT_BENCH_NB);
+	std::vector<uint8_t> flags(TEST_SOFT_BENCH_NB);
+	std::vector<uint32_t> arrayIds(TEST_SOFT_BENCH_NB);
+	std::vector<uint8_t> arrayFlags(TEST_SOFT_BENCH_NB);
+	std::vector<uint8_t> accept(TEST_SOFT_BENCH_NB);
+	std::vector<uint32_t> extIds;
+	Brg_CanRxArraysT arrays;
+	uint64_t startNs, evalNs, arraysNs, filterNs, linearNs, acceptedNb, linearNb;
+	uint32_t i, r, k, id;
+	unsigned int c;
+
+	s_seed = 11;
+	memset(&arrays, 0, sizeof(arrays));
+	arrays.pId = arrayIds.data();
+	arrays.pFlags = arrayFlags.data();
+
+	for( c = 0; c < 1 + sizeof(idNbs)/sizeof(idNbs[0]) + sizeof(rangeNbs)/sizeof(rangeNbs[0]); c++ ) {
+		BrgCanSoftFilter filter;
+
+		// Filter, and traffic with half of the frames accepted
+		extIds.clear();
+		for( i = 0; i < TEST_SOFT_BENCH_NB; i++ ) {
+			memset(&msgs[i], 0, sizeof(Brg_CanRxMsgT));
+			msgs[i].DLC = 8;
+		}
+		if( c == 0 ) {
+			for( id = 0; id <= 0x7FF; id += 2 ) {
+				BRG_TEST_CHECK(filter.AddId(CAN_ID_STANDARD, id) == BRG_NO_ERR);
+			}
+			for( i = 0; i < TEST_SOFT_BENCH_NB; i++ ) {
+				msgs[i].IDE = CAN_ID_STANDARD;
+				msgs[i].ID = Rand() & 0x7FF;
+			}
+			printf("Standard, 1024 identifiers:    ");
+		} else if( c <= sizeof(idNbs)/sizeof(idNbs[0]) ) {
+			for( i = 0; i < idNbs[c-1]; i++ ) {
+				extIds.push_back(RandExtId());
+				BRG_TEST_CHECK(filter.AddId(CAN_ID_EXTENDED, extIds[i]) == BRG_NO_ERR);
+			}
+			for( i = 0; i < TEST_SOFT_BENCH_NB; i++ ) {
+				msgs[i].IDE = CAN_ID_EXTENDED;
+				msgs[i].ID = ((i & 1) == 0) ? extIds[Rand() % idNbs[c-1]] : RandExtId();
+			}
+			printf("Extended, %4u identifiers:    ", idNbs[c-1]);
+		} else {
+			k = rangeNbs[c - 1 - sizeof(idNbs)/sizeof(idNbs[0])];
+			for( i = 0; i < k; i++ ) {
+				id = (0x1FFFFFFF / k) * i;
+				BRG_TEST_CHECK(filter.AddRange(CAN_ID_EXTENDED, id, id + (0x1FFFFFFF / k) / 2) == BRG_NO_ERR);
+			}
+			for( i = 0; i < TEST_SOFT_BENCH_NB; i++ ) {
+				msgs[i].IDE = CAN_ID_EXTENDED;
+				msgs[i].ID = RandExtId();
+			}
+			printf("Extended, %4u ranges:         ", k);
+		}
+		for( i = 0; i < TEST_SOFT_BENCH_NB; i++ ) {
+			ids[i] = msgs[i].ID;
+			flags[i] = (msgs[i].IDE == CAN_ID_EXTENDED) ? BRG_CAN_RX_FLAG_IDE : 0;
+		}
+
+		startNs = StlinkCmdStats::GetTimeNs();
+		for( acceptedNb = 0, r = 0; r < TEST_SOFT_BENCH_REPEAT; r++ ) {
+			acceptedNb += filter.Evaluate(msgs.data(), TEST_SOFT_BENCH_NB, accept.data());
+		}
+		evalNs = StlinkCmdStats::GetTimeNs() - startNs;
+		startNs = StlinkCmdStats::GetTimeNs();
+		for( r = 0; r < TEST_SOFT_BENCH_REPEAT; r++ ) {
+			BRG_TEST_CHECK(filter.Evaluate(ids.data(), flags.data(), TEST_SOFT_BENCH_NB, accept.data()) ==
+			               acceptedNb / TEST_SOFT_BENCH_REPEAT);
+		}
+		arraysNs = StlinkCmdStats::GetTimeNs() - startNs;
+		// FilterArrays() compacts the arrays: copy included
+		startNs = StlinkCmdStats::GetTimeNs();
+		for( r = 0; r < TEST_SOFT_BENCH_REPEAT; r++ ) {
+			memcpy(arrayIds.data(), ids.data(), TEST_SOFT_BENCH_NB*sizeof(uint32_t));
+			memcpy(arrayFlags.data(), flags.data(), TEST_SOFT_BENCH_NB);
+			BRG_TEST_CHECK(filter.FilterArrays(TEST_SOFT_BENCH_NB, &arrays) == acceptedNb / TEST_SOFT_BENCH_REPEAT);
+		}
+		filterNs = StlinkCmdStats::GetTimeNs() - startNs;
+		linearNs = 0;
+		if( extIds.size() != 0 ) {
+			startNs = StlinkCmdStats::GetTimeNs();
+			for( linearNb = 0, r = 0; r < TEST_SOFT_BENCH_REPEAT / 16; r++ ) {
+				for( i = 0; i < TEST_SOFT_BENCH_NB; i++ ) {
+					for( k = 0; (k < extIds.size()) && (extIds[k] != msgs[i].ID); k++ ) {
+					}
+					linearNb += (k < extIds.size()) ? 1 : 0;
+				}
+			}
+			linearNs = (StlinkCmdStats::GetTimeNs() - startNs) * 16;
+			BRG_TEST_CHECK(linearNb == acceptedNb / 16);
+		}
+		BRG_TEST_CHECK((acceptedNb != 0) && (acceptedNb != (uint64_t)TEST_SOFT_BENCH_NB*TEST_SOFT_BENCH_REPEAT));
+		printf("Evaluate %7.1f Mmsg/s, arrays %7.1f Mmsg/s, FilterArrays %7.1f Mmsg/s",
+		       GetRateM((uint64_t)TEST_SOFT_BENCH_NB*TEST_SOFT_BENCH_REPEAT, evalNs),
+		       GetRateM((uint64_t)TEST_SOFT_BENCH_NB*TEST_SOFT_BENCH_REPEAT, arraysNs),
+		       GetRateM((uint64_t)TEST_SOFT_BENCH_NB*TEST_SOFT_BENCH_REPEAT, filterNs));
+		if( linearNs != 0 ) {
+			printf(" (linear search x%.1f)", (double)linearNs/evalNs);
+		}
+		printf("\n");
+	}
+}
+
+/** @} */
+/******************* (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
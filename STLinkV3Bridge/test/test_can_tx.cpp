@@ -0,0 +1,428 @@
+/**
+  ******************************************************************************
+  * @file    test_can_tx.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "cantx": BrgCanTransmitter arbitration order, queue full,
+  *          failing frame and frames pushed again, pacing and statistics.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+#include "bridge_can_tx.h"
+
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_CANTX_TIMEOUT_MS  2000
+#define TEST_CANTX_QUEUE_SIZE  8
+#define TEST_CANTX_FRAME_MAX   64
+
+/* Private typedef -----------------------------------------------------------*/
+// Frame pushed to the transmitter: data[0] is its index in the test table
+typedef struct {
+	uint32_t ID;
+	bool bIde;
+	bool bRtr;
+} TestCanTxRefT;
+
+/// TestTxTransport Class: simulator reached through a transport that can hold the CAN writes (the
+/// transmitter worker then waits in its batch while the test fills the queue) and fail one of them
+/// with a USB error.
+class TestTxTransport : public STLinkTransport
+{
+public:
+	TestTxTransport(BrgSimTransport &Sim): m_sim(Sim), m_bHold(false), m_bHeld(false), m_writeNb(0),
+		m_failWrite(0) {}
+
+	virtual uint32_t Reenumerate(STLink_EnumStlinkInterfaceT IfId, uint8_t bClearList) {
+		return m_sim.Reenumerate(IfId, bClearList);
+	}
+	virtual uint32_t GetNbDevices(STLink_EnumStlinkInterfaceT IfId) {
+		return m_sim.GetNbDevices(IfId);
+	}
+	virtual uint32_t GetDeviceInfo2(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+	                                STLink_DeviceInfo2T *pInfo, uint32_t InfoSize) {
+		return m_sim.GetDeviceInfo2(IfId, DevIdxInList, pInfo, InfoSize);
+	}
+	virtual uint32_t OpenDevice(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+	                            uint8_t bExclusiveAccess, void **pHandle) {
+		return m_sim.OpenDevice(IfId, DevIdxInList, bExclusiveAccess, pHandle);
+	}
+	virtual uint32_t CloseDevice(void *pHandle) {
+		return m_sim.CloseDevice(pHandle);
+	}
+	virtual uint32_t SendCommand(void *pHandle, STLink_DeviceRequestT *pRequest, uint32_t TimeoutMs) {
+		if( (pRequest->CDBByte[0] == STLINK_BRIDGE_COMMAND) &&
+		    (pRequest->CDBByte[1] == STLINK_BRIDGE_WRITE_MSG_CAN) ) {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_bHeld = m_bHold;
+			m_cv.notify_all();
+			m_cv.wait(lock, [this]{ return (m_bHold == false); });
+			m_bHeld = false;
+			m_writeNb++;
+			if( m_writeNb == m_failWrite ) {
+				return SS_TRANSFER_ERR;
+			}
+		}
+		return m_sim.SendCommand(pHandle, pRequest, TimeoutMs);
+	}
+
+	// Next CAN writes wait for Release()
+	void Hold(void) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bHold = true;
+	}
+	// Waits until a CAN write is held
+	bool WaitHeld(void) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_cv.wait_for(lock, std::chrono::milliseconds(TEST_CANTX_TIMEOUT_MS),
+		                     [this]{ return m_bHeld; });
+	}
+	void Release(void) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bHold = false;
+		m_cv.notify_all();
+	}
+	// The WriteNb-th CAN write from now fails (0: none)
+	void FailWrite(uint32_t WriteNb) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_writeNb = 0;
+		m_failWrite = WriteNb;
+	}
+
+private:
+	BrgSimTransport &m_sim;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	bool m_bHold;
+	bool m_bHeld;
+	uint32_t m_writeNb;
+	uint32_t m_failWrite;
+};
+
+/* Private variables ---------------------------------------------------------*/
+// Frames pushed in this order after a first frame of ID 0x7FF: standard and extended frames of same base
+// identifier, data and remote frames, two frames of same identifier
+static const TestCanTxRefT s_orderRef[] = {
+	{ (0x123<<18) | 0x5, true, false },
+	{ 0x123, false, true },
+	{ 0x123, false, false },
+	{ 0x050, false, false },
+	{ 0x00000001, true, false },
+	{ 0x050, false, false },
+	{ 0x000, false, true },
+	{ (0x123<<18) | 0x5, true, true },
+	{ (0x123<<18) | 0x4, true, false },
+	{ 0x124, false, false },
+};
+// Indexes of s_orderRef in the CAN arbitration order
+static const uint32_t s_orderExpected[] = { 6, 4, 3, 5, 2, 1, 8, 0, 7, 9 };
+
+/*
+ * private: CAN at 1 Mbit/s in normal mode, the receiver (acknowledging the frames) accepting all the
+ * frames in FIFO0
+ */
+static void InitCan(Brg &BrgTx, Brg &BrgRx)
+{
+	Brg_CanInitT canInit;
+	Brg_CanFilterConfT filterConf;
+	uint32_t prescal, finalBaudrate;
+
+	memset(&canInit, 0, sizeof(canInit));
+	canInit.BitTimeConf.PropSegInTq = 1;
+	canInit.BitTimeConf.PhaseSeg1InTq = 4;
+	canInit.BitTimeConf.PhaseSeg2InTq = 2;
+	canInit.BitTimeConf.SjwInTq = 1;
+	BRG_TEST_CHECK(BrgTx.GetCANbaudratePrescal(&canInit.BitTimeConf, 1000000, &prescal,
+	                                           &finalBaudrate) == BRG_NO_ERR);
+	canInit.Prescaler = prescal;
+	canInit.Mode = CAN_MODE_NORMAL;
+	BRG_TEST_CHECK(BrgTx.InitCAN(&canInit, BRG_INIT_FULL) == BRG_NO_ERR);
+	BRG_TEST_CHECK(BrgRx.InitCAN(&canInit, BRG_INIT_FULL) == BRG_NO_ERR);
+
+	memset(&filterConf, 0, sizeof(filterConf));
+	filterConf.bIsFilterEn = true;
+	filterConf.FilterMode = CAN_FILTER_ID_MASK;
+	filterConf.FilterScale = CAN_FILTER_32BIT;
+	filterConf.AssignedFifo = CAN_MSG_RX_FIFO0;
+	BRG_TEST_CHECK(BrgRx.InitFilterCAN(&filterConf) == BRG_NO_ERR);
+	BRG_TEST_CHECK(BrgRx.StartMsgReceptionCAN() == BRG_NO_ERR);
+}
+
+/*
+ * private: pushes the frame Idx (data[0] = Idx, 2 data bytes for a data frame)
+ */
+static Brg_StatusT PushFrame(BrgCanTransmitter &Tx, const TestCanTxRefT *pRef, uint8_t Idx)
+{
+	Brg_CanTxMsgT msg;
+	uint8_t data[2] = { Idx, (uint8_t)~Idx };
+
+	msg.ID = pRef->ID;
+	msg.IDE = (pRef->bIde == true) ? CAN_ID_EXTENDED : CAN_ID_STANDARD;
+	msg.RTR = (pRef->bRtr == true) ? CAN_REMOTE_FRAME : CAN_DATA_FRAME;
+	msg.DLC = (pRef->bRtr == true) ? 0 : 2;
+	return Tx.Push(&msg, data, (pRef->bRtr == true) ? 0 : 2);
+}
+
+/*
+ * private: standard data frame Id with data[0] = Idx
+ */
+static Brg_StatusT PushStdFrame(BrgCanTransmitter &Tx, uint32_t Id, uint8_t Idx)
+{
+	TestCanTxRefT ref = { Id, false, false };
+
+	return PushFrame(Tx, &ref, Idx);
+}
+
+/*
+ * private: frames received by BrgRx, up to FrameMax, *pData the first data byte of each (0xFF for a
+ * remote frame). Returns the number of frames.
+ */
+static uint32_t ReadFrames(Brg &BrgRx, Brg_CanRxMsgT *pMsgs, uint8_t *pData, uint32_t FrameMax)
+{
+	uint8_t data[TEST_CANTX_FRAME_MAX*8];
+	uint16_t msgNb, dataSize, dataOffset, i;
+
+	if( (BrgRx.GetRxMsgNbCAN(&msgNb) != BRG_NO_ERR) || (msgNb > FrameMax) ) {
+		return 0;
+	}
+	if( (msgNb == 0) || (BrgRx.GetRxMsgCAN(pMsgs, msgNb, data, sizeof(data), &dataSize) != BRG_NO_ERR) ) {
+		return 0;
+	}
+	dataOffset = 0;
+	for( i = 0; i < msgNb; i++ ) {
+		pData[i] = 0xFF;
+		if( (pMsgs[i].RTR == CAN_DATA_FRAME) && (pMsgs[i].DLC > 0) ) {
+			pData[i] = data[dataOffset];
+			dataOffset = (uint16_t)(dataOffset + pMsgs[i].DLC);
+		}
+	}
+	return msgNb;
+}
+
+/*
+ * private: received frame equal to the pushed one of index Idx
+ */
+static bool IsSameFrame(const Brg_CanRxMsgT *pMsg, uint8_t Data, const TestCanTxRefT *pRef, uint8_t Idx)
+{
+	if( (pMsg->ID != pRef->ID) || (pMsg->IDE != ((pRef->bIde == true) ? CAN_ID_EXTENDED : CAN_ID_STANDARD)) ||
+	    (pMsg->RTR != ((pRef->bRtr == true) ? CAN_REMOTE_FRAME : CAN_DATA_FRAME)) ) {
+		return false;
+	}
+	return (pRef->bRtr == true) || (Data == Idx);
+}
+
+/*
+ * private: standard data frames received in order, ID FirstId + i and data[0] FirstIdx + i
+ */
+static uint32_t CheckStdFrames(Brg &BrgRx, uint32_t FirstId, uint8_t FirstIdx, uint32_t FrameNb)
+{
+	Brg_CanRxMsgT msgs[TEST_CANTX_FRAME_MAX];
+	uint8_t data[TEST_CANTX_FRAME_MAX];
+	uint32_t errorNb = 0;
+	uint32_t i;
+
+	if( ReadFrames(BrgRx, msgs, data, TEST_CANTX_FRAME_MAX) != FrameNb ) {
+		return FrameNb + 1;
+	}
+	for( i = 0; i < FrameNb; i++ ) {
+		TestCanTxRefT ref = { FirstId + i, false, false };
+		if( IsSameFrame(&msgs[i], data[i], &ref, (uint8_t)(FirstIdx + i)) == false ) {
+			errorNb++;
+		}
+	}
+	return errorNb;
+}
+
+/**
+ * @ingroup TEST
+ * @brief Frames queued while a batch is in progress sent in the CAN arbitration order (same identifier in
+ *        push order), queue full (frames refused and counted, queued frames discarded by Stop()/Start()),
+ *        frame failing in a batch (discarded with the frames after it, the next batches sent) and frames
+ *        pushed again once the bus acknowledges them, pacing, parameter errors and statistics.
+ */
+void TestCanTx(void)
+{
+	BrgTestBench bench(false, 2);
+	TestTxTransport transport(bench.m_sim);
+	STLinkInterface txItf(STLINK_BRIDGE);
+	Brg brgTx(txItf);
+	Brg brgRx(bench.m_itf);
+	BrgCanTransmitter tx(brgTx);
+	Brg_CanTxConfT conf;
+	Brg_CanTxStatsT stats;
+	Brg_CanRxMsgT msgs[TEST_CANTX_FRAME_MAX];
+	uint8_t data[TEST_CANTX_FRAME_MAX];
+	uint32_t i, frameNb, errorNb;
+
+	txItf.SetTransport(&transport);
+	txItf.LoadStlinkLibrary(NULL);
+
+	// Parameters and order
+	BRG_TEST_CHECK(tx.Start() == BRG_NO_STLINK);
+	BRG_TEST_CHECK(brgTx.OpenStlink(0) == BRG_NO_ERR);
+	BRG_TEST_CHECK(brgRx.OpenStlink(1) == BRG_NO_ERR);
+	InitCan(brgTx, brgRx);
+	BRG_TEST_CHECK(PushStdFrame(tx, 0x100, 0) == BRG_COM_CMD_ORDER_ERR);
+	BrgCanTransmitter::GetDefaultConf(&conf);
+	conf.QueueSize = 0;
+	BRG_TEST_CHECK(tx.Start(&conf) == BRG_PARAM_ERR);
+	conf.QueueSize = TEST_CANTX_FRAME_MAX;
+	conf.BatchMax = BRG_CAN_TX_BATCH_MAX + 1;
+	BRG_TEST_CHECK(tx.Start(&conf) == BRG_PARAM_ERR);
+	conf.BatchMax = 0;
+	BRG_TEST_CHECK(tx.Start(&conf) == BRG_PARAM_ERR);
+	conf.BatchMax = BRG_CAN_TX_BATCH_DEFAULT;
+	conf.FramesPerSec = 1000;
+	conf.BurstNb = 0;
+	BRG_TEST_CHECK(tx.Start(&conf) == BRG_PARAM_ERR);
+	conf.FramesPerSec = 0;
+	BRG_TEST_CHECK(tx.Start(&conf) == BRG_NO_ERR);
+	BRG_TEST_CHECK(PushStdFrame(tx, 0x800, 0) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(tx.Push(NULL, data, 0) == BRG_PARAM_ERR);
+
+	// Arbitration order: frames queued while the first frame is held in its batch
+	transport.Hold();
+	BRG_TEST_CHECK(PushStdFrame(tx, 0x7FF, 0xFF) == BRG_NO_ERR);
+	BRG_TEST_CHECK(transport.WaitHeld() == true);
+	for( i = 0; i < sizeof(s_orderRef)/sizeof(s_orderRef[0]); i++ ) {
+		BRG_TEST_CHECK(PushFrame(tx, &s_orderRef[i], (uint8_t)i) == BRG_NO_ERR);
+	}
+	tx.GetStats(&stats);
+	BRG_TEST_CHECK(stats.QueuedNb == sizeof(s_orderRef)/sizeof(s_orderRef[0]));
+	transport.Release();
+	BRG_TEST_CHECK(tx.Flush(TEST_CANTX_TIMEOUT_MS) == BRG_NO_ERR);
+	frameNb = ReadFrames(brgRx, msgs, data, TEST_CANTX_FRAME_MAX);
+	BRG_TEST_CHECK(frameNb == 1 + sizeof(s_orderRef)/sizeof(s_orderRef[0]));
+	BRG_TEST_CHECK((msgs[0].ID == 0x7FF) && (data[0] == 0xFF));
+	errorNb = 0;
+	for( i = 0; (i < sizeof(s_orderExpected)/sizeof(s_orderExpected[0])) && (i + 1 < frameNb); i++ ) {
+		if( IsSameFrame(&msgs[1 + i], data[1 + i], &s_orderRef[s_orderExpected[i]],
+		                (uint8_t)s_orderExpected[i]) == false ) {
+			errorNb++;
+		}
+	}
+	BRG_TEST_CHECK(errorNb == 0);
+	tx.GetStats(&stats);
+	BRG_TEST_CHECK((stats.PushNb == frameNb) && (stats.SentNb == frameNb) && (stats.ErrorNb == 0));
+	BRG_TEST_CHECK((stats.QueuedNb == 0) && (stats.MaxQueuedNb == frameNb - 1));
+	// First frame alone, then the others in one batch
+	BRG_TEST_CHECK(stats.BatchNb == 2);
+	BRG_TEST_CHECK((stats.MinLatencyUs <= stats.MeanLatencyUs) && (stats.MeanLatencyUs <= stats.MaxLatencyUs));
+	tx.Stop();
+
+	// Queue full: frames refused and counted, queued frames not sent after Stop(), discarded by Start()
+	conf.QueueSize = TEST_CANTX_QUEUE_SIZE;
+	BRG_TEST_CHECK(tx.Start(&conf) == BRG_NO_ERR);
+	transport.Hold();
+	BRG_TEST_CHECK(PushStdFrame(tx, 0x300, 0) == BRG_NO_ERR);
+	BRG_TEST_CHECK(transport.WaitHeld() == true);
+	for( i = 1; i <= TEST_CANTX_QUEUE_SIZE; i++ ) {
+		BRG_TEST_CHECK(PushStdFrame(tx, 0x300 + i, (uint8_t)i) == BRG_NO_ERR);
+	}
+	BRG_TEST_CHECK(PushStdFrame(tx, 0x3FF, 0xFF) == BRG_OVERRUN_ERR);
+	BRG_TEST_CHECK(PushStdFrame(tx, 0x000, 0xFF) == BRG_OVERRUN_ERR);
+	tx.GetStats(&stats);
+	BRG_TEST_CHECK((stats.FullNb == 2) && (stats.PushNb == TEST_CANTX_QUEUE_SIZE + 1));
+	BRG_TEST_CHECK((stats.QueuedNb == TEST_CANTX_QUEUE_SIZE) && (stats.MaxQueuedNb == TEST_CANTX_QUEUE_SIZE));
+	BRG_TEST_CHECK(tx.Flush(10) == BRG_TARGET_CMD_TIMEOUT);
+	// Stop() after the batch in progress (released once Stop() waits for the worker)
+	std::thread stopper([&tx]{ tx.Stop(); });
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	transport.Release();
+	stopper.join();
+	BRG_TEST_CHECK(CheckStdFrames(brgRx, 0x300, 0, 1) == 0);
+	BRG_TEST_CHECK(tx.Start(&conf) == BRG_NO_ERR);
+	tx.GetStats(&stats);
+	BRG_TEST_CHECK((stats.QueuedNb == 0) && (stats.PushNb == 0) && (stats.FullNb == 0));
+	BRG_TEST_CHECK(tx.Flush(TEST_CANTX_TIMEOUT_MS) == BRG_NO_ERR);
+	BRG_TEST_CHECK(ReadFrames(brgRx, msgs, data, TEST_CANTX_FRAME_MAX) == 0);
+	tx.Stop();
+
+	// 3rd frame of a batch failing: discarded with the frames after it in the batch, next batch sent
+	conf.QueueSize = TEST_CANTX_FRAME_MAX;
+	conf.BatchMax = 4;
+	BRG_TEST_CHECK(tx.Start(&conf) == BRG_NO_ERR);
+	transport.Hold();
+	BRG_TEST_CHECK(PushStdFrame(tx, 0x400, 0) == BRG_NO_ERR);
+	BRG_TEST_CHECK(transport.WaitHeld() == true);
+	transport.FailWrite(4);
+	for( i = 1; i <= 8; i++ ) {
+		BRG_TEST_CHECK(PushStdFrame(tx, 0x400 + i, (uint8_t)i) == BRG_NO_ERR);
+	}
+	transport.Release();
+	BRG_TEST_CHECK(tx.Flush(TEST_CANTX_TIMEOUT_MS) == BRG_NO_ERR);
+	transport.FailWrite(0);
+	tx.GetStats(&stats);
+	BRG_TEST_CHECK((stats.SentNb == 1 + 2 + 4) && (stats.ErrorNb == 2) && (stats.BatchNb == 3));
+	BRG_TEST_CHECK(stats.LastError == BRG_USB_COMM_ERR);
+	frameNb = ReadFrames(brgRx, msgs, data, TEST_CANTX_FRAME_MAX);
+	BRG_TEST_CHECK((frameNb == 7) && (data[2] == 2) && (data[3] == 5) && (data[6] == 8));
+
+	// Frames not acknowledged (no other node on the bus): all discarded, then pushed again
+	BRG_TEST_CHECK(brgRx.CloseBridge(COM_CAN) == BRG_NO_ERR);
+	tx.ResetStats();
+	for( i = 0; i < 6; i++ ) {
+		BRG_TEST_CHECK(PushStdFrame(tx, 0x500 + i, (uint8_t)i) == BRG_NO_ERR);
+	}
+	BRG_TEST_CHECK(tx.Flush(TEST_CANTX_TIMEOUT_MS) == BRG_NO_ERR);
+	tx.GetStats(&stats);
+	BRG_TEST_CHECK((stats.SentNb == 0) && (stats.ErrorNb == 6) && (stats.LastError == BRG_CAN_ERR));
+	InitCan(brgTx, brgRx);
+	tx.ResetStats();
+	for( i = 0; i < 6; i++ ) {
+		BRG_TEST_CHECK(PushStdFrame(tx, 0x500 + i, (uint8_t)i) == BRG_NO_ERR);
+	}
+	BRG_TEST_CHECK(tx.Flush(TEST_CANTX_TIMEOUT_MS) == BRG_NO_ERR);
+	tx.GetStats(&stats);
+	BRG_TEST_CHECK((stats.SentNb == 6) && (stats.ErrorNb == 0) && (stats.LastError == BRG_NO_ERR));
+	BRG_TEST_CHECK(CheckStdFrames(brgRx, 0x500, 0, 6) == 0);
+	tx.Stop();
+
+	// Pacing: BurstNb frames at once, then one every 1/FramesPerSec
+	conf.FramesPerSec = 200;
+	conf.BurstNb = 2;
+	conf.BatchMax = BRG_CAN_TX_BATCH_DEFAULT;
+	BRG_TEST_CHECK(tx.Start(&conf) == BRG_NO_ERR);
+	for( i = 0; i < 6; i++ ) {
+		BRG_TEST_CHECK(PushStdFrame(tx, 0x600 + i, (uint8_t)i) == BRG_NO_ERR);
+	}
+	BRG_TEST_CHECK(tx.Flush(TEST_CANTX_TIMEOUT_MS) == BRG_NO_ERR);
+	tx.GetStats(&stats);
+	// 4 frames paced at 5 ms
+	BRG_TEST_CHECK((stats.SentNb == 6) && (stats.MaxLatencyUs >= 4*5000 - 1000));
+	BRG_TEST_CHECK(CheckStdFrames(brgRx, 0x600, 0, 6) == 0);
+	tx.Stop();
+	BRG_TEST_CHECK(tx.Flush(TEST_CANTX_TIMEOUT_MS) == BRG_NO_ERR);
+
+	brgRx.CloseBridge(COM_UNDEF_ALL);
+	brgTx.CloseBridge(COM_UNDEF_ALL);
+	brgRx.CloseStlink();
+	brgTx.CloseStlink();
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,225 @@
+/**
+  ******************************************************************************
+  * @file    test_cmd_stats.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "cmdstats": StlinkCmdStats counters, percentiles and
+  *          text dump, recording overhead benchmark.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+#include "stlink_cmd_stats.h"
+
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_CMD_STATS_BENCH_NB   5000000
+#define TEST_CMD_STATS_BENCH_RUNS 3
+
+/*
+ * private: percentile within the histogram precision (upper bound of a 1/16 wide bucket)
+ */
+static bool IsNear(uint64_t ValueNs, uint64_t ExpectedNs)
+{
+	return (ValueNs >= ExpectedNs) && (ValueNs <= ExpectedNs + ExpectedNs/8);
+}
+
+/**
+ * @ingroup TEST
+ * @brief Counters and percentiles of a known latency distribution, entries beyond
+ *        #STLINK_CMD_STATS_MAX_CMD, truncated dump, recording while the statistics are read,
+ *        commands recorded by the Brg.
+ */
+void TestCmdStats(void)
+{
+	StlinkCmdStats stats;
+	StlinkCmdStatsT cmdStats;
+	StlinkCmdStatsT list[STLINK_CMD_STATS_MAX_CMD + 1];
+	char dump[4096];
+	char small[50];
+	uint32_t i, len;
+
+	// Latencies 1..1000 us
+	for( i = 1; i <= 1000; i++ ) {
+		stats.Record(STLINK_BRIDGE_COMMAND, STLINK_BRIDGE_WRITE_SPI, i*1000, 16 + 64, 2, (i % 100) == 0);
+	}
+	BRG_TEST_CHECK(stats.GetStats(STLINK_BRIDGE_COMMAND, STLINK_BRIDGE_WRITE_SPI, &cmdStats) == true);
+	BRG_TEST_CHECK(cmdStats.Count == 1000);
+	BRG_TEST_CHECK(cmdStats.ErrorCount == 10);
+	BRG_TEST_CHECK(cmdStats.BytesOut == 80000);
+	BRG_TEST_CHECK(cmdStats.BytesIn == 2000);
+	BRG_TEST_CHECK(cmdStats.TotalNs == 500500000ULL);
+	BRG_TEST_CHECK((cmdStats.MinNs == 1000) && (cmdStats.MaxNs == 1000000));
+	BRG_TEST_CHECK(IsNear(cmdStats.P50Ns, 500000));
+	BRG_TEST_CHECK(IsNear(cmdStats.P90Ns, 900000));
+	BRG_TEST_CHECK(IsNear(cmdStats.P99Ns, 990000));
+	BRG_TEST_CHECK(IsNear(cmdStats.P999Ns, 999000));
+	BRG_TEST_CHECK(stats.GetStats(STLINK_BRIDGE_COMMAND, STLINK_BRIDGE_READ_SPI, &cmdStats) == false);
+	BRG_TEST_CHECK(cmdStats.Count == 0);
+
+	// Commands beyond the table counted together in the last entry (WRITE_SPI and 30 of them have their own)
+	for( i = 0; i < STLINK_CMD_STATS_MAX_CMD + 8; i++ ) {
+		stats.Record(0x40, (uint8_t)i, 100, 16, 0, false);
+	}
+	BRG_TEST_CHECK(stats.GetStatsList(list, STLINK_CMD_STATS_MAX_CMD + 1) == STLINK_CMD_STATS_MAX_CMD);
+	BRG_TEST_CHECK(stats.GetStats(0xFF, 0xFF, &cmdStats) == true);
+	BRG_TEST_CHECK(cmdStats.Count == 10);
+
+	// Dump: one line per command, truncated and '\0' terminated
+	len = stats.Dump(dump, sizeof(dump));
+	BRG_TEST_CHECK((len > 0) && (len == strlen(dump)));
+	len = stats.Dump(small, sizeof(small));
+	BRG_TEST_CHECK(len == strlen(small));
+	BRG_TEST_CHECK(len < sizeof(small));
+	stats.Reset();
+	BRG_TEST_CHECK(stats.GetStatsList(list, STLINK_CMD_STATS_MAX_CMD + 1) == 0);
+
+	// Ticks converted consistently with GetTimeNs() (1 ms sleep, measured within 20%)
+	{
+		uint64_t startNs = StlinkCmdStats::GetTimeNs();
+		uint64_t startTicks = StlinkCmdStats::GetTicks();
+		uint64_t durationNs, ticksNs;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		ticksNs = stats.TicksToNs(StlinkCmdStats::GetTicks() - startTicks);
+		durationNs = StlinkCmdStats::GetTimeNs() - startNs;
+		BRG_TEST_CHECK((ticksNs >= durationNs - durationNs/5) && (ticksNs <= durationNs + durationNs/5));
+		BRG_TEST_CHECK(stats.TicksToNs((uint64_t)-1) == 0);
+	}
+
+	// Recording from a thread while another one reads and dumps
+	std::thread recorder([&stats]() {
+		for( uint32_t k = 0; k < 200000; k++ ) {
+			stats.Record(STLINK_BRIDGE_COMMAND, (uint8_t)(k & 3), 1000 + k, 16, 0, false);
+		}
+	});
+	for( i = 0; i < 200; i++ ) {
+		stats.Dump(dump, sizeof(dump));
+		stats.GetStatsList(list, STLINK_CMD_STATS_MAX_CMD + 1);
+	}
+	recorder.join();
+	BRG_TEST_CHECK(stats.GetStatsList(list, STLINK_CMD_STATS_MAX_CMD + 1) == 4);
+	BRG_TEST_CHECK(list[0].Count + list[1].Count + list[2].Count + list[3].Count == 200000);
+
+	// Commands recorded by the Brg
+	{
+		BrgTestBench bench(false);
+		BrgSimI2cMemSlave mem(256, 1);
+		Brg brg(bench.m_itf);
+		uint8_t data[5] = {0x10, 1, 2, 3, 4};
+		uint16_t sizeDone;
+
+		bench.m_sim.AttachI2cSlave(0, 0x50, &mem);
+		BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+		BRG_TEST_CHECK(BrgTestInitI2C(brg, I2C_FAST_PLUS, 1000) == BRG_NO_ERR);
+		brg.ResetCmdStats();
+		BRG_TEST_CHECK(brg.WriteI2C(data, 0x50, 5, &sizeDone) == BRG_NO_ERR);
+		BRG_TEST_CHECK(brg.GetCmdStats(STLINK_BRIDGE_WRITE_I2C, &cmdStats) == BRG_NO_ERR);
+		BRG_TEST_CHECK((cmdStats.Count == 1) && (cmdStats.ErrorCount == 0));
+		BRG_TEST_CHECK(brg.GetCmdStats(STLINK_BRIDGE_GET_RWCMD_STATUS, &cmdStats) == BRG_NO_ERR);
+		BRG_TEST_CHECK(cmdStats.Count == 1);
+		BRG_TEST_CHECK(brg.DumpCmdStats(dump, sizeof(dump)) > 0);
+		// Disabled: nothing recorded, the statistics are kept
+		brg.EnableCmdStats(false);
+		BRG_TEST_CHECK(brg.WriteI2C(data, 0x50, 5, &sizeDone) == BRG_NO_ERR);
+		BRG_TEST_CHECK(brg.GetCmdStats(STLINK_BRIDGE_WRITE_I2C, &cmdStats) == BRG_NO_ERR);
+		BRG_TEST_CHECK(cmdStats.Count == 1);
+		brg.EnableCmdStats(true);
+		BRG_TEST_CHECK(brg.WriteI2C(data, 0x50, 5, &sizeDone) == BRG_NO_ERR);
+		BRG_TEST_CHECK(brg.GetCmdStats(STLINK_BRIDGE_WRITE_I2C, &cmdStats) == BRG_NO_ERR);
+		BRG_TEST_CHECK(cmdStats.Count == 2);
+		brg.CloseBridge(COM_UNDEF_ALL);
+		brg.CloseStlink();
+	}
+}
+
+/**
+ * @ingroup TEST
+ * @brief Overhead added to each USB command by StlinkDevice::SendRequest(): two
+ *        StlinkCmdStats::GetTicks(), StlinkCmdStats::TicksToNs() and StlinkCmdStats::Record(),
+ *        checked below 100 ns; a single StlinkCmdStats::IsEnabled() when disabled.
+ */
+void BenchCmdStats(void)
+{
+	StlinkCmdStats stats;
+	uint64_t startNs, recordNs, ticksNs, timeNs, cmdNs, runNs, disabledNs;
+	volatile uint64_t sink = 0;
+	double overheadNs;
+	uint32_t i, run;
+
+	startNs = StlinkCmdStats::GetTimeNs();
+	for( i = 0; i < TEST_CMD_STATS_BENCH_NB; i++ ) {
+		stats.Record(STLINK_BRIDGE_COMMAND, (uint8_t)(i & 3), (uint64_t)(i % 9973)*100, 80, 0, false);
+	}
+	recordNs = StlinkCmdStats::GetTimeNs() - startNs;
+
+	startNs = StlinkCmdStats::GetTimeNs();
+	for( i = 0; i < TEST_CMD_STATS_BENCH_NB; i++ ) {
+		sink += StlinkCmdStats::GetTicks();
+	}
+	ticksNs = StlinkCmdStats::GetTimeNs() - startNs;
+
+	startNs = StlinkCmdStats::GetTimeNs();
+	for( i = 0; i < TEST_CMD_STATS_BENCH_NB; i++ ) {
+		sink += StlinkCmdStats::GetTimeNs();
+	}
+	timeNs = StlinkCmdStats::GetTimeNs() - startNs;
+
+	// Same sequence as StlinkDevice::SendRequest() around the USB command, best of
+	// TEST_CMD_STATS_BENCH_RUNS runs (preemptions of the bench thread excluded)
+	cmdNs = (uint64_t)-1;
+	for( run = 0; run < TEST_CMD_STATS_BENCH_RUNS; run++ ) {
+		startNs = StlinkCmdStats::GetTimeNs();
+		for( i = 0; i < TEST_CMD_STATS_BENCH_NB; i++ ) {
+			if( stats.IsEnabled() == true ) {
+				uint64_t cmdStartTicks = StlinkCmdStats::GetTicks();
+				stats.Record(STLINK_BRIDGE_COMMAND, (uint8_t)(i & 3),
+				             stats.TicksToNs(StlinkCmdStats::GetTicks() - cmdStartTicks), 80, 0, false);
+			}
+		}
+		runNs = StlinkCmdStats::GetTimeNs() - startNs;
+		if( runNs < cmdNs ) {
+			cmdNs = runNs;
+		}
+	}
+
+	stats.SetEnabled(false);
+	startNs = StlinkCmdStats::GetTimeNs();
+	for( i = 0; i < TEST_CMD_STATS_BENCH_NB; i++ ) {
+		if( stats.IsEnabled() == true ) {
+			sink += StlinkCmdStats::GetTicks();
+		}
+	}
+	disabledNs = StlinkCmdStats::GetTimeNs() - startNs;
+
+	overheadNs = (double)cmdNs/TEST_CMD_STATS_BENCH_NB;
+	printf("Record %.1f ns, GetTicks %.1f ns (GetTimeNs %.1f ns), per command overhead %.1f ns "
+	       "(budget 100 ns), disabled %.1f ns\n",
+	       (double)recordNs/TEST_CMD_STATS_BENCH_NB, (double)ticksNs/TEST_CMD_STATS_BENCH_NB,
+	       (double)timeNs/TEST_CMD_STATS_BENCH_NB, overheadNs, (double)disabledNs/TEST_CMD_STATS_BENCH_NB);
+	BRG_TEST_CHECK(overheadNs < 100);
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,219 @@
+/**
+  ******************************************************************************
+  * @file    test_device_lock.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "devlock": commands sent concurrently to several devices
+  *          (per device locking), throughput scaling with the number of devices.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+#include "stlink_cmd_stats.h"
+
+#include <string.h>
+#include <mutex>
+#include <thread>
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_LOCK_DEVICE_MAX  4
+#define TEST_LOCK_SLAVE_ADDR  0x50
+#define TEST_LOCK_WRITE_NB    300
+#define TEST_LOCK_BENCH_NB    500
+
+/* Private typedef -----------------------------------------------------------*/
+/// TestSerialTransport Class: simulator reached through one transport-wide command lock, as the
+/// transports did before per device locking (reference of the benchmark).
+class TestSerialTransport : public STLinkTransport
+{
+public:
+	TestSerialTransport(BrgSimTransport &Sim): m_sim(Sim) {}
+
+	virtual uint32_t Reenumerate(STLink_EnumStlinkInterfaceT IfId, uint8_t bClearList) {
+		return m_sim.Reenumerate(IfId, bClearList);
+	}
+	virtual uint32_t GetNbDevices(STLink_EnumStlinkInterfaceT IfId) {
+		return m_sim.GetNbDevices(IfId);
+	}
+	virtual uint32_t GetDeviceInfo2(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+	                                STLink_DeviceInfo2T *pInfo, uint32_t InfoSize) {
+		return m_sim.GetDeviceInfo2(IfId, DevIdxInList, pInfo, InfoSize);
+	}
+	virtual uint32_t OpenDevice(STLink_EnumStlinkInterfaceT IfId, uint8_t DevIdxInList,
+	                            uint8_t bExclusiveAccess, void **pHandle) {
+		return m_sim.OpenDevice(IfId, DevIdxInList, bExclusiveAccess, pHandle);
+	}
+	virtual uint32_t CloseDevice(void *pHandle) {
+		return m_sim.CloseDevice(pHandle);
+	}
+	virtual uint32_t SendCommand(void *pHandle, STLink_DeviceRequestT *pRequest, uint32_t TimeoutMs) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_sim.SendCommand(pHandle, pRequest, TimeoutMs);
+	}
+
+private:
+	BrgSimTransport &m_sim;
+	std::mutex m_mutex;
+};
+
+/*
+ * private: TEST_LOCK_WRITE_NB writes of a device specific pattern, each read back
+ */
+static void WriteReadLoop(Brg *pBrg, uint8_t DevIdx, int *pErrorNb)
+{
+	uint8_t txBuf[17], rxBuf[16];
+	uint16_t sizeDone;
+	int i, j;
+
+	for( i = 0; i < TEST_LOCK_WRITE_NB; i++ ) {
+		txBuf[0] = (uint8_t)((i*16) & 0xFF);
+		for( j = 0; j < 16; j++ ) {
+			txBuf[1 + j] = (uint8_t)(DevIdx*64 + i + j);
+		}
+		if( (pBrg->WriteI2C(txBuf, TEST_LOCK_SLAVE_ADDR, 17, &sizeDone) != BRG_NO_ERR) ||
+		    (pBrg->WriteReadI2C(TEST_LOCK_SLAVE_ADDR, txBuf, 1, rxBuf, 16) != BRG_NO_ERR) ||
+		    (memcmp(rxBuf, &txBuf[1], 16) != 0) ) {
+			(*pErrorNb)++;
+		}
+	}
+}
+
+/*
+ * private: I2C writes per second of NbDevices devices, one thread each, through the interface Itf
+ */
+static double MeasureWriteRate(STLinkInterface &Itf, uint8_t NbDevices)
+{
+	Brg *pBrg[TEST_LOCK_DEVICE_MAX];
+	std::thread *pThreads[TEST_LOCK_DEVICE_MAX];
+	uint64_t startNs, durationNs;
+	uint8_t dev;
+
+	for( dev = 0; dev < NbDevices; dev++ ) {
+		pBrg[dev] = new Brg(Itf);
+		BRG_TEST_CHECK(pBrg[dev]->OpenStlink(dev) == BRG_NO_ERR);
+		BRG_TEST_CHECK(BrgTestInitI2C(*pBrg[dev], I2C_FAST_PLUS, 1000) == BRG_NO_ERR);
+	}
+	startNs = StlinkCmdStats::GetTimeNs();
+	for( dev = 0; dev < NbDevices; dev++ ) {
+		pThreads[dev] = new std::thread([](Brg *pDevBrg) {
+			uint8_t data[16] = {0};
+			uint16_t sizeDone;
+			for( int i = 0; i < TEST_LOCK_BENCH_NB; i++ ) {
+				pDevBrg->WriteI2C(data, TEST_LOCK_SLAVE_ADDR, 16, &sizeDone);
+			}
+		}, pBrg[dev]);
+	}
+	for( dev = 0; dev < NbDevices; dev++ ) {
+		pThreads[dev]->join();
+		delete pThreads[dev];
+	}
+	durationNs = StlinkCmdStats::GetTimeNs() - startNs;
+	for( dev = 0; dev < NbDevices; dev++ ) {
+		pBrg[dev]->CloseBridge(COM_UNDEF_ALL);
+		pBrg[dev]->CloseStlink();
+		delete pBrg[dev];
+	}
+	return (double)NbDevices*TEST_LOCK_BENCH_NB*1000000000/durationNs;
+}
+
+/**
+ * @ingroup TEST
+ * @brief Writes and read backs from one thread per device (4 devices), each device receiving only
+ *        its own data, while another thread opens and closes one more device.
+ */
+void TestDeviceLock(void)
+{
+	BrgTestBench bench(false, TEST_LOCK_DEVICE_MAX + 1);
+	BrgSimI2cMemSlave *pMem[TEST_LOCK_DEVICE_MAX];
+	Brg *pBrg[TEST_LOCK_DEVICE_MAX];
+	std::thread *pThreads[TEST_LOCK_DEVICE_MAX];
+	int errorNb[TEST_LOCK_DEVICE_MAX];
+	uint8_t dev;
+
+	for( dev = 0; dev < TEST_LOCK_DEVICE_MAX; dev++ ) {
+		pMem[dev] = new BrgSimI2cMemSlave(256, 1);
+		bench.m_sim.AttachI2cSlave(dev, TEST_LOCK_SLAVE_ADDR, pMem[dev]);
+		pBrg[dev] = new Brg(bench.m_itf);
+		BRG_TEST_CHECK(pBrg[dev]->OpenStlink(dev) == BRG_NO_ERR);
+		BRG_TEST_CHECK(BrgTestInitI2C(*pBrg[dev], I2C_FAST_PLUS, 1000) == BRG_NO_ERR);
+		errorNb[dev] = 0;
+	}
+	for( dev = 0; dev < TEST_LOCK_DEVICE_MAX; dev++ ) {
+		pThreads[dev] = new std::thread(WriteReadLoop, pBrg[dev], dev, &errorNb[dev]);
+	}
+	{
+		Brg other(bench.m_itf);
+		int i;
+		for( i = 0; i < 50; i++ ) {
+			BRG_TEST_CHECK(other.OpenStlink(TEST_LOCK_DEVICE_MAX) == BRG_NO_ERR);
+			other.CloseStlink();
+		}
+	}
+	for( dev = 0; dev < TEST_LOCK_DEVICE_MAX; dev++ ) {
+		pThreads[dev]->join();
+		delete pThreads[dev];
+		BRG_TEST_CHECK(errorNb[dev] == 0);
+		// Last pattern written at 0x00-0xFF, wrapped (TEST_LOCK_WRITE_NB writes of 16 bytes)
+		BRG_TEST_CHECK(pMem[dev]->GetMem()[((TEST_LOCK_WRITE_NB - 1)*16) & 0xFF] ==
+		               (uint8_t)(dev*64 + TEST_LOCK_WRITE_NB - 1));
+		pBrg[dev]->CloseBridge(COM_UNDEF_ALL);
+		pBrg[dev]->CloseStlink();
+		delete pBrg[dev];
+		delete pMem[dev];
+	}
+}
+
+/**
+ * @ingroup TEST
+ * @brief I2C writes per second (real time simulation, 1 MHz, 16 bytes) of 1, 2 and 4 devices, one
+ *        thread each, with the per device locks and through a transport-wide command lock.
+ */
+void BenchDeviceLock(void)
+{
+	BrgTestBench bench(true, TEST_LOCK_DEVICE_MAX);
+	TestSerialTransport serialTransport(bench.m_sim);
+	STLinkInterface serialItf(STLINK_BRIDGE);
+	BrgSimI2cMemSlave *pMem[TEST_LOCK_DEVICE_MAX];
+	double perDeviceRate, serialRate, singleRate = 0;
+	uint8_t nbDevices, dev;
+
+	serialItf.SetTransport(&serialTransport);
+	serialItf.LoadStlinkLibrary(NULL);
+	for( dev = 0; dev < TEST_LOCK_DEVICE_MAX; dev++ ) {
+		pMem[dev] = new BrgSimI2cMemSlave(256, 1);
+		bench.m_sim.AttachI2cSlave(dev, TEST_LOCK_SLAVE_ADDR, pMem[dev]);
+	}
+	for( nbDevices = 1; nbDevices <= TEST_LOCK_DEVICE_MAX; nbDevices *= 2 ) {
+		perDeviceRate = MeasureWriteRate(bench.m_itf, nbDevices);
+		serialRate = MeasureWriteRate(serialItf, nbDevices);
+		if( nbDevices == 1 ) {
+			singleRate = perDeviceRate;
+		}
+		printf("%u device(s): per device locks %.0f writes/s (x%.2f), transport lock %.0f writes/s (x%.2f)\n",
+		       nbDevices, perDeviceRate, perDeviceRate/singleRate, serialRate, serialRate/singleRate);
+	}
+	for( dev = 0; dev < TEST_LOCK_DEVICE_MAX; dev++ ) {
+		delete pMem[dev];
+	}
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,121 @@
+/**
+  ******************************************************************************
+  * @file    test_gather.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "gather": Brg::WriteSPI() and Brg::WriteI2C() with data
+  *          spans.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_GATHER_SIZE_MAX 300
+
+/* Private classes -----------------------------------------------------------*/
+// SPI slave recording the bytes received
+class TestSpiRecorder : public BrgSimSpiSlave
+{
+public:
+	TestSpiRecorder(void) : m_size(0) {}
+
+	virtual uint8_t Transfer(uint8_t Mosi) {
+		if( m_size < sizeof(m_data) ) {
+			m_data[m_size] = Mosi;
+		}
+		m_size++;
+		return 0;
+	}
+
+	uint8_t m_data[TEST_GATHER_SIZE_MAX + 1];
+	uint32_t m_size;
+};
+
+/**
+ * @ingroup TEST
+ * @brief Header span followed by the payload split in two spans: bytes in the CDB only, in the data stage
+ *        from a single span (sent in place) or from several spans (gathered), empty spans, wrong spans.
+ */
+void TestGather(void)
+{
+	BrgTestBench bench(false);
+	BrgSimI2cMemSlave mem(256, 1);
+	TestSpiRecorder spiRec;
+	Brg brg(bench.m_itf);
+	Brg_SpiInitT spiInit;
+	Brg_SpanT spans[3];
+	uint8_t payload[TEST_GATHER_SIZE_MAX];
+	uint8_t header = 0x20;
+	uint16_t sizeDone;
+	// Sizes of the two payload spans
+	const int splits[][2] = { {3, 10}, {0, 20}, {2, 0}, {3, 200}, {100, 100}, {0, 0} };
+	int i, total;
+
+	bench.m_sim.AttachI2cSlave(0, 0x50, &mem);
+	bench.m_sim.AttachSpiSlave(0, &spiRec);
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+	BRG_TEST_CHECK(BrgTestInitI2C(brg, I2C_FAST_PLUS, 1000) == BRG_NO_ERR);
+	memset(&spiInit, 0, sizeof(spiInit));
+	spiInit.Baudrate = SPI_BAUDRATEPRESCALER_2;
+	spiInit.Nss = SPI_NSS_SOFT;
+	BRG_TEST_CHECK(brg.InitSPI(&spiInit) == BRG_NO_ERR);
+	for( i = 0; i < TEST_GATHER_SIZE_MAX; i++ ) {
+		payload[i] = (uint8_t)(i*7 + 1);
+	}
+
+	for( i = 0; i < (int)(sizeof(splits)/sizeof(splits[0])); i++ ) {
+		total = splits[i][0] + splits[i][1];
+		spans[0].pData = &header;
+		spans[0].SizeInBytes = 1;
+		spans[1].pData = payload;
+		spans[1].SizeInBytes = (uint16_t)splits[i][0];
+		spans[2].pData = &payload[splits[i][0]];
+		spans[2].SizeInBytes = (uint16_t)splits[i][1];
+
+		memset(mem.GetMem(), 0, 256);
+		BRG_TEST_CHECK(brg.WriteI2C(spans, 3, 0x50, &sizeDone) == BRG_NO_ERR);
+		BRG_TEST_CHECK(memcmp(mem.GetMem() + header, payload, total) == 0);
+
+		spiRec.m_size = 0;
+		BRG_TEST_CHECK(brg.WriteSPI(spans, 3, &sizeDone) == BRG_NO_ERR);
+		BRG_TEST_CHECK(spiRec.m_size == (uint32_t)(total + 1));
+		BRG_TEST_CHECK((spiRec.m_data[0] == header) && (memcmp(&spiRec.m_data[1], payload, total) == 0));
+	}
+
+	// NULL data with a size, no data at all
+	spans[0].pData = NULL;
+	spans[0].SizeInBytes = 2;
+	spans[1].pData = payload;
+	spans[1].SizeInBytes = 1;
+	BRG_TEST_CHECK(brg.WriteSPI(spans, 2, &sizeDone) == BRG_PARAM_ERR);
+	spans[0].SizeInBytes = 0;
+	BRG_TEST_CHECK(brg.WriteI2C(spans, 1, 0x50, &sizeDone) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(brg.WriteSPI(spans, 1, &sizeDone) == BRG_NO_ERR);
+
+	brg.CloseBridge(COM_UNDEF_ALL);
+	brg.CloseStlink();
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
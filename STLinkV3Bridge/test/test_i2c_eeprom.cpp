@@ -0,0 +1,202 @@
+/**
+  ******************************************************************************
+  * @file    test_i2c_eeprom.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "eeprom": BrgI2cEeprom page writes, ACK polling and
+  *          verify, programming time against a fixed tWR max delay.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+#include "bridge_i2c_eeprom.h"
+
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+// 24C256: 32 KB, 64 bytes pages
+#define TEST_EEPROM_SIZE        32768
+#define TEST_EEPROM_PAGE_SIZE   64
+// Fixed delay of the programming without ACK polling (24C256 tWR max)
+#define TEST_EEPROM_TWR_MAX_NS  5000000ULL
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t s_image[TEST_EEPROM_SIZE];
+
+/*
+ * private: simulated I2C bus timing (write cycle time of the EEPROM models)
+ */
+static void SetBusTiming(BrgTestBench &Bench)
+{
+	BrgSimConfT conf;
+
+	Bench.m_sim.GetConf(&conf);
+	conf.bBusTiming = true;
+	BRG_TEST_CHECK(Bench.m_sim.SetConf(&conf) == SS_OK);
+}
+
+/**
+ * @ingroup TEST
+ * @brief Program and verify of a 24C256 and of a 24C02 (1 address byte), unaligned write across pages,
+ *        verify error, out of range write, absent EEPROM, write cycle timeout.
+ */
+void TestI2cEeprom(void)
+{
+	BrgTestBench bench(false);
+	BrgSimI2cEeprom mem256(TEST_EEPROM_SIZE, TEST_EEPROM_PAGE_SIZE, 2, 3000);
+	BrgSimI2cEeprom mem02(256, 8, 1, 3000);
+	Brg brg(bench.m_itf);
+	BrgI2cEeprom eeprom256(brg), eeprom02(brg), eepromAbsent(brg);
+	Brg_I2cEepromConfT conf256 = {0x50, TEST_EEPROM_SIZE, TEST_EEPROM_PAGE_SIZE, 2, 10};
+	Brg_I2cEepromConfT conf02 = {0x51, 256, 8, 1, 10};
+	Brg_I2cEepromConfT confAbsent = {0x52, 256, 8, 1, 10};
+	Brg_I2cEepromStatsT stats;
+	uint8_t pattern[100];
+	uint8_t readBuf[200];
+	uint32_t errorAddr = 0;
+	uint32_t i;
+
+	SetBusTiming(bench);
+	bench.m_sim.AttachI2cSlave(0, 0x50, &mem256);
+	bench.m_sim.AttachI2cSlave(0, 0x51, &mem02);
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+	BRG_TEST_CHECK(BrgTestInitI2C(brg, I2C_FAST, 400) == BRG_NO_ERR);
+	for( i = 0; i < TEST_EEPROM_SIZE; i++ ) {
+		s_image[i] = (uint8_t)(i*13 + (i >> 8) + 7);
+	}
+
+	// 24C256: one write cycle per page
+	BRG_TEST_CHECK(eeprom256.Write(0, s_image, 1) == BRG_COM_INIT_NOT_DONE);
+	BRG_TEST_CHECK(eeprom256.Init(&conf256) == BRG_NO_ERR);
+	BRG_TEST_CHECK(eeprom256.Program(0, s_image, TEST_EEPROM_SIZE, &errorAddr) == BRG_NO_ERR);
+	BRG_TEST_CHECK(memcmp(mem256.GetMem(), s_image, TEST_EEPROM_SIZE) == 0);
+	BRG_TEST_CHECK(mem256.GetWriteCycleNb() == TEST_EEPROM_SIZE/TEST_EEPROM_PAGE_SIZE);
+	eeprom256.GetStats(&stats);
+	BRG_TEST_CHECK(stats.PageWriteNb == TEST_EEPROM_SIZE/TEST_EEPROM_PAGE_SIZE);
+	BRG_TEST_CHECK(stats.PollNb > stats.PageWriteNb);
+	BRG_TEST_CHECK(mem256.GetBusyNackNb() > 0);
+
+	// Unaligned write across pages: neighbouring bytes unchanged
+	memset(pattern, 0xA5, sizeof(pattern));
+	BRG_TEST_CHECK(eeprom256.Write(30, pattern, sizeof(pattern)) == BRG_NO_ERR);
+	BRG_TEST_CHECK(memcmp(mem256.GetMem() + 30, pattern, sizeof(pattern)) == 0);
+	BRG_TEST_CHECK((mem256.GetMem()[29] == s_image[29]) && (mem256.GetMem()[130] == s_image[130]));
+	BRG_TEST_CHECK(eeprom256.Read(0, readBuf, sizeof(readBuf)) == BRG_NO_ERR);
+	BRG_TEST_CHECK((readBuf[0] == s_image[0]) && (readBuf[30] == 0xA5) && (readBuf[129] == 0xA5));
+
+	// Verify error: first different byte
+	memcpy(mem256.GetMem() + 30, s_image + 30, sizeof(pattern));
+	mem256.GetMem()[1000] ^= 1;
+	BRG_TEST_CHECK(eeprom256.Verify(0, s_image, TEST_EEPROM_SIZE, &errorAddr) == BRG_VERIF_ERR);
+	BRG_TEST_CHECK(errorAddr == 1000);
+
+	// 24C02: block of 1 address byte, range check
+	BRG_TEST_CHECK(eeprom02.Init(&conf02) == BRG_NO_ERR);
+	BRG_TEST_CHECK(eeprom02.Program(3, s_image, 250, &errorAddr) == BRG_NO_ERR);
+	BRG_TEST_CHECK(memcmp(mem02.GetMem() + 3, s_image, 250) == 0);
+	BRG_TEST_CHECK(eeprom02.Write(200, s_image, 100) == BRG_PARAM_ERR);
+
+	// No EEPROM at this address
+	BRG_TEST_CHECK(eepromAbsent.Init(&confAbsent) == BRG_NO_ERR);
+	BRG_TEST_CHECK(eepromAbsent.Write(0, s_image, 4) == BRG_I2C_ERR);
+
+	brg.CloseBridge(COM_UNDEF_ALL);
+	brg.CloseStlink();
+
+	// Write cycle longer than WriteTimeoutMs (real time simulation: the timeout is measured on the host)
+	{
+		BrgTestBench rtBench(true);
+		BrgSimI2cEeprom slowMem(256, 8, 1, 50000);
+		Brg rtBrg(rtBench.m_itf);
+		BrgI2cEeprom slowEeprom(rtBrg);
+		Brg_I2cEepromConfT slowConf = {0x50, 256, 8, 1, 5};
+
+		SetBusTiming(rtBench);
+		rtBench.m_sim.AttachI2cSlave(0, 0x50, &slowMem);
+		BRG_TEST_CHECK(rtBrg.OpenStlink(0) == BRG_NO_ERR);
+		BRG_TEST_CHECK(BrgTestInitI2C(rtBrg, I2C_FAST, 400) == BRG_NO_ERR);
+		BRG_TEST_CHECK(slowEeprom.Init(&slowConf) == BRG_NO_ERR);
+		BRG_TEST_CHECK(slowEeprom.Write(0, s_image, 1) == BRG_TARGET_CMD_TIMEOUT);
+		rtBrg.CloseBridge(COM_UNDEF_ALL);
+		rtBrg.CloseStlink();
+	}
+}
+
+/**
+ * @ingroup TEST
+ * @brief Simulated 24C256 programming time (program and verify, 1 MHz) with ACK polling, for several
+ *        write cycle times, against the same page writes each followed by a fixed tWR max delay.
+ */
+void BenchI2cEeprom(void)
+{
+	const uint32_t writeCycleUs[] = {1500, 3000, 5000};
+	Brg_I2cEepromConfT conf = {0x50, TEST_EEPROM_SIZE, TEST_EEPROM_PAGE_SIZE, 2, 10};
+	Brg_I2cEepromConfT confZero = {0x51, TEST_EEPROM_SIZE, TEST_EEPROM_PAGE_SIZE, 2, 10};
+	Brg_I2cEepromStatsT stats;
+	uint64_t startNs, pollingNs, zeroNs, pollNs, fixedDelayNs;
+	uint8_t memAddr[2] = {0, 0};
+	uint16_t sizeDone;
+	uint32_t i;
+
+	for( i = 0; i < TEST_EEPROM_SIZE; i++ ) {
+		s_image[i] = (uint8_t)(i*13 + 7);
+	}
+
+	for( i = 0; i < sizeof(writeCycleUs)/sizeof(writeCycleUs[0]); i++ ) {
+		BrgTestBench bench(false);
+		BrgSimI2cEeprom mem(TEST_EEPROM_SIZE, TEST_EEPROM_PAGE_SIZE, 2, writeCycleUs[i]);
+		// No write cycle time: page writes and read back only
+		BrgSimI2cEeprom memZero(TEST_EEPROM_SIZE, TEST_EEPROM_PAGE_SIZE, 2, 0);
+		Brg brg(bench.m_itf);
+		BrgI2cEeprom eeprom(brg), eepromZero(brg);
+
+		SetBusTiming(bench);
+		bench.m_sim.AttachI2cSlave(0, 0x50, &mem);
+		bench.m_sim.AttachI2cSlave(0, 0x51, &memZero);
+		BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+		BRG_TEST_CHECK(BrgTestInitI2C(brg, I2C_FAST_PLUS, 1000) == BRG_NO_ERR);
+		BRG_TEST_CHECK(eeprom.Init(&conf) == BRG_NO_ERR);
+		BRG_TEST_CHECK(eepromZero.Init(&confZero) == BRG_NO_ERR);
+
+		startNs = BrgTestSimTimeNs(bench.m_sim, 0);
+		BRG_TEST_CHECK(eeprom.Program(0, s_image, TEST_EEPROM_SIZE) == BRG_NO_ERR);
+		pollingNs = BrgTestSimTimeNs(bench.m_sim, 0) - startNs;
+
+		startNs = BrgTestSimTimeNs(bench.m_sim, 0);
+		BRG_TEST_CHECK(eepromZero.Program(0, s_image, TEST_EEPROM_SIZE) == BRG_NO_ERR);
+		zeroNs = BrgTestSimTimeNs(bench.m_sim, 0) - startNs;
+		eepromZero.GetStats(&stats);
+
+		// Fixed delay: the polls (ACKed at once) replaced by tWR max per page
+		startNs = BrgTestSimTimeNs(bench.m_sim, 0);
+		brg.WriteI2C(memAddr, 0x51, 2, &sizeDone);
+		pollNs = BrgTestSimTimeNs(bench.m_sim, 0) - startNs;
+		fixedDelayNs = zeroNs - stats.PollNb*pollNs + stats.PageWriteNb*TEST_EEPROM_TWR_MAX_NS;
+
+		printf("tWR %u us: ACK polling %.0f ms, fixed %llu ms delay %.0f ms\n", writeCycleUs[i],
+		       (double)pollingNs/1000000, TEST_EEPROM_TWR_MAX_NS/1000000, (double)fixedDelayNs/1000000);
+		brg.CloseBridge(COM_UNDEF_ALL);
+		brg.CloseStlink();
+	}
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
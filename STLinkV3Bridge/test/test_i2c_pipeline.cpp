@@ -0,0 +1,225 @@
+/**
+  ******************************************************************************
+  * @file    test_i2c_pipeline.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "pipeline": BrgI2cReadPipeline sample order and data,
+  *          register address, error of a read or of a read issue.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+#include "bridge_i2c_pipeline.h"
+
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_PIPE_SLAVE_ADDR  0x48
+#define TEST_PIPE_REG_ADDR    0x1234
+#define TEST_PIPE_SAMPLE_SIZE 16
+#define TEST_PIPE_SAMPLE_NB   20
+
+/* Private classes -----------------------------------------------------------*/
+// I2C sensor: byte i of the nth read (from 1) is n + i, the register address written before each
+// read is checked, the read or write transaction number m_nakRead/m_nakWrite is NACKed
+class TestSampleSlave : public BrgSimI2cSlave
+{
+public:
+	TestSampleSlave(void) { Reset(); }
+
+	virtual bool Start(bool bRead) {
+		if( bRead == true ) {
+			m_readNb++;
+			if( m_reg != TEST_PIPE_REG_ADDR ) {
+				m_regErrorNb++;
+			}
+			m_reg = 0;
+			m_byteIdx = 0;
+			return (m_readNb != m_nakRead);
+		}
+		m_writeNb++;
+		m_reg = 0;
+		return (m_writeNb != m_nakWrite);
+	}
+	virtual bool WriteByte(uint8_t Data) {
+		m_reg = (uint16_t)((m_reg << 8) | Data);
+		return true;
+	}
+	virtual uint8_t ReadByte(void) {
+		return (uint8_t)(m_readNb + m_byteIdx++);
+	}
+
+	void Reset(void) {
+		m_readNb = 0;
+		m_writeNb = 0;
+		m_nakRead = 0;
+		m_nakWrite = 0;
+		m_regErrorNb = 0;
+		m_reg = 0;
+		m_byteIdx = 0;
+	}
+
+	uint32_t m_readNb;
+	uint32_t m_writeNb;
+	uint32_t m_nakRead;
+	uint32_t m_nakWrite;
+	uint32_t m_regErrorNb;
+
+private:
+	uint16_t m_reg;
+	uint32_t m_byteIdx;
+};
+
+/*
+ * private: NbSamples Read() of the started Pipeline, each checked against the slave content,
+ * returns the number of samples with wrong data
+ */
+static uint32_t ReadSamples(BrgI2cReadPipeline &Pipeline, uint32_t NbSamples)
+{
+	uint8_t sample[TEST_PIPE_SAMPLE_SIZE];
+	uint32_t errorNb = 0;
+	uint32_t n, i;
+
+	for( n = 1; n <= NbSamples; n++ ) {
+		memset(sample, 0, sizeof(sample));
+		BRG_TEST_CHECK(Pipeline.Read(sample) == BRG_NO_ERR);
+		for( i = 0; i < TEST_PIPE_SAMPLE_SIZE; i++ ) {
+			if( sample[i] != (uint8_t)(n + i) ) {
+				errorNb++;
+				break;
+			}
+		}
+	}
+	return errorNb;
+}
+
+/**
+ * @ingroup TEST
+ * @brief Samples returned in order with a 2-byte register address, NACK of the read of a sample and
+ *        of its register address write reported by the Read() of that sample, the previous samples
+ *        being valid, parameter and order checks, older firmware.
+ */
+void TestI2cPipeline(void)
+{
+	BrgTestBench bench(false);
+	TestSampleSlave slave;
+	Brg brg(bench.m_itf);
+	BrgI2cReadPipeline pipeline(brg);
+	Brg_I2cPipelineConfT conf;
+	Brg_I2cPipelineStatsT stats;
+	BrgSimConfT simConf;
+	uint8_t sample[TEST_PIPE_SAMPLE_SIZE];
+	uint16_t sizeRead;
+
+	// Bus timing at 100 KHz: the reads are still in progress at the Brg::ReadNoWaitI2C() answer
+	bench.m_sim.GetConf(&simConf);
+	simConf.bBusTiming = true;
+	BRG_TEST_CHECK(bench.m_sim.SetConf(&simConf) == SS_OK);
+	bench.m_sim.AttachI2cSlave(0, TEST_PIPE_SLAVE_ADDR, &slave);
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+	BRG_TEST_CHECK(BrgTestInitI2C(brg, I2C_STANDARD, 100) == BRG_NO_ERR);
+
+	memset(&conf, 0, sizeof(conf));
+	conf.Addr = TEST_PIPE_SLAVE_ADDR;
+	conf.AddrMode = I2C_ADDR_7BIT;
+	conf.SizeInBytes = TEST_PIPE_SAMPLE_SIZE;
+	conf.RegAddrSize = 2;
+	conf.RegAddr = TEST_PIPE_REG_ADDR;
+	conf.CmdTimeoutMs = DEFAULT_CMD_TIMEOUT;
+
+	// Parameters and order
+	BRG_TEST_CHECK(pipeline.Start(NULL) == BRG_PARAM_ERR);
+	conf.SizeInBytes = 0;
+	BRG_TEST_CHECK(pipeline.Start(&conf) == BRG_PARAM_ERR);
+	conf.SizeInBytes = BRG_I2C_PIPELINE_MAX_SIZE + 1;
+	BRG_TEST_CHECK(pipeline.Start(&conf) == BRG_PARAM_ERR);
+	conf.SizeInBytes = TEST_PIPE_SAMPLE_SIZE;
+	BRG_TEST_CHECK(pipeline.Read(sample) == BRG_COM_CMD_ORDER_ERR);
+
+	// Samples in order, one read issued ahead (discarded by Stop())
+	BRG_TEST_CHECK(pipeline.Start(&conf) == BRG_NO_ERR);
+	BRG_TEST_CHECK(pipeline.IsStarted() == true);
+	BRG_TEST_CHECK(pipeline.Start(&conf) == BRG_COM_CMD_ORDER_ERR);
+	BRG_TEST_CHECK(pipeline.Read(NULL) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(ReadSamples(pipeline, TEST_PIPE_SAMPLE_NB) == 0);
+	pipeline.GetStats(&stats);
+	BRG_TEST_CHECK(stats.SampleNb == TEST_PIPE_SAMPLE_NB);
+	BRG_TEST_CHECK(stats.PollNb >= TEST_PIPE_SAMPLE_NB);
+	BRG_TEST_CHECK(pipeline.Stop() == BRG_NO_ERR);
+	BRG_TEST_CHECK(pipeline.IsStarted() == false);
+	BRG_TEST_CHECK(slave.m_readNb == TEST_PIPE_SAMPLE_NB + 1);
+	BRG_TEST_CHECK(slave.m_writeNb == TEST_PIPE_SAMPLE_NB + 1);
+	BRG_TEST_CHECK(slave.m_regErrorNb == 0);
+	// Brg usable again after Stop()
+	BRG_TEST_CHECK(brg.ReadI2C(sample, TEST_PIPE_SLAVE_ADDR, 4, &sizeRead) == BRG_NO_ERR);
+
+	// Read of the 4th sample NACKed: error returned by the 4th Read(), pipeline stopped
+	slave.Reset();
+	slave.m_nakRead = 4;
+	BRG_TEST_CHECK(pipeline.Start(&conf) == BRG_NO_ERR);
+	BRG_TEST_CHECK(ReadSamples(pipeline, 3) == 0);
+	BRG_TEST_CHECK(pipeline.Read(sample, &sizeRead) == BRG_I2C_ERR);
+	BRG_TEST_CHECK(sizeRead == 0);
+	BRG_TEST_CHECK(pipeline.IsStarted() == false);
+	BRG_TEST_CHECK(pipeline.Read(sample) == BRG_COM_CMD_ORDER_ERR);
+	pipeline.GetStats(&stats);
+	BRG_TEST_CHECK(stats.SampleNb == 3);
+	BRG_TEST_CHECK(slave.m_readNb == 4);
+
+	// Register address write of the 3rd sample NACKed (issued by the 2nd Read()): returned by the 3rd Read()
+	slave.Reset();
+	slave.m_nakWrite = 3;
+	BRG_TEST_CHECK(pipeline.Start(&conf) == BRG_NO_ERR);
+	BRG_TEST_CHECK(ReadSamples(pipeline, 2) == 0);
+	BRG_TEST_CHECK(pipeline.IsStarted() == false);
+	BRG_TEST_CHECK(pipeline.Read(sample, &sizeRead) == BRG_I2C_ERR);
+	BRG_TEST_CHECK(sizeRead == 0);
+	BRG_TEST_CHECK(pipeline.Read(sample) == BRG_COM_CMD_ORDER_ERR);
+	BRG_TEST_CHECK(slave.m_readNb == 2);
+
+	// Restarted after an error
+	slave.Reset();
+	BRG_TEST_CHECK(pipeline.Start(&conf) == BRG_NO_ERR);
+	BRG_TEST_CHECK(ReadSamples(pipeline, 2) == 0);
+	BRG_TEST_CHECK(pipeline.Stop() == BRG_NO_ERR);
+
+	brg.CloseBridge(COM_UNDEF_ALL);
+	brg.CloseStlink();
+
+	// Firmware without STLINK_BRIDGE_READ_NO_WAIT_I2C
+	{
+		BrgTestBench oldBench(false);
+		Brg oldBrg(oldBench.m_itf);
+		BrgI2cReadPipeline oldPipeline(oldBrg);
+
+		oldBench.m_sim.GetConf(&simConf);
+		simConf.BridgeFwVersion = FIRMWARE_BRIDGE_MIN_VER_FOR_READ_NO_WAIT_I2C - 1;
+		BRG_TEST_CHECK(oldBench.m_sim.SetConf(&simConf) == SS_OK);
+		BRG_TEST_CHECK(oldBrg.OpenStlink(0) == BRG_OLD_FIRMWARE_WARNING);
+		BRG_TEST_CHECK(BrgTestInitI2C(oldBrg, I2C_FAST_PLUS, 1000) == BRG_NO_ERR);
+		BRG_TEST_CHECK(oldPipeline.Start(&conf) == BRG_CMD_NOT_SUPPORTED);
+		oldBrg.CloseBridge(COM_UNDEF_ALL);
+		oldBrg.CloseStlink();
+	}
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,237 @@
+/**
+  ******************************************************************************
+  * @file    test_i2c_timing.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "i2ctiming": Brg::GetI2cTiming() (pruned calculation and
+  *          result cache) against the reference exhaustive calculation.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+#include "stlink_cmd_stats.h"
+
+/* Private typedef -----------------------------------------------------------*/
+// Sweep result
+typedef struct {
+	uint32_t CaseNb;
+	uint32_t SolvedNb;
+	uint32_t DiffNb;
+} TestTimingSweepT;
+
+/* Private defines -----------------------------------------------------------*/
+// Frequencies checked per mode by the quick sweep (the full sweep checks all of them)
+#define TEST_TIMING_QUICK_FREQ_NB  10
+// Random parameter sets of the full sweep, per I2C input clock
+#define TEST_TIMING_RANDOM_NB      5334
+#define TEST_TIMING_BENCH_NB       200
+// Differences printed
+#define TEST_TIMING_PRINT_MAX      10
+
+/* Private variables ---------------------------------------------------------*/
+// Max frequency (KHz), rise time and fall time (ns) of I2C_STANDARD, I2C_FAST, I2C_FAST_PLUS
+static const int s_maxFreq[3] = {100, 400, 1000};
+static const int s_maxRise[3] = {1000, 300, 120};
+static const int s_maxFall[3] = {300, 300, 120};
+
+// I2C input clocks (KHz), the first three swept over all the frequencies
+static const uint32_t s_clocks[] = {16000, 48000, 100000, 32000, 24000, 8000, 64000, 80000, 96000,
+                                    1000, 4000, 12000};
+
+/*
+ * private: one parameter set, Brg::GetI2cTiming() compared to the reference calculation
+ */
+static void CheckTiming(Brg &BrgDevice, uint32_t ClkKHz, I2cModeT Mode, int Freq, int DNFn,
+                        int RiseTime, int FallTime, bool bAF, TestTimingSweepT *pSweep)
+{
+	uint32_t refReg = 0, timingReg = 0;
+	Brg_StatusT refStat, brgStat;
+
+	refStat = BrgTestRefI2cTimingReg(Mode, Freq, (double)ClkKHz, DNFn, RiseTime, FallTime, bAF, &refReg);
+	brgStat = BrgDevice.GetI2cTiming(Mode, Freq, DNFn, RiseTime, FallTime, bAF, &timingReg);
+	pSweep->CaseNb++;
+	if( (refStat != brgStat) || (refReg != timingReg) ) {
+		if( pSweep->DiffNb < TEST_TIMING_PRINT_MAX ) {
+			printf("DIFF clk %u mode %d freq %d dnf %d rise %d fall %d af %d: ref %d 0x%08X, brg %d 0x%08X\n",
+			       ClkKHz, (int)Mode, Freq, DNFn, RiseTime, FallTime, (int)bAF,
+			       (int)refStat, refReg, (int)brgStat, timingReg);
+		}
+		pSweep->DiffNb++;
+	} else if( brgStat == BRG_NO_ERR ) {
+		pSweep->SolvedNb++;
+	}
+}
+
+/*
+ * private: sweep of one I2C input clock. Quick: some frequencies of each mode, analog filter on/off.
+ * Full: all the frequencies of each mode with DNF 0/15, analog filter on/off, no or max rise/fall
+ * times (first three clocks), and pseudo-random parameter sets.
+ */
+static void SweepClock(uint32_t ClkKHz, bool bFull, bool bAllFreq, TestTimingSweepT *pSweep)
+{
+	BrgTestBench bench(false);
+	BrgSimConfT conf;
+	Brg brg(bench.m_itf);
+	uint32_t seed = ClkKHz;
+	int mode, freq, step, af, dnf, edge;
+	uint32_t i;
+
+	bench.m_sim.GetConf(&conf);
+	conf.I2cInputClkKHz = ClkKHz;
+	BRG_TEST_CHECK(bench.m_sim.SetConf(&conf) == SS_OK);
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+
+	for( mode = 0; mode < 3; mode++ ) {
+		if( bFull == false ) {
+			step = s_maxFreq[mode]/TEST_TIMING_QUICK_FREQ_NB;
+			for( freq = s_maxFreq[mode]; freq >= 1; freq -= step ) {
+				for( af = 0; af < 2; af++ ) {
+					CheckTiming(brg, ClkKHz, (I2cModeT)mode, freq, 0, s_maxRise[mode]/2, s_maxFall[mode]/2,
+					            af == 1, pSweep);
+				}
+			}
+		} else if( bAllFreq == true ) {
+			for( freq = 1; freq <= s_maxFreq[mode]; freq++ ) {
+				for( af = 0; af < 2; af++ ) {
+					for( dnf = 0; dnf < 16; dnf += 15 ) {
+						for( edge = 0; edge < 2; edge++ ) {
+							CheckTiming(brg, ClkKHz, (I2cModeT)mode, freq, dnf, edge*s_maxRise[mode],
+							            edge*s_maxFall[mode], af == 1, pSweep);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if( bFull == true ) {
+		for( i = 0; i < TEST_TIMING_RANDOM_NB; i++ ) {
+			seed = seed*1103515245 + 12345;
+			mode = (int)((seed >> 8) % 3);
+			freq = 1 + (int)((seed >> 10) % (uint32_t)s_maxFreq[mode]);
+			seed = seed*1103515245 + 12345;
+			dnf = (int)((seed >> 8) % 16);
+			af = (int)((seed >> 12) & 1);
+			edge = (int)((seed >> 13) % (uint32_t)(s_maxRise[mode] + 1));
+			seed = seed*1103515245 + 12345;
+			CheckTiming(brg, ClkKHz, (I2cModeT)mode, freq, dnf, edge,
+			            (int)((seed >> 8) % (uint32_t)(s_maxFall[mode] + 1)), af == 1, pSweep);
+		}
+	}
+
+	brg.CloseStlink();
+}
+
+/*
+ * private: sweep of all the clocks, print and check the result
+ */
+static void Sweep(bool bFull)
+{
+	TestTimingSweepT sweep = {0, 0, 0};
+	uint32_t i;
+
+	for( i = 0; i < sizeof(s_clocks)/sizeof(s_clocks[0]); i++ ) {
+		if( (bFull == true) || (i < 3) ) {
+			SweepClock(s_clocks[i], bFull, i < 3, &sweep);
+		}
+	}
+	printf("%s sweep: %u cases, %u solved, %u differences\n", (bFull == true) ? "Full" : "Quick",
+	       sweep.CaseNb, sweep.SolvedNb, sweep.DiffNb);
+	BRG_TEST_CHECK(sweep.DiffNb == 0);
+	BRG_TEST_CHECK(sweep.SolvedNb > 0);
+}
+
+/**
+ * @ingroup TEST
+ * @brief Quick equivalence sweep (3 I2C input clocks, 10 frequencies per mode), parameter checks and
+ *        cached results.
+ */
+void TestI2cTiming(void)
+{
+	BrgTestBench bench(false);
+	Brg brg(bench.m_itf);
+	uint32_t timingReg, cachedReg;
+	int i;
+
+	BRG_TEST_CHECK(brg.GetI2cTiming(I2C_FAST, 400, 0, 0, 0, false, &timingReg) == BRG_NO_STLINK);
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+	BRG_TEST_CHECK(brg.GetI2cTiming(I2C_FAST, 401, 0, 0, 0, false, &timingReg) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(brg.GetI2cTiming(I2C_FAST_PLUS, 1000, 16, 0, 0, false, &timingReg) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(brg.GetI2cTiming(I2C_STANDARD, 100, 0, 1001, 0, false, &timingReg) == BRG_PARAM_ERR);
+
+	// Same result from the cache, also once the cache entries were replaced
+	BRG_TEST_CHECK(brg.GetI2cTiming(I2C_FAST, 400, 0, 100, 100, true, &timingReg) == BRG_NO_ERR);
+	for( i = 0; i < 3*I2C_TIMING_CACHE_NB; i++ ) {
+		BRG_TEST_CHECK(brg.GetI2cTiming(I2C_FAST, 400, 0, 100, 100, true, &cachedReg) == BRG_NO_ERR);
+		BRG_TEST_CHECK(cachedReg == timingReg);
+		BRG_TEST_CHECK(brg.GetI2cTiming(I2C_FAST, 100 + i, 0, 0, 0, false, &cachedReg) == BRG_NO_ERR);
+	}
+	BRG_TEST_CHECK(brg.GetI2cTiming(I2C_FAST, 400, 0, 100, 100, true, &cachedReg) == BRG_NO_ERR);
+	BRG_TEST_CHECK(cachedReg == timingReg);
+	brg.CloseStlink();
+
+	Sweep(false);
+}
+
+/**
+ * @ingroup TEST
+ * @brief Full equivalence sweep (about 100000 parameter sets, several minutes: the reference
+ *        calculation takes some ms) and calculation time of the reference, of Brg::GetI2cTiming()
+ *        and of a cached Brg::GetI2cTiming() (GET_CLOCK command only).
+ */
+void BenchI2cTiming(void)
+{
+	BrgTestBench bench(false);
+	Brg brg(bench.m_itf);
+	uint64_t startNs, refNs, brgNs, cachedNs;
+	uint32_t timingReg;
+	int i;
+
+	Sweep(true);
+
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+	startNs = StlinkCmdStats::GetTimeNs();
+	for( i = 0; i < TEST_TIMING_BENCH_NB; i++ ) {
+		BrgTestRefI2cTimingReg(I2C_FAST, 400 - i, 48000, 0, 100, 100, true, &timingReg);
+	}
+	refNs = StlinkCmdStats::GetTimeNs() - startNs;
+
+	// Different frequency at each call: no cache hit
+	startNs = StlinkCmdStats::GetTimeNs();
+	for( i = 0; i < TEST_TIMING_BENCH_NB; i++ ) {
+		brg.GetI2cTiming(I2C_FAST, 400 - i, 0, 100, 100, true, &timingReg);
+	}
+	brgNs = StlinkCmdStats::GetTimeNs() - startNs;
+
+	startNs = StlinkCmdStats::GetTimeNs();
+	for( i = 0; i < TEST_TIMING_BENCH_NB; i++ ) {
+		brg.GetI2cTiming(I2C_FAST, 400, 0, 100, 100, true, &timingReg);
+	}
+	cachedNs = StlinkCmdStats::GetTimeNs() - startNs;
+	brg.CloseStlink();
+
+	printf("Reference %.1f us, GetI2cTiming %.2f us, cached %.2f us\n",
+	       (double)refNs/TEST_TIMING_BENCH_NB/1000, (double)brgNs/TEST_TIMING_BENCH_NB/1000,
+	       (double)cachedNs/TEST_TIMING_BENCH_NB/1000);
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,171 @@
+/**
+  ******************************************************************************
+  * @file    test_i2c_write_read.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "writeread": Brg::WriteReadI2C() register reads, register
+  *          read rate against separate write and read transactions.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+#include "bridge_i2c_cache.h"
+#include "stlink_cmd_stats.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_WR_SLAVE_ADDR   0x68
+#define TEST_WR_BENCH_NB     2000
+
+/* Private typedef -----------------------------------------------------------*/
+// Register read sequences compared by the benchmark
+typedef enum {
+	TEST_WR_WRITE_READ,        // WriteI2C() then ReadI2C()
+	TEST_WR_START_STOP,        // StartWriteI2C() then StopReadI2C()
+	TEST_WR_WRITE_READ_I2C,    // WriteReadI2C()
+	TEST_WR_SEQ_NB
+} TestWrSeqT;
+
+/*
+ * private: simulated bridge with bus timing, I2C memory (register n = n ^ 0x5A) at TEST_WR_SLAVE_ADDR
+ */
+static void InitBench(BrgTestBench &Bench, BrgSimI2cMemSlave &Mem)
+{
+	BrgSimConfT conf;
+	int i;
+
+	Bench.m_sim.GetConf(&conf);
+	conf.bBusTiming = true;
+	BRG_TEST_CHECK(Bench.m_sim.SetConf(&conf) == SS_OK);
+	for( i = 0; i < 256; i++ ) {
+		Mem.GetMem()[i] = (uint8_t)(i ^ 0x5A);
+	}
+	Bench.m_sim.AttachI2cSlave(0, TEST_WR_SLAVE_ADDR, &Mem);
+}
+
+/**
+ * @ingroup TEST
+ * @brief Register reads with 7 and 10bit addresses, absent slave, parameter checks, partial transactions
+ *        with a direction change, deferred status mode, register cache.
+ */
+void TestI2cWriteRead(void)
+{
+	BrgTestBench bench(false);
+	BrgSimI2cMemSlave mem(256, 1);
+	BrgSimI2cMemSlave mem10(256, 1);
+	Brg brg(bench.m_itf);
+	BrgI2cRegCache regCache(brg, TEST_WR_SLAVE_ADDR, I2C_ADDR_7BIT, 1);
+	uint8_t reg = 0x20;
+	uint8_t rxBuf[16];
+	uint8_t value;
+	uint16_t sizeDone = 0xFFFF;
+
+	InitBench(bench, mem);
+	bench.m_sim.AttachI2cSlave(0, I2C_10B_ADDR(0x2A5), &mem10);
+	mem10.GetMem()[7] = 0x77;
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+	BRG_TEST_CHECK(BrgTestInitI2C(brg, I2C_FAST_PLUS, 1000) == BRG_NO_ERR);
+
+	BRG_TEST_CHECK(brg.WriteReadI2C(TEST_WR_SLAVE_ADDR, &reg, 1, rxBuf, 16) == BRG_NO_ERR);
+	BRG_TEST_CHECK((rxBuf[0] == (0x20 ^ 0x5A)) && (rxBuf[15] == (0x2F ^ 0x5A)));
+	reg = 7;
+	BRG_TEST_CHECK(brg.WriteReadI2C(0x2A5, I2C_ADDR_10BIT, &reg, 1, rxBuf, 1, &sizeDone) == BRG_NO_ERR);
+	BRG_TEST_CHECK(rxBuf[0] == 0x77);
+
+	// Absent slave: write stage NACKed, read stage aborted
+	BRG_TEST_CHECK(brg.WriteReadI2C(TEST_WR_SLAVE_ADDR + 1, &reg, 1, rxBuf, 4, &sizeDone) == BRG_I2C_ERR);
+	BRG_TEST_CHECK(sizeDone == 0);
+	BRG_TEST_CHECK(brg.WriteReadI2C(TEST_WR_SLAVE_ADDR, NULL, 1, rxBuf, 4, &sizeDone) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(brg.WriteReadI2C(TEST_WR_SLAVE_ADDR, &reg, 1, rxBuf, 0, &sizeDone) == BRG_PARAM_ERR);
+
+	// Partial write then read: repeated START (simulator model, see Brg::WriteReadI2C())
+	reg = 0x30;
+	BRG_TEST_CHECK(brg.StartWriteI2C(&reg, TEST_WR_SLAVE_ADDR, 1, &sizeDone) == BRG_NO_ERR);
+	BRG_TEST_CHECK(brg.StopReadI2C(rxBuf, 2, &sizeDone) == BRG_NO_ERR);
+	BRG_TEST_CHECK(rxBuf[0] == (0x30 ^ 0x5A));
+	BRG_TEST_CHECK(brg.StopReadI2C(rxBuf, 2, &sizeDone) == BRG_COM_CMD_ORDER_ERR);
+
+	// Deferred status
+	BRG_TEST_CHECK(brg.SetRwStatusMode(RW_STATUS_DEFERRED, 0) == BRG_NO_ERR);
+	reg = 0x40;
+	BRG_TEST_CHECK(brg.WriteReadI2C(TEST_WR_SLAVE_ADDR, &reg, 1, rxBuf, 2) == BRG_NO_ERR);
+	BRG_TEST_CHECK(brg.SyncRwStatus() == BRG_NO_ERR);
+	BRG_TEST_CHECK(rxBuf[0] == (0x40 ^ 0x5A));
+	brg.WriteReadI2C(TEST_WR_SLAVE_ADDR + 1, &reg, 1, rxBuf, 2);
+	BRG_TEST_CHECK(brg.SyncRwStatus() == BRG_COM_CMD_ORDER_ERR);
+	BRG_TEST_CHECK(brg.SetRwStatusMode(RW_STATUS_IMMEDIATE, 0) == BRG_NO_ERR);
+
+	// Register cache reads
+	BRG_TEST_CHECK(regCache.Init(256) == BRG_NO_ERR);
+	BRG_TEST_CHECK(regCache.ReadReg(0x11, &value) == BRG_NO_ERR);
+	BRG_TEST_CHECK(value == (0x11 ^ 0x5A));
+
+	brg.CloseBridge(COM_UNDEF_ALL);
+	brg.CloseStlink();
+}
+
+/**
+ * @ingroup TEST
+ * @brief 2-byte register reads per second and USB commands per read (real time simulation, 1 MHz):
+ *        WriteI2C() + ReadI2C(), StartWriteI2C() + StopReadI2C(), WriteReadI2C().
+ */
+void BenchI2cWriteRead(void)
+{
+	const char *pSeqNames[TEST_WR_SEQ_NB] = {"WriteI2C + ReadI2C", "StartWriteI2C + StopReadI2C",
+	                                         "WriteReadI2C"};
+	BrgTestBench bench(true);
+	BrgSimI2cMemSlave mem(256, 1);
+	Brg brg(bench.m_itf);
+	BrgSimStatsT simStats;
+	uint64_t startNs, durationNs;
+	uint8_t reg = 0x20;
+	uint8_t rxBuf[2];
+	uint16_t sizeDone;
+	int seq, i;
+
+	InitBench(bench, mem);
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+	BRG_TEST_CHECK(BrgTestInitI2C(brg, I2C_FAST_PLUS, 1000) == BRG_NO_ERR);
+	for( seq = 0; seq < TEST_WR_SEQ_NB; seq++ ) {
+		bench.m_sim.ResetStats(0);
+		startNs = StlinkCmdStats::GetTimeNs();
+		for( i = 0; i < TEST_WR_BENCH_NB; i++ ) {
+			if( seq == TEST_WR_WRITE_READ ) {
+				BRG_TEST_CHECK(brg.WriteI2C(&reg, TEST_WR_SLAVE_ADDR, 1, &sizeDone) == BRG_NO_ERR);
+				BRG_TEST_CHECK(brg.ReadI2C(rxBuf, TEST_WR_SLAVE_ADDR, 2, &sizeDone) == BRG_NO_ERR);
+			} else if( seq == TEST_WR_START_STOP ) {
+				BRG_TEST_CHECK(brg.StartWriteI2C(&reg, TEST_WR_SLAVE_ADDR, 1, &sizeDone) == BRG_NO_ERR);
+				BRG_TEST_CHECK(brg.StopReadI2C(rxBuf, 2, &sizeDone) == BRG_NO_ERR);
+			} else {
+				BRG_TEST_CHECK(brg.WriteReadI2C(TEST_WR_SLAVE_ADDR, &reg, 1, rxBuf, 2) == BRG_NO_ERR);
+			}
+		}
+		durationNs = StlinkCmdStats::GetTimeNs() - startNs;
+		bench.m_sim.GetStats(0, &simStats);
+		printf("%-28s %.0f reads/s, %u USB commands per read\n", pSeqNames[seq],
+		       (double)TEST_WR_BENCH_NB*1000000000/durationNs, simStats.NbCommands/TEST_WR_BENCH_NB);
+	}
+
+	brg.CloseBridge(COM_UNDEF_ALL);
+	brg.CloseStlink();
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
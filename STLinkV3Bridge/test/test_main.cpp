@@ -0,0 +1,163 @@
+/**
+  ******************************************************************************
+  * @file    test_main.cpp
+  * @author  MCD Application Team
+  * @brief   STLINK-V3-BRIDGE library test program: runs the test suites on the
+  *          bridge simulator (BrgSimTransport), no STLink required.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ * Usage:\n
+ *   bridge_test              run the checks of all the suites\n
+ *   bridge_test isotp        run the checks of one suite\n
+ *   bridge_test --bench      run the checks and the benchmarks (real time simulation, slower)\n
+ *   bridge_test --bench can  ...of one suite\n
+ *   Exit code 0 if all the checks passed.
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private defines -----------------------------------------------------------*/
+/* Private macros ------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static const BrgTestSuiteT s_suites[] = {
+	{ "alloc", TestAlloc, NULL },
+	{ "async", TestAsync, NULL },
+	{ "batch", TestBatch, NULL },
+	{ "gather", TestGather, NULL },
+	{ "cmdstats", TestCmdStats, BenchCmdStats },
+	{ "i2ctiming", TestI2cTiming, BenchI2cTiming },
+	{ "eeprom", TestI2cEeprom, BenchI2cEeprom },
+	{ "writeread", TestI2cWriteRead, BenchI2cWriteRead },
+	{ "flash", TestSpiFlash, BenchSpiFlash },
+	{ "capture", TestCanCapture, BenchCanCapture },
+	{ "isotp", TestCanIsoTp, BenchCanIsoTp },
+	{ "devlock", TestDeviceLock, BenchDeviceLock },
+	{ "spistream", TestSpiStream, BenchSpiStream },
+	{ "pipeline", TestI2cPipeline, NULL },
+	{ "spsc", TestSpscRing, NULL },
+	{ "canrx", TestCanRx, NULL },
+	{ "cantx", TestCanTx, NULL },
+	{ "canfilter", TestCanFilter, BenchCanFilter },
+	{ "cansoft", TestCanSoftFilter, BenchCanSoftFilter },
+};
+
+/* Global variables ----------------------------------------------------------*/
+int g_brgTestFailNb = 0;
+
+/* Functions Definition ------------------------------------------------------*/
+
+/**
+ * @ingroup TEST
+ * @brief Simulated time of a device.
+ * @param[in]  Sim  Simulator used by the test.
+ * @param[in]  DevIdx  Index of the simulated device.
+ * @retval Simulated time in ns.
+ */
+uint64_t BrgTestSimTimeNs(BrgSimTransport &Sim, int DevIdx)
+{
+	BrgSimStatsT stats;
+
+	Sim.GetStats((uint8_t)DevIdx, &stats);
+	return stats.SimTimeNs;
+}
+
+/**
+ * @ingroup TEST
+ * @brief Initialize the I2C of a Brg (7bit addressing, no analog/digital filter).
+ * @param[in]  BrgDevice  Opened Brg.
+ * @param[in]  Mode  I2C_STANDARD, I2C_FAST or I2C_FAST_PLUS.
+ * @param[in]  SpeedKHz  I2C frequency.
+ * @retval Brg::InitI2C() status.
+ */
+Brg_StatusT BrgTestInitI2C(Brg &BrgDevice, I2cModeT Mode, int SpeedKHz)
+{
+	Brg_I2cInitT i2cInit;
+	Brg_StatusT brgStat;
+	uint32_t timingReg;
+
+	memset(&i2cInit, 0, sizeof(i2cInit));
+	brgStat = BrgDevice.GetI2cTiming(Mode, SpeedKHz, 0, 0, 0, false, &timingReg);
+	if( brgStat == BRG_NO_ERR ) {
+		i2cInit.TimingReg = timingReg;
+		i2cInit.OwnAddr = 0;
+		i2cInit.AddrMode = I2C_ADDR_7BIT;
+		i2cInit.AnFilterEn = I2C_FILTER_DISABLE;
+		i2cInit.DigitalFilterEn = I2C_FILTER_DISABLE;
+		i2cInit.Dnf = 0;
+		brgStat = BrgDevice.InitI2C(&i2cInit);
+	}
+	return brgStat;
+}
+
+/*
+ * private: run one suite, print its result
+ */
+static bool RunSuite(const BrgTestSuiteT *pSuite, bool bBench)
+{
+	int failNb = g_brgTestFailNb;
+
+	printf("[%s]\n", pSuite->pName);
+	pSuite->pTest();
+	if( bBench && (pSuite->pBench != NULL) ) {
+		pSuite->pBench();
+	}
+	failNb = g_brgTestFailNb - failNb;
+	printf("[%s] %s (%d failed checks)\n", pSuite->pName, (failNb == 0) ? "PASS" : "FAIL", failNb);
+	return failNb == 0;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *pName = NULL;
+	bool bBench = false;
+	bool bFound = false;
+	int suiteFailNb = 0;
+	size_t i;
+
+	for( i = 1; i < (size_t)argc; i++ ) {
+		if( strcmp(argv[i], "--bench") == 0 ) {
+			bBench = true;
+		} else {
+			pName = argv[i];
+		}
+	}
+
+	for( i = 0; i < sizeof(s_suites)/sizeof(s_suites[0]); i++ ) {
+		if( (pName == NULL) || (strcmp(pName, s_suites[i].pName) == 0) ) {
+			bFound = true;
+			if( RunSuite(&s_suites[i], bBench) == false ) {
+				suiteFailNb++;
+			}
+		}
+	}
+	if( bFound == false ) {
+		printf("Unknown test suite: %s\n", pName);
+		return 2;
+	}
+	printf("%d suite(s) failed, %d failed checks\n", suiteFailNb, g_brgTestFailNb);
+	return (g_brgTestFailNb == 0) ? 0 : 1;
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
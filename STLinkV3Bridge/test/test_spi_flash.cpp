@@ -0,0 +1,268 @@
+/**
+  ******************************************************************************
+  * @file    test_spi_flash.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "flash": BrgSpiFlash probe, erase, program and verify,
+  *          programming rate against separate bridge calls per step.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+#include "bridge_spi_flash.h"
+
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_FLASH_SIZE       (256*1024)
+#define TEST_FLASH_PAGE_SIZE  256
+// Typical times of the simulated flash (us): page program, 4KB sector erase, 32/64KB block erase
+#define TEST_FLASH_PP_US      600
+#define TEST_FLASH_SE_US      40000
+#define TEST_FLASH_BE_US      120000
+// Programmed by the checks (the benchmark programs the whole memory)
+#define TEST_FLASH_PROG_SIZE  (64*1024)
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t s_image[TEST_FLASH_SIZE];
+static uint8_t s_readBuf[TEST_FLASH_SIZE];
+
+/*
+ * private: simulated bridge with bus timing and a flash on its SPI (12MHz SCK), flash image with a
+ * sector of 0xFF
+ */
+static void InitBench(BrgTestBench &Bench, BrgSimSpiFlash &Flash, Brg &BrgDevice)
+{
+	BrgSimConfT conf;
+	Brg_SpiInitT spiInit;
+	uint32_t i;
+
+	Bench.m_sim.GetConf(&conf);
+	conf.bBusTiming = true;
+	BRG_TEST_CHECK(Bench.m_sim.SetConf(&conf) == SS_OK);
+	Bench.m_sim.AttachSpiSlave(0, &Flash);
+	BRG_TEST_CHECK(BrgDevice.OpenStlink(0) == BRG_NO_ERR);
+	memset(&spiInit, 0, sizeof(spiInit));
+	spiInit.Baudrate = SPI_BAUDRATEPRESCALER_4;
+	spiInit.Nss = SPI_NSS_SOFT;
+	spiInit.Mode = SPI_MODE_MASTER;
+	spiInit.DataSize = SPI_DATASIZE_8B;
+	spiInit.FirstBit = SPI_FIRSTBIT_MSB;
+	BRG_TEST_CHECK(BrgDevice.InitSPI(&spiInit) == BRG_NO_ERR);
+
+	for( i = 0; i < TEST_FLASH_SIZE; i++ ) {
+		s_image[i] = (uint8_t)(i*29 + (i >> 9) + 3);
+	}
+	memset(&s_image[8192], 0xFF, 4096);
+}
+
+/*
+ * private: steps of a flash driver without BrgSpiFlash: one bridge call per step, busy bit polled with
+ * a RDSR transaction per poll
+ */
+static void SimpleCmd(Brg &BrgDevice, const uint8_t *pCmd, uint16_t CmdSize)
+{
+	uint16_t sizeDone;
+
+	BrgDevice.SetSPIpinCS(SPI_NSS_LOW);
+	BrgDevice.WriteSPI(pCmd, CmdSize, &sizeDone);
+	BrgDevice.SetSPIpinCS(SPI_NSS_HIGH);
+}
+static void SimpleWait(Brg &BrgDevice)
+{
+	uint8_t rdsr = 0x05, status;
+	uint16_t sizeDone;
+
+	do {
+		BrgDevice.SetSPIpinCS(SPI_NSS_LOW);
+		BrgDevice.WriteSPI(&rdsr, 1, &sizeDone);
+		BrgDevice.ReadSPI(&status, 1, &sizeDone);
+		BrgDevice.SetSPIpinCS(SPI_NSS_HIGH);
+	} while( (status & 1) != 0 );
+}
+static void SimpleOp(Brg &BrgDevice, const uint8_t *pCmd, uint16_t CmdSize)
+{
+	uint8_t wren = 0x06;
+
+	SimpleCmd(BrgDevice, &wren, 1);
+	SimpleCmd(BrgDevice, pCmd, CmdSize);
+	SimpleWait(BrgDevice);
+}
+
+/**
+ * @ingroup TEST
+ * @brief SFDP probe, erase type selection, program and verify in both status modes, verify error,
+ *        unaligned write across pages, chip erase. Real time simulation: the program/erase timeouts
+ *        are measured on the host.
+ */
+void TestSpiFlash(void)
+{
+	BrgTestBench bench(true);
+	BrgSimSpiFlash flash(TEST_FLASH_SIZE, TEST_FLASH_PP_US, TEST_FLASH_SE_US, TEST_FLASH_BE_US);
+	Brg brg(bench.m_itf);
+	BrgSpiFlash spiFlash(brg);
+	Brg_SpiFlashInfoT info;
+	Brg_SpiFlashStatsT stats;
+	Brg_RwStatusModeT statusMode;
+	uint8_t pattern[300];
+	uint32_t errorAddr = 0;
+	uint32_t eraseNb, i;
+	int mode;
+	bool bErased;
+
+	InitBench(bench, flash, brg);
+
+	BRG_TEST_CHECK(spiFlash.Read(0, s_readBuf, 1) == BRG_COM_INIT_NOT_DONE);
+	BRG_TEST_CHECK(spiFlash.Probe(12000, &info) == BRG_NO_ERR);
+	BRG_TEST_CHECK((info.SizeInBytes == TEST_FLASH_SIZE) && (info.PageSize == TEST_FLASH_PAGE_SIZE));
+	BRG_TEST_CHECK((info.AddrSizeInBytes == 3) && (info.EraseTypeNb == 3) && (info.EraseSize[0] == 4096));
+	BRG_TEST_CHECK(spiFlash.Erase(100, 4096) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(spiFlash.Erase(0, TEST_FLASH_SIZE + 4096) == BRG_PARAM_ERR);
+
+	// Largest aligned erase types: 4KB + 32KB + 64KB + 4KB
+	memset(flash.GetMem(), 0, TEST_FLASH_SIZE);
+	eraseNb = flash.GetEraseNb();
+	BRG_TEST_CHECK(spiFlash.Erase(0x7000, 0x1000 + 0x8000 + 0x10000 + 0x1000) == BRG_NO_ERR);
+	BRG_TEST_CHECK(flash.GetEraseNb() - eraseNb == 4);
+	BRG_TEST_CHECK((flash.GetMem()[0x6FFF] == 0) && (flash.GetMem()[0x7000] == 0xFF));
+	BRG_TEST_CHECK((flash.GetMem()[0x20FFF] == 0xFF) && (flash.GetMem()[0x21000] == 0));
+
+	// Program (erase, write, verify), status mode of the Brg restored
+	for( mode = 0; mode < 2; mode++ ) {
+		statusMode = (mode == 0) ? RW_STATUS_IMMEDIATE : RW_STATUS_DEFERRED;
+		BRG_TEST_CHECK(brg.SetRwStatusMode(statusMode) == BRG_NO_ERR);
+		spiFlash.ResetStats();
+		BRG_TEST_CHECK(spiFlash.Program(0, s_image, TEST_FLASH_PROG_SIZE, &errorAddr) == BRG_NO_ERR);
+		BRG_TEST_CHECK(memcmp(flash.GetMem(), s_image, TEST_FLASH_PROG_SIZE) == 0);
+		BRG_TEST_CHECK(brg.GetRwStatusMode() == statusMode);
+		spiFlash.GetStats(&stats);
+		// Page of 0xFF skipped
+		BRG_TEST_CHECK(stats.PageProgramNb == (TEST_FLASH_PROG_SIZE - 4096)/TEST_FLASH_PAGE_SIZE);
+		BRG_TEST_CHECK(spiFlash.Read(0, s_readBuf, TEST_FLASH_PROG_SIZE) == BRG_NO_ERR);
+		BRG_TEST_CHECK(memcmp(s_readBuf, s_image, TEST_FLASH_PROG_SIZE) == 0);
+	}
+	BRG_TEST_CHECK(brg.SetRwStatusMode(RW_STATUS_IMMEDIATE) == BRG_NO_ERR);
+
+	// Verify error: first different address
+	flash.GetMem()[5000] ^= 1;
+	BRG_TEST_CHECK(spiFlash.Verify(0, s_image, TEST_FLASH_PROG_SIZE, &errorAddr) == BRG_VERIF_ERR);
+	BRG_TEST_CHECK(errorAddr == 5000);
+
+	// Unaligned write across pages
+	BRG_TEST_CHECK(spiFlash.Erase(0, 4096) == BRG_NO_ERR);
+	memset(pattern, 0x5A, sizeof(pattern));
+	BRG_TEST_CHECK(spiFlash.Write(100, pattern, sizeof(pattern)) == BRG_NO_ERR);
+	BRG_TEST_CHECK((flash.GetMem()[99] == 0xFF) && (flash.GetMem()[100] == 0x5A));
+	BRG_TEST_CHECK((flash.GetMem()[399] == 0x5A) && (flash.GetMem()[400] == 0xFF));
+	BRG_TEST_CHECK(spiFlash.Read(90, s_readBuf, 20) == BRG_NO_ERR);
+	BRG_TEST_CHECK((s_readBuf[9] == 0xFF) && (s_readBuf[10] == 0x5A));
+
+	// Whole memory: chip erase
+	BRG_TEST_CHECK(spiFlash.Erase(0, TEST_FLASH_SIZE) == BRG_NO_ERR);
+	bErased = true;
+	for( i = 0; (i < TEST_FLASH_SIZE) && (bErased == true); i++ ) {
+		bErased = (flash.GetMem()[i] == 0xFF);
+	}
+	BRG_TEST_CHECK(bErased == true);
+
+	brg.CloseBridge(COM_UNDEF_ALL);
+	brg.CloseStlink();
+}
+
+/**
+ * @ingroup TEST
+ * @brief Program and verify rate (real time simulation, 12MHz SCK) in both status modes, against a
+ *        driver with one bridge call per step, read rate, sector erase time.
+ */
+void BenchSpiFlash(void)
+{
+	BrgTestBench bench(true);
+	BrgSimSpiFlash flash(TEST_FLASH_SIZE, TEST_FLASH_PP_US, TEST_FLASH_SE_US, TEST_FLASH_BE_US);
+	Brg brg(bench.m_itf);
+	BrgSpiFlash spiFlash(brg);
+	Brg_SpiFlashStatsT stats;
+	uint64_t startNs, programNs, readNs;
+	uint8_t cmd[4 + TEST_FLASH_PAGE_SIZE];
+	uint16_t sizeDone;
+	uint64_t sizeRead;
+	uint32_t addr;
+	int mode;
+
+	InitBench(bench, flash, brg);
+	BRG_TEST_CHECK(spiFlash.Probe(12000) == BRG_NO_ERR);
+
+	for( mode = 0; mode < 2; mode++ ) {
+		BRG_TEST_CHECK(brg.SetRwStatusMode((mode == 0) ? RW_STATUS_IMMEDIATE : RW_STATUS_DEFERRED) == BRG_NO_ERR);
+		spiFlash.ResetStats();
+		startNs = StlinkCmdStats::GetTimeNs();
+		BRG_TEST_CHECK(spiFlash.Program(0, s_image, TEST_FLASH_SIZE) == BRG_NO_ERR);
+		programNs = StlinkCmdStats::GetTimeNs() - startNs;
+		spiFlash.GetStats(&stats);
+		startNs = StlinkCmdStats::GetTimeNs();
+		BRG_TEST_CHECK(spiFlash.Read(0, s_readBuf, TEST_FLASH_SIZE) == BRG_NO_ERR);
+		readNs = StlinkCmdStats::GetTimeNs() - startNs;
+		printf("BrgSpiFlash %s: program+verify %.1f KB/s (polls %u, busy status bytes %u), read %.0f KB/s\n",
+		       (mode == 0) ? "immediate" : "deferred", (double)TEST_FLASH_SIZE*1000000000/1024/programNs,
+		       stats.PollNb, stats.BusyStatusNb, (double)TEST_FLASH_SIZE*1000000000/1024/readNs);
+	}
+	BRG_TEST_CHECK(brg.SetRwStatusMode(RW_STATUS_IMMEDIATE) == BRG_NO_ERR);
+
+	// One bridge call per step: 64KB block erases, page programs, read back
+	startNs = StlinkCmdStats::GetTimeNs();
+	for( addr = 0; addr < TEST_FLASH_SIZE; addr += 0x10000 ) {
+		cmd[0] = 0xD8;
+		cmd[1] = (uint8_t)(addr >> 16);
+		cmd[2] = (uint8_t)(addr >> 8);
+		cmd[3] = (uint8_t)addr;
+		SimpleOp(brg, cmd, 4);
+	}
+	for( addr = 0; addr < TEST_FLASH_SIZE; addr += TEST_FLASH_PAGE_SIZE ) {
+		cmd[0] = 0x02;
+		cmd[1] = (uint8_t)(addr >> 16);
+		cmd[2] = (uint8_t)(addr >> 8);
+		cmd[3] = (uint8_t)addr;
+		memcpy(&cmd[4], &s_image[addr], TEST_FLASH_PAGE_SIZE);
+		SimpleOp(brg, cmd, sizeof(cmd));
+	}
+	cmd[0] = 0x03;
+	cmd[1] = cmd[2] = cmd[3] = 0;
+	brg.SetSPIpinCS(SPI_NSS_LOW);
+	brg.WriteSPI(cmd, 4, &sizeDone);
+	brg.ReadSPIStream(s_readBuf, TEST_FLASH_SIZE, &sizeRead);
+	brg.SetSPIpinCS(SPI_NSS_HIGH);
+	programNs = StlinkCmdStats::GetTimeNs() - startNs;
+	BRG_TEST_CHECK(memcmp(s_readBuf, s_image, TEST_FLASH_SIZE) == 0);
+	printf("One call per step: program+verify %.1f KB/s\n", (double)TEST_FLASH_SIZE*1000000000/1024/programNs);
+
+	spiFlash.ResetStats();
+	startNs = StlinkCmdStats::GetTimeNs();
+	BRG_TEST_CHECK(spiFlash.Erase(0x10000, 0x3000) == BRG_NO_ERR);
+	programNs = StlinkCmdStats::GetTimeNs() - startNs;
+	spiFlash.GetStats(&stats);
+	printf("3 sector erases (%u ms each): %.1f ms, polls %u\n", TEST_FLASH_SE_US/1000,
+	       (double)programNs/1000000, stats.PollNb);
+
+	brg.CloseBridge(COM_UNDEF_ALL);
+	brg.CloseStlink();
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
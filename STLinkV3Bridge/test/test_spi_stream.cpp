@@ -0,0 +1,216 @@
+/**
+  ******************************************************************************
+  * @file    test_spi_stream.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "spistream": Brg::ReadSPIStream() and Brg::WriteSPIStream()
+  *          chunking and data, throughput against chunked Brg::ReadSPI()/WriteSPI().
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+#include "stlink_cmd_stats.h"
+
+#include <string.h>
+#include <vector>
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_STREAM_SIZE_MAX   200001
+#define TEST_STREAM_BENCH_SIZE (2*1024*1024)
+
+/* Private classes -----------------------------------------------------------*/
+// SPI slave returning (index ^ 0x5A) and checking that MOSI is the byte index (mod 256)
+class TestSpiCounter : public BrgSimSpiSlave
+{
+public:
+	TestSpiCounter(void) : m_count(0), m_errorNb(0) {}
+
+	virtual uint8_t Transfer(uint8_t Mosi) {
+		uint8_t miso = (uint8_t)(m_count ^ 0x5A);
+		if( Mosi != (uint8_t)m_count ) {
+			m_errorNb++;
+		}
+		m_count++;
+		return miso;
+	}
+
+	void Reset(void) { m_count = 0; m_errorNb = 0; }
+
+	uint32_t m_count;
+	uint32_t m_errorNb;
+};
+
+/*
+ * private: SPI at 24 MHz (48 MHz input clock / 2), software NSS
+ */
+static Brg_StatusT InitSpi(Brg &BrgDevice)
+{
+	Brg_SpiInitT spiInit;
+
+	memset(&spiInit, 0, sizeof(spiInit));
+	spiInit.Baudrate = SPI_BAUDRATEPRESCALER_2;
+	spiInit.Nss = SPI_NSS_SOFT;
+	return BrgDevice.InitSPI(&spiInit);
+}
+
+/*
+ * private: Read/Write commands of device 0 since the last BrgSimTransport::ResetStats()
+ */
+static uint32_t GetRwCmdNb(BrgSimTransport &Sim)
+{
+	BrgSimStatsT stats;
+
+	Sim.GetStats(0, &stats);
+	return stats.NbCommands - stats.NbStatusCommands;
+}
+
+/*
+ * private: MB/s of SizeInBytes transferred in DurationNs
+ */
+static double GetRateMBs(uint64_t SizeInBytes, uint64_t DurationNs)
+{
+	return (DurationNs == 0) ? 0 : (double)SizeInBytes*1000/DurationNs;
+}
+
+/**
+ * @ingroup TEST
+ * @brief Streams of 1 byte, one chunk, one chunk + 1 byte and 4 chunks: data, size done and one
+ *        command per #BRG_SPI_STREAM_CHUNK_SIZE chunk, then empty stream and errors.
+ */
+void TestSpiStream(void)
+{
+	BrgTestBench bench(false);
+	TestSpiCounter counter;
+	Brg brg(bench.m_itf);
+	std::vector<uint8_t> buf(TEST_STREAM_SIZE_MAX);
+	const uint64_t sizes[] = { 1, BRG_SPI_STREAM_CHUNK_SIZE, BRG_SPI_STREAM_CHUNK_SIZE + 1, TEST_STREAM_SIZE_MAX };
+	uint64_t sizeDone, i;
+	uint32_t chunkNb, errorNb;
+	unsigned int s;
+
+	bench.m_sim.AttachSpiSlave(0, &counter);
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+
+	// SPI not initialized
+	BRG_TEST_CHECK(brg.ReadSPIStream(buf.data(), 10, &sizeDone) == BRG_COM_INIT_NOT_DONE);
+	BRG_TEST_CHECK(sizeDone == 0);
+	BRG_TEST_CHECK(InitSpi(brg) == BRG_NO_ERR);
+
+	for( s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++ ) {
+		chunkNb = (uint32_t)((sizes[s] + BRG_SPI_STREAM_CHUNK_SIZE - 1)/BRG_SPI_STREAM_CHUNK_SIZE);
+
+		memset(buf.data(), 0, buf.size());
+		counter.Reset();
+		bench.m_sim.ResetStats(0);
+		BRG_TEST_CHECK(brg.ReadSPIStream(buf.data(), sizes[s], &sizeDone) == BRG_NO_ERR);
+		BRG_TEST_CHECK(sizeDone == sizes[s]);
+		BRG_TEST_CHECK(GetRwCmdNb(bench.m_sim) == chunkNb);
+		errorNb = 0;
+		for( i = 0; i < sizes[s]; i++ ) {
+			if( buf[i] != (uint8_t)(i ^ 0x5A) ) {
+				errorNb++;
+			}
+		}
+		BRG_TEST_CHECK(errorNb == 0);
+		if( sizes[s] < buf.size() ) {
+			// Nothing written after the stream
+			BRG_TEST_CHECK(buf[sizes[s]] == 0);
+		}
+
+		for( i = 0; i < sizes[s]; i++ ) {
+			buf[i] = (uint8_t)i;
+		}
+		counter.Reset();
+		bench.m_sim.ResetStats(0);
+		BRG_TEST_CHECK(brg.WriteSPIStream(buf.data(), sizes[s], &sizeDone) == BRG_NO_ERR);
+		BRG_TEST_CHECK(sizeDone == sizes[s]);
+		BRG_TEST_CHECK(GetRwCmdNb(bench.m_sim) == chunkNb);
+		BRG_TEST_CHECK(counter.m_count == sizes[s]);
+		BRG_TEST_CHECK(counter.m_errorNb == 0);
+	}
+
+	// Empty stream: no command
+	bench.m_sim.ResetStats(0);
+	BRG_TEST_CHECK(brg.ReadSPIStream(buf.data(), 0, &sizeDone) == BRG_NO_ERR);
+	BRG_TEST_CHECK(brg.WriteSPIStream(buf.data(), 0, &sizeDone) == BRG_NO_ERR);
+	BRG_TEST_CHECK(sizeDone == 0);
+	BRG_TEST_CHECK(GetRwCmdNb(bench.m_sim) == 0);
+	// Wrong parameter
+	BRG_TEST_CHECK(brg.ReadSPIStream(NULL, 10, &sizeDone) == BRG_PARAM_ERR);
+	BRG_TEST_CHECK(brg.WriteSPIStream(NULL, 10, &sizeDone) == BRG_PARAM_ERR);
+
+	brg.CloseBridge(COM_UNDEF_ALL);
+	brg.CloseStlink();
+}
+
+/**
+ * @ingroup TEST
+ * @brief MB/s of a 2 MB read and write (real time simulation, SPI 24 MHz): Brg::ReadSPIStream() and
+ *        Brg::WriteSPIStream() against loops of Brg::ReadSPI()/WriteSPI() of 512 bytes and 4 KB.
+ */
+void BenchSpiStream(void)
+{
+	BrgTestBench bench(true);
+	TestSpiCounter counter;
+	Brg brg(bench.m_itf);
+	std::vector<uint8_t> buf(TEST_STREAM_BENCH_SIZE);
+	const uint16_t chunkSizes[] = { 512, 4096 };
+	uint64_t startNs, streamReadNs, streamWriteNs, readNs, writeNs, sizeDone;
+	uint32_t offset;
+	uint16_t chunkDone;
+	unsigned int c;
+
+	bench.m_sim.AttachSpiSlave(0, &counter);
+	BRG_TEST_CHECK(brg.OpenStlink(0) == BRG_NO_ERR);
+	BRG_TEST_CHECK(InitSpi(brg) == BRG_NO_ERR);
+
+	startNs = StlinkCmdStats::GetTimeNs();
+	BRG_TEST_CHECK(brg.ReadSPIStream(buf.data(), TEST_STREAM_BENCH_SIZE, &sizeDone) == BRG_NO_ERR);
+	streamReadNs = StlinkCmdStats::GetTimeNs() - startNs;
+	startNs = StlinkCmdStats::GetTimeNs();
+	BRG_TEST_CHECK(brg.WriteSPIStream(buf.data(), TEST_STREAM_BENCH_SIZE, &sizeDone) == BRG_NO_ERR);
+	streamWriteNs = StlinkCmdStats::GetTimeNs() - startNs;
+	printf("Stream (%u bytes chunks): read %.2f MB/s, write %.2f MB/s\n", BRG_SPI_STREAM_CHUNK_SIZE,
+	       GetRateMBs(TEST_STREAM_BENCH_SIZE, streamReadNs), GetRateMBs(TEST_STREAM_BENCH_SIZE, streamWriteNs));
+
+	for( c = 0; c < sizeof(chunkSizes)/sizeof(chunkSizes[0]); c++ ) {
+		startNs = StlinkCmdStats::GetTimeNs();
+		for( offset = 0; offset < TEST_STREAM_BENCH_SIZE; offset += chunkSizes[c] ) {
+			BRG_TEST_CHECK(brg.ReadSPI(&buf[offset], chunkSizes[c], &chunkDone) == BRG_NO_ERR);
+		}
+		readNs = StlinkCmdStats::GetTimeNs() - startNs;
+		startNs = StlinkCmdStats::GetTimeNs();
+		for( offset = 0; offset < TEST_STREAM_BENCH_SIZE; offset += chunkSizes[c] ) {
+			BRG_TEST_CHECK(brg.WriteSPI(&buf[offset], chunkSizes[c], &chunkDone) == BRG_NO_ERR);
+		}
+		writeNs = StlinkCmdStats::GetTimeNs() - startNs;
+		printf("ReadSPI/WriteSPI loop (%u bytes chunks): read %.2f MB/s (stream x%.2f), "
+		       "write %.2f MB/s (stream x%.2f)\n", chunkSizes[c],
+		       GetRateMBs(TEST_STREAM_BENCH_SIZE, readNs), (double)readNs/streamReadNs,
+		       GetRateMBs(TEST_STREAM_BENCH_SIZE, writeNs), (double)writeNs/streamWriteNs);
+	}
+
+	brg.CloseBridge(COM_UNDEF_ALL);
+	brg.CloseStlink();
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,218 @@
+/**
+  ******************************************************************************
+  * @file    test_spsc_ring.cpp
+  * @author  MCD Application Team
+  * @brief   Test suite "spsc": BrgSpscRing full/empty, slot wrap and order,
+  *          producer and consumer threads.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2019 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/** @addtogroup TEST
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(_MSC_VER) &&  (_MSC_VER >= 1000)
+#include "stdafx.h"  // first include for windows visual studio
+#endif
+
+#include "bridge_test.h"
+#include "bridge_spsc_ring.h"
+
+#include <string.h>
+#include <thread>
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_SPSC_THREAD_NB   200000
+#define TEST_SPSC_THREAD_RING 64
+
+/* Private typedef -----------------------------------------------------------*/
+// Element of the producer/consumer test: sequence number and its complement in every word
+typedef struct {
+	uint32_t Seq;
+	uint32_t Check[3];
+} TestSpscElemT;
+
+/*
+ * private: producer of TEST_SPSC_THREAD_NB elements, alternately through Push() and
+ * GetWriteSlot()/Commit(), yielding when the ring is full (single CPU hosts)
+ */
+static void Produce(BrgSpscRing *pRing, uint32_t *pFullNb)
+{
+	TestSpscElemT elem;
+	TestSpscElemT *pSlot;
+	uint32_t seq = 0;
+
+	while( seq < TEST_SPSC_THREAD_NB ) {
+		if( (seq & 1) == 0 ) {
+			elem.Seq = seq;
+			elem.Check[0] = elem.Check[1] = elem.Check[2] = ~seq;
+			if( pRing->Push(&elem) == true ) {
+				seq++;
+				continue;
+			}
+		} else {
+			pSlot = (TestSpscElemT*)pRing->GetWriteSlot();
+			if( pSlot != NULL ) {
+				pSlot->Seq = seq;
+				pSlot->Check[0] = pSlot->Check[1] = pSlot->Check[2] = ~seq;
+				pRing->Commit();
+				seq++;
+				continue;
+			}
+		}
+		(*pFullNb)++;
+		std::this_thread::yield();
+	}
+}
+
+/**
+ * @ingroup TEST
+ * @brief Not initialized ring, capacity rounding, full and empty ring, slots reused in order over
+ *        several wraps (copy and in place), Init() emptying the ring, then TEST_SPSC_THREAD_NB
+ *        elements from a producer thread to a consumer thread through a TEST_SPSC_THREAD_RING ring.
+ */
+void TestSpscRing(void)
+{
+	BrgSpscRing ring;
+	BrgSpscRing threadRing;
+	TestSpscElemT elem;
+	const TestSpscElemT *pElem;
+	const void *pSlot;
+	uint32_t value, expected, next, i, errorNb, fullNb, emptyNb;
+
+	// Not initialized
+	value = 0;
+	BRG_TEST_CHECK(ring.GetWriteSlot() == NULL);
+	BRG_TEST_CHECK(ring.Push(&value) == false);
+	BRG_TEST_CHECK(ring.GetReadSlot() == NULL);
+	BRG_TEST_CHECK(ring.Pop(&value) == false);
+	BRG_TEST_CHECK(ring.Init(0, 4) == BRG_PARAM_ERR);
+
+	// Capacity rounded up to a power of 2, min 2
+	BRG_TEST_CHECK(ring.Init(sizeof(uint32_t), 1) == BRG_NO_ERR);
+	BRG_TEST_CHECK(ring.GetCapacity() == 2);
+	BRG_TEST_CHECK(ring.Init(sizeof(uint32_t), 5) == BRG_NO_ERR);
+	BRG_TEST_CHECK(ring.GetCapacity() == 8);
+	BRG_TEST_CHECK(ring.Init(sizeof(uint32_t), 4) == BRG_NO_ERR);
+	BRG_TEST_CHECK(ring.GetCapacity() == 4);
+
+	// Full then empty
+	for( value = 0; value < 4; value++ ) {
+		BRG_TEST_CHECK(ring.Push(&value) == true);
+	}
+	BRG_TEST_CHECK(ring.GetCount() == 4);
+	BRG_TEST_CHECK(ring.Push(&value) == false);
+	BRG_TEST_CHECK(ring.GetWriteSlot() == NULL);
+	for( expected = 0; expected < 4; expected++ ) {
+		BRG_TEST_CHECK((ring.Pop(&value) == true) && (value == expected));
+	}
+	BRG_TEST_CHECK(ring.GetCount() == 0);
+	BRG_TEST_CHECK(ring.Pop(&value) == false);
+	BRG_TEST_CHECK(ring.GetReadSlot() == NULL);
+
+	// Wrap: up to 3 written and 2 read per round, in order, then filled and drained
+	next = 0;
+	expected = 0;
+	errorNb = 0;
+	for( i = 0; i < 10; i++ ) {
+		if( ring.Push(&next) == true ) {
+			next++;
+		}
+		if( i & 1 ) {
+			// Written in place
+			uint32_t *pWrite = (uint32_t*)ring.GetWriteSlot();
+			if( pWrite != NULL ) {
+				*pWrite = next++;
+				ring.Commit();
+			}
+		} else if( ring.Push(&next) == true ) {
+			next++;
+		}
+		if( ring.Push(&next) == true ) {
+			next++;
+		}
+		// Read in place, same slot until Release()
+		pSlot = ring.GetReadSlot();
+		BRG_TEST_CHECK((pSlot != NULL) && (pSlot == ring.GetReadSlot()));
+		if( (pSlot == NULL) || (*(const uint32_t*)pSlot != expected) ) {
+			errorNb++;
+		}
+		ring.Release();
+		expected++;
+		if( (ring.Pop(&value) == false) || (value != expected) ) {
+			errorNb++;
+		}
+		expected++;
+		BRG_TEST_CHECK(ring.GetCount() == next - expected);
+	}
+	BRG_TEST_CHECK(next > 4*ring.GetCapacity());
+	while( ring.Push(&next) == true ) {
+		next++;
+	}
+	BRG_TEST_CHECK(ring.GetCount() == ring.GetCapacity());
+	while( ring.Pop(&value) == true ) {
+		if( value != expected ) {
+			errorNb++;
+		}
+		expected++;
+	}
+	BRG_TEST_CHECK(errorNb == 0);
+	BRG_TEST_CHECK(expected == next);
+
+	// Init() empties a used ring
+	BRG_TEST_CHECK(ring.Push(&value) == true);
+	BRG_TEST_CHECK(ring.Init(sizeof(uint32_t), 4) == BRG_NO_ERR);
+	BRG_TEST_CHECK(ring.GetCount() == 0);
+	BRG_TEST_CHECK(ring.Pop(&value) == false);
+
+	// Producer and consumer threads, each waiting for the other when the ring is full or empty
+	BRG_TEST_CHECK(threadRing.Init(sizeof(TestSpscElemT), TEST_SPSC_THREAD_RING) == BRG_NO_ERR);
+	fullNb = 0;
+	emptyNb = 0;
+	errorNb = 0;
+	expected = 0;
+	std::thread producer(Produce, &threadRing, &fullNb);
+	while( expected < TEST_SPSC_THREAD_NB ) {
+		if( (expected & 1) == 0 ) {
+			if( threadRing.Pop(&elem) == false ) {
+				emptyNb++;
+				std::this_thread::yield();
+				continue;
+			}
+			pElem = &elem;
+		} else {
+			pElem = (const TestSpscElemT*)threadRing.GetReadSlot();
+			if( pElem == NULL ) {
+				emptyNb++;
+				std::this_thread::yield();
+				continue;
+			}
+		}
+		if( (pElem->Seq != expected) || (pElem->Check[0] != ~expected) ||
+		    (pElem->Check[1] != ~expected) || (pElem->Check[2] != ~expected) ) {
+			errorNb++;
+		}
+		if( (expected & 1) != 0 ) {
+			threadRing.Release();
+		}
+		expected++;
+	}
+	producer.join();
+	BRG_TEST_CHECK(errorNb == 0);
+	BRG_TEST_CHECK(threadRing.GetCount() == 0);
+	BRG_TEST_CHECK((fullNb + emptyNb) > 0);
+}
+
+/** @} */
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -2,7 +2,11 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
     STLinkV3Bridge \
+    bridge_test \
     serialBridgeApp
 
+# Library test program (runs on the bridge simulator)
+bridge_test.file = STLinkV3Bridge/test/bridge_test.pro
+
 OTHER_FILES += \
     README.md